@@ -45,6 +45,7 @@ quiche_core_hdrs = [
     "common/platform/api/quiche_thread.h",
     "common/platform/api/quiche_time_utils.h",
     "common/platform/api/quiche_url_utils.h",
+    "common/pooled_buffer_allocator.h",
     "common/print_elements.h",
     "common/quiche_buffer_allocator.h",
     "common/quiche_circular_deque.h",
@@ -130,6 +131,7 @@ quiche_core_hdrs = [
     "quic/core/congestion_control/bbr2_probe_rtt.h",
     "quic/core/congestion_control/bbr2_sender.h",
     "quic/core/congestion_control/bbr2_startup.h",
+    "quic/core/congestion_control/bbr2_subnet_bandwidth_cache.h",
     "quic/core/congestion_control/bbr_sender.h",
     "quic/core/congestion_control/cubic_bytes.h",
     "quic/core/congestion_control/general_loss_algorithm.h",
@@ -155,6 +157,7 @@ quiche_core_hdrs = [
     "quic/core/crypto/aes_base_decrypter.h",
     "quic/core/crypto/aes_base_encrypter.h",
     "quic/core/crypto/boring_utils.h",
+    "quic/core/crypto/caching_proof_verifier.h",
     "quic/core/crypto/cert_compressor.h",
     "quic/core/crypto/certificate_util.h",
     "quic/core/crypto/certificate_view.h",
@@ -165,6 +168,7 @@ quiche_core_hdrs = [
     "quic/core/crypto/chacha_base_decrypter.h",
     "quic/core/crypto/chacha_base_encrypter.h",
     "quic/core/crypto/channel_id.h",
+    "quic/core/crypto/cipher_suite_policy.h",
     "quic/core/crypto/client_proof_source.h",
     "quic/core/crypto/crypto_framer.h",
     "quic/core/crypto/crypto_handshake.h",
@@ -174,6 +178,7 @@ quiche_core_hdrs = [
     "quic/core/crypto/crypto_secret_boxer.h",
     "quic/core/crypto/crypto_utils.h",
     "quic/core/crypto/curve25519_key_exchange.h",
+    "quic/core/crypto/ephemeral_key_exchange_pool.h",
     "quic/core/crypto/key_exchange.h",
     "quic/core/crypto/null_decrypter.h",
     "quic/core/crypto/null_encrypter.h",
@@ -191,6 +196,7 @@ quiche_core_hdrs = [
     "quic/core/crypto/quic_encrypter.h",
     "quic/core/crypto/quic_hkdf.h",
     "quic/core/crypto/quic_random.h",
+    "quic/core/crypto/tls_cert_compression.h",
     "quic/core/crypto/tls_client_connection.h",
     "quic/core/crypto/tls_connection.h",
     "quic/core/crypto/tls_server_connection.h",
@@ -259,6 +265,7 @@ quiche_core_hdrs = [
     "quic/core/qpack/qpack_encoder.h",
     "quic/core/qpack/qpack_encoder_stream_receiver.h",
     "quic/core/qpack/qpack_encoder_stream_sender.h",
+    "quic/core/qpack/qpack_encoding_strategy.h",
     "quic/core/qpack/qpack_header_table.h",
     "quic/core/qpack/qpack_index_conversions.h",
     "quic/core/qpack/qpack_instruction_decoder.h",
@@ -306,6 +313,8 @@ quiche_core_hdrs = [
     "quic/core/quic_flags_list.h",
     "quic/core/quic_flow_controller.h",
     "quic/core/quic_framer.h",
+    "quic/core/quic_hot_path_profiler.h",
+    "quic/core/quic_http3_write_blocked_list.h",
     "quic/core/quic_idle_network_detector.h",
     "quic/core/quic_interval.h",
     "quic/core/quic_interval_deque.h",
@@ -416,6 +425,7 @@ quiche_core_srcs = [
     "common/masque/connect_udp_datagram_payload.cc",
     "common/platform/api/quiche_hostname_utils.cc",
     "common/platform/api/quiche_mutex.cc",
+    "common/pooled_buffer_allocator.cc",
     "common/quiche_buffer_allocator.cc",
     "common/quiche_crypto_logging.cc",
     "common/quiche_data_reader.cc",
@@ -487,6 +497,7 @@ quiche_core_srcs = [
     "quic/core/congestion_control/bbr2_probe_rtt.cc",
     "quic/core/congestion_control/bbr2_sender.cc",
     "quic/core/congestion_control/bbr2_startup.cc",
+    "quic/core/congestion_control/bbr2_subnet_bandwidth_cache.cc",
     "quic/core/congestion_control/bbr_sender.cc",
     "quic/core/congestion_control/cubic_bytes.cc",
     "quic/core/congestion_control/general_loss_algorithm.cc",
@@ -507,6 +518,7 @@ quiche_core_srcs = [
     "quic/core/crypto/aes_256_gcm_encrypter.cc",
     "quic/core/crypto/aes_base_decrypter.cc",
     "quic/core/crypto/aes_base_encrypter.cc",
+    "quic/core/crypto/caching_proof_verifier.cc",
     "quic/core/crypto/cert_compressor.cc",
     "quic/core/crypto/certificate_util.cc",
     "quic/core/crypto/certificate_view.cc",
@@ -517,6 +529,7 @@ quiche_core_srcs = [
     "quic/core/crypto/chacha_base_decrypter.cc",
     "quic/core/crypto/chacha_base_encrypter.cc",
     "quic/core/crypto/channel_id.cc",
+    "quic/core/crypto/cipher_suite_policy.cc",
     "quic/core/crypto/client_proof_source.cc",
     "quic/core/crypto/crypto_framer.cc",
     "quic/core/crypto/crypto_handshake.cc",
@@ -524,6 +537,7 @@ quiche_core_srcs = [
     "quic/core/crypto/crypto_secret_boxer.cc",
     "quic/core/crypto/crypto_utils.cc",
     "quic/core/crypto/curve25519_key_exchange.cc",
+    "quic/core/crypto/ephemeral_key_exchange_pool.cc",
     "quic/core/crypto/key_exchange.cc",
     "quic/core/crypto/null_decrypter.cc",
     "quic/core/crypto/null_encrypter.cc",
@@ -539,6 +553,7 @@ quiche_core_srcs = [
     "quic/core/crypto/quic_decrypter.cc",
     "quic/core/crypto/quic_encrypter.cc",
     "quic/core/crypto/quic_hkdf.cc",
+    "quic/core/crypto/tls_cert_compression.cc",
     "quic/core/crypto/tls_client_connection.cc",
     "quic/core/crypto/tls_connection.cc",
     "quic/core/crypto/tls_server_connection.cc",
@@ -599,6 +614,7 @@ quiche_core_srcs = [
     "quic/core/qpack/qpack_encoder.cc",
     "quic/core/qpack/qpack_encoder_stream_receiver.cc",
     "quic/core/qpack/qpack_encoder_stream_sender.cc",
+    "quic/core/qpack/qpack_encoding_strategy.cc",
     "quic/core/qpack/qpack_header_table.cc",
     "quic/core/qpack/qpack_index_conversions.cc",
     "quic/core/qpack/qpack_instruction_decoder.cc",
@@ -638,6 +654,8 @@ quiche_core_srcs = [
     "quic/core/quic_error_codes.cc",
     "quic/core/quic_flow_controller.cc",
     "quic/core/quic_framer.cc",
+    "quic/core/quic_hot_path_profiler.cc",
+    "quic/core/quic_http3_write_blocked_list.cc",
     "quic/core/quic_idle_network_detector.cc",
     "quic/core/quic_mtu_discovery.cc",
     "quic/core/quic_network_blackhole_detector.cc",
@@ -709,8 +727,12 @@ quiche_tool_support_hdrs = [
     "quic/tools/connect_tunnel.h",
     "quic/tools/connect_udp_tunnel.h",
     "quic/tools/fake_proof_verifier.h",
+    "quic/tools/file_backed_client_session_cache.h",
     "quic/tools/quic_backend_response.h",
     "quic/tools/quic_client_base.h",
+    "quic/tools/quic_file_backed_cache_backend.h",
+    "quic/tools/quic_latency_histogram.h",
+    "quic/tools/quic_load_balancer_routing_table.h",
     "quic/tools/quic_memory_cache_backend.h",
     "quic/tools/quic_name_lookup.h",
     "quic/tools/quic_simple_client_session.h",
@@ -724,6 +746,8 @@ quiche_tool_support_hdrs = [
     "quic/tools/quic_spdy_server_base.h",
     "quic/tools/quic_tcp_like_trace_converter.h",
     "quic/tools/quic_url.h",
+    "quic/tools/shared_anti_replay_cache.h",
+    "quic/tools/shared_ticket_crypter.h",
     "quic/tools/simple_ticket_crypter.h",
     "quic/tools/web_transport_test_visitors.h",
 ]
@@ -732,8 +756,12 @@ quiche_tool_support_srcs = [
     "quic/tools/connect_server_backend.cc",
     "quic/tools/connect_tunnel.cc",
     "quic/tools/connect_udp_tunnel.cc",
+    "quic/tools/file_backed_client_session_cache.cc",
     "quic/tools/quic_backend_response.cc",
     "quic/tools/quic_client_base.cc",
+    "quic/tools/quic_file_backed_cache_backend.cc",
+    "quic/tools/quic_latency_histogram.cc",
+    "quic/tools/quic_load_balancer_routing_table.cc",
     "quic/tools/quic_memory_cache_backend.cc",
     "quic/tools/quic_name_lookup.cc",
     "quic/tools/quic_simple_client_session.cc",
@@ -745,6 +773,8 @@ quiche_tool_support_srcs = [
     "quic/tools/quic_spdy_client_base.cc",
     "quic/tools/quic_tcp_like_trace_converter.cc",
     "quic/tools/quic_url.cc",
+    "quic/tools/shared_anti_replay_cache.cc",
+    "quic/tools/shared_ticket_crypter.cc",
     "quic/tools/simple_ticket_crypter.cc",
 ]
 quiche_test_support_hdrs = [
@@ -801,6 +831,7 @@ quiche_test_support_hdrs = [
     "quic/test_tools/qpack/qpack_encoder_peer.h",
     "quic/test_tools/qpack/qpack_offline_decoder.h",
     "quic/test_tools/qpack/qpack_test_utils.h",
+    "quic/test_tools/quic_benchmark_utils.h",
     "quic/test_tools/quic_buffered_packet_store_peer.h",
     "quic/test_tools/quic_client_promised_info_peer.h",
     "quic/test_tools/quic_client_session_cache_peer.h",
@@ -840,6 +871,7 @@ quiche_test_support_hdrs = [
     "quic/test_tools/simulator/alarm_factory.h",
     "quic/test_tools/simulator/link.h",
     "quic/test_tools/simulator/packet_filter.h",
+    "quic/test_tools/simulator/packet_reorderer.h",
     "quic/test_tools/simulator/port.h",
     "quic/test_tools/simulator/queue.h",
     "quic/test_tools/simulator/quic_endpoint.h",
@@ -900,6 +932,7 @@ quiche_test_support_srcs = [
     "quic/test_tools/qpack/qpack_encoder_peer.cc",
     "quic/test_tools/qpack/qpack_offline_decoder.cc",
     "quic/test_tools/qpack/qpack_test_utils.cc",
+    "quic/test_tools/quic_benchmark_utils.cc",
     "quic/test_tools/quic_buffered_packet_store_peer.cc",
     "quic/test_tools/quic_client_promised_info_peer.cc",
     "quic/test_tools/quic_coalesced_packet_peer.cc",
@@ -935,6 +968,7 @@ quiche_test_support_srcs = [
     "quic/test_tools/simulator/alarm_factory.cc",
     "quic/test_tools/simulator/link.cc",
     "quic/test_tools/simulator/packet_filter.cc",
+    "quic/test_tools/simulator/packet_reorderer.cc",
     "quic/test_tools/simulator/port.cc",
     "quic/test_tools/simulator/queue.cc",
     "quic/test_tools/simulator/quic_endpoint.cc",
@@ -978,6 +1012,7 @@ io_tool_support_hdrs = [
     "quic/tools/quic_client_factory.h",
     "quic/tools/quic_default_client.h",
     "quic/tools/quic_epoll_client_factory.h",
+    "quic/tools/quic_load_generator.h",
     "quic/tools/quic_server.h",
 ]
 io_tool_support_srcs = [
@@ -1007,6 +1042,7 @@ io_tool_support_srcs = [
     "quic/tools/quic_client_default_network_helper.cc",
     "quic/tools/quic_default_client.cc",
     "quic/tools/quic_epoll_client_factory.cc",
+    "quic/tools/quic_load_generator.cc",
     "quic/tools/quic_server.cc",
 ]
 io_test_support_hdrs = [
@@ -1044,6 +1080,7 @@ quiche_tests_srcs = [
     "common/platform/api/quiche_stack_trace_test.cc",
     "common/platform/api/quiche_time_utils_test.cc",
     "common/platform/api/quiche_url_utils_test.cc",
+    "common/pooled_buffer_allocator_test.cc",
     "common/print_elements_test.cc",
     "common/quiche_buffer_allocator_test.cc",
     "common/quiche_circular_deque_test.cc",
@@ -1120,12 +1157,14 @@ quiche_tests_srcs = [
     "oblivious_http/oblivious_http_gateway_test.cc",
     "quic/core/congestion_control/bandwidth_sampler_test.cc",
     "quic/core/congestion_control/bbr2_simulator_test.cc",
+    "quic/core/congestion_control/bbr2_subnet_bandwidth_cache_test.cc",
     "quic/core/congestion_control/bbr_sender_test.cc",
     "quic/core/congestion_control/cubic_bytes_test.cc",
     "quic/core/congestion_control/general_loss_algorithm_test.cc",
     "quic/core/congestion_control/hybrid_slow_start_test.cc",
     "quic/core/congestion_control/pacing_sender_test.cc",
     "quic/core/congestion_control/prr_sender_test.cc",
+    "quic/core/congestion_control/rack_loss_detection_test.cc",
     "quic/core/congestion_control/rtt_stats_test.cc",
     "quic/core/congestion_control/send_algorithm_test.cc",
     "quic/core/congestion_control/tcp_cubic_sender_bytes_test.cc",
@@ -1137,6 +1176,7 @@ quiche_tests_srcs = [
     "quic/core/crypto/aes_128_gcm_encrypter_test.cc",
     "quic/core/crypto/aes_256_gcm_decrypter_test.cc",
     "quic/core/crypto/aes_256_gcm_encrypter_test.cc",
+    "quic/core/crypto/caching_proof_verifier_test.cc",
     "quic/core/crypto/cert_compressor_test.cc",
     "quic/core/crypto/certificate_util_test.cc",
     "quic/core/crypto/certificate_view_test.cc",
@@ -1145,6 +1185,7 @@ quiche_tests_srcs = [
     "quic/core/crypto/chacha20_poly1305_tls_decrypter_test.cc",
     "quic/core/crypto/chacha20_poly1305_tls_encrypter_test.cc",
     "quic/core/crypto/channel_id_test.cc",
+    "quic/core/crypto/cipher_suite_policy_test.cc",
     "quic/core/crypto/client_proof_source_test.cc",
     "quic/core/crypto/crypto_framer_test.cc",
     "quic/core/crypto/crypto_handshake_message_test.cc",
@@ -1152,6 +1193,7 @@ quiche_tests_srcs = [
     "quic/core/crypto/crypto_server_test.cc",
     "quic/core/crypto/crypto_utils_test.cc",
     "quic/core/crypto/curve25519_key_exchange_test.cc",
+    "quic/core/crypto/ephemeral_key_exchange_pool_test.cc",
     "quic/core/crypto/null_decrypter_test.cc",
     "quic/core/crypto/null_encrypter_test.cc",
     "quic/core/crypto/p256_key_exchange_test.cc",
@@ -1161,6 +1203,7 @@ quiche_tests_srcs = [
     "quic/core/crypto/quic_crypto_client_config_test.cc",
     "quic/core/crypto/quic_crypto_server_config_test.cc",
     "quic/core/crypto/quic_hkdf_test.cc",
+    "quic/core/crypto/tls_cert_compression_test.cc",
     "quic/core/crypto/transport_parameters_test.cc",
     "quic/core/crypto/web_transport_fingerprint_proof_verifier_test.cc",
     "quic/core/deterministic_connection_id_generator_test.cc",
@@ -1191,6 +1234,7 @@ quiche_tests_srcs = [
     "quic/core/qpack/qpack_encoder_stream_receiver_test.cc",
     "quic/core/qpack/qpack_encoder_stream_sender_test.cc",
     "quic/core/qpack/qpack_encoder_test.cc",
+    "quic/core/qpack/qpack_encoding_strategy_test.cc",
     "quic/core/qpack/qpack_header_table_test.cc",
     "quic/core/qpack/qpack_index_conversions_test.cc",
     "quic/core/qpack/qpack_instruction_decoder_test.cc",
@@ -1223,6 +1267,8 @@ quiche_tests_srcs = [
     "quic/core/quic_error_codes_test.cc",
     "quic/core/quic_flow_controller_test.cc",
     "quic/core/quic_framer_test.cc",
+    "quic/core/quic_hot_path_profiler_test.cc",
+    "quic/core/quic_http3_write_blocked_list_test.cc",
     "quic/core/quic_idle_network_detector_test.cc",
     "quic/core/quic_interval_deque_test.cc",
     "quic/core/quic_interval_set_test.cc",
@@ -1270,8 +1316,14 @@ quiche_tests_srcs = [
     "quic/test_tools/simulator/simulator_test.cc",
     "quic/tools/connect_tunnel_test.cc",
     "quic/tools/connect_udp_tunnel_test.cc",
+    "quic/tools/file_backed_client_session_cache_test.cc",
+    "quic/tools/quic_file_backed_cache_backend_test.cc",
+    "quic/tools/quic_latency_histogram_test.cc",
+    "quic/tools/quic_load_balancer_routing_table_test.cc",
     "quic/tools/quic_memory_cache_backend_test.cc",
     "quic/tools/quic_tcp_like_trace_converter_test.cc",
+    "quic/tools/shared_anti_replay_cache_test.cc",
+    "quic/tools/shared_ticket_crypter_test.cc",
     "quic/tools/simple_ticket_crypter_test.cc",
     "spdy/core/array_output_buffer_test.cc",
     "spdy/core/hpack/hpack_decoder_adapter_test.cc",
@@ -1307,6 +1359,7 @@ io_tests_srcs = [
     "quic/core/io/quic_poll_event_loop_test.cc",
     "quic/core/io/socket_test.cc",
     "quic/tools/quic_default_client_test.cc",
+    "quic/tools/quic_load_generator_test.cc",
     "quic/tools/quic_server_test.cc",
     "quic/tools/quic_simple_server_session_test.cc",
     "quic/tools/quic_simple_server_stream_test.cc",
@@ -1337,13 +1390,20 @@ cli_tools_srcs = [
     "quic/masque/masque_client_bin.cc",
     "quic/masque/masque_server_bin.cc",
     "quic/tools/crypto_message_printer_bin.cc",
+    "quic/tools/qpack_encoder_benchmark_bin.cc",
     "quic/tools/qpack_offline_decoder_bin.cc",
+    "quic/tools/quic_benchmark_bin.cc",
     "quic/tools/quic_client_bin.cc",
     "quic/tools/quic_client_interop_test_bin.cc",
+    "quic/tools/quic_crypto_benchmark_bin.cc",
+    "quic/tools/quic_load_balancer_benchmark_bin.cc",
+    "quic/tools/quic_load_balancer_router_bin.cc",
+    "quic/tools/quic_load_generator_bin.cc",
     "quic/tools/quic_packet_printer_bin.cc",
     "quic/tools/quic_reject_reason_decoder_bin.cc",
     "quic/tools/quic_server_bin.cc",
     "quic/tools/quic_server_factory.cc",
+    "quic/tools/quic_simulator_benchmark_bin.cc",
     "quic/tools/quic_toy_client.cc",
     "quic/tools/quic_toy_server.cc",
 ]
@@ -1626,6 +1686,7 @@ linux_only_hdrs = [
     "quic/core/batch_writer/quic_gso_batch_writer.h",
     "quic/core/batch_writer/quic_sendmmsg_batch_writer.h",
     "quic/core/quic_linux_socket_utils.h",
+    "quic/tools/quic_load_balancer_router.h",
 ]
 linux_only_srcs = [
     "quic/core/batch_writer/quic_batch_writer_base.cc",
@@ -1633,6 +1694,7 @@ linux_only_srcs = [
     "quic/core/batch_writer/quic_gso_batch_writer.cc",
     "quic/core/batch_writer/quic_sendmmsg_batch_writer.cc",
     "quic/core/quic_linux_socket_utils.cc",
+    "quic/tools/quic_load_balancer_router.cc",
 ]
 linux_only_tests_hdrs = [
 
@@ -1643,4 +1705,5 @@ linux_only_tests_srcs = [
     "quic/core/batch_writer/quic_gso_batch_writer_test.cc",
     "quic/core/batch_writer/quic_sendmmsg_batch_writer_test.cc",
     "quic/core/quic_linux_socket_utils_test.cc",
+    "quic/tools/quic_load_balancer_router_test.cc",
 ]
@@ -0,0 +1,77 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/common/pooled_buffer_allocator.h"
+
+#include <new>
+
+namespace quiche {
+
+PooledBufferAllocator::PooledBufferAllocator(size_t max_buffer_size,
+                                             size_t max_free_buffers)
+    : max_free_buffers_(max_free_buffers) {
+  for (size_t size = kMinBufferSize; size <= max_buffer_size; size *= 2) {
+    free_buffers_.emplace_back();
+  }
+}
+
+PooledBufferAllocator::~PooledBufferAllocator() { MarkAllocatorIdle(); }
+
+char* PooledBufferAllocator::New(size_t size) {
+  size_t size_class = 0;
+  while (size_class < free_buffers_.size() &&
+         (kMinBufferSize << size_class) < size) {
+    ++size_class;
+  }
+  Header* header;
+  if (size_class == free_buffers_.size()) {
+    size_class = kUnpooled;
+    header = static_cast<Header*>(::operator new(sizeof(Header) + size));
+  } else if (!free_buffers_[size_class].empty()) {
+    header = free_buffers_[size_class].back();
+    free_buffers_[size_class].pop_back();
+    ++num_reused_;
+  } else {
+    header = static_cast<Header*>(
+        ::operator new(sizeof(Header) + (kMinBufferSize << size_class)));
+  }
+  header->size_class = size_class;
+  return reinterpret_cast<char*>(header + 1);
+}
+
+char* PooledBufferAllocator::New(size_t size, bool /*flag_enable*/) {
+  return New(size);
+}
+
+void PooledBufferAllocator::Delete(char* buffer) {
+  if (buffer == nullptr) {
+    return;
+  }
+  Header* header = reinterpret_cast<Header*>(buffer) - 1;
+  if (header->size_class == kUnpooled ||
+      free_buffers_[header->size_class].size() >= max_free_buffers_) {
+    ::operator delete(header);
+    return;
+  }
+  free_buffers_[header->size_class].push_back(header);
+}
+
+void PooledBufferAllocator::MarkAllocatorIdle() {
+  for (std::vector<Header*>& free_buffers : free_buffers_) {
+    for (Header* header : free_buffers) {
+      ::operator delete(header);
+    }
+    free_buffers.clear();
+  }
+}
+
+size_t PooledBufferAllocator::num_free_buffers() const {
+  size_t num_free_buffers = 0;
+  for (const std::vector<Header*>& free_buffers : free_buffers_) {
+    num_free_buffers += free_buffers.size();
+  }
+  return num_free_buffers;
+}
+
+}  // namespace quiche
@@ -0,0 +1,62 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_COMMON_POOLED_BUFFER_ALLOCATOR_H_
+#define QUICHE_COMMON_POOLED_BUFFER_ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "quiche/common/platform/api/quiche_export.h"
+#include "quiche/common/quiche_buffer_allocator.h"
+
+namespace quiche {
+
+// Keeps the buffers it frees for reuse, so that a steady flow of short-lived
+// buffers, such as the payloads of datagrams, does not go to the heap every
+// time.  Sizes are rounded up to a power of two of at least kMinBufferSize
+// bytes, and each size keeps up to |max_free_buffers| free buffers.  Buffers
+// larger than |max_buffer_size| are not pooled.  Not thread-safe, and must
+// outlive the buffers it allocates.
+class QUICHE_EXPORT PooledBufferAllocator : public QuicheBufferAllocator {
+ public:
+  static constexpr size_t kMinBufferSize = 64;
+
+  PooledBufferAllocator() : PooledBufferAllocator(16 * 1024, 128) {}
+  PooledBufferAllocator(size_t max_buffer_size, size_t max_free_buffers);
+  PooledBufferAllocator(const PooledBufferAllocator&) = delete;
+  PooledBufferAllocator& operator=(const PooledBufferAllocator&) = delete;
+  ~PooledBufferAllocator() override;
+
+  // QuicheBufferAllocator implementation.
+  char* New(size_t size) override;
+  char* New(size_t size, bool flag_enable) override;
+  void Delete(char* buffer) override;
+  // Releases the free buffers.
+  void MarkAllocatorIdle() override;
+
+  // Number of free buffers kept for reuse.
+  size_t num_free_buffers() const;
+  // Number of allocations served from a free buffer.
+  uint64_t num_reused() const { return num_reused_; }
+
+ private:
+  // Precedes every buffer, aligned so that the buffer is too.
+  struct alignas(std::max_align_t) Header {
+    // Index into |free_buffers_|, or kUnpooled.
+    size_t size_class;
+  };
+  static constexpr size_t kUnpooled = SIZE_MAX;
+
+  const size_t max_free_buffers_;
+  // Free buffers of kMinBufferSize << i bytes at index i, pointing at their
+  // headers.
+  std::vector<std::vector<Header*>> free_buffers_;
+  uint64_t num_reused_ = 0;
+};
+
+}  // namespace quiche
+
+#endif  // QUICHE_COMMON_POOLED_BUFFER_ALLOCATOR_H_
@@ -0,0 +1,71 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/common/pooled_buffer_allocator.h"
+
+#include <cstring>
+
+#include "quiche/common/platform/api/quiche_test.h"
+
+namespace quiche {
+namespace {
+
+TEST(PooledBufferAllocatorTest, ReusesFreedBuffers) {
+  PooledBufferAllocator alloc;
+  char* buf = alloc.New(100);
+  ASSERT_NE(nullptr, buf);
+  memset(buf, 'a', 100);
+  alloc.Delete(buf);
+  EXPECT_EQ(1u, alloc.num_free_buffers());
+  // Rounded up to the same size.
+  EXPECT_EQ(buf, alloc.New(128));
+  EXPECT_EQ(1u, alloc.num_reused());
+  EXPECT_EQ(0u, alloc.num_free_buffers());
+  // Too large for that buffer.
+  char* larger = alloc.New(129);
+  EXPECT_NE(buf, larger);
+  alloc.Delete(buf);
+  alloc.Delete(larger);
+  EXPECT_EQ(2u, alloc.num_free_buffers());
+}
+
+TEST(PooledBufferAllocatorTest, LargeBuffersAreNotPooled) {
+  PooledBufferAllocator alloc(/*max_buffer_size=*/1024,
+                              /*max_free_buffers=*/4);
+  char* buf = alloc.New(2000);
+  ASSERT_NE(nullptr, buf);
+  memset(buf, 'a', 2000);
+  alloc.Delete(buf);
+  EXPECT_EQ(0u, alloc.num_free_buffers());
+}
+
+TEST(PooledBufferAllocatorTest, KeepsAtMostMaxFreeBuffers) {
+  PooledBufferAllocator alloc(/*max_buffer_size=*/1024,
+                              /*max_free_buffers=*/2);
+  char* bufs[3] = {alloc.New(10), alloc.New(20), alloc.New(30)};
+  for (char* buf : bufs) {
+    alloc.Delete(buf);
+  }
+  EXPECT_EQ(2u, alloc.num_free_buffers());
+  alloc.MarkAllocatorIdle();
+  EXPECT_EQ(0u, alloc.num_free_buffers());
+}
+
+TEST(PooledBufferAllocatorTest, DeleteNull) {
+  PooledBufferAllocator alloc;
+  alloc.Delete(nullptr);
+}
+
+TEST(PooledBufferAllocatorTest, QuicheBuffer) {
+  PooledBufferAllocator alloc;
+  const absl::string_view original = "Test string";
+  {
+    QuicheBuffer copy = QuicheBuffer::Copy(&alloc, original);
+    EXPECT_EQ(copy.AsStringView(), original);
+  }
+  EXPECT_EQ(1u, alloc.num_free_buffers());
+}
+
+}  // namespace
+}  // namespace quiche
@@ -5,8 +5,11 @@
 #include "quiche/http2/hpack/huffman/hpack_huffman_decoder.h"
 
 #include <bitset>
+#include <cstring>
 #include <limits>
+#include <vector>
 
+#include "quiche/http2/hpack/huffman/huffman_spec_tables.h"
 #include "quiche/common/platform/api/quiche_logging.h"
 
 // Terminology:
@@ -343,6 +346,74 @@ struct ShortCodeInfo {
     {0x7a, 7},  // Match: 0b1111011, Symbol: z
 };
 
+// The number of leading bits of the bit buffer that are decoded with a single
+// lookup in MultiSymbolTable(). Codes are at least 5 bits long, so a lookup
+// decodes at most two symbols.
+constexpr HuffmanAccumulatorBitCount kMultiSymbolBitCount = 12;
+constexpr size_t kMultiSymbolTableSize = 1 << kMultiSymbolBitCount;
+
+// The whole codes at the start of a kMultiSymbolBitCount bit prefix.
+// |symbol_count| is zero if the prefix does not start with a whole code, and
+// |bit_count| is the total length of the decoded codes.
+struct MultiSymbolEntry {
+  char symbols[2];
+  uint8_t symbol_count;
+  uint8_t bit_count;
+};
+
+const MultiSymbolEntry* BuildMultiSymbolTable() {
+  // The symbol of the code at the start of each prefix, and the length of that
+  // code, or zero if the code is longer than the prefix.
+  struct FirstCode {
+    uint8_t symbol = 0;
+    uint8_t length = 0;
+  };
+  std::vector<FirstCode> first_codes(kMultiSymbolTableSize);
+  for (int symbol = 0; symbol < 256; ++symbol) {
+    const uint8_t length = HuffmanSpecTables::kCodeLengths[symbol];
+    if (length > kMultiSymbolBitCount) {
+      continue;
+    }
+    const HuffmanCode code = HuffmanSpecTables::kLeftCodes[symbol] >>
+                             (kHuffmanCodeBitCount - kMultiSymbolBitCount);
+    for (HuffmanCode suffix = 0;
+         suffix < (HuffmanCode{1} << (kMultiSymbolBitCount - length));
+         ++suffix) {
+      first_codes[code | suffix] = {static_cast<uint8_t>(symbol), length};
+    }
+  }
+
+  auto* table = new MultiSymbolEntry[kMultiSymbolTableSize]();
+  for (size_t prefix = 0; prefix < kMultiSymbolTableSize; ++prefix) {
+    const FirstCode& first = first_codes[prefix];
+    if (first.length == 0) {
+      continue;
+    }
+    MultiSymbolEntry& entry = table[prefix];
+    entry.symbols[0] = static_cast<char>(first.symbol);
+    entry.symbol_count = 1;
+    entry.bit_count = first.length;
+    // The bits after the first code, padded with zeros. A code that fits in
+    // the remaining bits is decoded correctly despite the padding.
+    const FirstCode& second =
+        first_codes[(prefix << first.length) & (kMultiSymbolTableSize - 1)];
+    if (second.length != 0 &&
+        first.length + second.length <= kMultiSymbolBitCount) {
+      entry.symbols[1] = static_cast<char>(second.symbol);
+      entry.symbol_count = 2;
+      entry.bit_count += second.length;
+    }
+  }
+  return table;
+}
+
+// Returns a table of kMultiSymbolTableSize entries, indexed by the leading
+// kMultiSymbolBitCount bits of an encoded string.
+const MultiSymbolEntry* MultiSymbolTable() {
+  static const MultiSymbolEntry* const table = BuildMultiSymbolTable();
+  return table;
+}
+
 }  // namespace
 
 HuffmanBitBuffer::HuffmanBitBuffer() { Reset(); }
@@ -413,11 +484,44 @@ HpackHuffmanDecoder::~HpackHuffmanDecoder() = default;
 bool HpackHuffmanDecoder::Decode(absl::string_view input, std::string* output) {
   QUICHE_DVLOG(1) << "HpackHuffmanDecoder::Decode";
 
+  // Every code is at least kMinCodeBitCount bits long, which bounds the number
+  // of symbols that can be decoded. Grow |output| up front so that symbols are
+  // stored without checking its capacity, with one more byte because a
+  // MultiSymbolEntry always stores two symbols. Shrink it before returning.
+  const size_t output_offset = output->size();
+  output->resize(output_offset +
+                 (bit_buffer_.count() + 8 * input.size()) / kMinCodeBitCount +
+                 1);
+  char* out = &(*output)[output_offset];
+  auto finish = [output, &out](bool result) {
+    output->resize(out - output->data());
+    return result;
+  };
+
   // Fill bit_buffer_ from input.
   input.remove_prefix(bit_buffer_.AppendBytes(input));
 
+  const MultiSymbolEntry* const multi_symbol_table = MultiSymbolTable();
   while (true) {
     QUICHE_DVLOG(3) << "Enter Decode Loop, bit_buffer_: " << bit_buffer_;
+    if (bit_buffer_.count() < kMultiSymbolBitCount && !input.empty()) {
+      input.remove_prefix(bit_buffer_.AppendBytes(input));
+    }
+    if (bit_buffer_.count() >= kMultiSymbolBitCount) {
+      // Decode one or two symbols with a single lookup, which covers the codes
+      // of all common characters.
+      const MultiSymbolEntry& entry =
+          multi_symbol_table[bit_buffer_.value() >>
+                             (kHuffmanAccumulatorBitCount -
+                              kMultiSymbolBitCount)];
+      if (entry.symbol_count > 0) {
+        memcpy(out, entry.symbols, sizeof(entry.symbols));
+        out += entry.symbol_count;
+        bit_buffer_.ConsumeBits(entry.bit_count);
+        continue;
+      }
+      // The code is more than kMultiSymbolBitCount bits long.
+    }
     if (bit_buffer_.count() >= 7) {
       // Get high 7 bits of the bit buffer, see if that contains a complete
       // code of 5, 6 or 7 bits.
@@ -427,7 +531,7 @@ bool HpackHuffmanDecoder::Decode(absl::string_view input, std::string* output) {
       if (short_code < kShortCodeTableSize) {
         ShortCodeInfo info = kShortCodeTable[short_code];
         bit_buffer_.ConsumeBits(info.length);
-        output->push_back(static_cast<char>(info.symbol));
+        *out++ = static_cast<char>(info.symbol);
         continue;
       }
       // The code is more than 7 bits long. Use PrefixToInfo, etc. to decode
@@ -455,22 +559,21 @@ bool HpackHuffmanDecoder::Decode(absl::string_view input, std::string* output) {
       uint32_t canonical = prefix_info.DecodeToCanonical(code_prefix);
       if (canonical < 256) {
         // Valid code.
-        char c = kCanonicalToSymbol[canonical];
-        output->push_back(c);
+        *out++ = kCanonicalToSymbol[canonical];
         bit_buffer_.ConsumeBits(prefix_info.code_length);
         continue;
       }
       // Encoder is not supposed to explicity encode the EOS symbol.
       QUICHE_DLOG(ERROR) << "EOS explicitly encoded!\n " << bit_buffer_ << "\n "
                          << prefix_info;
-      return false;
+      return finish(false);
     }
     // bit_buffer_ doesn't have enough bits in it to decode the next symbol.
     // Append to it as many bytes as are available AND fit.
     size_t byte_count = bit_buffer_.AppendBytes(input);
     if (byte_count == 0) {
       QUICHE_DCHECK_EQ(input.size(), 0u);
-      return true;
+      return finish(true);
     }
     input.remove_prefix(byte_count);
   }
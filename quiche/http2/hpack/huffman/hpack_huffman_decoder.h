@@ -10,7 +10,9 @@
 // By incremental, we mean that the HpackHuffmanDecoder::Decode method does
 // not require the entire string to be provided, and can instead decode the
 // string as fragments of it become available (e.g. as HPACK block fragments
-// are received for decoding by HpackEntryDecoder).
+// are received for decoding by HpackEntryDecoder). It is used by both the HPACK
+// and the QPACK decoders. Common characters, whose codes are short, are decoded
+// up to two at a time with a single table lookup.
 
 #include <stddef.h>
 
@@ -237,6 +237,31 @@ TEST_F(HpackHuffmanDecoderTest, SpecResponseExamples) {
   }
 }
 
+// Decode() appends to the output, and does not leave unused space at its end.
+TEST_F(HpackHuffmanDecoderTest, AppendsToOutput) {
+  HpackHuffmanDecoder decoder;
+  const std::string huffman_encoded =
+      absl::HexStringToBytes("f1e3c2e5f23a6ba0ab90f4ff");
+  std::string buffer = "prefix:";
+  decoder.Reset();
+  EXPECT_TRUE(decoder.Decode(huffman_encoded.substr(0, 5), &buffer)) << decoder;
+  EXPECT_TRUE(decoder.Decode(huffman_encoded.substr(5), &buffer)) << decoder;
+  EXPECT_TRUE(decoder.InputProperlyTerminated()) << decoder;
+  EXPECT_EQ(buffer, "prefix:www.example.com");
+}
+
+// Decoding the EOS symbol fails, and leaves only the symbols before it in the
+// output.
+TEST_F(HpackHuffmanDecoderTest, ExplicitEosFails) {
+  HpackHuffmanDecoder decoder;
+  // "a" (00011), followed by EOS (30 one bits) and padding.
+  const std::string huffman_encoded = absl::HexStringToBytes("1fffffffff");
+  std::string buffer;
+  decoder.Reset();
+  EXPECT_FALSE(decoder.Decode(huffman_encoded, &buffer)) << decoder;
+  EXPECT_EQ(buffer, "a");
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace http2
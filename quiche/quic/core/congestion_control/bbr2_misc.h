@@ -184,6 +184,12 @@ struct QUIC_EXPORT_PRIVATE Bbr2Params {
 
   Limits<QuicByteCount> cwnd_limits;
 
+  // Bytes the peer may receive before acking them, i.e. its ack packet
+  // tolerance in bytes. When sparse acks were negotiated, the congestion window
+  // leaves room for that much data on top of the BDP until the max ack height
+  // filter has learned about the ack aggregation.
+  QuicByteCount peer_ack_tolerance_bytes = 0;
+
   /*
    * Experimental flags from QuicConfig.
    */
@@ -111,6 +111,11 @@ void Bbr2Sender::SetFromConfig(const QuicConfig& config,
   if (config.HasClientRequestedIndependentOption(kICW1, perspective)) {
     max_cwnd_when_network_parameters_adjusted_ = 100 * kDefaultTCPMSS;
   }
+  if (config.HasClientSentConnectionOption(kAKDB, perspective) ||
+      config.HasClientSentConnectionOption(kAFF3, perspective)) {
+    params_.peer_ack_tolerance_bytes =
+        kMaxAckThinningPacketTolerance * kDefaultTCPMSS;
+  }
 
   ApplyConnectionOptions(config.ClientRequestedIndependentOptions(perspective));
 }
@@ -402,7 +407,12 @@ void Bbr2Sender::UpdateCongestionWindow(QuicByteCount bytes_acked) {
 
   const QuicByteCount prior_cwnd = cwnd_;
   if (model_.full_bandwidth_reached() || Params().startup_include_extra_acked) {
-    target_cwnd += model_.MaxAckHeight();
+    QuicByteCount extra_acked = model_.MaxAckHeight();
+    if (extra_acked == 0) {
+      // The max ack height filter is yet to learn the ack aggregation.
+      extra_acked = Params().peer_ack_tolerance_bytes;
+    }
+    target_cwnd += extra_acked;
     cwnd_ = std::min(prior_cwnd + bytes_acked, target_cwnd);
   } else if (prior_cwnd < target_cwnd || prior_cwnd < 2 * initial_cwnd_) {
     cwnd_ = prior_cwnd + bytes_acked;
@@ -0,0 +1,119 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/congestion_control/bbr2_subnet_bandwidth_cache.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "quiche/quic/core/congestion_control/bbr2_sender.h"
+#include "quiche/quic/platform/api/quic_flags.h"
+
+namespace quic {
+
+Bbr2SubnetBandwidthCache::Bbr2SubnetBandwidthCache(size_t max_entries,
+                                                   QuicTime::Delta max_age)
+    : max_age_(max_age), cache_(max_entries) {}
+
+// static
+Bbr2SubnetBandwidthCache* Bbr2SubnetBandwidthCache::GetProcessWideInstance() {
+  static Bbr2SubnetBandwidthCache* cache = []() {
+    const int64_t max_entries =
+        GetQuicFlag(quic_bbr2_subnet_bandwidth_cache_size);
+    if (max_entries <= 0) {
+      return static_cast<Bbr2SubnetBandwidthCache*>(nullptr);
+    }
+    return new Bbr2SubnetBandwidthCache(
+        max_entries,
+        QuicTime::Delta::FromSeconds(
+            GetQuicFlag(quic_bbr2_subnet_bandwidth_cache_max_age_seconds)));
+  }();
+  return cache;
+}
+
+// static
+std::string Bbr2SubnetBandwidthCache::SubnetKey(const QuicIpAddress& address) {
+  // Addresses are compared in packed form, so that an IPv4 and an IPv6 subnet
+  // never share a key: they have different lengths.
+  const QuicIpAddress normalized = address.Normalized();
+  const int prefix_length =
+      normalized.IsIPv4() ? kIpv4PrefixLength : kIpv6PrefixLength;
+  std::string key = normalized.ToPackedString();
+  key.resize(std::min<size_t>(key.size(), prefix_length / 8));
+  return key;
+}
+
+void Bbr2SubnetBandwidthCache::OnConnectionClosed(
+    const QuicIpAddress& peer_address,
+    const SendAlgorithmInterface& send_algorithm, QuicTime now) {
+  if (!peer_address.IsInitialized() ||
+      send_algorithm.GetCongestionControlType() != kBBRv2 ||
+      !send_algorithm.HasGoodBandwidthEstimateForResumption()) {
+    return;
+  }
+  const Bbr2NetworkModel& model =
+      static_cast<const Bbr2Sender&>(send_algorithm).GetNetworkModel();
+  Entry entry;
+  entry.bandwidth = model.MaxBandwidth();
+  entry.update_time = now;
+  if (entry.bandwidth.IsZero()) {
+    return;
+  }
+  Update(peer_address, entry);
+}
+
+absl::optional<SendAlgorithmInterface::NetworkParams>
+Bbr2SubnetBandwidthCache::GetNetworkParams(const QuicIpAddress& peer_address,
+                                           QuicTime now) {
+  absl::optional<Entry> entry = Lookup(peer_address, now);
+  if (!entry.has_value()) {
+    return absl::nullopt;
+  }
+  // Only the bandwidth is seeded. The min RTT of the entry was measured to a
+  // possibly different host of the subnet, and AdjustNetworkParameters would
+  // feed it into the min RTT filter of this connection, where a lower value
+  // stays until probe_rtt_period expires. With a zero RTT, the cwnd is sized
+  // from the min RTT of this connection instead.
+  return SendAlgorithmInterface::NetworkParams(
+      entry->bandwidth, QuicTime::Delta::Zero(),
+      /*allow_cwnd_to_decrease=*/false);
+}
+
+void Bbr2SubnetBandwidthCache::Update(const QuicIpAddress& peer_address,
+                                      const Entry& entry) {
+  std::string key = SubnetKey(peer_address);
+  QuicWriterMutexLock lock(&mutex_);
+  cache_.Insert(key, std::make_unique<Entry>(entry));
+}
+
+absl::optional<Bbr2SubnetBandwidthCache::Entry>
+Bbr2SubnetBandwidthCache::Lookup(const QuicIpAddress& peer_address,
+                                 QuicTime now) {
+  if (!peer_address.IsInitialized()) {
+    return absl::nullopt;
+  }
+  std::string key = SubnetKey(peer_address);
+  QuicWriterMutexLock lock(&mutex_);
+  auto it = cache_.Lookup(key);
+  if (it == cache_.end()) {
+    return absl::nullopt;
+  }
+  if (now - it->second->update_time > max_age_) {
+    cache_.Erase(it);
+    return absl::nullopt;
+  }
+  return *it->second;
+}
+
+size_t Bbr2SubnetBandwidthCache::Size() const {
+  QuicReaderMutexLock lock(&mutex_);
+  return cache_.Size();
+}
+
+void Bbr2SubnetBandwidthCache::Clear() {
+  QuicWriterMutexLock lock(&mutex_);
+  cache_.Clear();
+}
+
+}  // namespace quic
@@ -0,0 +1,86 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_CONGESTION_CONTROL_BBR2_SUBNET_BANDWIDTH_CACHE_H_
+#define QUICHE_QUIC_CORE_CONGESTION_CONTROL_BBR2_SUBNET_BANDWIDTH_CACHE_H_
+
+#include <cstddef>
+#include <string>
+
+#include "absl/types/optional.h"
+#include "quiche/quic/core/congestion_control/send_algorithm_interface.h"
+#include "quiche/quic/core/quic_bandwidth.h"
+#include "quiche/quic/core/quic_lru_cache.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/platform/api/quic_export.h"
+#include "quiche/quic/platform/api/quic_ip_address.h"
+#include "quiche/quic/platform/api/quic_mutex.h"
+
+namespace quic {
+
+// A server side cache of the path model learned by BBRv2, keyed by the
+// client's subnet. Many short connections from the same subnet arrive in
+// quick succession, and without it each of them starts from the initial
+// congestion window and has to go through STARTUP again. Entries are
+// recorded when a connection closes and are used to seed the STARTUP cwnd
+// and pacing rate of new connections from the same subnet through
+// SendAlgorithmInterface::AdjustNetworkParameters. Only the bandwidth is
+// cached: the min RTT to another host of the subnet says little about the
+// path of a new connection.
+//
+// Thread safe, so that one instance can be shared by all the dispatcher
+// threads of a process.
+class QUIC_EXPORT_PRIVATE Bbr2SubnetBandwidthCache {
+ public:
+  // Prefix lengths which define a client subnet.
+  static constexpr int kIpv4PrefixLength = 24;
+  static constexpr int kIpv6PrefixLength = 48;
+
+  struct QUIC_NO_EXPORT Entry {
+    QuicBandwidth bandwidth = QuicBandwidth::Zero();
+    QuicTime update_time = QuicTime::Zero();
+  };
+
+  // |max_entries| bounds the size of the cache, least recently used subnets
+  // are evicted first. Entries older than |max_age| are ignored.
+  Bbr2SubnetBandwidthCache(size_t max_entries, QuicTime::Delta max_age);
+  Bbr2SubnetBandwidthCache(const Bbr2SubnetBandwidthCache&) = delete;
+  Bbr2SubnetBandwidthCache& operator=(const Bbr2SubnetBandwidthCache&) =
+      delete;
+
+  // Returns the process-wide cache, or nullptr if it is disabled, i.e. if
+  // --quic_bbr2_subnet_bandwidth_cache_size is zero.
+  static Bbr2SubnetBandwidthCache* GetProcessWideInstance();
+
+  // Returns the cache key of the subnet |address| belongs to.
+  static std::string SubnetKey(const QuicIpAddress& address);
+
+  // Records the path model of |send_algorithm| for the subnet of
+  // |peer_address|. Does nothing unless |send_algorithm| is BBRv2 and has a
+  // bandwidth estimate which is not app-limited.
+  void OnConnectionClosed(const QuicIpAddress& peer_address,
+                          const SendAlgorithmInterface& send_algorithm,
+                          QuicTime now);
+
+  // Returns the network parameters to seed a new connection to
+  // |peer_address| with, if a fresh enough entry exists for its subnet.
+  absl::optional<SendAlgorithmInterface::NetworkParams> GetNetworkParams(
+      const QuicIpAddress& peer_address, QuicTime now);
+
+  void Update(const QuicIpAddress& peer_address, const Entry& entry);
+  absl::optional<Entry> Lookup(const QuicIpAddress& peer_address,
+                               QuicTime now);
+
+  size_t Size() const;
+  void Clear();
+
+ private:
+  const QuicTime::Delta max_age_;
+  mutable QuicMutex mutex_;
+  QuicLRUCache<std::string, Entry> cache_ QUIC_GUARDED_BY(mutex_);
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_CONGESTION_CONTROL_BBR2_SUBNET_BANDWIDTH_CACHE_H_
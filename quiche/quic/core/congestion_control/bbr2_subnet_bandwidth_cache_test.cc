@@ -0,0 +1,226 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/congestion_control/bbr2_subnet_bandwidth_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "quiche/quic/core/congestion_control/bbr2_sender.h"
+#include "quiche/quic/core/quic_bandwidth.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/platform/api/quic_ip_address.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+#include "quiche/quic/test_tools/simulator/link.h"
+#include "quiche/quic/test_tools/simulator/quic_endpoint.h"
+#include "quiche/quic/test_tools/simulator/simulator.h"
+#include "quiche/quic/test_tools/simulator/switch.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+const QuicTime::Delta kMaxAge = QuicTime::Delta::FromSeconds(300);
+
+QuicIpAddress Address(const std::string& text) {
+  QuicIpAddress address;
+  EXPECT_TRUE(address.FromString(text));
+  return address;
+}
+
+Bbr2SubnetBandwidthCache::Entry MakeEntry(int64_t kbps, QuicTime update_time) {
+  Bbr2SubnetBandwidthCache::Entry entry;
+  entry.bandwidth = QuicBandwidth::FromKBitsPerSecond(kbps);
+  entry.update_time = update_time;
+  return entry;
+}
+
+class Bbr2SubnetBandwidthCacheTest : public QuicTest {
+ protected:
+  Bbr2SubnetBandwidthCacheTest()
+      : now_(QuicTime::Zero() + QuicTime::Delta::FromSeconds(1000)),
+        cache_(/*max_entries=*/2, kMaxAge) {}
+
+  QuicTime now_;
+  Bbr2SubnetBandwidthCache cache_;
+};
+
+TEST_F(Bbr2SubnetBandwidthCacheTest, SubnetKey) {
+  EXPECT_EQ(Bbr2SubnetBandwidthCache::SubnetKey(Address("192.0.2.1")),
+            Bbr2SubnetBandwidthCache::SubnetKey(Address("192.0.2.254")));
+  EXPECT_NE(Bbr2SubnetBandwidthCache::SubnetKey(Address("192.0.2.1")),
+            Bbr2SubnetBandwidthCache::SubnetKey(Address("192.0.3.1")));
+  EXPECT_EQ(Bbr2SubnetBandwidthCache::SubnetKey(Address("192.0.2.1")),
+            Bbr2SubnetBandwidthCache::SubnetKey(Address("::ffff:192.0.2.7")));
+  EXPECT_EQ(Bbr2SubnetBandwidthCache::SubnetKey(Address("2001:db8:1::1")),
+            Bbr2SubnetBandwidthCache::SubnetKey(Address("2001:db8:1:ff::2")));
+  EXPECT_NE(Bbr2SubnetBandwidthCache::SubnetKey(Address("2001:db8:1::1")),
+            Bbr2SubnetBandwidthCache::SubnetKey(Address("2001:db8:2::1")));
+}
+
+TEST_F(Bbr2SubnetBandwidthCacheTest, LookupBySubnet) {
+  EXPECT_FALSE(cache_.Lookup(Address("192.0.2.1"), now_).has_value());
+  cache_.Update(Address("192.0.2.1"), MakeEntry(5000, now_));
+
+  absl::optional<Bbr2SubnetBandwidthCache::Entry> entry =
+      cache_.Lookup(Address("192.0.2.99"), now_);
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(QuicBandwidth::FromKBitsPerSecond(5000), entry->bandwidth);
+
+  absl::optional<SendAlgorithmInterface::NetworkParams> params =
+      cache_.GetNetworkParams(Address("192.0.2.99"), now_);
+  ASSERT_TRUE(params.has_value());
+  EXPECT_EQ(QuicBandwidth::FromKBitsPerSecond(5000), params->bandwidth);
+  // The min RTT of another host is not fed into the min RTT filter.
+  EXPECT_TRUE(params->rtt.IsZero());
+  EXPECT_FALSE(params->allow_cwnd_to_decrease);
+  EXPECT_FALSE(params->is_rtt_trusted);
+
+  EXPECT_FALSE(cache_.Lookup(Address("198.51.100.1"), now_).has_value());
+}
+
+TEST_F(Bbr2SubnetBandwidthCacheTest, ExpiresOldEntries) {
+  cache_.Update(Address("192.0.2.1"), MakeEntry(5000, now_));
+  EXPECT_TRUE(cache_.Lookup(Address("192.0.2.1"), now_ + kMaxAge).has_value());
+  EXPECT_FALSE(
+      cache_
+          .Lookup(Address("192.0.2.1"),
+                  now_ + kMaxAge + QuicTime::Delta::FromMilliseconds(1))
+          .has_value());
+  EXPECT_EQ(0u, cache_.Size());
+}
+
+TEST_F(Bbr2SubnetBandwidthCacheTest, BoundedSize) {
+  cache_.Update(Address("192.0.2.1"), MakeEntry(1000, now_));
+  cache_.Update(Address("198.51.100.1"), MakeEntry(2000, now_));
+  cache_.Update(Address("203.0.113.1"), MakeEntry(3000, now_));
+  EXPECT_EQ(2u, cache_.Size());
+  EXPECT_FALSE(cache_.Lookup(Address("192.0.2.1"), now_).has_value());
+  EXPECT_TRUE(cache_.Lookup(Address("203.0.113.1"), now_).has_value());
+
+  cache_.Clear();
+  EXPECT_EQ(0u, cache_.Size());
+}
+
+TEST_F(Bbr2SubnetBandwidthCacheTest, IgnoresOtherSendAlgorithms) {
+  MockSendAlgorithm send_algorithm;
+  EXPECT_CALL(send_algorithm, GetCongestionControlType())
+      .WillRepeatedly(testing::Return(kCubicBytes));
+  cache_.OnConnectionClosed(Address("192.0.2.1"), send_algorithm, now_);
+  EXPECT_EQ(0u, cache_.Size());
+}
+
+// Transfers data over a path with a large bandwidth-delay product, where
+// STARTUP takes several round trips to fill the pipe.
+class Bbr2SubnetBandwidthCacheSimulatorTest : public QuicTest {
+ protected:
+  static constexpr QuicBandwidth kBandwidth =
+      QuicBandwidth::FromKBitsPerSecond(100000);
+  static constexpr QuicTime::Delta kPropagationDelay =
+      QuicTime::Delta::FromMilliseconds(20);
+
+  class Network {
+   public:
+    explicit Network(uint64_t connection_id)
+        : simulator_(&random_),
+          switch_(&simulator_, "Switch", 8,
+                  2 * (kBandwidth * (4 * kPropagationDelay))),
+          sender_(&simulator_, "Sender", "Receiver", Perspective::IS_SERVER,
+                  TestConnectionId(connection_id)),
+          receiver_(&simulator_, "Receiver", "Sender", Perspective::IS_CLIENT,
+                    TestConnectionId(connection_id)),
+          sender_link_(&sender_, switch_.port(1), kBandwidth,
+                       kPropagationDelay),
+          receiver_link_(&receiver_, switch_.port(2), kBandwidth,
+                         kPropagationDelay) {
+      sender_.connection()->sent_packet_manager().SetSendAlgorithm(kBBRv2);
+    }
+
+    // Returns the simulated time it took to transfer |bytes|.
+    QuicTime::Delta Transfer(QuicByteCount bytes) {
+      const QuicTime start = simulator_.GetClock()->Now();
+      sender_.AddBytesToTransfer(bytes);
+      EXPECT_TRUE(simulator_.RunUntilOrTimeout(
+          [this, bytes]() { return receiver_.bytes_received() >= bytes; },
+          QuicTime::Delta::FromSeconds(30)));
+      return simulator_.GetClock()->Now() - start;
+    }
+
+    void RecordInto(Bbr2SubnetBandwidthCache* cache) {
+      cache->OnConnectionClosed(
+          sender_.connection()->peer_address().host(),
+          *sender_.connection()->sent_packet_manager().GetSendAlgorithm(),
+          simulator_.GetClock()->Now());
+    }
+
+    void SeedFrom(Bbr2SubnetBandwidthCache* cache) {
+      absl::optional<SendAlgorithmInterface::NetworkParams> params =
+          cache->GetNetworkParams(sender_.connection()->peer_address().host(),
+                                  simulator_.GetClock()->Now());
+      ASSERT_TRUE(params.has_value());
+      sender_.connection()->AdjustNetworkParameters(*params);
+    }
+
+    QuicTime::Delta MinRtt() {
+      return static_cast<const Bbr2Sender*>(
+                 sender_.connection()->sent_packet_manager().GetSendAlgorithm())
+          ->GetNetworkModel()
+          .MinRtt();
+    }
+
+   private:
+    SimpleRandom random_;
+    simulator::Simulator simulator_;
+    simulator::Switch switch_;
+    simulator::QuicEndpoint sender_;
+    simulator::QuicEndpoint receiver_;
+    simulator::SymmetricLink sender_link_;
+    simulator::SymmetricLink receiver_link_;
+  };
+
+  Bbr2SubnetBandwidthCacheSimulatorTest()
+      : cache_(/*max_entries=*/10, kMaxAge) {}
+
+  Bbr2SubnetBandwidthCache cache_;
+};
+
+TEST_F(Bbr2SubnetBandwidthCacheSimulatorTest, FasterTimeToFullThroughput) {
+  const QuicByteCount kShortTransfer = 2 * 1024 * 1024;
+
+  // A long transfer lets BBRv2 learn the path.
+  Network learning(/*connection_id=*/1);
+  learning.Transfer(20 * 1024 * 1024);
+  learning.RecordInto(&cache_);
+  ASSERT_EQ(1u, cache_.Size());
+
+  Network cold(/*connection_id=*/2);
+  const QuicTime::Delta cold_time = cold.Transfer(kShortTransfer);
+
+  Network seeded(/*connection_id=*/3);
+  seeded.SeedFrom(&cache_);
+  const QuicTime::Delta seeded_time = seeded.Transfer(kShortTransfer);
+
+  EXPECT_LT(seeded_time, cold_time);
+  // Seeding saves at least a few round trips of STARTUP.
+  EXPECT_LT(seeded_time + 4 * kPropagationDelay, cold_time);
+}
+
+TEST_F(Bbr2SubnetBandwidthCacheSimulatorTest, SeedingKeepsMinRtt) {
+  Network learning(/*connection_id=*/1);
+  learning.Transfer(20 * 1024 * 1024);
+  learning.RecordInto(&cache_);
+
+  // The new connection has no RTT samples yet, and keeps its initial RTT
+  // rather than the lower min RTT learned by the previous connection.
+  Network seeded(/*connection_id=*/2);
+  const QuicTime::Delta initial_min_rtt = seeded.MinRtt();
+  ASSERT_LT(learning.MinRtt(), initial_min_rtt);
+  seeded.SeedFrom(&cache_);
+  EXPECT_EQ(initial_min_rtt, seeded.MinRtt());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
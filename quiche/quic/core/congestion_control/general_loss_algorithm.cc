@@ -31,11 +31,54 @@ QuicTime::Delta GetMaxRtt(const RttStats& rtt_stats) {
 
 }  // namespace
 
+void RackPathState::OnPacketAcked(QuicPacketNumber acked_packet_number,
+                                  QuicTime sent_time, QuicTime ack_time) {
+  if (largest_acked.IsInitialized() && acked_packet_number < largest_acked) {
+    reordering_seen = true;
+  }
+  largest_acked.UpdateMax(acked_packet_number);
+  // Packet numbers are never reused, so a newer packet number means a more
+  // recently sent packet.
+  if (packet_number.IsInitialized() && acked_packet_number <= packet_number) {
+    return;
+  }
+  packet_number = acked_packet_number;
+  xmit_time = sent_time;
+  if (ack_time > sent_time) {
+    rtt = ack_time - sent_time;
+  }
+}
+
+void RackPathState::OnSpuriousLoss() {
+  reordering_seen = true;
+  reorder_window_multiplier =
+      std::min(reorder_window_multiplier + 1, kMaxReorderWindowMultiplier);
+  reorder_window_persist = kReorderWindowPersistence;
+}
+
+void RackPathState::OnLossEpisode() {
+  if (reorder_window_persist > 0 && --reorder_window_persist == 0) {
+    reorder_window_multiplier = 1;
+  }
+}
+
+QuicTime::Delta RackPathState::ReorderWindow(const RttStats& rtt_stats) const {
+  const QuicTime::Delta min_rtt = rtt_stats.min_rtt().IsZero()
+                                      ? rtt_stats.SmoothedOrInitialRtt()
+                                      : rtt_stats.min_rtt();
+  return std::min(min_rtt * reorder_window_multiplier / 4,
+                  rtt_stats.SmoothedOrInitialRtt());
+}
+
 // Uses nack counts to decide when packets are lost.
 LossDetectionInterface::DetectionStats GeneralLossAlgorithm::DetectLosses(
     const QuicUnackedPacketMap& unacked_packets, QuicTime time,
     const RttStats& rtt_stats, QuicPacketNumber largest_newly_acked,
     const AckedPacketVector& packets_acked, LostPacketVector* packets_lost) {
+  if (use_rack_) {
+    return DetectLossesWithRack(unacked_packets, time, rtt_stats,
+                                packets_acked, packets_lost);
+  }
   DetectionStats detection_stats;
 
   loss_detection_timeout_ = QuicTime::Zero();
@@ -142,6 +185,88 @@ LossDetectionInterface::DetectionStats GeneralLossAlgorithm::DetectLosses(
   return detection_stats;
 }
 
+LossDetectionInterface::DetectionStats
+GeneralLossAlgorithm::DetectLossesWithRack(
+    const QuicUnackedPacketMap& unacked_packets, QuicTime time,
+    const RttStats& rtt_stats, const AckedPacketVector& packets_acked,
+    LostPacketVector* packets_lost) {
+  DetectionStats detection_stats;
+  loss_detection_timeout_ = QuicTime::Zero();
+
+  for (const AckedPacket& acked : packets_acked) {
+    if (unacked_packets.GetPacketNumberSpace(acked.packet_number) !=
+        packet_number_space_) {
+      continue;
+    }
+    const QuicTime sent_time =
+        unacked_packets.GetTransmissionInfo(acked.packet_number).sent_time;
+    if (IsAlternativePathPacket(acked.packet_number)) {
+      alternative_path_rack_.OnPacketAcked(acked.packet_number, sent_time,
+                                           time);
+      continue;
+    }
+    rack_.OnPacketAcked(acked.packet_number, sent_time, time);
+  }
+  if (!rack_.packet_number.IsInitialized()) {
+    return detection_stats;
+  }
+
+  QuicPacketNumber packet_number = unacked_packets.GetLeastUnacked();
+  auto it = unacked_packets.begin();
+  if (least_in_flight_.IsInitialized() && least_in_flight_ > packet_number &&
+      least_in_flight_ <= unacked_packets.largest_sent_packet() + 1) {
+    it += (least_in_flight_ - packet_number);
+    packet_number = least_in_flight_;
+  }
+  least_in_flight_.Clear();
+
+  const QuicTime::Delta max_rtt = GetMaxRtt(rtt_stats);
+  const QuicTime::Delta reorder_window = rack_.ReorderWindow(rtt_stats);
+  const size_t num_lost_before = packets_lost->size();
+  // Only packets sent before the most recently sent acked packet can be
+  // declared lost.
+  for (; packet_number < rack_.packet_number; ++it, ++packet_number) {
+    QUICHE_DCHECK(it != unacked_packets.end());
+    if (!it->in_flight ||
+        unacked_packets.GetPacketNumberSpace(it->encryption_level) !=
+            packet_number_space_) {
+      continue;
+    }
+
+    if (parent_ != nullptr) {
+      parent_->OnReorderingDetected();
+    }
+    if (rack_.largest_acked - packet_number >
+        detection_stats.sent_packets_max_sequence_reordering) {
+      detection_stats.sent_packets_max_sequence_reordering =
+          rack_.largest_acked - packet_number;
+    }
+
+    // Until reordering is seen on the path, behave like packet threshold
+    // loss detection and do not wait for the reorder window.
+    const bool packet_threshold_lost =
+        !rack_.reordering_seen &&
+        rack_.largest_acked - packet_number >= reordering_threshold_;
+    const QuicTime when_lost = it->sent_time + rack_.rtt + reorder_window;
+    if (!packet_threshold_lost && time < when_lost) {
+      loss_detection_timeout_ = when_lost;
+      least_in_flight_ = packet_number;
+      break;
+    }
+    packets_lost->push_back(LostPacket(packet_number, it->bytes_sent));
+    detection_stats.total_loss_detection_response_time +=
+        DetectionResponseTime(max_rtt, it->sent_time, time);
+  }
+  if (!least_in_flight_.IsInitialized()) {
+    least_in_flight_ = rack_.packet_number;
+  }
+  if (packets_lost->size() > num_lost_before) {
+    rack_.OnLossEpisode();
+  }
+
+  return detection_stats;
+}
+
 QuicTime GeneralLossAlgorithm::GetLossTimeout() const {
   return loss_detection_timeout_;
 }
@@ -150,6 +275,15 @@ void GeneralLossAlgorithm::SpuriousLossDetected(
     const QuicUnackedPacketMap& unacked_packets, const RttStats& rtt_stats,
     QuicTime ack_receive_time, QuicPacketNumber packet_number,
     QuicPacketNumber previous_largest_acked) {
+  if (use_rack_) {
+    // Only widen the reorder window of the path the packet was sent on.
+    if (IsAlternativePathPacket(packet_number)) {
+      alternative_path_rack_.OnSpuriousLoss();
+    } else {
+      rack_.OnSpuriousLoss();
+    }
+  }
+
   if (use_adaptive_time_threshold_ && reordering_shift_ > 0) {
     // Increase reordering fraction such that the packet would not have been
     // declared lost.
@@ -189,4 +323,28 @@ void GeneralLossAlgorithm::Reset() {
   least_in_flight_.Clear();
 }
 
+void GeneralLossAlgorithm::OnAlternativePathPacketSent(
+    QuicPacketNumber packet_number) {
+  if (alternative_path_packets_.size() >= kMaxAlternativePathPackets) {
+    alternative_path_packets_.pop_front();
+  }
+  alternative_path_packets_.push_back(packet_number);
+}
+
+void GeneralLossAlgorithm::OnConnectionMigration() {
+  rack_ = alternative_path_rack_;
+  alternative_path_rack_ = RackPathState();
+  alternative_path_packets_.clear();
+}
+
+bool GeneralLossAlgorithm::IsAlternativePathPacket(
+    QuicPacketNumber packet_number) const {
+  for (QuicPacketNumber alternative_path_packet : alternative_path_packets_) {
+    if (alternative_path_packet == packet_number) {
+      return true;
+    }
+  }
+  return false;
+}
+
 }  // namespace quic
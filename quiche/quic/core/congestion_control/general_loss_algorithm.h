@@ -14,9 +14,49 @@
 #include "quiche/quic/core/quic_types.h"
 #include "quiche/quic/core/quic_unacked_packet_map.h"
 #include "quiche/quic/platform/api/quic_export.h"
+#include "quiche/common/quiche_circular_deque.h"
 
 namespace quic {
 
+class RttStats;
+
+// State of RACK (RFC 8985) time based loss detection for one network path.
+struct QUIC_EXPORT_PRIVATE RackPathState {
+  // Number of loss episodes after which a reorder window grown by spurious
+  // losses decays back to its initial size.
+  static constexpr int kReorderWindowPersistence = 16;
+  static constexpr int kMaxReorderWindowMultiplier = 64;
+
+  // Updates the state with a packet sent at |sent_time| and acked at
+  // |ack_time|.
+  void OnPacketAcked(QuicPacketNumber packet_number, QuicTime sent_time,
+                     QuicTime ack_time);
+
+  // Called when a packet declared lost is acked later on.
+  void OnSpuriousLoss();
+
+  // Called when a round of loss detection declares packets lost.
+  void OnLossEpisode();
+
+  // The time a packet sent before the most recently acked one is allowed to
+  // arrive late before it is declared lost: min_rtt / 4, grown by spurious
+  // losses, and never more than the smoothed RTT.
+  QuicTime::Delta ReorderWindow(const RttStats& rtt_stats) const;
+
+  // The most recently sent packet that has been acked, its send time and
+  // RTT.
+  QuicPacketNumber packet_number;
+  QuicTime xmit_time = QuicTime::Zero();
+  QuicTime::Delta rtt = QuicTime::Delta::Zero();
+  // Largest packet acked on this path.
+  QuicPacketNumber largest_acked;
+  // Whether any packet was acked out of order on this path.
+  bool reordering_seen = false;
+  int reorder_window_multiplier = 1;
+  // Remaining loss episodes before reorder_window_multiplier is reset.
+  int reorder_window_persist = 0;
+};
+
 // Class which can be configured to implement's TCP's approach of detecting loss
 // when 3 nacks have been received for a packet or with a time threshold.
 // Also implements TCP's early retransmit(RFC5827).
@@ -111,7 +151,40 @@ class QUIC_EXPORT_PRIVATE GeneralLossAlgorithm : public LossDetectionInterface {
     use_packet_threshold_for_runt_packets_ = false;
   }
 
+  bool use_rack() const { return use_rack_; }
+
+  // Replaces the time threshold of max(SRTT, latest_rtt) with RACK: a packet
+  // is lost once a packet sent after it is acked and it is still missing
+  // after the RTT of that packet plus a reorder window. The reorder window is
+  // learned per path from spurious losses.
+  void enable_rack() { use_rack_ = true; }
+
+  // Called when |packet_number| is a probe sent on an alternative path, e.g.
+  // a multi-port or migration probe of QuicPathValidator. Acks of such
+  // packets update the RACK state of the alternative path only.
+  void OnAlternativePathPacketSent(QuicPacketNumber packet_number);
+
+  // Called when the connection moves to a new path. The state learned on the
+  // alternative path, if any, becomes the state of the default path.
+  void OnConnectionMigration();
+
+  const RackPathState& rack_state() const { return rack_; }
+  const RackPathState& alternative_path_rack_state() const {
+    return alternative_path_rack_;
+  }
+
  private:
+  // Maximum number of alternative path probes whose packet numbers are
+  // remembered. Probes are sent at most a few times per RTT.
+  static constexpr size_t kMaxAlternativePathPackets = 32;
+
+  DetectionStats DetectLossesWithRack(
+      const QuicUnackedPacketMap& unacked_packets, QuicTime time,
+      const RttStats& rtt_stats, const AckedPacketVector& packets_acked,
+      LostPacketVector* packets_lost);
+
+  bool IsAlternativePathPacket(QuicPacketNumber packet_number) const;
+
   LossDetectionInterface* parent_ = nullptr;
   QuicTime loss_detection_timeout_ = QuicTime::Zero();
   // Fraction of a max(SRTT, latest_rtt) to permit reordering before declaring
@@ -130,6 +203,12 @@ class QUIC_EXPORT_PRIVATE GeneralLossAlgorithm : public LossDetectionInterface {
   // note, least_in_flight_ could be largest packet ever sent + 1.
   QuicPacketNumber least_in_flight_{1};
   PacketNumberSpace packet_number_space_ = NUM_PACKET_NUMBER_SPACES;
+  // If true, uses RACK instead of the time threshold above.
+  bool use_rack_ = false;
+  RackPathState rack_;
+  RackPathState alternative_path_rack_;
+  // Packet numbers of the most recent probes sent on an alternative path.
+  quiche::QuicheCircularDeque<QuicPacketNumber> alternative_path_packets_;
 };
 
 }  // namespace quic
@@ -0,0 +1,332 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Tests of RACK-TLP loss detection, see GeneralLossAlgorithm::enable_rack().
+
+#include <cstdint>
+#include <vector>
+
+#include "quiche/quic/core/congestion_control/general_loss_algorithm.h"
+#include "quiche/quic/core/congestion_control/rtt_stats.h"
+#include "quiche/quic/core/crypto/crypto_protocol.h"
+#include "quiche/quic/core/quic_config.h"
+#include "quiche/quic/core/quic_unacked_packet_map.h"
+#include "quiche/quic/core/quic_utils.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/mock_clock.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+#include "quiche/quic/test_tools/simulator/link.h"
+#include "quiche/quic/test_tools/simulator/packet_reorderer.h"
+#include "quiche/quic/test_tools/simulator/quic_endpoint.h"
+#include "quiche/quic/test_tools/simulator/simulator.h"
+#include "quiche/quic/test_tools/simulator/switch.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+const uint32_t kDefaultLength = 1000;
+
+class RackLossDetectionTest : public QuicTest {
+ protected:
+  RackLossDetectionTest() : unacked_packets_(Perspective::IS_CLIENT) {
+    rtt_stats_.UpdateRtt(QuicTime::Delta::FromMilliseconds(100),
+                         QuicTime::Delta::Zero(), clock_.Now());
+    loss_algorithm_.Initialize(APPLICATION_DATA, nullptr);
+    loss_algorithm_.enable_rack();
+  }
+
+  ~RackLossDetectionTest() override {}
+
+  void SendDataPacket(uint64_t packet_number) {
+    QuicStreamFrame frame;
+    frame.stream_id = QuicUtils::GetFirstBidirectionalStreamId(
+        CurrentSupportedVersions()[0].transport_version,
+        Perspective::IS_CLIENT);
+    SerializedPacket packet(QuicPacketNumber(packet_number),
+                            PACKET_1BYTE_PACKET_NUMBER, nullptr,
+                            kDefaultLength);
+    packet.encryption_level = ENCRYPTION_FORWARD_SECURE;
+    packet.retransmittable_frames.push_back(QuicFrame(frame));
+    unacked_packets_.AddSentPacket(&packet, NOT_RETRANSMISSION, clock_.Now(),
+                                   true, true);
+  }
+
+  void AckPacket(uint64_t packet_number) {
+    unacked_packets_.RemoveFromInFlight(QuicPacketNumber(packet_number));
+    unacked_packets_.MaybeUpdateLargestAckedOfPacketNumberSpace(
+        APPLICATION_DATA, QuicPacketNumber(packet_number));
+    packets_acked_.push_back(AckedPacket(QuicPacketNumber(packet_number),
+                                         kDefaultLength, QuicTime::Zero()));
+  }
+
+  void VerifyLosses(uint64_t largest_newly_acked,
+                    const std::vector<uint64_t>& losses_expected) {
+    LostPacketVector lost_packets;
+    loss_algorithm_.DetectLosses(unacked_packets_, clock_.Now(), rtt_stats_,
+                                 QuicPacketNumber(largest_newly_acked),
+                                 packets_acked_, &lost_packets);
+    packets_acked_.clear();
+    ASSERT_EQ(losses_expected.size(), lost_packets.size());
+    for (size_t i = 0; i < losses_expected.size(); ++i) {
+      EXPECT_EQ(lost_packets[i].packet_number,
+                QuicPacketNumber(losses_expected[i]));
+      unacked_packets_.RemoveFromInFlight(lost_packets[i].packet_number);
+    }
+  }
+
+  QuicUnackedPacketMap unacked_packets_;
+  GeneralLossAlgorithm loss_algorithm_;
+  RttStats rtt_stats_;
+  MockClock clock_;
+  AckedPacketVector packets_acked_;
+};
+
+TEST_F(RackLossDetectionTest, PacketThresholdBeforeReorderingSeen) {
+  for (uint64_t i = 1; i <= 5; ++i) {
+    SendDataPacket(i);
+  }
+  clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(100));
+  AckPacket(2);
+  AckPacket(3);
+  VerifyLosses(3, {});
+  EXPECT_NE(QuicTime::Zero(), loss_algorithm_.GetLossTimeout());
+  AckPacket(4);
+  VerifyLosses(4, {1});
+  EXPECT_FALSE(loss_algorithm_.rack_state().reordering_seen);
+}
+
+TEST_F(RackLossDetectionTest, TimeThreshold) {
+  SendDataPacket(1);
+  clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(10));
+  SendDataPacket(2);
+  clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(100));
+  AckPacket(2);
+  VerifyLosses(2, {});
+  // Packet 1 is lost one RACK RTT plus the reorder window of min_rtt / 4
+  // after it was sent.
+  EXPECT_EQ(clock_.Now() + QuicTime::Delta::FromMilliseconds(15),
+            loss_algorithm_.GetLossTimeout());
+  clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(14));
+  VerifyLosses(2, {});
+  clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(1));
+  VerifyLosses(2, {1});
+  EXPECT_EQ(QuicTime::Zero(), loss_algorithm_.GetLossTimeout());
+}
+
+TEST_F(RackLossDetectionTest, SpuriousLossGrowsReorderWindow) {
+  EXPECT_EQ(QuicTime::Delta::FromMilliseconds(25),
+            loss_algorithm_.rack_state().ReorderWindow(rtt_stats_));
+  for (uint64_t i = 1; i <= 4; ++i) {
+    SendDataPacket(i);
+  }
+  clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(100));
+  AckPacket(2);
+  AckPacket(3);
+  AckPacket(4);
+  VerifyLosses(4, {1});
+
+  // Packet 1 arrives late.
+  loss_algorithm_.SpuriousLossDetected(unacked_packets_, rtt_stats_,
+                                       clock_.Now(), QuicPacketNumber(1),
+                                       QuicPacketNumber(4));
+  const RackPathState& rack = loss_algorithm_.rack_state();
+  EXPECT_TRUE(rack.reordering_seen);
+  EXPECT_EQ(2, rack.reorder_window_multiplier);
+  EXPECT_EQ(QuicTime::Delta::FromMilliseconds(50),
+            rack.ReorderWindow(rtt_stats_));
+
+  // The window decays after enough loss episodes without spurious losses.
+  uint64_t packet_number = 5;
+  for (int i = 0; i < RackPathState::kReorderWindowPersistence; ++i) {
+    SendDataPacket(packet_number);
+    clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(100));
+    SendDataPacket(packet_number + 1);
+    clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(100));
+    AckPacket(packet_number + 1);
+    VerifyLosses(packet_number + 1, {packet_number});
+    packet_number += 2;
+  }
+  EXPECT_EQ(1, rack.reorder_window_multiplier);
+}
+
+TEST_F(RackLossDetectionTest, ReorderWindowCappedBySmoothedRtt) {
+  RackPathState rack;
+  for (int i = 0; i < 10; ++i) {
+    rack.OnSpuriousLoss();
+  }
+  EXPECT_EQ(rtt_stats_.smoothed_rtt(), rack.ReorderWindow(rtt_stats_));
+}
+
+TEST_F(RackLossDetectionTest, AlternativePathProbesKeptSeparate) {
+  SendDataPacket(1);
+  SendDataPacket(2);
+  SendDataPacket(3);
+  loss_algorithm_.OnAlternativePathPacketSent(QuicPacketNumber(3));
+  clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(20));
+  // The probe on the faster alternative path is acked first, which must not
+  // make the packets on the default path look lost.
+  AckPacket(3);
+  VerifyLosses(3, {});
+  EXPECT_FALSE(loss_algorithm_.rack_state().packet_number.IsInitialized());
+  EXPECT_EQ(QuicPacketNumber(3),
+            loss_algorithm_.alternative_path_rack_state().packet_number);
+  EXPECT_EQ(QuicTime::Delta::FromMilliseconds(20),
+            loss_algorithm_.alternative_path_rack_state().rtt);
+
+  clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(80));
+  AckPacket(1);
+  AckPacket(2);
+  VerifyLosses(2, {});
+  EXPECT_EQ(QuicPacketNumber(2), loss_algorithm_.rack_state().packet_number);
+
+  // Migrating to the alternative path adopts what was learned on it.
+  loss_algorithm_.OnConnectionMigration();
+  EXPECT_EQ(QuicPacketNumber(3), loss_algorithm_.rack_state().packet_number);
+  EXPECT_FALSE(loss_algorithm_.alternative_path_rack_state()
+                   .packet_number.IsInitialized());
+}
+
+TEST_F(RackLossDetectionTest, SpuriousLossOnAlternativePath) {
+  SendDataPacket(1);
+  loss_algorithm_.OnAlternativePathPacketSent(QuicPacketNumber(1));
+  SendDataPacket(2);
+  SendDataPacket(3);
+  SendDataPacket(4);
+  SendDataPacket(5);
+  clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(100));
+  AckPacket(5);
+  VerifyLosses(5, {1, 2});
+
+  // The probe arrives late: only the reorder window of the alternative path
+  // grows.
+  loss_algorithm_.SpuriousLossDetected(unacked_packets_, rtt_stats_,
+                                       clock_.Now(), QuicPacketNumber(1),
+                                       QuicPacketNumber(5));
+  EXPECT_EQ(1, loss_algorithm_.rack_state().reorder_window_multiplier);
+  EXPECT_FALSE(loss_algorithm_.rack_state().reordering_seen);
+  const RackPathState& alternative_path_rack =
+      loss_algorithm_.alternative_path_rack_state();
+  EXPECT_EQ(2, alternative_path_rack.reorder_window_multiplier);
+
+  loss_algorithm_.SpuriousLossDetected(unacked_packets_, rtt_stats_,
+                                       clock_.Now(), QuicPacketNumber(2),
+                                       QuicPacketNumber(5));
+  EXPECT_EQ(2, loss_algorithm_.rack_state().reorder_window_multiplier);
+}
+
+// Bulk transfers over a link which delivers every 20th packet 5ms late,
+// i.e. after several dozens of packets sent after it.
+class RackLossDetectionSimulatorTest : public QuicTest {
+ protected:
+  static constexpr QuicBandwidth kBandwidth =
+      QuicBandwidth::FromKBitsPerSecond(50000);
+  static constexpr QuicTime::Delta kPropagationDelay =
+      QuicTime::Delta::FromMilliseconds(10);
+
+  class ReorderingNetwork {
+   public:
+    explicit ReorderingNetwork(bool use_rack)
+        : simulator_(&random_),
+          switch_(&simulator_, "Switch", 8,
+                  2 * (kBandwidth * (4 * kPropagationDelay))),
+          sender_(&simulator_, "Sender", "Receiver", Perspective::IS_CLIENT,
+                  TestConnectionId(42)),
+          receiver_(&simulator_, "Receiver", "Sender", Perspective::IS_SERVER,
+                    TestConnectionId(42)),
+          reorderer_(&simulator_, "Reorderer", &sender_, /*period=*/20,
+                     QuicTime::Delta::FromMilliseconds(5)),
+          sender_link_(&reorderer_, switch_.port(1), kBandwidth,
+                       kPropagationDelay),
+          receiver_link_(&receiver_, switch_.port(2), kBandwidth,
+                         kPropagationDelay) {
+      QuicConfig config;
+      QuicTagVector options;
+      if (use_rack) {
+        options.push_back(kRACK);
+      } else {
+        // IETF style loss detection with fixed thresholds.
+        options.push_back(kILD0);
+      }
+      config.SetClientConnectionOptions(options);
+      sender_.connection()->sent_packet_manager().SetFromConfig(config);
+    }
+
+    bool Transfer(QuicByteCount bytes) {
+      const QuicByteCount target = receiver_.bytes_received() + bytes;
+      sender_.AddBytesToTransfer(bytes);
+      return simulator_.RunUntilOrTimeout(
+          [this, target]() { return receiver_.bytes_received() >= target; },
+          QuicTime::Delta::FromSeconds(30));
+    }
+
+    void StopReordering() { reorderer_.set_period(0); }
+
+    void DropNextPacket() { receiver_.DropNextIncomingPacket(); }
+
+    const QuicConnectionStats& sender_stats() {
+      return sender_.connection()->GetStats();
+    }
+
+    const UberLossAlgorithm* loss_algorithm() {
+      return sender_.connection()->sent_packet_manager().uber_loss_algorithm();
+    }
+
+    int packets_reordered() const { return reorderer_.packets_reordered(); }
+
+   private:
+    SimpleRandom random_;
+    simulator::Simulator simulator_;
+    simulator::Switch switch_;
+    simulator::QuicEndpoint sender_;
+    simulator::QuicEndpoint receiver_;
+    simulator::PacketReorderer reorderer_;
+    simulator::SymmetricLink sender_link_;
+    simulator::SymmetricLink receiver_link_;
+  };
+};
+
+TEST_F(RackLossDetectionSimulatorTest, FewerSpuriousRetransmissions) {
+  const QuicByteCount kTransferSize = 10 * 1024 * 1024;
+
+  ReorderingNetwork baseline(/*use_rack=*/false);
+  ASSERT_TRUE(baseline.Transfer(kTransferSize));
+  ASSERT_GT(baseline.packets_reordered(), 100);
+
+  ReorderingNetwork rack(/*use_rack=*/true);
+  ASSERT_TRUE(rack.Transfer(kTransferSize));
+  EXPECT_TRUE(rack.loss_algorithm()->use_rack());
+  EXPECT_TRUE(rack.loss_algorithm()->GetRackState().reordering_seen);
+
+  EXPECT_GT(baseline.sender_stats().packet_spuriously_detected_lost, 0u);
+  EXPECT_LT(rack.sender_stats().packet_spuriously_detected_lost,
+            baseline.sender_stats().packet_spuriously_detected_lost / 4);
+}
+
+TEST_F(RackLossDetectionSimulatorTest, ReorderWindowGrowsAndDecays) {
+  ReorderingNetwork rack(/*use_rack=*/true);
+  ASSERT_TRUE(rack.Transfer(5 * 1024 * 1024));
+  // The first late packets are declared lost by the packet threshold, and
+  // widen the reorder window when they arrive.
+  const QuicPacketCount spurious_losses =
+      rack.sender_stats().packet_spuriously_detected_lost;
+  EXPECT_GT(spurious_losses, 0u);
+  const RackPathState& state = rack.loss_algorithm()->GetRackState();
+  EXPECT_GT(state.reorder_window_multiplier, 1);
+  EXPECT_GT(state.reorder_window_persist, 0);
+
+  // Once the reordering stops, real losses shrink the window back.
+  rack.StopReordering();
+  for (int i = 0; i < RackPathState::kReorderWindowPersistence; ++i) {
+    rack.DropNextPacket();
+    ASSERT_TRUE(rack.Transfer(100 * 1024));
+  }
+  EXPECT_EQ(spurious_losses,
+            rack.sender_stats().packet_spuriously_detected_lost);
+  EXPECT_EQ(1, state.reorder_window_multiplier);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
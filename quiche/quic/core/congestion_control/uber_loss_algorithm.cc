@@ -202,6 +202,25 @@ void UberLossAlgorithm::DisablePacketThresholdForRuntPackets() {
   }
 }
 
+void UberLossAlgorithm::EnableRack() {
+  for (int8_t i = INITIAL_DATA; i < NUM_PACKET_NUMBER_SPACES; ++i) {
+    general_loss_algorithms_[i].enable_rack();
+  }
+}
+
+void UberLossAlgorithm::OnAlternativePathPacketSent(
+    QuicPacketNumber packet_number) {
+  // Path probes are only sent with 1-RTT keys.
+  general_loss_algorithms_[APPLICATION_DATA].OnAlternativePathPacketSent(
+      packet_number);
+}
+
+void UberLossAlgorithm::OnConnectionMigration() {
+  for (int8_t i = INITIAL_DATA; i < NUM_PACKET_NUMBER_SPACES; ++i) {
+    general_loss_algorithms_[i].OnConnectionMigration();
+  }
+}
+
 void UberLossAlgorithm::ResetLossDetection(PacketNumberSpace space) {
   if (space >= NUM_PACKET_NUMBER_SPACES) {
     QUIC_BUG(quic_bug_10469_3) << "Invalid packet number space: " << space;
@@ -101,6 +101,15 @@ class QUIC_EXPORT_PRIVATE UberLossAlgorithm : public LossDetectionInterface {
   // Disable packet threshold loss detection for *runt* packets.
   void DisablePacketThresholdForRuntPackets();
 
+  // Enable RACK time based loss detection of all packet number spaces.
+  void EnableRack();
+
+  // Called when |packet_number| is a probe sent on an alternative path.
+  void OnAlternativePathPacketSent(QuicPacketNumber packet_number);
+
+  // Called when the connection moves to a new path.
+  void OnConnectionMigration();
+
   // Called to reset loss detection of |space|.
   void ResetLossDetection(PacketNumberSpace space);
 
@@ -114,6 +123,16 @@ class QUIC_EXPORT_PRIVATE UberLossAlgorithm : public LossDetectionInterface {
         .use_adaptive_time_threshold();
   }
 
+  bool use_rack() const {
+    return general_loss_algorithms_[APPLICATION_DATA].use_rack();
+  }
+
+  // Returns the RACK state of the default path of the APPLICATION_DATA PN
+  // space.
+  const RackPathState& GetRackState() const {
+    return general_loss_algorithms_[APPLICATION_DATA].rack_state();
+  }
+
  private:
   friend class test::QuicSentPacketManagerPeer;
 
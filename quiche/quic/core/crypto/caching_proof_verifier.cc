@@ -0,0 +1,487 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/crypto/caching_proof_verifier.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/types/optional.h"
+#include "openssl/bytestring.h"
+#include "openssl/sha.h"
+#include "quiche/quic/core/crypto/certificate_view.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+#include "quiche/quic/platform/api/quic_thread.h"
+
+namespace quic {
+
+namespace {
+
+std::unique_ptr<ProofVerifyDetails> CloneDetails(
+    const std::unique_ptr<ProofVerifyDetails>& details) {
+  return details == nullptr ? nullptr : absl::WrapUnique(details->Clone());
+}
+
+// Returns the earliest nextUpdate time of the responses in the DER encoded
+// OCSP response |ocsp_response|, see RFC 6960, Section 4.2.1, or nullopt if
+// there is none or the response cannot be parsed.
+absl::optional<QuicWallTime> GetOcspNextUpdate(
+    absl::string_view ocsp_response) {
+  CBS input, response, response_status, response_bytes_wrapper,
+      response_bytes, response_type, basic_response_bytes, basic_response,
+      response_data, responses;
+  CBS_init(&input, reinterpret_cast<const uint8_t*>(ocsp_response.data()),
+           ocsp_response.size());
+  if (!CBS_get_asn1(&input, &response, CBS_ASN1_SEQUENCE) ||
+      !CBS_get_asn1(&response, &response_status, CBS_ASN1_ENUMERATED) ||
+      !CBS_get_asn1(&response, &response_bytes_wrapper,
+                    CBS_ASN1_CONTEXT_SPECIFIC | CBS_ASN1_CONSTRUCTED | 0) ||
+      !CBS_get_asn1(&response_bytes_wrapper, &response_bytes,
+                    CBS_ASN1_SEQUENCE) ||
+      !CBS_get_asn1(&response_bytes, &response_type, CBS_ASN1_OBJECT) ||
+      !CBS_get_asn1(&response_bytes, &basic_response_bytes,
+                    CBS_ASN1_OCTETSTRING) ||
+      !CBS_get_asn1(&basic_response_bytes, &basic_response,
+                    CBS_ASN1_SEQUENCE) ||
+      !CBS_get_asn1(&basic_response, &response_data, CBS_ASN1_SEQUENCE) ||
+      // Version.
+      !CBS_get_optional_asn1(
+          &response_data, nullptr, nullptr,
+          CBS_ASN1_CONTEXT_SPECIFIC | CBS_ASN1_CONSTRUCTED | 0) ||
+      // Responder ID.
+      !CBS_get_any_asn1(&response_data, nullptr, nullptr) ||
+      // Produced at.
+      !CBS_get_asn1(&response_data, nullptr, CBS_ASN1_GENERALIZEDTIME) ||
+      !CBS_get_asn1(&response_data, &responses, CBS_ASN1_SEQUENCE)) {
+    return absl::nullopt;
+  }
+  absl::optional<QuicWallTime> next_update;
+  while (CBS_len(&responses) > 0) {
+    CBS single_response, next_update_wrapper, next_update_time;
+    int has_next_update;
+    if (!CBS_get_asn1(&responses, &single_response, CBS_ASN1_SEQUENCE) ||
+        // Certificate ID.
+        !CBS_get_asn1(&single_response, nullptr, CBS_ASN1_SEQUENCE) ||
+        // Certificate status.
+        !CBS_get_any_asn1(&single_response, nullptr, nullptr) ||
+        // This update.
+        !CBS_get_asn1(&single_response, nullptr, CBS_ASN1_GENERALIZEDTIME) ||
+        !CBS_get_optional_asn1(
+            &single_response, &next_update_wrapper, &has_next_update,
+            CBS_ASN1_CONTEXT_SPECIFIC | CBS_ASN1_CONSTRUCTED | 0)) {
+      return absl::nullopt;
+    }
+    if (!has_next_update) {
+      continue;
+    }
+    if (!CBS_get_asn1(&next_update_wrapper, &next_update_time,
+                      CBS_ASN1_GENERALIZEDTIME)) {
+      return absl::nullopt;
+    }
+    absl::optional<QuicWallTime> time = ParseDerTime(
+        CBS_ASN1_GENERALIZEDTIME,
+        absl::string_view(reinterpret_cast<const char*>(
+                              CBS_data(&next_update_time)),
+                          CBS_len(&next_update_time)));
+    if (!time.has_value()) {
+      return absl::nullopt;
+    }
+    if (!next_update.has_value() || time->IsBefore(*next_update)) {
+      next_update = time;
+    }
+  }
+  return next_update;
+}
+
+// Makes a worker thread wait for an asynchronous verification of the
+// underlying verifier.
+class BlockingCallback : public ProofVerifierCallback {
+ public:
+  BlockingCallback(ProofVerificationCache::Result* result,
+                   QuicNotification* done)
+      : result_(result), done_(done) {}
+
+  void Run(bool ok, const std::string& error_details,
+           std::unique_ptr<ProofVerifyDetails>* details) override {
+    result_->ok = ok;
+    result_->error_details = error_details;
+    if (details != nullptr) {
+      result_->details = std::move(*details);
+    }
+    done_->Notify();
+  }
+
+ private:
+  ProofVerificationCache::Result* result_;
+  QuicNotification* done_;
+};
+
+}  // namespace
+
+class ProofVerificationCache::WorkerThread : public QuicThread {
+ public:
+  explicit WorkerThread(ProofVerificationCache* cache)
+      : QuicThread("ProofVerification"),
+        cache_(cache),
+        verifier_(cache->CreateVerifier()) {}
+
+ protected:
+  void Run() override {
+    while (cache_->RunNextJob(this)) {
+    }
+  }
+
+ private:
+  friend class ProofVerificationCache;
+
+  ProofVerificationCache* cache_;
+  // Underlying verifiers need not be thread safe, so each thread has its own.
+  const std::unique_ptr<ProofVerifier> verifier_;
+  // Replaced under the lock of the cache whenever the thread goes idle, and
+  // notified when there is a job or the cache is stopping.
+  std::unique_ptr<QuicNotification> wakeup_;
+};
+
+double ProofVerificationCache::Stats::hit_rate() const {
+  const uint64_t lookups = hits + misses;
+  return lookups == 0 ? 0 : static_cast<double>(hits) / lookups;
+}
+
+ProofVerificationCache::ProofVerificationCache(VerifierFactory verifier_factory,
+                                               size_t capacity,
+                                               QuicTime::Delta max_age,
+                                               int num_threads,
+                                               const QuicClock* clock)
+    : verifier_factory_(std::move(verifier_factory)),
+      max_age_(max_age),
+      clock_(clock),
+      cache_(capacity) {
+  QUICHE_DCHECK_GT(num_threads, 0);
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.push_back(std::make_unique<WorkerThread>(this));
+  }
+  for (std::unique_ptr<WorkerThread>& worker : workers_) {
+    worker->Start();
+  }
+}
+
+ProofVerificationCache::~ProofVerificationCache() {
+  {
+    QuicWriterMutexLock lock(&mutex_);
+    stopping_ = true;
+    for (WorkerThread* worker : idle_workers_) {
+      worker->wakeup_->Notify();
+    }
+    idle_workers_.clear();
+  }
+  for (std::unique_ptr<WorkerThread>& worker : workers_) {
+    worker->Join();
+  }
+}
+
+bool ProofVerificationCache::Lookup(
+    absl::string_view policy_id,
+    std::shared_ptr<const ProofVerifyContext> context,
+    const std::string& hostname, uint16_t port,
+    const std::vector<std::string>& certs, const std::string& ocsp_response,
+    const std::string& cert_sct, std::unique_ptr<ProofVerifyDetails>* details,
+    DoneCallback done) {
+  std::string key =
+      Key(policy_id, hostname, port, certs, ocsp_response, cert_sct);
+  const QuicTime now = clock_->Now();
+  QuicWriterMutexLock lock(&mutex_);
+  auto it = cache_.Lookup(key);
+  if (it != cache_.end()) {
+    if (now < it->second->expiry) {
+      ++stats_.hits;
+      *details = CloneDetails(it->second->details);
+      return true;
+    }
+    cache_.Erase(it);
+  }
+  ++stats_.misses;
+  std::vector<Waiter>& waiters = in_flight_[key];
+  waiters.push_back(Waiter{now, std::move(done)});
+  if (waiters.size() > 1) {
+    ++stats_.coalesced;
+    return false;
+  }
+  jobs_.push_back(Job{std::move(key), std::move(context), hostname, port,
+                      certs, ocsp_response, cert_sct});
+  if (!idle_workers_.empty()) {
+    idle_workers_.back()->wakeup_->Notify();
+    idle_workers_.pop_back();
+  }
+  return false;
+}
+
+size_t ProofVerificationCache::Size() const {
+  QuicReaderMutexLock lock(&mutex_);
+  return cache_.Size();
+}
+
+ProofVerificationCache::Stats ProofVerificationCache::GetStats() const {
+  QuicReaderMutexLock lock(&mutex_);
+  return stats_;
+}
+
+// static
+std::string ProofVerificationCache::Key(absl::string_view policy_id,
+                                        absl::string_view hostname,
+                                        uint16_t port,
+                                        const std::vector<std::string>& certs,
+                                        absl::string_view ocsp_response,
+                                        absl::string_view cert_sct) {
+  SHA256_CTX sha256;
+  SHA256_Init(&sha256);
+  // Every field is length prefixed, so that the key is unambiguous.
+  auto add = [&sha256](absl::string_view field) {
+    const uint64_t length = field.size();
+    SHA256_Update(&sha256, &length, sizeof(length));
+    SHA256_Update(&sha256, field.data(), field.size());
+  };
+  add(policy_id);
+  add(hostname);
+  SHA256_Update(&sha256, &port, sizeof(port));
+  const uint64_t num_certs = certs.size();
+  SHA256_Update(&sha256, &num_certs, sizeof(num_certs));
+  for (const std::string& cert : certs) {
+    add(cert);
+  }
+  add(ocsp_response);
+  add(cert_sct);
+  std::string key(SHA256_DIGEST_LENGTH, '\0');
+  SHA256_Final(reinterpret_cast<uint8_t*>(&key[0]), &sha256);
+  return key;
+}
+
+bool ProofVerificationCache::RunNextJob(WorkerThread* worker) {
+  QuicNotification* wakeup = nullptr;
+  Job job;
+  {
+    QuicWriterMutexLock lock(&mutex_);
+    if (stopping_) {
+      return false;
+    }
+    if (jobs_.empty()) {
+      worker->wakeup_ = std::make_unique<QuicNotification>();
+      wakeup = worker->wakeup_.get();
+      idle_workers_.push_back(worker);
+    } else {
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+  }
+  if (wakeup != nullptr) {
+    wakeup->WaitForNotification();
+    return true;
+  }
+  Verify(worker->verifier_.get(), job);
+  return true;
+}
+
+void ProofVerificationCache::Verify(ProofVerifier* verifier, const Job& job) {
+  const QuicTime start = clock_->Now();
+  Result result;
+  QuicNotification async_done;
+  uint8_t alert = 0;
+  const QuicAsyncStatus status = verifier->VerifyCertChain(
+      job.hostname, job.port, job.certs, job.ocsp_response, job.cert_sct,
+      job.context.get(), &result.error_details, &result.details, &alert,
+      std::make_unique<BlockingCallback>(&result, &async_done));
+  if (status == QUIC_PENDING) {
+    async_done.WaitForNotification();
+  } else {
+    result.ok = status == QUIC_SUCCESS;
+  }
+  if (!result.ok) {
+    QUIC_DLOG(INFO) << "Failed to verify the certificate chain of "
+                    << job.hostname << ": " << result.error_details;
+  }
+
+  const QuicTime::Delta lifetime =
+      result.ok ? GetLifetime(job) : QuicTime::Delta::Zero();
+  const QuicTime now = clock_->Now();
+  const QuicTime::Delta verification_time = now - start;
+  std::vector<Waiter> waiters;
+  {
+    QuicWriterMutexLock lock(&mutex_);
+    ++stats_.verifications;
+    if (!result.ok) {
+      ++stats_.failures;
+    }
+    stats_.total_verification_time =
+        stats_.total_verification_time + verification_time;
+    stats_.max_verification_time =
+        std::max(stats_.max_verification_time, verification_time);
+    if (lifetime > QuicTime::Delta::Zero()) {
+      cache_.Insert(job.key, std::make_unique<Entry>(Entry{
+                                 now + lifetime,
+                                 CloneDetails(result.details)}));
+    }
+    auto it = in_flight_.find(job.key);
+    if (it != in_flight_.end()) {
+      waiters = std::move(it->second);
+      in_flight_.erase(it);
+    }
+    for (const Waiter& waiter : waiters) {
+      stats_.total_miss_latency =
+          stats_.total_miss_latency + (now - waiter.start);
+    }
+  }
+  for (const Waiter& waiter : waiters) {
+    waiter.done(result);
+  }
+}
+
+QuicTime::Delta ProofVerificationCache::GetLifetime(const Job& job) const {
+  if (job.certs.empty()) {
+    return QuicTime::Delta::Zero();
+  }
+  std::unique_ptr<CertificateView> leaf =
+      CertificateView::ParseSingleCertificate(job.certs[0]);
+  if (leaf == nullptr) {
+    return QuicTime::Delta::Zero();
+  }
+  QuicWallTime valid_until = leaf->validity_end();
+  absl::optional<QuicWallTime> next_update =
+      GetOcspNextUpdate(job.ocsp_response);
+  if (next_update.has_value() && next_update->IsBefore(valid_until)) {
+    valid_until = *next_update;
+  }
+  const QuicWallTime now = clock_->WallNow();
+  if (!now.IsBefore(valid_until)) {
+    return QuicTime::Delta::Zero();
+  }
+  return std::min(max_age_, valid_until.AbsoluteDifference(now));
+}
+
+class CachingProofVerifier::CompletionQueue {
+ public:
+  struct Completion {
+    uint64_t id;
+    bool ok;
+    std::string error_details;
+    std::unique_ptr<ProofVerifyDetails> details;
+  };
+
+  explicit CompletionQueue(std::function<void()> wakeup)
+      : wakeup_(std::move(wakeup)) {}
+
+  // Called on the worker threads.
+  void Add(uint64_t id, const ProofVerificationCache::Result& result) {
+    Completion completion{id, result.ok, result.error_details,
+                          CloneDetails(result.details)};
+    QuicWriterMutexLock lock(&mutex_);
+    if (closed_) {
+      return;
+    }
+    completions_.push_back(std::move(completion));
+    if (wakeup_) {
+      wakeup_();
+    }
+  }
+
+  std::vector<Completion> TakeAll() {
+    std::vector<Completion> completions;
+    QuicWriterMutexLock lock(&mutex_);
+    completions.swap(completions_);
+    return completions;
+  }
+
+  // Drops the completions, and stops calling |wakeup_|, which may not outlive
+  // the verifier.
+  void Close() {
+    QuicWriterMutexLock lock(&mutex_);
+    closed_ = true;
+    wakeup_ = nullptr;
+    completions_.clear();
+  }
+
+ private:
+  QuicMutex mutex_;
+  std::function<void()> wakeup_ QUIC_GUARDED_BY(mutex_);
+  std::vector<Completion> completions_ QUIC_GUARDED_BY(mutex_);
+  bool closed_ QUIC_GUARDED_BY(mutex_) = false;
+};
+
+CachingProofVerifier::CachingProofVerifier(
+    std::shared_ptr<ProofVerificationCache> cache,
+    std::function<void()> wakeup)
+    : cache_(std::move(cache)),
+      verifier_(cache_->CreateVerifier()),
+      completions_(std::make_shared<CompletionQueue>(std::move(wakeup))) {}
+
+CachingProofVerifier::~CachingProofVerifier() { completions_->Close(); }
+
+QuicAsyncStatus CachingProofVerifier::VerifyProof(
+    const std::string& hostname, const uint16_t port,
+    const std::string& server_config, QuicTransportVersion transport_version,
+    absl::string_view chlo_hash, const std::vector<std::string>& certs,
+    const std::string& cert_sct, const std::string& signature,
+    const ProofVerifyContext* context, std::string* error_details,
+    std::unique_ptr<ProofVerifyDetails>* details,
+    std::unique_ptr<ProofVerifierCallback> callback) {
+  return verifier_->VerifyProof(
+      hostname, port, server_config, transport_version, chlo_hash, certs,
+      cert_sct, signature, context, error_details, details,
+      std::move(callback));
+}
+
+QuicAsyncStatus CachingProofVerifier::VerifyCertChain(
+    const std::string& hostname, const uint16_t port,
+    const std::vector<std::string>& certs, const std::string& ocsp_response,
+    const std::string& cert_sct, const ProofVerifyContext* context,
+    std::string* /*error_details*/,
+    std::unique_ptr<ProofVerifyDetails>* details, uint8_t* /*out_alert*/,
+    std::unique_ptr<ProofVerifierCallback> callback) {
+  absl::string_view policy_id;
+  std::shared_ptr<const ProofVerifyContext> underlying_context;
+  if (context != nullptr) {
+    const auto* caching_context =
+        static_cast<const CachingProofVerifyContext*>(context);
+    policy_id = caching_context->policy_id();
+    underlying_context = caching_context->context();
+  }
+  const uint64_t id = next_verification_id_++;
+  std::shared_ptr<CompletionQueue> completions = completions_;
+  if (cache_->Lookup(policy_id, std::move(underlying_context), hostname, port,
+                     certs, ocsp_response, cert_sct, details,
+                     [completions, id](const ProofVerificationCache::Result&
+                                           result) {
+                       completions->Add(id, result);
+                     })) {
+    return QUIC_SUCCESS;
+  }
+  // Completions are only taken on this thread, so the callback is registered
+  // before the completion of the verification can be taken.
+  callbacks_[id] = std::move(callback);
+  return QUIC_PENDING;
+}
+
+std::unique_ptr<ProofVerifyContext>
+CachingProofVerifier::CreateDefaultContext() {
+  return std::make_unique<CachingProofVerifyContext>(
+      "default", verifier_->CreateDefaultContext());
+}
+
+size_t CachingProofVerifier::RunPendingCallbacks() {
+  size_t num_run = 0;
+  for (CompletionQueue::Completion& completion : completions_->TakeAll()) {
+    auto it = callbacks_.find(completion.id);
+    if (it == callbacks_.end()) {
+      QUICHE_DCHECK(false) << "Unknown verification " << completion.id;
+      continue;
+    }
+    std::unique_ptr<ProofVerifierCallback> callback = std::move(it->second);
+    callbacks_.erase(it);
+    callback->Run(completion.ok, completion.error_details,
+                  &completion.details);
+    ++num_run;
+  }
+  return num_run;
+}
+
+}  // namespace quic
@@ -0,0 +1,246 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_CRYPTO_CACHING_PROOF_VERIFIER_H_
+#define QUICHE_QUIC_CORE_CRYPTO_CACHING_PROOF_VERIFIER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "quiche/quic/core/crypto/proof_verifier.h"
+#include "quiche/quic/core/quic_clock.h"
+#include "quiche/quic/core/quic_lru_cache.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/platform/api/quic_export.h"
+#include "quiche/quic/platform/api/quic_mutex.h"
+
+namespace quic {
+
+// A thread safe cache of successful certificate chain verifications, shared by
+// the CachingProofVerifiers of any number of connections and threads. Clients
+// which open many connections to a few servers otherwise verify the same
+// chains over and over.
+//
+// Entries are keyed by the SHA-256 hash of the verification policy ID,
+// hostname, port, certificate chain, OCSP response and SCT list. They expire
+// after |max_age| so that revocations are picked up, and never outlive the
+// leaf certificate or the nextUpdate time of the OCSP response. Failed
+// verifications are not cached, and neither are chains with a leaf
+// certificate which cannot be parsed.
+//
+// Misses are verified on a pool of worker threads, each with its own
+// underlying ProofVerifier, and concurrent misses of the same key wait for one
+// verification. If the underlying verifier returns QUIC_PENDING, the worker
+// thread blocks until its callback runs, so it must call back on a thread of
+// its own.
+class QUIC_EXPORT_PRIVATE ProofVerificationCache {
+ public:
+  struct QUIC_EXPORT_PRIVATE Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // Misses which waited for a verification of the same key in flight.
+    uint64_t coalesced = 0;
+    // Verifications by the underlying verifier, and how many of them failed.
+    uint64_t verifications = 0;
+    uint64_t failures = 0;
+    // Time spent in the underlying verifier.
+    QuicTime::Delta total_verification_time = QuicTime::Delta::Zero();
+    QuicTime::Delta max_verification_time = QuicTime::Delta::Zero();
+    // Time from the lookup of a miss until its verification completed, which
+    // includes waiting for a worker thread.
+    QuicTime::Delta total_miss_latency = QuicTime::Delta::Zero();
+
+    double hit_rate() const;
+  };
+
+  // The outcome of a verification, as passed to ProofVerifierCallback::Run().
+  struct QUIC_EXPORT_PRIVATE Result {
+    bool ok = false;
+    std::string error_details;
+    std::unique_ptr<ProofVerifyDetails> details;
+  };
+
+  // Called on a worker thread when the verification of a miss completes.
+  using DoneCallback = std::function<void(const Result& result)>;
+
+  // Creates the underlying verifiers. Called on the thread which creates the
+  // cache or a CachingProofVerifier.
+  using VerifierFactory = std::function<std::unique_ptr<ProofVerifier>()>;
+
+  // Keeps up to |capacity| verifications for up to |max_age| each. |clock|
+  // must be thread safe and outlive the cache.
+  ProofVerificationCache(VerifierFactory verifier_factory, size_t capacity,
+                         QuicTime::Delta max_age, int num_threads,
+                         const QuicClock* clock);
+  ProofVerificationCache(const ProofVerificationCache&) = delete;
+  ProofVerificationCache& operator=(const ProofVerificationCache&) = delete;
+  // Stops the worker threads. Queued verifications are dropped.
+  ~ProofVerificationCache();
+
+  // Looks up the verification of |certs| for |hostname| under the
+  // verification policy |policy_id|. On a hit, returns true and sets
+  // |*details| to a copy of the details of the verification. Otherwise
+  // returns false, verifies the chain with |context|, which may be null, and
+  // calls |done| once it is verified.
+  bool Lookup(absl::string_view policy_id,
+              std::shared_ptr<const ProofVerifyContext> context,
+              const std::string& hostname, uint16_t port,
+              const std::vector<std::string>& certs,
+              const std::string& ocsp_response, const std::string& cert_sct,
+              std::unique_ptr<ProofVerifyDetails>* details, DoneCallback done);
+
+  std::unique_ptr<ProofVerifier> CreateVerifier() const {
+    return verifier_factory_();
+  }
+
+  size_t Size() const;
+  Stats GetStats() const;
+
+ private:
+  class WorkerThread;
+
+  struct Entry {
+    QuicTime expiry;
+    std::unique_ptr<ProofVerifyDetails> details;
+  };
+
+  struct Job {
+    std::string key;
+    std::shared_ptr<const ProofVerifyContext> context;
+    std::string hostname;
+    uint16_t port = 0;
+    std::vector<std::string> certs;
+    std::string ocsp_response;
+    std::string cert_sct;
+  };
+
+  struct Waiter {
+    QuicTime start;
+    DoneCallback done;
+  };
+
+  static std::string Key(absl::string_view policy_id,
+                         absl::string_view hostname, uint16_t port,
+                         const std::vector<std::string>& certs,
+                         absl::string_view ocsp_response,
+                         absl::string_view cert_sct);
+
+  // Runs on the worker threads. Returns false once the cache is stopping.
+  bool RunNextJob(WorkerThread* worker);
+  void Verify(ProofVerifier* verifier, const Job& job);
+
+  // Returns how long a successful verification of |job| may be cached, which
+  // is zero if its leaf certificate cannot be parsed.
+  QuicTime::Delta GetLifetime(const Job& job) const;
+
+  const VerifierFactory verifier_factory_;
+  const QuicTime::Delta max_age_;
+  const QuicClock* clock_;
+  std::vector<std::unique_ptr<WorkerThread>> workers_;
+
+  mutable QuicMutex mutex_;
+  QuicLRUCache<std::string, Entry> cache_ QUIC_GUARDED_BY(mutex_);
+  // Waiters of the keys being verified or queued for verification.
+  absl::flat_hash_map<std::string, std::vector<Waiter>> in_flight_
+      QUIC_GUARDED_BY(mutex_);
+  std::deque<Job> jobs_ QUIC_GUARDED_BY(mutex_);
+  std::vector<WorkerThread*> idle_workers_ QUIC_GUARDED_BY(mutex_);
+  bool stopping_ QUIC_GUARDED_BY(mutex_) = false;
+  Stats stats_ QUIC_GUARDED_BY(mutex_);
+};
+
+// The context of the verifications of a CachingProofVerifier: the context of
+// the underlying verifier, and the ID of the verification policy it stands
+// for. Verifications are only shared by contexts with the same policy ID, so
+// contexts which verify differently must have different IDs.
+class QUIC_EXPORT_PRIVATE CachingProofVerifyContext
+    : public ProofVerifyContext {
+ public:
+  CachingProofVerifyContext(std::string policy_id,
+                            std::shared_ptr<const ProofVerifyContext> context)
+      : policy_id_(std::move(policy_id)), context_(std::move(context)) {}
+
+  const std::string& policy_id() const { return policy_id_; }
+  const std::shared_ptr<const ProofVerifyContext>& context() const {
+    return context_;
+  }
+
+ private:
+  const std::string policy_id_;
+  // Shared with the verifications in flight, which may outlive the
+  // connection.
+  const std::shared_ptr<const ProofVerifyContext> context_;
+};
+
+// A ProofVerifier which verifies certificate chains through a shared
+// ProofVerificationCache. Hits return QUIC_SUCCESS right away. Misses return
+// QUIC_PENDING, and their callbacks run in RunPendingCallbacks(), which the
+// owner calls on the thread of its connections, e.g. from its event loop
+// after |wakeup| was called.
+//
+// The contexts passed to it must be CachingProofVerifyContexts, or null, which
+// verifies with a null context under an empty policy ID.
+//
+// QUIC crypto proofs sign the server config, so VerifyProof() is passed
+// through to an underlying verifier of its own without caching.
+class QUIC_EXPORT_PRIVATE CachingProofVerifier : public ProofVerifier {
+ public:
+  // |wakeup| is called on a worker thread whenever a verification of this
+  // verifier completes. It must be thread safe, and must not call
+  // RunPendingCallbacks().
+  CachingProofVerifier(std::shared_ptr<ProofVerificationCache> cache,
+                       std::function<void()> wakeup);
+  // Pending callbacks are destroyed without being run.
+  ~CachingProofVerifier() override;
+
+  // ProofVerifier implementation.
+  QuicAsyncStatus VerifyProof(
+      const std::string& hostname, const uint16_t port,
+      const std::string& server_config, QuicTransportVersion transport_version,
+      absl::string_view chlo_hash, const std::vector<std::string>& certs,
+      const std::string& cert_sct, const std::string& signature,
+      const ProofVerifyContext* context, std::string* error_details,
+      std::unique_ptr<ProofVerifyDetails>* details,
+      std::unique_ptr<ProofVerifierCallback> callback) override;
+  QuicAsyncStatus VerifyCertChain(
+      const std::string& hostname, const uint16_t port,
+      const std::vector<std::string>& certs, const std::string& ocsp_response,
+      const std::string& cert_sct, const ProofVerifyContext* context,
+      std::string* error_details, std::unique_ptr<ProofVerifyDetails>* details,
+      uint8_t* out_alert,
+      std::unique_ptr<ProofVerifierCallback> callback) override;
+  // Returns a CachingProofVerifyContext with the default context of the
+  // underlying verifier, under the policy ID "default".
+  std::unique_ptr<ProofVerifyContext> CreateDefaultContext() override;
+
+  // Runs the callbacks of the completed verifications, and returns how many
+  // ran.
+  size_t RunPendingCallbacks();
+
+  size_t num_pending_callbacks() const { return callbacks_.size(); }
+
+ private:
+  // Completed verifications, shared with the worker threads.
+  class CompletionQueue;
+
+  std::shared_ptr<ProofVerificationCache> cache_;
+  // Only used on the thread of the connections.
+  const std::unique_ptr<ProofVerifier> verifier_;
+  std::shared_ptr<CompletionQueue> completions_;
+  uint64_t next_verification_id_ = 0;
+  absl::flat_hash_map<uint64_t, std::unique_ptr<ProofVerifierCallback>>
+      callbacks_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_CRYPTO_CACHING_PROOF_VERIFIER_H_
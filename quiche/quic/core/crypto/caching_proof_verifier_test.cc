@@ -0,0 +1,425 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/crypto/caching_proof_verifier.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "openssl/bytestring.h"
+#include "quiche/quic/core/crypto/certificate_view.h"
+#include "quiche/quic/platform/api/quic_mutex.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/mock_clock.h"
+#include "quiche/quic/test_tools/test_certificates.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+constexpr char kHostname[] = "example.org";
+constexpr char kBadHostname[] = "bad.example.org";
+constexpr QuicTime::Delta kMaxAge = QuicTime::Delta::FromSeconds(60);
+
+class FakeDetails : public ProofVerifyDetails {
+ public:
+  explicit FakeDetails(std::string hostname) : hostname_(std::move(hostname)) {}
+
+  ProofVerifyDetails* Clone() const override {
+    return new FakeDetails(hostname_);
+  }
+
+  const std::string& hostname() const { return hostname_; }
+
+ private:
+  std::string hostname_;
+};
+
+class FakeContext : public ProofVerifyContext {};
+
+// Shared by the verifiers of a test.
+struct VerifierState {
+  std::atomic<int> num_verifiers{0};
+  std::atomic<int> verifications{0};
+  std::atomic<const ProofVerifyContext*> last_context{nullptr};
+  std::unique_ptr<QuicNotification> unblocked;
+};
+
+// Accepts the chains of every hostname but kBadHostname, and counts its
+// verifications. After Block(), verifications wait for Unblock().
+class CountingProofVerifier : public ProofVerifier {
+ public:
+  explicit CountingProofVerifier(VerifierState* state) : state_(state) {
+    ++state_->num_verifiers;
+  }
+
+  QuicAsyncStatus VerifyProof(
+      const std::string& /*hostname*/, const uint16_t /*port*/,
+      const std::string& /*server_config*/,
+      QuicTransportVersion /*transport_version*/,
+      absl::string_view /*chlo_hash*/,
+      const std::vector<std::string>& /*certs*/,
+      const std::string& /*cert_sct*/, const std::string& /*signature*/,
+      const ProofVerifyContext* /*context*/, std::string* error_details,
+      std::unique_ptr<ProofVerifyDetails>* /*details*/,
+      std::unique_ptr<ProofVerifierCallback> /*callback*/) override {
+    *error_details = "QUIC crypto";
+    return QUIC_FAILURE;
+  }
+
+  QuicAsyncStatus VerifyCertChain(
+      const std::string& hostname, const uint16_t /*port*/,
+      const std::vector<std::string>& /*certs*/,
+      const std::string& /*ocsp_response*/, const std::string& /*cert_sct*/,
+      const ProofVerifyContext* context, std::string* error_details,
+      std::unique_ptr<ProofVerifyDetails>* details, uint8_t* /*out_alert*/,
+      std::unique_ptr<ProofVerifierCallback> /*callback*/) override {
+    ++state_->verifications;
+    state_->last_context = context;
+    if (state_->unblocked != nullptr) {
+      state_->unblocked->WaitForNotification();
+    }
+    if (hostname == kBadHostname) {
+      *error_details = "Untrusted chain";
+      return QUIC_FAILURE;
+    }
+    *details = std::make_unique<FakeDetails>(hostname);
+    return QUIC_SUCCESS;
+  }
+
+  std::unique_ptr<ProofVerifyContext> CreateDefaultContext() override {
+    return std::make_unique<FakeContext>();
+  }
+
+ private:
+  VerifierState* state_;
+};
+
+// Returns a successful OCSP response with a single response, which is valid
+// until |next_update|. Only the fields the cache reads are meaningful.
+std::string OcspResponse(QuicWallTime next_update) {
+  const std::string next_update_time = absl::FormatTime(
+      "%Y%m%d%H%M%SZ", absl::FromUnixSeconds(next_update.ToUNIXSeconds()),
+      absl::UTCTimeZone());
+  const std::string this_update_time = "20000101000000Z";
+  // id-pkix-ocsp-basic.
+  const uint8_t kBasicResponseType[] = {0x2b, 0x06, 0x01, 0x05, 0x05,
+                                        0x07, 0x30, 0x01, 0x01};
+  auto add_time = [](CBB* cbb, const std::string& time) {
+    CBB child;
+    return CBB_add_asn1(cbb, &child, CBS_ASN1_GENERALIZEDTIME) &&
+           CBB_add_bytes(&child, reinterpret_cast<const uint8_t*>(time.data()),
+                         time.size()) &&
+           CBB_flush(cbb);
+  };
+  bssl::ScopedCBB cbb;
+  CBB response, status, bytes_wrapper, bytes, type, basic_octets, basic, data,
+      responder_id, responses, single, cert_id, cert_status,
+      next_update_wrapper;
+  uint8_t* out;
+  size_t out_length;
+  if (!CBB_init(cbb.get(), 256) ||
+      !CBB_add_asn1(cbb.get(), &response, CBS_ASN1_SEQUENCE) ||
+      !CBB_add_asn1(&response, &status, CBS_ASN1_ENUMERATED) ||
+      !CBB_add_u8(&status, 0) ||
+      !CBB_add_asn1(&response, &bytes_wrapper,
+                    CBS_ASN1_CONTEXT_SPECIFIC | CBS_ASN1_CONSTRUCTED | 0) ||
+      !CBB_add_asn1(&bytes_wrapper, &bytes, CBS_ASN1_SEQUENCE) ||
+      !CBB_add_asn1(&bytes, &type, CBS_ASN1_OBJECT) ||
+      !CBB_add_bytes(&type, kBasicResponseType, sizeof(kBasicResponseType)) ||
+      !CBB_add_asn1(&bytes, &basic_octets, CBS_ASN1_OCTETSTRING) ||
+      !CBB_add_asn1(&basic_octets, &basic, CBS_ASN1_SEQUENCE) ||
+      !CBB_add_asn1(&basic, &data, CBS_ASN1_SEQUENCE) ||
+      !CBB_add_asn1(&data, &responder_id,
+                    CBS_ASN1_CONTEXT_SPECIFIC | CBS_ASN1_CONSTRUCTED | 2) ||
+      !CBB_add_asn1_octet_string(&responder_id,
+                                 reinterpret_cast<const uint8_t*>("key id"),
+                                 6) ||
+      !add_time(&data, this_update_time) ||
+      !CBB_add_asn1(&data, &responses, CBS_ASN1_SEQUENCE) ||
+      !CBB_add_asn1(&responses, &single, CBS_ASN1_SEQUENCE) ||
+      !CBB_add_asn1(&single, &cert_id, CBS_ASN1_SEQUENCE) ||
+      !CBB_add_asn1_uint64(&cert_id, 1) ||
+      // Good.
+      !CBB_add_asn1(&single, &cert_status, CBS_ASN1_CONTEXT_SPECIFIC | 0) ||
+      !add_time(&single, this_update_time) ||
+      !CBB_add_asn1(&single, &next_update_wrapper,
+                    CBS_ASN1_CONTEXT_SPECIFIC | CBS_ASN1_CONSTRUCTED | 0) ||
+      !add_time(&next_update_wrapper, next_update_time) ||
+      !CBB_finish(cbb.get(), &out, &out_length)) {
+    ADD_FAILURE() << "Failed to encode the OCSP response";
+    return "";
+  }
+  bssl::UniquePtr<uint8_t> owned_out(out);
+  return std::string(reinterpret_cast<const char*>(out), out_length);
+}
+
+struct Outcome {
+  bool done = false;
+  bool ok = false;
+  std::string error_details;
+  std::unique_ptr<ProofVerifyDetails> details;
+};
+
+class OutcomeCallback : public ProofVerifierCallback {
+ public:
+  explicit OutcomeCallback(Outcome* outcome) : outcome_(outcome) {}
+
+  void Run(bool ok, const std::string& error_details,
+           std::unique_ptr<ProofVerifyDetails>* details) override {
+    outcome_->done = true;
+    outcome_->ok = ok;
+    outcome_->error_details = error_details;
+    outcome_->details = std::move(*details);
+  }
+
+ private:
+  Outcome* outcome_;
+};
+
+class CachingProofVerifierTest : public QuicTest {
+ protected:
+  CachingProofVerifierTest()
+      : cache_(std::make_shared<ProofVerificationCache>(
+            [this]() {
+              return std::make_unique<CountingProofVerifier>(&state_);
+            },
+            /*capacity=*/10, kMaxAge, kNumThreads, &clock_)),
+        verifier_(std::make_unique<CachingProofVerifier>(cache_, nullptr)) {}
+
+  QuicAsyncStatus Verify(const std::string& hostname,
+                         const std::string& ocsp_response, Outcome* outcome,
+                         const ProofVerifyContext* context = nullptr) {
+    std::string error_details;
+    uint8_t alert = 0;
+    const QuicAsyncStatus status = verifier_->VerifyCertChain(
+        hostname, 443, certs_, ocsp_response, "sct", context, &error_details,
+        &outcome->details, &alert, std::make_unique<OutcomeCallback>(outcome));
+    if (status == QUIC_SUCCESS) {
+      outcome->done = true;
+      outcome->ok = true;
+    }
+    return status;
+  }
+
+  // Runs callbacks until |num_callbacks| have run.
+  void RunCallbacks(size_t num_callbacks) {
+    size_t num_run = 0;
+    while (num_run < num_callbacks) {
+      num_run += verifier_->RunPendingCallbacks();
+      if (num_run < num_callbacks) {
+        absl::SleepFor(absl::Milliseconds(1));
+      }
+    }
+  }
+
+  // Advances the clock to |delta| before the end of the validity of the leaf
+  // certificate.
+  void AdvanceClockToCertificateExpiry(QuicTime::Delta delta) {
+    std::unique_ptr<CertificateView> leaf =
+        CertificateView::ParseSingleCertificate(certs_[0]);
+    ASSERT_NE(nullptr, leaf);
+    clock_.AdvanceTime(
+        leaf->validity_end().AbsoluteDifference(clock_.WallNow()) - delta);
+  }
+
+  static constexpr int kNumThreads = 2;
+
+  MockClock clock_;
+  std::vector<std::string> certs_ = {std::string(kTestCertificate)};
+  VerifierState state_;
+  std::shared_ptr<ProofVerificationCache> cache_;
+  std::unique_ptr<CachingProofVerifier> verifier_;
+};
+
+TEST_F(CachingProofVerifierTest, CachesSuccessfulVerifications) {
+  Outcome miss;
+  EXPECT_EQ(QUIC_PENDING, Verify(kHostname, "ocsp", &miss));
+  EXPECT_FALSE(miss.done);
+  RunCallbacks(1);
+  EXPECT_TRUE(miss.ok);
+  ASSERT_NE(nullptr, miss.details);
+  EXPECT_EQ(kHostname,
+            static_cast<FakeDetails*>(miss.details.get())->hostname());
+
+  Outcome hit;
+  EXPECT_EQ(QUIC_SUCCESS, Verify(kHostname, "ocsp", &hit));
+  ASSERT_NE(nullptr, hit.details);
+  EXPECT_NE(miss.details.get(), hit.details.get());
+  EXPECT_EQ(kHostname,
+            static_cast<FakeDetails*>(hit.details.get())->hostname());
+
+  EXPECT_EQ(1, state_.verifications.load());
+  EXPECT_EQ(0u, verifier_->num_pending_callbacks());
+  ProofVerificationCache::Stats stats = cache_->GetStats();
+  EXPECT_EQ(1u, stats.hits);
+  EXPECT_EQ(1u, stats.misses);
+  EXPECT_EQ(1u, stats.verifications);
+  EXPECT_EQ(0.5, stats.hit_rate());
+}
+
+TEST_F(CachingProofVerifierTest, KeyCoversHostnameAndStaples) {
+  Outcome outcome;
+  EXPECT_EQ(QUIC_PENDING, Verify(kHostname, "ocsp", &outcome));
+  RunCallbacks(1);
+  // A new OCSP response, or another hostname, is verified again.
+  Outcome new_ocsp;
+  EXPECT_EQ(QUIC_PENDING, Verify(kHostname, "new ocsp", &new_ocsp));
+  Outcome other_hostname;
+  EXPECT_EQ(QUIC_PENDING, Verify("www.example.org", "ocsp", &other_hostname));
+  RunCallbacks(2);
+  EXPECT_TRUE(new_ocsp.ok);
+  EXPECT_TRUE(other_hostname.ok);
+  EXPECT_EQ(3, state_.verifications.load());
+  EXPECT_EQ(3u, cache_->Size());
+}
+
+TEST_F(CachingProofVerifierTest, DoesNotCacheFailures) {
+  for (int i = 0; i < 2; ++i) {
+    Outcome outcome;
+    EXPECT_EQ(QUIC_PENDING, Verify(kBadHostname, "ocsp", &outcome));
+    RunCallbacks(1);
+    EXPECT_FALSE(outcome.ok);
+    EXPECT_EQ("Untrusted chain", outcome.error_details);
+  }
+  EXPECT_EQ(2, state_.verifications.load());
+  EXPECT_EQ(2u, cache_->GetStats().failures);
+  EXPECT_EQ(0u, cache_->Size());
+}
+
+TEST_F(CachingProofVerifierTest, CoalescesConcurrentVerifications) {
+  state_.unblocked = std::make_unique<QuicNotification>();
+  Outcome outcomes[3];
+  for (Outcome& outcome : outcomes) {
+    EXPECT_EQ(QUIC_PENDING, Verify(kHostname, "ocsp", &outcome));
+  }
+  EXPECT_EQ(3u, verifier_->num_pending_callbacks());
+  state_.unblocked->Notify();
+  RunCallbacks(3);
+  for (const Outcome& outcome : outcomes) {
+    EXPECT_TRUE(outcome.ok);
+    EXPECT_NE(nullptr, outcome.details);
+  }
+  EXPECT_EQ(1, state_.verifications.load());
+  ProofVerificationCache::Stats stats = cache_->GetStats();
+  EXPECT_EQ(3u, stats.misses);
+  EXPECT_EQ(2u, stats.coalesced);
+}
+
+TEST_F(CachingProofVerifierTest, EntriesExpire) {
+  Outcome outcome;
+  EXPECT_EQ(QUIC_PENDING, Verify(kHostname, "ocsp", &outcome));
+  RunCallbacks(1);
+  clock_.AdvanceTime(kMaxAge - QuicTime::Delta::FromSeconds(1));
+  EXPECT_EQ(QUIC_SUCCESS, Verify(kHostname, "ocsp", &outcome));
+  clock_.AdvanceTime(QuicTime::Delta::FromSeconds(1));
+  EXPECT_EQ(QUIC_PENDING, Verify(kHostname, "ocsp", &outcome));
+  RunCallbacks(1);
+  EXPECT_EQ(2, state_.verifications.load());
+}
+
+TEST_F(CachingProofVerifierTest, SharedBetweenVerifiers) {
+  Outcome outcome;
+  EXPECT_EQ(QUIC_PENDING, Verify(kHostname, "ocsp", &outcome));
+  // A verifier destroyed with pending callbacks still fills the cache.
+  verifier_.reset();
+  while (cache_->GetStats().verifications == 0) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  verifier_ = std::make_unique<CachingProofVerifier>(cache_, nullptr);
+  EXPECT_EQ(QUIC_SUCCESS, Verify(kHostname, "ocsp", &outcome));
+  EXPECT_EQ(1, state_.verifications.load());
+}
+
+TEST_F(CachingProofVerifierTest, KeyCoversPolicy) {
+  auto strict_context = std::make_shared<FakeContext>();
+  CachingProofVerifyContext strict("strict", strict_context);
+  Outcome outcome;
+  EXPECT_EQ(QUIC_PENDING, Verify(kHostname, "ocsp", &outcome, &strict));
+  RunCallbacks(1);
+  EXPECT_TRUE(outcome.ok);
+  // The context of the caller is passed to the underlying verifier.
+  EXPECT_EQ(strict_context.get(), state_.last_context.load());
+  EXPECT_EQ(QUIC_SUCCESS, Verify(kHostname, "ocsp", &outcome, &strict));
+
+  // The same chain is verified again under another policy.
+  std::unique_ptr<ProofVerifyContext> default_context =
+      verifier_->CreateDefaultContext();
+  EXPECT_EQ(QUIC_PENDING,
+            Verify(kHostname, "ocsp", &outcome, default_context.get()));
+  RunCallbacks(1);
+  EXPECT_NE(nullptr, state_.last_context.load());
+  EXPECT_NE(strict_context.get(), state_.last_context.load());
+  EXPECT_EQ(QUIC_PENDING, Verify(kHostname, "ocsp", &outcome));
+  RunCallbacks(1);
+  EXPECT_EQ(nullptr, state_.last_context.load());
+  EXPECT_EQ(3, state_.verifications.load());
+}
+
+TEST_F(CachingProofVerifierTest, EachThreadHasItsOwnVerifier) {
+  // One for each worker thread, and one for VerifyProof().
+  EXPECT_EQ(kNumThreads + 1, state_.num_verifiers.load());
+  auto other_verifier = std::make_unique<CachingProofVerifier>(cache_, nullptr);
+  EXPECT_EQ(kNumThreads + 2, state_.num_verifiers.load());
+}
+
+TEST_F(CachingProofVerifierTest, EntriesExpireWithCertificate) {
+  AdvanceClockToCertificateExpiry(QuicTime::Delta::FromSeconds(10));
+  Outcome outcome;
+  EXPECT_EQ(QUIC_PENDING, Verify(kHostname, "ocsp", &outcome));
+  RunCallbacks(1);
+  clock_.AdvanceTime(QuicTime::Delta::FromSeconds(9));
+  EXPECT_EQ(QUIC_SUCCESS, Verify(kHostname, "ocsp", &outcome));
+  clock_.AdvanceTime(QuicTime::Delta::FromSeconds(1));
+  EXPECT_EQ(QUIC_PENDING, Verify(kHostname, "ocsp", &outcome));
+  RunCallbacks(1);
+  // Expired certificates are not cached at all.
+  EXPECT_EQ(0u, cache_->Size());
+}
+
+TEST_F(CachingProofVerifierTest, EntriesExpireWithOcspResponse) {
+  const std::string ocsp_response = OcspResponse(
+      clock_.WallNow().Add(QuicTime::Delta::FromSeconds(10)));
+  Outcome outcome;
+  EXPECT_EQ(QUIC_PENDING, Verify(kHostname, ocsp_response, &outcome));
+  RunCallbacks(1);
+  clock_.AdvanceTime(QuicTime::Delta::FromSeconds(9));
+  EXPECT_EQ(QUIC_SUCCESS, Verify(kHostname, ocsp_response, &outcome));
+  clock_.AdvanceTime(QuicTime::Delta::FromSeconds(1));
+  EXPECT_EQ(QUIC_PENDING, Verify(kHostname, ocsp_response, &outcome));
+  RunCallbacks(1);
+  EXPECT_EQ(2, state_.verifications.load());
+}
+
+TEST_F(CachingProofVerifierTest, DoesNotCacheUnparsableCertificates) {
+  certs_ = {"leaf", "intermediate"};
+  for (int i = 0; i < 2; ++i) {
+    Outcome outcome;
+    EXPECT_EQ(QUIC_PENDING, Verify(kHostname, "ocsp", &outcome));
+    RunCallbacks(1);
+    EXPECT_TRUE(outcome.ok);
+  }
+  EXPECT_EQ(2, state_.verifications.load());
+  EXPECT_EQ(0u, cache_->Size());
+}
+
+TEST_F(CachingProofVerifierTest, PassesQuicCryptoProofsThrough) {
+  std::string error_details;
+  std::unique_ptr<ProofVerifyDetails> details;
+  EXPECT_EQ(QUIC_FAILURE,
+            verifier_->VerifyProof(kHostname, 443, "server config",
+                                   QUIC_VERSION_46, "chlo hash", certs_, "sct",
+                                   "signature", nullptr, &error_details,
+                                   &details, nullptr));
+  EXPECT_EQ("QUIC crypto", error_details);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
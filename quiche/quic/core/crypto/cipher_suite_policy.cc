@@ -0,0 +1,183 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/crypto/cipher_suite_policy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "absl/base/attributes.h"
+#include "absl/strings/string_view.h"
+#include "openssl/aead.h"
+#include "openssl/ssl.h"
+#include "quiche/quic/core/crypto/aes_128_gcm_encrypter.h"
+#include "quiche/quic/core/crypto/chacha20_poly1305_tls_encrypter.h"
+#include "quiche/quic/core/crypto/quic_encrypter.h"
+#include "quiche/quic/core/quic_constants.h"
+#include "quiche/quic/core/quic_default_clock.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+namespace {
+
+constexpr int kRounds = 4;
+// Packets encrypted between two clock reads.
+constexpr int kPacketsPerBatch = 16;
+// The size of a sample of ciphertext for header protection.
+constexpr size_t kSampleSize = 16;
+// The length of a short header with a 4-byte packet number and an 8-byte
+// connection ID, which is the associated data of every packet.
+constexpr size_t kHeaderSize = 13;
+
+ABSL_CONST_INIT std::atomic<const AeadThroughput*> g_measured_throughput{
+    nullptr};
+
+// Protects |packet| with |encrypter| over and over for |duration|, and returns
+// the bytes of payload per second.
+double MeasureEncrypter(const QuicClock* clock, QuicEncrypter* encrypter,
+                        const std::string& packet, QuicTime::Delta duration,
+                        uint64_t* packet_number) {
+  const absl::string_view header(packet.data(), kHeaderSize);
+  const absl::string_view payload = absl::string_view(packet).substr(
+      kHeaderSize);
+  std::string ciphertext(encrypter->GetCiphertextSize(payload.size()), 0);
+  char mask[kSampleSize];
+  uint64_t bytes = 0;
+  const QuicTime start = clock->Now();
+  QuicTime now = start;
+  while (now - start < duration) {
+    for (int i = 0; i < kPacketsPerBatch; ++i) {
+      size_t ciphertext_length = 0;
+      if (!encrypter->EncryptPacket((*packet_number)++, header, payload,
+                                    &ciphertext[0], &ciphertext_length,
+                                    ciphertext.size()) ||
+          encrypter->GenerateHeaderProtectionMask(
+              absl::string_view(ciphertext.data(), kSampleSize), mask) == 0) {
+        QUIC_LOG(DFATAL) << "Failed to protect a packet";
+        return 0;
+      }
+      bytes += payload.size();
+    }
+    now = clock->Now();
+  }
+  return bytes * 1e6 / (now - start).ToMicroseconds();
+}
+
+std::unique_ptr<QuicEncrypter> CreateKeyedEncrypter(
+    std::unique_ptr<QuicEncrypter> encrypter) {
+  const std::string key(encrypter->GetKeySize(), 'k');
+  const std::string iv(encrypter->GetIVSize(), 'i');
+  if (!encrypter->SetKey(key) || !encrypter->SetIV(iv) ||
+      !encrypter->SetHeaderProtectionKey(key)) {
+    return nullptr;
+  }
+  return encrypter;
+}
+
+}  // namespace
+
+std::string CipherSuitePolicyToString(CipherSuitePolicy policy) {
+  switch (policy) {
+    case CipherSuitePolicy::kCpuFeatures:
+      return "cpu_features";
+    case CipherSuitePolicy::kPreferAesGcm:
+      return "prefer_aes_gcm";
+    case CipherSuitePolicy::kPreferChaCha20:
+      return "prefer_chacha20";
+    case CipherSuitePolicy::kMeasuredThroughput:
+      return "measured_throughput";
+  }
+  return "unknown";
+}
+
+AeadThroughput MeasureAeadThroughput(const QuicClock* clock,
+                                     size_t packet_size,
+                                     QuicTime::Delta duration) {
+  AeadThroughput throughput;
+  throughput.packet_size = packet_size;
+  // The ciphertext needs to cover the header protection sample.
+  const size_t payload_size =
+      packet_size > kHeaderSize + kSampleSize ? packet_size - kHeaderSize
+                                              : kSampleSize;
+  const std::string packet(kHeaderSize + payload_size, 'p');
+  std::unique_ptr<QuicEncrypter> aes_gcm =
+      CreateKeyedEncrypter(std::make_unique<Aes128GcmEncrypter>());
+  std::unique_ptr<QuicEncrypter> chacha20 =
+      CreateKeyedEncrypter(std::make_unique<ChaCha20Poly1305TlsEncrypter>());
+  if (aes_gcm == nullptr || chacha20 == nullptr) {
+    QUIC_LOG(DFATAL) << "Failed to key the AEADs";
+    return throughput;
+  }
+  const QuicTime::Delta round_duration = duration * (1.0 / kRounds);
+  uint64_t packet_number = 0;
+  for (int round = 0; round < kRounds; ++round) {
+    throughput.aes_128_gcm_bytes_per_second =
+        std::max(throughput.aes_128_gcm_bytes_per_second,
+                 MeasureEncrypter(clock, aes_gcm.get(), packet,
+                                  round_duration, &packet_number));
+    throughput.chacha20_poly1305_bytes_per_second =
+        std::max(throughput.chacha20_poly1305_bytes_per_second,
+                 MeasureEncrypter(clock, chacha20.get(), packet,
+                                  round_duration, &packet_number));
+  }
+  return throughput;
+}
+
+void InitializeMeasuredAeadThroughput() {
+  static const AeadThroughput* throughput = []() {
+    auto* measured = new AeadThroughput(
+        MeasureAeadThroughput(QuicDefaultClock::Get(), kDefaultMaxPacketSize,
+                              QuicTime::Delta::FromMilliseconds(20)));
+    QUIC_LOG(INFO) << "Measured AEAD throughput for "
+                   << measured->packet_size << " byte packets: AES-128-GCM "
+                   << measured->aes_128_gcm_bytes_per_second / 1e6
+                   << " MB/s, ChaCha20-Poly1305 "
+                   << measured->chacha20_poly1305_bytes_per_second / 1e6
+                   << " MB/s";
+    return measured;
+  }();
+  g_measured_throughput.store(throughput, std::memory_order_release);
+}
+
+const AeadThroughput* GetMeasuredAeadThroughput() {
+  return g_measured_throughput.load(std::memory_order_acquire);
+}
+
+bool CipherSuitePolicyPrefersAesGcm(CipherSuitePolicy policy) {
+  switch (policy) {
+    case CipherSuitePolicy::kCpuFeatures:
+      return EVP_has_aes_hardware() == 1;
+    case CipherSuitePolicy::kPreferAesGcm:
+      return true;
+    case CipherSuitePolicy::kPreferChaCha20:
+      return false;
+    case CipherSuitePolicy::kMeasuredThroughput: {
+      const AeadThroughput* throughput = GetMeasuredAeadThroughput();
+      if (throughput == nullptr) {
+        QUIC_LOG_FIRST_N(WARNING, 1)
+            << "AEAD throughput not measured, preferring AES-GCM if the CPU "
+               "has AES instructions";
+        return EVP_has_aes_hardware() == 1;
+      }
+      return throughput->AesGcmIsFaster();
+    }
+  }
+  return true;
+}
+
+void ApplyCipherSuitePolicy(CipherSuitePolicy policy, SSL_CTX* ssl_ctx) {
+  if (policy == CipherSuitePolicy::kCpuFeatures) {
+    return;
+  }
+  // The TLS 1.3 cipher suites, which are the only ones QUIC uses, cannot be
+  // ordered with a cipher list. BoringSSL picks ChaCha20-Poly1305 if the CPU
+  // has no AES instructions, so that is what the policy overrides.
+  SSL_CTX_set_aes_hw_override_for_testing(
+      ssl_ctx, CipherSuitePolicyPrefersAesGcm(policy) ? 1 : 0);
+}
+
+}  // namespace quic
@@ -0,0 +1,80 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_CRYPTO_CIPHER_SUITE_POLICY_H_
+#define QUICHE_QUIC_CORE_CRYPTO_CIPHER_SUITE_POLICY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "openssl/base.h"
+#include "quiche/quic/core/quic_clock.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// Which AEAD a TLS server prefers for the packet protection of its
+// connections, when the client offers both AES-GCM and ChaCha20-Poly1305.
+enum class CipherSuitePolicy : uint8_t {
+  // BoringSSL's default, which prefers AES-GCM if the CPU has AES
+  // instructions.
+  kCpuFeatures,
+  kPreferAesGcm,
+  kPreferChaCha20,
+  // Prefers whichever of the two encrypts packets faster on this CPU, as
+  // measured once per process by InitializeMeasuredAeadThroughput().
+  kMeasuredThroughput,
+};
+
+QUIC_EXPORT_PRIVATE std::string CipherSuitePolicyToString(
+    CipherSuitePolicy policy);
+
+// Packet protection throughput of the AEADs of QUIC version 1, including the
+// header protection mask of every packet.
+struct QUIC_EXPORT_PRIVATE AeadThroughput {
+  size_t packet_size = 0;
+  double aes_128_gcm_bytes_per_second = 0;
+  double chacha20_poly1305_bytes_per_second = 0;
+
+  bool AesGcmIsFaster() const {
+    return aes_128_gcm_bytes_per_second >= chacha20_poly1305_bytes_per_second;
+  }
+};
+
+// Protects packets of |packet_size| bytes of header and payload with
+// Aes128GcmEncrypter and ChaCha20Poly1305TlsEncrypter for |duration| each,
+// split over a few alternating rounds so that frequency scaling affects both
+// alike. Returns the payload throughput of the best round of each.
+QUIC_EXPORT_PRIVATE AeadThroughput MeasureAeadThroughput(
+    const QuicClock* clock, size_t packet_size, QuicTime::Delta duration);
+
+// Measures the throughput for full-sized packets which kMeasuredThroughput
+// chooses by, which takes about 20 ms. Servers call this at startup, before
+// they create SSL_CTXs, so that no handshake waits for it. Only the first call
+// measures. Thread safe.
+QUIC_EXPORT_PRIVATE void InitializeMeasuredAeadThroughput();
+
+// Returns the throughput measured by InitializeMeasuredAeadThroughput(), or
+// nullptr if it has not been called. Thread safe.
+QUIC_EXPORT_PRIVATE const AeadThroughput* GetMeasuredAeadThroughput();
+
+// Returns true if |policy| prefers AES-GCM on this CPU. Before the throughput
+// is measured, kMeasuredThroughput falls back to kCpuFeatures.
+QUIC_EXPORT_PRIVATE bool CipherSuitePolicyPrefersAesGcm(
+    CipherSuitePolicy policy);
+
+// Makes the TLS 1.3 servers using |ssl_ctx| choose their AEAD as |policy|
+// prefers, by overriding whether BoringSSL believes the CPU has AES
+// instructions. Without them, servers pick ChaCha20-Poly1305 whenever the
+// client offers it. With them, servers pick the first AEAD the client offers,
+// which is AES-GCM for clients that have AES instructions too. Leaves the
+// library's choice for kCpuFeatures.
+QUIC_EXPORT_PRIVATE void ApplyCipherSuitePolicy(CipherSuitePolicy policy,
+                                                SSL_CTX* ssl_ctx);
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_CRYPTO_CIPHER_SUITE_POLICY_H_
@@ -0,0 +1,158 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/crypto/cipher_suite_policy.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "openssl/ssl.h"
+#include "quiche/quic/core/crypto/quic_compressed_certs_cache.h"
+#include "quiche/quic/core/crypto/quic_crypto_client_config.h"
+#include "quiche/quic/core/crypto/quic_crypto_server_config.h"
+#include "quiche/quic/core/crypto/quic_random.h"
+#include "quiche/quic/core/quic_default_clock.h"
+#include "quiche/quic/core/quic_server_id.h"
+#include "quiche/quic/core/quic_versions.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/crypto_test_utils.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+
+using testing::_;
+using testing::AnyNumber;
+using testing::Return;
+
+namespace quic {
+namespace test {
+namespace {
+
+constexpr QuicTime::Delta kDuration = QuicTime::Delta::FromMilliseconds(4);
+
+TEST(CipherSuitePolicyTest, MeasuresBothAeads) {
+  for (size_t packet_size : {1u, 50u, 1250u}) {
+    const AeadThroughput throughput =
+        MeasureAeadThroughput(QuicDefaultClock::Get(), packet_size, kDuration);
+    EXPECT_EQ(packet_size, throughput.packet_size);
+    EXPECT_GT(throughput.aes_128_gcm_bytes_per_second, 0);
+    EXPECT_GT(throughput.chacha20_poly1305_bytes_per_second, 0);
+  }
+}
+
+TEST(CipherSuitePolicyTest, FasterAeadWins) {
+  AeadThroughput throughput;
+  throughput.aes_128_gcm_bytes_per_second = 2e9;
+  throughput.chacha20_poly1305_bytes_per_second = 1e9;
+  EXPECT_TRUE(throughput.AesGcmIsFaster());
+  throughput.chacha20_poly1305_bytes_per_second = 3e9;
+  EXPECT_FALSE(throughput.AesGcmIsFaster());
+}
+
+TEST(CipherSuitePolicyTest, PrefersAesGcm) {
+  EXPECT_TRUE(CipherSuitePolicyPrefersAesGcm(CipherSuitePolicy::kPreferAesGcm));
+  EXPECT_FALSE(
+      CipherSuitePolicyPrefersAesGcm(CipherSuitePolicy::kPreferChaCha20));
+  // The measurement is taken once, so the policy is stable.
+  InitializeMeasuredAeadThroughput();
+  const AeadThroughput* throughput = GetMeasuredAeadThroughput();
+  ASSERT_NE(nullptr, throughput);
+  EXPECT_EQ(throughput->AesGcmIsFaster(),
+            CipherSuitePolicyPrefersAesGcm(
+                CipherSuitePolicy::kMeasuredThroughput));
+  InitializeMeasuredAeadThroughput();
+  EXPECT_EQ(throughput, GetMeasuredAeadThroughput());
+  EXPECT_EQ("measured_throughput",
+            CipherSuitePolicyToString(CipherSuitePolicy::kMeasuredThroughput));
+}
+
+#if QUIC_TLS_SESSION
+// Handshakes between a client which offers AES-GCM first, as BoringSSL does on
+// CPUs with AES instructions, and a server with a policy.
+class CipherSuitePolicyHandshakeTest : public QuicTest {
+ protected:
+  CipherSuitePolicyHandshakeTest()
+      : server_crypto_config_(QuicCryptoServerConfig::TESTING,
+                              QuicRandom::GetInstance(),
+                              crypto_test_utils::ProofSourceForTesting(),
+                              KeyExchangeSource::Default(),
+                              /*tls_session=*/true),
+        client_crypto_config_(crypto_test_utils::ProofVerifierForTesting(),
+                              /*tls_session=*/true),
+        compressed_certs_cache_(
+            QuicCompressedCertsCache::kQuicCompressedCertsCacheSize) {
+    SSL_CTX_set_aes_hw_override_for_testing(client_crypto_config_.ssl_ctx(),
+                                            1);
+  }
+
+  // Returns the TLS cipher suite which the handshake negotiated.
+  uint16_t Handshake(CipherSuitePolicy policy) {
+    server_crypto_config_.set_cipher_suite_policy(policy);
+
+    const ParsedQuicVersionVector versions = {ParsedQuicVersion::RFCv1()};
+    const QuicServerId server_id(
+        crypto_test_utils::CertificateHostnameForTesting(), 443,
+        /*privacy_mode_enabled=*/false);
+    const QuicTime::Delta start_time = QuicTime::Delta::FromSeconds(100000);
+
+    PacketSavingConnection* client_connection;
+    TestQuicSpdyClientSession* client_session;
+    CreateClientSessionForTest(server_id, start_time, versions, &helper_,
+                               &alarm_factory_, &client_crypto_config_,
+                               &client_connection, &client_session);
+    std::unique_ptr<TestQuicSpdyClientSession> client_owner(client_session);
+    EXPECT_CALL(*client_session, GetAlpnsToOffer())
+        .WillRepeatedly(
+            Return(std::vector<std::string>({AlpnForVersion(versions[0])})));
+    EXPECT_CALL(*client_session, OnProofValid(_)).Times(AnyNumber());
+    EXPECT_CALL(*client_session, OnProofVerifyDetailsAvailable(_))
+        .Times(AnyNumber());
+
+    PacketSavingConnection* server_connection;
+    TestQuicSpdyServerSession* server_session;
+    CreateServerSessionForTest(server_id, start_time, versions, &helper_,
+                               &alarm_factory_, &server_crypto_config_,
+                               &compressed_certs_cache_, &server_connection,
+                               &server_session);
+    std::unique_ptr<TestQuicSpdyServerSession> server_owner(server_session);
+    EXPECT_CALL(*server_session, SelectAlpn(_))
+        .WillRepeatedly([](const std::vector<absl::string_view>& alpns) {
+          return alpns.cbegin();
+        });
+
+    client_session->GetMutableCryptoStream()->CryptoConnect();
+    crypto_test_utils::CommunicateHandshakeMessages(
+        client_connection, client_session->GetMutableCryptoStream(),
+        server_connection, server_session->GetMutableCryptoStream());
+    EXPECT_TRUE(client_session->GetCryptoStream()->one_rtt_keys_available());
+    const uint16_t cipher_suite =
+        server_session->GetCryptoStream()->crypto_negotiated_params()
+            .cipher_suite;
+    EXPECT_EQ(cipher_suite,
+              client_session->GetCryptoStream()->crypto_negotiated_params()
+                  .cipher_suite);
+    return cipher_suite;
+  }
+
+  MockQuicConnectionHelper helper_;
+  MockAlarmFactory alarm_factory_;
+  QuicCryptoServerConfig server_crypto_config_;
+  QuicCryptoClientConfig client_crypto_config_;
+  QuicCompressedCertsCache compressed_certs_cache_;
+};
+
+TEST_F(CipherSuitePolicyHandshakeTest, PreferChaCha20) {
+  EXPECT_EQ(TLS1_CK_CHACHA20_POLY1305_SHA256 & 0xffff,
+            Handshake(CipherSuitePolicy::kPreferChaCha20));
+}
+
+TEST_F(CipherSuitePolicyHandshakeTest, PreferAesGcm) {
+  EXPECT_EQ(TLS1_CK_AES_128_GCM_SHA256 & 0xffff,
+            Handshake(CipherSuitePolicy::kPreferAesGcm));
+}
+#endif  // QUIC_TLS_SESSION
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
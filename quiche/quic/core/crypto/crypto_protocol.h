@@ -204,6 +204,12 @@ const QuicTag kAFF1 = TAG('A', 'F', 'F', '1');   // Use SRTT in building
                                                  // AckFrequencyFrame.
 const QuicTag kAFF2 = TAG('A', 'F', 'F', '2');   // Send AckFrequencyFrame upon
                                                  // handshake completion.
+const QuicTag kAFF3 = TAG('A', 'F', 'F', '3');   // Scale the packet tolerance
+                                                 // of AckFrequencyFrame with
+                                                 // the congestion window.
+const QuicTag kAKDB = TAG('A', 'K', 'D', 'B');   // Ack decimation for bulk
+                                                 // transfers: up to 64 packets
+                                                 // and one ack per read burst.
 const QuicTag kSSLR = TAG('S', 'S', 'L', 'R');   // Slow Start Large Reduction.
 const QuicTag kNPRR = TAG('N', 'P', 'R', 'R');   // Pace at unity instead of PRR
 const QuicTag k5RTO = TAG('5', 'R', 'T', 'O');   // Close connection on 5 RTOs
@@ -237,6 +243,9 @@ const QuicTag kILD4 = TAG('I', 'L', 'D', '4');   // IETF style loss detection
                                                  // threshold
 const QuicTag kRUNT = TAG('R', 'U', 'N', 'T');   // No packet threshold loss
                                                  // detection for "runt" packet.
+const QuicTag kRACK = TAG('R', 'A', 'C', 'K');   // RACK-TLP loss detection
+                                                 // with per path reorder
+                                                 // window.
 const QuicTag kNSTP = TAG('N', 'S', 'T', 'P');   // No stop waiting frames.
 const QuicTag kNRTT = TAG('N', 'R', 'T', 'T');   // Ignore initial RTT
 
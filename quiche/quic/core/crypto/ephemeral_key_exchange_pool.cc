@@ -0,0 +1,134 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/crypto/ephemeral_key_exchange_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "quiche/quic/platform/api/quic_flags.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+class EphemeralKeyExchangePool::RefillThread : public QuicThread {
+ public:
+  explicit RefillThread(EphemeralKeyExchangePool* pool)
+      : QuicThread("KeyExchangeRefill"), pool_(pool) {}
+
+ protected:
+  void Run() override {
+    while (pool_->WaitForRefill()) {
+      pool_->Refill();
+    }
+  }
+
+ private:
+  EphemeralKeyExchangePool* pool_;
+};
+
+EphemeralKeyExchangePool::EphemeralKeyExchangePool(const QuicTagVector& types,
+                                                   size_t capacity,
+                                                   QuicRandom* rand)
+    : types_(types),
+      capacity_(capacity),
+      low_water_mark_(std::max<size_t>(capacity / 2, 1)),
+      rand_(rand) {}
+
+EphemeralKeyExchangePool::~EphemeralKeyExchangePool() {
+  if (refill_thread_ != nullptr) {
+    {
+      absl::MutexLock lock(&mutex_);
+      stopping_ = true;
+      refill_needed_.Signal();
+    }
+    refill_thread_->Join();
+  }
+}
+
+// static
+EphemeralKeyExchangePool* EphemeralKeyExchangePool::GetProcessWideInstance() {
+  static EphemeralKeyExchangePool* pool = []() {
+    const int32_t capacity = GetQuicFlag(quic_server_key_exchange_pool_size);
+    if (capacity <= 0) {
+      return static_cast<EphemeralKeyExchangePool*>(nullptr);
+    }
+    auto* pool = new EphemeralKeyExchangePool(
+        {kC255, kP256}, capacity, QuicRandom::GetInstance());
+    pool->StartRefillThread();
+    return pool;
+  }();
+  return pool;
+}
+
+std::unique_ptr<SynchronousKeyExchange> EphemeralKeyExchangePool::Take(
+    QuicTag type) {
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = pool_.find(type);
+    if (it != pool_.end() && !it->second.empty()) {
+      std::unique_ptr<SynchronousKeyExchange> key_exchange =
+          std::move(it->second.front());
+      it->second.pop_front();
+      if (it->second.size() < low_water_mark_) {
+        refill_needed_.Signal();
+      }
+      return key_exchange;
+    }
+    refill_needed_.Signal();
+  }
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  return CreateLocalSynchronousKeyExchange(type, rand_);
+}
+
+size_t EphemeralKeyExchangePool::Refill() {
+  size_t generated = 0;
+  for (QuicTag type : types_) {
+    while (Size(type) < capacity_) {
+      // Key pairs are generated without holding the lock, so that Take() is
+      // never blocked behind an ECDHE key generation.
+      std::unique_ptr<SynchronousKeyExchange> key_exchange =
+          CreateLocalSynchronousKeyExchange(type, rand_);
+      if (key_exchange == nullptr) {
+        break;
+      }
+      ++generated;
+      absl::MutexLock lock(&mutex_);
+      pool_[type].push_back(std::move(key_exchange));
+    }
+  }
+  return generated;
+}
+
+bool EphemeralKeyExchangePool::WaitForRefill() {
+  absl::MutexLock lock(&mutex_);
+  while (!stopping_ && !NeedsRefill()) {
+    refill_needed_.Wait(&mutex_);
+  }
+  return !stopping_;
+}
+
+bool EphemeralKeyExchangePool::NeedsRefill() const {
+  for (QuicTag type : types_) {
+    auto it = pool_.find(type);
+    if (it == pool_.end() || it->second.size() < low_water_mark_) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void EphemeralKeyExchangePool::StartRefillThread() {
+  QUICHE_DCHECK(refill_thread_ == nullptr);
+  refill_thread_ = std::make_unique<RefillThread>(this);
+  refill_thread_->Start();
+}
+
+size_t EphemeralKeyExchangePool::Size(QuicTag type) const {
+  absl::MutexLock lock(&mutex_);
+  auto it = pool_.find(type);
+  return it == pool_.end() ? 0 : it->second.size();
+}
+
+}  // namespace quic
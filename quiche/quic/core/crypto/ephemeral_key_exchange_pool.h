@@ -0,0 +1,99 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_CRYPTO_EPHEMERAL_KEY_EXCHANGE_POOL_H_
+#define QUICHE_QUIC_CORE_CRYPTO_EPHEMERAL_KEY_EXCHANGE_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "quiche/quic/core/crypto/key_exchange.h"
+#include "quiche/quic/core/crypto/quic_random.h"
+#include "quiche/quic/core/quic_tag.h"
+#include "quiche/quic/platform/api/quic_export.h"
+#include "quiche/quic/platform/api/quic_thread.h"
+
+namespace quic {
+
+// A pool of pre-generated ephemeral key pairs for the forward secure key
+// exchange of the QUIC crypto server handshake, which takes one of its three
+// elliptic curve operations off the handshake path. The pool is refilled by a
+// background thread once it falls below half its capacity, and falls back to
+// generating a key pair inline when it runs dry.
+//
+// Only QUIC crypto handshakes use the pool. TLS 1.3 handshakes, which this
+// tree builds with QUIC_TLS_SESSION, get their key shares from BoringSSL,
+// which generates them inside SSL_do_handshake() and cannot be handed
+// pre-generated ones.
+//
+// Thread safe. Each key pair is handed out at most once.
+class QUIC_EXPORT_PRIVATE EphemeralKeyExchangePool {
+ public:
+  // Keeps up to |capacity| key pairs of each of |types|, generated from
+  // |rand|, which must be thread safe and outlive the pool.
+  EphemeralKeyExchangePool(const QuicTagVector& types, size_t capacity,
+                           QuicRandom* rand);
+  EphemeralKeyExchangePool(const EphemeralKeyExchangePool&) = delete;
+  EphemeralKeyExchangePool& operator=(const EphemeralKeyExchangePool&) =
+      delete;
+  // Stops the refill thread, if any.
+  ~EphemeralKeyExchangePool();
+
+  // Returns the process-wide pool for C255 and P256 with its refill thread
+  // running, or nullptr if --quic_server_key_exchange_pool_size is zero.
+  static EphemeralKeyExchangePool* GetProcessWideInstance();
+
+  // Returns a key exchange of |type| with a fresh key pair. Never returns the
+  // same key pair twice. Returns nullptr if |type| is not supported. Wakes up
+  // the refill thread when the pool of |type| falls below the low-water mark.
+  std::unique_ptr<SynchronousKeyExchange> Take(QuicTag type);
+
+  // Generates key pairs until the pool is full, and returns how many were
+  // generated.
+  size_t Refill();
+
+  // Starts a thread which calls Refill() whenever the pool falls below the
+  // low-water mark, until the pool is destroyed.
+  void StartRefillThread();
+
+  size_t Size(QuicTag type) const;
+  // Number of Take() calls which had to generate a key pair inline.
+  uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+ private:
+  class RefillThread;
+
+  // Blocks until a pool is below the low-water mark or the pool is stopping.
+  // Returns false in the latter case.
+  bool WaitForRefill();
+  bool NeedsRefill() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const QuicTagVector types_;
+  const size_t capacity_;
+  const size_t low_water_mark_;
+  QuicRandom* rand_;
+
+  // An absl::Mutex rather than a QuicMutex, for |refill_needed_|.
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<QuicTag,
+                      std::deque<std::unique_ptr<SynchronousKeyExchange>>>
+      pool_ ABSL_GUARDED_BY(mutex_);
+  std::atomic<uint64_t> misses_{0};
+
+  // Signaled when a pool falls below |low_water_mark_| or the pool is
+  // stopping.
+  absl::CondVar refill_needed_;
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+  std::unique_ptr<RefillThread> refill_thread_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_CRYPTO_EPHEMERAL_KEY_EXCHANGE_POOL_H_
@@ -0,0 +1,91 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/crypto/ephemeral_key_exchange_pool.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "quiche/quic/core/crypto/crypto_protocol.h"
+#include "quiche/quic/platform/api/quic_test.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+constexpr size_t kCapacity = 8;
+
+class EphemeralKeyExchangePoolTest : public QuicTest {
+ protected:
+  EphemeralKeyExchangePoolTest()
+      : pool_({kC255, kP256}, kCapacity, QuicRandom::GetInstance()) {}
+
+  EphemeralKeyExchangePool pool_;
+};
+
+TEST_F(EphemeralKeyExchangePoolTest, TakesPregeneratedKeys) {
+  EXPECT_EQ(2 * kCapacity, pool_.Refill());
+  EXPECT_EQ(kCapacity, pool_.Size(kC255));
+  EXPECT_EQ(kCapacity, pool_.Size(kP256));
+  EXPECT_EQ(0u, pool_.Refill());
+
+  absl::flat_hash_set<std::string> public_values;
+  for (size_t i = 0; i < kCapacity; ++i) {
+    std::unique_ptr<SynchronousKeyExchange> key_exchange = pool_.Take(kC255);
+    ASSERT_NE(nullptr, key_exchange);
+    EXPECT_EQ(kC255, key_exchange->type());
+    EXPECT_TRUE(
+        public_values.insert(std::string(key_exchange->public_value())).second);
+  }
+  EXPECT_EQ(0u, pool_.Size(kC255));
+  EXPECT_EQ(kCapacity, pool_.Size(kP256));
+  EXPECT_EQ(0u, pool_.misses());
+
+  // An empty pool still hands out fresh key pairs.
+  std::unique_ptr<SynchronousKeyExchange> key_exchange = pool_.Take(kC255);
+  ASSERT_NE(nullptr, key_exchange);
+  EXPECT_TRUE(
+      public_values.insert(std::string(key_exchange->public_value())).second);
+  EXPECT_EQ(1u, pool_.misses());
+}
+
+TEST_F(EphemeralKeyExchangePoolTest, KeysAgree) {
+  pool_.Refill();
+  for (QuicTag type : {kC255, kP256}) {
+    std::unique_ptr<SynchronousKeyExchange> server = pool_.Take(type);
+    std::unique_ptr<SynchronousKeyExchange> client =
+        CreateLocalSynchronousKeyExchange(type, QuicRandom::GetInstance());
+    std::string server_shared_key, client_shared_key;
+    ASSERT_TRUE(server->CalculateSharedKeySync(client->public_value(),
+                                               &server_shared_key));
+    ASSERT_TRUE(client->CalculateSharedKeySync(server->public_value(),
+                                               &client_shared_key));
+    EXPECT_EQ(server_shared_key, client_shared_key);
+  }
+}
+
+TEST_F(EphemeralKeyExchangePoolTest, RefillThread) {
+  pool_.StartRefillThread();
+  for (int i = 0; i < 1000 && pool_.Size(kP256) < kCapacity; ++i) {
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  EXPECT_EQ(kCapacity, pool_.Size(kC255));
+  EXPECT_EQ(kCapacity, pool_.Size(kP256));
+
+  // Taking keys below the low-water mark wakes the thread up again.
+  for (size_t i = 0; i < kCapacity; ++i) {
+    pool_.Take(kC255);
+  }
+  for (int i = 0; i < 1000 && pool_.Size(kC255) < kCapacity; ++i) {
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  EXPECT_EQ(kCapacity, pool_.Size(kC255));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
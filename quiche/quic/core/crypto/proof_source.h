@@ -235,6 +235,26 @@ class QUIC_EXPORT_PRIVATE ProofSource {
   // the ProofSource, and the caller does not take ownership of said
   // TicketCrypter.
   virtual TicketCrypter* GetTicketCrypter() = 0;
+
+  // EarlyDataReplayCache tracks the session tickets which were used to send
+  // 0-RTT data recently, so that a server can refuse early data replayed by an
+  // attacker. It may be shared between server processes which share ticket
+  // keys.
+  class QUIC_EXPORT_PRIVATE EarlyDataReplayCache {
+   public:
+    virtual ~EarlyDataReplayCache() = default;
+
+    // Records that early data was offered with the encrypted session ticket
+    // |ticket|. Returns false if |ticket| may have been used for early data
+    // before, in which case early data must be rejected. False positives only
+    // cost a round trip.
+    virtual bool CheckAndInsert(absl::string_view ticket) = 0;
+  };
+
+  // Returns the EarlyDataReplayCache consulted before accepting early data, or
+  // nullptr if early data is accepted without replay protection. Like the
+  // TicketCrypter, it must outlive the ProofSource.
+  virtual EarlyDataReplayCache* GetEarlyDataReplayCache() { return nullptr; }
 };
 
 // ProofSourceHandleCallback is an interface that contains the callbacks when
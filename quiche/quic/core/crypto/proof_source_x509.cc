@@ -109,7 +109,11 @@ QuicSignatureAlgorithmVector ProofSourceX509::SupportedTlsSignatureAlgorithms()
 }
 
 ProofSource::TicketCrypter* ProofSourceX509::GetTicketCrypter() {
-  return nullptr;
+  return ticket_crypter_.get();
+}
+
+ProofSource::EarlyDataReplayCache* ProofSourceX509::GetEarlyDataReplayCache() {
+  return replay_cache_.get();
 }
 
 bool ProofSourceX509::AddCertificateChain(
@@ -7,6 +7,7 @@
 
 #include <forward_list>
 #include <memory>
+#include <utility>
 
 #include "absl/base/attributes.h"
 #include "absl/container/node_hash_map.h"
@@ -45,6 +46,17 @@ class QUIC_EXPORT_PRIVATE ProofSourceX509 final: public ProofSource {
       std::unique_ptr<SignatureCallback> callback) override;
   QuicSignatureAlgorithmVector SupportedTlsSignatureAlgorithms() const override;
   TicketCrypter* GetTicketCrypter() override;
+  EarlyDataReplayCache* GetEarlyDataReplayCache() override;
+
+  // Sets the TicketCrypter used for TLS resumption. Resumption is disabled
+  // until this is called.
+  void SetTicketCrypter(std::unique_ptr<TicketCrypter> ticket_crypter) {
+    ticket_crypter_ = std::move(ticket_crypter);
+  }
+  void SetEarlyDataReplayCache(
+      std::unique_ptr<EarlyDataReplayCache> replay_cache) {
+    replay_cache_ = std::move(replay_cache);
+  }
 
   // Adds a certificate chain to the verifier.  Returns false if the chain is
   // not valid.  Newer certificates will override older certificates with the
@@ -77,6 +89,8 @@ class QUIC_EXPORT_PRIVATE ProofSourceX509 final: public ProofSource {
   std::forward_list<Certificate> certificates_;
   Certificate* default_certificate_ = nullptr;
   absl::node_hash_map<std::string, Certificate*> certificate_map_;
+  std::unique_ptr<TicketCrypter> ticket_crypter_;
+  std::unique_ptr<EarlyDataReplayCache> replay_cache_;
 };
 
 }  // namespace quic
@@ -5,6 +5,8 @@
 #include "quiche/quic/core/crypto/quic_crypto_server_config.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
 #include <string>
@@ -152,6 +154,12 @@ std::string FormatCryptoHandshakeMessageForTrace(
   return s;
 }
 
+// Returns a snapshot generation that no QuicCryptoServerConfig has used yet.
+uint64_t NextSnapshotGeneration() {
+  static std::atomic<uint64_t> next_generation{1};
+  return next_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
 }  // namespace
 
 // static
@@ -278,10 +286,11 @@ QuicCryptoServerConfig::QuicCryptoServerConfig(
     : replay_protection_(true),
       chlo_multiplier_(kMultiplier),
       configs_lock_(),
-      primary_config_(nullptr),
-      next_config_promotion_time_(QuicWallTime::Zero()),
+      snapshot_(std::make_shared<ConfigSnapshot>()),
+      snapshot_generation_(NextSnapshotGeneration()),
       proof_source_(std::move(proof_source)),
       key_exchange_source_(std::move(key_exchange_source)),
+      key_exchange_pool_(EphemeralKeyExchangePool::GetProcessWideInstance()),
 #if QUIC_TLS_SESSION //hybchanged
       ssl_ctx_(tls_session ? TlsServerConnection::CreateSslCtx(proof_source_.get()) : nullptr),
 #endif
@@ -447,18 +456,21 @@ std::unique_ptr<CryptoHandshakeMessage> QuicCryptoServerConfig::AddConfig(
 
   {
     QuicWriterMutexLock locked(&configs_lock_);
-    if (configs_.find(config->id) != configs_.end()) {
+    auto snapshot = std::make_unique<ConfigSnapshot>(*snapshot_);
+    if (snapshot->configs.find(config->id) != snapshot->configs.end()) {
       QUIC_LOG(WARNING) << "Failed to add config because another with the same "
                            "server config id already exists: "
                         << absl::BytesToHexString(config->id);
       return nullptr;
     }
 
-    configs_[config->id] = config;
-    SelectNewPrimaryConfig(now);
-    QUICHE_DCHECK(primary_config_.get());
-    QUICHE_DCHECK_EQ(configs_.find(primary_config_->id)->second.get(),
-                     primary_config_.get());
+    snapshot->configs[config->id] = config;
+    SelectNewPrimaryConfig(now, snapshot.get());
+    QUICHE_DCHECK(snapshot->primary.get());
+    QUICHE_DCHECK_EQ(
+        snapshot->configs.find(snapshot->primary->id)->second.get(),
+        snapshot->primary.get());
+    PublishSnapshot(std::move(snapshot));
   }
 
   return msg;
@@ -510,13 +522,26 @@ bool QuicCryptoServerConfig::SetConfigs(
   QUIC_LOG(INFO) << "Updating configs:";
 
   QuicWriterMutexLock locked(&configs_lock_);
-  ConfigMap new_configs;
+  std::shared_ptr<const ConfigSnapshot> old_snapshot = snapshot_;
+  auto snapshot = std::make_unique<ConfigSnapshot>();
+  snapshot->primary = old_snapshot->primary;
 
   for (const quiche::QuicheReferenceCountedPointer<Config>& config :
        parsed_configs) {
-    auto it = configs_.find(config->id);
-    if (it != configs_.end()) {
+    auto it = old_snapshot->configs.find(config->id);
+    if (it != old_snapshot->configs.end() &&
+        it->second->primary_time == config->primary_time &&
+        it->second->priority == config->priority) {
       QUIC_LOG(INFO) << "Keeping scid: " << absl::BytesToHexString(config->id)
+                     << " orbit: "
+                     << absl::BytesToHexString(absl::string_view(
+                            reinterpret_cast<const char*>(config->orbit),
+                            kOrbitSize));
+      snapshot->configs.insert(*it);
+    } else if (it != old_snapshot->configs.end()) {
+      // The old config may be in use by readers of the current snapshot, so it
+      // is replaced by the newly parsed one rather than updated.
+      QUIC_LOG(INFO) << "Updating scid: " << absl::BytesToHexString(config->id)
                      << " orbit: "
                      << absl::BytesToHexString(absl::string_view(
                             reinterpret_cast<const char*>(config->orbit),
@@ -527,10 +552,7 @@ bool QuicCryptoServerConfig::SetConfigs(
                      << it->second->primary_time.ToUNIXSeconds()
                      << " new priority " << config->priority << " old priority "
                      << it->second->priority;
-      // Update primary_time and priority.
-      it->second->primary_time = config->primary_time;
-      it->second->priority = config->priority;
-      new_configs.insert(*it);
+      snapshot->configs.emplace(config->id, config);
     } else {
       QUIC_LOG(INFO) << "Adding scid: " << absl::BytesToHexString(config->id)
                      << " orbit: "
@@ -539,16 +561,16 @@ bool QuicCryptoServerConfig::SetConfigs(
                             kOrbitSize))
                      << " primary_time " << config->primary_time.ToUNIXSeconds()
                      << " priority " << config->priority;
-      new_configs.emplace(config->id, config);
+      snapshot->configs.emplace(config->id, config);
     }
   }
 
-  configs_ = std::move(new_configs);
-  fallback_config_ = fallback_config;
-  SelectNewPrimaryConfig(now);
-  QUICHE_DCHECK(primary_config_.get());
-  QUICHE_DCHECK_EQ(configs_.find(primary_config_->id)->second.get(),
-                   primary_config_.get());
+  snapshot->fallback = fallback_config;
+  SelectNewPrimaryConfig(now, snapshot.get());
+  QUICHE_DCHECK(snapshot->primary.get());
+  QUICHE_DCHECK_EQ(snapshot->configs.find(snapshot->primary->id)->second.get(),
+                   snapshot->primary.get());
+  PublishSnapshot(std::move(snapshot));
 
   return true;
 }
@@ -565,9 +587,10 @@ void QuicCryptoServerConfig::SetServerNonceKeys(const std::string_view keys) {
 }
 
 std::vector<std::string> QuicCryptoServerConfig::GetConfigIds() const {
-  QuicReaderMutexLock locked(&configs_lock_);
+  const ConfigSnapshot& snapshot = LoadSnapshot();
   std::vector<std::string> scids;
-  for (auto it = configs_.begin(); it != configs_.end(); ++it) {
+  for (auto it = snapshot.configs.begin(); it != snapshot.configs.end();
+       ++it) {
     scids.push_back(it->first);
   }
   return scids;
@@ -1022,7 +1045,10 @@ void QuicCryptoServerConfig::ProcessClientHelloAfterCalculateSharedKeys(
 
   std::string forward_secure_public_value;
   std::unique_ptr<SynchronousKeyExchange> forward_secure_key_exchange =
-      CreateLocalSynchronousKeyExchange(key_exchange_type, context->rand());
+      key_exchange_pool_ != nullptr
+          ? key_exchange_pool_->Take(key_exchange_type)
+          : CreateLocalSynchronousKeyExchange(key_exchange_type,
+                                              context->rand());
   if (!forward_secure_key_exchange) {
     QUIC_DLOG(WARNING) << "Failed to create keypair";
     context->Fail(QUIC_INVALID_CRYPTO_MESSAGE_PARAMETER,
@@ -1122,13 +1148,11 @@ void QuicCryptoServerConfig::SendRejectWithFallbackConfigAfterGetProof(
 }
 
 quiche::QuicheReferenceCountedPointer<QuicCryptoServerConfig::Config>
-QuicCryptoServerConfig::GetConfigWithScid(
-    absl::string_view requested_scid) const {
-  configs_lock_.AssertReaderHeld();
-
+QuicCryptoServerConfig::GetConfigWithScid(const ConfigSnapshot& snapshot,
+                                          absl::string_view requested_scid) {
   if (!requested_scid.empty()) {
-    auto it = configs_.find((std::string(requested_scid)));
-    if (it != configs_.end()) {
+    auto it = snapshot.configs.find((std::string(requested_scid)));
+    if (it != snapshot.configs.end()) {
       // We'll use the config that the client requested in order to do
       // key-agreement.
       return quiche::QuicheReferenceCountedPointer<Config>(it->second);
@@ -1142,30 +1166,38 @@ bool QuicCryptoServerConfig::GetCurrentConfigs(
     const QuicWallTime& now, absl::string_view requested_scid,
     quiche::QuicheReferenceCountedPointer<Config> old_primary_config,
     Configs* configs) const {
-  QuicReaderMutexLock locked(&configs_lock_);
+  const ConfigSnapshot* snapshot = &LoadSnapshot();
 
-  if (!primary_config_) {
+  if (!snapshot->primary) {
     return false;
   }
 
-  if (IsNextConfigReady(now)) {
-    configs_lock_.ReaderUnlock();
-    configs_lock_.WriterLock();
-    SelectNewPrimaryConfig(now);
-    QUICHE_DCHECK(primary_config_.get());
-    QUICHE_DCHECK_EQ(configs_.find(primary_config_->id)->second.get(),
-                     primary_config_.get());
-    configs_lock_.WriterUnlock();
-    configs_lock_.ReaderLock();
+  // Keeps the promoted snapshot alive until the end of this call.
+  std::shared_ptr<const ConfigSnapshot> promoted_snapshot;
+  if (IsNextConfigReady(now, *snapshot)) {
+    QuicWriterMutexLock locked(&configs_lock_);
+    // Another thread may have promoted the next config in the meantime.
+    promoted_snapshot = snapshot_;
+    if (IsNextConfigReady(now, *promoted_snapshot)) {
+      auto new_snapshot = std::make_shared<ConfigSnapshot>(*promoted_snapshot);
+      SelectNewPrimaryConfig(now, new_snapshot.get());
+      QUICHE_DCHECK(new_snapshot->primary.get());
+      QUICHE_DCHECK_EQ(
+          new_snapshot->configs.find(new_snapshot->primary->id)->second.get(),
+          new_snapshot->primary.get());
+      PublishSnapshot(new_snapshot);
+      promoted_snapshot = std::move(new_snapshot);
+    }
+    snapshot = promoted_snapshot.get();
   }
 
   if (old_primary_config != nullptr) {
     configs->primary = old_primary_config;
   } else {
-    configs->primary = primary_config_;
+    configs->primary = snapshot->primary;
   }
-  configs->requested = GetConfigWithScid(requested_scid);
-  configs->fallback = fallback_config_;
+  configs->requested = GetConfigWithScid(*snapshot, requested_scid);
+  configs->fallback = snapshot->fallback;
 
   return true;
 }
@@ -1189,18 +1221,45 @@ bool QuicCryptoServerConfig::ConfigPrimaryTimeLessThan(
   }
 }
 
+const QuicCryptoServerConfig::ConfigSnapshot&
+QuicCryptoServerConfig::LoadSnapshot() const {
+  // The last snapshot this thread loaded. Holding it keeps it alive even if
+  // it has been replaced or its QuicCryptoServerConfig destroyed since.
+  struct CachedSnapshot {
+    uint64_t generation = 0;
+    std::shared_ptr<const ConfigSnapshot> snapshot;
+  };
+  static thread_local CachedSnapshot cached;
+
+  if (cached.generation !=
+      snapshot_generation_.load(std::memory_order_acquire)) {
+    QuicReaderMutexLock locked(&configs_lock_);
+    cached.generation = snapshot_generation_.load(std::memory_order_relaxed);
+    cached.snapshot = snapshot_;
+  }
+  return *cached.snapshot;
+}
+
+void QuicCryptoServerConfig::PublishSnapshot(
+    std::shared_ptr<const ConfigSnapshot> snapshot) const {
+  snapshot_ = std::move(snapshot);
+  snapshot_generation_.store(NextSnapshotGeneration(),
+                             std::memory_order_release);
+}
+
 void QuicCryptoServerConfig::SelectNewPrimaryConfig(
-    const QuicWallTime now) const {
+    const QuicWallTime now, ConfigSnapshot* snapshot) const {
   absl::InlinedVector<quiche::QuicheReferenceCountedPointer<Config>, 1> configs;
-  //configs.reserve(configs_.size());
+  //configs.reserve(snapshot->configs.size());
 
-  for (auto it = configs_.begin(); it != configs_.end(); ++it) {
+  for (auto it = snapshot->configs.begin(); it != snapshot->configs.end();
+       ++it) {
     // TODO(avd) Exclude expired configs?
     configs.push_back(it->second);
   }
 
   if (configs.empty()) {
-    if (primary_config_ != nullptr) {
+    if (snapshot->primary != nullptr) {
       QUIC_BUG(quic_bug_10630_2)
           << "No valid QUIC server config. Keeping the current config.";
     } else {
@@ -1224,31 +1283,27 @@ void QuicCryptoServerConfig::SelectNewPrimaryConfig(
 
     // This is the first config with a primary_time in the future. Thus the
     // previous Config should be the primary and this one should determine the
-    // next_config_promotion_time_.
+    // snapshot->next_config_promotion_time.
     quiche::QuicheReferenceCountedPointer<Config> new_primary = best_candidate;
     if (i == 0) {
       // We need the primary_time of the next config.
       if (configs.size() > 1) {
-        next_config_promotion_time_ = configs[1]->primary_time;
+        snapshot->next_config_promotion_time = configs[1]->primary_time;
       } else {
-        next_config_promotion_time_ = QuicWallTime::Zero();
+        snapshot->next_config_promotion_time = QuicWallTime::Zero();
       }
     } else {
-      next_config_promotion_time_ = config->primary_time;
+      snapshot->next_config_promotion_time = config->primary_time;
     }
 
-    if (primary_config_) {
-      primary_config_->is_primary = false;
-    }
-    primary_config_ = new_primary;
-    new_primary->is_primary = true;
+    snapshot->primary = new_primary;
     QUIC_DLOG(INFO) << "New primary config.  orbit: "
                     << absl::BytesToHexString(
                            absl::string_view(reinterpret_cast<const char*>(
-                                                 primary_config_->orbit),
+                                                 snapshot->primary->orbit),
                                              kOrbitSize));
     if (primary_config_changed_cb_ != nullptr) {
-      primary_config_changed_cb_->Run(primary_config_->id);
+      primary_config_changed_cb_->Run(snapshot->primary->id);
     }
 
     return;
@@ -1257,19 +1312,15 @@ void QuicCryptoServerConfig::SelectNewPrimaryConfig(
   // All config's primary times are in the past. We should make the most recent
   // and highest priority candidate primary.
   quiche::QuicheReferenceCountedPointer<Config> new_primary = best_candidate;
-  if (primary_config_) {
-    primary_config_->is_primary = false;
-  }
-  primary_config_ = new_primary;
-  new_primary->is_primary = true;
+  snapshot->primary = new_primary;
   QUIC_DLOG(INFO) << "New primary config.  orbit: "
                   << absl::BytesToHexString(absl::string_view(
-                         reinterpret_cast<const char*>(primary_config_->orbit),
+                         reinterpret_cast<const char*>(new_primary->orbit),
                          kOrbitSize))
-                  << " scid: " << absl::BytesToHexString(primary_config_->id);
-  next_config_promotion_time_ = QuicWallTime::Zero();
+                  << " scid: " << absl::BytesToHexString(new_primary->id);
+  snapshot->next_config_promotion_time = QuicWallTime::Zero();
   if (primary_config_changed_cb_ != nullptr) {
-    primary_config_changed_cb_->Run(primary_config_->id);
+    primary_config_changed_cb_->Run(snapshot->primary->id);
   }
 }
 
@@ -1382,10 +1433,10 @@ void QuicCryptoServerConfig::BuildServerConfigUpdateMessage(
   std::string serialized;
   std::string source_address_token;
   {
-    QuicReaderMutexLock locked(&configs_lock_);
-    serialized = primary_config_->serialized;
+    const ConfigSnapshot& snapshot = LoadSnapshot();
+    serialized = snapshot.primary->serialized;
     source_address_token = NewSourceAddressToken(
-        *primary_config_->source_address_token_boxer,
+        *snapshot.primary->source_address_token_boxer,
         previous_source_address_tokens, client_address.host(), rand,
         clock->WallNow(), cached_network_params);
   }
@@ -1787,8 +1838,7 @@ std::string QuicCryptoServerConfig::NewSourceAddressToken(
 }
 
 int QuicCryptoServerConfig::NumberOfConfigs() const {
-  QuicReaderMutexLock locked(&configs_lock_);
-  return configs_.size();
+  return LoadSnapshot().configs.size();
 }
 
 ProofSource* QuicCryptoServerConfig::proof_source() const {
@@ -1801,6 +1851,12 @@ SSL_CTX* QuicCryptoServerConfig::ssl_ctx() const { return ssl_ctx_.get(); }
 SSL_CTX* QuicCryptoServerConfig::ssl_ctx() const { return nullptr; }
 #endif
 
+void QuicCryptoServerConfig::set_cipher_suite_policy(CipherSuitePolicy policy) {
+  if (ssl_ctx() != nullptr) {
+    ApplyCipherSuitePolicy(policy, ssl_ctx());
+  }
+}
+
 HandshakeFailureReason QuicCryptoServerConfig::ParseSourceAddressToken(
     const CryptoSecretBoxer& crypto_secret_boxer, absl::string_view token,
     SourceAddressTokens& tokens) const {
@@ -1910,14 +1966,15 @@ bool QuicCryptoServerConfig::ValidateExpectedLeafCertificate(
   return CryptoUtils::ComputeLeafCertHash(certs.at(0)) == hash_from_client;
 }
 
-bool QuicCryptoServerConfig::IsNextConfigReady(QuicWallTime now) const {
-  return !next_config_promotion_time_.IsZero() &&
-         !next_config_promotion_time_.IsAfter(now);
+// static
+bool QuicCryptoServerConfig::IsNextConfigReady(QuicWallTime now,
+                                               const ConfigSnapshot& snapshot) {
+  return !snapshot.next_config_promotion_time.IsZero() &&
+         !snapshot.next_config_promotion_time.IsAfter(now);
 }
 
 QuicCryptoServerConfig::Config::Config()
     : channel_id_enabled(false),
-      is_primary(false),
       primary_time(QuicWallTime::Zero()),
       expiry_time(QuicWallTime::Zero()),
       priority(0),
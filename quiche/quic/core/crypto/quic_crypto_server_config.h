@@ -5,6 +5,7 @@
 #ifndef QUICHE_QUIC_CORE_CRYPTO_QUIC_CRYPTO_SERVER_CONFIG_H_
 #define QUICHE_QUIC_CORE_CRYPTO_QUIC_CRYPTO_SERVER_CONFIG_H_
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <map>
@@ -14,10 +15,12 @@
 
 #include "absl/strings/string_view.h"
 #include "openssl/base.h"
+#include "quiche/quic/core/crypto/cipher_suite_policy.h"
 #include "quiche/quic/core/crypto/crypto_handshake.h"
 #include "quiche/quic/core/crypto/crypto_handshake_message.h"
 #include "quiche/quic/core/crypto/crypto_protocol.h"
 #include "quiche/quic/core/crypto/crypto_secret_boxer.h"
+#include "quiche/quic/core/crypto/ephemeral_key_exchange_pool.h"
 #include "quiche/quic/core/crypto/key_exchange.h"
 #include "quiche/quic/core/crypto/proof_source.h"
 #include "quiche/quic/core/crypto/quic_compressed_certs_cache.h"
@@ -442,12 +445,23 @@ class QUIC_EXPORT_PRIVATE QuicCryptoServerConfig {
 
   SSL_CTX* ssl_ctx() const;
 
+  // Overrides --quic_tls_server_cipher_suite_policy for the TLS handshakes
+  // which use this config. Clients of QUIC crypto choose the AEAD themselves.
+  void set_cipher_suite_policy(CipherSuitePolicy policy);
+
   // Pre-shared key used during the handshake.
   const std::string& pre_shared_key() const { return pre_shared_key_; }
   void set_pre_shared_key(absl::string_view psk) {
     pre_shared_key_ = std::string(psk);
   }
 
+  // Pool of pre-generated key pairs for the forward secure key exchange, or
+  // nullptr to generate them during the handshake. Defaults to
+  // EphemeralKeyExchangePool::GetProcessWideInstance().
+  void set_key_exchange_pool(EphemeralKeyExchangePool* key_exchange_pool) {
+    key_exchange_pool_ = key_exchange_pool;
+  }
+
   bool pad_rej() const { return pad_rej_; }
   void set_pad_rej(bool new_value) { pad_rej_ = new_value; }
 
@@ -463,7 +477,9 @@ class QUIC_EXPORT_PRIVATE QuicCryptoServerConfig {
   friend struct QuicSignedServerConfig;
 
   // Config represents a server config: a collection of preferences and
-  // Diffie-Hellman public values.
+  // Diffie-Hellman public values. A Config is not modified once it is in a
+  // published ConfigSnapshot, since readers of that snapshot may use it
+  // concurrently.
   class QUIC_EXPORT_PRIVATE Config : public QuicCryptoConfig,
                                      public quiche::QuicheReferenceCounted {
    public:
@@ -490,10 +506,6 @@ class QUIC_EXPORT_PRIVATE QuicCryptoServerConfig {
     // ChannelIDs are supported.
     bool channel_id_enabled;
 
-    // is_primary is true if this config is the one that we'll give out to
-    // clients as the current one.
-    bool is_primary;
-
     // primary_time contains the timestamp when this config should become the
     // primary config. A value of QuicWallTime::Zero() means that this config
     // will not be promoted at a specific time.
@@ -525,10 +537,46 @@ class QUIC_EXPORT_PRIVATE QuicCryptoServerConfig {
   using ConfigMap =
       std::map<ServerConfigID, quiche::QuicheReferenceCountedPointer<Config>>;
 
+  // An immutable view of the loaded configs. Writers hold |configs_lock_|
+  // while they build a new snapshot and publish it. Each reader thread keeps
+  // a reference to the last snapshot it saw, and only takes |configs_lock_|
+  // again once a newer one is published, so that the dispatcher threads
+  // sharing a QuicCryptoServerConfig do not contend on CHLOs. A replaced
+  // snapshot is freed once every thread that saw it has moved on.
+  //
+  // |configs| satisfies the following invariants:
+  //   1) configs.empty() <-> primary == nullptr
+  //   2) primary != nullptr -> primary is in configs
+  struct QUIC_EXPORT_PRIVATE ConfigSnapshot {
+    // All active server configs. It's expected that there are about
+    // half-a-dozen configs active at any one time.
+    ConfigMap configs;
+    // The config (which is also in |configs|) that we'll give out to new
+    // clients.
+    quiche::QuicheReferenceCountedPointer<Config> primary;
+    // The config (which is also in |configs|) which will be used if the other
+    // configs are unuseable for some reason.
+    //
+    // TODO(b/112548056): This is currently always nullptr.
+    quiche::QuicheReferenceCountedPointer<Config> fallback;
+    // The nearest, future time when an active config will be promoted to
+    // primary.
+    QuicWallTime next_config_promotion_time = QuicWallTime::Zero();
+  };
+
+  // Returns the current snapshot. The reference stays valid until the calling
+  // thread calls LoadSnapshot() again, on any QuicCryptoServerConfig. Must not
+  // be called with |configs_lock_| held; writers use |snapshot_| directly.
+  const ConfigSnapshot& LoadSnapshot() const
+      QUIC_LOCKS_EXCLUDED(configs_lock_);
+
+  // Makes |snapshot| the current snapshot.
+  void PublishSnapshot(std::shared_ptr<const ConfigSnapshot> snapshot) const
+      QUIC_EXCLUSIVE_LOCKS_REQUIRED(configs_lock_);
+
   // Get a ref to the config with a given server config id.
-  quiche::QuicheReferenceCountedPointer<Config> GetConfigWithScid(
-      absl::string_view requested_scid) const
-      QUIC_SHARED_LOCKS_REQUIRED(configs_lock_);
+  static quiche::QuicheReferenceCountedPointer<Config> GetConfigWithScid(
+      const ConfigSnapshot& snapshot, absl::string_view requested_scid);
 
   // A snapshot of the configs associated with an in-progress handshake.
   struct QUIC_EXPORT_PRIVATE Configs {
@@ -554,9 +602,10 @@ class QUIC_EXPORT_PRIVATE QuicCryptoServerConfig {
       const quiche::QuicheReferenceCountedPointer<Config>& a,
       const quiche::QuicheReferenceCountedPointer<Config>& b);
 
-  // SelectNewPrimaryConfig reevaluates the primary config based on the
-  // "primary_time" deadlines contained in each.
-  void SelectNewPrimaryConfig(QuicWallTime now) const
+  // SelectNewPrimaryConfig reevaluates the primary config of |snapshot|, which
+  // is not published yet, based on the "primary_time" deadlines contained in
+  // each config.
+  void SelectNewPrimaryConfig(QuicWallTime now, ConfigSnapshot* snapshot) const
       QUIC_EXCLUSIVE_LOCKS_REQUIRED(configs_lock_);
 
   // EvaluateClientHello checks |client_hello_state->client_hello| for gross
@@ -830,9 +879,9 @@ class QUIC_EXPORT_PRIVATE QuicCryptoServerConfig {
       CryptoHandshakeMessage message,
       std::unique_ptr<BuildServerConfigUpdateMessageResultCallback> cb) const;
 
-  // Returns true if the next config promotion should happen now.
-  bool IsNextConfigReady(QuicWallTime now) const
-      QUIC_SHARED_LOCKS_REQUIRED(configs_lock_);
+  // Returns true if the next config promotion of |snapshot| should happen now.
+  static bool IsNextConfigReady(QuicWallTime now,
+                                const ConfigSnapshot& snapshot);
 
   // replay_protection_ controls whether the server enforces that handshakes
   // aren't replays.
@@ -843,33 +892,18 @@ class QUIC_EXPORT_PRIVATE QuicCryptoServerConfig {
   // used to protect QUIC from amplification attacks.
   size_t chlo_multiplier_;
 
-  // configs_ satisfies the following invariants:
-  //   1) configs_.empty() <-> primary_config_ == nullptr
-  //   2) primary_config_ != nullptr -> primary_config_->is_primary
-  //   3) ∀ c∈configs_, c->is_primary <-> c == primary_config_
+  // Serializes the writers of |snapshot_|. Readers only take it when
+  // |snapshot_generation_| has changed since their last LoadSnapshot().
   mutable QuicMutex configs_lock_;
 
-  // configs_ contains all active server configs. It's expected that there are
-  // about half-a-dozen configs active at any one time.
-  ConfigMap configs_ QUIC_GUARDED_BY(configs_lock_);
-
-  // primary_config_ points to a Config (which is also in |configs_|) which is
-  // the primary config - i.e. the one that we'll give out to new clients.
-  mutable quiche::QuicheReferenceCountedPointer<Config> primary_config_
+  // The current snapshot. Never nullptr.
+  mutable std::shared_ptr<const ConfigSnapshot> snapshot_
       QUIC_GUARDED_BY(configs_lock_);
 
-  // fallback_config_ points to a Config (which is also in |configs_|) which is
-  // the fallback config, which will be used if the other configs are unuseable
-  // for some reason.
-  //
-  // TODO(b/112548056): This is currently always nullptr.
-  quiche::QuicheReferenceCountedPointer<Config> fallback_config_
-      QUIC_GUARDED_BY(configs_lock_);
-
-  // next_config_promotion_time_ contains the nearest, future time when an
-  // active config will be promoted to primary.
-  mutable QuicWallTime next_config_promotion_time_
-      QUIC_GUARDED_BY(configs_lock_);
+  // Identifies |snapshot_|. Generations are unique across all instances, so
+  // that a reader never mistakes the snapshot of a destroyed instance for
+  // the one of a new instance at the same address.
+  mutable std::atomic<uint64_t> snapshot_generation_;
 
   // Callback to invoke when the primary config changes.
   std::unique_ptr<PrimaryConfigChangedCallback> primary_config_changed_cb_
@@ -895,6 +929,9 @@ class QUIC_EXPORT_PRIVATE QuicCryptoServerConfig {
   // objects.
   std::unique_ptr<KeyExchangeSource> key_exchange_source_;
 
+  // Not owned.
+  EphemeralKeyExchangePool* key_exchange_pool_;
+
 #if QUIC_TLS_SESSION //hybchanged
   // ssl_ctx_ contains the server configuration for doing TLS handshakes.
   bssl::UniquePtr<SSL_CTX> ssl_ctx_;
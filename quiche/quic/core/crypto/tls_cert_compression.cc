@@ -0,0 +1,159 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/crypto/tls_cert_compression.h"
+
+#include <memory>
+#include <utility>
+
+#include "openssl/sha.h"
+#include "quiche/quic/platform/api/quic_bug_tracker.h"
+#include "quiche/quic/platform/api/quic_flags.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+#include "zlib.h"
+
+namespace quic {
+
+// static
+void TlsCertCompression::RegisterAlgorithms(SSL_CTX* ssl_ctx) {
+  if (!GetQuicFlag(quic_enable_tls_cert_compression)) {
+    return;
+  }
+  if (!SSL_CTX_add_cert_compression_alg(ssl_ctx, TLSEXT_cert_compression_zlib,
+                                        &ZlibCompressCallback,
+                                        &ZlibDecompressCallback)) {
+    QUIC_BUG(quic_bug_tls_cert_compression_registration)
+        << "Failed to register zlib certificate compression";
+  }
+}
+
+// static
+bool TlsCertCompression::ZlibCompress(absl::string_view in, std::string* out) {
+  uLongf compressed_size = compressBound(in.size());
+  out->resize(compressed_size);
+  if (compress2(reinterpret_cast<Bytef*>(&(*out)[0]), &compressed_size,
+                reinterpret_cast<const Bytef*>(in.data()), in.size(),
+                Z_BEST_COMPRESSION) != Z_OK) {
+    out->clear();
+    return false;
+  }
+  out->resize(compressed_size);
+  return true;
+}
+
+// static
+bool TlsCertCompression::ZlibDecompress(absl::string_view in,
+                                        size_t uncompressed_length,
+                                        std::string* out) {
+  if (uncompressed_length == 0 ||
+      uncompressed_length > kMaxUncompressedLength) {
+    return false;
+  }
+  out->resize(uncompressed_length);
+  uLongf decompressed_size = uncompressed_length;
+  // uncompress() fails with Z_BUF_ERROR if the output does not fit, so a peer
+  // cannot make us inflate more than |uncompressed_length| bytes.
+  if (uncompress(reinterpret_cast<Bytef*>(&(*out)[0]), &decompressed_size,
+                 reinterpret_cast<const Bytef*>(in.data()),
+                 in.size()) != Z_OK ||
+      decompressed_size != uncompressed_length) {
+    out->clear();
+    return false;
+  }
+  return true;
+}
+
+// static
+int TlsCertCompression::ZlibCompressCallback(SSL* /*ssl*/, CBB* out,
+                                             const uint8_t* in,
+                                             size_t in_len) {
+  absl::string_view certificate_message(reinterpret_cast<const char*>(in),
+                                        in_len);
+  TlsCompressedCertsCache* cache = TlsCompressedCertsCache::GetInstance();
+  absl::optional<std::string> compressed =
+      cache->Lookup(TLSEXT_cert_compression_zlib, certificate_message);
+  if (!compressed.has_value()) {
+    std::string result;
+    if (!ZlibCompress(certificate_message, &result)) {
+      // Returning 0 makes BoringSSL send the chain uncompressed.
+      return 0;
+    }
+    cache->Insert(TLSEXT_cert_compression_zlib, certificate_message, result);
+    compressed = std::move(result);
+  }
+  return CBB_add_bytes(out,
+                       reinterpret_cast<const uint8_t*>(compressed->data()),
+                       compressed->size());
+}
+
+// static
+int TlsCertCompression::ZlibDecompressCallback(SSL* /*ssl*/,
+                                               CRYPTO_BUFFER** out,
+                                               size_t uncompressed_len,
+                                               const uint8_t* in,
+                                               size_t in_len) {
+  std::string decompressed;
+  if (!ZlibDecompress(
+          absl::string_view(reinterpret_cast<const char*>(in), in_len),
+          uncompressed_len, &decompressed)) {
+    QUIC_DLOG(INFO) << "Failed to decompress certificate of claimed length "
+                    << uncompressed_len;
+    return 0;
+  }
+  *out = CRYPTO_BUFFER_new(reinterpret_cast<const uint8_t*>(decompressed.data()),
+                           decompressed.size(), nullptr);
+  return *out != nullptr;
+}
+
+TlsCompressedCertsCache::TlsCompressedCertsCache(size_t max_entries)
+    : cache_(max_entries) {}
+
+// static
+TlsCompressedCertsCache* TlsCompressedCertsCache::GetInstance() {
+  static TlsCompressedCertsCache* cache =
+      new TlsCompressedCertsCache(kDefaultMaxEntries);
+  return cache;
+}
+
+// static
+std::string TlsCompressedCertsCache::Key(
+    uint16_t algorithm, absl::string_view certificate_message) {
+  std::string key(2 + SHA256_DIGEST_LENGTH, '\0');
+  key[0] = static_cast<char>(algorithm >> 8);
+  key[1] = static_cast<char>(algorithm & 0xff);
+  SHA256(reinterpret_cast<const uint8_t*>(certificate_message.data()),
+         certificate_message.size(), reinterpret_cast<uint8_t*>(&key[2]));
+  return key;
+}
+
+absl::optional<std::string> TlsCompressedCertsCache::Lookup(
+    uint16_t algorithm, absl::string_view certificate_message) {
+  std::string key = Key(algorithm, certificate_message);
+  QuicWriterMutexLock lock(&mutex_);
+  auto it = cache_.Lookup(key);
+  if (it == cache_.end()) {
+    return absl::nullopt;
+  }
+  return *it->second;
+}
+
+void TlsCompressedCertsCache::Insert(uint16_t algorithm,
+                                     absl::string_view certificate_message,
+                                     std::string compressed) {
+  std::string key = Key(algorithm, certificate_message);
+  QuicWriterMutexLock lock(&mutex_);
+  cache_.Insert(key, std::make_unique<std::string>(std::move(compressed)));
+}
+
+size_t TlsCompressedCertsCache::Size() const {
+  QuicReaderMutexLock lock(&mutex_);
+  return cache_.Size();
+}
+
+void TlsCompressedCertsCache::Clear() {
+  QuicWriterMutexLock lock(&mutex_);
+  cache_.Clear();
+}
+
+}  // namespace quic
@@ -0,0 +1,88 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_CRYPTO_TLS_CERT_COMPRESSION_H_
+#define QUICHE_QUIC_CORE_CRYPTO_TLS_CERT_COMPRESSION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "openssl/ssl.h"
+#include "quiche/quic/core/quic_lru_cache.h"
+#include "quiche/quic/platform/api/quic_export.h"
+#include "quiche/quic/platform/api/quic_mutex.h"
+
+namespace quic {
+
+// TlsCertCompression implements RFC 8879 certificate compression for the TLS
+// 1.3 handshake. Without it the server's Certificate message carries the full
+// chain, which is often large enough to push the server's first flight past
+// the anti-amplification limit and cost a round trip.
+//
+// Only zlib (algorithm 1) is supported, since it is the only compression
+// library this tree depends on. The compressed form of a chain is
+// deterministic, so servers keep it in a process-wide cache instead of
+// compressing the same chain on every handshake, similar to what
+// QuicCompressedCertsCache does for QUIC crypto.
+class QUIC_EXPORT_PRIVATE TlsCertCompression {
+ public:
+  // Largest Certificate message a peer may claim to have compressed.
+  static constexpr size_t kMaxUncompressedLength = 128 * 1024;
+
+  // Registers the compression and decompression callbacks on |ssl_ctx|, if
+  // --quic_enable_tls_cert_compression is true.
+  static void RegisterAlgorithms(SSL_CTX* ssl_ctx);
+
+  // Compresses the Certificate message |in| with zlib. Returns false on
+  // failure.
+  static bool ZlibCompress(absl::string_view in, std::string* out);
+
+  // Decompresses |in| into |out|, which must then be exactly
+  // |uncompressed_length| bytes long. Returns false otherwise.
+  static bool ZlibDecompress(absl::string_view in, size_t uncompressed_length,
+                             std::string* out);
+
+ private:
+  static int ZlibCompressCallback(SSL* ssl, CBB* out, const uint8_t* in,
+                                  size_t in_len);
+  static int ZlibDecompressCallback(SSL* ssl, CRYPTO_BUFFER** out,
+                                    size_t uncompressed_len, const uint8_t* in,
+                                    size_t in_len);
+};
+
+// A thread safe cache of compressed Certificate messages, keyed by the
+// compression algorithm and the SHA-256 hash of the uncompressed message.
+class QUIC_EXPORT_PRIVATE TlsCompressedCertsCache {
+ public:
+  static constexpr size_t kDefaultMaxEntries = 225;
+
+  explicit TlsCompressedCertsCache(size_t max_entries);
+  TlsCompressedCertsCache(const TlsCompressedCertsCache&) = delete;
+  TlsCompressedCertsCache& operator=(const TlsCompressedCertsCache&) = delete;
+
+  // Returns the process-wide cache used by the compression callback.
+  static TlsCompressedCertsCache* GetInstance();
+
+  absl::optional<std::string> Lookup(uint16_t algorithm,
+                                     absl::string_view certificate_message);
+  void Insert(uint16_t algorithm, absl::string_view certificate_message,
+              std::string compressed);
+
+  size_t Size() const;
+  void Clear();
+
+ private:
+  static std::string Key(uint16_t algorithm,
+                         absl::string_view certificate_message);
+
+  mutable QuicMutex mutex_;
+  QuicLRUCache<std::string, std::string> cache_ QUIC_GUARDED_BY(mutex_);
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_CRYPTO_TLS_CERT_COMPRESSION_H_
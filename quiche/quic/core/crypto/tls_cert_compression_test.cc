@@ -0,0 +1,305 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/crypto/tls_cert_compression.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "quiche/quic/core/crypto/certificate_view.h"
+#include "quiche/quic/core/crypto/proof_source_x509.h"
+#include "quiche/quic/core/crypto/proof_verifier.h"
+#include "quiche/quic/core/crypto/quic_compressed_certs_cache.h"
+#include "quiche/quic/core/crypto/quic_crypto_client_config.h"
+#include "quiche/quic/core/crypto/quic_crypto_server_config.h"
+#include "quiche/quic/core/crypto/quic_random.h"
+#include "quiche/quic/core/quic_server_id.h"
+#include "quiche/quic/core/quic_versions.h"
+#include "quiche/quic/platform/api/quic_flags.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/crypto_test_utils.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+#include "quiche/quic/test_tools/test_certificates.h"
+
+using testing::_;
+using testing::AnyNumber;
+using testing::Return;
+
+namespace quic {
+namespace test {
+namespace {
+
+void AppendUint24(size_t value, std::string* out) {
+  out->push_back(static_cast<char>((value >> 16) & 0xff));
+  out->push_back(static_cast<char>((value >> 8) & 0xff));
+  out->push_back(static_cast<char>(value & 0xff));
+}
+
+// Returns a TLS 1.3 Certificate handshake message carrying |chain|.
+std::string CertificateMessage(const std::vector<std::string>& chain) {
+  std::string entries;
+  for (const std::string& certificate : chain) {
+    AppendUint24(certificate.size(), &entries);
+    entries.append(certificate);
+    // No extensions.
+    entries.append(2, '\0');
+  }
+  std::string body;
+  // Empty certificate_request_context.
+  body.push_back('\0');
+  AppendUint24(entries.size(), &body);
+  body.append(entries);
+
+  std::string message;
+  message.push_back(11);  // certificate
+  AppendUint24(body.size(), &message);
+  message.append(body);
+  return message;
+}
+
+std::vector<std::string> ReadPemChain(const char* pem) {
+  std::vector<std::string> chain;
+  std::stringstream stream(pem);
+  for (;;) {
+    PemReadResult result = ReadNextPemMessage(&stream);
+    if (result.status != PemReadResult::kOk) {
+      break;
+    }
+    chain.push_back(result.contents);
+  }
+  return chain;
+}
+
+std::vector<std::string> TestChain() {
+  std::vector<std::string> chain = ReadPemChain(kTestCertificateChainPem);
+  chain.push_back(std::string(kWildcardCertificate));
+  return chain;
+}
+
+class TlsCertCompressionTest : public QuicTest {};
+
+TEST_F(TlsCertCompressionTest, RoundTrip) {
+  const std::string message = CertificateMessage(TestChain());
+  std::string compressed;
+  ASSERT_TRUE(TlsCertCompression::ZlibCompress(message, &compressed));
+  EXPECT_LT(compressed.size(), message.size());
+
+  std::string decompressed;
+  ASSERT_TRUE(TlsCertCompression::ZlibDecompress(compressed, message.size(),
+                                                 &decompressed));
+  EXPECT_EQ(message, decompressed);
+}
+
+TEST_F(TlsCertCompressionTest, RejectsWrongLength) {
+  const std::string message = CertificateMessage(TestChain());
+  std::string compressed;
+  ASSERT_TRUE(TlsCertCompression::ZlibCompress(message, &compressed));
+
+  std::string decompressed;
+  EXPECT_FALSE(TlsCertCompression::ZlibDecompress(
+      compressed, message.size() - 1, &decompressed));
+  EXPECT_FALSE(TlsCertCompression::ZlibDecompress(
+      compressed, message.size() + 1, &decompressed));
+  EXPECT_FALSE(TlsCertCompression::ZlibDecompress(
+      compressed, TlsCertCompression::kMaxUncompressedLength + 1,
+      &decompressed));
+  EXPECT_FALSE(
+      TlsCertCompression::ZlibDecompress("garbage", 100, &decompressed));
+}
+
+TEST_F(TlsCertCompressionTest, Cache) {
+  TlsCompressedCertsCache cache(/*max_entries=*/1);
+  const std::string message = CertificateMessage(TestChain());
+  EXPECT_FALSE(cache.Lookup(TLSEXT_cert_compression_zlib, message));
+
+  cache.Insert(TLSEXT_cert_compression_zlib, message, "compressed");
+  EXPECT_EQ("compressed", cache.Lookup(TLSEXT_cert_compression_zlib, message));
+  EXPECT_FALSE(cache.Lookup(TLSEXT_cert_compression_brotli, message));
+
+  const std::string other =
+      CertificateMessage({std::string(kWildcardCertificate)});
+  cache.Insert(TLSEXT_cert_compression_zlib, other, "other");
+  EXPECT_EQ(1u, cache.Size());
+  EXPECT_FALSE(cache.Lookup(TLSEXT_cert_compression_zlib, message));
+}
+
+#if QUIC_TLS_SESSION
+// Accepts the production sized chain, whatever the hostname.
+class ProductionSizedChainVerifier : public ProofVerifier {
+ public:
+  class Details : public ProofVerifyDetails {
+   public:
+    ProofVerifyDetails* Clone() const override { return new Details(*this); }
+  };
+
+  ProductionSizedChainVerifier()
+      : chain_(ReadPemChain(kTestProductionSizedChainPem)) {}
+
+  QuicAsyncStatus VerifyProof(
+      const std::string& /*hostname*/, const uint16_t /*port*/,
+      const std::string& /*server_config*/,
+      QuicTransportVersion /*transport_version*/,
+      absl::string_view /*chlo_hash*/,
+      const std::vector<std::string>& /*certs*/,
+      const std::string& /*cert_sct*/, const std::string& /*signature*/,
+      const ProofVerifyContext* /*context*/, std::string* error_details,
+      std::unique_ptr<ProofVerifyDetails>* /*details*/,
+      std::unique_ptr<ProofVerifierCallback> /*callback*/) override {
+    *error_details = "Only TLS handshakes are verified";
+    return QUIC_FAILURE;
+  }
+
+  QuicAsyncStatus VerifyCertChain(
+      const std::string& /*hostname*/, const uint16_t /*port*/,
+      const std::vector<std::string>& certs,
+      const std::string& /*ocsp_response*/, const std::string& /*cert_sct*/,
+      const ProofVerifyContext* /*context*/, std::string* error_details,
+      std::unique_ptr<ProofVerifyDetails>* details, uint8_t* /*out_alert*/,
+      std::unique_ptr<ProofVerifierCallback> /*callback*/) override {
+    if (certs != chain_) {
+      *error_details = "Received certificates different from the expected";
+      return QUIC_FAILURE;
+    }
+    *details = std::make_unique<Details>();
+    return QUIC_SUCCESS;
+  }
+
+  std::unique_ptr<ProofVerifyContext> CreateDefaultContext() override {
+    return nullptr;
+  }
+
+ private:
+  const std::vector<std::string> chain_;
+};
+
+std::unique_ptr<ProofSource> ProductionSizedChainProofSource() {
+  std::stringstream key_stream(kTestProductionSizedLeafPrivateKeyPem);
+  std::unique_ptr<CertificatePrivateKey> key =
+      CertificatePrivateKey::LoadPemFromStream(&key_stream);
+  QUICHE_CHECK(key != nullptr);
+  return ProofSourceX509::Create(
+      quiche::QuicheReferenceCountedPointer<ProofSource::Chain>(
+          new ProofSource::Chain(ReadPemChain(kTestProductionSizedChainPem))),
+      std::move(*key));
+}
+
+size_t TotalLength(
+    const std::vector<std::unique_ptr<QuicEncryptedPacket>>& packets) {
+  size_t length = 0;
+  for (const auto& packet : packets) {
+    length += packet->length();
+  }
+  return length;
+}
+
+// Handshakes between a client and a server which serves a chain as large as
+// chains served in production, about 4 KB, mostly because of the names and
+// SCTs in the leaf.
+class TlsCertCompressionHandshakeTest : public QuicTest {
+ protected:
+  TlsCertCompressionHandshakeTest()
+      : compressed_certs_cache_(
+            QuicCompressedCertsCache::kQuicCompressedCertsCacheSize) {}
+
+  // The flag is read when the SSL_CTXs of the crypto configs are created.
+  void CreateSessions(bool enable_cert_compression) {
+    SetQuicFlag(quic_enable_tls_cert_compression, enable_cert_compression);
+    TlsCompressedCertsCache::GetInstance()->Clear();
+    server_crypto_config_ = std::make_unique<QuicCryptoServerConfig>(
+        QuicCryptoServerConfig::TESTING, QuicRandom::GetInstance(),
+        ProductionSizedChainProofSource(), KeyExchangeSource::Default(),
+        /*tls_session=*/true);
+    client_crypto_config_ = std::make_unique<QuicCryptoClientConfig>(
+        std::make_unique<ProductionSizedChainVerifier>(),
+        /*tls_session=*/true);
+
+    const ParsedQuicVersionVector versions = {ParsedQuicVersion::RFCv1()};
+    const QuicServerId server_id("www.example.org", 443,
+                                 /*privacy_mode_enabled=*/false);
+    const QuicTime::Delta start_time = QuicTime::Delta::FromSeconds(100000);
+
+    TestQuicSpdyClientSession* client_session;
+    CreateClientSessionForTest(server_id, start_time, versions, &helper_,
+                               &alarm_factory_, client_crypto_config_.get(),
+                               &client_connection_, &client_session);
+    client_session_.reset(client_session);
+    EXPECT_CALL(*client_session_, GetAlpnsToOffer())
+        .WillRepeatedly(
+            Return(std::vector<std::string>({AlpnForVersion(versions[0])})));
+    EXPECT_CALL(*client_session_, OnProofValid(_)).Times(AnyNumber());
+    EXPECT_CALL(*client_session_, OnProofVerifyDetailsAvailable(_))
+        .Times(AnyNumber());
+
+    TestQuicSpdyServerSession* server_session;
+    CreateServerSessionForTest(server_id, start_time, versions, &helper_,
+                               &alarm_factory_, server_crypto_config_.get(),
+                               &compressed_certs_cache_, &server_connection_,
+                               &server_session);
+    server_session_.reset(server_session);
+    EXPECT_CALL(*server_session_, SelectAlpn(_))
+        .WillRepeatedly([](const std::vector<absl::string_view>& alpns) {
+          return alpns.cbegin();
+        });
+  }
+
+  // Delivers the first flight of the client to the server, and what the
+  // server sends in response to the client. Nothing else from the client
+  // reaches the server, which therefore cannot send more than three times the
+  // size of the client's first flight before it validates the client address.
+  void ExchangeFirstFlights() {
+    client_session_->GetMutableCryptoStream()->CryptoConnect();
+    client_first_flight_size_ =
+        TotalLength(client_connection_->encrypted_packets_);
+    crypto_test_utils::AdvanceHandshake(
+        client_connection_, client_session_->GetMutableCryptoStream(), 0,
+        server_connection_, server_session_->GetMutableCryptoStream(), 0);
+  }
+
+  size_t server_first_flight_size() const {
+    return TotalLength(server_connection_->encrypted_packets_);
+  }
+
+  MockQuicConnectionHelper helper_;
+  MockAlarmFactory alarm_factory_;
+  QuicCompressedCertsCache compressed_certs_cache_;
+  std::unique_ptr<QuicCryptoServerConfig> server_crypto_config_;
+  std::unique_ptr<QuicCryptoClientConfig> client_crypto_config_;
+  PacketSavingConnection* client_connection_;  // Owned by |client_session_|.
+  PacketSavingConnection* server_connection_;  // Owned by |server_session_|.
+  std::unique_ptr<TestQuicSpdyClientSession> client_session_;
+  std::unique_ptr<TestQuicSpdyServerSession> server_session_;
+  size_t client_first_flight_size_ = 0;
+};
+
+TEST_F(TlsCertCompressionHandshakeTest, FirstFlightFitsAmplificationLimit) {
+  CreateSessions(/*enable_cert_compression=*/true);
+  ExchangeFirstFlights();
+
+  // The compression callback of the server ran, and cached the compressed
+  // Certificate message.
+  EXPECT_EQ(1u, TlsCompressedCertsCache::GetInstance()->Size());
+  EXPECT_LE(server_first_flight_size(), 3 * client_first_flight_size_);
+  // The whole first flight of the server, up to its Finished, reached the
+  // client, which decompressed and accepted the chain.
+  EXPECT_TRUE(client_session_->GetCryptoStream()->one_rtt_keys_available());
+}
+
+TEST_F(TlsCertCompressionHandshakeTest, FirstFlightBlockedWithoutCompression) {
+  CreateSessions(/*enable_cert_compression=*/false);
+  ExchangeFirstFlights();
+
+  EXPECT_EQ(0u, TlsCompressedCertsCache::GetInstance()->Size());
+  EXPECT_LE(server_first_flight_size(), 3 * client_first_flight_size_);
+  // The server has to wait for more bytes from the client before it can send
+  // the rest of the chain.
+  EXPECT_FALSE(client_session_->GetCryptoStream()->one_rtt_keys_available());
+}
+#endif  // QUIC_TLS_SESSION
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
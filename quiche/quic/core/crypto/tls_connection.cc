@@ -6,6 +6,7 @@
 
 #include "absl/strings/string_view.h"
 #include "openssl/ssl.h"
+#include "quiche/quic/core/crypto/tls_cert_compression.h"
 #include "quiche/quic/platform/api/quic_bug_tracker.h"
 
 namespace quic {
@@ -132,6 +133,7 @@ bssl::UniquePtr<SSL_CTX> TlsConnection::CreateSslCtx() {
   SSL_CTX_set_min_proto_version(ssl_ctx.get(), TLS1_3_VERSION);
   SSL_CTX_set_max_proto_version(ssl_ctx.get(), TLS1_3_VERSION);
   SSL_CTX_set_quic_method(ssl_ctx.get(), &kSslQuicMethod);
+  TlsCertCompression::RegisterAlgorithms(ssl_ctx.get());
   return ssl_ctx;
 }
 
@@ -6,6 +6,7 @@
 
 #include "absl/strings/string_view.h"
 #include "openssl/ssl.h"
+#include "quiche/quic/core/crypto/cipher_suite_policy.h"
 #include "quiche/quic/core/crypto/proof_source.h"
 #include "quiche/quic/core/quic_types.h"
 #include "quiche/quic/platform/api/quic_flag_utils.h"
@@ -52,6 +53,14 @@ bssl::UniquePtr<SSL_CTX> TlsServerConnection::CreateSslCtx(
   SSL_CTX_set_select_certificate_cb(
       ssl_ctx.get(), &TlsServerConnection::EarlySelectCertCallback);
   SSL_CTX_set_options(ssl_ctx.get(), SSL_OP_CIPHER_SERVER_PREFERENCE);
+  const int32_t cipher_suite_policy =
+      GetQuicFlag(quic_tls_server_cipher_suite_policy);
+  if (cipher_suite_policy > 0 &&
+      cipher_suite_policy <=
+          static_cast<int32_t>(CipherSuitePolicy::kMeasuredThroughput)) {
+    ApplyCipherSuitePolicy(static_cast<CipherSuitePolicy>(cipher_suite_policy),
+                           ssl_ctx.get());
+  }
 
   // Allow ProofSource to change SSL_CTX settings.
   proof_source->OnNewSslCtx(ssl_ctx.get());
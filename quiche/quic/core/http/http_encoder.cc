@@ -41,6 +41,18 @@ QuicByteCount HttpEncoder::GetDataFrameHeaderLength(
              static_cast<uint64_t>(HttpFrameType::DATA));
 }
 
+bool HttpEncoder::WriteDataFrameHeader(QuicByteCount payload_length,
+                                       QuicDataWriter* writer) {
+  QUICHE_DCHECK_NE(0u, payload_length);
+  return WriteFrameHeader(payload_length, HttpFrameType::DATA, writer);
+}
+
+bool HttpEncoder::WriteHeadersFrameHeader(QuicByteCount payload_length,
+                                          QuicDataWriter* writer) {
+  QUICHE_DCHECK_NE(0u, payload_length);
+  return WriteFrameHeader(payload_length, HttpFrameType::HEADERS, writer);
+}
+
 quiche::QuicheBuffer HttpEncoder::SerializeDataFrameHeader(
     QuicByteCount payload_length, quiche::QuicheBufferAllocator* allocator) {
   QUICHE_DCHECK_NE(0u, payload_length);
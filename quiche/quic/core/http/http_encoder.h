@@ -23,9 +23,22 @@ class QUIC_EXPORT_PRIVATE HttpEncoder {
  public:
   HttpEncoder() = delete;
 
+  // The maximum length of the type and length fields of a frame, each of which
+  // is a variable-length integer of up to 8 bytes.
+  static constexpr QuicByteCount kMaxFrameHeaderLength = 16;
+
   // Returns the length of the header for a DATA frame.
   static QuicByteCount GetDataFrameHeaderLength(QuicByteCount payload_length);
 
+  // Writes a DATA frame header to |writer|; returns false if it does not fit.
+  static bool WriteDataFrameHeader(QuicByteCount payload_length,
+                                   QuicDataWriter* writer);
+
+  // Writes a HEADERS frame header to |writer|; returns false if it does not
+  // fit.
+  static bool WriteHeadersFrameHeader(QuicByteCount payload_length,
+                                      QuicDataWriter* writer);
+
   // Serializes a DATA frame header into a QuicheBuffer; returns said
   // QuicheBuffer on success, empty buffer otherwise.
   static quiche::QuicheBuffer SerializeDataFrameHeader(
@@ -7,6 +7,7 @@
 #include <limits>
 #include <string>
 
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "quiche/quic/core/qpack/qpack_header_table.h"
 #include "quiche/quic/core/quic_packets.h"
@@ -22,10 +23,23 @@ QuicHeaderList::QuicHeaderList()
 
 QuicHeaderList::QuicHeaderList(QuicHeaderList&& other) = default;
 
-QuicHeaderList::QuicHeaderList(const QuicHeaderList& other) = default;
+QuicHeaderList::QuicHeaderList(const QuicHeaderList& other)
+    : max_header_list_size_(other.max_header_list_size_),
+      current_header_list_size_(other.current_header_list_size_),
+      uncompressed_header_bytes_(other.uncompressed_header_bytes_),
+      compressed_header_bytes_(other.compressed_header_bytes_) {
+  for (const auto& p : other.header_list_) {
+    header_list_.emplace_back(storage_.Write(p.first),
+                              storage_.Write(p.second));
+  }
+}
 
-QuicHeaderList& QuicHeaderList::operator=(const QuicHeaderList& other) =
-    default;
+QuicHeaderList& QuicHeaderList::operator=(const QuicHeaderList& other) {
+  if (this != &other) {
+    *this = QuicHeaderList(other);
+  }
+  return *this;
+}
 
 QuicHeaderList& QuicHeaderList::operator=(QuicHeaderList&& other) = default;
 
@@ -43,7 +57,7 @@ void QuicHeaderList::OnHeader(absl::string_view name, absl::string_view value) {
     current_header_list_size_ += name.size();
     current_header_list_size_ += value.size();
     current_header_list_size_ += kQpackEntrySizeOverhead;
-    header_list_.emplace_back(std::string(name), std::string(value));
+    header_list_.emplace_back(storage_.Write(name), storage_.Write(value));
   }
 }
 
@@ -58,6 +72,7 @@ void QuicHeaderList::OnHeaderBlockEnd(size_t uncompressed_header_bytes,
 
 void QuicHeaderList::Clear() {
   header_list_.clear();
+  storage_.Clear();
   current_header_list_size_ = 0;
   uncompressed_header_bytes_ = 0;
   compressed_header_bytes_ = 0;
@@ -66,7 +81,7 @@ void QuicHeaderList::Clear() {
 std::string QuicHeaderList::DebugString() const {
   std::string s = "{ ";
   for (const auto& p : *this) {
-    s.append(p.first + "=" + p.second + ", ");
+    absl::StrAppend(&s, p.first, "=", p.second, ", ");
   }
   s.append("}");
   return s;
@@ -14,16 +14,21 @@
 #include "quiche/quic/platform/api/quic_bug_tracker.h"
 #include "quiche/quic/platform/api/quic_export.h"
 #include "quiche/common/quiche_circular_deque.h"
+#include "quiche/spdy/core/http2_header_storage.h"
 #include "quiche/spdy/core/spdy_headers_handler_interface.h"
 
 namespace quic {
 
-// A simple class that accumulates header pairs
+// A simple class that accumulates header pairs. Names and values are copied
+// into an arena owned by the list, so accumulating a header does not allocate
+// memory for every field, and moving the list does not copy any of them. The
+// string_views returned by iteration are valid until the list is cleared or
+// destroyed.
 class QUIC_EXPORT_PRIVATE QuicHeaderList
     : public spdy::SpdyHeadersHandlerInterface {
  public:
-  using ListType =
-      quiche::QuicheCircularDeque<std::pair<std::string, std::string>>;
+  using ListType = quiche::QuicheCircularDeque<
+      std::pair<absl::string_view, absl::string_view>>;
   using value_type = ListType::value_type;
   using const_iterator = ListType::const_iterator;
 
@@ -59,7 +64,9 @@ class QUIC_EXPORT_PRIVATE QuicHeaderList
   std::string DebugString() const;
 
  private:
-  quiche::QuicheCircularDeque<std::pair<std::string, std::string>> header_list_;
+  // Backing store for the names and values in |header_list_|.
+  spdy::Http2HeaderStorage storage_;
+  ListType header_list_;
 
   // The limit on the size of the header list (defined by spec as name + value +
   // overhead for each header field). Headers over this limit will not be
@@ -76,8 +83,8 @@ class QUIC_EXPORT_PRIVATE QuicHeaderList
 };
 
 inline bool operator==(const QuicHeaderList& l1, const QuicHeaderList& l2) {
-  auto pred = [](const std::pair<std::string, std::string>& p1,
-                 const std::pair<std::string, std::string>& p2) {
+  auto pred = [](const QuicHeaderList::value_type& p1,
+                 const QuicHeaderList::value_type& p2) {
     return p1.first == p2.first && p1.second == p2.second;
   };
   return std::equal(l1.begin(), l1.end(), l2.begin(), pred);
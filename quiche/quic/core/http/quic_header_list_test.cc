@@ -0,0 +1,105 @@
+// Copyright (c) 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/http/quic_header_list.h"
+
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "quiche/quic/platform/api/quic_test.h"
+
+using ::testing::ElementsAre;
+using ::testing::Pair;
+
+namespace quic {
+namespace test {
+
+class QuicHeaderListTest : public QuicTest {};
+
+TEST_F(QuicHeaderListTest, OnHeader) {
+  QuicHeaderList headers;
+  headers.OnHeader("foo", "bar");
+  headers.OnHeader("april", "fools");
+  headers.OnHeader("beep", "");
+
+  EXPECT_THAT(headers, ElementsAre(Pair("foo", "bar"), Pair("april", "fools"),
+                                   Pair("beep", "")));
+}
+
+TEST_F(QuicHeaderListTest, DebugString) {
+  QuicHeaderList headers;
+  headers.OnHeader("foo", "bar");
+  headers.OnHeader("april", "fools");
+  headers.OnHeader("beep", "");
+
+  EXPECT_EQ("{ foo=bar, april=fools, beep=, }", headers.DebugString());
+}
+
+TEST_F(QuicHeaderListTest, TooLarge) {
+  QuicHeaderList headers;
+  const std::string key = "key";
+  const std::string value(1 << 18, '1');
+  headers.set_max_header_list_size(1 << 16);
+  headers.OnHeader(key, value);
+  headers.OnHeader(key + "2", value);
+  EXPECT_FALSE(headers.empty());
+  headers.OnHeaderBlockEnd(key.size() + value.size(),
+                           key.size() + value.size());
+  EXPECT_TRUE(headers.empty());
+}
+
+TEST_F(QuicHeaderListTest, DoesNotRetainInput) {
+  QuicHeaderList headers;
+  {
+    std::string name = "foo";
+    std::string value = "bar";
+    headers.OnHeader(name, value);
+    name.assign("xxx");
+    value.assign("yyy");
+  }
+  EXPECT_THAT(headers, ElementsAre(Pair("foo", "bar")));
+}
+
+// This test verifies that QuicHeaderList is copyable and assignable, and that
+// copies do not refer to the storage of the original.
+TEST_F(QuicHeaderListTest, IsCopyableAndAssignable) {
+  QuicHeaderList headers;
+  headers.OnHeader("foo", "bar");
+  headers.OnHeader("april", "fools");
+  headers.OnHeader("beep", "");
+
+  QuicHeaderList headers2(headers);
+  QuicHeaderList headers3 = headers;
+
+  EXPECT_THAT(headers2, ElementsAre(Pair("foo", "bar"), Pair("april", "fools"),
+                                    Pair("beep", "")));
+  EXPECT_THAT(headers3, ElementsAre(Pair("foo", "bar"), Pair("april", "fools"),
+                                    Pair("beep", "")));
+  EXPECT_NE(headers.begin()->first.data(), headers2.begin()->first.data());
+
+  headers.Clear();
+  EXPECT_THAT(headers2, ElementsAre(Pair("foo", "bar"), Pair("april", "fools"),
+                                    Pair("beep", "")));
+}
+
+// This test verifies that moving a QuicHeaderList keeps the names and values
+// in place.
+TEST_F(QuicHeaderListTest, MoveDoesNotCopyHeaders) {
+  QuicHeaderList headers;
+  headers.OnHeader("foo", "bar");
+  const absl::string_view name = headers.begin()->first;
+
+  QuicHeaderList headers2(std::move(headers));
+  EXPECT_THAT(headers2, ElementsAre(Pair("foo", "bar")));
+  EXPECT_EQ(name.data(), headers2.begin()->first.data());
+
+  QuicHeaderList headers3;
+  headers3 = std::move(headers2);
+  EXPECT_THAT(headers3, ElementsAre(Pair("foo", "bar")));
+  EXPECT_EQ(name.data(), headers3.begin()->first.data());
+}
+
+}  // namespace test
+}  // namespace quic
@@ -32,6 +32,8 @@ QuicServerSessionBase::QuicServerSessionBase(
       compressed_certs_cache_(compressed_certs_cache),
       helper_(helper),
       bandwidth_resumption_enabled_(false),
+      subnet_bandwidth_cache_(
+          Bbr2SubnetBandwidthCache::GetProcessWideInstance()),
       bandwidth_estimate_sent_to_client_(QuicBandwidth::Zero()),
       last_scup_time_(QuicTime::Zero()) {}
 
@@ -72,6 +74,13 @@ void QuicServerSessionBase::OnConfigNegotiated() {
     }
   }
 
+  // A validated address token from this serving region describes the path to
+  // this very client, so prefer it to what was learned from its subnet.
+  if (cached_network_params == nullptr ||
+      cached_network_params->serving_region() != serving_region_) {
+    MaybeSeedFromSubnetBandwidthCache();
+  }
+
   if (!config()->HasReceivedConnectionOptions()) {
     return;
   }
@@ -127,6 +136,12 @@ void QuicServerSessionBase::OnConfigNegotiated() {
 void QuicServerSessionBase::OnConnectionClosed(
     const QuicConnectionCloseFrame& frame, ConnectionCloseSource source) {
   QuicSession::OnConnectionClosed(frame, source);
+  if (subnet_bandwidth_cache_ != nullptr) {
+    subnet_bandwidth_cache_->OnConnectionClosed(
+        connection()->peer_address().host(),
+        *connection()->sent_packet_manager().GetSendAlgorithm(),
+        connection()->clock()->ApproximateNow());
+  }
   // In the unlikely event we get a connection close while doing an asynchronous
   // crypto event, make sure we cancel the callback.
   if (crypto_stream_ != nullptr) {
@@ -134,6 +149,24 @@ void QuicServerSessionBase::OnConnectionClosed(
   }
 }
 
+void QuicServerSessionBase::MaybeSeedFromSubnetBandwidthCache() {
+  if (subnet_bandwidth_cache_ == nullptr ||
+      connection()->sent_packet_manager().GetSendAlgorithm()
+              ->GetCongestionControlType() != kBBRv2) {
+    return;
+  }
+  absl::optional<SendAlgorithmInterface::NetworkParams> params =
+      subnet_bandwidth_cache_->GetNetworkParams(
+          connection()->peer_address().host(),
+          connection()->clock()->ApproximateNow());
+  if (!params.has_value()) {
+    return;
+  }
+  QUIC_DLOG(INFO) << "Server: Seeding bandwidth " << params->bandwidth
+                  << " from the client subnet cache";
+  connection()->AdjustNetworkParameters(*params);
+}
+
 void QuicServerSessionBase::OnBandwidthUpdateTimeout() {
   if (!enable_sending_bandwidth_estimate_when_network_idle_) {
     return;
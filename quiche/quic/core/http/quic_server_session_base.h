@@ -13,6 +13,7 @@
 #include <string>
 #include <vector>
 
+#include "quiche/quic/core/congestion_control/bbr2_subnet_bandwidth_cache.h"
 #include "quiche/quic/core/crypto/quic_compressed_certs_cache.h"
 #include "quiche/quic/core/http/quic_spdy_session.h"
 #include "quiche/quic/core/quic_crypto_server_stream_base.h"
@@ -73,6 +74,12 @@ class QUIC_EXPORT_PRIVATE QuicServerSessionBase : public QuicSpdySession {
 
   const std::string& serving_region() const { return serving_region_; }
 
+  // Overrides the process-wide subnet bandwidth cache, nullptr disables it.
+  // |cache| must outlive the session.
+  void set_subnet_bandwidth_cache(Bbr2SubnetBandwidthCache* cache) {
+    subnet_bandwidth_cache_ = cache;
+  }
+
   QuicSSLConfig GetSSLConfig() const override;
 
   bool enable_sending_bandwidth_estimate_when_network_idle() const {
@@ -118,6 +125,10 @@ class QUIC_EXPORT_PRIVATE QuicServerSessionBase : public QuicSpdySession {
   // data.
   void SendSettingsToCryptoStream();
 
+  // Seeds the send algorithm with the network parameters last seen from the
+  // client's subnet, if any.
+  void MaybeSeedFromSubnetBandwidthCache();
+
   const QuicCryptoServerConfig* crypto_config_;
 
   // The cache which contains most recently compressed certs.
@@ -133,6 +144,10 @@ class QUIC_EXPORT_PRIVATE QuicServerSessionBase : public QuicSpdySession {
   // Whether bandwidth resumption is enabled for this connection.
   bool bandwidth_resumption_enabled_;
 
+  // Shares the BBRv2 path model between connections from the same client
+  // subnet. Not owned, may be nullptr.
+  Bbr2SubnetBandwidthCache* subnet_bandwidth_cache_;
+
   // The most recent bandwidth estimate sent to the client.
   QuicBandwidth bandwidth_estimate_sent_to_client_;
 
@@ -202,7 +202,7 @@ bool QuicSpdyClientStream::AreHeadersValid(
   }
   // Verify the presence of :status header.
   bool saw_status = false;
-  for (const std::pair<std::string, std::string>& pair : header_list) {
+  for (const auto& pair : header_list) {
     if (pair.first == ":status") {
       saw_status = true;
     } else if (absl::StrContains(pair.first, ":")) {
@@ -20,6 +20,7 @@
 #include "quiche/quic/core/http/http_frames.h"
 #include "quiche/quic/core/http/quic_headers_stream.h"
 #include "quiche/quic/core/http/web_transport_http3.h"
+#include "quiche/quic/core/qpack/qpack_encoding_strategy.h"
 #include "quiche/quic/core/quic_error_codes.h"
 #include "quiche/quic/core/quic_types.h"
 #include "quiche/quic/core/quic_utils.h"
@@ -499,6 +500,10 @@ void QuicSpdySession::Initialize() {
     ActivateStream(std::move(headers_stream));
   } else {
     qpack_encoder_ = std::make_unique<QpackEncoder>(this);
+    if (GetQuicFlag(quic_qpack_encoder_frequency_strategy)) {
+      qpack_encoder_->set_encoding_strategy(
+          std::make_unique<QpackFrequencyEncodingStrategy>());
+    }
     qpack_decoder_ =
         std::make_unique<QpackDecoder>(qpack_maximum_dynamic_table_capacity_,
                                        qpack_maximum_blocked_streams_, this);
@@ -584,8 +589,8 @@ void QuicSpdySession::OnStreamHeaderList(QuicStreamId stream_id, bool fin,
     // byte offset necessary for flow control and open stream accounting.
     size_t final_byte_offset = 0;
     for (const auto& header : header_list) {
-      const std::string& header_key = header.first;
-      const std::string& header_value = header.second;
+      absl::string_view header_key = header.first;
+      absl::string_view header_value = header.second;
       if (header_key == kFinalOffsetHeaderKey) {
         if (!absl::SimpleAtoi(header_value, &final_byte_offset)) {
           connection()->CloseConnection(
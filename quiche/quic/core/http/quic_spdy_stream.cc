@@ -23,6 +23,7 @@
 #include "quiche/quic/core/qpack/qpack_decoder.h"
 #include "quiche/quic/core/qpack/qpack_encoder.h"
 #include "quiche/quic/core/quic_stream_priority.h"
+#include "quiche/quic/core/quic_data_writer.h"
 #include "quiche/quic/core/quic_types.h"
 #include "quiche/quic/core/quic_utils.h"
 #include "quiche/quic/core/quic_versions.h"
@@ -303,10 +304,60 @@ size_t QuicSpdyStream::WriteHeaders(
   return bytes_written;
 }
 
+QuicSpdyStream::ScopedDataFrameCoalescer::ScopedDataFrameCoalescer(
+    QuicSpdyStream* stream)
+    : stream_(VersionUsesHttp3(stream->transport_version()) &&
+                      GetQuicFlag(quic_coalesce_http3_data_frames)
+                  ? stream
+                  : nullptr) {
+  if (stream_ != nullptr) {
+    ++stream_->data_frame_coalescer_depth_;
+  }
+}
+
+QuicSpdyStream::ScopedDataFrameCoalescer::~ScopedDataFrameCoalescer() {
+  if (stream_ != nullptr && --stream_->data_frame_coalescer_depth_ == 0) {
+    stream_->FlushCoalescedBody(/*fin=*/false);
+  }
+}
+
 void QuicSpdyStream::WriteOrBufferBody(absl::string_view data, bool fin) {
   if (!AssertNotWebTransportDataStream("writing body data")) {
     return;
   }
+  if (data_frame_coalescer_depth_ > 0) {
+    if (data.size() < kMaxCoalescedWriteLength) {
+      coalesced_body_.append(data.data(), data.size());
+      if (fin) {
+        FlushCoalescedBody(/*fin=*/true);
+      }
+      return;
+    }
+    if (!coalesced_body_.empty()) {
+      // Large writes are not copied: they share the frame of the body
+      // coalesced so far, but are written to the send buffer directly.
+      QuicConnection::ScopedPacketFlusher flusher(spdy_session_->connection());
+      const bool success = WriteDataFrameHeader(
+          coalesced_body_.size() + data.size(), /*force_write=*/true);
+      QUICHE_DCHECK(success);
+      WriteOrBufferData(coalesced_body_, /*fin=*/false, nullptr);
+      coalesced_body_.clear();
+      WriteOrBufferData(data, fin, nullptr);
+      return;
+    }
+  }
+  WriteOrBufferDataFrame(data, fin);
+}
+
+void QuicSpdyStream::FlushCoalescedBody(bool fin) {
+  if (coalesced_body_.empty() && !fin) {
+    return;
+  }
+  WriteOrBufferDataFrame(coalesced_body_, fin);
+  coalesced_body_.clear();
+}
+
+void QuicSpdyStream::WriteOrBufferDataFrame(absl::string_view data, bool fin) {
   if (!VersionUsesHttp3(transport_version()) || data.length() == 0) {
     WriteOrBufferData(data, fin, nullptr);
     return;
@@ -383,9 +434,12 @@ bool QuicSpdyStream::WriteDataFrameHeader(QuicByteCount data_length,
                                           bool force_write) {
   QUICHE_DCHECK(VersionUsesHttp3(transport_version()));
   QUICHE_DCHECK_GT(data_length, 0u);
-  quiche::QuicheBuffer header = HttpEncoder::SerializeDataFrameHeader(
-      data_length,
-      spdy_session_->connection()->helper()->GetStreamSendBufferAllocator());
+  // The send buffer copies the header, so it needs no allocation of its own.
+  char header_buffer[HttpEncoder::kMaxFrameHeaderLength];
+  QuicDataWriter writer(sizeof(header_buffer), header_buffer);
+  const bool success = HttpEncoder::WriteDataFrameHeader(data_length, &writer);
+  QUICHE_DCHECK(success);
+  const absl::string_view header(header_buffer, writer.length());
   const bool can_write = CanWriteNewDataAfterData(header.size());
   if (!can_write && !force_write) {
     return false;
@@ -401,14 +455,7 @@ bool QuicSpdyStream::WriteDataFrameHeader(QuicByteCount data_length,
   QUIC_DLOG(INFO) << ENDPOINT << "Stream " << id()
                   << " is writing DATA frame header of length "
                   << header.size();
-  if (can_write) {
-    // Save one copy and allocation if send buffer can accomodate the header.
-    quiche::QuicheMemSlice header_slice(std::move(header));
-    WriteMemSlices(absl::MakeSpan(&header_slice, 1), false);
-  } else {
-    QUICHE_DCHECK(force_write);
-    WriteOrBufferData(header.AsStringView(), false, nullptr);
-  }
+  WriteOrBufferData(header, false, nullptr);
   return true;
 }
 
@@ -419,6 +466,7 @@ QuicConsumedData QuicSpdyStream::WriteBodySlices(
   }
 
   QuicConnection::ScopedPacketFlusher flusher(spdy_session_->connection());
+  FlushCoalescedBody(/*fin=*/false);
   const QuicByteCount data_size = MemSliceSpanTotalSize(slices);
   if (!WriteDataFrameHeader(data_size, /*force_write=*/false)) {
     return {0, false};
@@ -567,7 +615,15 @@ void QuicSpdyStream::OnHeadersDecoded(QuicHeaderList headers,
       debug_visitor->OnHeadersDecoded(id(), headers);
     }
 
-    OnStreamHeaderList(/* fin = */ false, headers_payload_length_, headers);
+    if (headers_decompressed_) {
+      OnStreamHeaderList(/* fin = */ false, headers_payload_length_, headers);
+    } else {
+      // Initial headers are kept in |header_list_|.  Move them there instead of
+      // copying them in OnInitialHeadersComplete().
+      header_list_ = std::move(headers);
+      OnStreamHeaderList(/* fin = */ false, headers_payload_length_,
+                         header_list_);
+    }
   } else {
     spdy_session_->OnHeaderList(headers);
   }
@@ -612,7 +668,9 @@ void QuicSpdyStream::OnInitialHeadersComplete(
     bool fin, size_t /*frame_len*/, const QuicHeaderList& header_list) {
   // TODO(b/134706391): remove |fin| argument.
   headers_decompressed_ = true;
-  header_list_ = header_list;
+  if (&header_list != &header_list_) {
+    header_list_ = header_list;
+  }
   bool header_too_large = VersionUsesHttp3(transport_version())
                               ? header_list_size_limit_exceeded_
                               : header_list.empty();
@@ -1178,9 +1236,18 @@ size_t QuicSpdyStream::WriteHeadersImpl(
     spdy_session_->debug_visitor()->OnHeadersFrameSent(id(), header_block);
   }
 
-  // Write HEADERS frame.
-  std::string headers_frame_header =
-      HttpEncoder::SerializeHeadersFrameHeader(encoded_headers.size());
+  // Write HEADERS frame. The frame header is written to the send buffer
+  // straight from the stack, followed by the encoded headers, and the two are
+  // sent together.
+  QuicConnection::ScopedPacketFlusher flusher(spdy_session_->connection());
+  FlushCoalescedBody(/*fin=*/false);
+  char frame_header_buffer[HttpEncoder::kMaxFrameHeaderLength];
+  QuicDataWriter writer(sizeof(frame_header_buffer), frame_header_buffer);
+  const bool success =
+      HttpEncoder::WriteHeadersFrameHeader(encoded_headers.size(), &writer);
+  QUICHE_DCHECK(success);
+  const absl::string_view headers_frame_header(frame_header_buffer,
+                                               writer.length());
   unacked_frame_headers_offsets_.Add(
       send_buffer().stream_offset(),
       send_buffer().stream_offset() + headers_frame_header.length());
@@ -1189,8 +1256,9 @@ size_t QuicSpdyStream::WriteHeadersImpl(
                   << " is writing HEADERS frame header of length "
                   << headers_frame_header.length() << ", and payload of length "
                   << encoded_headers.length() << " with fin " << fin;
-  WriteOrBufferData(absl::StrCat(headers_frame_header, encoded_headers), fin,
+  WriteOrBufferData(headers_frame_header, /*fin=*/false,
                     /*ack_listener=*/nullptr);
+  WriteOrBufferData(encoded_headers, fin, /*ack_listener=*/nullptr);
 
   QuicSpdySession::LogHeaderCompressionRatioHistogram(
       /* using_qpack = */ true,
@@ -1453,6 +1521,21 @@ MessageStatus QuicSpdyStream::SendHttp3Datagram(absl::string_view payload) {
   return spdy_session_->SendHttp3Datagram(id(), payload);
 }
 
+size_t QuicSpdyStream::SendHttp3Datagrams(
+    absl::Span<const absl::string_view> payloads) {
+  // Without the flusher, every DATAGRAM frame would go in its own packet.
+  QuicConnection::ScopedPacketFlusher flusher(spdy_session_->connection());
+  size_t num_sent = 0;
+  for (absl::string_view payload : payloads) {
+    const MessageStatus status = SendHttp3Datagram(payload);
+    if (status != MESSAGE_STATUS_SUCCESS && status != MESSAGE_STATUS_BLOCKED) {
+      break;
+    }
+    ++num_sent;
+  }
+  return num_sent;
+}
+
 void QuicSpdyStream::RegisterHttp3DatagramVisitor(
     Http3DatagramVisitor* visitor) {
   if (visitor == nullptr) {
@@ -1627,8 +1710,8 @@ constexpr bool isInvalidHeaderNameCharacter(unsigned char c) {
 }  // namespace
 
 bool QuicSpdyStream::AreHeadersValid(const QuicHeaderList& header_list) const {
-  for (const std::pair<std::string, std::string>& pair : header_list) {
-    const std::string& name = pair.first;
+  for (const auto& pair : header_list) {
+    absl::string_view name = pair.first;
     if (std::any_of(name.begin(), name.end(), isInvalidHeaderNameCharacter)) {
       QUIC_DLOG(ERROR) << "Invalid request header " << name;
       return false;
@@ -1654,8 +1737,8 @@ bool QuicSpdyStream::AreHeaderFieldValuesValid(
   // request or response that contains a character not permitted in a field
   // value MUST be treated as malformed.
   // [...]"
-  for (const std::pair<std::string, std::string>& pair : header_list) {
-    const std::string& value = pair.second;
+  for (const auto& pair : header_list) {
+    absl::string_view value = pair.second;
     for (const auto c : value) {
       if (c == '\0' || c == '\n' || c == '\r') {
         return false;
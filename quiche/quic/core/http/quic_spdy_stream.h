@@ -75,6 +75,29 @@ class QUIC_EXPORT_PRIVATE QuicSpdyStream
     virtual ~Visitor() {}
   };
 
+  // Coalesces the body written with WriteOrBufferBody() while it is in scope
+  // into a single HTTP/3 DATA frame, which is written once the outermost scope
+  // ends, or as soon as anything else is written to the stream. Only writes
+  // shorter than kMaxCoalescedWriteLength are copied; longer ones are written
+  // directly, in the frame of the body coalesced before them. Has no effect
+  // unless the stream uses HTTP/3 and --quic_coalesce_http3_data_frames is set.
+  class QUIC_EXPORT_PRIVATE ScopedDataFrameCoalescer {
+   public:
+    explicit ScopedDataFrameCoalescer(QuicSpdyStream* stream);
+    ScopedDataFrameCoalescer(const ScopedDataFrameCoalescer&) = delete;
+    ScopedDataFrameCoalescer& operator=(const ScopedDataFrameCoalescer&) =
+        delete;
+    ~ScopedDataFrameCoalescer();
+
+   private:
+    QuicSpdyStream* const stream_;  // Null if not coalescing.
+  };
+
+  // Writes of body at least this long are not copied by
+  // ScopedDataFrameCoalescer, as a frame header of their own is cheap next to
+  // them.
+  static constexpr size_t kMaxCoalescedWriteLength = 1024;
+
   QuicSpdyStream(QuicStreamId id, QuicSpdySession* spdy_session,
                  StreamType type);
   QuicSpdyStream(PendingStream* pending, QuicSpdySession* spdy_session);
@@ -264,6 +287,11 @@ class QUIC_EXPORT_PRIVATE QuicSpdyStream
   // to allow mocking in tests.
   virtual MessageStatus SendHttp3Datagram(absl::string_view payload);
 
+  // Sends or queues |payloads| as HTTP/3 datagrams, packing as many as fit
+  // into each packet.  Stops at the first datagram that can be neither sent
+  // nor queued, and returns the number of datagrams before it.
+  size_t SendHttp3Datagrams(absl::Span<const absl::string_view> payloads);
+
   class QUIC_EXPORT_PRIVATE Http3DatagramVisitor {
    public:
     virtual ~Http3DatagramVisitor() {}
@@ -333,6 +361,8 @@ class QUIC_EXPORT_PRIVATE QuicSpdyStream
   // reset the stream.
   virtual void OnHeadersTooLarge();
 
+  // |header_list| may refer to |header_list_|, in which case it is cleared by
+  // ConsumeHeaderList().
   virtual void OnInitialHeadersComplete(bool fin, size_t frame_len,
                                         const QuicHeaderList& header_list);
   virtual void OnTrailingHeadersComplete(bool fin, size_t frame_len,
@@ -411,6 +441,14 @@ class QUIC_EXPORT_PRIVATE QuicSpdyStream
   ABSL_MUST_USE_RESULT bool WriteDataFrameHeader(QuicByteCount data_length,
                                                  bool force_write);
 
+  // Writes |data| in a DATA frame of its own, or buffers it if it can't be
+  // sent immediately.
+  void WriteOrBufferDataFrame(absl::string_view data, bool fin);
+
+  // Writes the body coalesced by ScopedDataFrameCoalescer, if any, followed by
+  // a FIN if |fin| is true.
+  void FlushCoalescedBody(bool fin);
+
   // Simply calls OnBodyAvailable() unless capsules are in use, in which case
   // pass the capsule fragments to the capsule manager.
   void HandleBodyAvailable();
@@ -432,8 +470,8 @@ class QUIC_EXPORT_PRIVATE QuicSpdyStream
   // True if uncompressed headers or trailers exceed maximum allowed size
   // advertised to peer via SETTINGS_MAX_HEADER_LIST_SIZE.
   bool header_list_size_limit_exceeded_;
-  // Contains a copy of the decompressed header (name, value) pairs until they
-  // are consumed via Readv.
+  // Contains the decompressed header (name, value) pairs until they are
+  // consumed via Readv.
   QuicHeaderList header_list_;
   // Length of most recently received HEADERS frame payload.
   QuicByteCount headers_payload_length_;
@@ -477,6 +515,11 @@ class QUIC_EXPORT_PRIVATE QuicSpdyStream
   // Offset of unacked frame headers.
   QuicIntervalSet<QuicStreamOffset> unacked_frame_headers_offsets_;
 
+  // Number of active ScopedDataFrameCoalescers, and the body they have
+  // coalesced so far. The string keeps its capacity between flushes.
+  int data_frame_coalescer_depth_ = 0;
+  std::string coalesced_body_;
+
   // Priority parameters sent in the last PRIORITY_UPDATE frame, or default
   // values defined by RFC9218 if no PRIORITY_UPDATE frame has been sent.
   QuicStreamPriority last_sent_priority_;
@@ -0,0 +1,128 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/http/quic_spdy_stream.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "quiche/quic/core/crypto/null_decrypter.h"
+#include "quiche/quic/core/crypto/null_encrypter.h"
+#include "quiche/quic/core/http/quic_spdy_session.h"
+#include "quiche/quic/core/quic_types.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/mock_clock.h"
+#include "quiche/quic/test_tools/quic_connection_peer.h"
+#include "quiche/quic/test_tools/quic_spdy_session_peer.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+#include "quiche/common/pooled_buffer_allocator.h"
+
+using testing::_;
+using testing::Invoke;
+using testing::NiceMock;
+
+namespace quic {
+namespace test {
+namespace {
+
+// Allocates datagram buffers from a pool, as QuicServer does with
+// --quic_server_pool_send_buffers.
+class PooledConnectionHelper : public MockQuicConnectionHelper {
+ public:
+  quiche::QuicheBufferAllocator* GetStreamSendBufferAllocator() override {
+    return &allocator_;
+  }
+
+  quiche::PooledBufferAllocator& allocator() { return allocator_; }
+
+ private:
+  quiche::PooledBufferAllocator allocator_;
+};
+
+class EstablishedCryptoStream : public MockQuicCryptoStream {
+ public:
+  using MockQuicCryptoStream::MockQuicCryptoStream;
+
+  bool encryption_established() const override { return true; }
+  bool one_rtt_keys_available() const override { return true; }
+};
+
+class TestStream : public QuicSpdyStream {
+ public:
+  TestStream(QuicStreamId id, QuicSpdySession* session)
+      : QuicSpdyStream(id, session, BIDIRECTIONAL) {}
+
+  void OnBodyAvailable() override {}
+};
+
+class QuicSpdyStreamDatagramTest : public QuicTest {
+ protected:
+  QuicSpdyStreamDatagramTest()
+      : connection_(new NiceMock<MockQuicConnection>(
+            &helper_, &alarm_factory_, Perspective::IS_CLIENT)),
+        session_(connection_, /*create_mock_crypto_stream=*/false),
+        writer_(new TestPacketWriter(connection_->version(), &clock_,
+                                     Perspective::IS_CLIENT)) {
+    session_.SetCryptoStream(new EstablishedCryptoStream(&session_));
+    QuicSpdySessionPeer::SetHttpDatagramSupport(&session_,
+                                                HttpDatagramSupport::kRfc);
+    QuicConnectionPeer::SetWriter(connection_, writer_, /*owns_writer=*/true);
+    ON_CALL(*connection_, SendMessage(_, _, _))
+        .WillByDefault(
+            Invoke(connection_, &MockQuicConnection::ReallySendMessage));
+
+    connection_->SetEncrypter(
+        ENCRYPTION_FORWARD_SECURE,
+        std::make_unique<NullEncrypter>(Perspective::IS_CLIENT));
+    connection_->SetDefaultEncryptionLevel(ENCRYPTION_FORWARD_SECURE);
+    auto decrypter = std::make_unique<NullDecrypter>(Perspective::IS_SERVER);
+    if (connection_->version().KnowsWhichDecrypterToUse()) {
+      writer_->framer()->framer()->InstallDecrypter(ENCRYPTION_FORWARD_SECURE,
+                                                    std::move(decrypter));
+    } else {
+      writer_->framer()->framer()->SetDecrypter(ENCRYPTION_FORWARD_SECURE,
+                                                std::move(decrypter));
+    }
+
+    stream_ = new TestStream(GetNthClientInitiatedBidirectionalStreamId(
+                                 connection_->transport_version(), 0),
+                             &session_);
+    session_.ActivateStream(stream_);
+  }
+
+  MockClock clock_;
+  PooledConnectionHelper helper_;
+  MockAlarmFactory alarm_factory_;
+  MockQuicConnection* connection_;  // Owned by |session_|.
+  NiceMock<MockQuicSpdySession> session_;
+  TestPacketWriter* writer_;  // Owned by |connection_|.
+  TestStream* stream_;        // Owned by |session_|.
+};
+
+TEST_F(QuicSpdyStreamDatagramTest, DatagramsShareOnePacket) {
+  const std::string payload(100, 'a');
+  const absl::string_view payloads[] = {payload, payload, payload};
+
+  EXPECT_EQ(3u, stream_->SendHttp3Datagrams(payloads));
+  // One DATAGRAM frame per payload, all in the packet flushed at the end.
+  EXPECT_EQ(1u, writer_->packets_write_attempts());
+  EXPECT_EQ(3u, writer_->message_frames().size());
+  // The buffers of the datagrams are freed once their packet is serialized,
+  // and go back to the pool.
+  EXPECT_EQ(3u, helper_.allocator().num_free_buffers());
+  EXPECT_EQ(0u, helper_.allocator().num_reused());
+
+  // The next datagrams reuse them.
+  EXPECT_EQ(3u, stream_->SendHttp3Datagrams(payloads));
+  EXPECT_EQ(2u, writer_->packets_write_attempts());
+  EXPECT_EQ(3u, writer_->message_frames().size());
+  EXPECT_EQ(3u, helper_.allocator().num_free_buffers());
+  EXPECT_EQ(3u, helper_.allocator().num_reused());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -63,7 +63,7 @@ bool SpdyUtils::CopyAndValidateHeaders(const QuicHeaderList& header_list,
                                        int64_t* content_length,
                                        Http2HeaderBlock* headers) {
   for (const auto& p : header_list) {
-    const std::string& name = p.first;
+    absl::string_view name = p.first;
     if (name.empty()) {
       QUIC_DLOG(ERROR) << "Header name must not be empty.";
       return false;
@@ -93,7 +93,7 @@ bool SpdyUtils::CopyAndValidateTrailers(const QuicHeaderList& header_list,
                                         Http2HeaderBlock* trailers) {
   bool found_final_byte_offset = false;
   for (const auto& p : header_list) {
-    const std::string& name = p.first;
+    absl::string_view name = p.first;
 
     // Pull out the final offset pseudo header which indicates the number of
     // response body bytes expected.
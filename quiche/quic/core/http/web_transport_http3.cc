@@ -289,6 +289,11 @@ webtransport::DatagramStatus WebTransportHttp3::SendOrQueueDatagram(
       connect_stream_->SendHttp3Datagram(datagram));
 }
 
+size_t WebTransportHttp3::SendOrQueueDatagrams(
+    absl::Span<const absl::string_view> datagrams) {
+  return connect_stream_->SendHttp3Datagrams(datagrams);
+}
+
 QuicByteCount WebTransportHttp3::GetMaxDatagramSize() const {
   return connect_stream_->GetMaxDatagramSize();
 }
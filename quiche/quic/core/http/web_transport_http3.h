@@ -11,6 +11,7 @@
 #include "absl/container/flat_hash_set.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/http/quic_spdy_session.h"
 #include "quiche/quic/core/http/web_transport_stream_adapter.h"
 #include "quiche/quic/core/quic_error_codes.h"
@@ -86,6 +87,9 @@ class QUIC_EXPORT_PRIVATE WebTransportHttp3
 
   webtransport::DatagramStatus SendOrQueueDatagram(
       absl::string_view datagram) override;
+  // Sends or queues |datagrams|, several per packet.  Returns the number of
+  // datagrams sent or queued; the ones after them failed.
+  size_t SendOrQueueDatagrams(absl::Span<const absl::string_view> datagrams);
   QuicByteCount GetMaxDatagramSize() const override;
   void SetDatagramMaxTimeInQueue(absl::Duration max_time_in_queue) override;
 
@@ -37,7 +37,8 @@ QpackEncoder::QpackEncoder(
     : decoder_stream_error_delegate_(decoder_stream_error_delegate),
       decoder_stream_receiver_(this),
       maximum_blocked_streams_(0),
-      header_list_count_(0) {
+      header_list_count_(0),
+      speculative_insert_count_(0) {
   QUICHE_DCHECK(decoder_stream_error_delegate_);
 }
 
@@ -73,6 +74,38 @@ QpackEncoder::Representation QpackEncoder::EncodeLiteralHeaderField(
   return Representation::LiteralHeaderField(name, value);
 }
 
+bool QpackEncoder::ShouldInsert(absl::string_view name,
+                                absl::string_view value) {
+  return encoding_strategy_ == nullptr ||
+         encoding_strategy_->ShouldInsert(name, value);
+}
+
+bool QpackEncoder::MaybeInsertSpeculatively(
+    QpackEncoderHeaderTable::MatchType match_type, bool is_static,
+    uint64_t index, absl::string_view name, absl::string_view value,
+    uint64_t smallest_non_evictable_index) {
+  if (encoding_strategy_ == nullptr || !encoder_stream_sender_.CanWrite() ||
+      QpackEntry::Size(name, value) >
+          header_table_.MaxInsertSizeWithoutEvictingGivenEntry(
+              smallest_non_evictable_index) ||
+      !encoding_strategy_->ShouldInsertSpeculatively(name, value)) {
+    return false;
+  }
+  if (match_type == QpackEncoderHeaderTable::MatchType::kName) {
+    encoder_stream_sender_.SendInsertWithNameReference(
+        is_static,
+        is_static ? index
+                  : QpackAbsoluteIndexToEncoderStreamRelativeIndex(
+                        index, header_table_.inserted_entry_count()),
+        value);
+  } else {
+    encoder_stream_sender_.SendInsertWithoutNameReference(name, value);
+  }
+  header_table_.InsertEntry(name, value);
+  ++speculative_insert_count_;
+  return true;
+}
+
 QpackEncoder::Representations QpackEncoder::FirstPassEncode(
     QuicStreamId stream_id, const spdy::Http2HeaderBlock& header_list,
     QpackBlockingManager::IndexSet* referred_indices,
@@ -121,9 +154,12 @@ QpackEncoder::Representations QpackEncoder::FirstPassEncode(
     // These strings are owned by |header_list|.
     absl::string_view name = header.first;
     absl::string_view value = header.second;
+    if (encoding_strategy_ != nullptr) {
+      encoding_strategy_->OnHeaderField(name, value);
+    }
 
-    bool is_static;
-    uint64_t index;
+    bool is_static = false;
+    uint64_t index = 0;
 
     auto match_type =
         header_table_.FindHeaderField(name, value, &is_static, &index);
@@ -188,10 +224,13 @@ QpackEncoder::Representations QpackEncoder::FirstPassEncode(
 
       case QpackEncoderHeaderTable::MatchType::kName:
         if (is_static) {
-          if (blocking_allowed &&
-              QpackEntry::Size(name, value) <=
-                  header_table_.MaxInsertSizeWithoutEvictingGivenEntry(
-                      smallest_non_evictable_index)) {
+          if (!blocking_allowed) {
+            MaybeInsertSpeculatively(match_type, is_static, index, name, value,
+                                     smallest_non_evictable_index);
+          } else if (QpackEntry::Size(name, value) <=
+                         header_table_.MaxInsertSizeWithoutEvictingGivenEntry(
+                             smallest_non_evictable_index) &&
+                     ShouldInsert(name, value)) {
             // If allowed, insert entry into dynamic table and refer to it.
             if (can_write_to_encoder_stream) {
               encoder_stream_sender_.SendInsertWithNameReference(is_static,
@@ -215,11 +254,14 @@ QpackEncoder::Representations QpackEncoder::FirstPassEncode(
 
         if (!blocking_allowed) {
           blocked_stream_limit_exhausted = true;
+          MaybeInsertSpeculatively(
+              match_type, is_static, index, name, value,
+              std::min(smallest_non_evictable_index, index));
         } else if (QpackEntry::Size(name, value) >
                    header_table_.MaxInsertSizeWithoutEvictingGivenEntry(
                        std::min(smallest_non_evictable_index, index))) {
           dynamic_table_insertion_blocked = true;
-        } else {
+        } else if (ShouldInsert(name, value)) {
           // If allowed, insert entry with name reference and refer to it.
           if (can_write_to_encoder_stream) {
             encoder_stream_sender_.SendInsertWithNameReference(
@@ -263,11 +305,13 @@ QpackEncoder::Representations QpackEncoder::FirstPassEncode(
         // If allowed, insert entry and refer to it.
         if (!blocking_allowed) {
           blocked_stream_limit_exhausted = true;
+          MaybeInsertSpeculatively(match_type, is_static, index, name, value,
+                                   smallest_non_evictable_index);
         } else if (QpackEntry::Size(name, value) >
                    header_table_.MaxInsertSizeWithoutEvictingGivenEntry(
                        smallest_non_evictable_index)) {
           dynamic_table_insertion_blocked = true;
-        } else {
+        } else if (ShouldInsert(name, value)) {
           if (can_write_to_encoder_stream) {
             encoder_stream_sender_.SendInsertWithoutNameReference(name, value);
             uint64_t new_index = header_table_.InsertEntry(name, value);
@@ -281,9 +325,6 @@ QpackEncoder::Representations QpackEncoder::FirstPassEncode(
         }
 
         // Encode entry as string literals.
-        // TODO(b/112770235): Consider also adding to dynamic table to improve
-        // compression ratio for subsequent header blocks with peers that do not
-        // allow any blocked streams.
         representations.push_back(EncodeLiteralHeaderField(name, value));
 
         break;
@@ -8,12 +8,14 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/strings/string_view.h"
 #include "quiche/quic/core/qpack/qpack_blocking_manager.h"
 #include "quiche/quic/core/qpack/qpack_decoder_stream_receiver.h"
 #include "quiche/quic/core/qpack/qpack_encoder_stream_sender.h"
+#include "quiche/quic/core/qpack/qpack_encoding_strategy.h"
 #include "quiche/quic/core/qpack/qpack_header_table.h"
 #include "quiche/quic/core/qpack/qpack_instructions.h"
 #include "quiche/quic/core/quic_error_codes.h"
@@ -102,6 +104,17 @@ class QUIC_EXPORT_PRIVATE QpackEncoder
     return header_table_.maximum_dynamic_table_capacity();
   }
 
+  // Replaces the default insertion decisions, see QpackEncodingStrategy.
+  void set_encoding_strategy(std::unique_ptr<QpackEncodingStrategy> strategy) {
+    encoding_strategy_ = std::move(strategy);
+  }
+
+  // The number of dynamic table insertions which the header block that caused
+  // them could not refer to.
+  uint64_t speculative_insert_count() const {
+    return speculative_insert_count_;
+  }
+
  private:
   friend class test::QpackEncoderPeer;
 
@@ -140,6 +153,20 @@ class QUIC_EXPORT_PRIVATE QpackEncoder
       QpackBlockingManager::IndexSet* referred_indices,
       QuicByteCount* encoder_stream_sent_byte_count);
 
+  // Returns whether |encoding_strategy_| allows inserting |name| and |value|
+  // for the header block being encoded to refer to.
+  bool ShouldInsert(absl::string_view name, absl::string_view value);
+
+  // Inserts |name| and |value| into the dynamic table without referring to the
+  // new entry, if |encoding_strategy_| asks for it and the entry fits without
+  // evicting |smallest_non_evictable_index| or newer entries. For a kName
+  // |match_type|, the insertion refers to the name of entry |index|. Returns
+  // true if the entry was inserted.
+  bool MaybeInsertSpeculatively(QpackEncoderHeaderTable::MatchType match_type,
+                                bool is_static, uint64_t index,
+                                absl::string_view name, absl::string_view value,
+                                uint64_t smallest_non_evictable_index);
+
   // Performs second pass of two-pass encoding: serializes representations
   // generated in first pass, transforming absolute indices of dynamic table
   // entries to relative indices.
@@ -153,6 +180,8 @@ class QUIC_EXPORT_PRIVATE QpackEncoder
   uint64_t maximum_blocked_streams_;
   QpackBlockingManager blocking_manager_;
   int header_list_count_;
+  std::unique_ptr<QpackEncodingStrategy> encoding_strategy_;
+  uint64_t speculative_insert_count_;
 };
 
 // QpackEncoder::DecoderStreamErrorDelegate implementation that does nothing.
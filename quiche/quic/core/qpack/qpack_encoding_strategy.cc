@@ -0,0 +1,147 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/qpack/qpack_encoding_strategy.h"
+
+#include <limits>
+#include <utility>
+
+#include "absl/hash/hash.h"
+#include "quiche/quic/core/qpack/qpack_header_table.h"
+#include "quiche/common/platform/api/quiche_logging.h"
+
+namespace quic {
+
+namespace {
+
+// Field keys mix in a different seed than name keys, so that the name "a" and
+// the header field ("a", "") get different keys.
+constexpr uint64_t kFieldSeed = 0x9e3779b97f4a7c15;
+
+uint64_t NonZero(uint64_t hash) { return hash == 0 ? 1 : hash; }
+
+}  // namespace
+
+QpackFrequencyEncodingStrategy::QpackFrequencyEncodingStrategy(
+    size_t num_slots)
+    : slots_(num_slots) {
+  QUICHE_DCHECK_GE(num_slots, 4u);
+  QUICHE_DCHECK_EQ(0u, num_slots & (num_slots - 1));
+}
+
+// static
+uint64_t QpackFrequencyEncodingStrategy::NameKey(absl::string_view name) {
+  return NonZero(absl::Hash<absl::string_view>()(name));
+}
+
+// static
+uint64_t QpackFrequencyEncodingStrategy::FieldKey(absl::string_view name,
+                                                  absl::string_view value) {
+  return NonZero(absl::Hash<std::pair<absl::string_view, absl::string_view>>()(
+                     std::make_pair(name, value)) ^
+                 kFieldSeed);
+}
+
+const QpackFrequencyEncodingStrategy::Slot*
+QpackFrequencyEncodingStrategy::Find(uint64_t key) const {
+  const size_t mask = slots_.size() - 1;
+  for (size_t i = key & mask;; i = (i + 1) & mask) {
+    const Slot& slot = slots_[i];
+    if (slot.key == key) {
+      return &slot;
+    }
+    if (slot.key == 0) {
+      return nullptr;
+    }
+  }
+}
+
+QpackFrequencyEncodingStrategy::Slot*
+QpackFrequencyEncodingStrategy::FindOrInsert(uint64_t key) {
+  const Slot* existing = Find(key);
+  if (existing != nullptr) {
+    return const_cast<Slot*>(existing);
+  }
+  QUICHE_DCHECK_LT(size_, slots_.size());
+  const size_t mask = slots_.size() - 1;
+  size_t i = key & mask;
+  while (slots_[i].key != 0) {
+    i = (i + 1) & mask;
+  }
+  slots_[i].key = key;
+  ++size_;
+  return &slots_[i];
+}
+
+void QpackFrequencyEncodingStrategy::Age() {
+  std::vector<Slot> old_slots(slots_.size());
+  slots_.swap(old_slots);
+  size_ = 0;
+  const size_t mask = slots_.size() - 1;
+  for (const Slot& old_slot : old_slots) {
+    if (old_slot.count < 2) {
+      continue;
+    }
+    size_t i = old_slot.key & mask;
+    while (slots_[i].key != 0) {
+      i = (i + 1) & mask;
+    }
+    slots_[i] = old_slot;
+    slots_[i].count /= 2;
+    slots_[i].repeats /= 2;
+    ++size_;
+  }
+}
+
+void QpackFrequencyEncodingStrategy::OnHeaderField(absl::string_view name,
+                                                   absl::string_view value) {
+  constexpr uint16_t kMaxCount = std::numeric_limits<uint16_t>::max();
+  // Make room for a new name and a new field up front, so that aging does not
+  // drop the field being counted.
+  while (4 * (size_ + 2) > 3 * slots_.size()) {
+    Age();
+  }
+  Slot* field = FindOrInsert(FieldKey(name, value));
+  const bool repeated = field->count > 0;
+  if (field->count < kMaxCount) {
+    ++field->count;
+  }
+  Slot* name_slot = FindOrInsert(NameKey(name));
+  if (name_slot->count < kMaxCount) {
+    ++name_slot->count;
+    if (repeated) {
+      ++name_slot->repeats;
+    }
+  }
+}
+
+uint16_t QpackFrequencyEncodingStrategy::FieldCount(
+    absl::string_view name, absl::string_view value) const {
+  const Slot* field = Find(FieldKey(name, value));
+  return field == nullptr ? 0 : field->count;
+}
+
+bool QpackFrequencyEncodingStrategy::ValuesRepeat(
+    absl::string_view name) const {
+  const Slot* name_slot = Find(NameKey(name));
+  if (name_slot == nullptr || name_slot->count < kMinNameOccurrences) {
+    return true;
+  }
+  // At least a quarter of the occurrences repeat an earlier value.
+  return 4 * name_slot->repeats >= name_slot->count;
+}
+
+bool QpackFrequencyEncodingStrategy::ShouldInsert(absl::string_view name,
+                                                  absl::string_view value) {
+  return FieldCount(name, value) >= 2 || ValuesRepeat(name);
+}
+
+bool QpackFrequencyEncodingStrategy::ShouldInsertSpeculatively(
+    absl::string_view name, absl::string_view value) {
+  return FieldCount(name, value) >= 2 ||
+         (QpackEntry::Size(name, value) >= kMinSpeculativeEntrySize &&
+          ValuesRepeat(name));
+}
+
+}  // namespace quic
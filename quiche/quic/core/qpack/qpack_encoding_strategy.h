@@ -0,0 +1,105 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QPACK_QPACK_ENCODING_STRATEGY_H_
+#define QUICHE_QUIC_CORE_QPACK_QPACK_ENCODING_STRATEGY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "quiche/quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// Decides which header fields QpackEncoder inserts into the dynamic table.
+// Without a strategy, QpackEncoder inserts every header field that the header
+// block being encoded can refer to, and nothing else.
+class QUIC_EXPORT_PRIVATE QpackEncodingStrategy {
+ public:
+  virtual ~QpackEncodingStrategy() = default;
+
+  // Called for every header field of every header list, in order, before the
+  // encoder asks about it.
+  virtual void OnHeaderField(absl::string_view name,
+                             absl::string_view value) = 0;
+
+  // Returns whether to insert a header field which the header block being
+  // encoded then refers to.
+  virtual bool ShouldInsert(absl::string_view name,
+                            absl::string_view value) = 0;
+
+  // Returns whether to insert a header field which the header block being
+  // encoded cannot refer to, because the blocked streams limit is reached. The
+  // header field is encoded as a literal, and later header blocks refer to the
+  // entry without blocking once the decoder acknowledges the insertion.
+  virtual bool ShouldInsertSpeculatively(absl::string_view name,
+                                         absl::string_view value) = 0;
+};
+
+// Tracks how often every header name and header field occurs on a connection,
+// in a fixed-size open-addressing table of hashes which halves its counts when
+// it fills up, so that old fields age out.
+//
+// Header fields whose name has values that repeat, like cookies, user agents
+// and authorization tokens, are inserted, and large ones are inserted
+// speculatively on first sight. Header fields whose name takes a new value on
+// every request, like :path or request IDs, are only inserted once the same
+// value occurs again, so that they do not evict reusable entries.
+class QUIC_EXPORT_PRIVATE QpackFrequencyEncodingStrategy
+    : public QpackEncodingStrategy {
+ public:
+  // The number of occurrences of a name below which its values are assumed to
+  // repeat.
+  static constexpr uint16_t kMinNameOccurrences = 4;
+  // The size of the smallest entry, including the entry overhead, which is
+  // inserted speculatively on first sight.
+  static constexpr size_t kMinSpeculativeEntrySize = 96;
+
+  // Tracks up to three quarters of |num_slots| names and header fields.
+  // |num_slots| must be a power of two.
+  explicit QpackFrequencyEncodingStrategy(size_t num_slots = 256);
+
+  // QpackEncodingStrategy implementation.
+  void OnHeaderField(absl::string_view name, absl::string_view value) override;
+  bool ShouldInsert(absl::string_view name, absl::string_view value) override;
+  bool ShouldInsertSpeculatively(absl::string_view name,
+                                 absl::string_view value) override;
+
+  // Returns the number of occurrences of |name| with |value|, after aging.
+  uint16_t FieldCount(absl::string_view name, absl::string_view value) const;
+
+  // Returns false if |name| occurred often enough and with few enough repeated
+  // values to treat its values as unique.
+  bool ValuesRepeat(absl::string_view name) const;
+
+  // The number of names and header fields tracked.
+  size_t size() const { return size_; }
+
+ private:
+  struct Slot {
+    // Zero for empty slots.
+    uint64_t key = 0;
+    uint16_t count = 0;
+    // For names, the number of occurrences with a value that occurred before.
+    uint16_t repeats = 0;
+  };
+
+  static uint64_t NameKey(absl::string_view name);
+  static uint64_t FieldKey(absl::string_view name, absl::string_view value);
+
+  const Slot* Find(uint64_t key) const;
+  // Returns the slot of |key|, claiming an empty one if needed.
+  Slot* FindOrInsert(uint64_t key);
+  // Halves all counts and drops the slots that reach zero.
+  void Age();
+
+  std::vector<Slot> slots_;
+  size_t size_ = 0;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QPACK_QPACK_ENCODING_STRATEGY_H_
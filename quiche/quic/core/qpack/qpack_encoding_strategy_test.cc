@@ -0,0 +1,140 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/qpack/qpack_encoding_strategy.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "quiche/quic/core/qpack/qpack_encoder.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/qpack/qpack_test_utils.h"
+#include "quiche/spdy/core/http2_header_block.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+const std::string kCookie(200, 'c');
+
+TEST(QpackFrequencyEncodingStrategyTest, CountsFields) {
+  QpackFrequencyEncodingStrategy strategy;
+  EXPECT_EQ(0u, strategy.FieldCount("cookie", kCookie));
+  strategy.OnHeaderField("cookie", kCookie);
+  strategy.OnHeaderField("cookie", kCookie);
+  strategy.OnHeaderField("cookie", "other");
+  EXPECT_EQ(2u, strategy.FieldCount("cookie", kCookie));
+  EXPECT_EQ(1u, strategy.FieldCount("cookie", "other"));
+  EXPECT_EQ(0u, strategy.FieldCount("cookie", ""));
+  // One name and two fields.
+  EXPECT_EQ(3u, strategy.size());
+}
+
+TEST(QpackFrequencyEncodingStrategyTest, SkipsUniqueValues) {
+  QpackFrequencyEncodingStrategy strategy;
+  for (int i = 0; i < 8; ++i) {
+    const std::string path = absl::StrCat("/resource/", i);
+    strategy.OnHeaderField(":path", path);
+    strategy.OnHeaderField("user-agent", "agent");
+    // Unknown names are assumed to repeat.
+    if (i + 1 < QpackFrequencyEncodingStrategy::kMinNameOccurrences) {
+      EXPECT_TRUE(strategy.ShouldInsert(":path", path));
+    }
+    EXPECT_TRUE(strategy.ShouldInsert("user-agent", "agent"));
+  }
+  EXPECT_FALSE(strategy.ValuesRepeat(":path"));
+  EXPECT_TRUE(strategy.ValuesRepeat("user-agent"));
+  EXPECT_FALSE(strategy.ShouldInsert(":path", "/resource/8"));
+  EXPECT_FALSE(strategy.ShouldInsertSpeculatively(":path", "/resource/8"));
+  // A unique-looking name is inserted once a value repeats.
+  strategy.OnHeaderField(":path", "/resource/7");
+  EXPECT_TRUE(strategy.ShouldInsert(":path", "/resource/7"));
+  EXPECT_TRUE(strategy.ShouldInsertSpeculatively(":path", "/resource/7"));
+}
+
+TEST(QpackFrequencyEncodingStrategyTest, SpeculativeInsertions) {
+  QpackFrequencyEncodingStrategy strategy;
+  strategy.OnHeaderField("cookie", kCookie);
+  strategy.OnHeaderField("accept", "*/*");
+  // Large entries are inserted on first sight, small ones when they repeat.
+  EXPECT_TRUE(strategy.ShouldInsertSpeculatively("cookie", kCookie));
+  EXPECT_FALSE(strategy.ShouldInsertSpeculatively("accept", "*/*"));
+  strategy.OnHeaderField("accept", "*/*");
+  EXPECT_TRUE(strategy.ShouldInsertSpeculatively("accept", "*/*"));
+}
+
+TEST(QpackFrequencyEncodingStrategyTest, AgesOutOldFields) {
+  QpackFrequencyEncodingStrategy strategy(/*num_slots=*/16);
+  for (int i = 0; i < 4; ++i) {
+    strategy.OnHeaderField("cookie", kCookie);
+  }
+  for (int i = 0; i < 100; ++i) {
+    strategy.OnHeaderField("cookie", kCookie);
+    strategy.OnHeaderField("x-request-id", absl::StrCat(i));
+    EXPECT_LE(4 * strategy.size(), 3 * 16u);
+  }
+  // Frequent fields survive aging with reduced counts, one-off ones do not.
+  EXPECT_LT(1u, strategy.FieldCount("cookie", kCookie));
+  EXPECT_GT(104u, strategy.FieldCount("cookie", kCookie));
+  EXPECT_EQ(0u, strategy.FieldCount("x-request-id", "0"));
+  EXPECT_EQ(1u, strategy.FieldCount("x-request-id", "99"));
+  EXPECT_FALSE(strategy.ValuesRepeat("x-request-id"));
+}
+
+class QpackEncoderSpeculativeInsertionTest : public QuicTest {
+ protected:
+  QpackEncoderSpeculativeInsertionTest() : encoder_(&error_delegate_) {
+    encoder_.set_qpack_stream_sender_delegate(&stream_sender_delegate_);
+    encoder_.SetMaximumDynamicTableCapacity(4096);
+    encoder_.SetDynamicTableCapacity(4096);
+    // The peer does not allow blocked streams.
+    encoder_.SetMaximumBlockedStreams(0);
+    header_list_[":method"] = "GET";
+    header_list_["cookie"] = kCookie;
+  }
+
+  std::string Encode(QuicStreamId stream_id) {
+    return encoder_.EncodeHeaderList(stream_id, header_list_,
+                                     &encoder_stream_sent_byte_count_);
+  }
+
+  NoopDecoderStreamErrorDelegate error_delegate_;
+  NoopQpackStreamSenderDelegate stream_sender_delegate_;
+  QpackEncoder encoder_;
+  spdy::Http2HeaderBlock header_list_;
+  QuicByteCount encoder_stream_sent_byte_count_ = 0;
+};
+
+TEST_F(QpackEncoderSpeculativeInsertionTest, NoInsertionsWithoutStrategy) {
+  const std::string first = Encode(0);
+  EXPECT_EQ(0u, encoder_stream_sent_byte_count_);
+  EXPECT_EQ(first, Encode(4));
+  EXPECT_EQ(0u, encoder_.speculative_insert_count());
+}
+
+TEST_F(QpackEncoderSpeculativeInsertionTest, RefersToAcknowledgedEntries) {
+  encoder_.set_encoding_strategy(
+      std::make_unique<QpackFrequencyEncodingStrategy>());
+  // The cookie is inserted, but the header block cannot refer to it.
+  EXPECT_LT(100u, Encode(0).size());
+  EXPECT_LT(100u, encoder_stream_sent_byte_count_);
+  EXPECT_EQ(1u, encoder_.speculative_insert_count());
+  EXPECT_FALSE(encoder_.dynamic_table_entry_referenced());
+
+  // Until the insertion is acknowledged, the cookie remains a literal.
+  EXPECT_LT(100u, Encode(4).size());
+  EXPECT_EQ(0u, encoder_stream_sent_byte_count_);
+  EXPECT_EQ(1u, encoder_.speculative_insert_count());
+
+  encoder_.OnInsertCountIncrement(1);
+  const std::string third = Encode(8);
+  EXPECT_GT(10u, third.size());
+  EXPECT_EQ(0u, encoder_stream_sent_byte_count_);
+  EXPECT_TRUE(encoder_.dynamic_table_entry_referenced());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
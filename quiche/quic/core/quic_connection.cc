@@ -33,6 +33,7 @@
 #include "quiche/quic/core/quic_constants.h"
 #include "quiche/quic/core/quic_session.h"
 #include "quiche/quic/core/quic_error_codes.h"
+#include "quiche/quic/core/quic_hot_path_profiler.h"
 #include "quiche/quic/core/quic_packet_creator.h"
 #include "quiche/quic/core/quic_packet_writer.h"
 #include "quiche/quic/core/quic_packets.h"
@@ -662,6 +663,9 @@ void QuicConnection::SetFromConfig(const QuicConfig& config) {
     debug_visitor_->OnSetFromConfig(config);
   }
   uber_received_packet_manager_.SetFromConfig(config, perspective_);
+  if (config.HasClientSentConnectionOption(kAKDB, perspective_)) {
+    batch_acks_per_read_burst_ = true;
+  }
   if (config.HasClientSentConnectionOption(k5RTO, perspective_)) {
     num_rtos_for_blackhole_detection_ = 5;
   }
@@ -2384,6 +2388,9 @@ void QuicConnection::OnKeyUpdate(KeyUpdateReason reason) {
 
   lowest_packet_sent_in_current_key_phase_.Clear();
   stats_.key_update_count++;
+  if (framer_.last_key_update_used_prepared_keys()) {
+    stats_.num_key_updates_with_prepared_keys++;
+  }
 
   // If another key update triggers while the previous
   // discard_previous_one_rtt_keys_alarm_ hasn't fired yet, cancel it since the
@@ -2726,6 +2733,7 @@ void QuicConnection::ProcessUdpPacket(const QuicSocketAddress& self_address,
   if (!connected_) {
     return;
   }
+  QUIC_HOT_PATH_PROBE(HOT_PATH_PROCESS_UDP_PACKET);
   QUIC_DVLOG(2) << ENDPOINT << "Received encrypted " << packet.length()
                 << " bytes:" << std::endl
                 << quiche::QuicheTextUtils::HexDump(
@@ -2839,7 +2847,10 @@ void QuicConnection::ProcessUdpPacket(const QuicSocketAddress& self_address,
   //MaybeSendInResponseToPacket();
   //if (!HandleWriteBlocked())
   //if (connected_)
-  {
+  if (in_read_burst_) {
+    // Acks and data are sent once the whole burst is processed.
+    read_burst_needs_write_ = true;
+  } else {
     OnCanWrite();
 
     if (perspective_ == Perspective::IS_CLIENT && !retransmission_alarm_->IsSet()) //TODO2 hybchanged
@@ -2851,6 +2862,31 @@ void QuicConnection::ProcessUdpPacket(const QuicSocketAddress& self_address,
   is_current_packet_connectivity_probing_ = false;
 }
 
+void QuicConnection::OnReadBurstStart() {
+  if (!batch_acks_per_read_burst_ || in_read_burst_) {
+    return;
+  }
+  in_read_burst_ = true;
+}
+
+void QuicConnection::OnReadBurstEnd() {
+  if (!in_read_burst_) {
+    return;
+  }
+  in_read_burst_ = false;
+  const bool needs_write = read_burst_needs_write_;
+  read_burst_needs_write_ = false;
+  if (!needs_write || !connected_) {
+    return;
+  }
+  ++stats_.read_bursts_batched;
+  OnCanWrite();
+  if (perspective_ == Perspective::IS_CLIENT &&
+      !retransmission_alarm_->IsSet()) {
+    SetPingAlarm();
+  }
+}
+
 void QuicConnection::OnBlockedWriterCanWrite() {
   writer_->SetWritable();
   OnCanWrite();
@@ -3223,7 +3259,9 @@ bool QuicConnection::ShouldGeneratePacket(
 }
 
 const QuicFrame QuicConnection::MaybeBundleAckOpportunistically() {
-  if (sent_packet_manager_.CanSendAckFrequency() && !ack_frequency_sent_) {
+  if (sent_packet_manager_.CanSendAckFrequency() &&
+      (!ack_frequency_sent_ ||
+       sent_packet_manager_.ShouldUpdateAckFrequency())) {
     if (packet_creator_.NextSendingPacketNumber() >=
         FirstSendingPacketNumber() + kMinReceivedBeforeAckDecimation) {
       QUIC_RELOADABLE_FLAG_COUNT_N(quic_can_send_ack_frequency, 3, 3);
@@ -3740,6 +3778,10 @@ bool QuicConnection::MaybeHandleAeadConfidentialityLimits(
 
   const QuicPacketCount confidentiality_limit =
       framer_.GetOneRttEncrypterConfidentialityLimit();
+  stats_.aead_confidentiality_limit = confidentiality_limit;
+  stats_.max_packets_encrypted_in_key_phase =
+      std::max(stats_.max_packets_encrypted_in_key_phase,
+               num_packets_encrypted_in_current_key_phase);
 
   // Attempt to initiate a key update before reaching the AEAD
   // confidentiality limit when the number of packets sent in the current
@@ -4017,6 +4059,12 @@ void QuicConnection::MaybeSendConnectionIdToClient() {
 
 void QuicConnection::OnHandshakeComplete() {
   sent_packet_manager_.SetHandshakeConfirmed();
+  // The 1-RTT keys are installed and confirmed, so the keys of the first key
+  // update are derived now rather than when it happens. Later key phases are
+  // prepared by DiscardPreviousOneRttKeys().
+  if (GetQuicFlag(quic_prepare_next_one_rtt_keys)) {
+    framer_.PrepareNextOneRttKeys();
+  }
 #if QUIC_TLS_SESSION //TODO3 more fast on server.
   if (connection_migration_use_new_cid_ &&
       perspective_ == Perspective::IS_SERVER &&
@@ -4344,6 +4392,12 @@ void QuicConnection::RemoveDecrypter(EncryptionLevel level) {
 
 void QuicConnection::DiscardPreviousOneRttKeys() {
   framer_.DiscardPreviousOneRttKeys();
+  // This runs from an alarm three PTOs into every key phase, which is also
+  // when the keys of the next key phase are derived, so that key updates
+  // don't run HKDF and create crypters on the packet path.
+  if (GetQuicFlag(quic_prepare_next_one_rtt_keys)) {
+    framer_.PrepareNextOneRttKeys();
+  }
 }
 
 #if QUIC_TLS_SESSION
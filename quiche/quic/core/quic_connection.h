@@ -1220,6 +1220,14 @@ class QUIC_EXPORT_PRIVATE QuicConnection final
     can_receive_ack_frequency_frame_ = true;
   }
 
+  // Called by the packet processor before and after processing a burst of
+  // packets read from the socket with a single system call. If kAKDB was
+  // negotiated, packets of the burst do not trigger any write, so that a
+  // single ACK covers the whole burst rather than every few packets of it.
+  void OnReadBurstStart();
+  void OnReadBurstEnd();
+  bool in_read_burst() const { return in_read_burst_; }
+
   bool is_processing_packet() const { return framer_.is_processing_packet(); }
 
   bool HasPendingPathValidation() const;
@@ -2244,6 +2252,16 @@ class QUIC_EXPORT_PRIVATE QuicConnection final
   // Indicate whether AckFrequency frame has been sent.
   bool ack_frequency_sent_ = false;
 
+  // True if kAKDB was negotiated, see OnReadBurstStart().
+  bool batch_acks_per_read_burst_ = false;
+
+  // True between OnReadBurstStart() and OnReadBurstEnd().
+  bool in_read_burst_ = false;
+
+  // True if a packet was processed during the current read burst, such that
+  // the connection needs to write when it ends.
+  bool read_burst_needs_write_ = false;
+
   // True if a 0-RTT decrypter was or is installed at some point in the
   // connection's lifetime.
   bool had_zero_rtt_decrypter_ = false;
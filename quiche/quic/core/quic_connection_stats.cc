@@ -86,10 +86,20 @@ std::ostream& operator<<(std::ostream& os, const QuicConnectionStats& s) {
   os << " num_coalesced_packets_received: " << s.num_coalesced_packets_received;
   if (s.num_coalesced_packets_processed)
   os << " num_coalesced_packets_processed: "<< s.num_coalesced_packets_processed;
+  if (s.read_bursts_batched)
+  os << " read_bursts_batched: " << s.read_bursts_batched;
   if (s.num_ack_aggregation_epochs)
   os << " num_ack_aggregation_epochs: " << s.num_ack_aggregation_epochs;
   if (s.key_update_count)
   os << " key_update_count: " << s.key_update_count;
+  if (s.num_key_updates_with_prepared_keys)
+  os << " num_key_updates_with_prepared_keys: "
+     << s.num_key_updates_with_prepared_keys;
+  if (s.aead_confidentiality_limit)
+  os << " aead_confidentiality_limit: " << s.aead_confidentiality_limit;
+  if (s.max_packets_encrypted_in_key_phase)
+  os << " max_packets_encrypted_in_key_phase: "
+     << s.max_packets_encrypted_in_key_phase;
   if (s.num_failed_authentication_packets_received)
   os << " num_failed_authentication_packets_received: "
      << s.num_failed_authentication_packets_received;
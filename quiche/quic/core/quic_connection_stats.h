@@ -40,6 +40,9 @@ struct QUIC_EXPORT_PRIVATE QuicConnectionStats {
   QuicPacketCount ack_packets_recv = 0;
   // Excludes packets which were not processable.
   QuicPacketCount packets_processed = 0;
+  // Number of read bursts whose packets were all acked at once, see
+  // QuicConnection::OnReadBurstStart().
+  QuicPacketCount read_bursts_batched = 0;
   QuicByteCount stream_bytes_received = 0;  // Bytes received in a stream frame.
 
   QuicByteCount bytes_retransmitted = 0;
@@ -192,6 +195,14 @@ struct QUIC_EXPORT_PRIVATE QuicConnectionStats {
   // initiated key update, this is incremented when the keys are updated, before
   // the peer has acknowledged the key update.
   uint16_t key_update_count = 0;
+  // Number of key updates which swapped in the keys of the next key phase
+  // derived ahead of time, instead of deriving them on the packet path.
+  uint16_t num_key_updates_with_prepared_keys = 0;
+
+  // AEAD confidentiality limit of the current 1-RTT encrypter, and the largest
+  // number of packets encrypted in a key phase so far.
+  QuicPacketCount aead_confidentiality_limit = 0;
+  QuicPacketCount max_packets_encrypted_in_key_phase = 0;
 
   // Counts the number of undecryptable packets received across all keys. Does
   // not include packets where a decryption key for that level was absent.
@@ -0,0 +1,103 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_connection.h"
+
+#include "quiche/quic/core/quic_alarm.h"
+#include "quiche/quic/core/quic_framer.h"
+#include "quiche/quic/core/quic_types.h"
+#include "quiche/quic/platform/api/quic_flags.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/quic_connection_peer.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+
+using testing::NiceMock;
+
+namespace quic {
+namespace test {
+namespace {
+
+class QuicConnectionKeyUpdateTest : public QuicTest {
+ protected:
+  QuicConnectionKeyUpdateTest()
+      : connection_(new NiceMock<MockQuicConnection>(
+            &helper_, &alarm_factory_, Perspective::IS_SERVER)),
+        session_(connection_, /*create_mock_crypto_stream=*/false),
+        crypto_stream_(new KeyUpdateCryptoStream(&session_)),
+        framer_(QuicConnectionPeer::GetFramer(connection_)) {
+    session_.SetCryptoStream(crypto_stream_);
+    QuicConnectionPeer::EnableKeyUpdate(connection_);
+    connection_->SetEncrypter(ENCRYPTION_FORWARD_SECURE,
+                              crypto_stream_->CreateCurrentOneRttEncrypter());
+    connection_->InstallDecrypter(
+        ENCRYPTION_FORWARD_SECURE,
+        crypto_stream_->CreateCurrentOneRttDecrypter());
+  }
+
+  // Starts a new key phase the way the first packet of the peer in it does.
+  void ReceiveKeyUpdate() {
+    ASSERT_TRUE(framer_->DoKeyUpdate(KeyUpdateReason::kRemote));
+    connection_->OnDecryptedFirstPacketInKeyPhase();
+  }
+
+  MockQuicConnectionHelper helper_;
+  MockAlarmFactory alarm_factory_;
+  MockQuicConnection* connection_;  // Owned by |session_|.
+  NiceMock<MockQuicSession> session_;
+  KeyUpdateCryptoStream* crypto_stream_;  // Owned by |session_|.
+  QuicFramer* framer_;
+};
+
+TEST_F(QuicConnectionKeyUpdateTest, KeyUpdatesUsePreparedKeys) {
+  SetQuicFlag(quic_prepare_next_one_rtt_keys, true);
+  // The keys of the first key update are prepared with the handshake.
+  connection_->OnHandshakeComplete();
+  EXPECT_TRUE(framer_->HasNextOneRttKeys());
+  EXPECT_EQ(1, crypto_stream_->num_keys_derived());
+
+  QuicAlarm* discard_alarm =
+      QuicConnectionPeer::GetDiscardPreviousOneRttKeysAlarm(connection_);
+  for (int i = 1; i <= 3; ++i) {
+    ReceiveKeyUpdate();
+    // No keys are derived on the packet path.
+    EXPECT_EQ(i, crypto_stream_->num_keys_derived());
+    EXPECT_EQ(static_cast<uint32_t>(i),
+              connection_->GetStats().num_key_updates_with_prepared_keys);
+
+    // The keys of the next key phase are derived when the previous keys are
+    // discarded.
+    ASSERT_TRUE(discard_alarm->IsSet());
+    alarm_factory_.FireAlarm(discard_alarm);
+    EXPECT_TRUE(framer_->HasNextOneRttKeys());
+    EXPECT_EQ(i + 1, crypto_stream_->num_keys_derived());
+  }
+  EXPECT_EQ(3u, connection_->GetStats().key_update_count);
+}
+
+TEST_F(QuicConnectionKeyUpdateTest, KeyUpdateBeforeDiscardAlarmDerivesKeys) {
+  SetQuicFlag(quic_prepare_next_one_rtt_keys, true);
+  connection_->OnHandshakeComplete();
+  ReceiveKeyUpdate();
+  // The peer updates keys again before the previous keys are discarded.
+  ReceiveKeyUpdate();
+  EXPECT_EQ(2u, connection_->GetStats().key_update_count);
+  EXPECT_EQ(1u, connection_->GetStats().num_key_updates_with_prepared_keys);
+  EXPECT_EQ(2, crypto_stream_->num_keys_derived());
+}
+
+TEST_F(QuicConnectionKeyUpdateTest, KeysAreNotPreparedWithFlagOff) {
+  SetQuicFlag(quic_prepare_next_one_rtt_keys, false);
+  connection_->OnHandshakeComplete();
+  EXPECT_FALSE(framer_->HasNextOneRttKeys());
+  ReceiveKeyUpdate();
+  alarm_factory_.FireAlarm(
+      QuicConnectionPeer::GetDiscardPreviousOneRttKeysAlarm(connection_));
+  EXPECT_FALSE(framer_->HasNextOneRttKeys());
+  EXPECT_EQ(1u, connection_->GetStats().key_update_count);
+  EXPECT_EQ(0u, connection_->GetStats().num_key_updates_with_prepared_keys);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
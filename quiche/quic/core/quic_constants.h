@@ -302,6 +302,9 @@ inline constexpr int kDefaultIetfLossDelayShift = 3;
 inline constexpr QuicPacketCount kDefaultRetransmittablePacketsBeforeAck = 2;
 // Wait for up to 10 retransmittable packets before sending an ack.
 inline constexpr QuicPacketCount kMaxRetransmittablePacketsBeforeAck = 10;
+// Wait for up to 64 retransmittable packets before sending an ack when the
+// peer asked for sparse acks, either with kAKDB or with an AckFrequencyFrame.
+inline constexpr QuicPacketCount kMaxAckThinningPacketTolerance = 64;
 // Minimum number of packets received before ack decimation is enabled.
 // This intends to avoid the beginning of slow start, when CWNDs may be
 // rapidly increasing.
@@ -4,6 +4,8 @@
 
 #include "quiche/quic/core/quic_datagram_queue.h"
 
+#include <algorithm>
+
 #include "absl/types/span.h"
 #include "quiche/quic/core/quic_constants.h"
 #include "quiche/quic/core/quic_session.h"
@@ -27,6 +29,21 @@ QuicDatagramQueue::QuicDatagramQueue(QuicSession* session,
 
 MessageStatus QuicDatagramQueue::SendOrQueueDatagram(
     quiche::QuicheMemSlice datagram) {
+  return SendOrQueueDatagram(std::move(datagram), DatagramParameters());
+}
+
+MessageStatus QuicDatagramQueue::SendOrQueueDatagram(
+    quiche::QuicheMemSlice datagram, const DatagramParameters& parameters) {
+  const QuicTime now = clock_->ApproximateNow();
+  const bool has_deadline = parameters.deadline.IsInitialized();
+  if (has_deadline && parameters.deadline <= now) {
+    ++stats_.datagrams_expired;
+    if (observer_) {
+      observer_->OnDatagramProcessed(absl::nullopt);
+    }
+    return MESSAGE_STATUS_BLOCKED;
+  }
+
   // If the queue is non-empty, always queue the daragram.  This ensures that
   // the datagrams are sent in the same order that they were sent by the
   // application.
@@ -41,29 +58,46 @@ MessageStatus QuicDatagramQueue::SendOrQueueDatagram(
     }
   }
 
-  queue_.emplace_back(Datagram{std::move(datagram),
-                               clock_->ApproximateNow() + GetMaxTimeInQueue()});
+  const QuicTime expiry =
+      has_deadline ? parameters.deadline : now + GetMaxTimeInQueue();
+  queue_.push_back(Datagram{
+      std::move(datagram), expiry, now, parameters.priority,
+      has_deadline ? parameters.deadline : QuicTime::Infinite(),
+      next_sequence_number_++});
+  std::push_heap(queue_.begin(), queue_.end(), &SendsAfter);
+  earliest_expiry_ = std::min(earliest_expiry_, expiry);
+  ++stats_.datagrams_queued;
   return MESSAGE_STATUS_BLOCKED;
 }
 
 absl::optional<MessageStatus> QuicDatagramQueue::TrySendingNextDatagram() {
-  RemoveExpiredDatagrams();
+  const QuicTime now = clock_->ApproximateNow();
+  RemoveExpiredDatagrams(now);
   if (queue_.empty()) {
     return absl::nullopt;
   }
 
   MessageResult result =
       session_->SendMessage(absl::MakeSpan(&queue_.front().datagram, 1));
-  if (result.status != MESSAGE_STATUS_BLOCKED) {
-    queue_.pop_front();
-    if (observer_) {
-      observer_->OnDatagramProcessed(result.status);
-    }
+  if (result.status == MESSAGE_STATUS_BLOCKED) {
+    RemoveDatagramsExpiringBeforeRelease();
+    return result.status;
+  }
+  const QuicTime::Delta queueing_delay = now - queue_.front().queued;
+  PopNextDatagram();
+  ++stats_.datagrams_sent_from_queue;
+  stats_.total_queueing_delay = stats_.total_queueing_delay + queueing_delay;
+  stats_.max_queueing_delay =
+      std::max(stats_.max_queueing_delay, queueing_delay);
+  if (observer_) {
+    observer_->OnDatagramProcessed(result.status);
   }
   return result.status;
 }
 
 size_t QuicDatagramQueue::SendDatagrams() {
+  // Packs the datagrams into as few packets as possible.
+  QuicConnection::ScopedPacketFlusher flusher(session_->connection());
   size_t num_datagrams = 0;
   for (;;) {
     absl::optional<MessageStatus> status = TrySendingNextDatagram();
@@ -89,14 +123,66 @@ QuicTime::Delta QuicDatagramQueue::GetMaxTimeInQueue() const {
                   kMinPacingWindows * kAlarmGranularity);
 }
 
-void QuicDatagramQueue::RemoveExpiredDatagrams() {
-  QuicTime now = clock_->ApproximateNow();
-  while (!queue_.empty() && queue_.front().expiry <= now) {
-    queue_.pop_front();
-    if (observer_) {
+// static
+bool QuicDatagramQueue::SendsAfter(const Datagram& a, const Datagram& b) {
+  if (a.priority != b.priority) {
+    return a.priority < b.priority;
+  }
+  if (a.deadline != b.deadline) {
+    return a.deadline > b.deadline;
+  }
+  return a.sequence_number > b.sequence_number;
+}
+
+void QuicDatagramQueue::PopNextDatagram() {
+  std::pop_heap(queue_.begin(), queue_.end(), &SendsAfter);
+  queue_.pop_back();
+  if (queue_.empty()) {
+    earliest_expiry_ = QuicTime::Infinite();
+  }
+}
+
+void QuicDatagramQueue::RemoveExpiredDatagrams(QuicTime horizon) {
+  if (earliest_expiry_ > horizon) {
+    return;
+  }
+  const QuicTime now = clock_->ApproximateNow();
+  auto expired = std::partition(queue_.begin(), queue_.end(),
+                                [horizon](const Datagram& datagram) {
+                                  return datagram.expiry > horizon;
+                                });
+  size_t num_expired = 0;
+  for (auto it = expired; it != queue_.end(); ++it) {
+    ++num_expired;
+    if (it->expiry > now) {
+      ++stats_.datagrams_expired_by_pacing;
+    }
+  }
+  queue_.erase(expired, queue_.end());
+  std::make_heap(queue_.begin(), queue_.end(), &SendsAfter);
+  earliest_expiry_ = QuicTime::Infinite();
+  for (const Datagram& datagram : queue_) {
+    earliest_expiry_ = std::min(earliest_expiry_, datagram.expiry);
+  }
+  stats_.datagrams_expired += num_expired;
+  if (observer_) {
+    for (size_t i = 0; i < num_expired; ++i) {
       observer_->OnDatagramProcessed(absl::nullopt);
     }
   }
 }
 
+void QuicDatagramQueue::RemoveDatagramsExpiringBeforeRelease() {
+  // Without pacing, or when the connection is blocked by its congestion
+  // window, the release time is in the past and says nothing.
+  const QuicTime release_time = session_->connection()
+                                    ->sent_packet_manager()
+                                    .GetNextReleaseTime()
+                                    .release_time;
+  // The send alarm fires up to kAlarmGranularity ahead of the release time.
+  if (release_time - kAlarmGranularity > clock_->ApproximateNow()) {
+    RemoveExpiredDatagrams(release_time - kAlarmGranularity);
+  }
+}
+
 }  // namespace quic
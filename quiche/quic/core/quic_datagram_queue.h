@@ -5,13 +5,14 @@
 #ifndef QUICHE_QUIC_CORE_QUIC_DATAGRAM_QUEUE_H_
 #define QUICHE_QUIC_CORE_QUIC_DATAGRAM_QUEUE_H_
 
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "absl/types/optional.h"
 #include "quiche/quic/core/quic_time.h"
 #include "quiche/quic/core/quic_types.h"
 #include "quiche/common/platform/api/quiche_mem_slice.h"
-#include "quiche/common/quiche_circular_deque.h"
 
 namespace quic {
 
@@ -20,6 +21,12 @@ class QuicSession;
 // Provides a way to buffer QUIC datagrams (messages) in case they cannot
 // be sent due to congestion control.  Datagrams are buffered for a limited
 // amount of time, and deleted after that time passes.
+//
+// Queued datagrams are sent in order of priority, then of deadline, and then
+// in the order they were queued; datagrams without a priority or a deadline
+// are therefore sent first-in-first-out.  A datagram is dropped rather than
+// sent late: once its deadline passes, or as soon as the connection is blocked
+// and the pacer will not release another packet before the deadline.
 class QUIC_EXPORT_PRIVATE QuicDatagramQueue {
  public:
   // An interface used to monitor events on the associated `QuicDatagramQueue`.
@@ -29,13 +36,41 @@ class QUIC_EXPORT_PRIVATE QuicDatagramQueue {
 
     // Called when a datagram in the associated queue is sent or discarded.
     // Identity information for the datagram is not given, because the sending
-    // and discarding order is always first-in-first-out.
+    // and discarding order is first-in-first-out unless datagrams are queued
+    // with DatagramParameters.
     // This function is called synchronously in `QuicDatagramQueue` methods.
     // `status` is nullopt when the datagram is dropped due to being in the
     // queue for too long.
     virtual void OnDatagramProcessed(absl::optional<MessageStatus> status) = 0;
   };
 
+  // How a datagram is scheduled relative to the others in the queue.
+  struct QUIC_EXPORT_PRIVATE DatagramParameters {
+    // Datagrams of a higher priority are sent first, e.g. the key frames of a
+    // video ahead of its delta frames.
+    int priority = 0;
+    // The time after which the datagram is worthless and is dropped instead of
+    // sent.  Datagrams of the same priority are sent earliest deadline first.
+    // QuicTime::Zero() means that the datagram has no deadline of its own and
+    // expires after GetMaxTimeInQueue().
+    QuicTime deadline = QuicTime::Zero();
+  };
+
+  struct QUIC_EXPORT_PRIVATE Stats {
+    // Datagrams that could not be sent right away.
+    uint64_t datagrams_queued = 0;
+    // Queued datagrams that were sent before they expired.
+    uint64_t datagrams_sent_from_queue = 0;
+    // Datagrams dropped because they could not be sent in time.
+    uint64_t datagrams_expired = 0;
+    // Those of |datagrams_expired| dropped ahead of their expiry, because the
+    // pacer would not release them in time.
+    uint64_t datagrams_expired_by_pacing = 0;
+    // Time spent in the queue by the datagrams sent from it.
+    QuicTime::Delta total_queueing_delay = QuicTime::Delta::Zero();
+    QuicTime::Delta max_queueing_delay = QuicTime::Delta::Zero();
+  };
+
   // |session| is not owned and must outlive this object.
   explicit QuicDatagramQueue(QuicSession* session);
 
@@ -46,12 +81,19 @@ class QUIC_EXPORT_PRIVATE QuicDatagramQueue {
   // not, MESSAGE_STATUS_BLOCKED is returned.
   MessageStatus SendOrQueueDatagram(quiche::QuicheMemSlice datagram);
 
+  // Same as above, except that the datagram is queued by |parameters|.  A
+  // datagram whose deadline has already passed is dropped right away, and
+  // MESSAGE_STATUS_BLOCKED is returned.
+  MessageStatus SendOrQueueDatagram(quiche::QuicheMemSlice datagram,
+                                    const DatagramParameters& parameters);
+
   // Attempts to send a single datagram from the queue.  Returns the result of
   // SendMessage(), or nullopt if there were no unexpired datagrams to send.
   absl::optional<MessageStatus> TrySendingNextDatagram();
 
   // Sends all of the unexpired datagrams until either the connection becomes
-  // write-blocked or the queue is empty.  Returns the number of datagrams sent.
+  // write-blocked or the queue is empty, several per packet.  Returns the
+  // number of datagrams sent.
   size_t SendDatagrams();
 
   // Returns the amount of time a datagram is allowed to be in the queue before
@@ -68,26 +110,50 @@ class QUIC_EXPORT_PRIVATE QuicDatagramQueue {
   // and related logic.
   void SetForceFlush(bool force_flush) { force_flush_ = force_flush; }
 
-  size_t queue_size() { return queue_.size(); }
+  size_t queue_size() const { return queue_.size(); }
 
-  bool empty() { return queue_.empty(); }
+  bool empty() const { return queue_.empty(); }
+
+  const Stats& stats() const { return stats_; }
 
  private:
   struct QUIC_EXPORT_PRIVATE Datagram {
     quiche::QuicheMemSlice datagram;
+    // When the datagram is dropped if it has not been sent.
     QuicTime expiry;
+    // When the datagram was queued.
+    QuicTime queued;
+    int priority;
+    // The deadline the datagram is ordered by, infinite if it has none.
+    QuicTime deadline;
+    // Orders datagrams of the same priority and deadline.
+    uint64_t sequence_number;
   };
 
-  // Removes expired datagrams from the front of the queue.
-  void RemoveExpiredDatagrams();
+  // Whether |a| is sent after |b|.  Orders |queue_| as a heap.
+  static bool SendsAfter(const Datagram& a, const Datagram& b);
+
+  // Removes the datagrams that expire at or before |horizon|.
+  void RemoveExpiredDatagrams(QuicTime horizon);
+
+  // Removes the datagrams that the pacer will not release before they expire.
+  void RemoveDatagramsExpiringBeforeRelease();
+
+  // Removes the next datagram to send from the queue.
+  void PopNextDatagram();
 
   QuicSession* session_;  // Not owned.
   const QuicClock* clock_;
 
   QuicTime::Delta max_time_in_queue_ = QuicTime::Delta::Zero();
-  quiche::QuicheCircularDeque<Datagram> queue_;
+  // A heap of datagrams ordered by SendsAfter(), the next to send in front.
+  std::vector<Datagram> queue_;
+  // The earliest expiry in |queue_|, to skip looking for expired datagrams.
+  QuicTime earliest_expiry_ = QuicTime::Infinite();
+  uint64_t next_sequence_number_ = 0;
   std::unique_ptr<Observer> observer_;
   bool force_flush_;
+  Stats stats_;
 };
 
 }  // namespace quic
@@ -0,0 +1,239 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_datagram_queue.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "quiche/quic/core/crypto/null_encrypter.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/quic_connection_peer.h"
+#include "quiche/quic/test_tools/quic_sent_packet_manager_peer.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+#include "quiche/common/quiche_buffer_allocator.h"
+#include "quiche/common/simple_buffer_allocator.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::Invoke;
+
+class EstablishedCryptoStream : public MockQuicCryptoStream {
+ public:
+  using MockQuicCryptoStream::MockQuicCryptoStream;
+
+  bool encryption_established() const override { return true; }
+};
+
+class QuicDatagramQueueTest : public QuicTest {
+ protected:
+  QuicDatagramQueueTest()
+      : connection_(new MockQuicConnection(&helper_, &alarm_factory_,
+                                           Perspective::IS_CLIENT)),
+        session_(connection_),
+        queue_(&session_) {
+    session_.SetCryptoStream(new EstablishedCryptoStream(&session_));
+    connection_->SetEncrypter(
+        ENCRYPTION_FORWARD_SECURE,
+        std::make_unique<NullEncrypter>(connection_->perspective()));
+    // Records what is sent while |blocked_| is false.
+    ON_CALL(*connection_, SendMessage(_, _, _))
+        .WillByDefault(Invoke([this](QuicMessageId,
+                                     absl::Span<quiche::QuicheMemSlice> message,
+                                     bool) {
+          if (blocked_) {
+            return MESSAGE_STATUS_BLOCKED;
+          }
+          sent_.push_back(std::string(message[0].AsStringView()));
+          return MESSAGE_STATUS_SUCCESS;
+        }));
+  }
+
+  static quiche::QuicheMemSlice CreateMemSlice(absl::string_view data) {
+    return quiche::QuicheMemSlice(quiche::QuicheBuffer::Copy(
+        quiche::SimpleBufferAllocator::Get(), data));
+  }
+
+  MessageStatus Queue(absl::string_view data, int priority,
+                      QuicTime deadline = QuicTime::Zero()) {
+    return queue_.SendOrQueueDatagram(CreateMemSlice(data),
+                                      {priority, deadline});
+  }
+
+  QuicTime Now() { return helper_.GetClock()->ApproximateNow(); }
+
+  MockQuicConnectionHelper helper_;
+  MockAlarmFactory alarm_factory_;
+  MockQuicConnection* connection_;  // Owned by |session_|.
+  MockQuicSession session_;
+  QuicDatagramQueue queue_;
+  bool blocked_ = false;
+  std::vector<std::string> sent_;
+};
+
+TEST_F(QuicDatagramQueueTest, SendDatagramImmediately) {
+  EXPECT_CALL(*connection_, SendMessage(_, _, _));
+  EXPECT_EQ(MESSAGE_STATUS_SUCCESS, Queue("test", /*priority=*/0));
+  EXPECT_EQ(0u, queue_.queue_size());
+  EXPECT_EQ(0u, queue_.stats().datagrams_queued);
+}
+
+TEST_F(QuicDatagramQueueTest, DefaultDatagramsAreFirstInFirstOut) {
+  blocked_ = true;
+  EXPECT_EQ(MESSAGE_STATUS_BLOCKED, queue_.SendOrQueueDatagram(
+                                        CreateMemSlice("a")));
+  EXPECT_EQ(MESSAGE_STATUS_BLOCKED, queue_.SendOrQueueDatagram(
+                                        CreateMemSlice("b")));
+  EXPECT_EQ(MESSAGE_STATUS_BLOCKED, queue_.SendOrQueueDatagram(
+                                        CreateMemSlice("c")));
+  blocked_ = false;
+  EXPECT_EQ(3u, queue_.SendDatagrams());
+  EXPECT_THAT(sent_, ElementsAre("a", "b", "c"));
+  EXPECT_EQ(3u, queue_.stats().datagrams_sent_from_queue);
+}
+
+TEST_F(QuicDatagramQueueTest, HigherPriorityFirst) {
+  blocked_ = true;
+  Queue("delta1", /*priority=*/0);
+  Queue("delta2", /*priority=*/0);
+  Queue("key", /*priority=*/1);
+  blocked_ = false;
+  queue_.SendDatagrams();
+  EXPECT_THAT(sent_, ElementsAre("key", "delta1", "delta2"));
+}
+
+TEST_F(QuicDatagramQueueTest, EarliestDeadlineFirst) {
+  const QuicTime now = Now();
+  blocked_ = true;
+  Queue("none", 0);
+  Queue("late", 0, now + QuicTime::Delta::FromMilliseconds(30));
+  Queue("early", 0, now + QuicTime::Delta::FromMilliseconds(10));
+  blocked_ = false;
+  queue_.SendDatagrams();
+  EXPECT_THAT(sent_, ElementsAre("early", "late", "none"));
+}
+
+TEST_F(QuicDatagramQueueTest, DropsDatagramsPastDeadline) {
+  const QuicTime now = Now();
+  blocked_ = true;
+  Queue("stale", 0, now + QuicTime::Delta::FromMilliseconds(10));
+  Queue("fresh", 0, now + QuicTime::Delta::FromMilliseconds(50));
+  helper_.AdvanceTime(QuicTime::Delta::FromMilliseconds(20));
+  // Already too late to be queued.
+  EXPECT_EQ(MESSAGE_STATUS_BLOCKED, Queue("expired", 1, Now()));
+  EXPECT_EQ(2u, queue_.queue_size());
+
+  blocked_ = false;
+  EXPECT_EQ(1u, queue_.SendDatagrams());
+  EXPECT_THAT(sent_, ElementsAre("fresh"));
+  EXPECT_EQ(2u, queue_.stats().datagrams_expired);
+  EXPECT_EQ(0u, queue_.stats().datagrams_expired_by_pacing);
+  EXPECT_EQ(QuicTime::Delta::FromMilliseconds(20),
+            queue_.stats().max_queueing_delay);
+  EXPECT_FALSE(queue_.TrySendingNextDatagram().has_value());
+}
+
+// A datagram the pacer will not release before its deadline is dropped as
+// soon as the connection is blocked, rather than when the deadline passes.
+TEST_F(QuicDatagramQueueTest, DropsDatagramsThePacerCannotRelease) {
+  QuicSentPacketManager* manager =
+      QuicConnectionPeer::GetSentPacketManager(connection_);
+  QuicSentPacketManagerPeer::SetUsingPacing(manager, true);
+  const QuicTime now = Now();
+  QuicSentPacketManagerPeer::SetNextPacedPacketTime(
+      manager, now + QuicTime::Delta::FromMilliseconds(20));
+  blocked_ = true;
+  Queue("doomed", 1, now + QuicTime::Delta::FromMilliseconds(10));
+  Queue("in_time", 0, now + QuicTime::Delta::FromMilliseconds(50));
+  EXPECT_EQ(2u, queue_.queue_size());
+
+  EXPECT_EQ(MESSAGE_STATUS_BLOCKED, queue_.TrySendingNextDatagram());
+  EXPECT_EQ(1u, queue_.queue_size());
+  EXPECT_EQ(1u, queue_.stats().datagrams_expired_by_pacing);
+
+  helper_.AdvanceTime(QuicTime::Delta::FromMilliseconds(20));
+  blocked_ = false;
+  queue_.SendDatagrams();
+  EXPECT_THAT(sent_, ElementsAre("in_time"));
+}
+
+// Streams 30 frames per second, every tenth a key frame, over a link that
+// carries one datagram every 50 ms.  Nothing is sent after its deadline, and
+// the key frames all get through.
+TEST_F(QuicDatagramQueueTest, MediaOverConstrainedLink) {
+  const QuicTime::Delta kFrameInterval =
+      QuicTime::Delta::FromMicroseconds(33333);
+  const QuicTime::Delta kSendInterval = QuicTime::Delta::FromMilliseconds(50);
+  const QuicTime::Delta kFrameDeadline =
+      QuicTime::Delta::FromMilliseconds(100);
+  constexpr int kNumFrames = 300;
+
+  absl::flat_hash_map<std::string, QuicTime> deadlines;
+  int num_key_frames = 0;
+  int late = 0;
+  EXPECT_CALL(*connection_, SendMessage(_, _, _))
+      .WillRepeatedly(Invoke([&](QuicMessageId,
+                                 absl::Span<quiche::QuicheMemSlice> message,
+                                 bool) {
+        if (blocked_) {
+          return MESSAGE_STATUS_BLOCKED;
+        }
+        const std::string frame(message[0].AsStringView());
+        if (Now() > deadlines[frame]) {
+          ++late;
+        }
+        sent_.push_back(frame);
+        // The link is busy until the next send opportunity.
+        blocked_ = true;
+        return MESSAGE_STATUS_SUCCESS;
+      }));
+
+  const QuicTime start = Now();
+  QuicTime next_frame = start;
+  QuicTime next_send = start;
+  for (int i = 0; i < kNumFrames;) {
+    if (next_frame <= next_send) {
+      helper_.AdvanceTime(next_frame - Now());
+      const bool key_frame = i % 10 == 0;
+      const std::string frame = absl::StrCat(key_frame ? "key" : "delta", i);
+      deadlines[frame] = Now() + kFrameDeadline;
+      num_key_frames += key_frame;
+      Queue(frame, key_frame ? 1 : 0, deadlines[frame]);
+      next_frame = next_frame + kFrameInterval;
+      ++i;
+    } else {
+      helper_.AdvanceTime(next_send - Now());
+      blocked_ = false;
+      queue_.TrySendingNextDatagram();
+      blocked_ = true;
+      next_send = next_send + kSendInterval;
+    }
+  }
+
+  EXPECT_EQ(0, late);
+  int key_frames_sent = 0;
+  for (const std::string& frame : sent_) {
+    key_frames_sent += absl::StartsWith(frame, "key");
+  }
+  EXPECT_EQ(num_key_frames, key_frames_sent);
+  const QuicDatagramQueue::Stats& stats = queue_.stats();
+  EXPECT_GT(stats.datagrams_expired, 0u);
+  EXPECT_EQ(static_cast<uint64_t>(kNumFrames),
+            sent_.size() + stats.datagrams_expired + queue_.queue_size());
+  EXPECT_LE(stats.max_queueing_delay, kFrameDeadline);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
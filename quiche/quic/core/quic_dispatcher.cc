@@ -478,6 +478,13 @@ bool QuicDispatcher::MaybeDispatchPacket(
   auto it = reference_counted_session_map_.find(server_connection_id);
   if (it != reference_counted_session_map_.end()) {
     QUICHE_DCHECK(!buffered_packets_.HasBufferedPackets(server_connection_id));
+    QuicConnection* connection = it->second->connection();
+    if (in_read_burst_ && !connection->in_read_burst()) {
+      connection->OnReadBurstStart();
+      if (connection->in_read_burst()) {
+        sessions_in_read_burst_.push_back(it->second);
+      }
+    }
     it->second->ProcessUdpPacket(packet_info.self_address,
                                  packet_info.peer_address, packet_info.packet);
     return true;
@@ -859,6 +866,16 @@ void QuicDispatcher::ClearStatelessResetAddresses() {
   recent_stateless_reset_addresses_.clear();
 }
 
+void QuicDispatcher::OnReadBurstStart() { in_read_burst_ = true; }
+
+void QuicDispatcher::OnReadBurstEnd() {
+  in_read_burst_ = false;
+  for (const std::shared_ptr<QuicSession>& session : sessions_in_read_burst_) {
+    session->connection()->OnReadBurstEnd();
+  }
+  sessions_in_read_burst_.clear();
+}
+
 void QuicDispatcher::OnCanWrite() {
   // The socket is now writable.
   writer_->SetWritable();
@@ -70,6 +70,8 @@ class QUIC_NO_EXPORT QuicDispatcher
   void ProcessPacket(const QuicSocketAddress& self_address,
                      const QuicSocketAddress& peer_address,
                      const QuicReceivedPacket& packet) override;
+  void OnReadBurstStart() override;
+  void OnReadBurstEnd() override;
 
   // Called when the socket becomes writable to allow queued writes to happen.
   virtual void OnCanWrite();
@@ -395,6 +397,13 @@ class QUIC_NO_EXPORT QuicDispatcher
 
   ReferenceCountedSessionMap reference_counted_session_map_;
 
+  // True between OnReadBurstStart() and OnReadBurstEnd().
+  bool in_read_burst_ = false;
+
+  // Sessions which received packets during the current read burst, and whose
+  // connections wait for the burst to end to respond.
+  std::vector<std::shared_ptr<QuicSession>> sessions_in_read_burst_;
+
   // Entity that manages connection_ids in time wait state.
   std::unique_ptr<QuicTimeWaitListManager> time_wait_list_manager_;
 
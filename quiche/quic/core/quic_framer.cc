@@ -41,6 +41,7 @@
 #include "quiche/quic/core/quic_data_reader.h"
 #include "quiche/quic/core/quic_data_writer.h"
 #include "quiche/quic/core/quic_error_codes.h"
+#include "quiche/quic/core/quic_hot_path_profiler.h"
 #include "quiche/quic/core/quic_packets.h"
 #include "quiche/quic/core/quic_socket_address_coder.h"
 #include "quiche/quic/core/quic_stream_frame_data_producer.h"
@@ -460,6 +461,9 @@ QuicFramer::~QuicFramer() {
     delete encrypter_[i];
     delete decrypter_[i];
   }
+  delete previous_decrypter_;
+  delete next_decrypter_;
+  delete next_encrypter_;
 }
 
 // static
@@ -4386,19 +4390,43 @@ void QuicFramer::SetKeyUpdateSupportForConnection(bool enabled) {
 void QuicFramer::DiscardPreviousOneRttKeys() {
   QUICHE_DCHECK(support_key_update_for_connection_);
   QUIC_DVLOG(1) << ENDPOINT << "Discarding previous set of 1-RTT keys";
+  delete previous_decrypter_;
   previous_decrypter_ = nullptr;
 }
 
+bool QuicFramer::PrepareNextOneRttKeys() {
+  if (!support_key_update_for_connection_ ||
+      decrypter_[ENCRYPTION_FORWARD_SECURE] == nullptr ||
+      encrypter_[ENCRYPTION_FORWARD_SECURE] == nullptr) {
+    return false;
+  }
+  // The next decrypter may already have been created for a packet which
+  // attempted a key update.
+  if (!next_decrypter_) {
+    next_decrypter_ =
+        visitor_->AdvanceKeysAndCreateCurrentOneRttDecrypter().release();
+  }
+  if (next_decrypter_ && !next_encrypter_) {
+    next_encrypter_ = visitor_->CreateCurrentOneRttEncrypter().release();
+  }
+  QUIC_DVLOG(1) << ENDPOINT << "PrepareNextOneRttKeys: ready="
+                << HasNextOneRttKeys();
+  return HasNextOneRttKeys();
+}
+
 bool QuicFramer::DoKeyUpdate(KeyUpdateReason reason) {
   QUICHE_DCHECK(support_key_update_for_connection_);
+  last_key_update_used_prepared_keys_ = HasNextOneRttKeys();
   if (!next_decrypter_) {
     // If key update is locally initiated, next decrypter might not be created
     // yet.
-    next_decrypter_ = visitor_->AdvanceKeysAndCreateCurrentOneRttDecrypter().release();
+    next_decrypter_ =
+        visitor_->AdvanceKeysAndCreateCurrentOneRttDecrypter().release();
+  }
+  if (next_decrypter_ && !next_encrypter_) {
+    next_encrypter_ = visitor_->CreateCurrentOneRttEncrypter().release();
   }
-  std::unique_ptr<QuicEncrypter> next_encrypter =
-      visitor_->CreateCurrentOneRttEncrypter();
-  if (!next_decrypter_ || !next_encrypter) {
+  if (!next_decrypter_ || !next_encrypter_) {
     QUIC_BUG(quic_bug_10850_58) << "Failed to create next crypters";
     return false;
   }
@@ -4407,10 +4435,14 @@ bool QuicFramer::DoKeyUpdate(KeyUpdateReason reason) {
   QUIC_DLOG(INFO) << ENDPOINT << "DoKeyUpdate: new current_key_phase_bit_="
                   << current_key_phase_bit_;
   current_key_phase_first_received_packet_number_.Clear();
+  // The next keys become current, which only swaps pointers.
+  delete previous_decrypter_;
   previous_decrypter_ = decrypter_[ENCRYPTION_FORWARD_SECURE];
   decrypter_[ENCRYPTION_FORWARD_SECURE] = next_decrypter_;
+  next_decrypter_ = nullptr;
   delete encrypter_[ENCRYPTION_FORWARD_SECURE];
-  encrypter_[ENCRYPTION_FORWARD_SECURE] = next_encrypter.release();
+  encrypter_[ENCRYPTION_FORWARD_SECURE] = next_encrypter_;
+  next_encrypter_ = nullptr;
   switch (reason) {
     case KeyUpdateReason::kInvalid:
       QUIC_CODE_COUNT(quic_key_update_invalid);
@@ -4829,6 +4861,7 @@ bool QuicFramer::DecryptPayload(size_t udp_packet_length,
                                 char* decrypted_buffer, size_t buffer_length,
                                 size_t* decrypted_length,
                                 EncryptionLevel* decrypted_level) {
+  QUIC_HOT_PATH_PROBE(HOT_PATH_DECRYPT_PAYLOAD);
   if (DCHECK_FLAG && !EncryptionLevelIsValid(decrypter_level_)) {
     QUIC_BUG(quic_bug_10850_67)
         << "Attempted to decrypt with bad decrypter_level_";
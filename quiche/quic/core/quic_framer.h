@@ -573,8 +573,19 @@ class QUIC_EXPORT_PRIVATE QuicFramer {
   void SetKeyUpdateSupportForConnection(bool enabled);
   // Discard the decrypter for the previous key phase.
   void DiscardPreviousOneRttKeys();
+  // Derives the keys of the next key phase ahead of time, so that the next key
+  // update only swaps them in. Does nothing before the 1-RTT keys are
+  // installed. Returns true if the next keys are ready.
+  bool PrepareNextOneRttKeys();
+  bool HasNextOneRttKeys() const {
+    return next_decrypter_ != nullptr && next_encrypter_ != nullptr;
+  }
   // Update the key phase.
   bool DoKeyUpdate(KeyUpdateReason reason);
+  // Whether the last key update used keys from PrepareNextOneRttKeys().
+  bool last_key_update_used_prepared_keys() const {
+    return last_key_update_used_prepared_keys_;
+  }
   // Returns the count of packets received that appeared to attempt a key
   // update but failed decryption which have been received since the last
   // successfully decrypted packet.
@@ -1182,9 +1193,11 @@ class QUIC_EXPORT_PRIVATE QuicFramer {
   // Decrypter for the previous key phase. Will be null if in the first key
   // phase or previous keys have been discarded.
   QuicDecrypter* previous_decrypter_ = nullptr;
-  // Decrypter for the next key phase. May be null if next keys haven't been
-  // generated yet.
+  // Decrypter and encrypter for the next key phase. May be null if next keys
+  // haven't been generated yet.
   QuicDecrypter* next_decrypter_ = nullptr;
+  QuicEncrypter* next_encrypter_ = nullptr;
+  bool last_key_update_used_prepared_keys_ = false;
 
   // If this is a framer of a connection, this is the packet number of first
   // sending packet. If this is a framer of a framer of dispatcher, this is the
@@ -0,0 +1,118 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_framer.h"
+
+#include "quiche/quic/core/quic_types.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/quic_connection_peer.h"
+#include "quiche/quic/test_tools/quic_framer_peer.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+
+using testing::NiceMock;
+
+namespace quic {
+namespace test {
+namespace {
+
+class QuicFramerKeyUpdateTest : public QuicTest {
+ protected:
+  QuicFramerKeyUpdateTest()
+      : connection_(new NiceMock<MockQuicConnection>(
+            &helper_, &alarm_factory_, Perspective::IS_SERVER)),
+        session_(connection_, /*create_mock_crypto_stream=*/false),
+        crypto_stream_(new KeyUpdateCryptoStream(&session_)),
+        framer_(QuicConnectionPeer::GetFramer(connection_)) {
+    session_.SetCryptoStream(crypto_stream_);
+    QuicConnectionPeer::EnableKeyUpdate(connection_);
+    connection_->SetEncrypter(ENCRYPTION_FORWARD_SECURE,
+                              crypto_stream_->CreateCurrentOneRttEncrypter());
+    connection_->InstallDecrypter(
+        ENCRYPTION_FORWARD_SECURE,
+        crypto_stream_->CreateCurrentOneRttDecrypter());
+  }
+
+  const QuicEncrypter* OneRttEncrypter() {
+    return QuicFramerPeer::GetEncrypter(framer_, ENCRYPTION_FORWARD_SECURE);
+  }
+  const QuicDecrypter* OneRttDecrypter() {
+    return QuicFramerPeer::GetDecrypter(framer_, ENCRYPTION_FORWARD_SECURE);
+  }
+
+  MockQuicConnectionHelper helper_;
+  MockAlarmFactory alarm_factory_;
+  MockQuicConnection* connection_;  // Owned by |session_|.
+  NiceMock<MockQuicSession> session_;
+  KeyUpdateCryptoStream* crypto_stream_;  // Owned by |session_|.
+  QuicFramer* framer_;
+};
+
+TEST_F(QuicFramerKeyUpdateTest, PreparedKeysAreSwappedIn) {
+  ASSERT_TRUE(framer_->PrepareNextOneRttKeys());
+  EXPECT_TRUE(framer_->HasNextOneRttKeys());
+  EXPECT_EQ(1, crypto_stream_->num_keys_derived());
+  const QuicEncrypter* next_encrypter = crypto_stream_->last_encrypter();
+  const QuicDecrypter* next_decrypter = crypto_stream_->last_decrypter();
+  // Keys which are already prepared are not derived again.
+  EXPECT_TRUE(framer_->PrepareNextOneRttKeys());
+  EXPECT_EQ(1, crypto_stream_->num_keys_derived());
+
+  // The key update derives nothing, so the packet which triggers it does not
+  // wait for HKDF.
+  ASSERT_TRUE(framer_->DoKeyUpdate(KeyUpdateReason::kRemote));
+  EXPECT_TRUE(framer_->last_key_update_used_prepared_keys());
+  EXPECT_EQ(1, crypto_stream_->num_keys_derived());
+  EXPECT_EQ(next_encrypter, OneRttEncrypter());
+  EXPECT_EQ(next_decrypter, OneRttDecrypter());
+  EXPECT_FALSE(framer_->HasNextOneRttKeys());
+}
+
+TEST_F(QuicFramerKeyUpdateTest, KeysAreDerivedWithoutPreparation) {
+  ASSERT_TRUE(framer_->DoKeyUpdate(KeyUpdateReason::kLocalForTests));
+  EXPECT_FALSE(framer_->last_key_update_used_prepared_keys());
+  EXPECT_EQ(1, crypto_stream_->num_keys_derived());
+  EXPECT_EQ(crypto_stream_->last_encrypter(), OneRttEncrypter());
+  EXPECT_EQ(crypto_stream_->last_decrypter(), OneRttDecrypter());
+}
+
+TEST_F(QuicFramerKeyUpdateTest, SwappedInDecrypterIsNotReused) {
+  ASSERT_TRUE(framer_->PrepareNextOneRttKeys());
+  ASSERT_TRUE(framer_->DoKeyUpdate(KeyUpdateReason::kRemote));
+  const QuicDecrypter* first_update_decrypter = OneRttDecrypter();
+
+  // The second key update derives the keys of the next phase, rather than
+  // installing the decrypter of the first update again.
+  ASSERT_TRUE(framer_->DoKeyUpdate(KeyUpdateReason::kRemote));
+  EXPECT_FALSE(framer_->last_key_update_used_prepared_keys());
+  EXPECT_EQ(2, crypto_stream_->num_keys_derived());
+  EXPECT_NE(first_update_decrypter, OneRttDecrypter());
+  EXPECT_EQ(crypto_stream_->last_decrypter(), OneRttDecrypter());
+}
+
+TEST_F(QuicFramerKeyUpdateTest, PreviousDecryptersAreDeleted) {
+  EXPECT_EQ(1, crypto_stream_->num_live_decrypters());
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(framer_->DoKeyUpdate(KeyUpdateReason::kRemote));
+    // The current and the previous decrypter.
+    EXPECT_EQ(2, crypto_stream_->num_live_decrypters());
+  }
+  framer_->DiscardPreviousOneRttKeys();
+  EXPECT_EQ(1, crypto_stream_->num_live_decrypters());
+
+  ASSERT_TRUE(framer_->PrepareNextOneRttKeys());
+  EXPECT_EQ(2, crypto_stream_->num_live_decrypters());
+  ASSERT_TRUE(framer_->DoKeyUpdate(KeyUpdateReason::kRemote));
+  EXPECT_EQ(2, crypto_stream_->num_live_decrypters());
+}
+
+TEST_F(QuicFramerKeyUpdateTest, NothingToPrepareWithoutOneRttKeys) {
+  framer_->RemoveEncrypter(ENCRYPTION_FORWARD_SECURE);
+  EXPECT_FALSE(framer_->PrepareNextOneRttKeys());
+  EXPECT_FALSE(framer_->HasNextOneRttKeys());
+  EXPECT_EQ(0, crypto_stream_->num_keys_derived());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
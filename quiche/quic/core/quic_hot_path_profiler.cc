@@ -0,0 +1,225 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_hot_path_profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "absl/base/optimization.h"
+#include "absl/numeric/bits.h"
+#include "absl/strings/str_cat.h"
+#include "quiche/quic/platform/api/quic_mutex.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace quic {
+namespace {
+
+// Histograms of one thread. Only the owning thread writes, so plain
+// load/store pairs are enough; atomics only make concurrent snapshots
+// well-defined.
+struct PerThreadHistograms {
+  struct Stage {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> total_cycles;
+    std::atomic<uint64_t> max_cycles;
+    std::atomic<uint64_t> buckets[QuicCycleHistogram::kNumBuckets];
+  };
+
+  Stage stages[NUM_HOT_PATH_STAGES];
+};
+
+void Increment(std::atomic<uint64_t>& value, uint64_t delta) {
+  value.store(value.load(std::memory_order_relaxed) + delta,
+              std::memory_order_relaxed);
+}
+
+int BucketIndex(uint64_t cycles) {
+  if (cycles == 0) {
+    return 0;
+  }
+  return std::min<int>(absl::bit_width(cycles) - 1,
+                       QuicCycleHistogram::kNumBuckets - 1);
+}
+
+class Registry {
+ public:
+  void Register(PerThreadHistograms* histograms) {
+    QuicWriterMutexLock lock(&mutex_);
+    threads_.push_back(histograms);
+  }
+
+  QuicHotPathSnapshot Snapshot() {
+    QuicHotPathSnapshot snapshot;
+    QuicReaderMutexLock lock(&mutex_);
+    for (const PerThreadHistograms* thread : threads_) {
+      for (int s = 0; s < NUM_HOT_PATH_STAGES; ++s) {
+        const PerThreadHistograms::Stage& from = thread->stages[s];
+        QuicCycleHistogram histogram;
+        histogram.count = from.count.load(std::memory_order_relaxed);
+        histogram.total_cycles =
+            from.total_cycles.load(std::memory_order_relaxed);
+        histogram.max_cycles = from.max_cycles.load(std::memory_order_relaxed);
+        for (int b = 0; b < QuicCycleHistogram::kNumBuckets; ++b) {
+          histogram.buckets[b] =
+              from.buckets[b].load(std::memory_order_relaxed);
+        }
+        snapshot.stages[s].Merge(histogram);
+      }
+    }
+    return snapshot;
+  }
+
+  void Reset() {
+    QuicReaderMutexLock lock(&mutex_);
+    for (PerThreadHistograms* thread : threads_) {
+      for (PerThreadHistograms::Stage& stage : thread->stages) {
+        stage.count.store(0, std::memory_order_relaxed);
+        stage.total_cycles.store(0, std::memory_order_relaxed);
+        stage.max_cycles.store(0, std::memory_order_relaxed);
+        for (std::atomic<uint64_t>& bucket : stage.buckets) {
+          bucket.store(0, std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+
+ private:
+  QuicMutex mutex_;
+  std::vector<PerThreadHistograms*> threads_ QUIC_GUARDED_BY(mutex_);
+};
+
+Registry* GetRegistry() {
+  static Registry* registry = new Registry();
+  return registry;
+}
+
+ABSL_CONST_INIT thread_local PerThreadHistograms* current_thread_histograms =
+    nullptr;
+
+PerThreadHistograms* GetCurrentThreadHistograms() {
+  if (ABSL_PREDICT_FALSE(current_thread_histograms == nullptr)) {
+    // Intentionally leaked, the registry may still reference it after the
+    // thread exits.
+    current_thread_histograms = new PerThreadHistograms();
+    GetRegistry()->Register(current_thread_histograms);
+  }
+  return current_thread_histograms;
+}
+
+}  // namespace
+
+const char* QuicHotPathStageToString(QuicHotPathStage stage) {
+  switch (stage) {
+    case HOT_PATH_PROCESS_UDP_PACKET:
+      return "process_udp_packet";
+    case HOT_PATH_DECRYPT_PAYLOAD:
+      return "decrypt_payload";
+    case HOT_PATH_ON_ACK_FRAME_END:
+      return "on_ack_frame_end";
+    case HOT_PATH_SERIALIZE_PACKET:
+      return "serialize_packet";
+    case HOT_PATH_SESSION_ON_CAN_WRITE:
+      return "session_on_can_write";
+    case NUM_HOT_PATH_STAGES:
+      break;
+  }
+  return "unknown";
+}
+
+void QuicCycleHistogram::Add(uint64_t cycles) {
+  ++count;
+  total_cycles += cycles;
+  max_cycles = std::max(max_cycles, cycles);
+  ++buckets[BucketIndex(cycles)];
+}
+
+void QuicCycleHistogram::Merge(const QuicCycleHistogram& other) {
+  count += other.count;
+  total_cycles += other.total_cycles;
+  max_cycles = std::max(max_cycles, other.max_cycles);
+  for (int i = 0; i < kNumBuckets; ++i) {
+    buckets[i] += other.buckets[i];
+  }
+}
+
+uint64_t QuicCycleHistogram::Percentile(double fraction) const {
+  if (count == 0) {
+    return 0;
+  }
+  fraction = std::clamp(fraction, 0.0, 1.0);
+  const uint64_t rank =
+      std::max<uint64_t>(1, static_cast<uint64_t>(fraction * count + 0.5));
+  uint64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      const uint64_t bucket_upper_bound =
+          i + 1 >= 64 ? UINT64_MAX : (uint64_t{1} << (i + 1)) - 1;
+      return std::min(bucket_upper_bound, max_cycles);
+    }
+  }
+  return max_cycles;
+}
+
+std::string QuicHotPathSnapshot::DebugString() const {
+  std::string result;
+  for (int s = 0; s < NUM_HOT_PATH_STAGES; ++s) {
+    const QuicCycleHistogram& histogram = stages[s];
+    if (histogram.count == 0) {
+      continue;
+    }
+    absl::StrAppend(
+        &result, QuicHotPathStageToString(static_cast<QuicHotPathStage>(s)),
+        ": { count: ", histogram.count, " mean: ", histogram.Mean(),
+        " p50: ", histogram.Percentile(0.5),
+        " p99: ", histogram.Percentile(0.99),
+        " p999: ", histogram.Percentile(0.999), " max: ", histogram.max_cycles,
+        " } ");
+  }
+  return result;
+}
+
+// static
+uint64_t QuicHotPathProfiler::ReadCycleCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t value;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+  return value;
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+// static
+void QuicHotPathProfiler::Record(QuicHotPathStage stage, uint64_t cycles) {
+  PerThreadHistograms::Stage& histogram =
+      GetCurrentThreadHistograms()->stages[stage];
+  Increment(histogram.count, 1);
+  Increment(histogram.total_cycles, cycles);
+  if (cycles > histogram.max_cycles.load(std::memory_order_relaxed)) {
+    histogram.max_cycles.store(cycles, std::memory_order_relaxed);
+  }
+  Increment(histogram.buckets[BucketIndex(cycles)], 1);
+}
+
+// static
+QuicHotPathSnapshot QuicHotPathProfiler::Snapshot() {
+  return GetRegistry()->Snapshot();
+}
+
+// static
+void QuicHotPathProfiler::Reset() { GetRegistry()->Reset(); }
+
+}  // namespace quic
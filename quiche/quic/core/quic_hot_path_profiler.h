@@ -0,0 +1,121 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_HOT_PATH_PROFILER_H_
+#define QUICHE_QUIC_CORE_QUIC_HOT_PATH_PROFILER_H_
+
+#include <cstdint>
+#include <string>
+
+#include "quiche/quic/platform/api/quic_export.h"
+
+// Set QUIC_HOT_PATH_PROFILING to 1 (e.g. --copt=-DQUIC_HOT_PATH_PROFILING=1)
+// to compile the QUIC_HOT_PATH_PROBE()s in the packet processing path. When it
+// is 0, the probes expand to nothing and cost nothing.
+#ifndef QUIC_HOT_PATH_PROFILING
+#define QUIC_HOT_PATH_PROFILING 0
+#endif  // QUIC_HOT_PATH_PROFILING
+
+namespace quic {
+
+// Stages of the per-packet hot path that are instrumented. Stages nest, e.g.
+// HOT_PATH_DECRYPT_PAYLOAD and HOT_PATH_ON_ACK_FRAME_END run inside
+// HOT_PATH_PROCESS_UDP_PACKET, so stage totals are not additive.
+enum QuicHotPathStage : uint8_t {
+  // QuicConnection::ProcessUdpPacket, i.e. decrypt + frame parse + handling.
+  HOT_PATH_PROCESS_UDP_PACKET = 0,
+  // QuicFramer::DecryptPayload.
+  HOT_PATH_DECRYPT_PAYLOAD,
+  // QuicSentPacketManager::OnAckFrameEnd.
+  HOT_PATH_ON_ACK_FRAME_END,
+  // QuicPacketCreator::SerializePacket, i.e. frame building + encryption.
+  HOT_PATH_SERIALIZE_PACKET,
+  // QuicSession::OnCanWrite.
+  HOT_PATH_SESSION_ON_CAN_WRITE,
+
+  NUM_HOT_PATH_STAGES,
+};
+
+QUIC_EXPORT_PRIVATE const char* QuicHotPathStageToString(
+    QuicHotPathStage stage);
+
+// Log2 histogram of the cycle counts recorded for one stage. Bucket i holds
+// samples in [2^i, 2^(i+1)), bucket 0 also holds samples of 0.
+struct QUIC_EXPORT_PRIVATE QuicCycleHistogram {
+  static constexpr int kNumBuckets = 40;
+
+  void Add(uint64_t cycles);
+  void Merge(const QuicCycleHistogram& other);
+
+  // Returns an upper bound of the |fraction| (in [0, 1]) percentile.
+  uint64_t Percentile(double fraction) const;
+
+  uint64_t Mean() const { return count == 0 ? 0 : total_cycles / count; }
+
+  uint64_t count = 0;
+  uint64_t total_cycles = 0;
+  uint64_t max_cycles = 0;
+  uint64_t buckets[kNumBuckets] = {};
+};
+
+// Aggregate of all threads' histograms at the time of the snapshot.
+struct QUIC_EXPORT_PRIVATE QuicHotPathSnapshot {
+  std::string DebugString() const;
+
+  QuicCycleHistogram stages[NUM_HOT_PATH_STAGES];
+};
+
+// Process-wide registry of hot path histograms. Every thread records into its
+// own histograms, which are written only by that thread using relaxed atomics,
+// so recording takes no lock. Only the first Record() on a thread takes a
+// mutex to register the thread's histograms; they stay registered for the
+// lifetime of the process.
+class QUIC_EXPORT_PRIVATE QuicHotPathProfiler {
+ public:
+  // Returns the current value of the cheapest monotonic counter available:
+  // the TSC on x86, the virtual counter on aarch64, nanoseconds otherwise.
+  static uint64_t ReadCycleCounter();
+
+  // Records |cycles| spent in |stage| by the calling thread.
+  static void Record(QuicHotPathStage stage, uint64_t cycles);
+
+  // Sums the histograms of all threads. Samples recorded concurrently with the
+  // snapshot may or may not be included.
+  static QuicHotPathSnapshot Snapshot();
+
+  // Clears the histograms of all threads. Samples recorded concurrently with
+  // the reset may be partially lost.
+  static void Reset();
+};
+
+// Records the cycles spent between its construction and destruction.
+class QUIC_EXPORT_PRIVATE QuicScopedHotPathProbe {
+ public:
+  explicit QuicScopedHotPathProbe(QuicHotPathStage stage)
+      : stage_(stage), start_(QuicHotPathProfiler::ReadCycleCounter()) {}
+  QuicScopedHotPathProbe(const QuicScopedHotPathProbe&) = delete;
+  QuicScopedHotPathProbe& operator=(const QuicScopedHotPathProbe&) = delete;
+
+  ~QuicScopedHotPathProbe() {
+    QuicHotPathProfiler::Record(
+        stage_, QuicHotPathProfiler::ReadCycleCounter() - start_);
+  }
+
+ private:
+  const QuicHotPathStage stage_;
+  const uint64_t start_;
+};
+
+}  // namespace quic
+
+#if QUIC_HOT_PATH_PROFILING
+#define QUIC_HOT_PATH_PROBE(stage) \
+  ::quic::QuicScopedHotPathProbe quic_hot_path_probe(::quic::stage)
+#else
+#define QUIC_HOT_PATH_PROBE(stage) \
+  do {                             \
+  } while (0)
+#endif  // QUIC_HOT_PATH_PROFILING
+
+#endif  // QUICHE_QUIC_CORE_QUIC_HOT_PATH_PROFILER_H_
@@ -0,0 +1,101 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_hot_path_profiler.h"
+
+#include <memory>
+#include <vector>
+
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/platform/api/quic_thread.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+class QuicHotPathProfilerTest : public QuicTest {
+ protected:
+  QuicHotPathProfilerTest() { QuicHotPathProfiler::Reset(); }
+};
+
+TEST_F(QuicHotPathProfilerTest, HistogramBuckets) {
+  QuicCycleHistogram histogram;
+  EXPECT_EQ(0u, histogram.Percentile(0.5));
+  histogram.Add(0);
+  histogram.Add(1);
+  histogram.Add(100);
+  histogram.Add(1000);
+  EXPECT_EQ(4u, histogram.count);
+  EXPECT_EQ(1101u, histogram.total_cycles);
+  EXPECT_EQ(1000u, histogram.max_cycles);
+  EXPECT_EQ(2u, histogram.buckets[0]);
+  EXPECT_EQ(1u, histogram.buckets[6]);
+  EXPECT_EQ(1u, histogram.buckets[9]);
+  EXPECT_EQ(1u, histogram.Percentile(0.5));
+  EXPECT_EQ(127u, histogram.Percentile(0.75));
+  EXPECT_EQ(1000u, histogram.Percentile(1.0));
+
+  QuicCycleHistogram other;
+  other.Add(5000);
+  histogram.Merge(other);
+  EXPECT_EQ(5u, histogram.count);
+  EXPECT_EQ(5000u, histogram.max_cycles);
+  EXPECT_EQ(1u, histogram.buckets[12]);
+}
+
+TEST_F(QuicHotPathProfilerTest, ScopedProbe) {
+  {
+    QuicScopedHotPathProbe probe(HOT_PATH_SERIALIZE_PACKET);
+  }
+  {
+    QuicScopedHotPathProbe probe(HOT_PATH_SERIALIZE_PACKET);
+  }
+  QuicHotPathSnapshot snapshot = QuicHotPathProfiler::Snapshot();
+  EXPECT_EQ(2u, snapshot.stages[HOT_PATH_SERIALIZE_PACKET].count);
+  EXPECT_EQ(0u, snapshot.stages[HOT_PATH_PROCESS_UDP_PACKET].count);
+  EXPECT_NE(std::string::npos,
+            snapshot.DebugString().find("serialize_packet: { count: 2"));
+
+  QuicHotPathProfiler::Reset();
+  EXPECT_EQ(
+      0u,
+      QuicHotPathProfiler::Snapshot().stages[HOT_PATH_SERIALIZE_PACKET].count);
+}
+
+class RecordingThread : public QuicThread {
+ public:
+  explicit RecordingThread(int num_samples)
+      : QuicThread("RecordingThread"), num_samples_(num_samples) {}
+
+ protected:
+  void Run() override {
+    for (int i = 0; i < num_samples_; ++i) {
+      QuicHotPathProfiler::Record(HOT_PATH_ON_ACK_FRAME_END, i);
+    }
+  }
+
+ private:
+  const int num_samples_;
+};
+
+TEST_F(QuicHotPathProfilerTest, AggregatesAcrossThreads) {
+  const int kNumThreads = 4;
+  const int kNumSamples = 1000;
+  std::vector<std::unique_ptr<RecordingThread>> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.push_back(std::make_unique<RecordingThread>(kNumSamples));
+    threads.back()->Start();
+  }
+  for (auto& thread : threads) {
+    thread->Join();
+  }
+  const QuicCycleHistogram& histogram =
+      QuicHotPathProfiler::Snapshot().stages[HOT_PATH_ON_ACK_FRAME_END];
+  EXPECT_EQ(static_cast<uint64_t>(kNumThreads * kNumSamples), histogram.count);
+  EXPECT_EQ(static_cast<uint64_t>(kNumSamples - 1), histogram.max_cycles);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -0,0 +1,277 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_http3_write_blocked_list.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "quiche/quic/platform/api/quic_bug_tracker.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+void QuicHttp3WriteBlockedList::ReadyList::PushBack(StreamInfo* stream) {
+  stream->previous = tail;
+  stream->next = nullptr;
+  if (tail != nullptr) {
+    tail->next = stream;
+  } else {
+    head = stream;
+  }
+  tail = stream;
+  ++size;
+}
+
+void QuicHttp3WriteBlockedList::ReadyList::PushFront(StreamInfo* stream) {
+  stream->previous = nullptr;
+  stream->next = head;
+  if (head != nullptr) {
+    head->previous = stream;
+  } else {
+    tail = stream;
+  }
+  head = stream;
+  ++size;
+}
+
+void QuicHttp3WriteBlockedList::ReadyList::Remove(StreamInfo* stream) {
+  if (stream->previous != nullptr) {
+    stream->previous->next = stream->next;
+  } else {
+    head = stream->next;
+  }
+  if (stream->next != nullptr) {
+    stream->next->previous = stream->previous;
+  } else {
+    tail = stream->previous;
+  }
+  stream->previous = nullptr;
+  stream->next = nullptr;
+  --size;
+}
+
+QuicHttp3WriteBlockedList::QuicHttp3WriteBlockedList(QuicByteCount quantum)
+    : quantum_(std::max<QuicByteCount>(quantum, 1)) {}
+
+QuicHttp3WriteBlockedList::~QuicHttp3WriteBlockedList() = default;
+
+// static
+int QuicHttp3WriteBlockedList::LevelOfUrgency(int urgency) {
+  return kFirstUrgencyLevel +
+         std::clamp(urgency, HttpStreamPriority::kMinimumUrgency,
+                    HttpStreamPriority::kMaximumUrgency) -
+         HttpStreamPriority::kMinimumUrgency;
+}
+
+// static
+int QuicHttp3WriteBlockedList::LevelOf(const StreamInfo& stream) {
+  return stream.is_static ? kStaticLevel
+                          : LevelOfUrgency(stream.priority.urgency);
+}
+
+QuicHttp3WriteBlockedList::ReadyList& QuicHttp3WriteBlockedList::ReadyListOf(
+    const StreamInfo& stream) {
+  Level& level = levels_[LevelOf(stream)];
+  return !stream.is_static && stream.priority.incremental
+             ? level.incremental
+             : level.non_incremental;
+}
+
+const QuicHttp3WriteBlockedList::StreamInfo* QuicHttp3WriteBlockedList::Find(
+    QuicStreamId id) const {
+  auto it = streams_.find(id);
+  return it == streams_.end() ? nullptr : &it->second;
+}
+
+bool QuicHttp3WriteBlockedList::HasReadyStreamBefore(int level) const {
+  for (int i = kStaticLevel; i < level; ++i) {
+    if (levels_[i].non_incremental.size > 0 ||
+        levels_[i].incremental.size > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool QuicHttp3WriteBlockedList::ShouldYield(QuicStreamId id) const {
+  const StreamInfo* stream = Find(id);
+  if (stream == nullptr || stream->is_static) {
+    // Static streams never yield to data streams.
+    return false;
+  }
+  const int level = LevelOf(*stream);
+  if (HasReadyStreamBefore(level)) {
+    return true;
+  }
+  const Level& same_level = levels_[level];
+  if (!stream->priority.incremental) {
+    const StreamInfo* next = same_level.non_incremental.head;
+    return next != nullptr && next != stream;
+  }
+  // Non-incremental streams of the same urgency go first.
+  if (same_level.non_incremental.size > 0) {
+    return true;
+  }
+  const StreamInfo* next = same_level.incremental.head;
+  return next != nullptr && next != stream;
+}
+
+QuicStreamPriority QuicHttp3WriteBlockedList::GetPriorityOfStream(
+    QuicStreamId id) const {
+  const StreamInfo* stream = Find(id);
+  if (stream == nullptr) {
+    QUIC_BUG(quic_http3_write_blocked_list_unknown_stream)
+        << "Stream " << id << " not registered";
+    return QuicStreamPriority(HttpStreamPriority());
+  }
+  return QuicStreamPriority(stream->priority);
+}
+
+QuicStreamId QuicHttp3WriteBlockedList::PopFront() {
+  for (int level = kStaticLevel; level < kNumLevels; ++level) {
+    Level& candidates = levels_[level];
+    ReadyList& list = candidates.non_incremental.size > 0
+                          ? candidates.non_incremental
+                          : candidates.incremental;
+    StreamInfo* stream = list.head;
+    if (stream == nullptr) {
+      continue;
+    }
+    list.Remove(stream);
+    stream->ready = false;
+    --num_ready_;
+    if (level != kStaticLevel) {
+      ++stats_[level - kFirstUrgencyLevel].pops;
+    }
+    if (stream != last_popped_) {
+      last_popped_ = stream;
+      quantum_left_ = quantum_;
+    }
+    return stream->id;
+  }
+  QUIC_BUG(quic_http3_write_blocked_list_pop_empty)
+      << "No ready stream to pop";
+  return 0;
+}
+
+void QuicHttp3WriteBlockedList::RegisterStream(
+    QuicStreamId stream_id, bool is_static_stream,
+    const QuicStreamPriority& priority) {
+  StreamInfo info{stream_id, HttpStreamPriority(), is_static_stream};
+  if (!is_static_stream) {
+    info.priority = priority.http();
+  }
+  if (!streams_.emplace(stream_id, info).second) {
+    QUIC_BUG(quic_http3_write_blocked_list_duplicate_stream)
+        << "Stream " << stream_id << " already registered";
+  }
+}
+
+void QuicHttp3WriteBlockedList::UnregisterStream(QuicStreamId stream_id) {
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end()) {
+    QUIC_BUG(quic_http3_write_blocked_list_unregister_unknown_stream)
+        << "Stream " << stream_id << " not registered";
+    return;
+  }
+  StreamInfo& stream = it->second;
+  if (stream.ready) {
+    ReadyListOf(stream).Remove(&stream);
+    --num_ready_;
+  }
+  if (last_popped_ == &stream) {
+    last_popped_ = nullptr;
+  }
+  streams_.erase(it);
+}
+
+void QuicHttp3WriteBlockedList::UpdateStreamPriority(
+    QuicStreamId stream_id, const QuicStreamPriority& new_priority) {
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end() || it->second.is_static) {
+    QUIC_BUG(quic_http3_write_blocked_list_update_unknown_stream)
+        << "Stream " << stream_id << " not registered or static";
+    return;
+  }
+  StreamInfo& stream = it->second;
+  const HttpStreamPriority priority = new_priority.http();
+  if (priority == stream.priority) {
+    return;
+  }
+  ++stats_[LevelOfUrgency(priority.urgency) - kFirstUrgencyLevel]
+        .priority_updates;
+  if (!stream.ready) {
+    stream.priority = priority;
+    return;
+  }
+  ReadyListOf(stream).Remove(&stream);
+  stream.priority = priority;
+  ReadyListOf(stream).PushBack(&stream);
+}
+
+void QuicHttp3WriteBlockedList::UpdateBytesForStream(QuicStreamId stream_id,
+                                                     size_t bytes) {
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end() || it->second.is_static) {
+    return;
+  }
+  const StreamInfo& stream = it->second;
+  stats_[LevelOf(stream) - kFirstUrgencyLevel].bytes_written += bytes;
+  if (&stream == last_popped_) {
+    quantum_left_ -= std::min<QuicByteCount>(quantum_left_, bytes);
+  }
+}
+
+void QuicHttp3WriteBlockedList::AddStream(QuicStreamId stream_id) {
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end()) {
+    QUIC_BUG(quic_http3_write_blocked_list_add_unknown_stream)
+        << "Stream " << stream_id << " not registered";
+    return;
+  }
+  StreamInfo& stream = it->second;
+  if (stream.ready) {
+    return;
+  }
+  stream.ready = true;
+  ++num_ready_;
+  ReadyList& list = ReadyListOf(stream);
+  if (&stream != last_popped_ || stream.is_static) {
+    list.PushBack(&stream);
+    return;
+  }
+  // The stream being served keeps its place until it is done, or, if it is
+  // incremental, until its quantum is used.
+  if (!stream.priority.incremental || quantum_left_ > 0) {
+    list.PushFront(&stream);
+    return;
+  }
+  if (list.size > 0) {
+    ++stats_[LevelOf(stream) - kFirstUrgencyLevel].quanta_used;
+  }
+  list.PushBack(&stream);
+  // The stream gets a new quantum on its next turn.
+  last_popped_ = nullptr;
+}
+
+bool QuicHttp3WriteBlockedList::IsStreamBlocked(QuicStreamId stream_id) const {
+  const StreamInfo* stream = Find(stream_id);
+  return stream != nullptr && stream->ready;
+}
+
+QuicByteCount QuicHttp3WriteBlockedList::GetWriteQuota(
+    QuicStreamId stream_id) const {
+  const StreamInfo* stream = last_popped_;
+  // Only the incremental stream being served is cut short, and only if other
+  // incremental streams of its urgency are waiting for their turn.
+  if (stream == nullptr || stream->id != stream_id ||
+      !stream->priority.incremental ||
+      levels_[LevelOf(*stream)].incremental.size == 0) {
+    return std::numeric_limits<QuicByteCount>::max();
+  }
+  return quantum_left_;
+}
+
+}  // namespace quic
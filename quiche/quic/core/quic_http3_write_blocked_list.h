@@ -0,0 +1,135 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_HTTP3_WRITE_BLOCKED_LIST_H_
+#define QUICHE_QUIC_CORE_QUIC_HTTP3_WRITE_BLOCKED_LIST_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/container/node_hash_map.h"
+#include "quiche/quic/core/quic_stream_priority.h"
+#include "quiche/quic/core/quic_types.h"
+#include "quiche/quic/core/quic_write_blocked_list.h"
+#include "quiche/quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// Schedules streams as recommended by RFC 9218.  Static streams come first,
+// in the order they became ready.  Then, for each urgency from the most to
+// the least urgent, non-incremental streams are served one at a time in the
+// order they became ready, and incremental streams take turns writing
+// quantum-sized chunks.  Every operation, including the priority change of a
+// PRIORITY_UPDATE frame, takes constant time.
+class QUIC_EXPORT_PRIVATE QuicHttp3WriteBlockedList final
+    : public QuicWriteBlockedListInterface {
+ public:
+  // Counters of the streams of one urgency.
+  struct QUIC_EXPORT_PRIVATE UrgencyStats {
+    // Number of times PopFront() returned a stream of this urgency.
+    uint64_t pops = 0;
+    // Number of new stream data bytes written by streams of this urgency.
+    QuicByteCount bytes_written = 0;
+    // Number of times an incremental stream used up its quantum while other
+    // incremental streams of this urgency were waiting.
+    uint64_t quanta_used = 0;
+    // Number of priority updates which moved a stream to this urgency.
+    uint64_t priority_updates = 0;
+  };
+
+  // Incremental streams write up to |quantum| bytes per turn.
+  explicit QuicHttp3WriteBlockedList(QuicByteCount quantum);
+  QuicHttp3WriteBlockedList(const QuicHttp3WriteBlockedList&) = delete;
+  QuicHttp3WriteBlockedList& operator=(const QuicHttp3WriteBlockedList&) =
+      delete;
+  ~QuicHttp3WriteBlockedList() override;
+
+  // QuicWriteBlockedListInterface implementation.
+  bool HasWriteBlockedDataStreams() const override { return num_ready_ > 0; }
+  size_t NumBlockedSpecialStreams() const override {
+    return levels_[kStaticLevel].non_incremental.size;
+  }
+  size_t NumBlockedStreams() const override { return num_ready_; }
+  bool ShouldYield(QuicStreamId id) const override;
+  QuicStreamPriority GetPriorityOfStream(QuicStreamId id) const override;
+  QuicStreamId PopFront() override;
+  void RegisterStream(QuicStreamId stream_id, bool is_static_stream,
+                      const QuicStreamPriority& priority) override;
+  void UnregisterStream(QuicStreamId stream_id) override;
+  void UpdateStreamPriority(QuicStreamId stream_id,
+                            const QuicStreamPriority& new_priority) override;
+  void UpdateBytesForStream(QuicStreamId stream_id, size_t bytes) override;
+  void AddStream(QuicStreamId stream_id) override;
+  bool IsStreamBlocked(QuicStreamId stream_id) const override;
+  QuicByteCount GetWriteQuota(QuicStreamId stream_id) const override;
+
+  // Returns the counters of |urgency|.
+  const UrgencyStats& GetUrgencyStats(int urgency) const {
+    return stats_[LevelOfUrgency(urgency) - kFirstUrgencyLevel];
+  }
+
+ private:
+  struct StreamInfo {
+    QuicStreamId id;
+    HttpStreamPriority priority;
+    bool is_static;
+    bool ready = false;
+    // Neighbours in the ready list while |ready|.
+    StreamInfo* previous = nullptr;
+    StreamInfo* next = nullptr;
+  };
+
+  // An intrusive doubly-linked list, so that a stream can leave it from any
+  // position in constant time.
+  struct ReadyList {
+    void PushBack(StreamInfo* stream);
+    void PushFront(StreamInfo* stream);
+    void Remove(StreamInfo* stream);
+
+    StreamInfo* head = nullptr;
+    StreamInfo* tail = nullptr;
+    size_t size = 0;
+  };
+
+  struct Level {
+    // Also holds the static streams on kStaticLevel.
+    ReadyList non_incremental;
+    ReadyList incremental;
+  };
+
+  static constexpr int kStaticLevel = 0;
+  static constexpr int kFirstUrgencyLevel = 1;
+  static constexpr int kNumLevels = kFirstUrgencyLevel +
+                                    HttpStreamPriority::kMaximumUrgency -
+                                    HttpStreamPriority::kMinimumUrgency + 1;
+
+  // Urgencies outside of the supported range are clamped.
+  static int LevelOfUrgency(int urgency);
+  static int LevelOf(const StreamInfo& stream);
+
+  ReadyList& ReadyListOf(const StreamInfo& stream);
+
+  const StreamInfo* Find(QuicStreamId id) const;
+
+  // Returns true if a stream on a level before |level| is ready.
+  bool HasReadyStreamBefore(int level) const;
+
+  const QuicByteCount quantum_;
+  Level levels_[kNumLevels];
+  UrgencyStats stats_[kNumLevels - kFirstUrgencyLevel];
+  size_t num_ready_ = 0;
+  // Node based, so that the ready lists can point into it.
+  absl::node_hash_map<QuicStreamId, StreamInfo> streams_;
+
+  // The stream most recently returned by PopFront(), and how much of its
+  // quantum is left if it is incremental.  A non-incremental stream goes back
+  // to the front of its list, so that it is completed before the next one
+  // starts; an incremental stream does until its quantum is used.
+  const StreamInfo* last_popped_ = nullptr;
+  QuicByteCount quantum_left_ = 0;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_HTTP3_WRITE_BLOCKED_LIST_H_
@@ -0,0 +1,189 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_http3_write_blocked_list.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "quiche/quic/platform/api/quic_test.h"
+
+using ::testing::ElementsAre;
+
+namespace quic {
+namespace test {
+namespace {
+
+constexpr QuicByteCount kQuantum = 16 * 1024;
+// What the connection lets a stream write per turn, as in a congestion window
+// limited QuicSession::OnCanWrite().
+constexpr QuicByteCount kBytesPerTurn = 4 * 1350;
+
+QuicStreamPriority Priority(int urgency, bool incremental) {
+  return QuicStreamPriority(HttpStreamPriority{urgency, incremental});
+}
+
+class QuicHttp3WriteBlockedListTest : public QuicTest {
+ protected:
+  QuicHttp3WriteBlockedListTest() : list_(kQuantum) {}
+
+  void Register(QuicStreamId id, int urgency, bool incremental,
+                QuicByteCount size) {
+    list_.RegisterStream(id, /*is_static_stream=*/false,
+                         Priority(urgency, incremental));
+    remaining_[id] = size;
+    list_.AddStream(id);
+  }
+
+  // Serves streams the way QuicSession::OnCanWrite() does, until |stop| is
+  // called.  Returns the streams in the order they finished.
+  std::vector<QuicStreamId> WriteUntil(
+      std::function<bool(QuicStreamId)> stop = nullptr) {
+    std::vector<QuicStreamId> finished;
+    while (list_.HasWriteBlockedDataStreams()) {
+      const QuicStreamId id = list_.PopFront();
+      const QuicByteCount length = std::min(
+          {remaining_[id], kBytesPerTurn, list_.GetWriteQuota(id)});
+      list_.UpdateBytesForStream(id, length);
+      remaining_[id] -= length;
+      if (remaining_[id] == 0) {
+        finished.push_back(id);
+      } else {
+        list_.AddStream(id);
+      }
+      if (stop && stop(id)) {
+        break;
+      }
+    }
+    return finished;
+  }
+
+  QuicHttp3WriteBlockedList list_;
+  absl::flat_hash_map<QuicStreamId, QuicByteCount> remaining_;
+};
+
+TEST_F(QuicHttp3WriteBlockedListTest, StaticStreamsFirst) {
+  list_.RegisterStream(3, /*is_static_stream=*/true, Priority(3, false));
+  list_.RegisterStream(4, /*is_static_stream=*/false, Priority(2, false));
+  list_.AddStream(4);
+  list_.AddStream(3);
+  EXPECT_EQ(2u, list_.NumBlockedStreams());
+  EXPECT_EQ(1u, list_.NumBlockedSpecialStreams());
+  EXPECT_TRUE(list_.ShouldYield(4));
+  EXPECT_FALSE(list_.ShouldYield(3));
+  EXPECT_EQ(3u, list_.PopFront());
+  EXPECT_EQ(4u, list_.PopFront());
+  EXPECT_FALSE(list_.HasWriteBlockedDataStreams());
+}
+
+TEST_F(QuicHttp3WriteBlockedListTest, NonIncrementalBeforeIncremental) {
+  list_.RegisterStream(0, false, Priority(3, true));
+  list_.RegisterStream(4, false, Priority(3, false));
+  list_.RegisterStream(8, false, Priority(4, false));
+  list_.AddStream(8);
+  list_.AddStream(0);
+  list_.AddStream(4);
+  EXPECT_TRUE(list_.ShouldYield(0));
+  EXPECT_FALSE(list_.ShouldYield(4));
+  EXPECT_TRUE(list_.ShouldYield(8));
+  EXPECT_EQ(4u, list_.PopFront());
+  EXPECT_EQ(0u, list_.PopFront());
+  EXPECT_EQ(8u, list_.PopFront());
+}
+
+// A non-incremental stream keeps writing until it is done.
+TEST_F(QuicHttp3WriteBlockedListTest, NonIncrementalStreamsInTurn) {
+  Register(0, 3, false, 3 * kBytesPerTurn);
+  Register(4, 3, false, kBytesPerTurn);
+  std::vector<QuicStreamId> order;
+  WriteUntil([&order](QuicStreamId id) {
+    order.push_back(id);
+    return false;
+  });
+  EXPECT_THAT(order, ElementsAre(0, 0, 0, 4));
+}
+
+// Incremental streams of the same urgency take turns of a quantum each.
+TEST_F(QuicHttp3WriteBlockedListTest, IncrementalStreamsShareQuanta) {
+  Register(0, 3, true, 2 * kQuantum);
+  Register(4, 3, true, 2 * kQuantum);
+  // The first stream writes a quantum and no more.
+  EXPECT_EQ(0u, list_.PopFront());
+  EXPECT_EQ(kQuantum, list_.GetWriteQuota(0));
+  list_.UpdateBytesForStream(0, kQuantum);
+  EXPECT_EQ(0u, list_.GetWriteQuota(0));
+  list_.AddStream(0);
+  EXPECT_EQ(4u, list_.PopFront());
+  // A stream alone at its urgency is not cut short.
+  EXPECT_EQ(std::numeric_limits<QuicByteCount>::max(),
+            list_.GetWriteQuota(4));
+  EXPECT_EQ(1u, list_.GetUrgencyStats(3).quanta_used);
+}
+
+TEST_F(QuicHttp3WriteBlockedListTest, PriorityUpdateMovesReadyStream) {
+  Register(0, 5, false, kBytesPerTurn);
+  Register(4, 4, false, kBytesPerTurn);
+  EXPECT_TRUE(list_.ShouldYield(0));
+  list_.UpdateStreamPriority(0, Priority(2, false));
+  EXPECT_FALSE(list_.ShouldYield(0));
+  EXPECT_EQ(Priority(2, false), list_.GetPriorityOfStream(0));
+  EXPECT_EQ(1u, list_.GetUrgencyStats(2).priority_updates);
+  EXPECT_EQ(0u, list_.PopFront());
+  EXPECT_EQ(4u, list_.PopFront());
+}
+
+TEST_F(QuicHttp3WriteBlockedListTest, UnregisterReadyStream) {
+  Register(0, 3, true, kBytesPerTurn);
+  Register(4, 3, true, kBytesPerTurn);
+  Register(8, 3, true, kBytesPerTurn);
+  list_.UnregisterStream(4);
+  EXPECT_EQ(2u, list_.NumBlockedStreams());
+  EXPECT_FALSE(list_.IsStreamBlocked(4));
+  EXPECT_EQ(0u, list_.PopFront());
+  EXPECT_EQ(8u, list_.PopFront());
+}
+
+// Loads a page: the HTML and a stylesheet are non-incremental and urgent, a
+// script follows, and images are incremental and the least urgent.
+TEST_F(QuicHttp3WriteBlockedListTest, PageLoad) {
+  constexpr QuicStreamId kImages[] = {16, 20, 24};
+  Register(0, 2, false, 20000);   // HTML
+  for (QuicStreamId image : kImages) {
+    Register(image, 5, true, 100000);
+  }
+  Register(8, 3, false, 30000);   // Script
+  Register(4, 2, false, 10000);   // Stylesheet
+  EXPECT_THAT(WriteUntil(), ElementsAre(0, 4, 8, 16, 20, 24));
+
+  for (QuicStreamId image : kImages) {
+    Register(image + 12, 5, true, 100000);
+  }
+  // The images are interleaved: when the first one is done, the others are at
+  // most a quantum and a turn behind.
+  WriteUntil([this](QuicStreamId) { return remaining_[28] == 0; });
+  EXPECT_LE(remaining_[32], kQuantum + kBytesPerTurn);
+  EXPECT_LE(remaining_[36], kQuantum + kBytesPerTurn);
+  EXPECT_EQ(2 * 3 * 100000u, list_.GetUrgencyStats(5).bytes_written +
+                                 remaining_[32] + remaining_[36]);
+  EXPECT_EQ(60000u, list_.GetUrgencyStats(2).bytes_written +
+                        list_.GetUrgencyStats(3).bytes_written);
+}
+
+// A PRIORITY_UPDATE frame raising an image takes effect on its next turn.
+TEST_F(QuicHttp3WriteBlockedListTest, PageLoadWithPriorityUpdate) {
+  Register(0, 4, true, 100000);
+  Register(4, 4, true, 100000);
+  Register(8, 5, true, 100000);
+  // Stop after the first turn.
+  WriteUntil([](QuicStreamId) { return true; });
+  list_.UpdateStreamPriority(8, Priority(2, true));
+  EXPECT_THAT(WriteUntil(), ElementsAre(8, 0, 4));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
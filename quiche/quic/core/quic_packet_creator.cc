@@ -27,6 +27,7 @@
 #include "quiche/quic/core/quic_constants.h"
 #include "quiche/quic/core/quic_data_writer.h"
 #include "quiche/quic/core/quic_error_codes.h"
+#include "quiche/quic/core/quic_hot_path_profiler.h"
 #include "quiche/quic/core/quic_types.h"
 #include "quiche/quic/core/quic_utils.h"
 #include "quiche/quic/core/quic_versions.h"
@@ -780,6 +781,7 @@ QuicPacketCreator::MaybeBuildDataPacketWithChaosProtection(
 bool QuicPacketCreator::SerializePacket(QuicOwnedPacketBuffer encrypted_buffer,
                                         size_t encrypted_buffer_len,
                                         bool allow_padding) {
+  QUIC_HOT_PATH_PROBE(HOT_PATH_SERIALIZE_PACKET);
   QUICHE_DCHECK(packet_.encrypted_buffer == nullptr);
   if (DCHECK_FLAG && packet_.encrypted_buffer != nullptr) {
     const std::string error_details =
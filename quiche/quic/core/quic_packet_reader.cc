@@ -56,6 +56,9 @@ bool QuicPacketReader::ReadAndDispatchPackets(
                 QuicUdpPacketInfoBit::RECV_TIMESTAMP, QuicUdpPacketInfoBit::TTL,
                 QuicUdpPacketInfoBit::GOOGLE_PACKET_HEADER),
       &read_results_);
+  if (packets_read > 0) {
+    processor->OnReadBurstStart();
+  }
   for (size_t i = 0; i < packets_read; ++i) {
     auto& result = read_results_[i];
     if (!result.ok) {
@@ -102,6 +105,9 @@ bool QuicPacketReader::ReadAndDispatchPackets(
     QuicSocketAddress self_address(self_ip, port);
     processor->ProcessPacket(self_address, peer_address, packet);
   }
+  if (packets_read > 0) {
+    processor->OnReadBurstEnd();
+  }
 
   // We may not have read all of the packets available on the socket.
   return packets_read == kNumPacketsPerReadMmsgCall;
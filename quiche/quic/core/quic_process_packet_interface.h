@@ -17,6 +17,12 @@ class QUIC_NO_EXPORT ProcessPacketInterface {
   virtual void ProcessPacket(const QuicSocketAddress& self_address,
                              const QuicSocketAddress& peer_address,
                              const QuicReceivedPacket& packet) = 0;
+
+  // Called before and after the packets read by a single system call are
+  // passed to ProcessPacket(), so that connections can respond to all of them
+  // at once.
+  virtual void OnReadBurstStart() {}
+  virtual void OnReadBurstEnd() {}
 };
 
 }  // namespace quic
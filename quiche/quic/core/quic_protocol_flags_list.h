@@ -148,6 +148,17 @@ QUIC_PROTOCOL_FLAG(
     int32_t, quic_bbr2_default_initial_ack_height_filter_window, 10,
     "The default initial value of the max ack height filter's window length.")
 
+QUIC_PROTOCOL_FLAG(
+    int64_t, quic_bbr2_subnet_bandwidth_cache_size, 0,
+    "If positive, servers remember the BBRv2 bandwidth and min RTT of up to "
+    "this many client subnets, and use them to seed STARTUP of new "
+    "connections from the same subnet.")
+
+QUIC_PROTOCOL_FLAG(
+    int64_t, quic_bbr2_subnet_bandwidth_cache_max_age_seconds, 300,
+    "Entries of the BBRv2 subnet bandwidth cache older than this are not "
+    "used.")
+
 QUIC_PROTOCOL_FLAG(
     double, quic_ack_aggregation_bandwidth_threshold, 1.0,
     "If the bandwidth during ack aggregation is smaller than (estimated "
@@ -189,6 +200,13 @@ QUIC_PROTOCOL_FLAG(
     "If non-zero and key update is allowed, the maximum number of "
     "packets sent for each key phase before initiating a key update.")
 
+QUIC_PROTOCOL_FLAG(
+    bool, quic_prepare_next_one_rtt_keys, false,
+    "If true, QUIC connections with TLS derive the keys of the next key phase "
+    "when the handshake is confirmed and from an alarm after each key update, "
+    "instead of on the packet path. Off by default because most connections "
+    "never update their keys.")
+
 QUIC_PROTOCOL_FLAG(bool, quic_disable_client_tls_zero_rtt, false,
                    "If true, QUIC client with TLS will not try 0-RTT.")
 
@@ -196,6 +214,23 @@ QUIC_PROTOCOL_FLAG(bool, quic_disable_server_tls_resumption, false,
                    "If true, QUIC server will disable TLS resumption by not "
                    "issuing or processing session tickets.")
 
+QUIC_PROTOCOL_FLAG(
+    int32_t, quic_tls_server_cipher_suite_policy, 0,
+    "Which AEAD QUIC servers with TLS prefer, see CipherSuitePolicy: 0 for "
+    "AES-GCM if the CPU has AES instructions, 1 for AES-GCM, 2 for "
+    "ChaCha20-Poly1305, 3 for whichever is faster in a startup measurement.")
+
+QUIC_PROTOCOL_FLAG(
+    int32_t, quic_server_key_exchange_pool_size, 0,
+    "If positive, QUIC crypto servers take the ephemeral key pairs of their "
+    "handshakes from a pool of up to this many key pairs per curve, which is "
+    "refilled by a background thread.")
+
+QUIC_PROTOCOL_FLAG(
+    bool, quic_enable_tls_cert_compression, false,
+    "If true, QUIC endpoints with TLS offer and accept RFC 8879 zlib "
+    "certificate compression.")
+
 QUIC_PROTOCOL_FLAG(bool, quic_defer_send_in_response, true,
                    "If true, QUIC servers will defer sending in response to "
                    "incoming packets by default.")
@@ -205,6 +240,38 @@ QUIC_PROTOCOL_FLAG(
     "If true, QUIC QPACK decoder includes 32-bytes overheader per entry while "
     "comparing request/response header size against its upper limit.")
 
+QUIC_PROTOCOL_FLAG(
+    bool, quic_qpack_encoder_frequency_strategy, false,
+    "If true, the QPACK encoders of HTTP/3 sessions decide which header fields "
+    "to insert into the dynamic table by how often they occur, and insert "
+    "repeated ones even when the blocked streams limit is reached.")
+
+QUIC_PROTOCOL_FLAG(
+    bool, quic_coalesce_http3_data_frames, true,
+    "If true, body written to an HTTP/3 stream within the scope of a "
+    "QuicSpdyStream::ScopedDataFrameCoalescer is sent in a single DATA "
+    "frame.")
+
+QUIC_PROTOCOL_FLAG(
+    bool, quic_use_http3_write_blocked_list, false,
+    "If true, sessions schedule streams with QuicHttp3WriteBlockedList, which "
+    "interleaves incremental streams of the same urgency.")
+
+QUIC_PROTOCOL_FLAG(
+    uint64_t, quic_http3_incremental_quantum, 16 * 1024,
+    "Number of bytes an incremental stream writes per turn when "
+    "--quic_use_http3_write_blocked_list is true.")
+
+QUIC_PROTOCOL_FLAG(
+    bool, quic_server_pool_send_buffers, false,
+    "If true, QuicServer allocates stream send buffers and HTTP/3 datagrams "
+    "from a quiche::PooledBufferAllocator.")
+
+QUIC_PROTOCOL_FLAG(
+    bool, quic_send_queued_datagrams_on_can_write, false,
+    "If true, sessions ask to write while their default datagram queue is not "
+    "empty, and send the queued datagrams in OnCanWrite().")
+
 QUIC_PROTOCOL_FLAG(
     bool, quic_reject_retry_token_in_initial_packet, false,
     "If true, always reject retry_token received in INITIAL packets")
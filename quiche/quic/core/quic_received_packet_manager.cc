@@ -47,6 +47,7 @@ QuicReceivedPacketManager::QuicReceivedPacketManager(QuicConnectionStats* stats)
       ack_frequency_(kDefaultRetransmittablePacketsBeforeAck),
       ack_decimation_delay_(uint8_t(1 / kAckDecimationDelay)),
       unlimited_ack_decimation_(false),
+      ack_thinning_(false),
       one_immediate_ack_(false),
       ignore_order_(false),
       local_max_ack_delay_(
@@ -66,6 +67,9 @@ void QuicReceivedPacketManager::SetFromConfig(const QuicConfig& config,
   if (config.HasClientSentConnectionOption(kAKDU, perspective)) {
     unlimited_ack_decimation_ = true;
   }
+  if (config.HasClientSentConnectionOption(kAKDB, perspective)) {
+    ack_thinning_ = true;
+  }
   if (config.HasClientSentConnectionOption(k1ACK, perspective)) {
     one_immediate_ack_ = true;
   }
@@ -246,9 +250,13 @@ void QuicReceivedPacketManager::MaybeUpdateAckFrequency(
   if (last_received_packet_number.ToUint64() < min_received_before_ack_decimation_) {
     return;
   }
-  ack_frequency_ = unlimited_ack_decimation_
-                       ? std::numeric_limits<size_t>::max()
-                       : kMaxRetransmittablePacketsBeforeAck;
+  if (unlimited_ack_decimation_) {
+    ack_frequency_ = std::numeric_limits<size_t>::max();
+  } else if (ack_thinning_) {
+    ack_frequency_ = kMaxAckThinningPacketTolerance;
+  } else {
+    ack_frequency_ = kMaxRetransmittablePacketsBeforeAck;
+  }
 }
 
 void QuicReceivedPacketManager::MaybeUpdateAckTimeout(
@@ -354,8 +362,12 @@ void QuicReceivedPacketManager::OnAckFrequencyFrame(
     return;
   }
   last_ack_frequency_frame_sequence_number_ = new_sequence_number;
-  ack_frequency_ = frame.packet_tolerance;
-  local_max_ack_delay_ = frame.max_ack_delay;
+  ack_frequency_ = std::max<uint64_t>(frame.packet_tolerance, 1);
+  // The peer must not ask for acks sooner than the min_ack_delay advertised in
+  // the transport parameters, see QuicSession::Initialize().
+  local_max_ack_delay_ =
+      std::max(frame.max_ack_delay,
+               QuicTime::Delta::FromMilliseconds(kDefaultMinAckDelayTimeMs));
   ignore_order_ = frame.ignore_order;
 }
 
@@ -190,6 +190,9 @@ class QUIC_EXPORT_PRIVATE QuicReceivedPacketManager {
   // When true, removes ack decimation's max number of packets(10) before
   // sending an ack.
   bool unlimited_ack_decimation_;
+  // When true, raises ack decimation's max number of packets before sending
+  // an ack to kMaxAckThinningPacketTolerance.
+  bool ack_thinning_;
   // When true, only send 1 immediate ACK when reordering is detected.
   bool one_immediate_ack_;
   // When true, do not ack immediately upon observation of packet reordering.
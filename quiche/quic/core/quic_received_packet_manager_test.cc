@@ -0,0 +1,147 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_received_packet_manager.h"
+
+#include <cstdint>
+
+#include "quiche/quic/core/congestion_control/rtt_stats.h"
+#include "quiche/quic/core/crypto/crypto_protocol.h"
+#include "quiche/quic/core/frames/quic_ack_frequency_frame.h"
+#include "quiche/quic/core/quic_config.h"
+#include "quiche/quic/core/quic_connection_stats.h"
+#include "quiche/quic/core/quic_constants.h"
+#include "quiche/quic/core/quic_packets.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/mock_clock.h"
+#include "quiche/quic/test_tools/quic_config_peer.h"
+
+namespace quic {
+namespace test {
+
+class QuicReceivedPacketManagerPeer {
+ public:
+  static size_t GetAckFrequency(const QuicReceivedPacketManager& manager) {
+    return manager.ack_frequency_;
+  }
+
+  static QuicTime::Delta GetLocalMaxAckDelay(
+      const QuicReceivedPacketManager& manager) {
+    return manager.local_max_ack_delay_;
+  }
+};
+
+namespace {
+
+const bool kInstigateAck = true;
+
+class QuicReceivedPacketManagerTest : public QuicTest {
+ protected:
+  QuicReceivedPacketManagerTest() : received_manager_(&stats_) {
+    clock_.AdvanceTime(QuicTime::Delta::FromSeconds(1));
+    rtt_stats_.UpdateRtt(QuicTime::Delta::FromMilliseconds(100),
+                         QuicTime::Delta::Zero(), QuicTime::Zero());
+  }
+
+  void SetConnectionOption(QuicTag tag) {
+    QuicConfig config;
+    QuicConfigPeer::SetReceivedConnectionOptions(&config, QuicTagVector{tag});
+    received_manager_.SetFromConfig(config, Perspective::IS_SERVER);
+  }
+
+  void RecordPacketReceipt(uint64_t packet_number) {
+    QuicPacketHeader header;
+    header.packet_number = QuicPacketNumber(packet_number);
+    received_manager_.RecordPacketReceived(header, clock_.ApproximateNow());
+  }
+
+  void MaybeUpdateAckTimeout(bool should_last_packet_instigate_acks,
+                             uint64_t last_received_packet_number) {
+    received_manager_.MaybeUpdateAckTimeout(
+        should_last_packet_instigate_acks,
+        QuicPacketNumber(last_received_packet_number),
+        /*last_packet_receipt_time=*/clock_.ApproximateNow(),
+        /*now=*/clock_.ApproximateNow(), &rtt_stats_);
+  }
+
+  // Receives packets |first| to |last| in order and at the same time, sends
+  // every ack which is due right away, and returns the number of those acks.
+  size_t ReceivePacketsAndCountAcks(uint64_t first, uint64_t last) {
+    size_t acks = 0;
+    for (uint64_t packet_number = first; packet_number <= last;
+         ++packet_number) {
+      RecordPacketReceipt(packet_number);
+      MaybeUpdateAckTimeout(kInstigateAck, packet_number);
+      if (received_manager_.ack_timeout().IsInitialized() &&
+          received_manager_.ack_timeout() <= clock_.ApproximateNow()) {
+        ++acks;
+        received_manager_.ResetAckStates();
+      }
+    }
+    return acks;
+  }
+
+  MockClock clock_;
+  RttStats rtt_stats_;
+  QuicConnectionStats stats_;
+  QuicReceivedPacketManager received_manager_;
+};
+
+TEST_F(QuicReceivedPacketManagerTest, AckDecimation) {
+  ReceivePacketsAndCountAcks(1, kMinReceivedBeforeAckDecimation);
+  received_manager_.ResetAckStates();
+  EXPECT_EQ(64u, ReceivePacketsAndCountAcks(
+                     kMinReceivedBeforeAckDecimation + 1,
+                     kMinReceivedBeforeAckDecimation +
+                         64 * kMaxRetransmittablePacketsBeforeAck));
+}
+
+TEST_F(QuicReceivedPacketManagerTest, AckThinning) {
+  SetConnectionOption(kAKDB);
+  ReceivePacketsAndCountAcks(1, kMinReceivedBeforeAckDecimation);
+  received_manager_.ResetAckStates();
+  EXPECT_EQ(kMaxAckThinningPacketTolerance,
+            QuicReceivedPacketManagerPeer::GetAckFrequency(received_manager_));
+  EXPECT_EQ(10u, ReceivePacketsAndCountAcks(
+                     kMinReceivedBeforeAckDecimation + 1,
+                     kMinReceivedBeforeAckDecimation +
+                         10 * kMaxAckThinningPacketTolerance));
+}
+
+TEST_F(QuicReceivedPacketManagerTest, AckFrequencyFrameIsClamped) {
+  QuicAckFrequencyFrame frame;
+  frame.sequence_number = 1;
+  frame.packet_tolerance = 0;
+  frame.max_ack_delay = QuicTime::Delta::FromMilliseconds(1);
+  received_manager_.OnAckFrequencyFrame(frame);
+  // A packet tolerance of 0 is invalid, and the peer must not ask for acks
+  // sooner than the advertised min_ack_delay.
+  EXPECT_EQ(1u,
+            QuicReceivedPacketManagerPeer::GetAckFrequency(received_manager_));
+  EXPECT_EQ(QuicTime::Delta::FromMilliseconds(kDefaultMinAckDelayTimeMs),
+            QuicReceivedPacketManagerPeer::GetLocalMaxAckDelay(
+                received_manager_));
+  EXPECT_EQ(5u, ReceivePacketsAndCountAcks(1, 5));
+
+  frame.sequence_number = 2;
+  frame.packet_tolerance = 20;
+  frame.max_ack_delay = QuicTime::Delta::FromMilliseconds(40);
+  received_manager_.OnAckFrequencyFrame(frame);
+  EXPECT_EQ(20u,
+            QuicReceivedPacketManagerPeer::GetAckFrequency(received_manager_));
+  EXPECT_EQ(QuicTime::Delta::FromMilliseconds(40),
+            QuicReceivedPacketManagerPeer::GetLocalMaxAckDelay(
+                received_manager_));
+
+  // Obsolete frames are ignored.
+  frame.sequence_number = 1;
+  frame.packet_tolerance = 3;
+  received_manager_.OnAckFrequencyFrame(frame);
+  EXPECT_EQ(20u,
+            QuicReceivedPacketManagerPeer::GetAckFrequency(received_manager_));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -16,6 +16,7 @@
 #include "quiche/quic/core/proto/cached_network_parameters_proto.h"
 #include "quiche/quic/core/quic_connection_stats.h"
 #include "quiche/quic/core/quic_constants.h"
+#include "quiche/quic/core/quic_hot_path_profiler.h"
 #include "quiche/quic/core/quic_packet_number.h"
 #include "quiche/quic/core/quic_transmission_info.h"
 #include "quiche/quic/core/quic_types.h"
@@ -128,6 +129,9 @@ void QuicSentPacketManager::SetFromConfig(const QuicConfig& config) {
     if (config.HasClientSentConnectionOption(kAFF1, perspective)) {
       use_smoothed_rtt_in_ack_delay_ = true;
     }
+    if (config.HasClientSentConnectionOption(kAFF3, perspective)) {
+      scale_ack_frequency_with_cwnd_ = true;
+    }
   }
   if (config.HasClientSentConnectionOption(kMAD0, perspective)) {
     ignore_ack_delay_ = true;
@@ -203,6 +207,9 @@ void QuicSentPacketManager::SetFromConfig(const QuicConfig& config) {
   if (config.HasClientRequestedIndependentOption(kRUNT, perspective)) {
     uber_loss_algorithm_.DisablePacketThresholdForRuntPackets();
   }
+  if (config.HasClientRequestedIndependentOption(kRACK, perspective)) {
+    uber_loss_algorithm_.EnableRack();
+  }
   if (config.HasClientSentConnectionOption(kCONH, perspective)) {
     conservative_handshake_retransmits_ = true;
   }
@@ -625,6 +632,13 @@ QuicAckFrequencyFrame QuicSentPacketManager::GetUpdatedAckFrequencyFrame()
 
   QUIC_RELOADABLE_FLAG_COUNT_N(quic_can_send_ack_frequency, 1, 3);
   frame.packet_tolerance = kMaxRetransmittablePacketsBeforeAck;
+  if (scale_ack_frequency_with_cwnd_) {
+    // About 8 acks per congestion window still give the bandwidth sampler
+    // several samples per round trip.
+    frame.packet_tolerance = std::clamp(
+        GetCongestionWindowInTcpMss() / 8, kMaxRetransmittablePacketsBeforeAck,
+        kMaxAckThinningPacketTolerance);
+  }
   auto rtt = use_smoothed_rtt_in_ack_delay_ ? rtt_stats_.SmoothedOrInitialRtt()
                                             : rtt_stats_.MinOrInitialRtt();
   frame.max_ack_delay = rtt * kAckDecimationDelay;
@@ -637,6 +651,17 @@ QuicAckFrequencyFrame QuicSentPacketManager::GetUpdatedAckFrequencyFrame()
   return frame;
 }
 
+bool QuicSentPacketManager::ShouldUpdateAckFrequency() const {
+  if (!scale_ack_frequency_with_cwnd_ || !CanSendAckFrequency() ||
+      last_sent_ack_frequency_packet_tolerance_ == 0) {
+    return false;
+  }
+  const QuicPacketCount packet_tolerance =
+      GetUpdatedAckFrequencyFrame().packet_tolerance;
+  return packet_tolerance >= 2 * last_sent_ack_frequency_packet_tolerance_ ||
+         2 * packet_tolerance <= last_sent_ack_frequency_packet_tolerance_;
+}
+
 bool QuicSentPacketManager::OnPacketSent(
     SerializedPacket* mutable_packet, QuicTime sent_time,
     TransmissionType transmission_type,
@@ -688,6 +713,11 @@ bool QuicSentPacketManager::OnPacketSent(
     }
   }
 #endif
+  if (!measure_rtt && uber_loss_algorithm_.use_rack()) {
+    // Only path probes are sent without measuring RTT, keep them out of the
+    // RACK state of the default path.
+    uber_loss_algorithm_.OnAlternativePathPacketSent(packet_number);
+  }
   unacked_packets_.AddSentPacket(mutable_packet, transmission_type, sent_time,
                                  in_flight, measure_rtt);
   // Reset the retransmission timer anytime a pending packet is sent.
@@ -1012,13 +1042,13 @@ const QuicTime QuicSentPacketManager::GetRetransmissionTime() const {
       }
 
       QuicTime delay_first = unacked_packets_.GetFirstInFlightTransmissionInfo()->sent_time +
-                    GetProbeTimeoutDelay(NUM_PACKET_NUMBER_SPACES);
+                    GetTailLossProbeDelay(NUM_PACKET_NUMBER_SPACES);
       QuicTime delay_last  = unacked_packets_.GetLastInFlightPacketSentTime() +
                     rtt_stats_.smoothed_rtt() * kFirstPtoSrttMultiplier / 2;
       return std::max(delay_first, delay_last);
     }
     // Ensure PTO never gets set to a time in the past.
-    return unacked_packets_.GetLastInFlightPacketSentTime() + GetProbeTimeoutDelay(NUM_PACKET_NUMBER_SPACES);
+    return unacked_packets_.GetLastInFlightPacketSentTime() + GetTailLossProbeDelay(NUM_PACKET_NUMBER_SPACES);
   }
 
   PacketNumberSpace packet_number_space = NUM_PACKET_NUMBER_SPACES;
@@ -1041,11 +1071,11 @@ const QuicTime QuicSentPacketManager::GetRetransmissionTime() const {
       // in flight packet. Only do this for application data.
       return
           std::max(
-              first_application_info->sent_time + GetProbeTimeoutDelay(packet_number_space),
+              first_application_info->sent_time + GetTailLossProbeDelay(packet_number_space),
               earliest_right_edge + kFirstPtoSrttMultiplier * rtt_stats_.smoothed_rtt() / 2);
     }
   }
-  return earliest_right_edge + GetProbeTimeoutDelay(packet_number_space);
+  return earliest_right_edge + GetTailLossProbeDelay(packet_number_space);
 }
 
 const QuicTime::Delta QuicSentPacketManager::GetPathDegradingDelay() const {
@@ -1101,6 +1131,24 @@ const QuicTime::Delta QuicSentPacketManager::GetProbeTimeoutDelay(
   return pto_delay * (1 << consecutive_pto_count_);
 }
 
+const QuicTime::Delta QuicSentPacketManager::GetTailLossProbeDelay(
+    PacketNumberSpace space) const {
+  const QuicTime::Delta pto_delay = GetProbeTimeoutDelay(space);
+  if (!uber_loss_algorithm_.use_rack() || consecutive_pto_count_ > 0 ||
+      rtt_stats_.smoothed_rtt().IsZero() || space == INITIAL_DATA ||
+      space == HANDSHAKE_DATA) {
+    return pto_delay;
+  }
+  // RACK-TLP (RFC 8985 section 7.2): the first probe fires after 2 * SRTT of
+  // the current path, plus the peer's max ack delay if a single packet is in
+  // flight and its ack may be delayed.
+  QuicTime::Delta tlp_delay = 2 * rtt_stats_.smoothed_rtt();
+  if (unacked_packets_.packets_in_flight() <= 1) {
+    tlp_delay = tlp_delay + peer_max_ack_delay_;
+  }
+  return std::min(pto_delay, std::max(tlp_delay, kAlarmGranularity));
+}
+
 QuicTime::Delta QuicSentPacketManager::GetSlowStartDuration() const {
   if (send_algorithm_->GetCongestionControlType() == kBBR ||
       send_algorithm_->GetCongestionControlType() == kBBRv2) {
@@ -1144,6 +1192,7 @@ SendAlgorithmInterface*
 QuicSentPacketManager::OnConnectionMigration(bool reset_send_algorithm) {
   consecutive_pto_count_ = 0;
   rtt_stats_.OnConnectionMigration();
+  uber_loss_algorithm_.OnConnectionMigration();
   if (!reset_send_algorithm) {
     send_algorithm_->OnConnectionMigration();
     return nullptr;
@@ -1246,6 +1295,7 @@ void QuicSentPacketManager::OnAckTimestamp(QuicPacketNumber packet_number,
 AckResult QuicSentPacketManager::OnAckFrameEnd(
     QuicTime ack_receive_time, QuicPacketNumber ack_packet_number,
     EncryptionLevel ack_decrypted_level) {
+  QUIC_HOT_PATH_PROBE(HOT_PATH_ON_ACK_FRAME_END);
   QuicByteCount prior_bytes_in_flight = unacked_packets_.bytes_in_flight();
   // Reverse packets_acked_ so that it is in ascending order.
   if (packets_acked_.size() > 1)
@@ -1448,6 +1498,8 @@ void QuicSentPacketManager::OnAckFrequencyFrameSent(
     const QuicAckFrequencyFrame& ack_frequency_frame) {
   in_use_sent_ack_delays_.emplace_back(ack_frequency_frame.max_ack_delay,
                                        ack_frequency_frame.sequence_number);
+  last_sent_ack_frequency_packet_tolerance_ =
+      ack_frequency_frame.packet_tolerance;
   if (ack_frequency_frame.max_ack_delay > peer_max_ack_delay_) {
     peer_max_ack_delay_ = ack_frequency_frame.max_ack_delay;
   }
@@ -214,6 +214,10 @@ class QUIC_EXPORT_PRIVATE QuicSentPacketManager {
 
   QuicAckFrequencyFrame GetUpdatedAckFrequencyFrame() const;
 
+  // Returns true if the packet tolerance of the last sent AckFrequencyFrame no
+  // longer matches the congestion window, see kAFF3.
+  bool ShouldUpdateAckFrequency() const;
+
   // Called when the retransmission timer expires and returns the retransmission
   // mode.
   RetransmissionTimeoutMode OnRetransmissionTimeout();
@@ -488,6 +492,10 @@ class QUIC_EXPORT_PRIVATE QuicSentPacketManager {
   // Returns the probe timeout.
   const QuicTime::Delta GetProbeTimeoutDelay(PacketNumberSpace space) const;
 
+  // Returns the delay of the next PTO when it is armed. Equals
+  // GetProbeTimeoutDelay() unless RACK-TLP shortens the first probe.
+  const QuicTime::Delta GetTailLossProbeDelay(PacketNumberSpace space) const;
+
   // Update the RTT if the ack is for the largest acked packet number.
   // Returns true if the rtt was updated.
   bool MaybeUpdateRTT(QuicPacketNumber largest_acked,
@@ -645,6 +653,14 @@ class QUIC_EXPORT_PRIVATE QuicSentPacketManager {
   // Use smoothed RTT for computing max_ack_delay in AckFrequency frame.
   bool use_smoothed_rtt_in_ack_delay_ = false;
 
+  // Scale the packet tolerance of AckFrequency frames with the congestion
+  // window, rather than always asking for an ack every 10 packets.
+  bool scale_ack_frequency_with_cwnd_ = false;
+
+  // The packet tolerance of the last sent AckFrequency frame, 0 if none was
+  // sent.
+  QuicPacketCount last_sent_ack_frequency_packet_tolerance_ = 0;
+
   // A reverse iterator of last_ack_frame_.packets. This is reset in
   // OnAckRangeStart, and gradually moves in OnAckRange..
   PacketNumberQueue::const_reverse_iterator acked_packets_iter_;
@@ -0,0 +1,95 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_sent_packet_manager.h"
+
+#include "quiche/quic/core/crypto/crypto_protocol.h"
+#include "quiche/quic/core/crypto/quic_random.h"
+#include "quiche/quic/core/frames/quic_ack_frequency_frame.h"
+#include "quiche/quic/core/quic_config.h"
+#include "quiche/quic/core/quic_connection_stats.h"
+#include "quiche/quic/core/quic_constants.h"
+#include "quiche/quic/platform/api/quic_flags.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/mock_clock.h"
+#include "quiche/quic/test_tools/quic_config_peer.h"
+#include "quiche/quic/test_tools/quic_sent_packet_manager_peer.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+
+using testing::NiceMock;
+using testing::Return;
+
+namespace quic {
+namespace test {
+namespace {
+
+class QuicSentPacketManagerTest : public QuicTest {
+ protected:
+  QuicSentPacketManagerTest()
+      : manager_(Perspective::IS_SERVER, &clock_, QuicRandom::GetInstance(),
+                 &stats_, kCubicBytes),
+        send_algorithm_(new NiceMock<MockSendAlgorithm>) {
+    QuicSentPacketManagerPeer::SetSendAlgorithm(&manager_, send_algorithm_);
+    clock_.AdvanceTime(QuicTime::Delta::FromSeconds(1));
+  }
+
+  void SetCongestionWindowInPackets(QuicPacketCount packets) {
+    ON_CALL(*send_algorithm_, GetCongestionWindow())
+        .WillByDefault(Return(packets * kDefaultTCPMSS));
+  }
+
+  MockClock clock_;
+  QuicConnectionStats stats_;
+  QuicSentPacketManager manager_;
+  // Owned by |manager_|.
+  MockSendAlgorithm* send_algorithm_;
+};
+
+TEST_F(QuicSentPacketManagerTest, AckFrequencyScalesWithCongestionWindow) {
+  SetQuicReloadableFlag(quic_can_send_ack_frequency, true);
+  QuicConfig config;
+  QuicConfigPeer::SetReceivedMinAckDelayMs(&config, kDefaultMinAckDelayTimeMs);
+  QuicConfigPeer::SetReceivedConnectionOptions(&config, QuicTagVector{kAFF3});
+  manager_.SetFromConfig(config);
+  manager_.SetHandshakeConfirmed();
+#if !QUIC_TLS_SESSION
+  // Only TLS sessions send AckFrequency frames.
+  EXPECT_FALSE(manager_.CanSendAckFrequency());
+  EXPECT_FALSE(manager_.ShouldUpdateAckFrequency());
+#else
+  ASSERT_TRUE(manager_.CanSendAckFrequency());
+  // About 8 acks per congestion window, but no fewer packets per ack than
+  // without kAFF3.
+  SetCongestionWindowInPackets(40);
+  EXPECT_EQ(kMaxRetransmittablePacketsBeforeAck,
+            manager_.GetUpdatedAckFrequencyFrame().packet_tolerance);
+  // Nothing to update before the first frame is sent.
+  EXPECT_FALSE(manager_.ShouldUpdateAckFrequency());
+  QuicSentPacketManagerPeer::OnAckFrequencyFrameSent(
+      &manager_, manager_.GetUpdatedAckFrequencyFrame());
+  EXPECT_FALSE(manager_.ShouldUpdateAckFrequency());
+
+  // The frame is only resent once the packet tolerance is off by 2x.
+  SetCongestionWindowInPackets(8 * 15);
+  EXPECT_FALSE(manager_.ShouldUpdateAckFrequency());
+  SetCongestionWindowInPackets(8 * 20);
+  EXPECT_TRUE(manager_.ShouldUpdateAckFrequency());
+
+  // At most kMaxAckThinningPacketTolerance packets per ack.
+  SetCongestionWindowInPackets(8 * 1000);
+  EXPECT_EQ(kMaxAckThinningPacketTolerance,
+            manager_.GetUpdatedAckFrequencyFrame().packet_tolerance);
+  QuicSentPacketManagerPeer::OnAckFrequencyFrameSent(
+      &manager_, manager_.GetUpdatedAckFrequencyFrame());
+  EXPECT_FALSE(manager_.ShouldUpdateAckFrequency());
+  SetCongestionWindowInPackets(8 * 40);
+  EXPECT_FALSE(manager_.ShouldUpdateAckFrequency());
+  SetCongestionWindowInPackets(8 * 32);
+  EXPECT_TRUE(manager_.ShouldUpdateAckFrequency());
+#endif
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -5,6 +5,7 @@
 #include "quiche/quic/core/quic_session.h"
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -17,6 +18,8 @@
 #include "quiche/quic/core/quic_connection_context.h"
 #include "quiche/quic/core/quic_error_codes.h"
 #include "quiche/quic/core/quic_flow_controller.h"
+#include "quiche/quic/core/quic_hot_path_profiler.h"
+#include "quiche/quic/core/quic_http3_write_blocked_list.h"
 #include "quiche/quic/core/quic_stream_priority.h"
 #include "quiche/quic/core/quic_types.h"
 #include "quiche/quic/core/quic_utils.h"
@@ -78,6 +81,11 @@ QuicSession::QuicSession(
     : connection_(connection),
       //visitor_(owner),
       //write_blocked_streams_{},
+      http3_write_blocked_streams_(
+          GetQuicFlag(quic_use_http3_write_blocked_list)
+              ? std::make_unique<QuicHttp3WriteBlockedList>(
+                    GetQuicFlag(quic_http3_incremental_quantum))
+              : nullptr),
       config_(config),
 #if QUIC_SERVER_SESSION == 1
       perspective_(connection->perspective()),
@@ -605,7 +613,7 @@ bool QuicSession::CheckStreamNotBusyLooping(QuicStream* stream,
 bool QuicSession::CheckStreamWriteBlocked(QuicStream* stream) const {
   if (stream->HasBufferedData() && !stream->write_side_closed() &&
       !stream->IsFlowControlBlocked() &&
-      !write_blocked_streams_.IsStreamBlocked(stream->id())) {
+      !write_blocked_streams()->IsStreamBlocked(stream->id())) {
     QUIC_DLOG(ERROR) << ENDPOINT << "stream " << stream->id()
                      << " has buffered " << stream->BufferedDataBytes()
                      << " bytes, and is not flow control blocked, "
@@ -616,6 +624,7 @@ bool QuicSession::CheckStreamWriteBlocked(QuicStream* stream) const {
 }
 
 void QuicSession::OnCanWrite() {
+  QUIC_HOT_PATH_PROBE(HOT_PATH_SESSION_ON_CAN_WRITE);
   if (false && connection_->framer().is_processing_packet()) {
     // Do not write data in the middle of packet processing because rest
     // frames in the packet may change the data to write. For example, lost
@@ -651,9 +660,16 @@ void QuicSession::OnCanWrite() {
   // If we are connection level flow control blocked, then only allow the
   // crypto and headers streams to try writing as all other streams will be
   // blocked.
-  size_t num_writes = false && flow_controller_.IsBlocked()
-                          ? write_blocked_streams_.NumBlockedSpecialStreams()
-                          : write_blocked_streams_.NumBlockedStreams();
+  size_t num_writes;
+  if (http3_write_blocked_streams_ != nullptr) {
+    num_writes = false && flow_controller_.IsBlocked()
+                     ? http3_write_blocked_streams_->NumBlockedSpecialStreams()
+                     : http3_write_blocked_streams_->NumBlockedStreams();
+  } else {
+    num_writes = false && flow_controller_.IsBlocked()
+                     ? write_blocked_streams_.NumBlockedSpecialStreams()
+                     : write_blocked_streams_.NumBlockedStreams();
+  }
   if (num_writes == 0 && !control_frame_manager_.WillingToWrite() && datagram_queue_.empty()  
 #if QUIC_TLS_SESSION
     &&
@@ -686,8 +702,9 @@ void QuicSession::OnCanWrite() {
 #endif
 
   // TODO(b/147146815): this makes all datagrams go before stream data.  We
-  // should have a better priority scheme for this. TODO3.remove it before use
-  if (enable_frame_message && !datagram_queue_.empty()) {
+  // should have a better priority scheme for this.
+  if (GetQuicFlag(quic_send_queued_datagrams_on_can_write) &&
+      !datagram_queue_.empty()) {
     size_t written = datagram_queue_.SendDatagrams();
     QUIC_DVLOG(1) << ENDPOINT << "Sent " << written << " datagrams";
     if (!datagram_queue_.empty()) {
@@ -698,8 +715,8 @@ void QuicSession::OnCanWrite() {
   absl::InlinedVector<QuicStreamId, 8> last_writing_stream_ids;
   for (size_t i = 0; i < num_writes; ++i) {
 #if DCHECK_FLAG
-    if (!(write_blocked_streams_.HasWriteBlockedSpecialStream() ||
-          write_blocked_streams_.HasWriteBlockedDataStreams())) {
+    if (!(write_blocked_streams()->HasWriteBlockedSpecialStream() ||
+          write_blocked_streams()->HasWriteBlockedDataStreams())) {
       // Writing one stream removed another!? Something's broken.
       QUIC_BUG(quic_bug_10866_1)
           << "WriteBlockedStream is missing, num_writes: " << num_writes
@@ -719,7 +736,10 @@ void QuicSession::OnCanWrite() {
     if (i > 0 && !CanWriteStreamData()) {
       return;
     }
-    currently_writing_stream_id_ = write_blocked_streams_.PopFront();
+    currently_writing_stream_id_ =
+        http3_write_blocked_streams_ != nullptr
+            ? http3_write_blocked_streams_->PopFront()
+            : write_blocked_streams_.PopFront();
     last_writing_stream_ids.push_back(currently_writing_stream_id_);
     QUIC_DVLOG(1) << ENDPOINT << "Removing stream "
                   << currently_writing_stream_id_ << " from write-blocked list";
@@ -761,13 +781,21 @@ bool QuicSession::WillingAndAbleToWrite() const {
     control_frame_manager_.WillingToWrite()) {
     return true;
   }
+  if (GetQuicFlag(quic_send_queued_datagrams_on_can_write) &&
+      !datagram_queue_.empty()) {
+    return true;
+  }
   if (false && flow_controller_.IsBlocked()) { //never happens only for bad con...
     if (VersionUsesHttp3(transport_version())) {
       return false;
     }
     // Crypto and headers streams are not blocked by connection level flow
     // control.
-    return write_blocked_streams_.HasWriteBlockedSpecialStream();
+    return write_blocked_streams()->HasWriteBlockedSpecialStream();
+  }
+  if (http3_write_blocked_streams_ != nullptr) {
+    return http3_write_blocked_streams_->HasWriteBlockedDataStreams() ||
+           http3_write_blocked_streams_->HasWriteBlockedSpecialStream();
   }
   return write_blocked_streams_.HasWriteBlockedDataStreams() ||
          write_blocked_streams_.HasWriteBlockedSpecialStream();
@@ -809,7 +837,7 @@ bool QuicSession::HasPendingHandshake() const {
 
   const auto cid = QuicUtils::GetCryptoStreamId(transport_version());
   return streams_with_pending_retransmission_.contains(cid) ||
-         write_blocked_streams_.IsStreamBlocked(cid);
+         write_blocked_streams()->IsStreamBlocked(cid);
 }
 
 void QuicSession::ProcessUdpPacket(const QuicSocketAddress& self_address,
@@ -868,6 +896,19 @@ QuicConsumedData QuicSession::WritevData(QuicStreamId id, size_t write_length,
     return QuicConsumedData(0, false);
   }
 
+  if (type == NOT_RETRANSMISSION && http3_write_blocked_streams_ != nullptr) {
+    // Incremental streams of the same urgency take turns.
+    const QuicByteCount quota =
+        http3_write_blocked_streams_->GetWriteQuota(id);
+    if (write_length > quota) {
+      if (quota == 0) {
+        return QuicConsumedData(0, false);
+      }
+      write_length = quota;
+      state = NO_FIN;
+    }
+  }
+
   SetTransmissionType(type);
   //QUICHE_CHECK(level == connection_->encryption_level());// TODO2 hybchanged removed it
 #if DEBUG || QUIC_TLS_SESSION //TODO3
@@ -877,7 +918,12 @@ QuicConsumedData QuicSession::WritevData(QuicStreamId id, size_t write_length,
       connection_->SendStreamData(id, write_length, offset, state);
   if (type == NOT_RETRANSMISSION) {
     // This is new stream data.
-    write_blocked_streams_.UpdateBytesForStream(id, data.bytes_consumed);
+    if (http3_write_blocked_streams_ != nullptr) {
+      http3_write_blocked_streams_->UpdateBytesForStream(id,
+                                                         data.bytes_consumed);
+    } else {
+      write_blocked_streams_.UpdateBytesForStream(id, data.bytes_consumed);
+    }
   }
 
   return data;
@@ -1854,16 +1900,16 @@ void QuicSession::OnCryptoHandshakeMessageReceived(
 
 void QuicSession::RegisterStreamPriority(QuicStreamId id, bool is_static,
                                          const QuicStreamPriority& priority) {
-  write_blocked_streams_.RegisterStream(id, is_static, priority);
+  write_blocked_streams()->RegisterStream(id, is_static, priority);
 }
 
 void QuicSession::UnregisterStreamPriority(QuicStreamId id) {
-  write_blocked_streams_.UnregisterStream(id);
+  write_blocked_streams()->UnregisterStream(id);
 }
 
 void QuicSession::UpdateStreamPriority(QuicStreamId id,
                                        const QuicStreamPriority& new_priority) {
-  write_blocked_streams_.UpdateStreamPriority(id, new_priority);
+  write_blocked_streams()->UpdateStreamPriority(id, new_priority);
 }
 
 void QuicSession::ActivateStream(QuicStream* stream) {
@@ -2046,6 +2092,9 @@ bool QuicSession::ShouldYield(QuicStreamId stream_id) {
   if (stream_id == currently_writing_stream_id_) {
     return false;
   }
+  if (http3_write_blocked_streams_ != nullptr) {
+    return http3_write_blocked_streams_->ShouldYield(stream_id);
+  }
   return write_blocked_streams_.ShouldYield(stream_id);
 }
 
@@ -2152,13 +2201,17 @@ void QuicSession::MarkConnectionLevelWriteBlocked(QuicStreamId id) {
   QUIC_DVLOG(1) << ENDPOINT << "Adding stream " << id
                 << " to write-blocked list";
 
+  if (http3_write_blocked_streams_ != nullptr) {
+    http3_write_blocked_streams_->AddStream(id);
+    return;
+  }
   write_blocked_streams_.AddStream(id);
 }
 
 #if 0
 bool QuicSession::HasDataToWrite() const {
-  return write_blocked_streams_.HasWriteBlockedSpecialStream() ||
-         write_blocked_streams_.HasWriteBlockedDataStreams() ||
+  return write_blocked_streams()->HasWriteBlockedSpecialStream() ||
+         write_blocked_streams()->HasWriteBlockedDataStreams() ||
          connection_->HasQueuedData() ||
          !streams_with_pending_retransmission_.empty() ||
          control_frame_manager_.WillingToWrite();
@@ -2577,6 +2630,12 @@ MessageResult QuicSession::SendMessage(quiche::QuicheMemSlice message) {
   return SendMessage(absl::MakeSpan(&message, 1), /*flush=*/false);
 }
 
+MessageStatus QuicSession::SendOrQueueMessage(
+    quiche::QuicheMemSlice message,
+    const QuicDatagramQueue::DatagramParameters& parameters) {
+  return datagram_queue_.SendOrQueueDatagram(std::move(message), parameters);
+}
+
 MessageResult QuicSession::SendMessage(
     absl::Span<quiche::QuicheMemSlice> message, bool flush) {
   QUICHE_DCHECK(connection_->connected())
@@ -30,6 +30,7 @@
 #include "quiche/quic/core/quic_crypto_stream.h"
 #include "quiche/quic/core/quic_datagram_queue.h"
 #include "quiche/quic/core/quic_error_codes.h"
+#include "quiche/quic/core/quic_http3_write_blocked_list.h"
 #include "quiche/quic/core/quic_packet_creator.h"
 #include "quiche/quic/core/quic_packets.h"
 #include "quiche/quic/core/quic_path_validator.h"
@@ -247,6 +248,20 @@ class QUIC_EXPORT_PRIVATE QuicSession
   // version always takes ownership of the slice.
   MessageResult SendMessage(quiche::QuicheMemSlice message);
 
+  // Sends |message| right away if the default datagram queue is empty and the
+  // connection can write, and queues it otherwise.  Queued messages are sent
+  // by priority and deadline, and dropped if they cannot be sent before their
+  // deadline; see QuicDatagramQueue.  Unlike SendMessage(), the message ID is
+  // not returned.
+  MessageStatus SendOrQueueMessage(
+      quiche::QuicheMemSlice message,
+      const QuicDatagramQueue::DatagramParameters& parameters);
+
+  // Drop and queueing statistics of the default datagram queue.
+  const QuicDatagramQueue::Stats& datagram_queue_stats() const {
+    return datagram_queue_.stats();
+  }
+
   // Called when message with |message_id| gets acked.
   virtual void OnMessageAcked(QuicMessageId message_id,
                               QuicTime receive_timestamp);
@@ -725,7 +740,7 @@ class QUIC_EXPORT_PRIVATE QuicSession
   _virtua constexpr bool ShouldProcessPendingStreamImmediately() const { return true; }
 
   spdy::SpdyPriority GetSpdyPriorityofStream(QuicStreamId stream_id) const {
-    return write_blocked_streams_.GetPriorityOfStream(stream_id)
+    return write_blocked_streams()->GetPriorityOfStream(stream_id)
         .http()
         .urgency;
   }
@@ -738,6 +753,15 @@ class QUIC_EXPORT_PRIVATE QuicSession
       QuicStreamId largest_peer_created_stream_id);
 
   QuicWriteBlockedListInterface* write_blocked_streams() {
+    if (http3_write_blocked_streams_ != nullptr) {
+      return http3_write_blocked_streams_.get();
+    }
+    return &write_blocked_streams_;
+  }
+  const QuicWriteBlockedListInterface* write_blocked_streams() const {
+    if (http3_write_blocked_streams_ != nullptr) {
+      return http3_write_blocked_streams_.get();
+    }
     return &write_blocked_streams_;
   }
 
@@ -940,9 +964,14 @@ class QUIC_EXPORT_PRIVATE QuicSession
 
   // A list of streams which need to write more data.  Stream register
   // themselves in their constructor, and unregisterm themselves in their
-  // destructors, so the write blocked list must outlive all streams.
+  // destructors, so the write blocked list must outlive all streams.  Unused
+  // if |http3_write_blocked_streams_| is set.
   QuicWriteBlockedList write_blocked_streams_;
 
+  // Replaces |write_blocked_streams_| if --quic_use_http3_write_blocked_list
+  // was set when the session was created.  Null otherwise.
+  std::unique_ptr<QuicHttp3WriteBlockedList> http3_write_blocked_streams_;
+
   ClosedStreams closed_streams_;
 
   // Map from StreamId to pointers to streams. Owns the streams.
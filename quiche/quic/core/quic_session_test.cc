@@ -0,0 +1,216 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/core/quic_session.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "quiche/quic/core/crypto/null_encrypter.h"
+#include "quiche/quic/core/quic_datagram_queue.h"
+#include "quiche/quic/core/quic_stream.h"
+#include "quiche/quic/core/quic_stream_priority.h"
+#include "quiche/quic/core/quic_types.h"
+#include "quiche/quic/platform/api/quic_flags.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/quic_connection_peer.h"
+#include "quiche/quic/test_tools/quic_session_peer.h"
+#include "quiche/quic/test_tools/quic_stream_peer.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+#include "quiche/common/quiche_buffer_allocator.h"
+#include "quiche/common/simple_buffer_allocator.h"
+
+using testing::_;
+using testing::ElementsAre;
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+
+namespace quic {
+namespace test {
+namespace {
+
+constexpr QuicByteCount kQuantum = 1000;
+
+class EstablishedCryptoStream : public MockQuicCryptoStream {
+ public:
+  using MockQuicCryptoStream::MockQuicCryptoStream;
+
+  bool encryption_established() const override { return true; }
+  bool one_rtt_keys_available() const override { return true; }
+};
+
+class TestStream : public QuicStream {
+ public:
+  TestStream(QuicStreamId id, QuicSession* session)
+      : QuicStream(id, session, /*is_static=*/false, BIDIRECTIONAL) {}
+
+  void OnDataAvailable() override {}
+};
+
+class QuicSessionWriteQuotaTest : public QuicTest {
+ protected:
+  // Creates the session, which picks its write blocked list by the flags.
+  void CreateSession(bool use_http3_write_blocked_list) {
+    SetQuicFlag(quic_use_http3_write_blocked_list,
+                use_http3_write_blocked_list);
+    SetQuicFlag(quic_http3_incremental_quantum, kQuantum);
+    connection_ = new NiceMock<MockQuicConnection>(&helper_, &alarm_factory_,
+                                                   Perspective::IS_SERVER);
+    session_ = std::make_unique<NiceMock<MockQuicSession>>(
+        connection_, /*create_mock_crypto_stream=*/false);
+    session_->SetCryptoStream(new EstablishedCryptoStream(session_.get()));
+    connection_->SetEncrypter(
+        ENCRYPTION_FORWARD_SECURE,
+        std::make_unique<NullEncrypter>(Perspective::IS_SERVER));
+    connection_->SetDefaultEncryptionLevel(ENCRYPTION_FORWARD_SECURE);
+    auto* writer = static_cast<MockPacketWriter*>(
+        QuicConnectionPeer::GetWriter(connection_));
+    ON_CALL(*writer, WritePacket(_, _, _, _, _))
+        .WillByDefault(Return(WriteResult(WRITE_STATUS_OK, 0)));
+  }
+
+  // Returns an incremental stream with |length| bytes buffered, waiting on
+  // the write blocked list as if the connection had been blocked.
+  TestStream* CreateBlockedIncrementalStream(int n, QuicByteCount length) {
+    auto* stream = new TestStream(GetNthServerInitiatedBidirectionalStreamId(
+                                      connection_->transport_version(), n),
+                                  session_.get());
+    session_->ActivateStream(stream);
+    stream->SetPriority(QuicStreamPriority(HttpStreamPriority{
+        HttpStreamPriority::kDefaultUrgency, /*incremental=*/true}));
+    QuicStreamPeer::SendBuffer(stream).SaveStreamData(
+        std::string(length, 'a'));
+    session_->MarkConnectionLevelWriteBlocked(stream->id());
+    return stream;
+  }
+
+  MockQuicConnectionHelper helper_;
+  MockAlarmFactory alarm_factory_;
+  MockQuicConnection* connection_ = nullptr;  // Owned by |session_|.
+  std::unique_ptr<NiceMock<MockQuicSession>> session_;
+};
+
+TEST_F(QuicSessionWriteQuotaTest, IncrementalStreamsTakeTurns) {
+  CreateSession(/*use_http3_write_blocked_list=*/true);
+  TestStream* first = CreateBlockedIncrementalStream(0, 3 * kQuantum);
+  TestStream* second = CreateBlockedIncrementalStream(1, 3 * kQuantum);
+
+  // WritevData() cuts each write short at the end of the quantum of the
+  // stream, and the stream queues itself behind the other one.
+  session_->OnCanWrite();
+  EXPECT_EQ(kQuantum, first->stream_bytes_written());
+  EXPECT_EQ(kQuantum, second->stream_bytes_written());
+  EXPECT_TRUE(
+      QuicSessionPeer::IsStreamWriteBlocked(session_.get(), first->id()));
+  EXPECT_TRUE(
+      QuicSessionPeer::IsStreamWriteBlocked(session_.get(), second->id()));
+  EXPECT_TRUE(session_->WillingAndAbleToWrite());
+
+  session_->OnCanWrite();
+  EXPECT_EQ(2 * kQuantum, first->stream_bytes_written());
+  EXPECT_EQ(2 * kQuantum, second->stream_bytes_written());
+}
+
+TEST_F(QuicSessionWriteQuotaTest, LastIncrementalStreamIsNotCut) {
+  CreateSession(/*use_http3_write_blocked_list=*/true);
+  TestStream* stream = CreateBlockedIncrementalStream(0, 3 * kQuantum);
+
+  // No other stream is waiting for its turn.
+  session_->OnCanWrite();
+  EXPECT_EQ(3 * kQuantum, stream->stream_bytes_written());
+  EXPECT_FALSE(
+      QuicSessionPeer::IsStreamWriteBlocked(session_.get(), stream->id()));
+}
+
+TEST_F(QuicSessionWriteQuotaTest, NoQuotaWithFlagOff) {
+  CreateSession(/*use_http3_write_blocked_list=*/false);
+  TestStream* first = CreateBlockedIncrementalStream(0, 3 * kQuantum);
+  TestStream* second = CreateBlockedIncrementalStream(1, 3 * kQuantum);
+
+  session_->OnCanWrite();
+  EXPECT_EQ(3 * kQuantum, first->stream_bytes_written());
+  EXPECT_EQ(3 * kQuantum, second->stream_bytes_written());
+  EXPECT_FALSE(session_->WillingAndAbleToWrite());
+}
+
+class QuicSessionDatagramTest : public QuicTest {
+ protected:
+  QuicSessionDatagramTest()
+      : connection_(new NiceMock<MockQuicConnection>(
+            &helper_, &alarm_factory_, Perspective::IS_CLIENT)),
+        session_(connection_, /*create_mock_crypto_stream=*/false) {
+    session_.SetCryptoStream(new EstablishedCryptoStream(&session_));
+    connection_->SetEncrypter(
+        ENCRYPTION_FORWARD_SECURE,
+        std::make_unique<NullEncrypter>(Perspective::IS_CLIENT));
+    // Records what is sent while |blocked_| is false.
+    ON_CALL(*connection_, SendMessage(_, _, _))
+        .WillByDefault(Invoke([this](QuicMessageId,
+                                     absl::Span<quiche::QuicheMemSlice> message,
+                                     bool) {
+          if (blocked_) {
+            return MESSAGE_STATUS_BLOCKED;
+          }
+          sent_.push_back(std::string(message[0].AsStringView()));
+          return MESSAGE_STATUS_SUCCESS;
+        }));
+  }
+
+  MessageStatus Queue(absl::string_view data, int priority,
+                      QuicTime deadline = QuicTime::Zero()) {
+    return session_.SendOrQueueMessage(
+        quiche::QuicheMemSlice(quiche::QuicheBuffer::Copy(
+            quiche::SimpleBufferAllocator::Get(), data)),
+        {priority, deadline});
+  }
+
+  // Queues datagrams of two priorities, with and without deadlines.
+  void QueueDatagrams() {
+    const QuicTime now = helper_.GetClock()->ApproximateNow();
+    blocked_ = true;
+    EXPECT_EQ(MESSAGE_STATUS_BLOCKED, Queue("none", /*priority=*/0));
+    EXPECT_EQ(MESSAGE_STATUS_BLOCKED,
+              Queue("late", 0, now + QuicTime::Delta::FromMilliseconds(30)));
+    EXPECT_EQ(MESSAGE_STATUS_BLOCKED,
+              Queue("early", 0, now + QuicTime::Delta::FromMilliseconds(10)));
+    EXPECT_EQ(MESSAGE_STATUS_BLOCKED, Queue("key", /*priority=*/1));
+    blocked_ = false;
+  }
+
+  MockQuicConnectionHelper helper_;
+  MockAlarmFactory alarm_factory_;
+  MockQuicConnection* connection_;  // Owned by |session_|.
+  NiceMock<MockQuicSession> session_;
+  bool blocked_ = false;
+  std::vector<std::string> sent_;
+};
+
+TEST_F(QuicSessionDatagramTest, QueuedDatagramsDrainOnCanWrite) {
+  SetQuicFlag(quic_send_queued_datagrams_on_can_write, true);
+  QueueDatagrams();
+  EXPECT_TRUE(session_.WillingAndAbleToWrite());
+
+  session_.OnCanWrite();
+  EXPECT_THAT(sent_, ElementsAre("key", "early", "late", "none"));
+  EXPECT_EQ(4u, session_.datagram_queue_stats().datagrams_sent_from_queue);
+  EXPECT_FALSE(session_.WillingAndAbleToWrite());
+}
+
+TEST_F(QuicSessionDatagramTest, QueuedDatagramsWaitWithFlagOff) {
+  SetQuicFlag(quic_send_queued_datagrams_on_can_write, false);
+  QueueDatagrams();
+  EXPECT_FALSE(session_.WillingAndAbleToWrite());
+
+  session_.OnCanWrite();
+  EXPECT_TRUE(sent_.empty());
+  EXPECT_EQ(0u, session_.datagram_queue_stats().datagrams_sent_from_queue);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
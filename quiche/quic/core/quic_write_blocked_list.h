@@ -7,6 +7,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <utility>
 
 #include "absl/container/inlined_vector.h"
@@ -76,6 +77,10 @@ class QUICHE_EXPORT QuicWriteBlockedListInterface {
 
   // Returns true if stream with |stream_id| is write blocked.
   virtual bool IsStreamBlocked(QuicStreamId stream_id) const = 0;
+
+  // Returns how many bytes of new data |stream_id| may write before yielding
+  // to other streams.
+  virtual QuicByteCount GetWriteQuota(QuicStreamId stream_id) const = 0;
 };
 
 // Default implementation of QuicWriteBlockedListInterface.
@@ -141,6 +146,11 @@ class QUIC_EXPORT_PRIVATE QuicWriteBlockedList final
   // Returns true if stream with |stream_id| is write blocked.
   bool IsStreamBlocked(QuicStreamId stream_id) const override;
 
+  // Streams are never cut short.
+  QuicByteCount GetWriteQuota(QuicStreamId /*stream_id*/) const override {
+    return std::numeric_limits<QuicByteCount>::max();
+  }
+
  private:
   struct QUICHE_EXPORT HttpStreamPriorityToInt {
     int operator()(const HttpStreamPriority& priority) {
@@ -805,6 +805,15 @@ ssl_ticket_aead_result_t TlsServerHandshaker::SessionTicketOpen(
 
   ssl_ticket_aead_result_t result =
       FinalizeSessionTicketOpen(out, out_len, max_out_len);
+  if (result == ssl_ticket_aead_success && early_data_attempted_) {
+    ProofSource::EarlyDataReplayCache* replay_cache =
+        proof_source_->GetEarlyDataReplayCache();
+    if (replay_cache != nullptr && !replay_cache->CheckAndInsert(in)) {
+      // The session is still resumed, but BoringSSL will reject early data.
+      QUIC_CODE_COUNT(quic_tls_server_handshaker_early_data_replay_rejected);
+      SSL_set_early_data_enabled(ssl(), 0);
+    }
+  }
 
   QuicConnectionStats::TlsServerOperationStats decrypt_ticket_stats;
   decrypt_ticket_stats.success = (result == ssl_ticket_aead_success);
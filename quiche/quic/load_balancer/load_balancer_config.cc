@@ -4,10 +4,13 @@
 
 #include "quiche/quic/load_balancer/load_balancer_config.h"
 
+#include <cstring>
 #include <memory>
 #include <string_view>
+#include <utility>
 
 #include "openssl/aes.h"
+#include "openssl/cipher.h"
 #include "quiche/quic/platform/api/quic_bug_tracker.h"
 
 namespace quic {
@@ -110,8 +113,90 @@ void CiphertextXorWithRight(const uint8_t *from, const uint8_t plaintext_len,
   }
 }
 
+// Runs |ctx| in place over |num_blocks| contiguous blocks.
+bool EcbCipherUpdate(EVP_CIPHER_CTX *ctx, uint8_t *blocks, size_t num_blocks) {
+  const int len = static_cast<int>(num_blocks * kLoadBalancerBlockSize);
+  int out_len = 0;
+  return EVP_CipherUpdate(ctx, blocks, &out_len, blocks, len) &&
+         out_len == len;
+}
+
 }  // namespace
 
+LoadBalancerConfig::EcbCipher::EcbCipher(const EcbCipher &other) {
+  *this = other;
+}
+
+LoadBalancerConfig::EcbCipher &LoadBalancerConfig::EcbCipher::operator=(
+    const EcbCipher &other) {
+  if (this == &other) {
+    return *this;
+  }
+  ctx_.reset();
+  if (other.ctx_ == nullptr) {
+    return *this;
+  }
+  bssl::UniquePtr<EVP_CIPHER_CTX> ctx(EVP_CIPHER_CTX_new());
+  if (ctx != nullptr && EVP_CIPHER_CTX_copy(ctx.get(), other.ctx_.get())) {
+    ctx_ = std::move(ctx);
+  }
+  return *this;
+}
+
+// static
+LoadBalancerConfig::EcbCipher LoadBalancerConfig::EcbCipher::Create(
+    absl::string_view key, bool encrypt) {
+  EcbCipher cipher;
+  if (key.size() != kLoadBalancerKeyLen) {
+    return cipher;
+  }
+  bssl::UniquePtr<EVP_CIPHER_CTX> ctx(EVP_CIPHER_CTX_new());
+  if (ctx == nullptr ||
+      !EVP_CipherInit_ex(ctx.get(), EVP_aes_128_ecb(), nullptr,
+                         reinterpret_cast<const uint8_t *>(key.data()),
+                         nullptr, encrypt ? 1 : 0)) {
+    return cipher;
+  }
+  EVP_CIPHER_CTX_set_padding(ctx.get(), 0);
+  cipher.ctx_ = std::move(ctx);
+  return cipher;
+}
+
+bool LoadBalancerConfig::EcbCipher::CopyContext(EVP_CIPHER_CTX *copy) const {
+  return ctx_ != nullptr && EVP_CIPHER_CTX_copy(copy, ctx_.get());
+}
+
+bool LoadBalancerConfig::EcbCipher::CipherInPlace(uint8_t *blocks,
+                                                  size_t num_blocks) const {
+  bssl::ScopedEVP_CIPHER_CTX ctx;
+  return CopyContext(ctx.get()) &&
+         EcbCipherUpdate(ctx.get(), blocks, num_blocks);
+}
+
+bool LoadBalancerConfig::EcbCipher::CipherInPlace(
+    absl::Span<uint8_t *const> targets) const {
+  bssl::ScopedEVP_CIPHER_CTX ctx;
+  if (!CopyContext(ctx.get())) {
+    return false;
+  }
+  uint8_t buf[kLoadBalancerBatchSize][kLoadBalancerBlockSize];
+  for (size_t start = 0; start < targets.size();
+       start += kLoadBalancerBatchSize) {
+    absl::Span<uint8_t *const> batch =
+        targets.subspan(start, kLoadBalancerBatchSize);
+    for (size_t i = 0; i < batch.size(); ++i) {
+      memcpy(buf[i], batch[i], kLoadBalancerBlockSize);
+    }
+    if (!EcbCipherUpdate(ctx.get(), buf[0], batch.size())) {
+      return false;
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+      memcpy(batch[i], buf[i], kLoadBalancerBlockSize);
+    }
+  }
+  return true;
+}
+
 absl::optional<LoadBalancerConfig> LoadBalancerConfig::Create(
     const uint8_t config_id, const uint8_t server_id_len,
     const uint8_t nonce_len, const absl::string_view key) {
@@ -187,6 +272,47 @@ bool LoadBalancerConfig::BlockDecrypt(
   return true;
 }
 
+bool LoadBalancerConfig::EncryptionPassBatch(absl::Span<uint8_t *const> targets,
+                                             const uint8_t index) const {
+  if (!key_.has_value()) {
+    return false;
+  }
+  uint8_t buf[kLoadBalancerBatchSize][kLoadBalancerBlockSize];
+  for (size_t start = 0; start < targets.size();
+       start += kLoadBalancerBatchSize) {
+    absl::Span<uint8_t *const> batch =
+        targets.subspan(start, kLoadBalancerBatchSize);
+    for (size_t i = 0; i < batch.size(); ++i) {
+      if (index % 2) {  // Odd indices go from left to right
+        TakePlaintextFromLeft(batch[i], plaintext_len(), index, buf[i]);
+      } else {
+        TakePlaintextFromRight(batch[i], plaintext_len(), index, buf[i]);
+      }
+    }
+    if (!ecb_encrypt_.CipherInPlace(buf[0], batch.size())) {
+      return false;
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+      if (index % 2) {
+        CiphertextXorWithRight(buf[i], plaintext_len(), batch[i]);
+      } else {
+        CiphertextXorWithLeft(buf[i], plaintext_len(), batch[i]);
+      }
+    }
+  }
+  return true;
+}
+
+bool LoadBalancerConfig::BlockEncryptBatch(
+    absl::Span<uint8_t *const> targets) const {
+  return key_.has_value() && ecb_encrypt_.CipherInPlace(targets);
+}
+
+bool LoadBalancerConfig::BlockDecryptBatch(
+    absl::Span<uint8_t *const> targets) const {
+  return block_decrypt_key_.has_value() && ecb_decrypt_.CipherInPlace(targets);
+}
+
 LoadBalancerConfig::LoadBalancerConfig(const uint8_t config_id,
                                        const uint8_t server_id_len,
                                        const uint8_t nonce_len,
@@ -197,6 +323,12 @@ LoadBalancerConfig::LoadBalancerConfig(const uint8_t config_id,
       key_(BuildKey(key, /* encrypt = */ true)),
       block_decrypt_key_((server_id_len + nonce_len == kLoadBalancerBlockSize)
                              ? BuildKey(key, /* encrypt = */ false)
-                             : absl::optional<AES_KEY>()) {}
+                             : absl::optional<AES_KEY>()),
+      ecb_encrypt_(key_.has_value()
+                       ? EcbCipher::Create(key, /* encrypt = */ true)
+                       : EcbCipher()),
+      ecb_decrypt_(block_decrypt_key_.has_value()
+                       ? EcbCipher::Create(key, /* encrypt = */ false)
+                       : EcbCipher()) {}
 
 }  // namespace quic
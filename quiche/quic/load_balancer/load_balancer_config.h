@@ -5,7 +5,11 @@
 #ifndef QUICHE_QUIC_LOAD_BALANCER_LOAD_BALANCER_CONFIG_H_
 #define QUICHE_QUIC_LOAD_BALANCER_LOAD_BALANCER_CONFIG_H_
 
+#include <cstddef>
+#include <cstdint>
+
 #include "openssl/aes.h"
+#include "openssl/cipher.h"
 #include "quiche/quic/core/quic_types.h"
 #include "quiche/quic/platform/api/quic_export.h"
 
@@ -19,6 +23,8 @@ inline constexpr uint8_t kLoadBalancerBlockSize = 16;
 inline constexpr uint8_t kLoadBalancerMaxNonceLen = 16;
 inline constexpr uint8_t kLoadBalancerMinNonceLen = 4;
 inline constexpr uint8_t kNumLoadBalancerCryptoPasses = 4;
+// The batch functions hand up to this many blocks to the cipher at once.
+inline constexpr size_t kLoadBalancerBatchSize = 32;
 
 // This the base class for QUIC-LB configuration. It contains configuration
 // elements usable by both encoders (servers) and decoders (load balancers).
@@ -61,6 +67,21 @@ class QUIC_EXPORT_PRIVATE LoadBalancerConfig {
       const uint8_t ciphertext[kLoadBalancerBlockSize],
       uint8_t plaintext[kLoadBalancerBlockSize]) const;
 
+  // Batch versions of the functions above, which work in place on each of
+  // |targets|. Rather than one AES_encrypt call per block, the blocks of a
+  // batch go to the cipher in a single multi-block ECB call, which lets AES-NI
+  // keep several of them in flight. The cipher contexts are set up once, with
+  // the config. Each of |targets| must point to
+  // plaintext_len() bytes for EncryptionPassBatch(), and to
+  // kLoadBalancerBlockSize bytes for the others. Return false under the same
+  // conditions as their single versions.
+  ABSL_MUST_USE_RESULT bool EncryptionPassBatch(
+      absl::Span<uint8_t* const> targets, const uint8_t index) const;
+  ABSL_MUST_USE_RESULT bool BlockEncryptBatch(
+      absl::Span<uint8_t* const> targets) const;
+  ABSL_MUST_USE_RESULT bool BlockDecryptBatch(
+      absl::Span<uint8_t* const> targets) const;
+
   uint8_t config_id() const { return config_id_; }
   uint8_t server_id_len() const { return server_id_len_; }
   uint8_t nonce_len() const { return nonce_len_; }
@@ -71,6 +92,37 @@ class QUIC_EXPORT_PRIVATE LoadBalancerConfig {
   bool IsEncrypted() const { return key_.has_value(); }
 
  private:
+  // An AES-128-ECB cipher context for the batch functions, set up with the
+  // key schedule once. EVP_CipherUpdate() writes to the context it runs on,
+  // so every call runs on its own copy of it, and concurrent callers such as
+  // the workers of QuicLoadBalancerRouter only read the shared one.
+  class QUIC_EXPORT_PRIVATE EcbCipher {
+   public:
+    EcbCipher() = default;
+    EcbCipher(const EcbCipher& other);
+    EcbCipher& operator=(const EcbCipher& other);
+    EcbCipher(EcbCipher&& other) = default;
+    EcbCipher& operator=(EcbCipher&& other) = default;
+
+    // Returns an empty cipher if |key| is empty or invalid.
+    static EcbCipher Create(absl::string_view key, bool encrypt);
+
+    bool IsInitialized() const { return ctx_ != nullptr; }
+
+    // Runs the cipher in place over |num_blocks| contiguous blocks.
+    bool CipherInPlace(uint8_t* blocks, size_t num_blocks) const;
+
+    // Runs the cipher in place over each of the blocks at |targets|.
+    bool CipherInPlace(absl::Span<uint8_t* const> targets) const;
+
+   private:
+    // Copies the key schedule of |ctx_| into |copy|, which must be freshly
+    // initialized. Returns false if the cipher is not initialized.
+    bool CopyContext(EVP_CIPHER_CTX* copy) const;
+
+    bssl::UniquePtr<EVP_CIPHER_CTX> ctx_;
+  };
+
   // Constructor is private because it doesn't validate input.
   LoadBalancerConfig(uint8_t config_id, uint8_t server_id_len,
                      uint8_t nonce_len, absl::string_view key);
@@ -87,6 +139,10 @@ class QUIC_EXPORT_PRIVATE LoadBalancerConfig {
   // AES_decrypt requires an AES_KEY that is initialized differently. In all
   // other cases, block_decrypt_key_ is empty.
   absl::optional<AES_KEY> block_decrypt_key_;
+  // The same keys for the batch functions, initialized if and only if |key_|
+  // and |block_decrypt_key_| are.
+  EcbCipher ecb_encrypt_;
+  EcbCipher ecb_decrypt_;
 };
 
 }  // namespace quic
@@ -5,6 +5,8 @@
 #include "quiche/quic/load_balancer/load_balancer_config.h"
 
 #include <cstdint>
+#include <cstring>
+#include <utility>
 
 #include "absl/types/span.h"
 #include "quiche/quic/platform/api/quic_expect_bug.h"
@@ -167,6 +169,56 @@ TEST_F(LoadBalancerConfigTest, BlockEncryptionExample) {
   EXPECT_EQ(memcmp(result, ptext, sizeof(ptext)), 0);
 }
 
+// The batch functions produce the same results as their single versions, also
+// for more targets than fit in one batch.
+TEST_F(LoadBalancerConfigTest, BatchMatchesSingle) {
+  constexpr size_t kNumTargets = kLoadBalancerBatchSize + 7;
+  for (const auto& [server_id_len, nonce_len] :
+       {std::pair<uint8_t, uint8_t>{3, 4}, {5, 6}, {7, 8}, {8, 8}}) {
+    auto config = LoadBalancerConfig::Create(0, server_id_len, nonce_len,
+                                             absl::string_view(raw_key, 16));
+    ASSERT_TRUE(config.has_value());
+    uint8_t single[kNumTargets][kLoadBalancerBlockSize];
+    uint8_t batch[kNumTargets][kLoadBalancerBlockSize];
+    uint8_t* targets[kNumTargets];
+    for (size_t i = 0; i < kNumTargets; ++i) {
+      for (size_t j = 0; j < kLoadBalancerBlockSize; ++j) {
+        single[i][j] = static_cast<uint8_t>(i * 31 + j);
+      }
+      memcpy(batch[i], single[i], kLoadBalancerBlockSize);
+      targets[i] = batch[i];
+    }
+    if (config->plaintext_len() == kLoadBalancerBlockSize) {
+      for (size_t i = 0; i < kNumTargets; ++i) {
+        EXPECT_TRUE(config->BlockEncrypt(single[i], single[i]));
+      }
+      EXPECT_TRUE(config->BlockEncryptBatch(targets));
+      EXPECT_EQ(memcmp(single, batch, sizeof(single)), 0);
+      for (size_t i = 0; i < kNumTargets; ++i) {
+        EXPECT_TRUE(config->BlockDecrypt(single[i], single[i]));
+      }
+      EXPECT_TRUE(config->BlockDecryptBatch(targets));
+      EXPECT_EQ(memcmp(single, batch, sizeof(single)), 0);
+      continue;
+    }
+    EXPECT_FALSE(config->BlockDecryptBatch(targets));
+    for (uint8_t index = 1; index <= kNumLoadBalancerCryptoPasses; ++index) {
+      for (size_t i = 0; i < kNumTargets; ++i) {
+        EXPECT_TRUE(config->EncryptionPass(
+            absl::Span<uint8_t>(single[i], config->plaintext_len()), index));
+      }
+      EXPECT_TRUE(config->EncryptionPassBatch(targets, index));
+      EXPECT_EQ(memcmp(single, batch, sizeof(single)), 0);
+    }
+  }
+  auto pt_config = LoadBalancerConfig::CreateUnencrypted(0, 8, 8);
+  uint8_t block[kLoadBalancerBlockSize] = {};
+  uint8_t* targets[] = {block};
+  EXPECT_FALSE(pt_config->EncryptionPassBatch(targets, 1));
+  EXPECT_FALSE(pt_config->BlockEncryptBatch(targets));
+  EXPECT_FALSE(pt_config->BlockDecryptBatch(targets));
+}
+
 TEST_F(LoadBalancerConfigTest, ConfigIsCopyable) {
   const uint8_t ptext[] = {0xed, 0x79, 0x3a, 0x51, 0xd4, 0x9b, 0x8f, 0x5f,
                            0xee, 0x08, 0x0d, 0xbf, 0x48, 0xc0, 0xd1, 0xe5};
@@ -181,6 +233,14 @@ TEST_F(LoadBalancerConfigTest, ConfigIsCopyable) {
   EXPECT_EQ(memcmp(result, ctext, sizeof(ctext)), 0);
   EXPECT_TRUE(config2->BlockEncrypt(ptext, result));
   EXPECT_EQ(memcmp(result, ctext, sizeof(ctext)), 0);
+  // The copy has its own cipher contexts for the batch functions.
+  config.reset();
+  memcpy(result, ptext, sizeof(ptext));
+  uint8_t* targets[] = {result};
+  EXPECT_TRUE(config2->BlockEncryptBatch(targets));
+  EXPECT_EQ(memcmp(result, ctext, sizeof(ctext)), 0);
+  EXPECT_TRUE(config2->BlockDecryptBatch(targets));
+  EXPECT_EQ(memcmp(result, ptext, sizeof(ptext)), 0);
 }
 
 }  // namespace
@@ -4,10 +4,55 @@
 
 #include "quiche/quic/load_balancer/load_balancer_decoder.h"
 
+#include <cstring>
+
 #include "quiche/quic/platform/api/quic_bug_tracker.h"
 
 namespace quic {
 
+namespace {
+
+// Encrypted connection IDs of one config waiting to be decrypted together.
+struct PendingConnectionIds {
+  size_t size = 0;
+  // Where the server IDs go.
+  size_t indices[kLoadBalancerBatchSize];
+  // The connection IDs without their first byte, decrypted in place.
+  uint8_t data[kLoadBalancerBatchSize]
+              [kQuicMaxConnectionIdWithLengthPrefixLength];
+};
+
+// Decrypts the connection IDs in |pending|, which use |config|, and writes
+// their server IDs to |server_ids|. This mirrors GetServerId(), with every
+// decryption pass running over the whole batch.
+void DecryptBatch(const LoadBalancerConfig& config,
+                  PendingConnectionIds& pending,
+                  absl::Span<absl::optional<LoadBalancerServerId>> server_ids) {
+  uint8_t* targets[kLoadBalancerBatchSize];
+  for (size_t i = 0; i < pending.size; ++i) {
+    targets[i] = pending.data[i];
+  }
+  absl::Span<uint8_t* const> batch(targets, pending.size);
+  bool success = true;
+  if (config.plaintext_len() == kLoadBalancerKeyLen) {  // single pass
+    success = config.BlockDecryptBatch(batch);
+  } else {
+    uint8_t end = (config.server_id_len() > config.nonce_len()) ? 1 : 2;
+    for (uint8_t i = kNumLoadBalancerCryptoPasses; success && i >= end; i--) {
+      success = config.EncryptionPassBatch(batch, i);
+    }
+  }
+  for (size_t i = 0; i < pending.size; ++i) {
+    server_ids[pending.indices[i]] =
+        success ? LoadBalancerServerId::Create(absl::Span<const uint8_t>(
+                      pending.data[i], config.server_id_len()))
+                : absl::optional<LoadBalancerServerId>();
+  }
+  pending.size = 0;
+}
+
+}  // namespace
+
 bool LoadBalancerDecoder::AddConfig(const LoadBalancerConfig& config) {
   if (config_[config.config_id()].has_value()) {
     return false;
@@ -30,11 +75,20 @@ void LoadBalancerDecoder::DeleteConfig(uint8_t config_id) {
 // connection ID of sufficient length.
 absl::optional<LoadBalancerServerId> LoadBalancerDecoder::GetServerId(
     const QuicConnectionId& connection_id) const {
-  absl::optional<uint8_t> config_id = GetConfigId(connection_id);
-  if (!config_id.has_value()) {
+  return GetServerId(
+      absl::string_view(connection_id.data(), connection_id.length()));
+}
+
+absl::optional<LoadBalancerServerId> LoadBalancerDecoder::GetServerId(
+    absl::string_view connection_id) const {
+  if (connection_id.empty()) {
     return absl::optional<LoadBalancerServerId>();
   }
-  absl::optional<LoadBalancerConfig> config = config_[*config_id];
+  const uint8_t config_id = static_cast<uint8_t>(connection_id[0]) >> 6;
+  if (config_id >= kNumLoadBalancerConfigs) {
+    return absl::optional<LoadBalancerServerId>();
+  }
+  const absl::optional<LoadBalancerConfig>& config = config_[config_id];
   if (!config.has_value()) {
     return absl::optional<LoadBalancerServerId>();
   }
@@ -70,6 +124,52 @@ absl::optional<LoadBalancerServerId> LoadBalancerDecoder::GetServerId(
       absl::Span<const uint8_t>(result, config->server_id_len()));
 }
 
+void LoadBalancerDecoder::GetServerIds(
+    absl::Span<const absl::string_view> connection_ids,
+    absl::Span<absl::optional<LoadBalancerServerId>> server_ids) const {
+  if (connection_ids.size() != server_ids.size()) {
+    QUIC_BUG(quic_bug_438896865_02)
+        << "GetServerIds called with " << connection_ids.size()
+        << " connection IDs but room for " << server_ids.size()
+        << " server IDs";
+    return;
+  }
+  PendingConnectionIds pending[kNumLoadBalancerConfigs];
+  for (size_t i = 0; i < connection_ids.size(); ++i) {
+    absl::string_view connection_id = connection_ids[i];
+    server_ids[i].reset();
+    if (connection_id.empty()) {
+      continue;
+    }
+    const uint8_t config_id = static_cast<uint8_t>(connection_id[0]) >> 6;
+    if (config_id >= kNumLoadBalancerConfigs ||
+        !config_[config_id].has_value() ||
+        connection_id.length() < config_[config_id]->total_len()) {
+      continue;
+    }
+    const LoadBalancerConfig& config = *config_[config_id];
+    const uint8_t* data =
+        reinterpret_cast<const uint8_t*>(connection_id.data()) + 1;
+    if (!config.IsEncrypted()) {
+      server_ids[i] = LoadBalancerServerId::Create(
+          absl::Span<const uint8_t>(data, config.server_id_len()));
+      continue;
+    }
+    PendingConnectionIds& batch = pending[config_id];
+    batch.indices[batch.size] = i;
+    memcpy(batch.data[batch.size], data, config.plaintext_len());
+    if (++batch.size == kLoadBalancerBatchSize) {
+      DecryptBatch(config, batch, server_ids);
+    }
+  }
+  for (uint8_t config_id = 0; config_id < kNumLoadBalancerConfigs;
+       ++config_id) {
+    if (pending[config_id].size > 0) {
+      DecryptBatch(*config_[config_id], pending[config_id], server_ids);
+    }
+  }
+}
+
 absl::optional<uint8_t> LoadBalancerDecoder::GetConfigId(
     const QuicConnectionId& connection_id) {
   if (connection_id.IsEmpty()) {
@@ -5,6 +5,8 @@
 #ifndef QUICHE_QUIC_LOAD_BALANCER_LOAD_BALANCER_DECODER_H_
 #define QUICHE_QUIC_LOAD_BALANCER_LOAD_BALANCER_DECODER_H_
 
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "quiche/quic/load_balancer/load_balancer_config.h"
 #include "quiche/quic/load_balancer/load_balancer_server_id.h"
 
@@ -28,6 +30,21 @@ class QUIC_EXPORT_PRIVATE LoadBalancerDecoder {
   // without error.
   absl::optional<LoadBalancerServerId> GetServerId(
       const QuicConnectionId& connection_id) const;
+  // As above, for the raw bytes of a connection ID, which may be longer than
+  // QuicConnectionId can hold.
+  absl::optional<LoadBalancerServerId> GetServerId(
+      absl::string_view connection_id) const;
+
+  // Sets each element of |server_ids| to the server ID of the corresponding
+  // element of |connection_ids|, as GetServerId() would. Encrypted connection
+  // IDs are decrypted in batches per config, so this is much faster than
+  // calling GetServerId() for each when a load balancer has read many packets
+  // at once. The connection IDs are the raw bytes parsed from the packets, so
+  // those longer than QuicConnectionId can hold are decoded too. Creates a bug
+  // if the two spans have different sizes.
+  void GetServerIds(
+      absl::Span<const absl::string_view> connection_ids,
+      absl::Span<absl::optional<LoadBalancerServerId>> server_ids) const;
 
   // Returns the config ID stored in the first two bits of |connection_id|, or
   // empty if |connection_id| is empty.
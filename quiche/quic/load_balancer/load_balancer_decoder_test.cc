@@ -4,9 +4,15 @@
 
 #include "quiche/quic/load_balancer/load_balancer_decoder.h"
 
+#include <memory>
+#include <vector>
+
+#include "absl/base/macros.h"
+#include "absl/strings/string_view.h"
 #include "quiche/quic/load_balancer/load_balancer_server_id.h"
 #include "quiche/quic/platform/api/quic_expect_bug.h"
 #include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/platform/api/quic_thread.h"
 #include "quiche/quic/test_tools/quic_test_utils.h"
 
 namespace quic {
@@ -97,6 +103,128 @@ TEST_F(LoadBalancerDecoderTest, DecoderTestVectors) {
   }
 }
 
+// Decoding in batches gives the same results as decoding one connection ID at
+// a time, whatever the mix of configs, also for the connection IDs longer than
+// QuicConnectionId holds.
+TEST_F(LoadBalancerDecoderTest, GetServerIds) {
+  LoadBalancerDecoder decoder;
+  EXPECT_TRUE(decoder.AddConfig(*LoadBalancerConfig::Create(0, 3, 4, kKey)));
+  EXPECT_TRUE(decoder.AddConfig(*LoadBalancerConfig::Create(1, 10, 5, kKey)));
+  EXPECT_TRUE(decoder.AddConfig(*LoadBalancerConfig::Create(2, 8, 8, kKey)));
+  const absl::string_view connection_ids[] = {
+      "\x07\x41\x26\xee\x38\xbf\x54\x54",
+      "\x4f\xcd\x3f\x57\x2d\x4e\xef\xb0\x46\xfd\xb5\x1d\x16\x4e\xfc\xcc",
+      "\x90\x4d\xd2\xd0\x5a\x7b\x0d\xe9\xb2\xb9\x90\x7a\xfb\x5e\xcf\x8c"
+      "\xc3",
+      // Unroutable, too short and empty connection IDs.
+      "\xc0\x01\x02\x03\x04\x05\x06\x07",
+      "\x07\x41\x26\xee",
+      "",
+  };
+  const absl::optional<LoadBalancerServerId> expected[] = {
+      MakeServerId(kServerId, 3),  MakeServerId(kServerId, 10),
+      MakeServerId(kServerId, 8),  absl::nullopt,
+      absl::nullopt,               absl::nullopt,
+  };
+  std::vector<absl::string_view> batch;
+  for (size_t i = 0; i < 3 * kLoadBalancerBatchSize; ++i) {
+    batch.push_back(connection_ids[(i * 7) % ABSL_ARRAYSIZE(connection_ids)]);
+  }
+  std::vector<absl::optional<LoadBalancerServerId>> server_ids(batch.size());
+  decoder.GetServerIds(batch, absl::MakeSpan(server_ids));
+  for (size_t i = 0; i < batch.size(); ++i) {
+    EXPECT_EQ(server_ids[i],
+              expected[(i * 7) % ABSL_ARRAYSIZE(connection_ids)])
+        << i;
+  }
+  for (size_t i = 0; i < ABSL_ARRAYSIZE(connection_ids); ++i) {
+    EXPECT_EQ(expected[i], decoder.GetServerId(connection_ids[i])) << i;
+  }
+  EXPECT_EQ(expected[0],
+            decoder.GetServerId(QuicConnectionId(
+                connection_ids[0].data(), connection_ids[0].length())));
+
+  EXPECT_QUIC_BUG(
+      decoder.GetServerIds(batch, absl::MakeSpan(server_ids).subspan(1)),
+      "GetServerIds called with");
+}
+
+// Decodes the same batch over and over on a decoder shared with other
+// threads, as the workers of QuicLoadBalancerRouter do.
+class DecodingThread : public QuicThread {
+ public:
+  DecodingThread(const LoadBalancerDecoder* decoder,
+                 const std::vector<absl::string_view>* batch,
+                 const absl::optional<LoadBalancerServerId>* expected,
+                 int num_batches)
+      : QuicThread("DecodingThread"),
+        decoder_(decoder),
+        batch_(batch),
+        expected_(expected),
+        num_batches_(num_batches) {}
+
+  int mismatches() const { return mismatches_; }
+
+ protected:
+  void Run() override {
+    std::vector<absl::optional<LoadBalancerServerId>> server_ids(
+        batch_->size());
+    for (int i = 0; i < num_batches_; ++i) {
+      decoder_->GetServerIds(*batch_, absl::MakeSpan(server_ids));
+      for (size_t j = 0; j < server_ids.size(); ++j) {
+        if (!(server_ids[j] == expected_[j])) {
+          ++mismatches_;
+        }
+      }
+    }
+  }
+
+ private:
+  const LoadBalancerDecoder* decoder_;
+  const std::vector<absl::string_view>* batch_;
+  const absl::optional<LoadBalancerServerId>* expected_;
+  const int num_batches_;
+  int mismatches_ = 0;
+};
+
+TEST_F(LoadBalancerDecoderTest, GetServerIdsFromManyThreads) {
+  LoadBalancerDecoder decoder;
+  // Covers the four pass, the single pass, and the single pass decryption
+  // cases.
+  EXPECT_TRUE(decoder.AddConfig(*LoadBalancerConfig::Create(0, 3, 4, kKey)));
+  EXPECT_TRUE(decoder.AddConfig(*LoadBalancerConfig::Create(1, 10, 5, kKey)));
+  EXPECT_TRUE(decoder.AddConfig(*LoadBalancerConfig::Create(2, 8, 8, kKey)));
+  const absl::string_view connection_ids[] = {
+      "\x07\x41\x26\xee\x38\xbf\x54\x54",
+      "\x4f\xcd\x3f\x57\x2d\x4e\xef\xb0\x46\xfd\xb5\x1d\x16\x4e\xfc\xcc",
+      "\x90\x4d\xd2\xd0\x5a\x7b\x0d\xe9\xb2\xb9\x90\x7a\xfb\x5e\xcf\x8c"
+      "\xc3",
+  };
+  const absl::optional<LoadBalancerServerId> server_ids[] = {
+      MakeServerId(kServerId, 3),
+      MakeServerId(kServerId, 10),
+      MakeServerId(kServerId, 8),
+  };
+  std::vector<absl::string_view> batch;
+  std::vector<absl::optional<LoadBalancerServerId>> expected;
+  for (size_t i = 0; i < 4 * kLoadBalancerBatchSize; ++i) {
+    batch.push_back(connection_ids[i % ABSL_ARRAYSIZE(connection_ids)]);
+    expected.push_back(server_ids[i % ABSL_ARRAYSIZE(server_ids)]);
+  }
+
+  const int kNumThreads = 4;
+  std::vector<std::unique_ptr<DecodingThread>> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.push_back(std::make_unique<DecodingThread>(
+        &decoder, &batch, expected.data(), /*num_batches=*/1000));
+    threads.back()->Start();
+  }
+  for (auto& thread : threads) {
+    thread->Join();
+    EXPECT_EQ(0, thread->mismatches());
+  }
+}
+
 TEST_F(LoadBalancerDecoderTest, NoServerIdEntry) {
   auto server_id = LoadBalancerServerId::Create({0x01, 0x02, 0x03});
   EXPECT_TRUE(server_id.has_value());
@@ -4,6 +4,8 @@
 
 #include "quiche/quic/load_balancer/load_balancer_encoder.h"
 
+#include <algorithm>
+
 #include "absl/numeric/int128.h"
 #include "quiche/quic/core/quic_connection_id.h"
 #include "quiche/quic/core/quic_data_reader.h"
@@ -100,44 +102,28 @@ void LoadBalancerEncoder::DeleteConfig() {
 }
 
 QuicConnectionId LoadBalancerEncoder::GenerateConnectionId() {
-  uint8_t config_id = config_.has_value() ? config_->config_id()
-                                          : kLoadBalancerUnroutableConfigId;
-  uint8_t shifted_config_id = config_id << 6;
-  uint8_t length = connection_id_lengths_[config_id];
   if (config_.has_value() != server_id_.has_value()) {
     QUIC_BUG(quic_bug_435375038_04)
         << "Existence of config and server_id are out of sync";
     return QuicConnectionId();
   }
-  uint8_t first_byte;
-  // first byte
-  if (len_self_encoded_) {
-    first_byte = shifted_config_id | (length - 1);
-  } else {
-    random_.RandBytes(static_cast<void *>(&first_byte), 1);
-    first_byte = shifted_config_id | (first_byte & kLoadBalancerLengthMask);
-  }
+  uint8_t first_byte = MakeFirstByte();
   if (!config_.has_value()) {
     return MakeUnroutableConnectionId(first_byte);
   }
   QuicConnectionId id;
-  id.set_length(length);
-  QuicDataWriter writer(length, id.mutable_data(), quiche::HOST_BYTE_ORDER);
-  writer.WriteUInt8(first_byte);
-  absl::uint128 next_nonce =
-      (seed_ + num_nonces_left_--) % NumberOfNonces(config_->nonce_len());
-  writer.WriteBytes(server_id_->data().data(), server_id_->length());
-  if (!WriteUint128(next_nonce, config_->nonce_len(), writer)) {
+  if (!WritePlaintextConnectionId(first_byte, id)) {
     return QuicConnectionId();
   }
-  uint8_t *block_start = reinterpret_cast<uint8_t *>(writer.data() + 1);
+  const uint8_t length = id.length();
+  uint8_t *block_start = reinterpret_cast<uint8_t *>(id.mutable_data() + 1);
   if (!config_->IsEncrypted()) {
     // Fill the nonce field with a hash of the Connection ID to avoid the nonce
     // visibly increasing by one. This would allow observers to correlate
     // connection IDs as being sequential and likely from the same connection,
     // not just the same server.
     absl::uint128 nonce_hash =
-        QuicUtils::FNV1a_128_Hash(absl::string_view(writer.data(), length));
+        QuicUtils::FNV1a_128_Hash(absl::string_view(id.data(), length));
     QuicDataWriter rewriter(config_->nonce_len(),
                             id.mutable_data() + config_->server_id_len() + 1,
                             quiche::HOST_BYTE_ORDER);
@@ -165,6 +151,46 @@ QuicConnectionId LoadBalancerEncoder::GenerateConnectionId() {
   return id;
 }
 
+void LoadBalancerEncoder::GenerateConnectionIds(
+    absl::Span<QuicConnectionId> connection_ids) {
+  size_t next = 0;
+  while (next < connection_ids.size()) {
+    if (!IsEncrypted() || !server_id_.has_value()) {
+      connection_ids[next++] = GenerateConnectionId();
+      continue;
+    }
+    // A batch ends at the last nonce, after which the config is deleted.
+    const size_t batch_size = static_cast<size_t>(std::min<absl::uint128>(
+        std::min(connection_ids.size() - next, kLoadBalancerBatchSize),
+        num_nonces_left_));
+    absl::Span<QuicConnectionId> batch =
+        connection_ids.subspan(next, batch_size);
+    next += batch_size;
+    uint8_t *targets[kLoadBalancerBatchSize];
+    bool success = true;
+    for (size_t i = 0; i < batch.size(); ++i) {
+      success &= WritePlaintextConnectionId(MakeFirstByte(), batch[i]);
+      targets[i] = reinterpret_cast<uint8_t *>(batch[i].mutable_data() + 1);
+    }
+    absl::Span<uint8_t *const> blocks(targets, batch.size());
+    if (success && config_->plaintext_len() == kLoadBalancerBlockSize) {
+      // Use one encryption pass.
+      success = config_->BlockEncryptBatch(blocks);
+    } else if (success) {
+      for (uint8_t i = 1; success && i <= kNumLoadBalancerCryptoPasses; i++) {
+        success = config_->EncryptionPassBatch(blocks, i);
+      }
+    }
+    if (!success) {
+      QUIC_LOG(ERROR) << "Block encryption failed";
+      std::fill(batch.begin(), batch.end(), QuicConnectionId());
+    }
+    if (num_nonces_left_ == 0) {
+      DeleteConfig();
+    }
+  }
+}
+
 absl::optional<QuicConnectionId> LoadBalancerEncoder::GenerateNextConnectionId(
     [[maybe_unused]] const QuicConnectionId &original) {
   // Do not allow new connection IDs if linkable.
@@ -191,6 +217,30 @@ uint8_t LoadBalancerEncoder::ConnectionIdLength(uint8_t first_byte) const {
   return connection_id_lengths_[first_byte >> 6];
 }
 
+uint8_t LoadBalancerEncoder::MakeFirstByte() {
+  uint8_t config_id = config_.has_value() ? config_->config_id()
+                                          : kLoadBalancerUnroutableConfigId;
+  uint8_t shifted_config_id = config_id << 6;
+  if (len_self_encoded_) {
+    return shifted_config_id | (connection_id_lengths_[config_id] - 1);
+  }
+  uint8_t first_byte;
+  random_.RandBytes(static_cast<void *>(&first_byte), 1);
+  return shifted_config_id | (first_byte & kLoadBalancerLengthMask);
+}
+
+bool LoadBalancerEncoder::WritePlaintextConnectionId(uint8_t first_byte,
+                                                     QuicConnectionId &id) {
+  uint8_t length = connection_id_lengths_[config_->config_id()];
+  id.set_length(length);
+  QuicDataWriter writer(length, id.mutable_data(), quiche::HOST_BYTE_ORDER);
+  writer.WriteUInt8(first_byte);
+  absl::uint128 next_nonce =
+      (seed_ + num_nonces_left_--) % NumberOfNonces(config_->nonce_len());
+  writer.WriteBytes(server_id_->data().data(), server_id_->length());
+  return WriteUint128(next_nonce, config_->nonce_len(), writer);
+}
+
 QuicConnectionId LoadBalancerEncoder::MakeUnroutableConnectionId(
     uint8_t first_byte) {
   QuicConnectionId id;
@@ -5,6 +5,7 @@
 #ifndef QUICHE_QUIC_LOAD_BALANCER_LOAD_BALANCER_ENCODER_H_
 #define QUICHE_QUIC_LOAD_BALANCER_LOAD_BALANCER_ENCODER_H_
 
+#include "absl/types/span.h"
 #include "quiche/quic/core/connection_id_generator.h"
 #include "quiche/quic/core/crypto/quic_random.h"
 #include "quiche/quic/load_balancer/load_balancer_config.h"
@@ -117,6 +118,11 @@ class QUIC_EXPORT_PRIVATE LoadBalancerEncoder
   // length Connection ID.
   QuicConnectionId GenerateConnectionId();
 
+  // Fills |connection_ids| as successive calls to GenerateConnectionId()
+  // would, but encrypts them in batches, which is much faster when a server
+  // needs many connection IDs at once.
+  void GenerateConnectionIds(absl::Span<QuicConnectionId> connection_ids);
+
   // Functions from ConnectionIdGeneratorInterface
   absl::optional<QuicConnectionId> GenerateNextConnectionId(
       const QuicConnectionId& original) override;
@@ -139,6 +145,13 @@ class QUIC_EXPORT_PRIVATE LoadBalancerEncoder
  private:
   friend class test::LoadBalancerEncoderPeer;
 
+  // Returns the first byte of the next connection ID.
+  uint8_t MakeFirstByte();
+
+  // Writes |first_byte|, the server ID and the next nonce of the current
+  // config into |id|, which the caller then encrypts. Returns false on error.
+  bool WritePlaintextConnectionId(uint8_t first_byte, QuicConnectionId &id);
+
   QuicConnectionId MakeUnroutableConnectionId(uint8_t first_byte);
 
   QuicRandom& random_;
@@ -5,6 +5,8 @@
 #include "quiche/quic/load_balancer/load_balancer_encoder.h"
 
 #include <cstdint>
+#include <utility>
+#include <vector>
 
 #include "absl/numeric/int128.h"
 #include "quiche/quic/platform/api/quic_expect_bug.h"
@@ -275,6 +277,37 @@ TEST_F(LoadBalancerEncoderTest, RunOutOfNonces) {
   EXPECT_EQ(visitor.num_deletes(), 1u);
 }
 
+// Generating connection IDs in batches gives the same connection IDs as
+// generating them one at a time, including when the nonces run out midway.
+// The lengths are those which fit in a QuicConnectionId.
+TEST_F(LoadBalancerEncoderTest, GenerateConnectionIdsMatchesSingle) {
+  for (const auto &[server_id_len, nonce_len] :
+       {std::pair<uint8_t, uint8_t>{3, 4}, {2, 4}, {1, 5}}) {
+    auto config = LoadBalancerConfig::Create(0, server_id_len, nonce_len, kKey);
+    ASSERT_TRUE(config.has_value());
+    TestRandom single_random, batch_random;
+    auto single = LoadBalancerEncoder::Create(single_random, nullptr, false);
+    auto batch = LoadBalancerEncoder::Create(batch_random, nullptr, false);
+    ASSERT_TRUE(single.has_value());
+    ASSERT_TRUE(batch.has_value());
+    const LoadBalancerServerId server_id =
+        MakeServerId(kServerId, server_id_len);
+    EXPECT_TRUE(single->UpdateConfig(*config, server_id));
+    EXPECT_TRUE(batch->UpdateConfig(*config, server_id));
+    LoadBalancerEncoderPeer::SetNumNoncesLeft(*single,
+                                              2 * kLoadBalancerBatchSize + 3);
+    LoadBalancerEncoderPeer::SetNumNoncesLeft(*batch,
+                                              2 * kLoadBalancerBatchSize + 3);
+
+    std::vector<QuicConnectionId> connection_ids(3 * kLoadBalancerBatchSize);
+    batch->GenerateConnectionIds(absl::MakeSpan(connection_ids));
+    for (size_t i = 0; i < connection_ids.size(); ++i) {
+      EXPECT_EQ(connection_ids[i], single->GenerateConnectionId()) << i;
+    }
+    EXPECT_FALSE(batch->IsEncoding());
+  }
+}
+
 TEST_F(LoadBalancerEncoderTest, UnroutableConnectionId) {
   random_.AddNextValues(0x83, kNonceHigh);
   auto encoder = LoadBalancerEncoder::Create(random_, nullptr, false);
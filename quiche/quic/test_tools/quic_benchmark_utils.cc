@@ -0,0 +1,98 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/test_tools/quic_benchmark_utils.h"
+
+#include <time.h>
+
+#include <cmath>
+#include <iostream>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+double ReadClockSeconds(clockid_t clock) {
+  timespec ts;
+  clock_gettime(clock, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+}  // namespace
+
+void QuicBenchmarkTimer::Start() {
+  wall_start_ = ReadClockSeconds(CLOCK_MONOTONIC);
+  cpu_start_ = ReadClockSeconds(CLOCK_PROCESS_CPUTIME_ID);
+  thread_cpu_start_ = ReadClockSeconds(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void QuicBenchmarkTimer::Stop() {
+  wall_seconds_ = ReadClockSeconds(CLOCK_MONOTONIC) - wall_start_;
+  cpu_seconds_ = ReadClockSeconds(CLOCK_PROCESS_CPUTIME_ID) - cpu_start_;
+  thread_cpu_seconds_ =
+      ReadClockSeconds(CLOCK_THREAD_CPUTIME_ID) - thread_cpu_start_;
+}
+
+QuicBenchmarkResult& QuicBenchmarkResult::AddMetric(std::string metric,
+                                                    double value) {
+  metrics_.emplace_back(std::move(metric), value);
+  return *this;
+}
+
+QuicBenchmarkResult& QuicBenchmarkResult::AddTimer(
+    const QuicBenchmarkTimer& timer) {
+  AddMetric("wall_seconds", timer.wall_seconds());
+  AddMetric("cpu_seconds", timer.cpu_seconds());
+  if (timer.wall_seconds() > 0) {
+    AddMetric("cpu_utilization", timer.cpu_seconds() / timer.wall_seconds());
+  }
+  return *this;
+}
+
+std::string QuicBenchmarkResult::ToJson() const {
+  std::string json = absl::StrCat("{\"benchmark\":\"", name_, "\"");
+  for (const auto& metric : metrics_) {
+    // JSON has no representation of NaN and infinities.
+    if (std::isfinite(metric.second)) {
+      absl::StrAppend(&json, ",\"", metric.first, "\":", metric.second);
+    } else {
+      absl::StrAppend(&json, ",\"", metric.first, "\":null");
+    }
+  }
+  absl::StrAppend(&json, "}");
+  return json;
+}
+
+void PrintBenchmarkResult(const QuicBenchmarkResult& result) {
+  std::cout << result.ToJson() << std::endl;
+}
+
+int RunBenchmarks(const std::vector<QuicBenchmark>& benchmarks,
+                  absl::string_view filter) {
+  absl::flat_hash_set<absl::string_view> selected;
+  for (absl::string_view name :
+       absl::StrSplit(filter, ',', absl::SkipWhitespace())) {
+    selected.insert(name);
+  }
+  int failures = 0;
+  for (const QuicBenchmark& benchmark : benchmarks) {
+    if (!selected.empty() && !selected.contains(benchmark.name)) {
+      continue;
+    }
+    QUIC_LOG(INFO) << "Running benchmark " << benchmark.name;
+    if (!benchmark.run()) {
+      QUIC_LOG(ERROR) << "Benchmark " << benchmark.name << " failed";
+      ++failures;
+    }
+  }
+  return failures;
+}
+
+}  // namespace test
+}  // namespace quic
@@ -0,0 +1,89 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Common utilities for the QUIC benchmark binaries (*_benchmark_bin.cc).
+// Every benchmark reports its results as one JSON object per line on stdout,
+// so runs can be collected and compared by scripts, e.g. to gate library
+// upgrades on the absence of regressions.
+
+#ifndef QUICHE_QUIC_TEST_TOOLS_QUIC_BENCHMARK_UTILS_H_
+#define QUICHE_QUIC_TEST_TOOLS_QUIC_BENCHMARK_UTILS_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace quic {
+namespace test {
+
+// Measures wall time and CPU time consumed by the whole process (i.e. all
+// threads, including a server thread running in the same process) between
+// Start() and Stop(). The CPU time of the calling thread alone is measured too,
+// which excludes work moved to background threads.
+class QuicBenchmarkTimer {
+ public:
+  void Start();
+  void Stop();
+
+  double wall_seconds() const { return wall_seconds_; }
+  double cpu_seconds() const { return cpu_seconds_; }
+  double thread_cpu_seconds() const { return thread_cpu_seconds_; }
+
+ private:
+  double wall_start_ = 0;
+  double cpu_start_ = 0;
+  double thread_cpu_start_ = 0;
+  double wall_seconds_ = 0;
+  double cpu_seconds_ = 0;
+  double thread_cpu_seconds_ = 0;
+};
+
+// The result of a single benchmark run.
+class QuicBenchmarkResult {
+ public:
+  explicit QuicBenchmarkResult(std::string name) : name_(std::move(name)) {}
+
+  // Adds a named metric. Metrics are serialized in insertion order.
+  QuicBenchmarkResult& AddMetric(std::string metric, double value);
+
+  // Adds wall_seconds, cpu_seconds and cpu_utilization from |timer|.
+  QuicBenchmarkResult& AddTimer(const QuicBenchmarkTimer& timer);
+
+  const std::string& name() const { return name_; }
+  const std::vector<std::pair<std::string, double>>& metrics() const {
+    return metrics_;
+  }
+
+  // Serializes the result as a single-line JSON object, e.g.
+  // {"benchmark":"simulator_bulk_transfer","wall_seconds":1.5,...}
+  std::string ToJson() const;
+
+ private:
+  std::string name_;
+  std::vector<std::pair<std::string, double>> metrics_;
+};
+
+// Writes |result| as a line of JSON to stdout.
+void PrintBenchmarkResult(const QuicBenchmarkResult& result);
+
+// A named benchmark. Returns false if the benchmark could not run.
+struct QuicBenchmark {
+  std::string name;
+  std::function<bool()> run;
+};
+
+// Runs every benchmark in |benchmarks| whose name is listed in the
+// comma-separated |filter|, or all of them if |filter| is empty. Returns the
+// number of benchmarks that failed.
+int RunBenchmarks(const std::vector<QuicBenchmark>& benchmarks,
+                  absl::string_view filter);
+
+}  // namespace test
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TEST_TOOLS_QUIC_BENCHMARK_UTILS_H_
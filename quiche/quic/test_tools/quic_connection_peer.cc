@@ -569,5 +569,11 @@ QuicSocketAddress QuicConnectionPeer::GetServerPreferredAddress(
   return connection->server_preferred_address_;
 }
 
+// static
+void QuicConnectionPeer::EnableKeyUpdate(QuicConnection* connection) {
+  connection->support_key_update_for_connection_ = true;
+  connection->framer_.SetKeyUpdateSupportForConnection(true);
+}
+
 }  // namespace test
 }  // namespace quic
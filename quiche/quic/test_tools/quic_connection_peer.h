@@ -231,6 +231,9 @@ class QuicConnectionPeer {
 
   static QuicSocketAddress GetServerPreferredAddress(
       QuicConnection* connection);
+
+  // Allows key updates, as SetFromConfig() does for versions which use TLS.
+  static void EnableKeyUpdate(QuicConnection* connection);
 };
 
 }  // namespace test
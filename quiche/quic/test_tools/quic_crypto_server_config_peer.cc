@@ -4,6 +4,9 @@
 
 #include "quiche/quic/test_tools/quic_crypto_server_config_peer.h"
 
+#include <memory>
+#include <utility>
+
 #include "absl/strings/string_view.h"
 #include "quiche/quic/test_tools/mock_clock.h"
 #include "quiche/quic/test_tools/mock_random.h"
@@ -14,19 +17,19 @@ namespace test {
 
 quiche::QuicheReferenceCountedPointer<QuicCryptoServerConfig::Config>
 QuicCryptoServerConfigPeer::GetPrimaryConfig() {
-  QuicReaderMutexLock locked(&server_config_->configs_lock_);
   return quiche::QuicheReferenceCountedPointer<QuicCryptoServerConfig::Config>(
-      server_config_->primary_config_);
+      server_config_->LoadSnapshot().primary);
 }
 
 quiche::QuicheReferenceCountedPointer<QuicCryptoServerConfig::Config>
 QuicCryptoServerConfigPeer::GetConfig(std::string config_id) {
-  QuicReaderMutexLock locked(&server_config_->configs_lock_);
+  const QuicCryptoServerConfig::ConfigSnapshot& snapshot =
+      server_config_->LoadSnapshot();
   if (config_id == "<primary>") {
     return quiche::QuicheReferenceCountedPointer<
-        QuicCryptoServerConfig::Config>(server_config_->primary_config_);
+        QuicCryptoServerConfig::Config>(snapshot.primary);
   } else {
-    return server_config_->GetConfigWithScid(config_id);
+    return QuicCryptoServerConfig::GetConfigWithScid(snapshot, config_id);
   }
 }
 
@@ -80,16 +83,19 @@ void QuicCryptoServerConfigPeer::CheckConfigs(
     std::vector<std::pair<std::string, bool>> expected_ids_and_status) {
   QuicReaderMutexLock locked(&server_config_->configs_lock_);
 
-  ASSERT_EQ(expected_ids_and_status.size(), server_config_->configs_.size())
-      << ConfigsDebug();
+  const QuicCryptoServerConfig::ConfigSnapshot* snapshot =
+      server_config_->snapshot_.get();
+  const QuicCryptoServerConfig::ConfigMap& configs = snapshot->configs;
+  ASSERT_EQ(expected_ids_and_status.size(), configs.size()) << ConfigsDebug();
 
   for (const std::pair<const ServerConfigID,
                        quiche::QuicheReferenceCountedPointer<
                            QuicCryptoServerConfig::Config>>& i :
-       server_config_->configs_) {
+       configs) {
     bool found = false;
     for (std::pair<ServerConfigID, bool>& j : expected_ids_and_status) {
-      if (i.first == j.first && i.second->is_primary == j.second) {
+      const bool is_primary = i.second == snapshot->primary;
+      if (i.first == j.first && is_primary == j.second) {
         found = true;
         j.first.clear();
         break;
@@ -105,16 +111,19 @@ void QuicCryptoServerConfigPeer::CheckConfigs(
 // ConfigsDebug returns a std::string that contains debugging information about
 // the set of Configs loaded in |server_config_| and their status.
 std::string QuicCryptoServerConfigPeer::ConfigsDebug() {
-  if (server_config_->configs_.empty()) {
+  const QuicCryptoServerConfig::ConfigSnapshot* snapshot =
+      server_config_->snapshot_.get();
+  const QuicCryptoServerConfig::ConfigMap& configs = snapshot->configs;
+  if (configs.empty()) {
     return "No Configs in QuicCryptoServerConfig";
   }
 
   std::string s;
 
-  for (const auto& i : server_config_->configs_) {
+  for (const auto& i : configs) {
     const quiche::QuicheReferenceCountedPointer<QuicCryptoServerConfig::Config>
         config = i.second;
-    if (config->is_primary) {
+    if (config == snapshot->primary) {
       s += "(primary) ";
     } else {
       s += "          ";
@@ -128,8 +137,38 @@ std::string QuicCryptoServerConfigPeer::ConfigsDebug() {
 
 void QuicCryptoServerConfigPeer::SelectNewPrimaryConfig(int seconds) {
   QuicWriterMutexLock locked(&server_config_->configs_lock_);
-  server_config_->SelectNewPrimaryConfig(
-      QuicWallTime::FromUNIXSeconds(seconds));
+  const QuicWallTime now = QuicWallTime::FromUNIXSeconds(seconds);
+  auto snapshot = std::make_unique<QuicCryptoServerConfig::ConfigSnapshot>(
+      *server_config_->snapshot_);
+  server_config_->SelectNewPrimaryConfig(now, snapshot.get());
+  server_config_->PublishSnapshot(std::move(snapshot));
+}
+
+bool QuicCryptoServerConfigPeer::GetCurrentConfigs(
+    absl::string_view requested_scid) {
+  QuicCryptoServerConfig::Configs configs;
+  return server_config_->GetCurrentConfigs(
+             QuicWallTime::Zero(), requested_scid,
+             quiche::QuicheReferenceCountedPointer<
+                 QuicCryptoServerConfig::Config>(),
+             &configs) &&
+         configs.requested != nullptr;
+}
+
+bool QuicCryptoServerConfigPeer::GetCurrentConfigsUnderLock(
+    absl::string_view requested_scid) {
+  QuicReaderMutexLock locked(&server_config_->configs_lock_);
+  const QuicCryptoServerConfig::ConfigSnapshot& snapshot =
+      *server_config_->snapshot_;
+  if (!snapshot.primary) {
+    return false;
+  }
+  QuicCryptoServerConfig::Configs configs;
+  configs.primary = snapshot.primary;
+  configs.requested =
+      QuicCryptoServerConfig::GetConfigWithScid(snapshot, requested_scid);
+  configs.fallback = snapshot.fallback;
+  return configs.requested != nullptr;
 }
 
 std::string QuicCryptoServerConfigPeer::CompressChain(
@@ -69,6 +69,14 @@ class QuicCryptoServerConfigPeer {
 
   void SelectNewPrimaryConfig(int seconds);
 
+  // Looks up the configs for a CHLO naming |requested_scid|. Returns true if
+  // that config is loaded.
+  bool GetCurrentConfigs(absl::string_view requested_scid);
+
+  // Same as GetCurrentConfigs(), but under |configs_lock_| held for reading,
+  // as every lookup was before the configs were published as snapshots.
+  bool GetCurrentConfigsUnderLock(absl::string_view requested_scid);
+
   static std::string CompressChain(
       QuicCompressedCertsCache* compressed_certs_cache,
       const quiche::QuicheReferenceCountedPointer<ProofSource::Chain>& chain,
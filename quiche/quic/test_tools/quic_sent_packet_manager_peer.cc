@@ -176,5 +176,12 @@ int QuicSentPacketManagerPeer::GetNumPtosForPathDegrading(
   return sent_packet_manager->num_ptos_for_path_degrading_;
 }
 
+// static
+void QuicSentPacketManagerPeer::OnAckFrequencyFrameSent(
+    QuicSentPacketManager* sent_packet_manager,
+    const QuicAckFrequencyFrame& ack_frequency_frame) {
+  sent_packet_manager->OnAckFrequencyFrameSent(ack_frequency_frame);
+}
+
 }  // namespace test
 }  // namespace quic
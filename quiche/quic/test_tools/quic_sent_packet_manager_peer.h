@@ -85,6 +85,10 @@ class QuicSentPacketManagerPeer {
 
   static int GetNumPtosForPathDegrading(
       QuicSentPacketManager* sent_packet_manager);
+
+  static void OnAckFrequencyFrameSent(
+      QuicSentPacketManager* sent_packet_manager,
+      const QuicAckFrequencyFrame& ack_frequency_frame);
 };
 
 }  // namespace test
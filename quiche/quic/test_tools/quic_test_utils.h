@@ -19,6 +19,8 @@
 #include "absl/strings/string_view.h"
 #include "quiche/quic/core/congestion_control/loss_detection_interface.h"
 #include "quiche/quic/core/congestion_control/send_algorithm_interface.h"
+#include "quiche/quic/core/crypto/null_decrypter.h"
+#include "quiche/quic/core/crypto/null_encrypter.h"
 #include "quiche/quic/core/crypto/transport_parameters.h"
 #include "quiche/quic/core/http/http_decoder.h"
 #include "quiche/quic/core/http/quic_client_push_promise_index.h"
@@ -695,6 +697,12 @@ class MockQuicConnection : public QuicConnection {
     return QuicConnection::SendControlFrame(frame);
   }
 
+  MessageStatus ReallySendMessage(QuicMessageId message_id,
+                                  absl::Span<quiche::QuicheMemSlice> message,
+                                  bool flush) {
+    return QuicConnection::SendMessage(message_id, message, flush);
+  }
+
   bool ReallySendConnectivityProbingPacket(
       QuicPacketWriter* probing_writer, const QuicSocketAddress& peer_address) {
     return QuicConnection::SendConnectivityProbingPacket(probing_writer,
@@ -1803,6 +1811,56 @@ class StrictTaggingDecrypter : public TaggingDecrypter {
   const uint8_t tag_;
 };
 
+// A MockQuicCryptoStream which creates 1-RTT crypters for key updates, and
+// keeps count of the key derivations and of the decrypters which have not been
+// deleted.
+class KeyUpdateCryptoStream : public MockQuicCryptoStream {
+ public:
+  explicit KeyUpdateCryptoStream(QuicSession* session)
+      : MockQuicCryptoStream(session) {}
+
+  std::unique_ptr<QuicDecrypter> AdvanceKeysAndCreateCurrentOneRttDecrypter()
+      override {
+    ++num_keys_derived_;
+    return CreateCurrentOneRttDecrypter();
+  }
+  std::unique_ptr<QuicEncrypter> CreateCurrentOneRttEncrypter() override {
+    auto encrypter = std::make_unique<NullEncrypter>(Perspective::IS_SERVER);
+    last_encrypter_ = encrypter.get();
+    return encrypter;
+  }
+
+  // Creates a decrypter of the current key phase, without advancing it.
+  std::unique_ptr<QuicDecrypter> CreateCurrentOneRttDecrypter() {
+    auto decrypter = std::make_unique<CountedDecrypter>(&num_live_decrypters_);
+    last_decrypter_ = decrypter.get();
+    return decrypter;
+  }
+
+  int num_keys_derived() const { return num_keys_derived_; }
+  int num_live_decrypters() const { return num_live_decrypters_; }
+  const QuicEncrypter* last_encrypter() const { return last_encrypter_; }
+  const QuicDecrypter* last_decrypter() const { return last_decrypter_; }
+
+ private:
+  class CountedDecrypter : public NullDecrypter {
+   public:
+    explicit CountedDecrypter(int* num_live)
+        : NullDecrypter(Perspective::IS_SERVER), num_live_(num_live) {
+      ++*num_live_;
+    }
+    ~CountedDecrypter() override { --*num_live_; }
+
+   private:
+    int* num_live_;
+  };
+
+  int num_keys_derived_ = 0;
+  int num_live_decrypters_ = 0;
+  const QuicEncrypter* last_encrypter_ = nullptr;
+  const QuicDecrypter* last_decrypter_ = nullptr;
+};
+
 class TestPacketWriter : public QuicPacketWriter {
   struct PacketBuffer {
     ABSL_CACHELINE_ALIGNED char buffer[1500];
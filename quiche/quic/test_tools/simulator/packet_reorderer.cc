@@ -0,0 +1,68 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/test_tools/simulator/packet_reorderer.h"
+
+#include <utility>
+
+namespace quic {
+namespace simulator {
+
+PacketReorderer::PacketReorderer(Simulator* simulator, std::string name,
+                                 Endpoint* input, int period,
+                                 QuicTime::Delta extra_delay)
+    : Endpoint(simulator, name),
+      output_tx_port_(nullptr),
+      input_(input),
+      period_(period),
+      extra_delay_(extra_delay),
+      packets_seen_(0),
+      packets_reordered_(0) {
+  input_->SetTxPort(this);
+}
+
+PacketReorderer::~PacketReorderer() {}
+
+void PacketReorderer::AcceptPacket(std::unique_ptr<Packet> packet) {
+  ++packets_seen_;
+  if (period_ > 0 && packets_seen_ % period_ == 0) {
+    ++packets_reordered_;
+    held_packets_.push_back(
+        HeldPacket{std::move(packet), clock_->Now() + extra_delay_});
+    Schedule(held_packets_.front().release_time);
+    return;
+  }
+  output_tx_port_->AcceptPacket(std::move(packet));
+}
+
+QuicTime::Delta PacketReorderer::TimeUntilAvailable() {
+  return output_tx_port_->TimeUntilAvailable();
+}
+
+void PacketReorderer::Act() {
+  while (!held_packets_.empty() &&
+         held_packets_.front().release_time <= clock_->Now()) {
+    const QuicTime::Delta wait = output_tx_port_->TimeUntilAvailable();
+    if (!wait.IsZero()) {
+      Schedule(clock_->Now() + wait);
+      return;
+    }
+    output_tx_port_->AcceptPacket(std::move(held_packets_.front().packet));
+    held_packets_.pop_front();
+  }
+  if (!held_packets_.empty()) {
+    Schedule(held_packets_.front().release_time);
+  }
+}
+
+UnconstrainedPortInterface* PacketReorderer::GetRxPort() {
+  return input_->GetRxPort();
+}
+
+void PacketReorderer::SetTxPort(ConstrainedPortInterface* port) {
+  output_tx_port_ = port;
+}
+
+}  // namespace simulator
+}  // namespace quic
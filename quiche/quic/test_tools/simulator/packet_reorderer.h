@@ -0,0 +1,67 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_TEST_TOOLS_SIMULATOR_PACKET_REORDERER_H_
+#define QUICHE_QUIC_TEST_TOOLS_SIMULATOR_PACKET_REORDERER_H_
+
+#include <memory>
+
+#include "quiche/quic/test_tools/simulator/port.h"
+#include "quiche/common/quiche_circular_deque.h"
+
+namespace quic {
+namespace simulator {
+
+// Reorders the packets which exit the output port of the wrapped endpoint, by
+// holding every |period|-th packet back for |extra_delay| while the following
+// packets are passed through.  Packets in the other direction are always
+// passed through.  Used the same way as PacketFilter:
+//
+//   PacketReorderer reorderer(&simulator, "A reorderer", &endpoint_a, 10,
+//                             QuicTime::Delta::FromMilliseconds(5));
+//   SymmetricLink a_b_link(&reorderer, &endpoint_b, ...);
+class PacketReorderer : public Endpoint, public ConstrainedPortInterface {
+ public:
+  PacketReorderer(Simulator* simulator, std::string name, Endpoint* input,
+                  int period, QuicTime::Delta extra_delay);
+  PacketReorderer(const PacketReorderer&) = delete;
+  PacketReorderer& operator=(const PacketReorderer&) = delete;
+  ~PacketReorderer() override;
+
+  // Implementation of ConstrainedPortInterface.
+  void AcceptPacket(std::unique_ptr<Packet> packet) override;
+  QuicTime::Delta TimeUntilAvailable() override;
+
+  // Implementation of Endpoint interface methods.
+  UnconstrainedPortInterface* GetRxPort() override;
+  void SetTxPort(ConstrainedPortInterface* port) override;
+
+  // Implementation of Actor interface methods.
+  void Act() override;
+
+  int packets_reordered() const { return packets_reordered_; }
+
+  // Changes how often packets are held back. Zero disables reordering.
+  void set_period(int period) { period_ = period; }
+
+ private:
+  struct HeldPacket {
+    std::unique_ptr<Packet> packet;
+    QuicTime release_time;
+  };
+
+  ConstrainedPortInterface* output_tx_port_;
+  Endpoint* input_;
+
+  int period_;
+  const QuicTime::Delta extra_delay_;
+  int packets_seen_;
+  int packets_reordered_;
+  quiche::QuicheCircularDeque<HeldPacket> held_packets_;
+};
+
+}  // namespace simulator
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TEST_TOOLS_SIMULATOR_PACKET_REORDERER_H_
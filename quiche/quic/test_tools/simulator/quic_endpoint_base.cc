@@ -62,7 +62,9 @@ QuicEndpointBase::QuicEndpointBase(Simulator* simulator, std::string name,
                     kMaxOutgoingPacketSize * kTxQueueSize),
       connection_(nullptr),
       write_blocked_count_(0),
-      drop_next_packet_(false) {
+      drop_next_packet_(false),
+      read_burst_max_packets_(0),
+      read_burst_delay_(QuicTime::Delta::Zero()) {
   nic_tx_queue_.set_listener_interface(this);
 }
 
@@ -79,6 +81,12 @@ QuicEndpointBase::~QuicEndpointBase() {
 
 void QuicEndpointBase::DropNextIncomingPacket() { drop_next_packet_ = true; }
 
+void QuicEndpointBase::SetReadBurst(size_t max_packets,
+                                    QuicTime::Delta delay) {
+  read_burst_max_packets_ = max_packets;
+  read_burst_delay_ = delay;
+}
+
 void QuicEndpointBase::RecordTrace() {
   trace_visitor_ = std::make_unique<QuicTraceVisitor>(connection_.get());
   connection_->set_debug_visitor(trace_visitor_.get());
@@ -95,8 +103,34 @@ void QuicEndpointBase::AcceptPacket(std::unique_ptr<Packet> packet) {
 
   QuicReceivedPacket received_packet(packet->contents.data(),
                                      packet->contents.size(), clock_->Now());
-  connection_->ProcessUdpPacket(connection_->self_address(),
-                                connection_->peer_address(), received_packet);
+  if (read_burst_max_packets_ == 0) {
+    connection_->ProcessUdpPacket(connection_->self_address(),
+                                  connection_->peer_address(), received_packet);
+    return;
+  }
+  if (pending_reads_.empty()) {
+    Schedule(clock_->Now() + read_burst_delay_);
+  }
+  pending_reads_.push_back(received_packet.Clone());
+}
+
+void QuicEndpointBase::Act() {
+  if (pending_reads_.empty()) {
+    return;
+  }
+  connection_->OnReadBurstStart();
+  for (size_t i = 0; i < read_burst_max_packets_ && !pending_reads_.empty();
+       ++i) {
+    connection_->ProcessUdpPacket(connection_->self_address(),
+                                  connection_->peer_address(),
+                                  *pending_reads_.front());
+    pending_reads_.pop_front();
+  }
+  connection_->OnReadBurstEnd();
+  if (!pending_reads_.empty()) {
+    // The next recvmmsg() call follows right away.
+    Schedule(clock_->Now());
+  }
 }
 
 UnconstrainedPortInterface* QuicEndpointBase::GetRxPort() { return this; }
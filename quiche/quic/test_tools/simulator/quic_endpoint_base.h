@@ -19,6 +19,7 @@
 #include "quiche/quic/test_tools/simple_session_notifier.h"
 #include "quiche/quic/test_tools/simulator/link.h"
 #include "quiche/quic/test_tools/simulator/queue.h"
+#include "quiche/common/quiche_circular_deque.h"
 
 namespace quic {
 namespace simulator {
@@ -51,6 +52,13 @@ class QuicEndpointBase : public Endpoint,
   // Drop the next packet upon receipt.
   void DropNextIncomingPacket();
 
+  // Makes the endpoint read its packets in bursts, like a server which reads
+  // up to |max_packets| packets per recvmmsg() call, |delay| after the first
+  // one arrived. The packets of a burst are processed between
+  // OnReadBurstStart() and OnReadBurstEnd() of the connection. Each packet
+  // keeps the time it arrived at as its receipt time.
+  void SetReadBurst(size_t max_packets, QuicTime::Delta delay);
+
   // UnconstrainedPortInterface method.  Called whenever the endpoint receives a
   // packet.
   void AcceptPacket(std::unique_ptr<Packet> packet) override;
@@ -64,7 +72,7 @@ class QuicEndpointBase : public Endpoint,
   // End Endpoint implementation.
 
   // Actor method.
-  void Act() override {}
+  void Act() override;
 
   // Queue::ListenerInterface method.
   void OnPacketDequeued() override;
@@ -127,6 +135,14 @@ class QuicEndpointBase : public Endpoint,
   // If true, drop the next packet when receiving it.
   bool drop_next_packet_;
 
+  // See SetReadBurst(). Packets are processed as they arrive if
+  // |read_burst_max_packets_| is 0.
+  size_t read_burst_max_packets_;
+  QuicTime::Delta read_burst_delay_;
+  // Received packets waiting for the next read burst.
+  quiche::QuicheCircularDeque<std::unique_ptr<QuicReceivedPacket>>
+      pending_reads_;
+
   std::unique_ptr<QuicTraceVisitor> trace_visitor_;
 
   test::MockConnectionIdGenerator connection_id_generator_;
@@ -20,6 +20,15 @@ ABSL_CONST_INIT extern const char kTestCertificatePem[];
 // |kTestCertificatePem| with a PEM-encoded root appended to the end.
 ABSL_CONST_INIT extern const char kTestCertificateChainPem[];
 
+// PEM-encoded leaf and intermediate certificates as large as chains served in
+// production, about 4 KB in DER: an RSA-2048 leaf for 57 names with AIA, CRL
+// distribution point, policy and embedded SCT extensions, issued by an RSA-2048
+// intermediate.
+ABSL_CONST_INIT extern const char kTestProductionSizedChainPem[];
+
+// PEM-encoded private key for the leaf of |kTestProductionSizedChainPem|.
+ABSL_CONST_INIT extern const char kTestProductionSizedLeafPrivateKeyPem[];
+
 // PEM-encoded certificate that contains a subjectAltName with an
 // unknown/unsupported type.
 ABSL_CONST_INIT extern const char kTestCertWithUnknownSanTypePem[];
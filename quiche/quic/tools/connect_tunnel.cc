@@ -5,6 +5,7 @@
 #include "quiche/quic/tools/connect_tunnel.h"
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -20,7 +21,6 @@
 #include "quiche/quic/core/quic_server_id.h"
 #include "quiche/quic/core/socket_factory.h"
 #include "quiche/quic/platform/api/quic_socket_address.h"
-#include "quiche/quic/tools/quic_backend_response.h"
 #include "quiche/quic/tools/quic_name_lookup.h"
 #include "quiche/quic/tools/quic_simple_server_backend.h"
 #include "quiche/common/platform/api/quiche_logging.h"
@@ -89,6 +89,19 @@ bool ValidateAuthority(
 
 }  // namespace
 
+// Resumes reading from the destination once the client stream has sent enough
+// of the data read so far.
+class ConnectTunnel::DestinationReader
+    : public QuicSimpleServerBackend::ResponseProducer {
+ public:
+  explicit DestinationReader(ConnectTunnel* tunnel) : tunnel_(tunnel) {}
+
+  void ResumeProducing() override { tunnel_->ResumeReadFromDestination(); }
+
+ private:
+  ConnectTunnel* const tunnel_;
+};
+
 ConnectTunnel::ConnectTunnel(
     QuicSimpleServerBackend::RequestHandler* client_stream_request_handler,
     SocketFactory* socket_factory,
@@ -223,8 +236,17 @@ void ConnectTunnel::ReceiveComplete(
   }
 
   QUICHE_DCHECK(client_stream_request_handler_);
-  client_stream_request_handler_->SendStreamData(data.value().AsStringView(),
-                                                 /*close_stream=*/false);
+  quiche::QuicheMemSlice slice = std::move(data).value();
+  if (!client_stream_request_handler_->SendResponseBody(
+          absl::MakeSpan(&slice, 1), /*fin=*/false)) {
+    // Stop reading until the client stream catches up, so that a slow client
+    // does not make the stream buffer everything the destination sends.
+    QUICHE_DVLOG(1) << "CONNECT stream "
+                    << client_stream_request_handler_->stream_id()
+                    << " paused reading from destination";
+    receive_paused_ = true;
+    return;
+  }
 
   BeginAsyncReadFromDestination();
 }
@@ -243,6 +265,15 @@ void ConnectTunnel::BeginAsyncReadFromDestination() {
   destination_socket_->ReceiveAsync(kReadSize);
 }
 
+void ConnectTunnel::ResumeReadFromDestination() {
+  if (!receive_paused_ || !IsConnectedToDestination() ||
+      !client_stream_request_handler_) {
+    return;
+  }
+  receive_paused_ = false;
+  BeginAsyncReadFromDestination();
+}
+
 void ConnectTunnel::OnDestinationConnectionClosed() {
   QUICHE_DCHECK(IsConnectedToDestination());
   QUICHE_DCHECK(client_stream_request_handler_);
@@ -259,7 +290,7 @@ void ConnectTunnel::OnDestinationConnectionClosed() {
   // stream.
   QUICHE_DCHECK(client_stream_request_handler_);
 
-  client_stream_request_handler_->SendStreamData("", /*close_stream=*/true);
+  client_stream_request_handler_->SendResponseBody({}, /*fin=*/true);
 }
 
 void ConnectTunnel::SendConnectResponse() {
@@ -269,12 +300,11 @@ void ConnectTunnel::SendConnectResponse() {
   spdy::Http2HeaderBlock response_headers;
   response_headers[":status"] = "200";
 
-  QuicBackendResponse response;
-  response.set_headers(std::move(response_headers));
   // Need to leave the stream open after sending the CONNECT response.
-  response.set_response_type(QuicBackendResponse::INCOMPLETE_RESPONSE);
-
-  client_stream_request_handler_->OnResponseBackendComplete(&response);
+  client_stream_request_handler_->SendResponseHeaders(
+      std::move(response_headers), /*fin=*/false);
+  client_stream_request_handler_->SetResponseProducer(
+      std::make_unique<DestinationReader>(this));
 }
 
 void ConnectTunnel::TerminateClientStream(absl::string_view error_description,
@@ -59,7 +59,12 @@ class ConnectTunnel : public ConnectingClientSocket::AsyncVisitor {
   void SendComplete(absl::Status status) override;
 
  private:
+  class DestinationReader;
+
   void BeginAsyncReadFromDestination();
+  // Restarts reading from the destination if it was paused because the client
+  // stream had buffered too much data.
+  void ResumeReadFromDestination();
   void OnDataReceivedFromDestination(bool success);
 
   // For normal (FIN) closure. Errors (RST) should result in directly calling
@@ -82,6 +87,9 @@ class ConnectTunnel : public ConnectingClientSocket::AsyncVisitor {
   std::unique_ptr<ConnectingClientSocket> destination_socket_;
 
   bool receive_started_ = false;
+  // Whether reading from the destination waits for the client stream to send
+  // its buffered data.
+  bool receive_paused_ = false;
 };
 
 }  // namespace quic
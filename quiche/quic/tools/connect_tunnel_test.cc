@@ -5,6 +5,7 @@
 #include "quiche/quic/tools/connect_tunnel.h"
 
 #include <cstdint>
+#include <memory>
 #include <utility>
 
 #include "absl/container/flat_hash_set.h"
@@ -12,6 +13,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/connecting_client_socket.h"
 #include "quiche/quic/core/quic_connection_id.h"
 #include "quiche/quic/core/quic_error_codes.h"
@@ -30,7 +32,6 @@ namespace quic::test {
 namespace {
 
 using ::testing::_;
-using ::testing::AllOf;
 using ::testing::AnyOf;
 using ::testing::ElementsAre;
 using ::testing::Eq;
@@ -60,8 +61,25 @@ class MockRequestHandler : public QuicSimpleServerBackend::RequestHandler {
               (override));
   MOCK_METHOD(void, TerminateStreamWithError, (QuicResetStreamError error),
               (override));
+  MOCK_METHOD(void, SendResponseHeaders,
+              (spdy::Http2HeaderBlock response_headers, bool fin), (override));
+  MOCK_METHOD(bool, SendResponseBody,
+              (absl::Span<quiche::QuicheMemSlice> body, bool fin), (override));
+  MOCK_METHOD(bool, SendResponseBodyChunk, (absl::string_view chunk, bool fin),
+              (override));
+  MOCK_METHOD(void, SendResponseTrailers,
+              (spdy::Http2HeaderBlock response_trailers), (override));
+  MOCK_METHOD(void, SetResponseProducer,
+              (std::unique_ptr<QuicSimpleServerBackend::ResponseProducer>
+                   producer),
+              (override));
 };
 
+// Matches a response body consisting of the single slice `data`.
+MATCHER_P(BodyIs, data, "") {
+  return arg.size() == 1 && arg[0].AsStringView() == data;
+}
+
 class MockSocketFactory : public SocketFactory {
  public:
   MOCK_METHOD(std::unique_ptr<ConnectingClientSocket>, CreateTcpClientSocket,
@@ -133,19 +151,10 @@ TEST_F(ConnectTunnelTest, OpenTunnel) {
     tunnel_.ReceiveComplete(absl::CancelledError());
   }));
 
-  spdy::Http2HeaderBlock expected_response_headers;
-  expected_response_headers[":status"] = "200";
-  QuicBackendResponse expected_response;
-  expected_response.set_headers(std::move(expected_response_headers));
-  expected_response.set_response_type(QuicBackendResponse::INCOMPLETE_RESPONSE);
   EXPECT_CALL(request_handler_,
-              OnResponseBackendComplete(
-                  AllOf(Property(&QuicBackendResponse::response_type,
-                                 QuicBackendResponse::INCOMPLETE_RESPONSE),
-                        Property(&QuicBackendResponse::headers,
-                                 ElementsAre(Pair(":status", "200"))),
-                        Property(&QuicBackendResponse::trailers, IsEmpty()),
-                        Property(&QuicBackendResponse::body, IsEmpty()))));
+              SendResponseHeaders(ElementsAre(Pair(":status", "200")),
+                                  /*fin=*/false));
+  EXPECT_CALL(request_handler_, SetResponseProducer(_));
 
   spdy::Http2HeaderBlock request_headers;
   request_headers[":method"] = "CONNECT";
@@ -165,19 +174,10 @@ TEST_F(ConnectTunnelTest, OpenTunnelToIpv4LiteralDestination) {
     tunnel_.ReceiveComplete(absl::CancelledError());
   }));
 
-  spdy::Http2HeaderBlock expected_response_headers;
-  expected_response_headers[":status"] = "200";
-  QuicBackendResponse expected_response;
-  expected_response.set_headers(std::move(expected_response_headers));
-  expected_response.set_response_type(QuicBackendResponse::INCOMPLETE_RESPONSE);
   EXPECT_CALL(request_handler_,
-              OnResponseBackendComplete(
-                  AllOf(Property(&QuicBackendResponse::response_type,
-                                 QuicBackendResponse::INCOMPLETE_RESPONSE),
-                        Property(&QuicBackendResponse::headers,
-                                 ElementsAre(Pair(":status", "200"))),
-                        Property(&QuicBackendResponse::trailers, IsEmpty()),
-                        Property(&QuicBackendResponse::body, IsEmpty()))));
+              SendResponseHeaders(ElementsAre(Pair(":status", "200")),
+                                  /*fin=*/false));
+  EXPECT_CALL(request_handler_, SetResponseProducer(_));
 
   spdy::Http2HeaderBlock request_headers;
   request_headers[":method"] = "CONNECT";
@@ -197,19 +197,10 @@ TEST_F(ConnectTunnelTest, OpenTunnelToIpv6LiteralDestination) {
     tunnel_.ReceiveComplete(absl::CancelledError());
   }));
 
-  spdy::Http2HeaderBlock expected_response_headers;
-  expected_response_headers[":status"] = "200";
-  QuicBackendResponse expected_response;
-  expected_response.set_headers(std::move(expected_response_headers));
-  expected_response.set_response_type(QuicBackendResponse::INCOMPLETE_RESPONSE);
   EXPECT_CALL(request_handler_,
-              OnResponseBackendComplete(
-                  AllOf(Property(&QuicBackendResponse::response_type,
-                                 QuicBackendResponse::INCOMPLETE_RESPONSE),
-                        Property(&QuicBackendResponse::headers,
-                                 ElementsAre(Pair(":status", "200"))),
-                        Property(&QuicBackendResponse::trailers, IsEmpty()),
-                        Property(&QuicBackendResponse::body, IsEmpty()))));
+              SendResponseHeaders(ElementsAre(Pair(":status", "200")),
+                                  /*fin=*/false));
+  EXPECT_CALL(request_handler_, SetResponseProducer(_));
 
   spdy::Http2HeaderBlock request_headers;
   request_headers[":method"] = "CONNECT";
@@ -262,9 +253,12 @@ TEST_F(ConnectTunnelTest, ReceiveFromDestination) {
     tunnel_.ReceiveComplete(absl::CancelledError());
   }));
 
-  EXPECT_CALL(request_handler_, OnResponseBackendComplete(_));
+  EXPECT_CALL(request_handler_, SendResponseHeaders(_, /*fin=*/false));
+  EXPECT_CALL(request_handler_, SetResponseProducer(_));
 
-  EXPECT_CALL(request_handler_, SendStreamData(kData, /*close_stream=*/false));
+  EXPECT_CALL(request_handler_,
+              SendResponseBody(BodyIs(kData), /*fin=*/false))
+      .WillOnce(Return(true));
 
   spdy::Http2HeaderBlock request_headers;
   request_headers[":method"] = "CONNECT";
@@ -279,6 +273,46 @@ TEST_F(ConnectTunnelTest, ReceiveFromDestination) {
   tunnel_.OnClientStreamClose();
 }
 
+TEST_F(ConnectTunnelTest, PausesReceiveWhileClientStreamIsBlocked) {
+  static constexpr absl::string_view kData = "\x11\x22\x33\x44\x55";
+
+  EXPECT_CALL(*socket_, ConnectBlocking()).WillOnce(Return(absl::OkStatus()));
+  EXPECT_CALL(*socket_, Disconnect()).WillOnce(InvokeWithoutArgs([this]() {
+    tunnel_.ReceiveComplete(absl::CancelledError());
+  }));
+
+  EXPECT_CALL(request_handler_, SendResponseHeaders(_, /*fin=*/false));
+  std::unique_ptr<QuicSimpleServerBackend::ResponseProducer> producer;
+  EXPECT_CALL(request_handler_, SetResponseProducer(_))
+      .WillOnce([&producer](
+                    std::unique_ptr<QuicSimpleServerBackend::ResponseProducer>
+                        response_producer) {
+        producer = std::move(response_producer);
+      });
+  // The client stream does not accept more data after `kData`.
+  EXPECT_CALL(request_handler_,
+              SendResponseBody(BodyIs(kData), /*fin=*/false))
+      .WillOnce(Return(false));
+
+  spdy::Http2HeaderBlock request_headers;
+  request_headers[":method"] = "CONNECT";
+  request_headers[":authority"] =
+      absl::StrCat(kAcceptableDestination, ":", kAcceptablePort);
+
+  EXPECT_CALL(*socket_, ReceiveAsync(Gt(0)));
+  tunnel_.OpenTunnel(request_headers);
+  ASSERT_TRUE(producer);
+
+  // No further receive is started while the client stream is blocked.
+  tunnel_.ReceiveComplete(MemSliceFromString(kData));
+  testing::Mock::VerifyAndClearExpectations(socket_);
+
+  EXPECT_CALL(*socket_, ReceiveAsync(Gt(0)));
+  producer->ResumeProducing();
+
+  tunnel_.OnClientStreamClose();
+}
+
 TEST_F(ConnectTunnelTest, SendToDestination) {
   static constexpr absl::string_view kData = "\x11\x22\x33\x44\x55";
 
@@ -290,7 +324,8 @@ TEST_F(ConnectTunnelTest, SendToDestination) {
     tunnel_.ReceiveComplete(absl::CancelledError());
   }));
 
-  EXPECT_CALL(request_handler_, OnResponseBackendComplete(_));
+  EXPECT_CALL(request_handler_, SendResponseHeaders(_, /*fin=*/false));
+  EXPECT_CALL(request_handler_, SetResponseProducer(_));
 
   spdy::Http2HeaderBlock request_headers;
   request_headers[":method"] = "CONNECT";
@@ -307,8 +342,10 @@ TEST_F(ConnectTunnelTest, DestinationDisconnect) {
   EXPECT_CALL(*socket_, ReceiveAsync(Gt(0)));
   EXPECT_CALL(*socket_, Disconnect());
 
-  EXPECT_CALL(request_handler_, OnResponseBackendComplete(_));
-  EXPECT_CALL(request_handler_, SendStreamData("", /*close_stream=*/true));
+  EXPECT_CALL(request_handler_, SendResponseHeaders(_, /*fin=*/false));
+  EXPECT_CALL(request_handler_, SetResponseProducer(_));
+  EXPECT_CALL(request_handler_, SendResponseBody(IsEmpty(), /*fin=*/true))
+      .WillOnce(Return(true));
 
   spdy::Http2HeaderBlock request_headers;
   request_headers[":method"] = "CONNECT";
@@ -330,7 +367,8 @@ TEST_F(ConnectTunnelTest, DestinationTcpConnectionError) {
   EXPECT_CALL(*socket_, ReceiveAsync(Gt(0)));
   EXPECT_CALL(*socket_, Disconnect());
 
-  EXPECT_CALL(request_handler_, OnResponseBackendComplete(_));
+  EXPECT_CALL(request_handler_, SendResponseHeaders(_, /*fin=*/false));
+  EXPECT_CALL(request_handler_, SetResponseProducer(_));
   EXPECT_CALL(request_handler_,
               TerminateStreamWithError(Property(
                   &QuicResetStreamError::ietf_application_code,
@@ -11,6 +11,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "url/url_canon_stdstring.h"
 #include "url/url_util.h"
 #include "quiche/quic/core/connecting_client_socket.h"
@@ -26,6 +27,7 @@
 #include "quiche/common/masque/connect_udp_datagram_payload.h"
 #include "quiche/common/platform/api/quiche_mem_slice.h"
 #include "quiche/common/platform/api/quiche_test.h"
+#include "quiche/spdy/core/http2_header_block.h"
 
 namespace quic::test {
 namespace {
@@ -74,6 +76,18 @@ class MockRequestHandler : public QuicSimpleServerBackend::RequestHandler {
               (override));
   MOCK_METHOD(void, TerminateStreamWithError, (QuicResetStreamError error),
               (override));
+  MOCK_METHOD(void, SendResponseHeaders,
+              (spdy::Http2HeaderBlock response_headers, bool fin), (override));
+  MOCK_METHOD(bool, SendResponseBody,
+              (absl::Span<quiche::QuicheMemSlice> body, bool fin), (override));
+  MOCK_METHOD(bool, SendResponseBodyChunk, (absl::string_view chunk, bool fin),
+              (override));
+  MOCK_METHOD(void, SendResponseTrailers,
+              (spdy::Http2HeaderBlock response_trailers), (override));
+  MOCK_METHOD(void, SetResponseProducer,
+              (std::unique_ptr<QuicSimpleServerBackend::ResponseProducer>
+                   producer),
+              (override));
 };
 
 class MockSocketFactory : public SocketFactory {
@@ -0,0 +1,633 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/file_backed_client_session_cache.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "quiche/quic/core/crypto/transport_parameters.h"
+#include "quiche/quic/core/quic_data_reader.h"
+#include "quiche/quic/core/quic_data_writer.h"
+#include "quiche/quic/core/quic_types.h"
+#include "quiche/quic/core/quic_utils.h"
+#include "quiche/quic/core/quic_versions.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+namespace {
+
+// The file is the magic number, the number of entries, and the entries
+// prefixed with their varint62 lengths. Entries of the same server are
+// adjacent and newest first.
+constexpr uint64_t kMagic = 0x5155494353435331;  // "QUICSCS1"
+
+// Flags of an entry.
+constexpr uint8_t kHasParams = 1 << 0;
+constexpr uint8_t kHasApplicationState = 1 << 1;
+// ClearEarlyData() was called, the session is resumed without early data.
+constexpr uint8_t kEarlyDataCleared = 1 << 2;
+
+size_t VarInt62StringLength(absl::string_view value) {
+  return QuicDataWriter::GetVarInt62Len(value.size()) + value.size();
+}
+
+absl::string_view BytesToStringView(const uint8_t* data, size_t length) {
+  return absl::string_view(reinterpret_cast<const char*>(data), length);
+}
+
+bool ParseParams(absl::string_view bytes, TransportParameters* params) {
+  std::string error_details;
+  // The version only matters for the parameters of Google QUIC versions, which
+  // don't use TLS.
+  if (!ParseTransportParameters(
+          ParsedQuicVersion::RFCv1(), Perspective::IS_SERVER,
+          reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size(), params,
+          &error_details)) {
+    QUIC_DLOG(ERROR) << "Invalid cached transport parameters: "
+                     << error_details;
+    return false;
+  }
+  DegreaseTransportParameters(*params);
+  return true;
+}
+
+bool WriteFile(const std::string& path, absl::string_view contents) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return false;
+  }
+  while (!contents.empty()) {
+    const ssize_t written = write(fd, contents.data(), contents.size());
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      close(fd);
+      return false;
+    }
+    contents.remove_prefix(written);
+  }
+  // The snapshot replaces the previous one with rename(), so it must be on
+  // disk first, or a crash may leave an empty file in its place.
+  if (fsync(fd) != 0) {
+    close(fd);
+    return false;
+  }
+  return close(fd) == 0;
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<FileBackedClientSessionCache>
+FileBackedClientSessionCache::Create(const std::string& path,
+                                     size_t max_entries,
+                                     QuicTime::Delta flush_interval,
+                                     const QuicClock* clock) {
+  const std::string lock_path = absl::StrCat(path, ".lock");
+  int fd = open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    QUIC_LOG(ERROR) << "Failed to create session cache lock " << lock_path;
+    return nullptr;
+  }
+  close(fd);
+  std::unique_ptr<FileBackedClientSessionCache> cache(
+      new FileBackedClientSessionCache(path, max_entries, flush_interval,
+                                       clock));
+  cache->Remap();
+  return cache;
+}
+
+FileBackedClientSessionCache::FileBackedClientSessionCache(
+    std::string path, size_t max_entries, QuicTime::Delta flush_interval,
+    const QuicClock* clock)
+    : path_(std::move(path)),
+      max_entries_(max_entries),
+      flush_interval_(flush_interval),
+      clock_(clock),
+      last_refresh_(clock->ApproximateNow()) {}
+
+FileBackedClientSessionCache::~FileBackedClientSessionCache() {
+  if (!changes_.empty() || cleared_) {
+    Flush();
+  }
+  Unmap();
+}
+
+// static
+std::string FileBackedClientSessionCache::SerializeEntry(
+    const QuicServerId& server_id, const QuicResumptionState& state) {
+  SSL_SESSION* session = state.tls_session.get();
+  if (session == nullptr) {
+    return "";
+  }
+  uint8_t* session_bytes = nullptr;
+  size_t session_length = 0;
+  if (!SSL_SESSION_to_bytes(session, &session_bytes, &session_length)) {
+    return "";
+  }
+  bssl::UniquePtr<uint8_t> free_session_bytes(session_bytes);
+
+  Record record;
+  record.server_id = server_id;
+  record.expiry =
+      SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session);
+  record.session = BytesToStringView(session_bytes, session_length);
+  std::vector<uint8_t> params;
+  // SerializeTransportParameters() requires the legacy version information,
+  // sessions of servers which don't send it are resumed without early data.
+  if (state.transport_params != nullptr &&
+      state.transport_params->legacy_version_information.has_value()) {
+    TransportParameters degreased = *state.transport_params;
+    DegreaseTransportParameters(degreased);
+    if (!SerializeTransportParameters(degreased, &params)) {
+      return "";
+    }
+    record.flags |= kHasParams;
+    record.params = BytesToStringView(params.data(), params.size());
+  }
+  if (state.application_state != nullptr) {
+    record.flags |= kHasApplicationState;
+    record.application_state = BytesToStringView(
+        state.application_state->data(), state.application_state->size());
+  }
+  record.token = state.token;
+  return SerializeRecord(record);
+}
+
+// static
+std::unique_ptr<QuicResumptionState> FileBackedClientSessionCache::ParseEntry(
+    absl::string_view entry, const SSL_CTX* ctx, QuicServerId* server_id) {
+  Record record;
+  if (!ParseRecord(entry, &record)) {
+    return nullptr;
+  }
+  auto state = std::make_unique<QuicResumptionState>();
+  state->tls_session.reset(SSL_SESSION_from_bytes(
+      reinterpret_cast<const uint8_t*>(record.session.data()),
+      record.session.size(), ctx));
+  if (state->tls_session == nullptr) {
+    return nullptr;
+  }
+  if (record.flags & kEarlyDataCleared) {
+    state->tls_session.reset(
+        SSL_SESSION_copy_without_early_data(state->tls_session.get()));
+  }
+  if (record.flags & kHasParams) {
+    state->transport_params = std::make_unique<TransportParameters>();
+    if (!ParseParams(record.params, state->transport_params.get())) {
+      return nullptr;
+    }
+  }
+  if (record.flags & kHasApplicationState) {
+    state->application_state = std::make_unique<ApplicationState>(
+        record.application_state.begin(), record.application_state.end());
+  }
+  state->token = std::string(record.token);
+  *server_id = record.server_id;
+  return state;
+}
+
+// static
+bool FileBackedClientSessionCache::ParseRecord(absl::string_view entry,
+                                               Record* record) {
+  QuicDataReader reader(entry);
+  absl::string_view host;
+  uint16_t port = 0;
+  uint8_t privacy_mode_enabled = 0;
+  if (!reader.ReadStringPieceVarInt62(&host) || !reader.ReadUInt16(&port) ||
+      !reader.ReadUInt8(&privacy_mode_enabled) ||
+      !reader.ReadUInt64(&record->expiry) ||
+      !reader.ReadUInt8(&record->flags) ||
+      !reader.ReadStringPieceVarInt62(&record->session) ||
+      !reader.ReadStringPieceVarInt62(&record->params) ||
+      !reader.ReadStringPieceVarInt62(&record->application_state) ||
+      !reader.ReadStringPieceVarInt62(&record->token) ||
+      !reader.IsDoneReading()) {
+    return false;
+  }
+  record->server_id =
+      QuicServerId(std::string(host), port, privacy_mode_enabled != 0);
+  return true;
+}
+
+// static
+std::string FileBackedClientSessionCache::SerializeRecord(
+    const Record& record) {
+  const std::string& host = record.server_id.host();
+  std::string entry(VarInt62StringLength(host) + sizeof(uint16_t) +
+                        sizeof(uint8_t) + sizeof(uint64_t) + sizeof(uint8_t) +
+                        VarInt62StringLength(record.session) +
+                        VarInt62StringLength(record.params) +
+                        VarInt62StringLength(record.application_state) +
+                        VarInt62StringLength(record.token),
+                    '\0');
+  QuicDataWriter writer(entry.size(), entry.data());
+  const bool ok =
+      writer.WriteStringPieceVarInt62(host) &&
+      writer.WriteUInt16(record.server_id.port()) &&
+      writer.WriteUInt8(record.server_id.privacy_mode_enabled() ? 1 : 0) &&
+      writer.WriteUInt64(record.expiry) && writer.WriteUInt8(record.flags) &&
+      writer.WriteStringPieceVarInt62(record.session) &&
+      writer.WriteStringPieceVarInt62(record.params) &&
+      writer.WriteStringPieceVarInt62(record.application_state) &&
+      writer.WriteStringPieceVarInt62(record.token);
+  QUICHE_DCHECK(ok && writer.remaining() == 0);
+  return entry;
+}
+
+void FileBackedClientSessionCache::Insert(
+    const QuicServerId& server_id, bssl::UniquePtr<SSL_SESSION> session,
+    const TransportParameters& params,
+    const ApplicationState* application_state) {
+  QuicResumptionState state;
+  state.tls_session = std::move(session);
+  state.transport_params = std::make_unique<TransportParameters>(params);
+  DegreaseTransportParameters(*state.transport_params);
+  if (application_state != nullptr) {
+    state.application_state =
+        std::make_unique<ApplicationState>(*application_state);
+  }
+  std::string entry = SerializeEntry(server_id, state);
+  if (entry.empty()) {
+    QUIC_DLOG(ERROR) << "Failed to serialize TLS session for host: "
+                     << server_id.host();
+    return;
+  }
+
+  // Sessions of the same connection share its transport parameters and
+  // application state, the newest of them is kept as well.
+  std::vector<std::string> entries = CurrentEntries(server_id);
+  Record inserted;
+  Record previous;
+  TransportParameters previous_params;
+  const bool keep_previous =
+      !entries.empty() && ParseRecord(entry, &inserted) &&
+      ParseRecord(entries[0], &previous) &&
+      (inserted.flags & (kHasParams | kHasApplicationState)) ==
+          (previous.flags & (kHasParams | kHasApplicationState)) &&
+      inserted.application_state == previous.application_state &&
+      (!(inserted.flags & kHasParams) ||
+       (ParseParams(previous.params, &previous_params) &&
+        previous_params == *state.transport_params));
+  std::vector<std::string> new_entries;
+  new_entries.push_back(std::move(entry));
+  if (keep_previous) {
+    new_entries.push_back(std::move(entries[0]));
+  }
+  changes_[server_id] = std::move(new_entries);
+  MaybeRefresh();
+}
+
+std::unique_ptr<QuicResumptionState> FileBackedClientSessionCache::Lookup(
+    const QuicServerId& server_id, QuicWallTime now, const SSL_CTX* ctx) {
+  MaybeRefresh();
+  std::vector<std::string> entries = CurrentEntries(server_id);
+  if (entries.empty()) {
+    return nullptr;
+  }
+  Record newest;
+  std::unique_ptr<QuicResumptionState> state;
+  if (ParseRecord(entries[0], &newest) && now.ToUNIXSeconds() < newest.expiry) {
+    QuicServerId parsed_server_id;
+    state = ParseEntry(entries[0], ctx, &parsed_server_id);
+  }
+  if (state == nullptr) {
+    QUIC_DLOG(INFO) << "TLS Session expired for host:" << server_id.host();
+    changes_[server_id].clear();
+    return nullptr;
+  }
+  used_sessions_.insert(QuicUtils::FNV1a_64_Hash(newest.session));
+  entries.erase(entries.begin());
+  // Like sessions, tokens are used once.
+  for (std::string& entry : entries) {
+    Record record;
+    if (ParseRecord(entry, &record) && !record.token.empty()) {
+      record.token = absl::string_view();
+      entry = SerializeRecord(record);
+    }
+  }
+  changes_[server_id] = std::move(entries);
+  return state;
+}
+
+void FileBackedClientSessionCache::ClearEarlyData(
+    const QuicServerId& server_id) {
+  std::vector<std::string> entries = CurrentEntries(server_id);
+  if (entries.empty()) {
+    return;
+  }
+  QUIC_DLOG(INFO) << "Clear early data for for host: " << server_id.host();
+  for (std::string& entry : entries) {
+    Record record;
+    if (ParseRecord(entry, &record) && !(record.flags & kEarlyDataCleared)) {
+      record.flags |= kEarlyDataCleared;
+      entry = SerializeRecord(record);
+    }
+  }
+  changes_[server_id] = std::move(entries);
+}
+
+void FileBackedClientSessionCache::OnNewTokenReceived(
+    const QuicServerId& server_id, absl::string_view token) {
+  if (token.empty()) {
+    return;
+  }
+  std::vector<std::string> entries = CurrentEntries(server_id);
+  if (entries.empty()) {
+    return;
+  }
+  for (std::string& entry : entries) {
+    Record record;
+    if (ParseRecord(entry, &record)) {
+      record.token = token;
+      entry = SerializeRecord(record);
+    }
+  }
+  changes_[server_id] = std::move(entries);
+}
+
+void FileBackedClientSessionCache::RemoveExpiredEntries(QuicWallTime now) {
+  const uint64_t now_seconds = now.ToUNIXSeconds();
+  auto is_expired = [now_seconds](absl::string_view entry) {
+    Record record;
+    return !ParseRecord(entry, &record) || record.expiry <= now_seconds;
+  };
+  for (auto& [server_id, entries] : changes_) {
+    entries.erase(std::remove_if(entries.begin(), entries.end(), is_expired),
+                  entries.end());
+  }
+  bool snapshot_has_expired = false;
+  if (!cleared_) {
+    for (const auto& [server_id, entries] : snapshot_) {
+      for (const SnapshotEntry& entry : entries) {
+        snapshot_has_expired |= entry.expiry <= now_seconds;
+      }
+    }
+  }
+  if (snapshot_has_expired) {
+    TryFlush();
+  }
+}
+
+void FileBackedClientSessionCache::Clear() {
+  changes_.clear();
+  cleared_ = true;
+}
+
+size_t FileBackedClientSessionCache::size() const {
+  size_t size = 0;
+  for (const auto& [server_id, entries] : changes_) {
+    size += entries.empty() ? 0 : 1;
+  }
+  if (cleared_) {
+    return size;
+  }
+  for (const auto& [server_id, entries] : snapshot_) {
+    if (changes_.contains(server_id)) {
+      continue;
+    }
+    for (const SnapshotEntry& entry : entries) {
+      if (!used_sessions_.contains(entry.session_hash)) {
+        ++size;
+        break;
+      }
+    }
+  }
+  return size;
+}
+
+bool FileBackedClientSessionCache::Flush() {
+  return FlushChanges(/*wait_for_lock=*/true);
+}
+
+bool FileBackedClientSessionCache::TryFlush() {
+  return FlushChanges(/*wait_for_lock=*/false);
+}
+
+bool FileBackedClientSessionCache::FlushChanges(bool wait_for_lock) {
+  const std::string lock_path = absl::StrCat(path_, ".lock");
+  int lock_fd = open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (lock_fd < 0) {
+    QUIC_LOG(ERROR) << "Failed to open session cache lock " << lock_path;
+    return false;
+  }
+  if (flock(lock_fd, wait_for_lock ? LOCK_EX : LOCK_EX | LOCK_NB) != 0) {
+    if (errno == EWOULDBLOCK) {
+      QUIC_DLOG(INFO) << "Session cache " << lock_path
+                      << " is locked by another process";
+    } else {
+      QUIC_LOG(ERROR) << "Failed to lock session cache " << lock_path;
+    }
+    close(lock_fd);
+    return false;
+  }
+  // No other process replaces the file while the lock is held, so the changes
+  // are merged into the latest snapshot.
+  Remap();
+
+  struct Server {
+    uint64_t expiry = 0;
+    std::vector<absl::string_view> entries;
+  };
+  const uint64_t now = clock_->WallNow().ToUNIXSeconds();
+  std::vector<Server> servers;
+  for (const auto& [server_id, entries] : changes_) {
+    Server server;
+    for (const std::string& entry : entries) {
+      Record record;
+      if (ParseRecord(entry, &record) && record.expiry > now) {
+        server.expiry = std::max(server.expiry, record.expiry);
+        server.entries.push_back(entry);
+      }
+    }
+    if (!server.entries.empty()) {
+      servers.push_back(std::move(server));
+    }
+  }
+  if (!cleared_) {
+    for (const auto& [server_id, entries] : snapshot_) {
+      if (changes_.contains(server_id)) {
+        continue;
+      }
+      Server server;
+      for (const SnapshotEntry& entry : entries) {
+        if (entry.expiry > now &&
+            !used_sessions_.contains(entry.session_hash)) {
+          server.expiry = std::max(server.expiry, entry.expiry);
+          server.entries.push_back(entry.bytes);
+        }
+      }
+      if (!server.entries.empty()) {
+        servers.push_back(std::move(server));
+      }
+    }
+  }
+  if (servers.size() > max_entries_) {
+    std::nth_element(servers.begin(), servers.begin() + max_entries_,
+                     servers.end(), [](const Server& a, const Server& b) {
+                       return a.expiry > b.expiry;
+                     });
+    servers.resize(max_entries_);
+  }
+
+  size_t length = sizeof(kMagic) + sizeof(uint32_t);
+  uint32_t num_entries = 0;
+  for (const Server& server : servers) {
+    for (absl::string_view entry : server.entries) {
+      length += VarInt62StringLength(entry);
+      ++num_entries;
+    }
+  }
+  std::string contents(length, '\0');
+  QuicDataWriter writer(contents.size(), contents.data());
+  bool ok = writer.WriteUInt64(kMagic) && writer.WriteUInt32(num_entries);
+  for (const Server& server : servers) {
+    for (absl::string_view entry : server.entries) {
+      ok = ok && writer.WriteStringPieceVarInt62(entry);
+    }
+  }
+  QUICHE_DCHECK(ok && writer.remaining() == 0);
+
+  const std::string temp_path = absl::StrCat(path_, ".tmp");
+  const bool written = WriteFile(temp_path, contents) &&
+                       rename(temp_path.c_str(), path_.c_str()) == 0;
+  if (written) {
+    changes_.clear();
+    cleared_ = false;
+    Remap();
+  } else {
+    QUIC_LOG(ERROR) << "Failed to write session cache " << path_;
+    std::remove(temp_path.c_str());
+  }
+  flock(lock_fd, LOCK_UN);
+  close(lock_fd);
+  return written;
+}
+
+void FileBackedClientSessionCache::Remap() {
+  struct stat file_stat;
+  if (stat(path_.c_str(), &file_stat) != 0) {
+    // There is no snapshot yet, or it was deleted.
+    Unmap();
+    used_sessions_.clear();
+    return;
+  }
+  if (map_inode_ != 0 && file_stat.st_dev == map_device_ &&
+      file_stat.st_ino == map_inode_) {
+    return;
+  }
+  int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+  // The file may have been replaced again since stat().
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return;
+  }
+  Unmap();
+  map_device_ = file_stat.st_dev;
+  map_inode_ = file_stat.st_ino;
+  if (file_stat.st_size > 0) {
+    void* map = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map != MAP_FAILED) {
+      map_ = static_cast<const char*>(map);
+      map_size_ = file_stat.st_size;
+    }
+  }
+  close(fd);
+
+  QuicDataReader reader(map_, map_size_);
+  uint64_t magic = 0;
+  uint32_t num_entries = 0;
+  bool valid = reader.ReadUInt64(&magic) && magic == kMagic &&
+               reader.ReadUInt32(&num_entries);
+  for (uint32_t i = 0; valid && i < num_entries; ++i) {
+    absl::string_view bytes;
+    Record record;
+    valid = reader.ReadStringPieceVarInt62(&bytes) &&
+            ParseRecord(bytes, &record);
+    if (valid) {
+      snapshot_[record.server_id].push_back(
+          {bytes, record.expiry, QuicUtils::FNV1a_64_Hash(record.session)});
+    }
+  }
+  if (!valid) {
+    QUIC_LOG(ERROR) << "Ignoring invalid session cache " << path_;
+    snapshot_.clear();
+  }
+
+  // Sessions which are no longer in the snapshot can't be used again.
+  absl::flat_hash_set<uint64_t> used_sessions;
+  for (const auto& [server_id, entries] : snapshot_) {
+    for (const SnapshotEntry& entry : entries) {
+      if (used_sessions_.contains(entry.session_hash)) {
+        used_sessions.insert(entry.session_hash);
+      }
+    }
+  }
+  used_sessions_ = std::move(used_sessions);
+}
+
+void FileBackedClientSessionCache::Unmap() {
+  snapshot_.clear();
+  if (map_ != nullptr) {
+    munmap(const_cast<char*>(map_), map_size_);
+  }
+  map_ = nullptr;
+  map_size_ = 0;
+  map_device_ = 0;
+  map_inode_ = 0;
+}
+
+void FileBackedClientSessionCache::MaybeRefresh() {
+  const QuicTime now = clock_->ApproximateNow();
+  if (now - last_refresh_ < flush_interval_) {
+    return;
+  }
+  last_refresh_ = now;
+  if (!changes_.empty() || cleared_) {
+    // Another process may be writing a snapshot, in which case the changes
+    // are merged on the next refresh instead of waiting for it.
+    TryFlush();
+  } else {
+    Remap();
+  }
+}
+
+std::vector<std::string> FileBackedClientSessionCache::CurrentEntries(
+    const QuicServerId& server_id) const {
+  auto it = changes_.find(server_id);
+  if (it != changes_.end()) {
+    return it->second;
+  }
+  std::vector<std::string> entries;
+  if (cleared_) {
+    return entries;
+  }
+  auto snapshot_it = snapshot_.find(server_id);
+  if (snapshot_it == snapshot_.end()) {
+    return entries;
+  }
+  for (const SnapshotEntry& entry : snapshot_it->second) {
+    if (!used_sessions_.contains(entry.session_hash)) {
+      entries.emplace_back(entry.bytes);
+    }
+  }
+  return entries;
+}
+
+}  // namespace quic
@@ -0,0 +1,167 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_TOOLS_FILE_BACKED_CLIENT_SESSION_CACHE_H_
+#define QUICHE_QUIC_TOOLS_FILE_BACKED_CLIENT_SESSION_CACHE_H_
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "quiche/quic/core/crypto/quic_crypto_client_config.h"
+#include "quiche/quic/core/quic_clock.h"
+#include "quiche/quic/core/quic_server_id.h"
+#include "quiche/quic/core/quic_time.h"
+
+namespace quic {
+
+// FileBackedClientSessionCache is a SessionCache which keeps its sessions in a
+// file, so that a client resumes, and sends 0-RTT data, on its first
+// connections after a restart, and so that all the client processes which use
+// the same file share their sessions.
+//
+// The file is an immutable snapshot, which every process maps into memory and
+// which is only ever replaced with rename(). Lookups read the mapping and the
+// changes of this process, and every |flush_interval| the changes are merged
+// into a new snapshot under an flock() of the file |path|.lock. These merges
+// never wait for the lock: while another process holds it, the changes are
+// kept for the next interval. Snapshots are fsync()ed before they replace the
+// file. Merging drops the expired sessions, and keeps the sessions of the
+// |max_entries| servers whose sessions expire last. Processes which have no
+// changes only stat() the file every |flush_interval| to pick up new
+// snapshots.
+//
+// Like QuicClientSessionCache, up to two sessions are kept per server, and a
+// process uses each session at most once. Different processes may use the
+// same session before either flushes, servers which use an anti-replay cache
+// reject all but the first 0-RTT attempt, and those connections fall back to
+// a full round trip.
+//
+// Not thread safe, each thread should use a cache of its own.
+class QUIC_NO_EXPORT FileBackedClientSessionCache : public SessionCache {
+ public:
+  // Opens the cache in the file |path|, which is created on the first flush.
+  // Returns nullptr if the lock file next to it can't be created. A file which
+  // is not a session cache, e.g. after a crash, is treated as empty.
+  static std::unique_ptr<FileBackedClientSessionCache> Create(
+      const std::string& path, size_t max_entries,
+      QuicTime::Delta flush_interval, const QuicClock* clock);
+
+  // Flushes the changes since the last flush.
+  ~FileBackedClientSessionCache() override;
+
+  // SessionCache implementation.
+  void Insert(const QuicServerId& server_id,
+              bssl::UniquePtr<SSL_SESSION> session,
+              const TransportParameters& params,
+              const ApplicationState* application_state) override;
+  std::unique_ptr<QuicResumptionState> Lookup(const QuicServerId& server_id,
+                                              QuicWallTime now,
+                                              const SSL_CTX* ctx) override;
+  void ClearEarlyData(const QuicServerId& server_id) override;
+  void OnNewTokenReceived(const QuicServerId& server_id,
+                          absl::string_view token) override;
+  // Also compacts the file if it contains expired sessions.
+  void RemoveExpiredEntries(QuicWallTime now) override;
+  void Clear() override;
+
+  // Merges the changes of this process into a new snapshot. Returns false on
+  // failure, in which case the changes are kept for the next flush. Waits for
+  // other processes to release the lock.
+  bool Flush();
+
+  // Like Flush(), but returns false right away if another process holds the
+  // lock.
+  bool TryFlush();
+
+  // Returns the number of servers with sessions.
+  size_t size() const;
+
+  // Serializes a session of |server_id|, with the transport parameters,
+  // application state and token of |state|. Returns an empty string if the
+  // session or the transport parameters can't be serialized.
+  static std::string SerializeEntry(const QuicServerId& server_id,
+                                    const QuicResumptionState& state);
+
+  // Parses a serialized session, whose certificates are parsed with the
+  // X.509 method of |ctx|. Returns nullptr if |entry| is invalid.
+  static std::unique_ptr<QuicResumptionState> ParseEntry(
+      absl::string_view entry, const SSL_CTX* ctx, QuicServerId* server_id);
+
+ private:
+  // An entry in the serialized format, pointing into its serialization.
+  struct Record {
+    QuicServerId server_id;
+    // When the session expires, in UNIX seconds.
+    uint64_t expiry = 0;
+    uint8_t flags = 0;
+    absl::string_view session;
+    absl::string_view params;
+    absl::string_view application_state;
+    absl::string_view token;
+  };
+
+  // An entry of the current snapshot.
+  struct SnapshotEntry {
+    absl::string_view bytes;
+    uint64_t expiry = 0;
+    uint64_t session_hash = 0;
+  };
+
+  static bool ParseRecord(absl::string_view entry, Record* record);
+  static std::string SerializeRecord(const Record& record);
+
+  FileBackedClientSessionCache(std::string path, size_t max_entries,
+                               QuicTime::Delta flush_interval,
+                               const QuicClock* clock);
+
+  bool FlushChanges(bool wait_for_lock);
+
+  // Maps the file again if it was replaced since it was last mapped.
+  void Remap();
+  void Unmap();
+
+  // Flushes the changes, or picks up a new snapshot, if |flush_interval_| has
+  // elapsed since the last time.
+  void MaybeRefresh();
+
+  // Returns the unused entries of |server_id|, newest first.
+  std::vector<std::string> CurrentEntries(const QuicServerId& server_id) const;
+
+  const std::string path_;
+  const size_t max_entries_;
+  const QuicTime::Delta flush_interval_;
+  const QuicClock* clock_;
+  QuicTime last_refresh_;
+
+  // The mapping of the current snapshot, and the file it was mapped from.
+  const char* map_ = nullptr;
+  size_t map_size_ = 0;
+  dev_t map_device_ = 0;
+  ino_t map_inode_ = 0;
+  absl::flat_hash_map<QuicServerId, std::vector<SnapshotEntry>,
+                      QuicServerIdHash>
+      snapshot_;
+
+  // The entries of the servers changed since the last flush, which replace
+  // those of the snapshot, newest first.
+  absl::flat_hash_map<QuicServerId, std::vector<std::string>, QuicServerIdHash>
+      changes_;
+  // True if the snapshot was cleared since the last flush.
+  bool cleared_ = false;
+  // Hashes of the sessions this process used which may still be in the
+  // snapshot.
+  absl::flat_hash_set<uint64_t> used_sessions_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TOOLS_FILE_BACKED_CLIENT_SESSION_CACHE_H_
@@ -0,0 +1,320 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/file_backed_client_session_cache.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "quiche/quic/core/crypto/transport_parameters.h"
+#include "quiche/quic/core/quic_versions.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/test_tools/mock_clock.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+constexpr size_t kMaxEntries = 10;
+constexpr QuicTime::Delta kFlushInterval = QuicTime::Delta::FromSeconds(1);
+constexpr uint64_t kTimeout = 1000;
+
+// Returns the ID MakeSession() stored in the master key of |session|.
+uint8_t SessionId(const SSL_SESSION* session) {
+  uint8_t master_key[8] = {};
+  SSL_SESSION_get_master_key(session, master_key, sizeof(master_key));
+  return master_key[0];
+}
+
+class FileBackedClientSessionCacheTest : public QuicTest {
+ protected:
+  FileBackedClientSessionCacheTest()
+      : path_(absl::StrCat(testing::TempDir(), "/session_cache_",
+                           testing::UnitTest::GetInstance()
+                               ->current_test_info()
+                               ->name())),
+        ssl_ctx_(SSL_CTX_new(TLS_with_buffers_method())),
+        server_id_("www.example.org", 443, false) {
+    RemoveFiles();
+    clock_.AdvanceTime(QuicTime::Delta::FromSeconds(1000000));
+  }
+
+  ~FileBackedClientSessionCacheTest() override { RemoveFiles(); }
+
+  void RemoveFiles() {
+    for (const char* suffix : {"", ".lock", ".tmp"}) {
+      std::remove(absl::StrCat(path_, suffix).c_str());
+    }
+  }
+
+  std::unique_ptr<FileBackedClientSessionCache> CreateCache(
+      size_t max_entries = kMaxEntries) {
+    return FileBackedClientSessionCache::Create(path_, max_entries,
+                                                kFlushInterval, &clock_);
+  }
+
+  // Returns a minimal TLS 1.3 session which is valid for |timeout| seconds
+  // from now, with |id| as the first byte of its master key.
+  bssl::UniquePtr<SSL_SESSION> MakeSession(uint8_t id,
+                                           uint64_t timeout = kTimeout) {
+    const uint8_t kSession[] = {
+        0x30, 0x17,                                // SEQUENCE
+        0x02, 0x01, 0x01,                          // Version 1
+        0x02, 0x02, 0x03, 0x04,                    // TLS 1.3
+        0x04, 0x02, 0x13, 0x01,                    // TLS_AES_128_GCM_SHA256
+        0x04, 0x00,                                // Session ID
+        0x04, 0x08, id, 0, 0, 0, 0, 0, 0, 0,       // Master key
+    };
+    bssl::UniquePtr<SSL_SESSION> session(
+        SSL_SESSION_from_bytes(kSession, sizeof(kSession), ssl_ctx_.get()));
+    EXPECT_NE(nullptr, session);
+    SSL_SESSION_set_time(session.get(), clock_.WallNow().ToUNIXSeconds());
+    SSL_SESSION_set_timeout(session.get(), timeout);
+    return session;
+  }
+
+  TransportParameters MakeParams(uint64_t initial_max_data = 1000000) {
+    TransportParameters params;
+    params.perspective = Perspective::IS_SERVER;
+    params.legacy_version_information =
+        TransportParameters::LegacyVersionInformation();
+    params.legacy_version_information->version =
+        CreateQuicVersionLabel(ParsedQuicVersion::RFCv1());
+    params.legacy_version_information->supported_versions.push_back(
+        params.legacy_version_information->version);
+    params.initial_max_data.set_value(initial_max_data);
+    return params;
+  }
+
+  std::unique_ptr<QuicResumptionState> Lookup(
+      FileBackedClientSessionCache* cache) {
+    return cache->Lookup(server_id_, clock_.WallNow(), ssl_ctx_.get());
+  }
+
+  const std::string path_;
+  MockClock clock_;
+  bssl::UniquePtr<SSL_CTX> ssl_ctx_;
+  const QuicServerId server_id_;
+  const ApplicationState application_state_ = {1, 2, 3};
+};
+
+TEST_F(FileBackedClientSessionCacheTest, SerializesEntries) {
+  QuicResumptionState state;
+  state.tls_session = MakeSession(1);
+  state.transport_params = std::make_unique<TransportParameters>(MakeParams());
+  state.application_state =
+      std::make_unique<ApplicationState>(application_state_);
+  state.token = "token";
+  const std::string entry =
+      FileBackedClientSessionCache::SerializeEntry(server_id_, state);
+  ASSERT_FALSE(entry.empty());
+
+  QuicServerId server_id;
+  std::unique_ptr<QuicResumptionState> parsed =
+      FileBackedClientSessionCache::ParseEntry(entry, ssl_ctx_.get(),
+                                               &server_id);
+  ASSERT_NE(nullptr, parsed);
+  EXPECT_EQ(server_id_, server_id);
+  EXPECT_EQ(1, SessionId(parsed->tls_session.get()));
+  EXPECT_EQ(SSL_SESSION_get_time(state.tls_session.get()),
+            SSL_SESSION_get_time(parsed->tls_session.get()));
+  ASSERT_NE(nullptr, parsed->transport_params);
+  EXPECT_EQ(*state.transport_params, *parsed->transport_params);
+  ASSERT_NE(nullptr, parsed->application_state);
+  EXPECT_EQ(application_state_, *parsed->application_state);
+  EXPECT_EQ("token", parsed->token);
+
+  for (size_t length = 0; length < entry.size(); length += 7) {
+    EXPECT_EQ(nullptr, FileBackedClientSessionCache::ParseEntry(
+                           entry.substr(0, length), ssl_ctx_.get(),
+                           &server_id));
+  }
+  EXPECT_EQ(nullptr, FileBackedClientSessionCache::ParseEntry(
+                         entry + "x", ssl_ctx_.get(), &server_id));
+}
+
+TEST_F(FileBackedClientSessionCacheTest, PersistsAcrossRestarts) {
+  std::unique_ptr<FileBackedClientSessionCache> cache = CreateCache();
+  ASSERT_NE(nullptr, cache);
+  cache->Insert(server_id_, MakeSession(1), MakeParams(), &application_state_);
+  EXPECT_EQ(1u, cache->size());
+  cache.reset();
+
+  cache = CreateCache();
+  EXPECT_EQ(1u, cache->size());
+  std::unique_ptr<QuicResumptionState> state = Lookup(cache.get());
+  ASSERT_NE(nullptr, state);
+  EXPECT_EQ(1, SessionId(state->tls_session.get()));
+  ASSERT_NE(nullptr, state->transport_params);
+  EXPECT_EQ(MakeParams(), *state->transport_params);
+  ASSERT_NE(nullptr, state->application_state);
+  EXPECT_EQ(application_state_, *state->application_state);
+  // Sessions are used once.
+  EXPECT_EQ(nullptr, Lookup(cache.get()));
+  cache.reset();
+
+  EXPECT_EQ(0u, CreateCache()->size());
+}
+
+TEST_F(FileBackedClientSessionCacheTest, SharedBetweenProcesses) {
+  std::unique_ptr<FileBackedClientSessionCache> cache1 = CreateCache();
+  std::unique_ptr<FileBackedClientSessionCache> cache2 = CreateCache();
+  cache1->Insert(server_id_, MakeSession(1), MakeParams(), nullptr);
+  EXPECT_EQ(nullptr, Lookup(cache2.get()));
+
+  // cache2 picks up the new snapshot after the flush interval.
+  ASSERT_TRUE(cache1->Flush());
+  EXPECT_EQ(nullptr, Lookup(cache2.get()));
+  clock_.AdvanceTime(kFlushInterval);
+  std::unique_ptr<QuicResumptionState> state = Lookup(cache2.get());
+  ASSERT_NE(nullptr, state);
+  EXPECT_EQ(1, SessionId(state->tls_session.get()));
+
+  // Once cache2 flushes, cache1 does not use the session either.
+  ASSERT_TRUE(cache2->Flush());
+  clock_.AdvanceTime(kFlushInterval);
+  EXPECT_EQ(nullptr, Lookup(cache1.get()));
+}
+
+TEST_F(FileBackedClientSessionCacheTest, SkipsFlushWhileLocked) {
+  std::unique_ptr<FileBackedClientSessionCache> cache = CreateCache();
+  std::unique_ptr<FileBackedClientSessionCache> reader = CreateCache();
+  int lock_fd = open(absl::StrCat(path_, ".lock").c_str(), O_RDWR | O_CLOEXEC);
+  ASSERT_LE(0, lock_fd);
+  ASSERT_EQ(0, flock(lock_fd, LOCK_EX));
+
+  // The refresh of an insertion does not wait for the lock.
+  cache->Insert(server_id_, MakeSession(1), MakeParams(), nullptr);
+  clock_.AdvanceTime(kFlushInterval);
+  cache->Insert(server_id_, MakeSession(2), MakeParams(), nullptr);
+  EXPECT_FALSE(cache->TryFlush());
+  struct stat file_stat;
+  EXPECT_NE(0, stat(path_.c_str(), &file_stat));
+  EXPECT_EQ(1u, cache->size());
+
+  // The changes are kept, and written by the first refresh after the lock is
+  // released.
+  flock(lock_fd, LOCK_UN);
+  close(lock_fd);
+  clock_.AdvanceTime(kFlushInterval);
+  const QuicServerId other_server_id("other.example.org", 443, false);
+  EXPECT_EQ(nullptr,
+            cache->Lookup(other_server_id, clock_.WallNow(), ssl_ctx_.get()));
+  EXPECT_EQ(0, stat(path_.c_str(), &file_stat));
+  std::unique_ptr<QuicResumptionState> state = Lookup(reader.get());
+  ASSERT_NE(nullptr, state);
+  EXPECT_EQ(2, SessionId(state->tls_session.get()));
+}
+
+TEST_F(FileBackedClientSessionCacheTest, KeepsTwoSessionsPerConnection) {
+  std::unique_ptr<FileBackedClientSessionCache> cache = CreateCache();
+  for (uint8_t id : {1, 2, 3}) {
+    cache->Insert(server_id_, MakeSession(id), MakeParams(),
+                  &application_state_);
+  }
+  ASSERT_TRUE(cache->Flush());
+  for (uint8_t id : {3, 2}) {
+    std::unique_ptr<QuicResumptionState> state = Lookup(cache.get());
+    ASSERT_NE(nullptr, state);
+    EXPECT_EQ(id, SessionId(state->tls_session.get()));
+  }
+  EXPECT_EQ(nullptr, Lookup(cache.get()));
+
+  // Sessions of another connection replace the previous ones.
+  cache->Insert(server_id_, MakeSession(4), MakeParams(), &application_state_);
+  cache->Insert(server_id_, MakeSession(5), MakeParams(2000000),
+                &application_state_);
+  cache->Insert(server_id_, MakeSession(6), MakeParams(2000000), nullptr);
+  std::unique_ptr<QuicResumptionState> state = Lookup(cache.get());
+  ASSERT_NE(nullptr, state);
+  EXPECT_EQ(6, SessionId(state->tls_session.get()));
+  EXPECT_EQ(nullptr, state->application_state);
+  EXPECT_EQ(nullptr, Lookup(cache.get()));
+}
+
+TEST_F(FileBackedClientSessionCacheTest, TokensAreUsedOnce) {
+  std::unique_ptr<FileBackedClientSessionCache> cache = CreateCache();
+  cache->OnNewTokenReceived(server_id_, "ignored");
+  cache->Insert(server_id_, MakeSession(1), MakeParams(), nullptr);
+  cache->Insert(server_id_, MakeSession(2), MakeParams(), nullptr);
+  cache->OnNewTokenReceived(server_id_, "token");
+  cache.reset();
+
+  cache = CreateCache();
+  std::unique_ptr<QuicResumptionState> state = Lookup(cache.get());
+  ASSERT_NE(nullptr, state);
+  EXPECT_EQ("token", state->token);
+  state = Lookup(cache.get());
+  ASSERT_NE(nullptr, state);
+  EXPECT_EQ("", state->token);
+}
+
+TEST_F(FileBackedClientSessionCacheTest, ExpiresAndCompacts) {
+  std::unique_ptr<FileBackedClientSessionCache> cache =
+      CreateCache(/*max_entries=*/2);
+  for (int i = 1; i <= 3; ++i) {
+    cache->Insert(QuicServerId(absl::StrCat("server", i), 443, false),
+                  MakeSession(i, /*timeout=*/i * 100), MakeParams(), nullptr);
+  }
+  EXPECT_EQ(3u, cache->size());
+  cache.reset();
+
+  // The servers whose sessions expire last are kept.
+  cache = CreateCache(/*max_entries=*/2);
+  EXPECT_EQ(2u, cache->size());
+  EXPECT_EQ(nullptr, cache->Lookup(QuicServerId("server1", 443, false),
+                                   clock_.WallNow(), ssl_ctx_.get()));
+
+  clock_.AdvanceTime(QuicTime::Delta::FromSeconds(250));
+  EXPECT_EQ(nullptr, cache->Lookup(QuicServerId("server2", 443, false),
+                                   clock_.WallNow(), ssl_ctx_.get()));
+  cache->RemoveExpiredEntries(clock_.WallNow());
+  cache.reset();
+  cache = CreateCache();
+  EXPECT_EQ(1u, cache->size());
+  EXPECT_NE(nullptr, cache->Lookup(QuicServerId("server3", 443, false),
+                                   clock_.WallNow(), ssl_ctx_.get()));
+}
+
+TEST_F(FileBackedClientSessionCacheTest, Clear) {
+  std::unique_ptr<FileBackedClientSessionCache> cache = CreateCache();
+  cache->Insert(server_id_, MakeSession(1), MakeParams(), nullptr);
+  ASSERT_TRUE(cache->Flush());
+  cache->Clear();
+  EXPECT_EQ(0u, cache->size());
+  EXPECT_EQ(nullptr, Lookup(cache.get()));
+  cache.reset();
+  EXPECT_EQ(0u, CreateCache()->size());
+}
+
+TEST_F(FileBackedClientSessionCacheTest, IgnoresInvalidFiles) {
+  FILE* file = fopen(path_.c_str(), "w");
+  ASSERT_NE(nullptr, file);
+  fputs("not a session cache", file);
+  fclose(file);
+
+  std::unique_ptr<FileBackedClientSessionCache> cache = CreateCache();
+  ASSERT_NE(nullptr, cache);
+  EXPECT_EQ(0u, cache->size());
+  cache->Insert(server_id_, MakeSession(1), MakeParams(), nullptr);
+  ASSERT_TRUE(cache->Flush());
+  cache.reset();
+  EXPECT_EQ(1u, CreateCache()->size());
+
+  EXPECT_EQ(nullptr,
+            FileBackedClientSessionCache::Create(
+                absl::StrCat(path_, "/no/such/directory"), kMaxEntries,
+                kFlushInterval, &clock_));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -0,0 +1,390 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the compression ratio and CPU cost of QpackEncoder with and without
+// a QpackEncodingStrategy on a corpus of header lists, and the throughput of
+// QpackDecoder on the resulting encoder streams and header blocks.
+//
+// Every input file is a connection, in the format of the expected header files
+// of qpack_offline_decoder: one "name\tvalue" line per header field, and an
+// empty line after every header list. Without input files, a synthetic corpus
+// of API gateway requests is used, with large cookies and authorization tokens
+// that repeat and paths and request IDs that do not.
+//
+// Every header block is decoded by a QpackDecoder, whose decoder stream reaches
+// the encoder --ack_delay header lists later, to simulate the round trip. The
+// encoded data is then decoded again --decode_iterations times by fresh
+// decoders to measure decoding alone.
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "quiche/quic/core/qpack/qpack_decoder.h"
+#include "quiche/quic/core/qpack/qpack_encoder.h"
+#include "quiche/quic/core/qpack/qpack_encoding_strategy.h"
+#include "quiche/quic/core/qpack/qpack_progressive_decoder.h"
+#include "quiche/quic/core/qpack/qpack_stream_receiver.h"
+#include "quiche/quic/core/qpack/qpack_stream_sender_delegate.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+#include "quiche/quic/test_tools/qpack/qpack_test_utils.h"
+#include "quiche/quic/test_tools/quic_benchmark_utils.h"
+#include "quiche/common/platform/api/quiche_command_line_flags.h"
+#include "quiche/common/platform/api/quiche_file_utils.h"
+#include "quiche/spdy/core/http2_header_block.h"
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(uint64_t, max_table_capacity, 4096,
+                                "Dynamic table capacity, in bytes.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    uint64_t, max_blocked_streams, 0,
+    "Maximum number of blocked streams allowed by the decoder.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    uint64_t, ack_delay, 4,
+    "Number of header lists encoded before the decoder stream data of a header "
+    "list reaches the encoder.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    uint64_t, decode_iterations, 10,
+    "Number of times the encoded corpus is decoded to measure decoding "
+    "throughput.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    uint64_t, num_header_lists, 1000,
+    "Number of header lists of the synthetic corpus, used when no input files "
+    "are given.");
+
+namespace quic {
+namespace test {
+namespace {
+
+using Connection = std::vector<spdy::Http2HeaderBlock>;
+
+// The encoder stream data sent before each header block, and the header block.
+using EncodedConnection = std::vector<std::pair<std::string, std::string>>;
+
+// Buffers the data of a unidirectional stream until it is delivered.
+class BufferingStreamSenderDelegate : public QpackStreamSenderDelegate {
+ public:
+  ~BufferingStreamSenderDelegate() override = default;
+
+  void WriteStreamData(absl::string_view data) override {
+    buffer_.append(data.data(), data.size());
+  }
+  uint64_t NumBytesBuffered() const override { return 0; }
+
+  // Returns and clears the buffered data.
+  std::string TakeData() {
+    std::string data;
+    data.swap(buffer_);
+    return data;
+  }
+
+ private:
+  std::string buffer_;
+};
+
+class CountingHeadersHandler
+    : public QpackProgressiveDecoder::HeadersHandlerInterface {
+ public:
+  ~CountingHeadersHandler() override = default;
+
+  void OnHeaderDecoded(absl::string_view name,
+                       absl::string_view value) override {
+    decoded_size_ += name.size() + value.size();
+  }
+  void OnDecodingCompleted() override { completed_ = true; }
+  void OnDecodingErrorDetected(QuicErrorCode /*error_code*/,
+                               absl::string_view error_message) override {
+    QUIC_LOG(ERROR) << "Decoding error: " << error_message;
+    error_ = true;
+  }
+
+  size_t decoded_size() const { return decoded_size_; }
+  bool ok() const { return completed_ && !error_; }
+
+ private:
+  size_t decoded_size_ = 0;
+  bool completed_ = false;
+  bool error_ = false;
+};
+
+bool ReadConnection(absl::string_view filename, Connection* connection) {
+  absl::optional<std::string> contents = quiche::ReadFileContents(filename);
+  if (!contents) {
+    QUIC_LOG(ERROR) << "Failed to read " << filename;
+    return false;
+  }
+  spdy::Http2HeaderBlock header_list;
+  for (absl::string_view line : absl::StrSplit(*contents, '\n')) {
+    if (line.empty()) {
+      if (!header_list.empty()) {
+        connection->push_back(std::move(header_list));
+        header_list = spdy::Http2HeaderBlock();
+      }
+      continue;
+    }
+    std::vector<absl::string_view> pieces = absl::StrSplit(line, '\t');
+    if (pieces.size() != 2) {
+      QUIC_LOG(ERROR) << "Header name and value must be separated by TAB in "
+                      << filename;
+      return false;
+    }
+    header_list.AppendValueOrAddHeader(pieces[0], pieces[1]);
+  }
+  if (!header_list.empty()) {
+    connection->push_back(std::move(header_list));
+  }
+  return true;
+}
+
+Connection SyntheticConnection(size_t num_header_lists) {
+  const char* const kUserAgents[] = {
+      "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+      "Chrome/117.0.0.0 Safari/537.36",
+      "okhttp/4.11.0",
+      "internal-service-client/2.3 (grpc-gateway)",
+  };
+  Connection connection;
+  for (size_t i = 0; i < num_header_lists; ++i) {
+    spdy::Http2HeaderBlock header_list;
+    header_list[":method"] = i % 5 == 0 ? "POST" : "GET";
+    header_list[":scheme"] = "https";
+    header_list[":authority"] = "api.example.com";
+    header_list[":path"] = absl::StrCat("/v1/accounts/", i * 7919 % 100003,
+                                        "/items?page=", i % 13);
+    header_list["user-agent"] = kUserAgents[i % 3];
+    header_list["accept"] = "application/json";
+    // Tokens are refreshed every 200 requests.
+    header_list["authorization"] = absl::StrCat(
+        "Bearer ", std::string(180, static_cast<char>('a' + i / 200 % 26)));
+    header_list["cookie"] =
+        absl::StrCat("session=", std::string(120, 's'), "; prefs=",
+                     std::string(60, 'p'), "; ab=", i / 100 % 4);
+    header_list["x-request-id"] = absl::StrCat(i * 2654435761u, "-", i);
+    connection.push_back(std::move(header_list));
+  }
+  return connection;
+}
+
+struct EncodingResult {
+  uint64_t header_lists = 0;
+  uint64_t raw_bytes = 0;
+  uint64_t header_block_bytes = 0;
+  uint64_t encoder_stream_bytes = 0;
+  uint64_t speculative_inserts = 0;
+};
+
+// Encodes and decodes |connection|, adds the sizes to |result|, and appends
+// the encoded data to |encoded_connection|.
+bool EncodeConnection(const Connection& connection, bool use_strategy,
+                      EncodingResult* result,
+                      EncodedConnection* encoded_connection) {
+  NoopDecoderStreamErrorDelegate decoder_stream_error_delegate;
+  NoopEncoderStreamErrorDelegate encoder_stream_error_delegate;
+  BufferingStreamSenderDelegate encoder_stream;
+  BufferingStreamSenderDelegate decoder_stream;
+
+  QpackEncoder encoder(&decoder_stream_error_delegate);
+  encoder.set_qpack_stream_sender_delegate(&encoder_stream);
+  encoder.SetMaximumDynamicTableCapacity(
+      quiche::GetQuicheCommandLineFlag(FLAGS_max_table_capacity));
+  encoder.SetDynamicTableCapacity(
+      quiche::GetQuicheCommandLineFlag(FLAGS_max_table_capacity));
+  encoder.SetMaximumBlockedStreams(
+      quiche::GetQuicheCommandLineFlag(FLAGS_max_blocked_streams));
+  if (use_strategy) {
+    encoder.set_encoding_strategy(
+        std::make_unique<QpackFrequencyEncodingStrategy>());
+  }
+
+  QpackDecoder decoder(
+      quiche::GetQuicheCommandLineFlag(FLAGS_max_table_capacity),
+      quiche::GetQuicheCommandLineFlag(FLAGS_max_blocked_streams),
+      &encoder_stream_error_delegate);
+  decoder.set_qpack_stream_sender_delegate(&decoder_stream);
+
+  const uint64_t ack_delay = quiche::GetQuicheCommandLineFlag(FLAGS_ack_delay);
+  std::deque<std::string> decoder_stream_in_flight;
+  QuicStreamId stream_id = 0;
+  for (const spdy::Http2HeaderBlock& header_list : connection) {
+    QuicByteCount encoder_stream_sent_byte_count = 0;
+    const std::string header_block = encoder.EncodeHeaderList(
+        stream_id, header_list, &encoder_stream_sent_byte_count);
+    for (const auto& header : header_list) {
+      result->raw_bytes += header.first.size() + header.second.size();
+    }
+    ++result->header_lists;
+    result->header_block_bytes += header_block.size();
+    result->encoder_stream_bytes += encoder_stream_sent_byte_count;
+
+    encoded_connection->emplace_back(encoder_stream.TakeData(), header_block);
+    decoder.encoder_stream_receiver()->Decode(
+        encoded_connection->back().first);
+    CountingHeadersHandler handler;
+    std::unique_ptr<QpackProgressiveDecoder> progressive_decoder =
+        decoder.CreateProgressiveDecoder(stream_id, &handler);
+    progressive_decoder->Decode(header_block);
+    progressive_decoder->EndHeaderBlock();
+    if (!handler.ok()) {
+      return false;
+    }
+
+    decoder_stream_in_flight.push_back(decoder_stream.TakeData());
+    while (decoder_stream_in_flight.size() > ack_delay) {
+      encoder.decoder_stream_receiver()->Decode(
+          decoder_stream_in_flight.front());
+      decoder_stream_in_flight.pop_front();
+    }
+    stream_id += 4;
+  }
+  result->speculative_inserts += encoder.speculative_insert_count();
+  return true;
+}
+
+// Decodes |encoded_connection| without sending decoder stream data, and adds
+// the total size of the decoded names and values to |decoded_size|.
+bool DecodeConnection(const EncodedConnection& encoded_connection,
+                      uint64_t* decoded_size) {
+  NoopEncoderStreamErrorDelegate encoder_stream_error_delegate;
+  NoopQpackStreamSenderDelegate decoder_stream;
+  QpackDecoder decoder(
+      quiche::GetQuicheCommandLineFlag(FLAGS_max_table_capacity),
+      quiche::GetQuicheCommandLineFlag(FLAGS_max_blocked_streams),
+      &encoder_stream_error_delegate);
+  decoder.set_qpack_stream_sender_delegate(&decoder_stream);
+
+  QuicStreamId stream_id = 0;
+  for (const auto& [encoder_stream_data, header_block] : encoded_connection) {
+    decoder.encoder_stream_receiver()->Decode(encoder_stream_data);
+    CountingHeadersHandler handler;
+    std::unique_ptr<QpackProgressiveDecoder> progressive_decoder =
+        decoder.CreateProgressiveDecoder(stream_id, &handler);
+    progressive_decoder->Decode(header_block);
+    progressive_decoder->EndHeaderBlock();
+    if (!handler.ok()) {
+      return false;
+    }
+    *decoded_size += handler.decoded_size();
+    stream_id += 4;
+  }
+  return true;
+}
+
+bool RunDecodeBenchmark(
+    const std::vector<EncodedConnection>& encoded_connections,
+    bool use_strategy) {
+  const uint64_t iterations =
+      quiche::GetQuicheCommandLineFlag(FLAGS_decode_iterations);
+  uint64_t decoded_bytes = 0;
+  uint64_t encoded_bytes = 0;
+  QuicBenchmarkTimer timer;
+  timer.Start();
+  for (uint64_t i = 0; i < iterations; ++i) {
+    for (const EncodedConnection& encoded_connection : encoded_connections) {
+      if (!DecodeConnection(encoded_connection, &decoded_bytes)) {
+        return false;
+      }
+    }
+  }
+  timer.Stop();
+  for (const EncodedConnection& encoded_connection : encoded_connections) {
+    for (const auto& [encoder_stream_data, header_block] : encoded_connection) {
+      encoded_bytes += encoder_stream_data.size() + header_block.size();
+    }
+  }
+
+  encoded_bytes *= iterations;
+
+  const double seconds = timer.thread_cpu_seconds();
+  PrintBenchmarkResult(
+      QuicBenchmarkResult(use_strategy ? "qpack_decoder_frequency_strategy"
+                                       : "qpack_decoder_default")
+          .AddTimer(timer)
+          .AddMetric("decoded_bytes", decoded_bytes)
+          .AddMetric("encoded_bytes", encoded_bytes)
+          .AddMetric("decoded_mb_per_second",
+                     seconds == 0 ? 0 : decoded_bytes / seconds / 1e6)
+          .AddMetric("encoded_mb_per_second",
+                     seconds == 0 ? 0 : encoded_bytes / seconds / 1e6));
+  return true;
+}
+
+bool RunBenchmark(const std::vector<Connection>& connections,
+                  bool use_strategy) {
+  EncodingResult result;
+  std::vector<EncodedConnection> encoded_connections(connections.size());
+  QuicBenchmarkTimer timer;
+  timer.Start();
+  for (size_t i = 0; i < connections.size(); ++i) {
+    if (!EncodeConnection(connections[i], use_strategy, &result,
+                          &encoded_connections[i])) {
+      return false;
+    }
+  }
+  timer.Stop();
+
+  const uint64_t compressed_bytes =
+      result.header_block_bytes + result.encoder_stream_bytes;
+  PrintBenchmarkResult(
+      QuicBenchmarkResult(use_strategy ? "qpack_encoder_frequency_strategy"
+                                       : "qpack_encoder_default")
+          .AddTimer(timer)
+          .AddMetric("header_lists", result.header_lists)
+          .AddMetric("raw_bytes", result.raw_bytes)
+          .AddMetric("header_block_bytes", result.header_block_bytes)
+          .AddMetric("encoder_stream_bytes", result.encoder_stream_bytes)
+          .AddMetric("compression_ratio",
+                     compressed_bytes == 0
+                         ? 0
+                         : static_cast<double>(result.raw_bytes) /
+                               compressed_bytes)
+          .AddMetric("speculative_inserts", result.speculative_inserts)
+          // Includes decoding, which costs the same for both encoders.
+          .AddMetric("cpu_ns_per_header_list",
+                     result.header_lists == 0
+                         ? 0
+                         : timer.thread_cpu_seconds() * 1e9 /
+                               result.header_lists));
+  return RunDecodeBenchmark(encoded_connections, use_strategy);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
+
+int main(int argc, char* argv[]) {
+  const char* usage = "Usage: qpack_encoder_benchmark [input_filename ...]";
+  std::vector<std::string> args =
+      quiche::QuicheParseCommandLineFlags(usage, argc, argv);
+
+  std::vector<quic::test::Connection> connections;
+  for (const std::string& filename : args) {
+    connections.emplace_back();
+    if (!quic::test::ReadConnection(filename, &connections.back())) {
+      return 1;
+    }
+  }
+  if (connections.empty()) {
+    connections.push_back(quic::test::SyntheticConnection(
+        quiche::GetQuicheCommandLineFlag(FLAGS_num_header_lists)));
+  }
+
+  for (bool use_strategy : {false, true}) {
+    if (!quic::test::RunBenchmark(connections, use_strategy)) {
+      std::cerr << "Failed to decode a header block." << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
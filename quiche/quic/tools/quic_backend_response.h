@@ -57,7 +57,12 @@ class QuicBackendResponse {
   SpecialResponseType response_type() const { return response_type_; }
   const spdy::Http2HeaderBlock& headers() const { return headers_; }
   const spdy::Http2HeaderBlock& trailers() const { return trailers_; }
-  const absl::string_view body() const { return absl::string_view(body_); }
+  const absl::string_view body() const {
+    return has_external_body_ ? external_body_ : absl::string_view(body_);
+  }
+  // Whether the body refers to memory owned by the backend, such as a
+  // memory-mapped file, instead of a copy held by this response.
+  bool has_external_body() const { return has_external_body_; }
 
   void AddEarlyHints(const spdy::Http2HeaderBlock& headers) {
     spdy::Http2HeaderBlock hints = headers.Clone();
@@ -77,6 +82,15 @@ class QuicBackendResponse {
   }
   void set_body(absl::string_view body) {
     body_.assign(body.data(), body.size());
+    external_body_ = absl::string_view();
+    has_external_body_ = false;
+  }
+  // Sets the body without copying it.  |body| must outlive this response and
+  // every stream which sends it.
+  void set_external_body(absl::string_view body) {
+    body_.clear();
+    external_body_ = body;
+    has_external_body_ = true;
   }
 
   // This would simulate a delay before sending the response
@@ -90,6 +104,8 @@ class QuicBackendResponse {
   spdy::Http2HeaderBlock headers_;
   spdy::Http2HeaderBlock trailers_;
   std::string body_;
+  absl::string_view external_body_;
+  bool has_external_body_ = false;
   QuicTime::Delta delay_;
 };
 
@@ -0,0 +1,842 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// End-to-end QUIC benchmarks over loopback. Every benchmark prints one line of
+// JSON with its results to stdout, e.g.
+//   quic_benchmark --benchmarks=loopback_bulk_transfer,loopback_handshakes
+//
+// The benchmarks run a QuicServer (backed by QuicMemoryCacheBackend, using the
+// X.509 test certificate via ProofSourceX509) on a separate thread and talk to
+// it with QuicDefaultClient over the loopback interface. CPU time is accounted
+// for the whole process, i.e. client and server together.
+// loopback_resumption restarts a client over and over, and compares the
+// latency of its first request with the in-memory QuicClientSessionCache, which
+// loses its sessions, and with FileBackedClientSessionCache, which resumes them
+// with 0-RTT. loopback_key_updates forces frequent key updates and compares the
+// request latency when the keys of the next key phase are derived ahead of
+// time with deriving them on the packet path. loopback_cache_corpus_* serve a
+// generated cache directory from QuicMemoryCacheBackend and from
+// QuicFileBackedCacheBackend, and report the resident memory of each.
+// loopback_small_messages streams gRPC-style responses of small messages, with
+// and without coalescing the DATA frames of each message. The effect of the
+// ephemeral key exchange pool on whole handshakes is measured by
+// loopback_handshakes with --key_exchange_pool_size.
+//
+// Connection options under evaluation can be compared over loopback with
+// --connection_options, e.g. AKDB for ack thinning, which lowers
+// client_packets_sent of loopback_bulk_transfer.
+//
+// Benchmarks of other areas live in quic_simulator_benchmark,
+// quic_crypto_benchmark and quic_load_balancer_benchmark.
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "quiche/quic/core/crypto/quic_client_session_cache.h"
+#include "quiche/quic/core/io/quic_default_event_loop.h"
+#include "quiche/quic/core/io/quic_event_loop.h"
+#include "quiche/quic/core/quic_default_clock.h"
+#include "quiche/quic/core/quic_connection_stats.h"
+#include "quiche/quic/core/quic_server_id.h"
+#include "quiche/quic/core/quic_tag.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/core/quic_types.h"
+#include "quiche/quic/core/quic_versions.h"
+#include "quiche/quic/platform/api/quic_flags.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/platform/api/quic_test_loopback.h"
+#include "quiche/quic/test_tools/crypto_test_utils.h"
+#include "quiche/quic/test_tools/quic_benchmark_utils.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+#include "quiche/quic/test_tools/server_thread.h"
+#include "quiche/quic/tools/file_backed_client_session_cache.h"
+#include "quiche/quic/tools/quic_default_client.h"
+#include "quiche/quic/tools/quic_file_backed_cache_backend.h"
+#include "quiche/quic/tools/quic_memory_cache_backend.h"
+#include "quiche/quic/tools/quic_server.h"
+#include "quiche/quic/tools/quic_simple_server_backend.h"
+#include "quiche/common/platform/api/quiche_command_line_flags.h"
+#include "quiche/common/platform/api/quiche_file_utils.h"
+#include "quiche/common/platform/api/quiche_mem_slice.h"
+#include "quiche/spdy/core/http2_header_block.h"
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    std::string, benchmarks, "",
+    "Comma-separated list of benchmarks to run. If empty, all benchmarks are "
+    "run.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    std::string, quic_version, "",
+    "QUIC versions to use for the loopback benchmarks, e.g. \"h3\". If not "
+    "set, all currently supported versions are offered.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    std::string, connection_options, "",
+    "Connection options sent by the clients of the loopback benchmarks, e.g. "
+    "\"AKDB\" to ack once per read burst.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, bulk_transfer_mb, 100,
+    "Size of the response body of the bulk transfer benchmarks, in MiB.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(int32_t, num_handshakes, 500,
+                                "Number of handshakes to perform.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, key_exchange_pool_size, 0,
+    "If positive, the loopback server takes the ephemeral key pairs of its "
+    "handshakes from a pool of this size, see "
+    "--quic_server_key_exchange_pool_size.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, num_requests, 5000,
+    "Number of requests to send in the request/response benchmarks.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, small_response_size, 100,
+    "Size of the response body of the request/response benchmarks.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, small_message_size, 64,
+    "Size of the messages of the small messages benchmark.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, cache_corpus_mb, 256,
+    "Total size of the response bodies of the cache corpus benchmarks, in "
+    "MiB.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, cache_corpus_files, 64,
+    "Number of files of the cache corpus benchmarks.");
+
+namespace quic {
+namespace test {
+namespace {
+
+constexpr char kBulkPath[] = "/bulk";
+constexpr char kSmallPath[] = "/small";
+
+ParsedQuicVersionVector BenchmarkVersions() {
+  const std::string versions =
+      quiche::GetQuicheCommandLineFlag(FLAGS_quic_version);
+  if (versions.empty()) {
+    return CurrentSupportedVersions();
+  }
+  return ParseQuicVersionVectorString(versions);
+}
+
+QuicByteCount BulkTransferBytes() {
+  return static_cast<QuicByteCount>(
+             quiche::GetQuicheCommandLineFlag(FLAGS_bulk_transfer_mb))
+         << 20;
+}
+
+spdy::Http2HeaderBlock RequestHeaders(absl::string_view path) {
+  spdy::Http2HeaderBlock headers;
+  headers[":method"] = "GET";
+  headers[":scheme"] = "https";
+  headers[":authority"] = crypto_test_utils::CertificateHostnameForTesting();
+  headers[":path"] = path;
+  return headers;
+}
+
+// A QuicServer serving kBulkPath and kSmallPath from memory, or the responses
+// of an initialized |backend|, on a loopback port, running on its own thread.
+class LoopbackServer {
+ public:
+  LoopbackServer(const ParsedQuicVersionVector& versions,
+                 std::unique_ptr<QuicSimpleServerBackend> backend)
+      : backend_(std::move(backend)) {
+    if (backend_ == nullptr) {
+      auto memory_cache = std::make_unique<QuicMemoryCacheBackend>();
+      const std::string host =
+          crypto_test_utils::CertificateHostnameForTesting();
+      memory_cache->AddSimpleResponse(host, kBulkPath, 200,
+                                      std::string(BulkTransferBytes(), 'b'));
+      memory_cache->AddSimpleResponse(
+          host, kSmallPath, 200,
+          std::string(
+              quiche::GetQuicheCommandLineFlag(FLAGS_small_response_size),
+              's'));
+      backend_ = std::move(memory_cache);
+    }
+    auto server = std::make_unique<QuicServer>(
+        crypto_test_utils::ProofSourceForTesting(), backend_.get(), versions);
+    thread_ = std::make_unique<ServerThread>(
+        std::move(server), QuicSocketAddress(TestLoopback(), 0));
+    thread_->Initialize();
+    thread_->Start();
+  }
+
+  ~LoopbackServer() {
+    thread_->Quit();
+    thread_->Join();
+  }
+
+  QuicSocketAddress address() {
+    return QuicSocketAddress(TestLoopback(), thread_->GetPort());
+  }
+
+ private:
+  std::unique_ptr<QuicSimpleServerBackend> backend_;
+  std::unique_ptr<ServerThread> thread_;
+};
+
+// Base class of the loopback benchmarks: owns the server and the client event
+// loop.
+class LoopbackBenchmark {
+ public:
+  explicit LoopbackBenchmark(
+      std::unique_ptr<QuicSimpleServerBackend> backend = nullptr)
+      : versions_(BenchmarkVersions()),
+        server_(versions_, std::move(backend)),
+        event_loop_(GetDefaultEventLoop()->Create(QuicDefaultClock::Get())) {}
+
+ protected:
+  // Returns an initialized, but not yet connected client.
+  std::unique_ptr<QuicDefaultClient> CreateClient(
+      std::unique_ptr<SessionCache> session_cache = nullptr) {
+    const QuicSocketAddress address = server_.address();
+    QuicServerId server_id(crypto_test_utils::CertificateHostnameForTesting(),
+                           address.port(), false);
+    auto client = std::make_unique<QuicDefaultClient>(
+        address, server_id, versions_, event_loop_.get(),
+        crypto_test_utils::ProofVerifierForTesting(), std::move(session_cache));
+    const std::string connection_options =
+        quiche::GetQuicheCommandLineFlag(FLAGS_connection_options);
+    if (!connection_options.empty()) {
+      client->config()->SetConnectionOptionsToSend(
+          ParseQuicTagVector(connection_options));
+    }
+    if (!client->Initialize()) {
+      QUIC_LOG(ERROR) << "Failed to initialize client";
+      return nullptr;
+    }
+    return client;
+  }
+
+  std::unique_ptr<QuicDefaultClient> CreateConnectedClient(
+      std::unique_ptr<SessionCache> session_cache = nullptr) {
+    std::unique_ptr<QuicDefaultClient> client =
+        CreateClient(std::move(session_cache));
+    if (client == nullptr || !client->Connect()) {
+      QUIC_LOG(ERROR) << "Failed to connect to " << server_.address();
+      return nullptr;
+    }
+    return client;
+  }
+
+  ParsedQuicVersionVector versions_;
+  LoopbackServer server_;
+  std::unique_ptr<QuicEventLoop> event_loop_;
+};
+
+// Downloads a single large response over one connection.
+class LoopbackBulkTransferBenchmark : public LoopbackBenchmark {
+ public:
+  bool Run() {
+    std::unique_ptr<QuicDefaultClient> client = CreateConnectedClient();
+    if (client == nullptr) {
+      return false;
+    }
+    client->set_store_response(true);
+    QuicBenchmarkTimer timer;
+    timer.Start();
+    client->SendRequestAndWaitForResponse(RequestHeaders(kBulkPath), "",
+                                          /*fin=*/true);
+    timer.Stop();
+    const QuicByteCount bytes = client->latest_response_body().size();
+    if (bytes != BulkTransferBytes()) {
+      QUIC_LOG(ERROR) << "Received " << bytes << " bytes, expected "
+                      << BulkTransferBytes();
+      return false;
+    }
+    // The client mostly sends acks.
+    const QuicConnectionStats& stats =
+        client->session()->connection()->GetStats();
+    PrintBenchmarkResult(
+        QuicBenchmarkResult("loopback_bulk_transfer")
+            .AddMetric("bytes", bytes)
+            .AddTimer(timer)
+            .AddMetric("gbps", bytes * 8.0 / timer.wall_seconds() / 1e9)
+            .AddMetric("gbps_per_core",
+                       bytes * 8.0 / timer.cpu_seconds() / 1e9)
+            .AddMetric("client_packets_received", stats.packets_received)
+            .AddMetric("client_packets_sent", stats.packets_sent)
+            .AddMetric("client_packets_sent_per_second",
+                       stats.packets_sent / timer.wall_seconds()));
+    client->Disconnect();
+    return true;
+  }
+};
+
+// Performs a full handshake through the server's QuicDispatcher on a new
+// connection, then closes it, repeatedly.
+class LoopbackHandshakeBenchmark : public LoopbackBenchmark {
+ public:
+  bool Run() {
+    const int num_handshakes =
+        quiche::GetQuicheCommandLineFlag(FLAGS_num_handshakes);
+    QuicBenchmarkTimer timer;
+    timer.Start();
+    for (int i = 0; i < num_handshakes; ++i) {
+      std::unique_ptr<QuicDefaultClient> client = CreateConnectedClient();
+      if (client == nullptr) {
+        return false;
+      }
+      client->Disconnect();
+    }
+    timer.Stop();
+    PrintBenchmarkResult(
+        QuicBenchmarkResult("loopback_handshakes")
+            .AddMetric("handshakes", num_handshakes)
+            .AddTimer(timer)
+            .AddMetric("handshakes_per_second",
+                       num_handshakes / timer.wall_seconds())
+            .AddMetric("handshakes_per_core_second",
+                       num_handshakes / timer.cpu_seconds())
+            .AddMetric("mean_handshake_us",
+                       timer.wall_seconds() * 1e6 / num_handshakes));
+    return true;
+  }
+};
+
+// Sends small HTTP requests sequentially over one connection.
+class LoopbackRequestResponseBenchmark : public LoopbackBenchmark {
+ public:
+  bool Run() {
+    std::unique_ptr<QuicDefaultClient> client = CreateConnectedClient();
+    if (client == nullptr) {
+      return false;
+    }
+    client->set_store_response(true);
+    const int num_requests =
+        quiche::GetQuicheCommandLineFlag(FLAGS_num_requests);
+    const spdy::Http2HeaderBlock headers = RequestHeaders(kSmallPath);
+    QuicBenchmarkTimer timer;
+    timer.Start();
+    for (int i = 0; i < num_requests; ++i) {
+      client->SendRequestAndWaitForResponse(headers, "", /*fin=*/true);
+      if (client->latest_response_code() != 200) {
+        QUIC_LOG(ERROR) << "Request " << i << " failed with status "
+                        << client->latest_response_code();
+        return false;
+      }
+    }
+    timer.Stop();
+    PrintBenchmarkResult(
+        QuicBenchmarkResult("loopback_request_response")
+            .AddMetric("requests", num_requests)
+            .AddMetric("response_size",
+                       quiche::GetQuicheCommandLineFlag(
+                           FLAGS_small_response_size))
+            .AddTimer(timer)
+            .AddMetric("requests_per_second",
+                       num_requests / timer.wall_seconds())
+            .AddMetric("requests_per_core_second",
+                       num_requests / timer.cpu_seconds())
+            .AddMetric("mean_latency_us",
+                       timer.wall_seconds() * 1e6 / num_requests));
+    client->Disconnect();
+    return true;
+  }
+};
+
+// Answers every request like a gRPC server streaming small messages: each
+// message is sent with one SendResponseBody() call of two slices, its 5-byte
+// length prefix and its payload, and the response ends with trailers.
+class SmallMessageBackend : public QuicSimpleServerBackend {
+ public:
+  // QuicSimpleServerBackend implementation.
+  bool InitializeBackend(const std::string& /*backend_url*/) override {
+    return true;
+  }
+  bool IsBackendInitialized() const override { return true; }
+  void FetchResponseFromBackend(
+      const spdy::Http2HeaderBlock& /*request_headers*/,
+      const std::string& /*request_body*/,
+      RequestHandler* request_handler) override {
+    const int message_size =
+        quiche::GetQuicheCommandLineFlag(FLAGS_small_message_size);
+    const std::string prefix({0, static_cast<char>(message_size >> 24),
+                              static_cast<char>(message_size >> 16),
+                              static_cast<char>(message_size >> 8),
+                              static_cast<char>(message_size)});
+    const std::string message(message_size, 'm');
+    spdy::Http2HeaderBlock headers;
+    headers[":status"] = "200";
+    headers["content-type"] = "application/grpc";
+    request_handler->SendResponseHeaders(std::move(headers), /*fin=*/false);
+    for (int i = 0; i < kMessagesPerResponse; ++i) {
+      quiche::QuicheMemSlice slices[] = {MemSliceFromString(prefix),
+                                         MemSliceFromString(message)};
+      // The responses are small enough to ignore backpressure.
+      request_handler->SendResponseBody(absl::MakeSpan(slices),
+                                        /*fin=*/false);
+    }
+    spdy::Http2HeaderBlock trailers;
+    trailers["grpc-status"] = "0";
+    request_handler->SendResponseTrailers(std::move(trailers));
+  }
+  void CloseBackendResponseStream(
+      RequestHandler* /*request_handler*/) override {}
+
+  static constexpr int kMessagesPerResponse = 10;
+};
+
+// Sends requests sequentially over one connection to SmallMessageBackend, with
+// and without --quic_coalesce_http3_data_frames. Coalescing sends one DATA
+// frame per message instead of two, which shows in the bytes received per
+// request.
+class LoopbackSmallMessagesBenchmark : public LoopbackBenchmark {
+ public:
+  explicit LoopbackSmallMessagesBenchmark(bool coalesce)
+      : LoopbackBenchmark(std::make_unique<SmallMessageBackend>()),
+        coalesce_(coalesce) {}
+
+  bool Run() {
+    std::unique_ptr<QuicDefaultClient> client = CreateConnectedClient();
+    if (client == nullptr) {
+      return false;
+    }
+    client->set_store_response(true);
+    const int num_requests =
+        quiche::GetQuicheCommandLineFlag(FLAGS_num_requests);
+    const spdy::Http2HeaderBlock headers = RequestHeaders(kSmallPath);
+    const QuicConnectionStats& stats =
+        client->session()->connection()->GetStats();
+    const QuicByteCount bytes_received_before = stats.bytes_received;
+    const QuicPacketCount packets_received_before = stats.packets_received;
+    QuicBenchmarkTimer timer;
+    timer.Start();
+    for (int i = 0; i < num_requests; ++i) {
+      client->SendRequestAndWaitForResponse(headers, "", /*fin=*/true);
+      if (client->latest_response_code() != 200) {
+        QUIC_LOG(ERROR) << "Request " << i << " failed with status "
+                        << client->latest_response_code();
+        return false;
+      }
+    }
+    timer.Stop();
+    PrintBenchmarkResult(
+        QuicBenchmarkResult(coalesce_ ? "loopback_small_messages_coalesced"
+                                      : "loopback_small_messages")
+            .AddMetric("requests", num_requests)
+            .AddMetric("messages_per_response",
+                       SmallMessageBackend::kMessagesPerResponse)
+            .AddMetric("message_size", quiche::GetQuicheCommandLineFlag(
+                                           FLAGS_small_message_size))
+            .AddTimer(timer)
+            .AddMetric("requests_per_second",
+                       num_requests / timer.wall_seconds())
+            .AddMetric("requests_per_core_second",
+                       num_requests / timer.cpu_seconds())
+            .AddMetric("client_bytes_received_per_request",
+                       static_cast<double>(stats.bytes_received -
+                                           bytes_received_before) /
+                           num_requests)
+            .AddMetric("client_packets_received_per_request",
+                       static_cast<double>(stats.packets_received -
+                                           packets_received_before) /
+                           num_requests));
+    client->Disconnect();
+    return true;
+  }
+
+ private:
+  const bool coalesce_;
+};
+
+bool RunSmallMessages() {
+  const bool coalesce_data_frames =
+      GetQuicFlag(quic_coalesce_http3_data_frames);
+  bool ok = true;
+  for (const bool coalesce : {true, false}) {
+    // Set before the server starts, as its thread reads the flag.
+    SetQuicFlag(quic_coalesce_http3_data_frames, coalesce);
+    ok = LoopbackSmallMessagesBenchmark(coalesce).Run() && ok;
+  }
+  SetQuicFlag(quic_coalesce_http3_data_frames, coalesce_data_frames);
+  return ok;
+}
+
+// Restarts a client over and over. Every restart creates a new session cache
+// and client, which connects and sends one small request. The sessions of
+// QuicClientSessionCache are lost on restart, so every connection performs a
+// full handshake. FileBackedClientSessionCache resumes the session of the
+// previous run, and the request is sent as 0-RTT data.
+class LoopbackResumptionBenchmark : public LoopbackBenchmark {
+ public:
+  bool Run() {
+    const std::string path =
+        absl::StrCat("/tmp/quic_benchmark_session_cache_", getpid());
+    const bool ok =
+        RunRestarts("memory",
+                    []() -> std::unique_ptr<SessionCache> {
+                      return std::make_unique<QuicClientSessionCache>();
+                    }) &&
+        RunRestarts("file", [&path]() -> std::unique_ptr<SessionCache> {
+          return FileBackedClientSessionCache::Create(
+              path, /*max_entries=*/1024, QuicTime::Delta::FromSeconds(1),
+              QuicDefaultClock::Get());
+        });
+    for (const char* suffix : {"", ".lock"}) {
+      unlink(absl::StrCat(path, suffix).c_str());
+    }
+    return ok;
+  }
+
+ private:
+  bool RunRestarts(
+      absl::string_view session_cache,
+      const std::function<std::unique_ptr<SessionCache>()>& create_cache) {
+    const int num_restarts =
+        quiche::GetQuicheCommandLineFlag(FLAGS_num_handshakes);
+    const spdy::Http2HeaderBlock headers = RequestHeaders(kSmallPath);
+    const QuicClock* clock = QuicDefaultClock::Get();
+    QuicTime::Delta total_latency = QuicTime::Delta::Zero();
+    int early_data_accepted = 0;
+    QuicBenchmarkTimer timer;
+    timer.Start();
+    // The first run only fills the session cache.
+    for (int i = 0; i <= num_restarts; ++i) {
+      const QuicTime start = clock->Now();
+      std::unique_ptr<SessionCache> cache = create_cache();
+      if (cache == nullptr) {
+        return false;
+      }
+      std::unique_ptr<QuicDefaultClient> client =
+          CreateConnectedClient(std::move(cache));
+      if (client == nullptr) {
+        return false;
+      }
+      client->set_store_response(true);
+      client->SendRequestAndWaitForResponse(headers, "", /*fin=*/true);
+      if (client->latest_response_code() != 200) {
+        QUIC_LOG(ERROR) << "Request failed with status "
+                        << client->latest_response_code();
+        return false;
+      }
+      if (i > 0) {
+        total_latency = total_latency + (clock->Now() - start);
+        early_data_accepted += client->EarlyDataAccepted() ? 1 : 0;
+      }
+      client->Disconnect();
+    }
+    timer.Stop();
+    PrintBenchmarkResult(
+        QuicBenchmarkResult(
+            absl::StrCat("loopback_resumption_", session_cache))
+            .AddMetric("restarts", num_restarts)
+            .AddTimer(timer)
+            .AddMetric("mean_time_to_first_response_us",
+                       total_latency.ToMicroseconds() /
+                           static_cast<double>(num_restarts))
+            .AddMetric("early_data_accepted_fraction",
+                       early_data_accepted /
+                           static_cast<double>(num_restarts)));
+    return true;
+  }
+};
+
+// Sends small HTTP requests sequentially over one connection whose endpoints
+// update their keys every kKeyUpdatePackets packets, with and without
+// --quic_prepare_next_one_rtt_keys. Key updates which derive their keys on the
+// packet path show up in the tail latency.
+class LoopbackKeyUpdateBenchmark : public LoopbackBenchmark {
+ public:
+  bool Run() {
+    const uint64_t key_update_limit =
+        GetQuicFlag(quic_key_update_confidentiality_limit);
+    const bool prepare_next_keys = GetQuicFlag(quic_prepare_next_one_rtt_keys);
+    SetQuicFlag(quic_key_update_confidentiality_limit, kKeyUpdatePackets);
+    bool ok = true;
+    for (const bool prepare : {true, false}) {
+      SetQuicFlag(quic_prepare_next_one_rtt_keys, prepare);
+      ok = ok && RunRequests(prepare);
+    }
+    SetQuicFlag(quic_key_update_confidentiality_limit, key_update_limit);
+    SetQuicFlag(quic_prepare_next_one_rtt_keys, prepare_next_keys);
+    return ok;
+  }
+
+ private:
+  static constexpr uint64_t kKeyUpdatePackets = 100;
+
+  bool RunRequests(bool prepare) {
+    std::unique_ptr<QuicDefaultClient> client = CreateConnectedClient();
+    if (client == nullptr) {
+      return false;
+    }
+    client->set_store_response(true);
+    const int num_requests =
+        quiche::GetQuicheCommandLineFlag(FLAGS_num_requests);
+    const spdy::Http2HeaderBlock headers = RequestHeaders(kSmallPath);
+    const QuicClock* clock = QuicDefaultClock::Get();
+    std::vector<int64_t> latencies_us;
+    latencies_us.reserve(num_requests);
+    QuicBenchmarkTimer timer;
+    timer.Start();
+    for (int i = 0; i < num_requests; ++i) {
+      const QuicTime start = clock->Now();
+      client->SendRequestAndWaitForResponse(headers, "", /*fin=*/true);
+      if (client->latest_response_code() != 200) {
+        QUIC_LOG(ERROR) << "Request " << i << " failed with status "
+                        << client->latest_response_code();
+        return false;
+      }
+      latencies_us.push_back((clock->Now() - start).ToMicroseconds());
+    }
+    timer.Stop();
+    std::sort(latencies_us.begin(), latencies_us.end());
+    auto percentile = [&latencies_us](double fraction) {
+      return latencies_us[static_cast<size_t>(fraction *
+                                              (latencies_us.size() - 1))];
+    };
+    const QuicConnectionStats& stats =
+        client->session()->connection()->GetStats();
+    PrintBenchmarkResult(
+        QuicBenchmarkResult(prepare ? "loopback_key_updates_prepared"
+                                    : "loopback_key_updates_on_packet_path")
+            .AddMetric("requests", num_requests)
+            .AddTimer(timer)
+            .AddMetric("key_updates", stats.key_update_count)
+            .AddMetric("key_updates_with_prepared_keys",
+                       stats.num_key_updates_with_prepared_keys)
+            .AddMetric("max_packets_encrypted_in_key_phase",
+                       stats.max_packets_encrypted_in_key_phase)
+            .AddMetric("mean_latency_us",
+                       timer.wall_seconds() * 1e6 / num_requests)
+            .AddMetric("p50_latency_us", percentile(0.5))
+            .AddMetric("p99_latency_us", percentile(0.99))
+            .AddMetric("p999_latency_us", percentile(0.999))
+            .AddMetric("max_latency_us", latencies_us.back()));
+    client->Disconnect();
+    return true;
+  }
+};
+
+// Returns a field of /proc/self/status in MiB: RssAnon is the heap and other
+// private memory, RssFile the pages of mapped files, which the kernel reclaims
+// under memory pressure.
+double ResidentMiB(absl::string_view field) {
+  absl::optional<std::string> status =
+      quiche::ReadFileContents("/proc/self/status");
+  if (!status.has_value()) {
+    return 0;
+  }
+  for (absl::string_view line : absl::StrSplit(*status, '\n')) {
+    if (!absl::ConsumePrefix(&line, field) ||
+        !absl::ConsumePrefix(&line, ":")) {
+      continue;
+    }
+    line = absl::StripAsciiWhitespace(line);
+    absl::ConsumeSuffix(&line, " kB");
+    int64_t kib = 0;
+    return absl::SimpleAtoi(line, &kib) ? kib / 1024.0 : 0;
+  }
+  return 0;
+}
+
+// A cache directory in the format of `wget -p --save-headers`, made of
+// --cache_corpus_files files which add up to --cache_corpus_mb MiB of bodies.
+// The directory is removed on destruction.
+class CacheCorpus {
+ public:
+  CacheCorpus()
+      : directory_(
+            absl::StrCat("/tmp/quic_benchmark_cache_corpus_", getpid())),
+        host_directory_(quiche::JoinPath(
+            directory_, crypto_test_utils::CertificateHostnameForTesting())) {
+    const int num_files = std::max(
+        1, quiche::GetQuicheCommandLineFlag(FLAGS_cache_corpus_files));
+    body_size_ = (static_cast<size_t>(quiche::GetQuicheCommandLineFlag(
+                      FLAGS_cache_corpus_mb))
+                  << 20) /
+                 num_files;
+    if (mkdir(directory_.c_str(), 0700) != 0 ||
+        mkdir(host_directory_.c_str(), 0700) != 0) {
+      QUIC_LOG(ERROR) << "Failed to create " << host_directory_;
+      return;
+    }
+    const std::string chunk(1 << 20, 'c');
+    for (int i = 0; i < num_files; ++i) {
+      const std::string path = absl::StrCat("/file", i);
+      FILE* file = fopen((host_directory_ + path).c_str(), "wb");
+      if (file == nullptr) {
+        QUIC_LOG(ERROR) << "Failed to create " << host_directory_ << path;
+        return;
+      }
+      paths_.push_back(path);
+      const std::string headers = absl::StrCat(
+          "HTTP/1.1 200 OK\r\ncontent-length: ", body_size_, "\r\n\r\n");
+      bool ok = fwrite(headers.data(), headers.size(), 1, file) == 1;
+      for (size_t written = 0; ok && written < body_size_;
+           written += chunk.size()) {
+        const size_t len = std::min(chunk.size(), body_size_ - written);
+        ok = fwrite(chunk.data(), len, 1, file) == 1;
+      }
+      if (fclose(file) != 0 || !ok) {
+        QUIC_LOG(ERROR) << "Failed to write " << host_directory_ << path;
+        return;
+      }
+    }
+    ok_ = true;
+  }
+
+  ~CacheCorpus() {
+    for (const std::string& path : paths_) {
+      unlink((host_directory_ + path).c_str());
+    }
+    rmdir(host_directory_.c_str());
+    rmdir(directory_.c_str());
+  }
+
+  bool ok() const { return ok_; }
+  const std::string& directory() const { return directory_; }
+  const std::vector<std::string>& paths() const { return paths_; }
+  size_t body_size() const { return body_size_; }
+
+ private:
+  const std::string directory_;
+  const std::string host_directory_;
+  std::vector<std::string> paths_;
+  size_t body_size_ = 0;
+  bool ok_ = false;
+};
+
+// Downloads every file of a CacheCorpus sequentially over one connection from
+// an initialized cache backend.
+class LoopbackCacheCorpusBenchmark : public LoopbackBenchmark {
+ public:
+  explicit LoopbackCacheCorpusBenchmark(
+      std::unique_ptr<QuicSimpleServerBackend> backend)
+      : LoopbackBenchmark(std::move(backend)) {}
+
+  // Takes the results of initializing the backend as extra metrics.
+  bool Run(QuicBenchmarkResult result, const CacheCorpus& corpus) {
+    std::unique_ptr<QuicDefaultClient> client = CreateConnectedClient();
+    if (client == nullptr) {
+      return false;
+    }
+    client->set_store_response(true);
+    QuicByteCount bytes = 0;
+    QuicBenchmarkTimer timer;
+    timer.Start();
+    for (const std::string& path : corpus.paths()) {
+      client->SendRequestAndWaitForResponse(RequestHeaders(path), "",
+                                            /*fin=*/true);
+      if (client->latest_response_code() != 200 ||
+          client->latest_response_body().size() != corpus.body_size()) {
+        QUIC_LOG(ERROR) << "Request for " << path << " failed with status "
+                        << client->latest_response_code() << " and "
+                        << client->latest_response_body().size() << " bytes";
+        return false;
+      }
+      bytes += corpus.body_size();
+    }
+    timer.Stop();
+    PrintBenchmarkResult(
+        result.AddMetric("files", corpus.paths().size())
+            .AddMetric("bytes", bytes)
+            .AddTimer(timer)
+            .AddMetric("gbps", bytes * 8.0 / timer.wall_seconds() / 1e9)
+            .AddMetric("gbps_per_core",
+                       bytes * 8.0 / timer.cpu_seconds() / 1e9)
+            .AddMetric("rss_anon_mb", ResidentMiB("RssAnon"))
+            .AddMetric("rss_file_mb", ResidentMiB("RssFile")));
+    client->Disconnect();
+    return true;
+  }
+};
+
+// Serves a CacheCorpus from QuicMemoryCacheBackend, which copies it to the
+// heap, or from QuicFileBackedCacheBackend, which maps it. backend_rss_anon_mb
+// is the heap the backend holds after initialization.
+bool RunCacheCorpus(bool file_backed) {
+  CacheCorpus corpus;
+  if (!corpus.ok()) {
+    return false;
+  }
+  const double rss_anon_before = ResidentMiB("RssAnon");
+  std::unique_ptr<QuicSimpleServerBackend> backend;
+  if (file_backed) {
+    backend = std::make_unique<QuicFileBackedCacheBackend>();
+  } else {
+    backend = std::make_unique<QuicMemoryCacheBackend>();
+  }
+  QuicBenchmarkTimer init_timer;
+  init_timer.Start();
+  if (!backend->InitializeBackend(corpus.directory())) {
+    return false;
+  }
+  init_timer.Stop();
+  QuicBenchmarkResult result(file_backed ? "loopback_cache_corpus_file_backed"
+                                         : "loopback_cache_corpus_memory");
+  result.AddMetric("init_seconds", init_timer.wall_seconds())
+      .AddMetric("backend_rss_anon_mb",
+                 ResidentMiB("RssAnon") - rss_anon_before);
+  return LoopbackCacheCorpusBenchmark(std::move(backend))
+      .Run(std::move(result), corpus);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
+
+int main(int argc, char* argv[]) {
+  const char* usage = "Usage: quic_benchmark [--benchmarks=name,...]";
+  std::vector<std::string> args =
+      quiche::QuicheParseCommandLineFlags(usage, argc, argv);
+  if (!args.empty()) {
+    quiche::QuichePrintCommandLineFlagHelp(usage);
+    return 1;
+  }
+
+  const int32_t key_exchange_pool_size =
+      quiche::GetQuicheCommandLineFlag(FLAGS_key_exchange_pool_size);
+  if (key_exchange_pool_size > 0) {
+    SetQuicFlag(quic_server_key_exchange_pool_size, key_exchange_pool_size);
+  }
+
+  using quic::test::QuicBenchmark;
+  const std::vector<QuicBenchmark> benchmarks = {
+      {"loopback_bulk_transfer",
+       []() { return quic::test::LoopbackBulkTransferBenchmark().Run(); }},
+      {"loopback_handshakes",
+       []() { return quic::test::LoopbackHandshakeBenchmark().Run(); }},
+      {"loopback_request_response",
+       []() { return quic::test::LoopbackRequestResponseBenchmark().Run(); }},
+      {"loopback_small_messages", quic::test::RunSmallMessages},
+      {"loopback_resumption",
+       []() { return quic::test::LoopbackResumptionBenchmark().Run(); }},
+      {"loopback_key_updates",
+       []() { return quic::test::LoopbackKeyUpdateBenchmark().Run(); }},
+      {"loopback_cache_corpus_memory",
+       []() { return quic::test::RunCacheCorpus(/*file_backed=*/false); }},
+      {"loopback_cache_corpus_file_backed",
+       []() { return quic::test::RunCacheCorpus(/*file_backed=*/true); }},
+  };
+  const int failures = quic::test::RunBenchmarks(
+      benchmarks, quiche::GetQuicheCommandLineFlag(FLAGS_benchmarks));
+  return failures == 0 ? 0 : 1;
+}
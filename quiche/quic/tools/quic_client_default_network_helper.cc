@@ -221,6 +221,18 @@ void QuicClientDefaultNetworkHelper::ProcessPacket(
   client_->session()->ProcessUdpPacket(self_address, peer_address, packet);
 }
 
+void QuicClientDefaultNetworkHelper::OnReadBurstStart() {
+  if (client_->session() != nullptr) {
+    client_->session()->connection()->OnReadBurstStart();
+  }
+}
+
+void QuicClientDefaultNetworkHelper::OnReadBurstEnd() {
+  if (client_->session() != nullptr) {
+    client_->session()->connection()->OnReadBurstEnd();
+  }
+}
+
 int QuicClientDefaultNetworkHelper::CreateUDPSocket(
     QuicSocketAddress server_address, bool* overflow_supported) {
   QuicUdpSocketApi api;
@@ -46,6 +46,8 @@ class QuicClientDefaultNetworkHelper : public QuicClientBase::NetworkHelper,
   void ProcessPacket(const QuicSocketAddress& self_address,
                      const QuicSocketAddress& peer_address,
                      const QuicReceivedPacket& packet) override;
+  void OnReadBurstStart() override;
+  void OnReadBurstEnd() override;
 
   // From NetworkHelper.
   void RunEventLoop() override;
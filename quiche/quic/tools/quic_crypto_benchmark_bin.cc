@@ -0,0 +1,510 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Micro benchmarks of the cryptographic components of QUIC servers and
+// clients. Every benchmark prints one line of JSON with its results to stdout,
+// e.g.
+//   quic_crypto_benchmark --benchmarks=aead_throughput,server_key_exchanges
+//
+// server_key_exchanges, anti_replay_lookups and server_config_lookups measure
+// the ephemeral key exchange pool, the 0-RTT anti-replay cache and the config
+// lookups of CHLO validation on the handshake path of a server.
+// proof_verification_cache measures the certificate verification cache of
+// clients. aead_throughput measures the AEADs between which
+// --quic_tls_server_cipher_suite_policy chooses.
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "quiche/quic/core/crypto/caching_proof_verifier.h"
+#include "quiche/quic/core/crypto/certificate_util.h"
+#include "quiche/quic/core/crypto/certificate_view.h"
+#include "quiche/quic/core/crypto/cipher_suite_policy.h"
+#include "quiche/quic/core/crypto/crypto_protocol.h"
+#include "quiche/quic/core/crypto/ephemeral_key_exchange_pool.h"
+#include "quiche/quic/core/crypto/key_exchange.h"
+#include "quiche/quic/core/crypto/proof_verifier.h"
+#include "quiche/quic/core/crypto/quic_crypto_server_config.h"
+#include "quiche/quic/core/crypto/quic_random.h"
+#include "quiche/quic/core/quic_default_clock.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+#include "quiche/quic/platform/api/quic_thread.h"
+#include "quiche/quic/test_tools/crypto_test_utils.h"
+#include "quiche/quic/test_tools/quic_benchmark_utils.h"
+#include "quiche/quic/test_tools/quic_crypto_server_config_peer.h"
+#include "quiche/quic/tools/shared_anti_replay_cache.h"
+#include "quiche/common/platform/api/quiche_command_line_flags.h"
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    std::string, benchmarks, "",
+    "Comma-separated list of benchmarks to run. If empty, all benchmarks are "
+    "run.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, num_handshakes, 500,
+    "Number of handshakes of the server_key_exchanges benchmark.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, num_threads, 8,
+    "Number of threads of the multi-threaded micro benchmarks.");
+
+namespace quic {
+namespace test {
+namespace {
+
+// Reports the packet protection throughput of the AEADs of QUIC version 1 on
+// this CPU for a range of packet sizes, and which AEAD the cipher suite
+// policies of TLS servers prefer.
+bool RunAeadThroughput() {
+  InitializeMeasuredAeadThroughput();
+  const QuicTime::Delta duration = QuicTime::Delta::FromMilliseconds(200);
+  for (size_t packet_size : {50u, 100u, 500u, 1000u, 1250u, 1452u}) {
+    const AeadThroughput throughput =
+        MeasureAeadThroughput(QuicDefaultClock::Get(), packet_size, duration);
+    if (throughput.aes_128_gcm_bytes_per_second == 0 ||
+        throughput.chacha20_poly1305_bytes_per_second == 0) {
+      QUIC_LOG(ERROR) << "Failed to measure the AEAD throughput";
+      return false;
+    }
+    PrintBenchmarkResult(
+        QuicBenchmarkResult("aead_throughput")
+            .AddMetric("packet_size", packet_size)
+            .AddMetric("aes_128_gcm_gbps",
+                       throughput.aes_128_gcm_bytes_per_second * 8 / 1e9)
+            .AddMetric("chacha20_poly1305_gbps",
+                       throughput.chacha20_poly1305_bytes_per_second * 8 / 1e9)
+            .AddMetric("cpu_features_prefer_aes_gcm",
+                       CipherSuitePolicyPrefersAesGcm(
+                           CipherSuitePolicy::kCpuFeatures))
+            .AddMetric("measured_throughput_prefers_aes_gcm",
+                       CipherSuitePolicyPrefersAesGcm(
+                           CipherSuitePolicy::kMeasuredThroughput)));
+  }
+  return true;
+}
+
+// Compares the elliptic curve work done on the handshake thread of a QUIC
+// crypto server, for a forward secure key exchange per handshake, without and
+// with an EphemeralKeyExchangePool.
+bool RunServerKeyExchanges() {
+  const int num_handshakes =
+      quiche::GetQuicheCommandLineFlag(FLAGS_num_handshakes);
+  QuicRandom* rand = QuicRandom::GetInstance();
+  std::unique_ptr<SynchronousKeyExchange> client =
+      CreateLocalSynchronousKeyExchange(kC255, rand);
+  EphemeralKeyExchangePool pool({kC255}, /*capacity=*/256, rand);
+  pool.Refill();
+  pool.StartRefillThread();
+
+  QuicBenchmarkTimer timers[2];
+  for (int i = 0; i < 2; ++i) {
+    timers[i].Start();
+    for (int j = 0; j < num_handshakes; ++j) {
+      std::unique_ptr<SynchronousKeyExchange> server =
+          i == 0 ? CreateLocalSynchronousKeyExchange(kC255, rand)
+                 : pool.Take(kC255);
+      std::string shared_key;
+      if (!server->CalculateSharedKeySync(client->public_value(),
+                                          &shared_key)) {
+        QUIC_LOG(ERROR) << "Key exchange failed";
+        return false;
+      }
+    }
+    timers[i].Stop();
+  }
+  PrintBenchmarkResult(
+      QuicBenchmarkResult("server_key_exchanges")
+          .AddMetric("handshakes", num_handshakes)
+          .AddMetric("baseline_per_core_second",
+                     num_handshakes / timers[0].thread_cpu_seconds())
+          .AddMetric("pooled_per_core_second",
+                     num_handshakes / timers[1].thread_cpu_seconds())
+          .AddMetric("pooled_process_cpu_seconds", timers[1].cpu_seconds())
+          .AddMetric("pool_misses", pool.misses()));
+  return true;
+}
+
+class AntiReplayLookupThread : public QuicThread {
+ public:
+  AntiReplayLookupThread(SharedAntiReplayCache* cache, int id,
+                         int num_lookups)
+      : QuicThread("AntiReplayLookupThread"),
+        cache_(cache),
+        id_(id),
+        num_lookups_(num_lookups) {}
+
+  int rejected() const { return rejected_; }
+
+ protected:
+  void Run() override {
+    // Tickets are around 200 bytes.
+    std::string ticket(200, 'x');
+    for (int i = 0; i < num_lookups_; ++i) {
+      absl::StrAppend(&ticket, id_, "-", i);
+      if (!cache_->CheckAndInsert(ticket)) {
+        ++rejected_;
+      }
+      ticket.resize(200);
+    }
+  }
+
+ private:
+  SharedAntiReplayCache* cache_;
+  const int id_;
+  const int num_lookups_;
+  int rejected_ = 0;
+};
+
+// Measures the throughput of the 0-RTT anti-replay cache under contention, with
+// as many distinct tickets as a busy server sees in one window.
+bool RunAntiReplayLookups() {
+  const int num_threads = quiche::GetQuicheCommandLineFlag(FLAGS_num_threads);
+  const int lookups_per_thread = 1000000;
+  QuicDefaultClock* clock = QuicDefaultClock::Get();
+  std::unique_ptr<SharedAntiReplayCache> cache = SharedAntiReplayCache::Create(
+      /*num_words=*/size_t{1} << 24, SharedAntiReplayCache::kDefaultWindow,
+      clock);
+  std::vector<std::unique_ptr<AntiReplayLookupThread>> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.push_back(std::make_unique<AntiReplayLookupThread>(
+        cache.get(), i, lookups_per_thread));
+  }
+  QuicBenchmarkTimer timer;
+  timer.Start();
+  for (auto& thread : threads) {
+    thread->Start();
+  }
+  int rejected = 0;
+  for (auto& thread : threads) {
+    thread->Join();
+    rejected += thread->rejected();
+  }
+  timer.Stop();
+  const double lookups = static_cast<double>(num_threads) * lookups_per_thread;
+  PrintBenchmarkResult(QuicBenchmarkResult("anti_replay_lookups")
+                           .AddMetric("threads", num_threads)
+                           .AddMetric("lookups", lookups)
+                           .AddTimer(timer)
+                           .AddMetric("lookups_per_second",
+                                      lookups / timer.wall_seconds())
+                           .AddMetric("false_positive_rate",
+                                      rejected / lookups));
+  return true;
+}
+
+class ConfigLookupThread : public QuicThread {
+ public:
+  // If |under_lock| is true, every lookup holds |configs_lock_| for reading,
+  // as every config lookup did before the configs were published as
+  // snapshots.
+  ConfigLookupThread(QuicCryptoServerConfig* crypto_config,
+                     absl::string_view scid, int num_lookups, bool under_lock)
+      : QuicThread("ConfigLookupThread"),
+        peer_(crypto_config),
+        scid_(scid),
+        num_lookups_(num_lookups),
+        under_lock_(under_lock) {}
+
+  int found() const { return found_; }
+
+ protected:
+  void Run() override {
+    for (int i = 0; i < num_lookups_; ++i) {
+      if (under_lock_ ? peer_.GetCurrentConfigsUnderLock(scid_)
+                      : peer_.GetCurrentConfigs(scid_)) {
+        ++found_;
+      }
+    }
+  }
+
+ private:
+  QuicCryptoServerConfigPeer peer_;
+  const std::string scid_;
+  const int num_lookups_;
+  const bool under_lock_;
+  int found_ = 0;
+};
+
+// Compares the throughput of the config lookups of CHLOs on threads sharing
+// one QuicCryptoServerConfig, with the published snapshots and with the
+// reader lock on |configs_lock_| that every lookup took before.
+bool RunServerConfigLookups() {
+  const int num_threads = quiche::GetQuicheCommandLineFlag(FLAGS_num_threads);
+  const int lookups_per_thread = 2000000;
+  QuicCryptoServerConfig crypto_config(
+      QuicCryptoServerConfig::TESTING, QuicRandom::GetInstance(),
+      crypto_test_utils::ProofSourceForTesting(), KeyExchangeSource::Default(),
+      /*tls_session=*/false);
+  crypto_config.AddDefaultConfig(QuicRandom::GetInstance(),
+                                 QuicDefaultClock::Get(),
+                                 QuicCryptoServerConfig::ConfigOptions());
+  const std::vector<std::string> scids = crypto_config.GetConfigIds();
+  if (scids.empty()) {
+    QUIC_LOG(ERROR) << "No server config";
+    return false;
+  }
+
+  QuicBenchmarkTimer timers[2];
+  int found[2] = {0, 0};
+  for (int i = 0; i < 2; ++i) {
+    std::vector<std::unique_ptr<ConfigLookupThread>> threads;
+    for (int j = 0; j < num_threads; ++j) {
+      threads.push_back(std::make_unique<ConfigLookupThread>(
+          &crypto_config, scids[0], lookups_per_thread,
+          /*under_lock=*/i == 0));
+    }
+    timers[i].Start();
+    for (auto& thread : threads) {
+      thread->Start();
+    }
+    for (auto& thread : threads) {
+      thread->Join();
+      found[i] += thread->found();
+    }
+    timers[i].Stop();
+  }
+  const double lookups = static_cast<double>(num_threads) * lookups_per_thread;
+  if (found[0] != lookups || found[1] != lookups) {
+    QUIC_LOG(ERROR) << "Config lookup failed";
+    return false;
+  }
+  PrintBenchmarkResult(
+      QuicBenchmarkResult("server_config_lookups")
+          .AddMetric("threads", num_threads)
+          .AddMetric("lookups", lookups)
+          .AddMetric("locked_lookups_per_second",
+                     lookups / timers[0].wall_seconds())
+          .AddMetric("snapshot_lookups_per_second",
+                     lookups / timers[1].wall_seconds())
+          .AddMetric("locked_cpu_seconds", timers[0].cpu_seconds())
+          .AddMetric("snapshot_cpu_seconds", timers[1].cpu_seconds()));
+  return true;
+}
+
+// Verifies certificate chains at roughly the cost of a real verifier: it
+// parses every certificate, and checks an ECDSA signature with the leaf key,
+// standing in for the signature checks along the chain.
+class SignatureCheckingProofVerifier : public ProofVerifier {
+ public:
+  SignatureCheckingProofVerifier(std::string payload, std::string signature)
+      : payload_(std::move(payload)), signature_(std::move(signature)) {}
+
+  QuicAsyncStatus VerifyProof(
+      const std::string& /*hostname*/, const uint16_t /*port*/,
+      const std::string& /*server_config*/,
+      QuicTransportVersion /*transport_version*/,
+      absl::string_view /*chlo_hash*/,
+      const std::vector<std::string>& /*certs*/,
+      const std::string& /*cert_sct*/, const std::string& /*signature*/,
+      const ProofVerifyContext* /*context*/, std::string* error_details,
+      std::unique_ptr<ProofVerifyDetails>* /*details*/,
+      std::unique_ptr<ProofVerifierCallback> /*callback*/) override {
+    *error_details = "Not supported";
+    return QUIC_FAILURE;
+  }
+
+  QuicAsyncStatus VerifyCertChain(
+      const std::string& /*hostname*/, const uint16_t /*port*/,
+      const std::vector<std::string>& certs,
+      const std::string& /*ocsp_response*/, const std::string& /*cert_sct*/,
+      const ProofVerifyContext* /*context*/, std::string* error_details,
+      std::unique_ptr<ProofVerifyDetails>* /*details*/, uint8_t* /*out_alert*/,
+      std::unique_ptr<ProofVerifierCallback> /*callback*/) override {
+    std::unique_ptr<CertificateView> leaf;
+    for (const std::string& cert : certs) {
+      std::unique_ptr<CertificateView> view =
+          CertificateView::ParseSingleCertificate(cert);
+      if (view == nullptr) {
+        *error_details = "Failed to parse certificate";
+        return QUIC_FAILURE;
+      }
+      if (leaf == nullptr) {
+        leaf = std::move(view);
+      }
+    }
+    if (leaf == nullptr ||
+        !leaf->VerifySignature(payload_, signature_,
+                               SSL_SIGN_ECDSA_SECP256R1_SHA256)) {
+      *error_details = "Invalid signature";
+      return QUIC_FAILURE;
+    }
+    return QUIC_SUCCESS;
+  }
+
+  std::unique_ptr<ProofVerifyContext> CreateDefaultContext() override {
+    return nullptr;
+  }
+
+ private:
+  const std::string payload_;
+  const std::string signature_;
+};
+
+class CountingProofVerifierCallback : public ProofVerifierCallback {
+ public:
+  CountingProofVerifierCallback(int* completed, int* failed)
+      : completed_(completed), failed_(failed) {}
+
+  void Run(bool ok, const std::string& /*error_details*/,
+           std::unique_ptr<ProofVerifyDetails>* /*details*/) override {
+    ++*completed_;
+    if (!ok) {
+      ++*failed_;
+    }
+  }
+
+ private:
+  int* completed_;
+  int* failed_;
+};
+
+// Compares certificate chain verification of a client connecting to a few
+// backends over and over, with the plain verifier inline and through a
+// ProofVerificationCache with --num_threads worker threads. Connections are
+// opened in bursts of kBurstSize, and each backend staples its own OCSP
+// response, so the first burst coalesces concurrent misses of each backend.
+bool RunProofVerificationCache() {
+  constexpr int kNumBackends = 8;
+  constexpr int kNumConnections = 20000;
+  constexpr int kBurstSize = 100;
+  const int num_threads = quiche::GetQuicheCommandLineFlag(FLAGS_num_threads);
+  // The cache does not keep chains with an expired leaf certificate, which
+  // the test certificate is, so sign a fresh one.
+  CertificatePrivateKey key(MakeKeyPairForSelfSignedCertificate());
+  CertificateOptions options;
+  options.subject = "CN=benchmark";
+  options.serial_number = 1;
+  options.validity_start = {2020, 1, 1, 0, 0, 0};
+  options.validity_end = {2099, 12, 31, 23, 59, 59};
+  const std::string cert =
+      CreateSelfSignedCertificate(*key.private_key(), options);
+  if (cert.empty()) {
+    QUIC_LOG(ERROR) << "Failed to create a certificate";
+    return false;
+  }
+  const std::string payload = "certificate chain";
+  const std::string signature =
+      key.Sign(payload, SSL_SIGN_ECDSA_SECP256R1_SHA256);
+  auto new_verifier = [&]() {
+    return std::make_unique<SignatureCheckingProofVerifier>(payload,
+                                                            signature);
+  };
+  const std::vector<std::string> certs = {cert};
+  const std::string hostname =
+      crypto_test_utils::CertificateHostnameForTesting();
+
+  int completed = 0;
+  int failed = 0;
+  std::unique_ptr<ProofVerifier> inline_verifier = new_verifier();
+  QuicBenchmarkTimer inline_timer;
+  inline_timer.Start();
+  for (int i = 0; i < kNumConnections; ++i) {
+    std::string error_details;
+    std::unique_ptr<ProofVerifyDetails> details;
+    uint8_t alert;
+    if (inline_verifier->VerifyCertChain(
+            hostname, 443, certs, absl::StrCat("ocsp", i % kNumBackends), "",
+            nullptr, &error_details, &details, &alert,
+            nullptr) != QUIC_SUCCESS) {
+      ++failed;
+    }
+  }
+  inline_timer.Stop();
+
+  auto cache = std::make_shared<ProofVerificationCache>(
+      new_verifier, /*capacity=*/1000, QuicTime::Delta::FromSeconds(3600),
+      num_threads, QuicDefaultClock::Get());
+  std::atomic<int> wakeups{0};
+  CachingProofVerifier verifier(cache, [&wakeups]() { ++wakeups; });
+  QuicBenchmarkTimer cached_timer;
+  cached_timer.Start();
+  for (int burst = 0; burst < kNumConnections / kBurstSize; ++burst) {
+    const int expected = completed + kBurstSize;
+    for (int i = 0; i < kBurstSize; ++i) {
+      std::string error_details;
+      std::unique_ptr<ProofVerifyDetails> details;
+      uint8_t alert;
+      auto callback =
+          std::make_unique<CountingProofVerifierCallback>(&completed, &failed);
+      if (verifier.VerifyCertChain(
+              hostname, 443, certs, absl::StrCat("ocsp", i % kNumBackends),
+              "", nullptr, &error_details, &details, &alert,
+              std::move(callback)) == QUIC_SUCCESS) {
+        ++completed;
+      }
+    }
+    while (completed < expected) {
+      // Stands in for the event loop of the client, woken up by |wakeups|.
+      if (wakeups.exchange(0) == 0) {
+        absl::SleepFor(absl::Microseconds(10));
+      }
+      verifier.RunPendingCallbacks();
+    }
+  }
+  cached_timer.Stop();
+  if (failed > 0) {
+    QUIC_LOG(ERROR) << failed << " verifications failed";
+    return false;
+  }
+
+  const ProofVerificationCache::Stats stats = cache->GetStats();
+  auto mean_us = [](QuicTime::Delta total, uint64_t count) {
+    return count == 0 ? 0.0
+                      : total.ToMicroseconds() / static_cast<double>(count);
+  };
+  PrintBenchmarkResult(
+      QuicBenchmarkResult("proof_verification_cache")
+          .AddMetric("threads", num_threads)
+          .AddMetric("connections", kNumConnections)
+          .AddMetric("backends", kNumBackends)
+          .AddMetric("inline_cpu_seconds", inline_timer.cpu_seconds())
+          .AddMetric("inline_verify_us",
+                     inline_timer.wall_seconds() * 1e6 / kNumConnections)
+          .AddMetric("cached_cpu_seconds", cached_timer.cpu_seconds())
+          .AddMetric("hit_rate", stats.hit_rate())
+          .AddMetric("coalesced", stats.coalesced)
+          .AddMetric("verifications", stats.verifications)
+          .AddMetric("verify_us", mean_us(stats.total_verification_time,
+                                          stats.verifications))
+          .AddMetric("max_verify_us",
+                     stats.max_verification_time.ToMicroseconds())
+          .AddMetric("miss_latency_us",
+                     mean_us(stats.total_miss_latency, stats.misses)));
+  return true;
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
+
+int main(int argc, char* argv[]) {
+  const char* usage = "Usage: quic_crypto_benchmark [--benchmarks=name,...]";
+  std::vector<std::string> args =
+      quiche::QuicheParseCommandLineFlags(usage, argc, argv);
+  if (!args.empty()) {
+    quiche::QuichePrintCommandLineFlagHelp(usage);
+    return 1;
+  }
+
+  using quic::test::QuicBenchmark;
+  const std::vector<QuicBenchmark> benchmarks = {
+      {"aead_throughput", quic::test::RunAeadThroughput},
+      {"server_key_exchanges", quic::test::RunServerKeyExchanges},
+      {"anti_replay_lookups", quic::test::RunAntiReplayLookups},
+      {"server_config_lookups", quic::test::RunServerConfigLookups},
+      {"proof_verification_cache", quic::test::RunProofVerificationCache},
+  };
+  const int failures = quic::test::RunBenchmarks(
+      benchmarks, quiche::GetQuicheCommandLineFlag(FLAGS_benchmarks));
+  return failures == 0 ? 0 : 1;
+}
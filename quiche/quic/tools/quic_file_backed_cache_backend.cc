@@ -0,0 +1,159 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/quic_file_backed_cache_backend.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "quiche/quic/platform/api/quic_bug_tracker.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+#include "quiche/quic/tools/quic_memory_cache_backend.h"
+#include "quiche/common/platform/api/quiche_file_utils.h"
+
+namespace quic {
+
+QuicFileBackedCacheBackend::QuicFileBackedCacheBackend() = default;
+
+QuicFileBackedCacheBackend::~QuicFileBackedCacheBackend() {
+  // Responses refer to the mappings.
+  responses_.clear();
+  for (const Mapping& mapping : mappings_) {
+    munmap(const_cast<char*>(mapping.data), mapping.size);
+  }
+}
+
+const QuicBackendResponse* QuicFileBackedCacheBackend::GetResponse(
+    absl::string_view host, absl::string_view path) const {
+  auto it = responses_.find(GetKey(host, path));
+  if (it == responses_.end()) {
+    QUIC_DVLOG(1) << "Get response for resource failed: host " << host
+                  << " path " << path;
+    return nullptr;
+  }
+  return it->second.get();
+}
+
+absl::string_view QuicFileBackedCacheBackend::MapFile(
+    const std::string& file_name) {
+  int fd = open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    QUIC_LOG(ERROR) << "Failed to open " << file_name;
+    return absl::string_view();
+  }
+  struct stat file_stat;
+  void* map = MAP_FAILED;
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    map = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  // The mapping stays valid after the file is closed.
+  close(fd);
+  if (map == MAP_FAILED) {
+    QUIC_LOG(ERROR) << "Failed to map " << file_name;
+    return absl::string_view();
+  }
+  const size_t size = file_stat.st_size;
+  mappings_.push_back({static_cast<const char*>(map), size});
+  mapped_bytes_ += size;
+  return absl::string_view(static_cast<const char*>(map), size);
+}
+
+bool QuicFileBackedCacheBackend::InitializeBackend(
+    const std::string& cache_directory) {
+  if (cache_directory.empty()) {
+    QUIC_BUG(quic_file_backed_cache_empty_directory)
+        << "cache_directory must not be empty.";
+    return false;
+  }
+  QUIC_LOG(INFO)
+      << "Attempting to initialize QuicFileBackedCacheBackend from directory: "
+      << cache_directory;
+  std::vector<std::string> files;
+  if (!quiche::EnumerateDirectoryRecursively(cache_directory, files)) {
+    QUIC_BUG(quic_file_backed_cache_unreadable_directory)
+        << "Can't read QuicFileBackedCacheBackend directory: "
+        << cache_directory;
+    return false;
+  }
+  for (const auto& filename : files) {
+    absl::string_view contents = MapFile(filename);
+    if (contents.empty()) {
+      continue;
+    }
+    QuicMemoryCacheBackend::ResourceFile resource_file(filename);
+
+    // Tease apart filename into host and path.
+    std::string base(filename);
+    // Transform windows path separators to URL path separators.
+    for (size_t i = 0; i < base.length(); ++i) {
+      if (base[i] == '\\') {
+        base[i] = '/';
+      }
+    }
+    base.erase(0, cache_directory.length());
+    if (base[0] == '/') {
+      base.erase(0, 1);
+    }
+
+    resource_file.SetHostPathFromBase(base);
+    // Only the headers are read here, the body pages stay on disk.
+    resource_file.Parse(contents);
+
+    std::string key = GetKey(resource_file.host(), resource_file.path());
+    if (responses_.contains(key)) {
+      QUIC_BUG(quic_file_backed_cache_duplicate_response)
+          << "Response for '" << key << "' already exists!";
+      continue;
+    }
+    auto response = std::make_unique<QuicBackendResponse>();
+    response->set_response_type(QuicBackendResponse::REGULAR_RESPONSE);
+    response->set_headers(resource_file.spdy_headers().Clone());
+    response->set_external_body(resource_file.body());
+    QUIC_DVLOG(1) << "Add response with key " << key;
+    responses_[key] = std::move(response);
+  }
+
+  QUIC_LOG(INFO) << "Mapped " << responses_.size() << " responses, "
+                 << mapped_bytes_ << " bytes.";
+  initialized_ = true;
+  return true;
+}
+
+bool QuicFileBackedCacheBackend::IsBackendInitialized() const {
+  return initialized_;
+}
+
+void QuicFileBackedCacheBackend::FetchResponseFromBackend(
+    const spdy::Http2HeaderBlock& request_headers,
+    const std::string& /*request_body*/,
+    QuicSimpleServerBackend::RequestHandler* quic_stream) {
+  const QuicBackendResponse* quic_response = nullptr;
+  auto authority = request_headers.find(":authority");
+  auto path = request_headers.find(":path");
+  if (authority != request_headers.end() && path != request_headers.end()) {
+    quic_response = GetResponse(authority->second, path->second);
+  }
+  quic_stream->OnResponseBackendComplete(quic_response);
+}
+
+// The file-backed cache does not have a per-stream handler.
+void QuicFileBackedCacheBackend::CloseBackendResponseStream(
+    QuicSimpleServerBackend::RequestHandler* /*quic_stream*/) {}
+
+// static
+std::string QuicFileBackedCacheBackend::GetKey(absl::string_view host,
+                                               absl::string_view path) {
+  size_t port = host.find(':');
+  if (port != absl::string_view::npos) {
+    host = host.substr(0, port);
+  }
+  return absl::StrCat(host, path);
+}
+
+}  // namespace quic
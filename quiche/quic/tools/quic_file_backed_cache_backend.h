@@ -0,0 +1,76 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_TOOLS_QUIC_FILE_BACKED_CACHE_BACKEND_H_
+#define QUICHE_QUIC_TOOLS_QUIC_FILE_BACKED_CACHE_BACKEND_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "quiche/quic/tools/quic_backend_response.h"
+#include "quiche/quic/tools/quic_simple_server_backend.h"
+#include "quiche/spdy/core/http2_header_block.h"
+
+namespace quic {
+
+// Serves the same cache directory as QuicMemoryCacheBackend, but memory-maps
+// every file instead of copying it to the heap.  Only the headers are parsed
+// at startup; response bodies refer to the mappings and are paged in by the
+// kernel as streams send them, so that the corpus may be larger than memory.
+// Server push associations are not supported.
+class QuicFileBackedCacheBackend : public QuicSimpleServerBackend {
+ public:
+  QuicFileBackedCacheBackend();
+  QuicFileBackedCacheBackend(const QuicFileBackedCacheBackend&) = delete;
+  QuicFileBackedCacheBackend& operator=(const QuicFileBackedCacheBackend&) =
+      delete;
+  ~QuicFileBackedCacheBackend() override;
+
+  // Returns the response for |host| and |path|, or nullptr if there is none.
+  const QuicBackendResponse* GetResponse(absl::string_view host,
+                                         absl::string_view path) const;
+
+  // The number of responses and the total size of the mapped files.
+  size_t num_responses() const { return responses_.size(); }
+  size_t mapped_bytes() const { return mapped_bytes_; }
+
+  // QuicSimpleServerBackend implementation.
+  // |cache_directory| can be generated using `wget -p --save-headers <url>`.
+  bool InitializeBackend(const std::string& cache_directory) override;
+  bool IsBackendInitialized() const override;
+  void FetchResponseFromBackend(
+      const spdy::Http2HeaderBlock& request_headers,
+      const std::string& request_body,
+      QuicSimpleServerBackend::RequestHandler* quic_stream) override;
+  void CloseBackendResponseStream(
+      QuicSimpleServerBackend::RequestHandler* quic_stream) override;
+
+ private:
+  struct Mapping {
+    const char* data;
+    size_t size;
+  };
+
+  // Maps |file_name| read-only and returns its contents, or an empty view if
+  // the file is empty or cannot be mapped.
+  absl::string_view MapFile(const std::string& file_name);
+
+  static std::string GetKey(absl::string_view host, absl::string_view path);
+
+  std::vector<Mapping> mappings_;
+  size_t mapped_bytes_ = 0;
+  // Keyed by host without port followed by path.  Response bodies refer to
+  // |mappings_|.
+  absl::flat_hash_map<std::string, std::unique_ptr<QuicBackendResponse>>
+      responses_;
+  bool initialized_ = false;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TOOLS_QUIC_FILE_BACKED_CACHE_BACKEND_H_
@@ -0,0 +1,76 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/quic_file_backed_cache_backend.h"
+
+#include <string>
+
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/tools/quic_backend_response.h"
+#include "quiche/quic/tools/quic_memory_cache_backend.h"
+#include "quiche/common/platform/api/quiche_test.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+class QuicFileBackedCacheBackendTest : public QuicTest {
+ protected:
+  std::string CacheDirectory() {
+    return quiche::test::QuicheGetTestMemoryCachePath();
+  }
+
+  QuicFileBackedCacheBackend cache_;
+};
+
+TEST_F(QuicFileBackedCacheBackendTest, GetResponseNoMatch) {
+  ASSERT_TRUE(cache_.InitializeBackend(CacheDirectory()));
+  EXPECT_EQ(nullptr, cache_.GetResponse("mail.google.com", "/index.html"));
+}
+
+TEST_F(QuicFileBackedCacheBackendTest, ReadsCacheDir) {
+  ASSERT_TRUE(cache_.InitializeBackend(CacheDirectory()));
+  EXPECT_TRUE(cache_.IsBackendInitialized());
+  EXPECT_LT(0u, cache_.num_responses());
+  const QuicBackendResponse* response =
+      cache_.GetResponse("test.example.com", "/index.html");
+  ASSERT_TRUE(response);
+  ASSERT_TRUE(response->headers().contains(":status"));
+  EXPECT_EQ("200", response->headers().find(":status")->second);
+  // Connection headers are not valid in HTTP/2.
+  EXPECT_FALSE(response->headers().contains("connection"));
+  EXPECT_TRUE(response->has_external_body());
+  EXPECT_LT(0u, response->body().length());
+  EXPECT_LT(response->body().length(), cache_.mapped_bytes());
+}
+
+TEST_F(QuicFileBackedCacheBackendTest, UsesOriginalUrl) {
+  ASSERT_TRUE(cache_.InitializeBackend(CacheDirectory()));
+  const QuicBackendResponse* response =
+      cache_.GetResponse("test.example.com:443", "/site_map.html");
+  ASSERT_TRUE(response);
+  EXPECT_EQ("200", response->headers().find(":status")->second);
+}
+
+// The responses match the ones QuicMemoryCacheBackend copies to the heap.
+TEST_F(QuicFileBackedCacheBackendTest, MatchesMemoryCache) {
+  ASSERT_TRUE(cache_.InitializeBackend(CacheDirectory()));
+  QuicMemoryCacheBackend memory_cache;
+  ASSERT_TRUE(memory_cache.InitializeBackend(CacheDirectory()));
+  for (const char* path : {"/index.html", "/site_map.html"}) {
+    const QuicBackendResponse* mapped =
+        cache_.GetResponse("test.example.com", path);
+    const QuicBackendResponse* copied =
+        memory_cache.GetResponse("test.example.com", path);
+    ASSERT_TRUE(mapped);
+    ASSERT_TRUE(copied);
+    EXPECT_EQ(copied->headers(), mapped->headers());
+    EXPECT_EQ(copied->body(), mapped->body());
+    EXPECT_FALSE(copied->has_external_body());
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -0,0 +1,99 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/quic_latency_histogram.h"
+
+#include <algorithm>
+
+#include "absl/numeric/bits.h"
+
+namespace quic {
+
+namespace {
+
+constexpr uint64_t kHalfSubBucketCount =
+    QuicLatencyHistogram::kSubBucketCount / 2;
+constexpr uint64_t kMaxMicros =
+    (uint64_t{1} << QuicLatencyHistogram::kMaxBits) - 1;
+
+}  // namespace
+
+QuicLatencyHistogram::QuicLatencyHistogram()
+    : buckets_(BucketIndex(kMaxMicros) + 1) {}
+
+// static
+size_t QuicLatencyHistogram::BucketIndex(uint64_t micros) {
+  if (micros < kSubBucketCount) {
+    return micros;
+  }
+  // Latencies of kSubBucketCount << (shift - 1) and above share buckets of
+  // 1 << shift microseconds.
+  const int shift = absl::bit_width(micros) - kSubBucketBits;
+  return kSubBucketCount + (shift - 1) * kHalfSubBucketCount +
+         ((micros >> shift) - kHalfSubBucketCount);
+}
+
+// static
+uint64_t QuicLatencyHistogram::BucketUpperBound(size_t index) {
+  if (index < kSubBucketCount) {
+    return index;
+  }
+  const int shift = (index - kSubBucketCount) / kHalfSubBucketCount + 1;
+  const uint64_t sub_bucket =
+      (index - kSubBucketCount) % kHalfSubBucketCount + kHalfSubBucketCount;
+  return ((sub_bucket + 1) << shift) - 1;
+}
+
+void QuicLatencyHistogram::Add(QuicTime::Delta latency) {
+  const uint64_t micros = std::clamp<int64_t>(latency.ToMicroseconds(), 0,
+                                              static_cast<int64_t>(kMaxMicros));
+  ++count_;
+  total_micros_ += micros;
+  min_micros_ = std::min(min_micros_, micros);
+  max_micros_ = std::max(max_micros_, micros);
+  ++buckets_[BucketIndex(micros)];
+}
+
+void QuicLatencyHistogram::Merge(const QuicLatencyHistogram& other) {
+  count_ += other.count_;
+  total_micros_ += other.total_micros_;
+  min_micros_ = std::min(min_micros_, other.min_micros_);
+  max_micros_ = std::max(max_micros_, other.max_micros_);
+  for (size_t i = 0; i < buckets_.size(); ++i) {
+    buckets_[i] += other.buckets_[i];
+  }
+}
+
+QuicTime::Delta QuicLatencyHistogram::Percentile(double fraction) const {
+  if (count_ == 0) {
+    return QuicTime::Delta::Zero();
+  }
+  fraction = std::clamp(fraction, 0.0, 1.0);
+  const uint64_t rank =
+      std::max<uint64_t>(1, static_cast<uint64_t>(fraction * count_ + 0.5));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets_.size(); ++i) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return QuicTime::Delta::FromMicroseconds(
+          std::min(BucketUpperBound(i), max_micros_));
+    }
+  }
+  return max();
+}
+
+QuicTime::Delta QuicLatencyHistogram::min() const {
+  return QuicTime::Delta::FromMicroseconds(count_ == 0 ? 0 : min_micros_);
+}
+
+QuicTime::Delta QuicLatencyHistogram::max() const {
+  return QuicTime::Delta::FromMicroseconds(max_micros_);
+}
+
+QuicTime::Delta QuicLatencyHistogram::Mean() const {
+  return QuicTime::Delta::FromMicroseconds(
+      count_ == 0 ? 0 : total_micros_ / count_);
+}
+
+}  // namespace quic
@@ -0,0 +1,57 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_TOOLS_QUIC_LATENCY_HISTOGRAM_H_
+#define QUICHE_QUIC_TOOLS_QUIC_LATENCY_HISTOGRAM_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// Histogram of latencies with a bounded relative error, laid out like an HDR
+// histogram: latencies below kSubBucketCount microseconds are recorded
+// exactly, and every following power of two is split into kSubBucketCount / 2
+// buckets, so that a percentile is within 1 / 128 of the recorded latency.
+// Latencies of more than 2^kMaxBits microseconds, about 12 days, are recorded
+// as such. Not thread safe; threads record into histograms of their own, which
+// are merged afterwards.
+class QUIC_NO_EXPORT QuicLatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 8;
+  static constexpr uint64_t kSubBucketCount = uint64_t{1} << kSubBucketBits;
+  static constexpr int kMaxBits = 40;
+
+  QuicLatencyHistogram();
+
+  void Add(QuicTime::Delta latency);
+  void Merge(const QuicLatencyHistogram& other);
+
+  // Returns an upper bound of the |fraction| (in [0, 1]) percentile, at most
+  // max().
+  QuicTime::Delta Percentile(double fraction) const;
+
+  uint64_t count() const { return count_; }
+  QuicTime::Delta min() const;
+  QuicTime::Delta max() const;
+  QuicTime::Delta Mean() const;
+
+ private:
+  static size_t BucketIndex(uint64_t micros);
+  // Returns the largest latency recorded in the bucket at |index|.
+  static uint64_t BucketUpperBound(size_t index);
+
+  uint64_t count_ = 0;
+  uint64_t total_micros_ = 0;
+  uint64_t min_micros_ = UINT64_MAX;
+  uint64_t max_micros_ = 0;
+  std::vector<uint64_t> buckets_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TOOLS_QUIC_LATENCY_HISTOGRAM_H_
@@ -0,0 +1,82 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/quic_latency_histogram.h"
+
+#include <cstdint>
+
+#include "quiche/quic/platform/api/quic_test.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+QuicTime::Delta Micros(int64_t micros) {
+  return QuicTime::Delta::FromMicroseconds(micros);
+}
+
+TEST(QuicLatencyHistogramTest, Empty) {
+  QuicLatencyHistogram histogram;
+  EXPECT_EQ(0u, histogram.count());
+  EXPECT_EQ(QuicTime::Delta::Zero(), histogram.Percentile(0.5));
+  EXPECT_EQ(QuicTime::Delta::Zero(), histogram.min());
+  EXPECT_EQ(QuicTime::Delta::Zero(), histogram.Mean());
+}
+
+TEST(QuicLatencyHistogramTest, SmallLatenciesAreExact) {
+  QuicLatencyHistogram histogram;
+  for (int64_t micros = 1; micros <= 100; ++micros) {
+    histogram.Add(Micros(micros));
+  }
+  EXPECT_EQ(100u, histogram.count());
+  EXPECT_EQ(Micros(1), histogram.min());
+  EXPECT_EQ(Micros(100), histogram.max());
+  EXPECT_EQ(Micros(50), histogram.Percentile(0.5));
+  EXPECT_EQ(Micros(99), histogram.Percentile(0.99));
+  EXPECT_EQ(Micros(100), histogram.Percentile(1));
+  EXPECT_EQ(Micros(50), histogram.Mean());
+}
+
+TEST(QuicLatencyHistogramTest, BoundedRelativeError) {
+  for (int64_t micros :
+       {int64_t{255}, int64_t{256}, int64_t{1000}, int64_t{123456},
+        int64_t{5000000}, int64_t{3600000000}}) {
+    QuicLatencyHistogram histogram;
+    histogram.Add(Micros(micros));
+    // Also recorded, so that the percentile is not capped by max().
+    histogram.Add(Micros(2 * micros));
+    const int64_t median = histogram.Percentile(0.5).ToMicroseconds();
+    EXPECT_GE(median, micros);
+    EXPECT_LE(median, micros + micros / 128) << micros;
+  }
+}
+
+TEST(QuicLatencyHistogramTest, HugeLatenciesAreClamped) {
+  QuicLatencyHistogram histogram;
+  histogram.Add(QuicTime::Delta::Infinite());
+  histogram.Add(Micros(-1));
+  EXPECT_EQ(Micros(0), histogram.min());
+  EXPECT_EQ(Micros((int64_t{1} << QuicLatencyHistogram::kMaxBits) - 1),
+            histogram.max());
+}
+
+TEST(QuicLatencyHistogramTest, Merge) {
+  QuicLatencyHistogram a;
+  QuicLatencyHistogram b;
+  for (int i = 0; i < 90; ++i) {
+    a.Add(Micros(10));
+  }
+  for (int i = 0; i < 10; ++i) {
+    b.Add(Micros(20000));
+  }
+  a.Merge(b);
+  EXPECT_EQ(100u, a.count());
+  EXPECT_EQ(Micros(10), a.Percentile(0.9));
+  EXPECT_LE(Micros(20000), a.Percentile(0.95));
+  EXPECT_EQ(Micros(20000), a.max());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -0,0 +1,415 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Benchmarks of QUIC-LB. Every benchmark prints one line of JSON with its
+// results to stdout, e.g.
+//   quic_load_balancer_benchmark --benchmarks=load_balancer_router
+//
+// load_balancer_connection_ids measures connection ID encoding and decoding,
+// and load_balancer_router the packet rate of QuicLoadBalancerRouter over
+// loopback.
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "quiche/quic/core/batch_writer/quic_gso_batch_writer.h"
+#include "quiche/quic/core/crypto/quic_random.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/core/quic_types.h"
+#include "quiche/quic/core/quic_udp_socket.h"
+#include "quiche/quic/load_balancer/load_balancer_config.h"
+#include "quiche/quic/load_balancer/load_balancer_decoder.h"
+#include "quiche/quic/load_balancer/load_balancer_encoder.h"
+#include "quiche/quic/load_balancer/load_balancer_server_id.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/platform/api/quic_thread.h"
+#include "quiche/quic/test_tools/quic_benchmark_utils.h"
+#include "quiche/quic/tools/quic_load_balancer_router.h"
+#include "quiche/quic/tools/quic_load_balancer_routing_table.h"
+#include "quiche/common/platform/api/quiche_command_line_flags.h"
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    std::string, benchmarks, "",
+    "Comma-separated list of benchmarks to run. If empty, all benchmarks are "
+    "run.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, num_threads, 8,
+    "Number of threads of the multi-threaded micro benchmarks.");
+
+namespace quic {
+namespace test {
+namespace {
+
+// Compares the packet rates of QUIC-LB server ID decoding (load balancer) and
+// connection ID generation (server), one connection ID at a time and in
+// batches, for encrypted 8, 12 and 16 byte connection IDs. QuicConnectionId
+// holds at most 8 bytes, so encoding is only measured for 8 byte connection
+// IDs, and the longer ones are decoded from random bytes, which cost the same
+// to decrypt.
+bool RunLoadBalancerConnectionIds() {
+  constexpr size_t kNumConnectionIds = 1024;
+  constexpr int kRounds = 1000;
+  const char key[kLoadBalancerKeyLen] = {};
+  const uint8_t server_id_bytes[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+  const double packets = static_cast<double>(kNumConnectionIds) * kRounds;
+  // Server ID and nonce lengths for each connection ID length.
+  for (const auto& [server_id_len, nonce_len] :
+       {std::pair<uint8_t, uint8_t>{3, 4}, {5, 6}, {7, 8}}) {
+    absl::optional<LoadBalancerConfig> config = LoadBalancerConfig::Create(
+        0, server_id_len, nonce_len, absl::string_view(key, sizeof(key)));
+    absl::optional<LoadBalancerServerId> server_id =
+        LoadBalancerServerId::Create(
+            absl::Span<const uint8_t>(server_id_bytes, server_id_len));
+    if (!config.has_value() || !server_id.has_value()) {
+      QUIC_LOG(ERROR) << "Invalid QUIC-LB config";
+      return false;
+    }
+    LoadBalancerDecoder decoder;
+    if (!decoder.AddConfig(*config)) {
+      QUIC_LOG(ERROR) << "Failed to set up QUIC-LB decoder";
+      return false;
+    }
+    const bool encode =
+        config->total_len() <= kQuicDefaultConnectionIdLength;
+    QuicBenchmarkResult result(
+        absl::StrCat("load_balancer_connection_ids_", config->total_len()));
+    result.AddMetric("connection_id_length", config->total_len())
+        .AddMetric("packets", packets);
+
+    std::vector<std::string> connection_id_bytes(kNumConnectionIds);
+    if (encode) {
+      absl::optional<LoadBalancerEncoder> encoder =
+          LoadBalancerEncoder::Create(*QuicRandom::GetInstance(), nullptr,
+                                      /*len_self_encoded=*/true);
+      if (!encoder.has_value() ||
+          !encoder->UpdateConfig(*config, *server_id)) {
+        QUIC_LOG(ERROR) << "Failed to set up QUIC-LB encoder";
+        return false;
+      }
+      std::vector<QuicConnectionId> connection_ids(kNumConnectionIds);
+      QuicBenchmarkTimer timers[2];
+      timers[0].Start();
+      for (int round = 0; round < kRounds; ++round) {
+        for (QuicConnectionId& connection_id : connection_ids) {
+          connection_id = encoder->GenerateConnectionId();
+        }
+      }
+      timers[0].Stop();
+      timers[1].Start();
+      for (int round = 0; round < kRounds; ++round) {
+        encoder->GenerateConnectionIds(absl::MakeSpan(connection_ids));
+      }
+      timers[1].Stop();
+      result
+          .AddMetric("encode_mpps", packets / timers[0].cpu_seconds() / 1e6)
+          .AddMetric("batch_encode_mpps",
+                     packets / timers[1].cpu_seconds() / 1e6);
+      for (size_t i = 0; i < kNumConnectionIds; ++i) {
+        connection_id_bytes[i].assign(connection_ids[i].data(),
+                                      connection_ids[i].length());
+      }
+    } else {
+      for (std::string& bytes : connection_id_bytes) {
+        bytes.resize(config->total_len());
+        QuicRandom::GetInstance()->RandBytes(bytes.data(), bytes.size());
+        bytes[0] &= 0x3f;  // config ID 0
+      }
+    }
+    std::vector<absl::string_view> connection_ids(
+        connection_id_bytes.begin(), connection_id_bytes.end());
+
+    // Decoding one at a time uses GetServerId(), which takes raw bytes for
+    // connection IDs that do not fit in a QuicConnectionId.
+    std::vector<absl::optional<LoadBalancerServerId>> server_ids(
+        kNumConnectionIds);
+    std::vector<absl::optional<LoadBalancerServerId>> batch_server_ids(
+        kNumConnectionIds);
+    QuicBenchmarkTimer timers[2];
+    timers[0].Start();
+    for (int round = 0; round < kRounds; ++round) {
+      for (size_t i = 0; i < kNumConnectionIds; ++i) {
+        server_ids[i] = decoder.GetServerId(connection_ids[i]);
+      }
+    }
+    timers[0].Stop();
+    timers[1].Start();
+    for (int round = 0; round < kRounds; ++round) {
+      decoder.GetServerIds(connection_ids, absl::MakeSpan(batch_server_ids));
+    }
+    timers[1].Stop();
+    for (size_t i = 0; i < kNumConnectionIds; ++i) {
+      // LoadBalancerServerId has no operator!=.
+      if (!(batch_server_ids[i] == server_ids[i]) ||
+          (encode && !(server_ids[i] == server_id))) {
+        QUIC_LOG(ERROR) << "QUIC-LB decoding failed";
+        return false;
+      }
+    }
+    PrintBenchmarkResult(
+        result.AddMetric("decode_mpps", packets / timers[0].cpu_seconds() / 1e6)
+            .AddMetric("batch_decode_mpps",
+                       packets / timers[1].cpu_seconds() / 1e6));
+  }
+  return true;
+}
+
+// Blasts the same batch of QUIC packets at |destination| with UDP GSO until
+// stopped.
+class PacketBlasterThread : public QuicThread {
+ public:
+  PacketBlasterThread(const QuicSocketAddress& destination,
+                      std::vector<std::string> packets,
+                      const std::atomic<bool>* stopping)
+      : QuicThread("PacketBlasterThread"),
+        destination_(destination),
+        packets_(std::move(packets)),
+        stopping_(stopping) {}
+
+  uint64_t packets_sent() const { return packets_sent_; }
+
+ protected:
+  void Run() override {
+    QuicUdpSocketApi socket_api;
+    QuicUdpSocketFd fd =
+        socket_api.Create(destination_.host().AddressFamilyToInt(),
+                          kDefaultSocketReceiveBuffer,
+                          4 * kDefaultSocketReceiveBuffer);
+    if (fd == kQuicInvalidSocketFd) {
+      QUIC_LOG(ERROR) << "Failed to create socket";
+      return;
+    }
+    QuicGsoBatchWriter writer(fd);
+    while (!stopping_->load(std::memory_order_relaxed)) {
+      for (const std::string& packet : packets_) {
+        WriteResult result =
+            writer.WritePacket(packet.data(), packet.size(), QuicIpAddress(),
+                               destination_, /*options=*/nullptr);
+        writer.SetWritable();
+        if (result.status == WRITE_STATUS_OK) {
+          ++packets_sent_;
+        }
+      }
+      writer.Flush();
+      writer.SetWritable();
+    }
+    socket_api.Destroy(fd);
+  }
+
+ private:
+  const QuicSocketAddress destination_;
+  const std::vector<std::string> packets_;
+  const std::atomic<bool>* stopping_;
+  uint64_t packets_sent_ = 0;
+};
+
+// A backend of the load balancer router, which counts the packets it
+// receives until stopped.
+class PacketSinkThread : public QuicThread {
+ public:
+  explicit PacketSinkThread(const std::atomic<bool>* stopping)
+      : QuicThread("PacketSinkThread"), stopping_(stopping) {}
+  ~PacketSinkThread() override { socket_api_.Destroy(fd_); }
+
+  // Binds the socket of the sink to a loopback port.
+  bool Bind() {
+    fd_ = socket_api_.Create(AF_INET, 4 * kDefaultSocketReceiveBuffer,
+                             kDefaultSocketReceiveBuffer);
+    return fd_ != kQuicInvalidSocketFd &&
+           socket_api_.Bind(fd_,
+                            QuicSocketAddress(QuicIpAddress::Loopback4(), 0)) &&
+           address_.FromSocket(fd_) == 0;
+  }
+
+  const QuicSocketAddress& address() const { return address_; }
+  uint64_t packets_received() const { return packets_received_; }
+
+ protected:
+  void Run() override {
+    constexpr size_t kNumReads = 64;
+    std::unique_ptr<char[]> buffer(
+        new char[kNumReads * kMaxIncomingPacketSize]);
+    QuicUdpSocketApi::ReadPacketResults results(kNumReads);
+    while (!stopping_->load(std::memory_order_relaxed)) {
+      if (!socket_api_.WaitUntilReadable(
+              fd_, QuicTime::Delta::FromMilliseconds(50))) {
+        continue;
+      }
+      for (size_t i = 0; i < kNumReads; ++i) {
+        results[i].packet_buffer.buffer =
+            buffer.get() + i * kMaxIncomingPacketSize;
+        results[i].Reset(kMaxIncomingPacketSize);
+      }
+      packets_received_ += socket_api_.ReadMultiplePackets(
+          fd_, BitMask64(QuicUdpPacketInfoBit::PEER_ADDRESS), &results);
+    }
+  }
+
+ private:
+  const std::atomic<bool>* stopping_;
+  QuicUdpSocketApi socket_api_;
+  QuicUdpSocketFd fd_ = kQuicInvalidSocketFd;
+  QuicSocketAddress address_;
+  uint64_t packets_received_ = 0;
+};
+
+// Measures the packet rate of a QuicLoadBalancerRouter on the loopback
+// interface, reading with recvmmsg and with UDP GRO. --num_threads senders
+// blast 1200 byte packets at a router with --num_threads worker threads,
+// which forwards them to 4 backends. Most packets have short headers with
+// QUIC-LB encoded connection IDs; 1 in 16 is an Initial, routed by the
+// consistent hash of its random connection ID. As senders and router share
+// the machine, the packet rate depends on the number of cores.
+bool RunLoadBalancerRouter() {
+  constexpr int kNumBackends = 4;
+  constexpr size_t kPacketSize = 1200;
+  constexpr size_t kPacketsPerBatch = 64;
+  const QuicTime::Delta kDuration = QuicTime::Delta::FromSeconds(5);
+  const int num_threads = quiche::GetQuicheCommandLineFlag(FLAGS_num_threads);
+  const char key[kLoadBalancerKeyLen] = {};
+  absl::optional<LoadBalancerConfig> config = LoadBalancerConfig::Create(
+      0, /*server_id_len=*/3, /*nonce_len=*/4,
+      absl::string_view(key, sizeof(key)));
+  if (!config.has_value()) {
+    QUIC_LOG(ERROR) << "Invalid QUIC-LB config";
+    return false;
+  }
+
+  for (const bool use_gro : {false, true}) {
+    std::atomic<bool> stopping{false};
+    std::string routing_table = absl::StrCat(
+        "config 0 3 4 ",
+        absl::BytesToHexString(absl::string_view(key, sizeof(key))), "\n");
+    std::vector<std::unique_ptr<PacketSinkThread>> backends;
+    for (int i = 0; i < kNumBackends; ++i) {
+      backends.push_back(std::make_unique<PacketSinkThread>(&stopping));
+      if (!backends.back()->Bind()) {
+        QUIC_LOG(ERROR) << "Failed to bind backend socket";
+        return false;
+      }
+      absl::StrAppend(&routing_table, "backend 0 0", i, "0000 ",
+                      backends.back()->address().ToString(), "\n");
+    }
+    std::shared_ptr<const QuicLoadBalancerRoutingTable> table =
+        QuicLoadBalancerRoutingTable::Parse(routing_table);
+    if (table == nullptr) {
+      return false;
+    }
+    QuicLoadBalancerRouter router(table, num_threads, use_gro);
+    if (!router.Start(QuicSocketAddress(QuicIpAddress::Loopback4(), 0))) {
+      return false;
+    }
+
+    std::vector<std::unique_ptr<PacketBlasterThread>> senders;
+    for (int i = 0; i < num_threads; ++i) {
+      const uint8_t server_id_bytes[] = {static_cast<uint8_t>(i % kNumBackends),
+                                         0, 0};
+      absl::optional<LoadBalancerEncoder> encoder =
+          LoadBalancerEncoder::Create(*QuicRandom::GetInstance(), nullptr,
+                                      /*len_self_encoded=*/false);
+      absl::optional<LoadBalancerServerId> server_id =
+          LoadBalancerServerId::Create(server_id_bytes);
+      if (!encoder.has_value() || !server_id.has_value() ||
+          !encoder->UpdateConfig(*config, *server_id)) {
+        QUIC_LOG(ERROR) << "Failed to set up QUIC-LB encoder";
+        return false;
+      }
+      std::vector<std::string> packets;
+      for (size_t j = 0; j < kPacketsPerBatch; ++j) {
+        std::string packet(kPacketSize, 0);
+        if (j % 16 == 0) {
+          // An Initial with a random 8 byte connection ID.
+          const char header[] = {'\xc0', 0, 0, 0, 1, 8};
+          memcpy(packet.data(), header, sizeof(header));
+          QuicRandom::GetInstance()->RandBytes(packet.data() + sizeof(header),
+                                               8);
+        } else {
+          const QuicConnectionId connection_id =
+              encoder->GenerateConnectionId();
+          packet[0] = '\x41';
+          memcpy(packet.data() + 1, connection_id.data(),
+                 connection_id.length());
+        }
+        packets.push_back(std::move(packet));
+      }
+      senders.push_back(std::make_unique<PacketBlasterThread>(
+          router.address(), std::move(packets), &stopping));
+    }
+
+    for (auto& backend : backends) {
+      backend->Start();
+    }
+    QuicBenchmarkTimer timer;
+    timer.Start();
+    for (auto& sender : senders) {
+      sender->Start();
+    }
+    absl::SleepFor(absl::Microseconds(kDuration.ToMicroseconds()));
+    const QuicLoadBalancerRouter::Stats stats = router.GetStats();
+    timer.Stop();
+    stopping = true;
+    router.Stop();
+    uint64_t packets_sent = 0;
+    for (auto& sender : senders) {
+      sender->Join();
+      packets_sent += sender->packets_sent();
+    }
+    uint64_t backend_packets = 0;
+    for (auto& backend : backends) {
+      backend->Join();
+      backend_packets += backend->packets_received();
+    }
+    PrintBenchmarkResult(
+        QuicBenchmarkResult(use_gro ? "load_balancer_router_gro"
+                                    : "load_balancer_router_mmsg")
+            .AddMetric("threads", num_threads)
+            .AddMetric("packets_sent", packets_sent)
+            .AddMetric("packets_received", stats.packets_received)
+            .AddMetric("packets_forwarded", stats.packets_forwarded)
+            .AddMetric("packets_dropped", stats.packets_dropped)
+            .AddMetric("backend_packets_received", backend_packets)
+            .AddTimer(timer)
+            .AddMetric("forwarded_mpps",
+                       stats.packets_forwarded / timer.wall_seconds() / 1e6));
+  }
+  return true;
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
+
+int main(int argc, char* argv[]) {
+  const char* usage =
+      "Usage: quic_load_balancer_benchmark [--benchmarks=name,...]";
+  std::vector<std::string> args =
+      quiche::QuicheParseCommandLineFlags(usage, argc, argv);
+  if (!args.empty()) {
+    quiche::QuichePrintCommandLineFlagHelp(usage);
+    return 1;
+  }
+
+  using quic::test::QuicBenchmark;
+  const std::vector<QuicBenchmark> benchmarks = {
+      {"load_balancer_connection_ids",
+       quic::test::RunLoadBalancerConnectionIds},
+      {"load_balancer_router", quic::test::RunLoadBalancerRouter},
+  };
+  const int failures = quic::test::RunBenchmarks(
+      benchmarks, quiche::GetQuicheCommandLineFlag(FLAGS_benchmarks));
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,312 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/quic_load_balancer_router.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "quiche/quic/core/batch_writer/quic_gso_batch_writer.h"
+#include "quiche/quic/core/quic_constants.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/core/quic_types.h"
+#include "quiche/quic/core/quic_udp_socket.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+#include "quiche/quic/platform/api/quic_thread.h"
+
+namespace quic {
+
+namespace {
+
+// Number of datagrams read at once by recvmmsg.
+constexpr size_t kNumMmsgReads = 64;
+// Number of datagrams read at once with GRO. Each holds up to 64 segments.
+constexpr size_t kNumGroReads = 8;
+constexpr size_t kGroBufferSize = 64 * 1024;
+// How often an idle worker checks whether it should stop.
+constexpr QuicTime::Delta kReadTimeout = QuicTime::Delta::FromMilliseconds(50);
+constexpr int kSocketBufferSize = 4 * kDefaultSocketReceiveBuffer;
+
+}  // namespace
+
+class QuicLoadBalancerRouter::Worker : public QuicThread {
+ public:
+  Worker(QuicLoadBalancerRouter* router, QuicUdpSocketFd fd, bool use_gro)
+      : QuicThread("LoadBalancerRouter"),
+        router_(router),
+        fd_(fd),
+        writer_(fd),
+        read_buffer_size_(use_gro ? kGroBufferSize : kMaxIncomingPacketSize),
+        read_buffer_(new char[(use_gro ? kNumGroReads : kNumMmsgReads) *
+                              read_buffer_size_]),
+        scratch_buffer_(
+            new char[kMaxLoadBalancerForwardingHeaderLength + kGroBufferSize]),
+        read_results_(use_gro ? kNumGroReads : kNumMmsgReads) {
+    packet_info_interested_.Set(QuicUdpPacketInfoBit::PEER_ADDRESS);
+    if (use_gro) {
+      packet_info_interested_.Set(QuicUdpPacketInfoBit::IS_GRO);
+    }
+    control_buffer_.reset(
+        new char[read_results_.size() * kDefaultUdpPacketControlBufferSize]);
+    for (size_t i = 0; i < read_results_.size(); ++i) {
+      read_results_[i].packet_buffer.buffer =
+          read_buffer_.get() + i * read_buffer_size_;
+      read_results_[i].control_buffer.buffer =
+          control_buffer_.get() + i * kDefaultUdpPacketControlBufferSize;
+      read_results_[i].control_buffer.buffer_len =
+          kDefaultUdpPacketControlBufferSize;
+    }
+  }
+
+  ~Worker() override { QuicUdpSocketApi().Destroy(fd_); }
+
+  Stats GetStats() const {
+    Stats stats;
+    stats.packets_received = packets_received_.load(std::memory_order_relaxed);
+    stats.packets_dropped = packets_dropped_.load(std::memory_order_relaxed);
+    stats.packets_forwarded = stats.packets_received - stats.packets_dropped;
+    return stats;
+  }
+
+ protected:
+  void Run() override {
+    while (!router_->stopping_.load(std::memory_order_relaxed)) {
+      if (!socket_api_.WaitUntilReadable(fd_, kReadTimeout)) {
+        continue;
+      }
+      while (!router_->stopping_.load(std::memory_order_relaxed) &&
+             ProcessPackets()) {
+      }
+    }
+  }
+
+ private:
+  // Reads, routes and forwards one batch of packets. Returns false if there
+  // was nothing to read.
+  bool ProcessPackets() {
+    for (QuicUdpSocketApi::ReadPacketResult& result : read_results_) {
+      result.Reset(read_buffer_size_);
+    }
+    const size_t num_read = socket_api_.ReadMultiplePackets(
+        fd_, packet_info_interested_, &read_results_);
+    if (num_read == 0) {
+      return false;
+    }
+    packets_.clear();
+    clients_.clear();
+    for (size_t i = 0; i < num_read; ++i) {
+      QuicUdpSocketApi::ReadPacketResult& result = read_results_[i];
+      if (!result.ok) {
+        continue;
+      }
+      absl::string_view datagram(result.packet_buffer.buffer,
+                                 result.packet_buffer.buffer_len);
+      size_t segment_size = datagram.size();
+      if (result.packet_info.HasValue(QuicUdpPacketInfoBit::IS_GRO) &&
+          result.packet_info.gso_size() > 0) {
+        segment_size = result.packet_info.gso_size();
+      }
+      for (size_t offset = 0; offset < datagram.size();
+           offset += segment_size) {
+        packets_.push_back(datagram.substr(offset, segment_size));
+        clients_.push_back(&result.packet_info.peer_address());
+      }
+    }
+
+    backends_.resize(packets_.size());
+    router_->routing_table()->Route(packets_, absl::MakeSpan(backends_));
+    // Group the packets of each backend, so that they go out in as few GSO
+    // writes as possible. The packets of a backend stay in order.
+    order_.resize(packets_.size());
+    std::iota(order_.begin(), order_.end(), 0);
+    std::stable_sort(order_.begin(), order_.end(), [this](size_t a, size_t b) {
+      return std::less<const QuicSocketAddress*>()(backends_[a], backends_[b]);
+    });
+
+    uint64_t dropped = 0;
+    for (size_t i : order_) {
+      if (backends_[i] == nullptr) {
+        ++dropped;
+        continue;
+      }
+      dropped += Forward(*clients_[i], packets_[i], *backends_[i]);
+    }
+    WriteResult result = writer_.Flush();
+    if (IsWriteError(result.status)) {
+      QUIC_LOG_FIRST_N(ERROR, 10) << "Failed to forward packets: " << result;
+      dropped += result.dropped_packets;
+    }
+    writer_.SetWritable();
+
+    packets_received_.fetch_add(packets_.size(), std::memory_order_relaxed);
+    packets_dropped_.fetch_add(dropped, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Forwards |packet| from |client| to |backend|, and returns the number of
+  // packets dropped, which includes previously batched packets if a write
+  // failed.
+  uint64_t Forward(const QuicSocketAddress& client, absl::string_view packet,
+                   const QuicSocketAddress& backend) {
+    char header[kMaxLoadBalancerForwardingHeaderLength];
+    const size_t header_length =
+        WriteLoadBalancerForwardingHeader(client, header);
+    const size_t length = header_length + packet.size();
+    char* buffer = nullptr;
+    if (length <= kMaxOutgoingPacketSize) {
+      // Build the packet in place in the batch, when there is room for it.
+      buffer = writer_.GetNextWriteLocation(QuicIpAddress(), backend).buffer;
+    }
+    if (buffer == nullptr) {
+      buffer = scratch_buffer_.get();
+    }
+    memcpy(buffer, header, header_length);
+    memcpy(buffer + header_length, packet.data(), packet.size());
+
+    if (length > kMaxOutgoingPacketSize) {
+      // Too large for the batch writer.
+      QuicUdpPacketInfo packet_info;
+      packet_info.SetPeerAddress(backend);
+      WriteResult result =
+          socket_api_.WritePacket(fd_, buffer, length, packet_info);
+      return result.status == WRITE_STATUS_OK ? 0 : 1;
+    }
+    WriteResult result = writer_.WritePacket(buffer, length, QuicIpAddress(),
+                                             backend, /*options=*/nullptr);
+    // A blocked socket drops the packets which do not fit in its buffer, as
+    // a router with more packets to read cannot wait for it.
+    writer_.SetWritable();
+    if (result.status == WRITE_STATUS_BLOCKED) {
+      return 1;
+    }
+    if (IsWriteError(result.status)) {
+      QUIC_LOG_FIRST_N(ERROR, 10) << "Failed to forward packets: " << result;
+      return result.dropped_packets;
+    }
+    return 0;
+  }
+
+  QuicLoadBalancerRouter* router_;
+  const QuicUdpSocketFd fd_;
+  QuicUdpSocketApi socket_api_;
+  QuicGsoBatchWriter writer_;
+  BitMask64 packet_info_interested_;
+  const size_t read_buffer_size_;
+  std::unique_ptr<char[]> read_buffer_;
+  std::unique_ptr<char[]> control_buffer_;
+  std::unique_ptr<char[]> scratch_buffer_;
+  QuicUdpSocketApi::ReadPacketResults read_results_;
+
+  // The packets of the current batch, with their clients and backends.
+  std::vector<absl::string_view> packets_;
+  std::vector<const QuicSocketAddress*> clients_;
+  std::vector<const QuicSocketAddress*> backends_;
+  std::vector<size_t> order_;
+
+  std::atomic<uint64_t> packets_received_{0};
+  std::atomic<uint64_t> packets_dropped_{0};
+};
+
+QuicLoadBalancerRouter::QuicLoadBalancerRouter(
+    std::shared_ptr<const QuicLoadBalancerRoutingTable> routing_table,
+    int num_threads, bool use_gro)
+    : num_threads_(num_threads),
+      use_gro_(use_gro),
+      routing_table_(std::move(routing_table)) {}
+
+QuicLoadBalancerRouter::~QuicLoadBalancerRouter() { Stop(); }
+
+bool QuicLoadBalancerRouter::Start(const QuicSocketAddress& address) {
+  QUICHE_DCHECK(workers_.empty());
+  address_ = address;
+  for (int i = 0; i < num_threads_; ++i) {
+    QuicUdpSocketFd fd = CreateSocket();
+    if (fd == kQuicInvalidSocketFd) {
+      // Closes the sockets created so far.
+      workers_.clear();
+      return false;
+    }
+    workers_.push_back(std::make_unique<Worker>(this, fd, use_gro_));
+  }
+  QUIC_LOG(INFO) << "Routing QUIC packets on " << address_.ToString()
+                 << " with " << num_threads_ << " threads";
+  for (std::unique_ptr<Worker>& worker : workers_) {
+    worker->Start();
+  }
+  return true;
+}
+
+void QuicLoadBalancerRouter::Stop() {
+  if (workers_.empty() || stopping_.exchange(true)) {
+    return;
+  }
+  for (std::unique_ptr<Worker>& worker : workers_) {
+    worker->Join();
+  }
+}
+
+QuicUdpSocketFd QuicLoadBalancerRouter::CreateSocket() {
+  QuicUdpSocketApi socket_api;
+  QuicUdpSocketFd fd =
+      socket_api.Create(address_.host().AddressFamilyToInt(),
+                        kSocketBufferSize, kSocketBufferSize);
+  if (fd == kQuicInvalidSocketFd) {
+    QUIC_LOG(ERROR) << "Failed to create socket: " << strerror(errno);
+    return kQuicInvalidSocketFd;
+  }
+  int one = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+    QUIC_LOG(ERROR) << "Failed to set SO_REUSEPORT: " << strerror(errno);
+    socket_api.Destroy(fd);
+    return kQuicInvalidSocketFd;
+  }
+  if (use_gro_ && setsockopt(fd, SOL_UDP, UDP_GRO, &one, sizeof(one)) != 0) {
+    QUIC_LOG(ERROR) << "Failed to enable UDP GRO: " << strerror(errno);
+    socket_api.Destroy(fd);
+    return kQuicInvalidSocketFd;
+  }
+  // If the kernel chooses the port, the other sockets bind to it too.
+  if (!socket_api.Bind(fd, address_) ||
+      (address_.port() == 0 && address_.FromSocket(fd) != 0)) {
+    QUIC_LOG(ERROR) << "Failed to bind to " << address_.ToString() << ": "
+                    << strerror(errno);
+    socket_api.Destroy(fd);
+    return kQuicInvalidSocketFd;
+  }
+  return fd;
+}
+
+void QuicLoadBalancerRouter::SetRoutingTable(
+    std::shared_ptr<const QuicLoadBalancerRoutingTable> routing_table) {
+  QuicWriterMutexLock lock(&mutex_);
+  routing_table_ = std::move(routing_table);
+}
+
+std::shared_ptr<const QuicLoadBalancerRoutingTable>
+QuicLoadBalancerRouter::routing_table() const {
+  QuicReaderMutexLock lock(&mutex_);
+  return routing_table_;
+}
+
+QuicLoadBalancerRouter::Stats QuicLoadBalancerRouter::GetStats() const {
+  Stats total;
+  for (const std::unique_ptr<Worker>& worker : workers_) {
+    Stats stats = worker->GetStats();
+    total.packets_received += stats.packets_received;
+    total.packets_forwarded += stats.packets_forwarded;
+    total.packets_dropped += stats.packets_dropped;
+  }
+  return total;
+}
+
+}  // namespace quic
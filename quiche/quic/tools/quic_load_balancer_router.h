@@ -0,0 +1,92 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_TOOLS_QUIC_LOAD_BALANCER_ROUTER_H_
+#define QUICHE_QUIC_TOOLS_QUIC_LOAD_BALANCER_ROUTER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "quiche/quic/core/quic_udp_socket.h"
+#include "quiche/quic/platform/api/quic_export.h"
+#include "quiche/quic/platform/api/quic_mutex.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/tools/quic_load_balancer_routing_table.h"
+
+namespace quic {
+
+// QuicLoadBalancerRouter forwards the QUIC packets it receives on a UDP
+// address to the backends chosen by a QuicLoadBalancerRoutingTable. It keeps
+// no per-connection state. Each of its worker threads has its own socket bound
+// to the address with SO_REUSEPORT, reads packets in batches with recvmmsg, or
+// with UDP GRO, routes a whole batch at once, and forwards it with UDP GSO.
+//
+// As the router cannot route replies, every forwarded packet starts with the
+// address of the client, see WriteLoadBalancerForwardingHeader(). Backends
+// must be QuicServers with the router IP address set, see
+// QuicServer::set_load_balancer_router_address(), which strip the header and
+// reply to the client directly from the router address, e.g. with direct
+// server return.
+//
+// Linux only.
+class QUIC_NO_EXPORT QuicLoadBalancerRouter {
+ public:
+  struct QUIC_NO_EXPORT Stats {
+    uint64_t packets_received = 0;
+    uint64_t packets_forwarded = 0;
+    // Packets which are not QUIC packets, or could not be sent.
+    uint64_t packets_dropped = 0;
+  };
+
+  // |use_gro| reads with UDP GRO instead of recvmmsg.
+  QuicLoadBalancerRouter(
+      std::shared_ptr<const QuicLoadBalancerRoutingTable> routing_table,
+      int num_threads, bool use_gro);
+  QuicLoadBalancerRouter(const QuicLoadBalancerRouter&) = delete;
+  QuicLoadBalancerRouter& operator=(const QuicLoadBalancerRouter&) = delete;
+  ~QuicLoadBalancerRouter();
+
+  // Binds the sockets of all the worker threads to |address|, and starts the
+  // threads. If the port of |address| is 0, the kernel chooses one, see
+  // address(). Returns false on failure.
+  bool Start(const QuicSocketAddress& address);
+
+  // Stops and joins the worker threads. The router cannot be restarted.
+  void Stop();
+
+  // Replaces the routing table. Each worker thread picks up the new table
+  // before its next batch of packets.
+  void SetRoutingTable(
+      std::shared_ptr<const QuicLoadBalancerRoutingTable> routing_table);
+  std::shared_ptr<const QuicLoadBalancerRoutingTable> routing_table() const;
+
+  // The address the router listens on.
+  const QuicSocketAddress& address() const { return address_; }
+
+  // Sums the stats of all worker threads.
+  Stats GetStats() const;
+
+ private:
+  class Worker;
+
+  // Returns a socket bound to |address_| with SO_REUSEPORT, or
+  // kQuicInvalidSocketFd on failure. Sets the port of |address_| if it is 0.
+  QuicUdpSocketFd CreateSocket();
+
+  const int num_threads_;
+  const bool use_gro_;
+  QuicSocketAddress address_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<bool> stopping_{false};
+
+  mutable QuicMutex mutex_;
+  std::shared_ptr<const QuicLoadBalancerRoutingTable> routing_table_
+      QUIC_GUARDED_BY(mutex_);
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TOOLS_QUIC_LOAD_BALANCER_ROUTER_H_
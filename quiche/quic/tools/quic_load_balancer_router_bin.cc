@@ -0,0 +1,119 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A stateless QUIC-LB packet router, see QuicLoadBalancerRouter. It listens on
+// --port until it's killed, and forwards QUIC packets to the backends in
+// --routing_table, which it reads again every --routing_table_reload_seconds
+// to pick up config rotations and backend changes. See
+// QuicLoadBalancerRoutingTable for the format of the routing table.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "quiche/quic/platform/api/quic_ip_address.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/tools/quic_load_balancer_router.h"
+#include "quiche/quic/tools/quic_load_balancer_routing_table.h"
+#include "quiche/common/platform/api/quiche_command_line_flags.h"
+#include "quiche/common/platform/api/quiche_file_utils.h"
+#include "quiche/common/platform/api/quiche_system_event_loop.h"
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    std::string, host, "",
+    "The IP address the router listens on. If empty, it listens on all "
+    "addresses. Backends must know the address the router sends from, see "
+    "the --load_balancer_router_host flag of quic_server, so set it when "
+    "routing to them.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(int32_t, port, 6121,
+                                "The port the router listens on.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(std::string, routing_table, "",
+                                "Path to the routing table file.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, routing_table_reload_seconds, 10,
+    "How often the routing table file is read again. The file should be "
+    "replaced atomically, e.g. with rename().");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(int32_t, num_threads, 4,
+                                "Number of packet routing threads.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    bool, gro, true, "If true, packets are read with UDP GRO, else recvmmsg.");
+
+namespace {
+
+std::shared_ptr<const quic::QuicLoadBalancerRoutingTable> LoadRoutingTable(
+    const std::string& path, std::string* contents) {
+  absl::optional<std::string> new_contents = quiche::ReadFileContents(path);
+  if (!new_contents.has_value()) {
+    QUIC_LOG(ERROR) << "Failed to read routing table " << path;
+    return nullptr;
+  }
+  *contents = *std::move(new_contents);
+  return quic::QuicLoadBalancerRoutingTable::Parse(*contents);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  quiche::QuicheSystemEventLoop event_loop("quic_load_balancer_router");
+  const char* usage =
+      "Usage: quic_load_balancer_router --routing_table=<file> [options]";
+  std::vector<std::string> non_option_args =
+      quiche::QuicheParseCommandLineFlags(usage, argc, argv);
+  const std::string path =
+      quiche::GetQuicheCommandLineFlag(FLAGS_routing_table);
+  if (!non_option_args.empty() || path.empty()) {
+    quiche::QuichePrintCommandLineFlagHelp(usage);
+    exit(0);
+  }
+
+  std::string contents;
+  std::shared_ptr<const quic::QuicLoadBalancerRoutingTable> routing_table =
+      LoadRoutingTable(path, &contents);
+  if (routing_table == nullptr) {
+    return 1;
+  }
+  quic::QuicIpAddress host = quic::QuicIpAddress::Any6();
+  const std::string host_flag = quiche::GetQuicheCommandLineFlag(FLAGS_host);
+  if (!host_flag.empty() && !host.FromString(host_flag)) {
+    QUIC_LOG(ERROR) << "Invalid --host " << host_flag;
+    return 1;
+  }
+  quic::QuicLoadBalancerRouter router(
+      routing_table, quiche::GetQuicheCommandLineFlag(FLAGS_num_threads),
+      quiche::GetQuicheCommandLineFlag(FLAGS_gro));
+  if (!router.Start(quic::QuicSocketAddress(
+          host, quiche::GetQuicheCommandLineFlag(FLAGS_port)))) {
+    return 1;
+  }
+
+  while (true) {
+    absl::SleepFor(absl::Seconds(
+        quiche::GetQuicheCommandLineFlag(FLAGS_routing_table_reload_seconds)));
+    std::string new_contents;
+    routing_table = LoadRoutingTable(path, &new_contents);
+    if (new_contents != contents) {
+      if (routing_table == nullptr) {
+        QUIC_LOG(ERROR) << "Keeping the current routing table";
+      } else {
+        QUIC_LOG(INFO) << "Loaded routing table with "
+                       << routing_table->num_backends() << " backends";
+        router.SetRoutingTable(routing_table);
+        contents = std::move(new_contents);
+      }
+    }
+    const quic::QuicLoadBalancerRouter::Stats stats = router.GetStats();
+    QUIC_LOG(INFO) << "Packets received: " << stats.packets_received
+                   << ", forwarded: " << stats.packets_forwarded
+                   << ", dropped: " << stats.packets_dropped;
+  }
+}
@@ -0,0 +1,84 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/quic_load_balancer_router.h"
+
+#include <memory>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "quiche/quic/core/quic_session.h"
+#include "quiche/quic/core/quic_versions.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/platform/api/quic_test_loopback.h"
+#include "quiche/quic/test_tools/crypto_test_utils.h"
+#include "quiche/quic/test_tools/quic_dispatcher_peer.h"
+#include "quiche/quic/test_tools/quic_server_peer.h"
+#include "quiche/quic/test_tools/quic_test_client.h"
+#include "quiche/quic/test_tools/server_thread.h"
+#include "quiche/quic/tools/quic_load_balancer_routing_table.h"
+#include "quiche/quic/tools/quic_memory_cache_backend.h"
+#include "quiche/quic/tools/quic_server.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+constexpr char kHost[] = "test.example.com";
+
+// Returns a routing table with the single backend |port| on the loopback
+// address. The connection IDs of the server are not QUIC-LB connection IDs, so
+// all packets take the fallback route to it.
+std::shared_ptr<const QuicLoadBalancerRoutingTable> RoutingTableTo(int port) {
+  return QuicLoadBalancerRoutingTable::Parse(absl::StrCat(
+      "config 0 3 4 8f95f09245765f80256934e50c66207f\n", "backend 0 ed793a ",
+      QuicSocketAddress(TestLoopback4(), port).ToString(), "\n"));
+}
+
+TEST(QuicLoadBalancerRouterTest, ServesClientThroughRouter) {
+  QuicMemoryCacheBackend backend;
+  backend.AddSimpleResponse(kHost, "/foo", 200, "bar");
+
+  // The port of the server is not known before it listens, which it only
+  // does once it knows the router address.
+  QuicLoadBalancerRouter router(RoutingTableTo(1), /*num_threads=*/1,
+                                /*use_gro=*/false);
+  ASSERT_TRUE(router.Start(QuicSocketAddress(TestLoopback4(), 0)));
+
+  auto server = std::make_unique<QuicServer>(
+      crypto_test_utils::ProofSourceForTesting(), &backend);
+  server->set_load_balancer_router_address(router.address());
+  ServerThread server_thread(std::move(server),
+                             QuicSocketAddress(TestLoopback4(), 0));
+  server_thread.Initialize();
+  ASSERT_NE(0, server_thread.GetPort());
+  router.SetRoutingTable(RoutingTableTo(server_thread.GetPort()));
+  server_thread.Start();
+
+  QuicTestClient client(router.address(), kHost, AllSupportedVersions());
+  EXPECT_EQ("bar", client.SendSynchronousRequest("/foo"));
+  EXPECT_LT(0u, router.GetStats().packets_forwarded);
+
+  // The server replies to the address of the client, not to the router.
+  server_thread.Pause();
+  QuicSession* session = QuicDispatcherPeer::GetFirstSessionIfAny(
+      QuicServerPeer::GetDispatcher(server_thread.server()));
+  ASSERT_NE(nullptr, session);
+  EXPECT_EQ(client.local_address().port(), session->peer_address().port());
+  server_thread.Resume();
+
+  // The client moves to the address the replies come from, and its packets no
+  // longer carry a forwarding header. The server must still accept them.
+  EXPECT_EQ("bar", client.SendSynchronousRequest("/foo"));
+
+  client.Disconnect();
+  server_thread.Quit();
+  server_thread.Join();
+  router.Stop();
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -0,0 +1,301 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/quic_load_balancer_routing_table.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "quiche/quic/core/quic_types.h"
+#include "quiche/quic/core/quic_utils.h"
+#include "quiche/quic/core/quic_versions.h"
+#include "quiche/quic/load_balancer/load_balancer_server_id.h"
+#include "quiche/quic/platform/api/quic_bug_tracker.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+namespace {
+
+// Offset of the destination connection ID length in long header packets.
+constexpr size_t kLongHeaderConnectionIdLengthOffset = 5;
+// Route() decodes up to this many server IDs at once.
+constexpr size_t kMaxRouteBatchSize = 64;
+
+bool IsHex(absl::string_view s) {
+  for (char c : s) {
+    if (!absl::ascii_isxdigit(c)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Parses "host:port", where an IPv6 host is in brackets.
+bool ParseSocketAddress(absl::string_view s, QuicSocketAddress* address) {
+  const size_t colon = s.rfind(':');
+  if (colon == absl::string_view::npos) {
+    return false;
+  }
+  absl::string_view host = s.substr(0, colon);
+  if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+    host = host.substr(1, host.size() - 2);
+  }
+  QuicIpAddress ip;
+  uint32_t port;
+  if (!ip.FromString(std::string(host)) ||
+      !absl::SimpleAtoi(s.substr(colon + 1), &port) || port > 0xffff) {
+    return false;
+  }
+  *address = QuicSocketAddress(ip, static_cast<uint16_t>(port));
+  return true;
+}
+
+// Returns a bucket in [0, num_buckets) for |key|, such that only a
+// 1 / |num_buckets| fraction of the keys change buckets when a bucket is added
+// or removed at the end. See "A Fast, Minimal Memory, Consistent Hash
+// Algorithm" by Lamping and Veach.
+size_t JumpConsistentHash(uint64_t key, size_t num_buckets) {
+  int64_t bucket = -1;
+  int64_t next = 0;
+  while (next < static_cast<int64_t>(num_buckets)) {
+    bucket = next;
+    key = key * 2862933555777941757ULL + 1;
+    next = static_cast<int64_t>((bucket + 1) *
+                                (static_cast<double>(1LL << 31) /
+                                 static_cast<double>((key >> 33) + 1)));
+  }
+  return static_cast<size_t>(bucket);
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<QuicLoadBalancerRoutingTable>
+QuicLoadBalancerRoutingTable::Parse(absl::string_view contents) {
+  auto table = absl::WrapUnique(new QuicLoadBalancerRoutingTable());
+  std::vector<QuicSocketAddress> backends;
+  for (absl::string_view line : absl::StrSplit(contents, '\n')) {
+    line = absl::StripAsciiWhitespace(line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::vector<absl::string_view> fields =
+        absl::StrSplit(line, ' ', absl::SkipEmpty());
+    bool valid = false;
+    uint32_t config_id, server_id_len, nonce_len;
+    QuicSocketAddress address;
+    if (fields[0] == "config" && (fields.size() == 4 || fields.size() == 5) &&
+        absl::SimpleAtoi(fields[1], &config_id) &&
+        config_id < kNumLoadBalancerConfigs &&
+        !table->configs_[config_id].has_value() &&
+        absl::SimpleAtoi(fields[2], &server_id_len) &&
+        absl::SimpleAtoi(fields[3], &nonce_len) && server_id_len < 0x100 &&
+        nonce_len < 0x100) {
+      absl::optional<LoadBalancerConfig> config;
+      if (fields.size() == 4) {
+        config = LoadBalancerConfig::CreateUnencrypted(config_id, server_id_len,
+                                                       nonce_len);
+      } else if (fields[4].size() == 2 * kLoadBalancerKeyLen &&
+                 IsHex(fields[4])) {
+        config = LoadBalancerConfig::Create(config_id, server_id_len,
+                                            nonce_len,
+                                            absl::HexStringToBytes(fields[4]));
+      }
+      if (config.has_value() && table->decoder_.AddConfig(*config)) {
+        table->configs_[config_id] = Config{
+            config->total_len(),
+            LoadBalancerServerIdMap<QuicSocketAddress>::Create(server_id_len)};
+        valid = true;
+      }
+    } else if (fields[0] == "backend" && fields.size() == 4 &&
+               absl::SimpleAtoi(fields[1], &config_id) &&
+               config_id < kNumLoadBalancerConfigs &&
+               table->configs_[config_id].has_value() && IsHex(fields[2]) &&
+               ParseSocketAddress(fields[3], &address)) {
+      LoadBalancerServerIdMap<QuicSocketAddress>& map =
+          *table->configs_[config_id]->backends;
+      const std::string bytes = absl::HexStringToBytes(fields[2]);
+      absl::optional<LoadBalancerServerId> server_id =
+          LoadBalancerServerId::Create(absl::Span<const uint8_t>(
+              reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()));
+      if (server_id.has_value() && server_id->length() == map.server_id_len() &&
+          map.LookupNoCopy(*server_id) == nullptr) {
+        map.AddOrReplace(*server_id, address);
+        backends.push_back(address);
+        valid = true;
+      }
+    } else if (fields[0] == "fallback" && fields.size() == 2 &&
+               ParseSocketAddress(fields[1], &address)) {
+      table->fallback_backends_.push_back(address);
+      valid = true;
+    }
+    if (!valid) {
+      QUIC_LOG(ERROR) << "Invalid routing table line: " << line;
+      return nullptr;
+    }
+  }
+  table->num_backends_ = backends.size();
+  if (table->fallback_backends_.empty()) {
+    table->fallback_backends_ = std::move(backends);
+  }
+  if (table->fallback_backends_.empty()) {
+    QUIC_LOG(ERROR) << "Routing table without backends";
+    return nullptr;
+  }
+  return table;
+}
+
+absl::optional<absl::string_view>
+QuicLoadBalancerRoutingTable::GetDestinationConnectionId(
+    absl::string_view packet) const {
+  if (packet.size() < 2) {
+    return absl::nullopt;
+  }
+  const uint8_t first_byte = static_cast<uint8_t>(packet[0]);
+  size_t offset = 1;
+  size_t length;
+  if (first_byte & FLAGS_LONG_HEADER) {
+    if (packet.size() <= kLongHeaderConnectionIdLengthOffset) {
+      return absl::nullopt;
+    }
+    const QuicVersionLabel version_label =
+        (static_cast<uint32_t>(static_cast<uint8_t>(packet[1])) << 24) |
+        (static_cast<uint32_t>(static_cast<uint8_t>(packet[2])) << 16) |
+        (static_cast<uint32_t>(static_cast<uint8_t>(packet[3])) << 8) |
+        static_cast<uint32_t>(static_cast<uint8_t>(packet[4]));
+    offset = kLongHeaderConnectionIdLengthOffset + 1;
+    length = static_cast<uint8_t>(packet[kLongHeaderConnectionIdLengthOffset]);
+    if (QuicVersionLabelUses4BitConnectionIdLength(version_label)) {
+      length >>= 4;
+      if (length != 0) {
+        length += 3;
+      }
+    }
+  } else if (!(first_byte & FLAGS_FIXED_BIT)) {
+    // Google QUIC before version 46, which has 8 byte connection IDs.
+    if (!(first_byte & PACKET_PUBLIC_FLAGS_8BYTE_CONNECTION_ID)) {
+      return absl::nullopt;
+    }
+    length = kQuicDefaultConnectionIdLength;
+  } else {
+    const uint8_t config_id = static_cast<uint8_t>(packet[1]) >> 6;
+    length = config_id < kNumLoadBalancerConfigs &&
+                     configs_[config_id].has_value()
+                 ? configs_[config_id]->connection_id_len
+                 : kQuicDefaultConnectionIdLength;
+  }
+  if (packet.size() < offset + length) {
+    return absl::nullopt;
+  }
+  return packet.substr(offset, length);
+}
+
+void QuicLoadBalancerRoutingTable::Route(
+    absl::Span<const absl::string_view> packets,
+    absl::Span<const QuicSocketAddress*> backends) const {
+  if (packets.size() != backends.size()) {
+    QUIC_BUG(quic_bug_473650832_01)
+        << "Route called with " << packets.size() << " packets but room for "
+        << backends.size() << " backends";
+    return;
+  }
+  bool is_quic[kMaxRouteBatchSize];
+  absl::string_view connection_ids[kMaxRouteBatchSize];
+  absl::optional<LoadBalancerServerId> server_ids[kMaxRouteBatchSize];
+  for (size_t start = 0; start < packets.size();
+       start += kMaxRouteBatchSize) {
+    const size_t size = std::min(kMaxRouteBatchSize, packets.size() - start);
+    for (size_t i = 0; i < size; ++i) {
+      absl::optional<absl::string_view> connection_id =
+          GetDestinationConnectionId(packets[start + i]);
+      is_quic[i] = connection_id.has_value();
+      connection_ids[i] = connection_id.value_or(absl::string_view());
+    }
+    decoder_.GetServerIds(absl::MakeConstSpan(connection_ids, size),
+                          absl::MakeSpan(server_ids, size));
+    for (size_t i = 0; i < size; ++i) {
+      const QuicSocketAddress*& backend = backends[start + i];
+      backend = nullptr;
+      if (!is_quic[i]) {
+        continue;
+      }
+      if (server_ids[i].has_value()) {
+        const uint8_t config_id =
+            static_cast<uint8_t>(connection_ids[i][0]) >> 6;
+        backend = configs_[config_id]->backends->LookupNoCopy(*server_ids[i]);
+      }
+      if (backend == nullptr) {
+        backend = &GetFallbackBackend(connection_ids[i]);
+      }
+    }
+  }
+}
+
+const QuicSocketAddress& QuicLoadBalancerRoutingTable::GetFallbackBackend(
+    absl::string_view connection_id) const {
+  return fallback_backends_[JumpConsistentHash(
+      QuicUtils::FNV1a_64_Hash(connection_id), fallback_backends_.size())];
+}
+
+size_t WriteLoadBalancerForwardingHeader(const QuicSocketAddress& client,
+                                         char* out) {
+  // Copies the address straight out of the in_addr or in6_addr, as this runs
+  // for every packet.
+  size_t ip_length;
+  if (client.host().IsIPv4()) {
+    const in_addr ip = client.host().GetIPv4();
+    out[0] = 4;
+    ip_length = QuicIpAddress::kIPv4AddressSize;
+    memcpy(out + 1, &ip, ip_length);
+  } else {
+    const in6_addr ip = client.host().GetIPv6();
+    out[0] = 6;
+    ip_length = QuicIpAddress::kIPv6AddressSize;
+    memcpy(out + 1, &ip, ip_length);
+  }
+  out[1 + ip_length] = static_cast<char>(client.port() >> 8);
+  out[2 + ip_length] = static_cast<char>(client.port());
+  return 3 + ip_length;
+}
+
+bool StripLoadBalancerForwardingHeader(absl::string_view* packet,
+                                       QuicSocketAddress* client) {
+  if (packet->empty()) {
+    return false;
+  }
+  size_t ip_length;
+  switch ((*packet)[0]) {
+    case 4:
+      ip_length = QuicIpAddress::kIPv4AddressSize;
+      break;
+    case 6:
+      ip_length = QuicIpAddress::kIPv6AddressSize;
+      break;
+    default:
+      return false;
+  }
+  const size_t header_length = 3 + ip_length;
+  QuicIpAddress ip;
+  if (packet->size() < header_length ||
+      !ip.FromPackedString(packet->data() + 1, ip_length)) {
+    return false;
+  }
+  const uint16_t port =
+      (static_cast<uint16_t>(static_cast<uint8_t>((*packet)[1 + ip_length]))
+       << 8) |
+      static_cast<uint8_t>((*packet)[2 + ip_length]);
+  *client = QuicSocketAddress(ip, port);
+  packet->remove_prefix(header_length);
+  return true;
+}
+
+}  // namespace quic
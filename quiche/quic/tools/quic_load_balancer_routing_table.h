@@ -0,0 +1,108 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_TOOLS_QUIC_LOAD_BALANCER_ROUTING_TABLE_H_
+#define QUICHE_QUIC_TOOLS_QUIC_LOAD_BALANCER_ROUTING_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "quiche/quic/load_balancer/load_balancer_config.h"
+#include "quiche/quic/load_balancer/load_balancer_decoder.h"
+#include "quiche/quic/load_balancer/load_balancer_server_id_map.h"
+#include "quiche/quic/platform/api/quic_export.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+
+namespace quic {
+
+// QuicLoadBalancerRoutingTable chooses the backend of QUIC packets by the
+// QUIC-LB server ID encoded in their destination connection ID
+// (draft-ietf-quic-load-balancers), without any per-connection state. Packets
+// whose connection ID does not decode to a known server ID, such as the
+// Initials of new connections, whose connection ID the client chose, go to a
+// fallback backend chosen by a consistent hash of the connection ID. All the
+// packets of a connection attempt thus reach the same backend, whichever
+// router thread or process handles them, and few attempts move when fallback
+// backends are added or removed.
+//
+// The routing table file has one entry per line:
+//   config <config ID: 0-2> <server ID length> <nonce length> [<key: 32 hex>]
+//   backend <config ID> <server ID: hex> <host:port>
+//   fallback <host:port>
+// Empty lines and lines starting with '#' are ignored. Configs without a key
+// are unencrypted. If there are no fallback lines, all backends are fallbacks.
+// To rotate configs, add the new config and its backends under an unused
+// config ID, switch the servers to it, and remove the old config once its
+// connection IDs have gone out of use.
+//
+// Immutable, and therefore thread safe.
+class QUIC_NO_EXPORT QuicLoadBalancerRoutingTable {
+ public:
+  // Returns nullptr if |contents| is not a valid routing table file with at
+  // least one backend.
+  static std::unique_ptr<QuicLoadBalancerRoutingTable> Parse(
+      absl::string_view contents);
+
+  // Returns the destination connection ID of |packet|, which may be empty, or
+  // nullopt if |packet| is too short. The length of the connection ID of a
+  // short header packet is that of its config, or 8 bytes if the config is
+  // unknown.
+  absl::optional<absl::string_view> GetDestinationConnectionId(
+      absl::string_view packet) const;
+
+  // Sets each element of |backends| to the backend of the corresponding
+  // element of |packets|, or nullptr if it is not a QUIC packet. The server IDs
+  // of a whole batch are decoded at once. The backends are owned by the table.
+  // |packets| and |backends| must have the same size.
+  void Route(absl::Span<const absl::string_view> packets,
+             absl::Span<const QuicSocketAddress*> backends) const;
+
+  // Returns the fallback backend of |connection_id|.
+  const QuicSocketAddress& GetFallbackBackend(
+      absl::string_view connection_id) const;
+
+  size_t num_backends() const { return num_backends_; }
+  size_t num_fallback_backends() const { return fallback_backends_.size(); }
+
+ private:
+  struct Config {
+    uint8_t connection_id_len;
+    std::shared_ptr<LoadBalancerServerIdMap<QuicSocketAddress>> backends;
+  };
+
+  QuicLoadBalancerRoutingTable() = default;
+
+  LoadBalancerDecoder decoder_;
+  absl::optional<Config> configs_[kNumLoadBalancerConfigs];
+  std::vector<QuicSocketAddress> fallback_backends_;
+  size_t num_backends_ = 0;
+};
+
+// The maximum size of the forwarding header which QuicLoadBalancerRouter puts
+// in front of every packet it forwards.
+inline constexpr size_t kMaxLoadBalancerForwardingHeaderLength = 19;
+
+// Writes the forwarding header for a packet from |client| to |out|, which must
+// have room for kMaxLoadBalancerForwardingHeaderLength bytes, and returns its
+// length. The header is the IP version (4 or 6) in one byte, followed by the
+// client IP address and port in network byte order.
+QUIC_NO_EXPORT size_t WriteLoadBalancerForwardingHeader(
+    const QuicSocketAddress& client, char* out);
+
+// Removes the forwarding header from the front of |packet| and sets |client|
+// to the address in it. Returns false if |packet| does not start with a valid
+// forwarding header. QuicServer calls this on every packet from the router
+// address set with QuicServer::set_load_balancer_router_address(), and replies
+// to |client|.
+QUIC_NO_EXPORT bool StripLoadBalancerForwardingHeader(
+    absl::string_view* packet, QuicSocketAddress* client);
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TOOLS_QUIC_LOAD_BALANCER_ROUTING_TABLE_H_
@@ -0,0 +1,247 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/quic_load_balancer_routing_table.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "quiche/quic/platform/api/quic_test.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+// The keys and connection IDs are those of the QUIC-LB decoder tests.
+constexpr char kRoutingTable[] =
+    "# Config 0 has 3 byte server IDs and 8 byte connection IDs.\n"
+    "config 0 3 4 8f95f09245765f80256934e50c66207f\n"
+    "backend 0 ed793a 127.0.0.1:1000\n"
+    "backend 0 010203 127.0.0.1:1001\n"
+    "\n"
+    "config 1 10 5 8f95f09245765f80256934e50c66207f\n"
+    "backend 1 ed793a51d49b8f5fab65 [::1]:1002\n"
+    "fallback 127.0.0.1:2000\n"
+    "fallback 127.0.0.1:2001\n"
+    "fallback 127.0.0.1:2002\n";
+// Server ID ed793a of config 0.
+constexpr char kConnectionId0[] = "0741 26ee 38bf 5454";
+// Server ID ed793a51d49b8f5fab65 of config 1.
+constexpr char kConnectionId1[] = "4fcd 3f57 2d4e efb0 46fd b51d 164e fccc";
+
+std::string Bytes(absl::string_view hex) {
+  std::string stripped;
+  for (char c : hex) {
+    if (c != ' ') {
+      stripped.push_back(c);
+    }
+  }
+  return absl::HexStringToBytes(stripped);
+}
+
+std::string ShortHeaderPacket(absl::string_view connection_id) {
+  return absl::StrCat(Bytes("41"), connection_id, "payload");
+}
+
+std::string LongHeaderPacket(absl::string_view version,
+                             absl::string_view connection_id) {
+  return absl::StrCat(Bytes("c0"), version,
+                      std::string(1, static_cast<char>(connection_id.size())),
+                      connection_id, Bytes("00"), "payload");
+}
+
+QuicSocketAddress Address(absl::string_view host, uint16_t port) {
+  QuicIpAddress ip;
+  EXPECT_TRUE(ip.FromString(std::string(host)));
+  return QuicSocketAddress(ip, port);
+}
+
+class QuicLoadBalancerRoutingTableTest : public QuicTest {
+ protected:
+  QuicLoadBalancerRoutingTableTest()
+      : table_(QuicLoadBalancerRoutingTable::Parse(kRoutingTable)) {}
+
+  // Returns the backend of |packet|, or an uninitialized address if the
+  // packet is dropped.
+  QuicSocketAddress Route(const std::string& packet) {
+    const absl::string_view packets[] = {packet};
+    const QuicSocketAddress* backends[1];
+    table_->Route(packets, absl::MakeSpan(backends));
+    return backends[0] == nullptr ? QuicSocketAddress() : *backends[0];
+  }
+
+  std::unique_ptr<QuicLoadBalancerRoutingTable> table_;
+};
+
+TEST_F(QuicLoadBalancerRoutingTableTest, Parse) {
+  ASSERT_NE(nullptr, table_);
+  EXPECT_EQ(3u, table_->num_backends());
+  EXPECT_EQ(3u, table_->num_fallback_backends());
+
+  // Without fallback lines, all the backends are fallbacks.
+  std::unique_ptr<QuicLoadBalancerRoutingTable> table =
+      QuicLoadBalancerRoutingTable::Parse(
+          "config 2 3 4\nbackend 2 010203 127.0.0.1:1000\n");
+  ASSERT_NE(nullptr, table);
+  EXPECT_EQ(1u, table->num_fallback_backends());
+
+  for (const char* contents : {
+           "",
+           "# No backends\nconfig 0 3 4\n",
+           "config 3 3 4\nfallback 127.0.0.1:1000\n",
+           "config 0 3 4 8f95f092\nfallback 127.0.0.1:1000\n",
+           "config 0 3 4\nconfig 0 3 4\nfallback 127.0.0.1:1000\n",
+           "backend 0 010203 127.0.0.1:1000\n",
+           "config 0 3 4\nbackend 0 0102 127.0.0.1:1000\n",
+           "config 0 3 4\nbackend 0 010203 127.0.0.1\n",
+           "config 0 3 4\nbackend 0 010203 127.0.0.1:1000\n"
+           "backend 0 010203 127.0.0.1:1001\n",
+           "fallback localhost:1000\n",
+           "fallback 127.0.0.1:100000\n",
+           "route 127.0.0.1:1000\n",
+       }) {
+    SCOPED_TRACE(contents);
+    EXPECT_EQ(nullptr, QuicLoadBalancerRoutingTable::Parse(contents));
+  }
+}
+
+TEST_F(QuicLoadBalancerRoutingTableTest, RoutesByServerId) {
+  ASSERT_NE(nullptr, table_);
+  EXPECT_EQ(Address("127.0.0.1", 1000),
+            Route(ShortHeaderPacket(Bytes(kConnectionId0))));
+  EXPECT_EQ(Address("::1", 1002),
+            Route(ShortHeaderPacket(Bytes(kConnectionId1))));
+  // Long header packets carry server chosen connection IDs too, e.g. after a
+  // Retry.
+  EXPECT_EQ(Address("127.0.0.1", 1000),
+            Route(LongHeaderPacket(Bytes("00000001"), Bytes(kConnectionId0))));
+  // Google QUIC, with 4 bit connection ID lengths.
+  EXPECT_EQ(Address("127.0.0.1", 1000),
+            Route(absl::StrCat(Bytes("c0"), "Q046", Bytes("50"),
+                               Bytes(kConnectionId0), "payload")));
+  // Google QUIC before version 46.
+  EXPECT_EQ(Address("127.0.0.1", 1000),
+            Route(absl::StrCat(Bytes("08"), Bytes(kConnectionId0), "payload")));
+}
+
+TEST_F(QuicLoadBalancerRoutingTableTest, FallsBackToConsistentHash) {
+  ASSERT_NE(nullptr, table_);
+  // Client chosen connection IDs of Initials, an unknown server ID, an
+  // unroutable connection ID and an unknown config all go to the fallbacks.
+  const std::string connection_ids[] = {
+      Bytes("0102 0304 0506 0708"),
+      Bytes("8102 0304 0506 0708 090a"),
+      Bytes("0741 26ee 38bf 5455"),
+      Bytes("c102 0304 0506 0708"),
+  };
+  for (const std::string& connection_id : connection_ids) {
+    SCOPED_TRACE(absl::BytesToHexString(connection_id));
+    const QuicSocketAddress backend = table_->GetFallbackBackend(connection_id);
+    EXPECT_GE(backend.port(), 2000);
+    EXPECT_LE(backend.port(), 2002);
+    // Every packet of a connection attempt goes to the same backend.
+    EXPECT_EQ(backend, Route(LongHeaderPacket(Bytes("00000001"),
+                                              connection_id)));
+    if (connection_id.size() == 8) {
+      EXPECT_EQ(backend, Route(ShortHeaderPacket(connection_id)));
+    }
+  }
+}
+
+TEST_F(QuicLoadBalancerRoutingTableTest, ConsistentHashMovesFewConnections) {
+  std::string contents;
+  for (int i = 0; i < 10; ++i) {
+    absl::StrAppend(&contents, "fallback 127.0.0.1:", 2000 + i, "\n");
+  }
+  std::unique_ptr<QuicLoadBalancerRoutingTable> table10 =
+      QuicLoadBalancerRoutingTable::Parse(contents);
+  absl::StrAppend(&contents, "fallback 127.0.0.1:2010\n");
+  std::unique_ptr<QuicLoadBalancerRoutingTable> table11 =
+      QuicLoadBalancerRoutingTable::Parse(contents);
+  ASSERT_NE(nullptr, table10);
+  ASSERT_NE(nullptr, table11);
+
+  const int kNumConnectionIds = 10000;
+  int moved = 0;
+  for (int i = 0; i < kNumConnectionIds; ++i) {
+    const std::string connection_id = absl::StrCat("cid", i);
+    const QuicSocketAddress& backend11 =
+        table11->GetFallbackBackend(connection_id);
+    if (table10->GetFallbackBackend(connection_id) != backend11) {
+      // Connections only move to the new backend.
+      EXPECT_EQ(2010, backend11.port());
+      ++moved;
+    }
+  }
+  // About 1 in 11 connections move.
+  EXPECT_GT(moved, kNumConnectionIds / 15);
+  EXPECT_LT(moved, kNumConnectionIds / 8);
+}
+
+TEST_F(QuicLoadBalancerRoutingTableTest, DropsInvalidPackets) {
+  ASSERT_NE(nullptr, table_);
+  for (const std::string& packet : {
+           std::string(),
+           Bytes("41"),
+           // Too short for the connection ID of its config.
+           ShortHeaderPacket(Bytes("4fcd 3f57")).substr(0, 8),
+           // Google QUIC without a connection ID.
+           absl::StrCat(Bytes("00"), "payload"),
+           Bytes("c0000000"),
+           absl::StrCat(Bytes("c000 0000 0108"), "short"),
+       }) {
+    SCOPED_TRACE(absl::BytesToHexString(packet));
+    EXPECT_FALSE(Route(packet).IsInitialized());
+  }
+}
+
+TEST_F(QuicLoadBalancerRoutingTableTest, RoutesBatches) {
+  ASSERT_NE(nullptr, table_);
+  std::vector<std::string> packet_storage;
+  const char* connection_ids[] = {kConnectionId0, kConnectionId1,
+                                  "0102030405060708"};
+  for (int i = 0; i < 100; ++i) {
+    packet_storage.push_back(ShortHeaderPacket(Bytes(connection_ids[i % 3])));
+  }
+  packet_storage.push_back(Bytes("41"));
+  std::vector<absl::string_view> packets(packet_storage.begin(),
+                                         packet_storage.end());
+  std::vector<const QuicSocketAddress*> backends(packets.size());
+  table_->Route(packets, absl::MakeSpan(backends));
+  for (size_t i = 0; i < 100; ++i) {
+    SCOPED_TRACE(i);
+    ASSERT_NE(nullptr, backends[i]);
+    EXPECT_EQ(*backends[i], Route(packet_storage[i]));
+  }
+  EXPECT_EQ(nullptr, backends[100]);
+}
+
+TEST_F(QuicLoadBalancerRoutingTableTest, ForwardingHeader) {
+  for (const QuicSocketAddress& client :
+       {Address("192.0.2.1", 443), Address("2001:db8::1", 65535)}) {
+    SCOPED_TRACE(client.ToString());
+    char header[kMaxLoadBalancerForwardingHeaderLength];
+    const size_t length = WriteLoadBalancerForwardingHeader(client, header);
+    const std::string forwarded =
+        absl::StrCat(absl::string_view(header, length), "packet");
+    absl::string_view packet = forwarded;
+    QuicSocketAddress stripped;
+    ASSERT_TRUE(StripLoadBalancerForwardingHeader(&packet, &stripped));
+    EXPECT_EQ(client, stripped);
+    EXPECT_EQ("packet", packet);
+
+    packet = absl::string_view(forwarded).substr(0, length - 1);
+    EXPECT_FALSE(StripLoadBalancerForwardingHeader(&packet, &stripped));
+  }
+  absl::string_view packet = "packet";
+  QuicSocketAddress client;
+  EXPECT_FALSE(StripLoadBalancerForwardingHeader(&packet, &client));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -0,0 +1,379 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/quic_load_generator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "quiche/quic/core/crypto/quic_client_session_cache.h"
+#include "quiche/quic/core/crypto/quic_random.h"
+#include "quiche/quic/core/http/quic_spdy_client_session.h"
+#include "quiche/quic/core/http/quic_spdy_client_stream.h"
+#include "quiche/quic/core/io/quic_default_event_loop.h"
+#include "quiche/quic/core/io/quic_event_loop.h"
+#include "quiche/quic/core/quic_default_clock.h"
+#include "quiche/quic/core/quic_stream.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+#include "quiche/quic/platform/api/quic_thread.h"
+#include "quiche/quic/tools/quic_default_client.h"
+#include "quiche/quic/tools/quic_spdy_client_base.h"
+#include "quiche/common/quiche_circular_deque.h"
+#include "quiche/spdy/core/http2_header_block.h"
+
+namespace quic {
+
+namespace {
+
+// How long an idle worker waits for I/O before it sends due requests.
+constexpr QuicTime::Delta kEventLoopTimeout =
+    QuicTime::Delta::FromMilliseconds(1);
+
+}  // namespace
+
+void QuicLoadGenerator::Results::Merge(const Results& other) {
+  requests_sent += other.requests_sent;
+  responses_ok += other.responses_ok;
+  responses_failed += other.responses_failed;
+  connections_opened += other.connections_opened;
+  connections_resumed_with_0rtt += other.connections_resumed_with_0rtt;
+  connection_errors += other.connection_errors;
+  bytes_received += other.bytes_received;
+  max_outstanding = std::max(max_outstanding, other.max_outstanding);
+  max_backlog = std::max(max_backlog, other.max_backlog);
+  elapsed = std::max(elapsed, other.elapsed);
+  latency.Merge(other.latency);
+}
+
+class QuicLoadGenerator::Worker : public QuicThread {
+ public:
+  // Runs |num_connections| of the connections, and in open-loop mode sends
+  // |requests_per_second| of the requests.
+  Worker(const Config& config, int num_connections, double requests_per_second)
+      : QuicThread("LoadGenerator"),
+        config_(config),
+        num_connections_(num_connections),
+        requests_per_second_(requests_per_second),
+        clock_(QuicDefaultClock::Get()) {
+    for (const Request& request : config_.requests) {
+      spdy::Http2HeaderBlock headers;
+      headers[":method"] = "GET";
+      headers[":scheme"] = "https";
+      headers[":authority"] = config_.server_id.host();
+      headers[":path"] = request.path;
+      request_headers_.push_back(std::move(headers));
+      total_weight_ += request.weight;
+      cumulative_weights_.push_back(total_weight_);
+    }
+  }
+
+  // Valid once the thread is joined.
+  const Results& results() const { return results_; }
+
+ protected:
+  void Run() override {
+    event_loop_ = GetDefaultEventLoop()->Create(QuicDefaultClock::Get());
+    for (int i = 0; i < num_connections_; ++i) {
+      auto connection = std::make_unique<Connection>();
+      connection->client = std::make_unique<QuicDefaultClient>(
+          config_.server_address, config_.server_id, config_.versions,
+          event_loop_.get(), config_.create_proof_verifier(),
+          config_.resume ? std::make_unique<QuicClientSessionCache>()
+                         : nullptr);
+      connection->client->set_response_listener(
+          std::make_unique<ResponseRecorder>(this, connection.get()));
+      connection->client->set_drop_response_body(true);
+      StartConnection(connection.get());
+      connections_.push_back(std::move(connection));
+    }
+
+    const bool open_loop = requests_per_second_ > 0;
+    const QuicTime::Delta request_interval =
+        QuicTime::Delta::FromMicroseconds(std::max<int64_t>(
+            1, open_loop ? static_cast<int64_t>(1e6 / requests_per_second_)
+                         : 0));
+    const QuicTime start = clock_->Now();
+    const QuicTime end = start + config_.duration;
+    QuicTime next_request = start;
+    size_t first_connection = 0;
+    for (;;) {
+      event_loop_->RunEventLoopOnce(kEventLoopTimeout);
+      const QuicTime now = clock_->Now();
+      if (now >= end) {
+        break;
+      }
+      if (open_loop) {
+        while (next_request <= now) {
+          backlog_.push_back(next_request);
+          next_request = next_request + request_interval;
+        }
+        results_.max_backlog =
+            std::max<uint64_t>(results_.max_backlog, backlog_.size());
+      }
+      // Takes turns at serving the backlog first.
+      for (size_t i = 0; i < connections_.size(); ++i) {
+        Pump(connections_[(first_connection + i) % connections_.size()].get(),
+             now);
+      }
+      first_connection = (first_connection + 1) % connections_.size();
+    }
+    results_.elapsed = clock_->Now() - start;
+
+    // Requests still outstanding are neither successes nor failures.
+    for (std::unique_ptr<Connection>& connection : connections_) {
+      connection->outstanding.clear();
+      FinishConnection(connection.get());
+      if (connection->client->initialized()) {
+        connection->client->Disconnect();
+      }
+    }
+    connections_.clear();
+    event_loop_.reset();
+  }
+
+ private:
+  struct Connection {
+    std::unique_ptr<QuicDefaultClient> client;
+    // When the outstanding requests were due, by stream.
+    absl::flat_hash_map<QuicStreamId, QuicTime> outstanding;
+    // Requests sent since the connection was opened.
+    int requests_sent = 0;
+    // Whether the session of |client| is yet to be accounted for.
+    bool open = false;
+  };
+
+  class ResponseRecorder : public QuicSpdyClientBase::ResponseListener {
+   public:
+    ResponseRecorder(Worker* worker, Connection* connection)
+        : worker_(worker), connection_(connection) {}
+
+    void OnCompleteResponse(QuicStreamId id,
+                            const spdy::Http2HeaderBlock& response_headers,
+                            const std::string& /*response_body*/) override {
+      worker_->OnResponse(connection_, id, response_headers);
+    }
+
+   private:
+    Worker* worker_;
+    Connection* connection_;
+  };
+
+  void StartConnection(Connection* connection) {
+    connection->requests_sent = 0;
+    if (!connection->client->Initialize()) {
+      // Counted as a connection error by Pump().
+      QUIC_LOG_FIRST_N(ERROR, 10) << "Failed to initialize client";
+      return;
+    }
+    connection->client->StartConnect();
+    connection->open = true;
+    ++results_.connections_opened;
+  }
+
+  // Accounts for the connection of |connection| before it is replaced.
+  void FinishConnection(Connection* connection) {
+    if (!connection->open) {
+      return;
+    }
+    connection->open = false;
+    QuicDefaultClient* client = connection->client.get();
+    QuicSpdyClientSession* session = client->client_session();
+    results_.bytes_received += session->connection()->GetStats().bytes_received;
+    if (session->OneRttKeysAvailable() && client->EarlyDataAccepted()) {
+      ++results_.connections_resumed_with_0rtt;
+    }
+    // The streams of a connection are usually closed with it, which fails
+    // their requests through OnResponse().
+    results_.responses_failed += connection->outstanding.size();
+    connection->outstanding.clear();
+  }
+
+  void Reconnect(Connection* connection) {
+    FinishConnection(connection);
+    if (connection->client->initialized()) {
+      connection->client->Disconnect();
+    }
+    StartConnection(connection);
+  }
+
+  // Sends requests on |connection| while it has free streams, and replaces it
+  // once it is closed or has sent its share of requests.
+  void Pump(Connection* connection, QuicTime now) {
+    QuicDefaultClient* client = connection->client.get();
+    if (!client->connected()) {
+      // Closed by the server, or failed, e.g. with an idle timeout.
+      ++results_.connection_errors;
+      Reconnect(connection);
+      return;
+    }
+    QuicSpdyClientSession* session = client->client_session();
+    if (!session->IsEncryptionEstablished()) {
+      // Neither resumed with 0-RTT, nor done with the handshake.
+      return;
+    }
+    RemoveFailedStreams(connection, session);
+    for (;;) {
+      if (config_.requests_per_connection > 0 &&
+          connection->requests_sent >= config_.requests_per_connection) {
+        if (connection->outstanding.empty()) {
+          Reconnect(connection);
+        }
+        return;
+      }
+      if (connection->outstanding.size() >=
+              static_cast<size_t>(config_.streams_per_connection) ||
+          !session->CanOpenNextOutgoingBidirectionalStream()) {
+        return;
+      }
+      QuicTime due = now;
+      if (requests_per_second_ > 0) {
+        if (backlog_.empty()) {
+          return;
+        }
+        due = backlog_.front();
+      }
+      QuicSpdyClientStream* stream = client->CreateClientStream();
+      if (stream == nullptr) {
+        return;
+      }
+      if (requests_per_second_ > 0) {
+        backlog_.pop_front();
+      }
+      connection->outstanding[stream->id()] = due;
+      results_.max_outstanding = std::max<uint64_t>(
+          results_.max_outstanding, connection->outstanding.size());
+      ++connection->requests_sent;
+      ++results_.requests_sent;
+      stream->SendRequest(PickRequest().Clone(), "", /*fin=*/true);
+    }
+  }
+
+  // Fails the requests of streams which are closed or reset, but which did not
+  // complete a response, so that they no longer take up a stream of
+  // |connection|.
+  void RemoveFailedStreams(Connection* connection,
+                           QuicSpdyClientSession* session) {
+    for (auto it = connection->outstanding.begin();
+         it != connection->outstanding.end();) {
+      const QuicStream* stream = session->GetActiveStream(it->first);
+      if (stream != nullptr && !stream->IsZombie() && !stream->rst_received() &&
+          !stream->rst_sent()) {
+        ++it;
+        continue;
+      }
+      ++results_.responses_failed;
+      connection->outstanding.erase(it++);
+    }
+  }
+
+  void OnResponse(Connection* connection, QuicStreamId id,
+                  const spdy::Http2HeaderBlock& response_headers) {
+    auto it = connection->outstanding.find(id);
+    if (it == connection->outstanding.end()) {
+      return;
+    }
+    const QuicTime due = it->second;
+    connection->outstanding.erase(it);
+    auto status = response_headers.find(":status");
+    int code = 0;
+    if (status == response_headers.end() ||
+        !absl::SimpleAtoi(status->second, &code) || code < 200 || code >= 300) {
+      ++results_.responses_failed;
+      return;
+    }
+    ++results_.responses_ok;
+    results_.latency.Add(clock_->Now() - due);
+  }
+
+  const spdy::Http2HeaderBlock& PickRequest() {
+    const int weight =
+        QuicRandom::GetInstance()->InsecureRandUint64() % total_weight_;
+    return request_headers_[std::upper_bound(cumulative_weights_.begin(),
+                                             cumulative_weights_.end(),
+                                             weight) -
+                            cumulative_weights_.begin()];
+  }
+
+  const Config& config_;
+  const int num_connections_;
+  const double requests_per_second_;
+  const QuicClock* clock_;
+  std::vector<spdy::Http2HeaderBlock> request_headers_;
+  std::vector<int> cumulative_weights_;
+  int total_weight_ = 0;
+  std::unique_ptr<QuicEventLoop> event_loop_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+  // Open-loop mode only: when the requests waiting for a free stream were due.
+  quiche::QuicheCircularDeque<QuicTime> backlog_;
+  Results results_;
+};
+
+// static
+absl::optional<std::vector<QuicLoadGenerator::Request>>
+QuicLoadGenerator::ParseRequests(absl::string_view requests) {
+  std::vector<Request> result;
+  for (absl::string_view entry :
+       absl::StrSplit(requests, ',', absl::SkipEmpty())) {
+    Request request;
+    absl::string_view path = entry;
+    const size_t colon = entry.rfind(':');
+    if (colon != absl::string_view::npos) {
+      if (!absl::SimpleAtoi(entry.substr(colon + 1), &request.weight) ||
+          request.weight <= 0) {
+        return absl::nullopt;
+      }
+      path = entry.substr(0, colon);
+    }
+    if (path.empty() || path[0] != '/') {
+      return absl::nullopt;
+    }
+    request.path = std::string(path);
+    result.push_back(std::move(request));
+  }
+  if (result.empty()) {
+    return absl::nullopt;
+  }
+  return result;
+}
+
+QuicLoadGenerator::QuicLoadGenerator(Config config)
+    : config_(std::move(config)) {}
+
+QuicLoadGenerator::~QuicLoadGenerator() = default;
+
+QuicLoadGenerator::Results QuicLoadGenerator::Run() {
+  QUICHE_DCHECK(!config_.requests.empty());
+  // Every thread runs at least one connection.
+  const int num_threads = std::clamp(config_.num_threads, 1,
+                                     std::max(1, config_.num_connections));
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (int i = 0; i < num_threads; ++i) {
+    const int num_connections = config_.num_connections / num_threads +
+                                (i < config_.num_connections % num_threads);
+    workers.push_back(std::make_unique<Worker>(
+        config_, num_connections, config_.requests_per_second / num_threads));
+  }
+  QUIC_LOG(INFO) << "Generating load on " << config_.num_connections
+                 << " connections to " << config_.server_address.ToString()
+                 << " with " << num_threads << " threads";
+  for (std::unique_ptr<Worker>& worker : workers) {
+    worker->Start();
+  }
+  Results results;
+  for (std::unique_ptr<Worker>& worker : workers) {
+    worker->Join();
+    results.Merge(worker->results());
+  }
+  return results;
+}
+
+}  // namespace quic
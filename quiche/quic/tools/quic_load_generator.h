@@ -0,0 +1,119 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_TOOLS_QUIC_LOAD_GENERATOR_H_
+#define QUICHE_QUIC_TOOLS_QUIC_LOAD_GENERATOR_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "quiche/quic/core/crypto/proof_verifier.h"
+#include "quiche/quic/core/quic_server_id.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/core/quic_versions.h"
+#include "quiche/quic/platform/api/quic_export.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/tools/quic_latency_histogram.h"
+
+namespace quic {
+
+// QuicLoadGenerator sends HTTP/3 requests to a server from many connections at
+// once, and measures the latency of the responses. Each of its worker threads
+// runs its share of the connections as QuicDefaultClients on an event loop of
+// its own.
+//
+// In closed-loop mode, every connection keeps |streams_per_connection|
+// requests outstanding. In open-loop mode, requests are due at a fixed total
+// rate regardless of how fast the server responds, and each one is sent on the
+// first connection with a free stream. Requests which find no free stream wait
+// in a backlog, and their latency includes that wait, so that a slow server
+// cannot hide its latency by slowing down the load.
+//
+// With |resume| set, every connection keeps its sessions in a
+// QuicClientSessionCache, and each new connection after the first resumes a
+// session and sends its first requests with 0-RTT.
+//
+// Linux only.
+class QUIC_NO_EXPORT QuicLoadGenerator {
+ public:
+  struct QUIC_NO_EXPORT Request {
+    std::string path;
+    // Relative frequency of the request in the mix.
+    int weight = 1;
+  };
+
+  struct QUIC_NO_EXPORT Config {
+    QuicSocketAddress server_address;
+    // The server name sent in the TLS handshake and as :authority.
+    QuicServerId server_id;
+    ParsedQuicVersionVector versions;
+    std::function<std::unique_ptr<ProofVerifier>()> create_proof_verifier;
+
+    int num_threads = 1;
+    // Across all threads.
+    int num_connections = 1;
+    // Maximum number of outstanding requests of each connection.
+    int streams_per_connection = 1;
+    // Requests per second across all connections in open-loop mode, or 0 for
+    // closed-loop mode.
+    double requests_per_second = 0;
+    // Connections are closed and replaced after this many requests, or never
+    // if 0.
+    int requests_per_connection = 0;
+    bool resume = true;
+    QuicTime::Delta duration = QuicTime::Delta::FromSeconds(10);
+    std::vector<Request> requests;
+  };
+
+  struct QUIC_NO_EXPORT Results {
+    uint64_t requests_sent = 0;
+    // Responses with a 2xx status.
+    uint64_t responses_ok = 0;
+    // Other responses, reset streams, and requests outstanding on a
+    // connection which closed.
+    uint64_t responses_failed = 0;
+    uint64_t connections_opened = 0;
+    // Connections which sent early data that the server accepted.
+    uint64_t connections_resumed_with_0rtt = 0;
+    // Connections closed other than by the load generator.
+    uint64_t connection_errors = 0;
+    uint64_t bytes_received = 0;
+    // The most requests outstanding on one connection at once.
+    uint64_t max_outstanding = 0;
+    // Open-loop mode only: the longest backlog of due requests of a thread.
+    uint64_t max_backlog = 0;
+    QuicTime::Delta elapsed = QuicTime::Delta::Zero();
+    // Latency of the successful requests.
+    QuicLatencyHistogram latency;
+
+    void Merge(const Results& other);
+  };
+
+  // Parses a request mix of the form "path[:weight],...", e.g.
+  // "/index.html:3,/style.css". Returns nullopt if it is malformed.
+  static absl::optional<std::vector<Request>> ParseRequests(
+      absl::string_view requests);
+
+  explicit QuicLoadGenerator(Config config);
+  QuicLoadGenerator(const QuicLoadGenerator&) = delete;
+  QuicLoadGenerator& operator=(const QuicLoadGenerator&) = delete;
+  ~QuicLoadGenerator();
+
+  // Generates load for |duration|, and returns the results of all threads.
+  Results Run();
+
+ private:
+  class Worker;
+
+  const Config config_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TOOLS_QUIC_LOAD_GENERATOR_H_
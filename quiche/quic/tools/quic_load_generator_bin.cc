@@ -0,0 +1,195 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Generates HTTP/3 load with QuicLoadGenerator, and prints one line of JSON
+// with the request counts and latency percentiles when done, in the format of
+// the benchmarks. For example, against a local server which generates its
+// responses:
+//   quic_server --generate_dynamic_responses &
+//   quic_load_generator --disable_certificate_verification --connections=1000 \
+//       --requests=/1000:9,/100000:1 --requests_per_second=20000
+//
+// Without --requests_per_second, every connection keeps
+// --streams_per_connection requests outstanding. With
+// --requests_per_connection, connections are replaced after that many requests
+// and resume their sessions with 0-RTT, unless --resume is false.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "quiche/quic/core/crypto/proof_verifier.h"
+#include "quiche/quic/core/quic_server_id.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/core/quic_versions.h"
+#include "quiche/quic/platform/api/quic_default_proof_providers.h"
+#include "quiche/quic/platform/api/quic_ip_address.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/test_tools/quic_benchmark_utils.h"
+#include "quiche/quic/tools/fake_proof_verifier.h"
+#include "quiche/quic/tools/quic_load_generator.h"
+#include "quiche/common/platform/api/quiche_command_line_flags.h"
+#include "quiche/common/platform/api/quiche_system_event_loop.h"
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(std::string, host, "127.0.0.1",
+                                "The IP address of the server.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(int32_t, port, 6121,
+                                "The port of the server.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    std::string, server_name, "www.example.org",
+    "The server name sent in the TLS handshake and as :authority.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    std::string, quic_version, "",
+    "QUIC versions to offer, e.g. \"h3\". If not set, all supported HTTP/3 "
+    "versions are offered.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    bool, disable_certificate_verification, false,
+    "If true, don't verify the server certificate.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, threads, 0,
+    "Number of threads, each with an event loop of its own. If 0, one per "
+    "core.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(int32_t, connections, 100,
+                                "Number of concurrent connections.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, streams_per_connection, 1,
+    "Maximum number of outstanding requests of each connection.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    double, requests_per_second, 0,
+    "Total rate of requests in open-loop mode. If 0, each connection sends a "
+    "new request as soon as one of its requests completes.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, requests_per_connection, 0,
+    "If not 0, connections are replaced after this many requests.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    bool, resume, true,
+    "If true, connections resume their previous sessions with 0-RTT.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(int32_t, duration_seconds, 10,
+                                "How long to generate load for.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    std::string, requests, "/",
+    "The request mix, as comma separated paths with optional relative "
+    "weights, e.g. \"/index.html:3,/style.css\".");
+
+int main(int argc, char* argv[]) {
+  quiche::QuicheSystemEventLoop event_loop("quic_load_generator");
+  const char* usage = "Usage: quic_load_generator [options]";
+  std::vector<std::string> non_option_args =
+      quiche::QuicheParseCommandLineFlags(usage, argc, argv);
+  if (!non_option_args.empty()) {
+    quiche::QuichePrintCommandLineFlagHelp(usage);
+    exit(0);
+  }
+
+  quic::QuicLoadGenerator::Config config;
+  quic::QuicIpAddress host;
+  if (!host.FromString(quiche::GetQuicheCommandLineFlag(FLAGS_host))) {
+    QUIC_LOG(ERROR) << "Invalid --host";
+    return 1;
+  }
+  const int port = quiche::GetQuicheCommandLineFlag(FLAGS_port);
+  config.server_address = quic::QuicSocketAddress(host, port);
+  config.server_id = quic::QuicServerId(
+      quiche::GetQuicheCommandLineFlag(FLAGS_server_name), port,
+      /*privacy_mode_enabled=*/false);
+  const std::string versions =
+      quiche::GetQuicheCommandLineFlag(FLAGS_quic_version);
+  config.versions = versions.empty()
+                        ? quic::CurrentSupportedHttp3Versions()
+                        : quic::ParseQuicVersionVectorString(versions);
+  if (config.versions.empty()) {
+    QUIC_LOG(ERROR) << "No supported version in --quic_version";
+    return 1;
+  }
+  if (quiche::GetQuicheCommandLineFlag(
+          FLAGS_disable_certificate_verification)) {
+    config.create_proof_verifier =
+        []() -> std::unique_ptr<quic::ProofVerifier> {
+      return std::make_unique<quic::FakeProofVerifier>();
+    };
+  } else {
+    config.create_proof_verifier = []() {
+      return quic::CreateDefaultProofVerifier(
+          quiche::GetQuicheCommandLineFlag(FLAGS_server_name));
+    };
+  }
+
+  config.num_threads = quiche::GetQuicheCommandLineFlag(FLAGS_threads);
+  if (config.num_threads <= 0) {
+    config.num_threads = std::thread::hardware_concurrency();
+  }
+  config.num_connections = quiche::GetQuicheCommandLineFlag(FLAGS_connections);
+  config.streams_per_connection =
+      quiche::GetQuicheCommandLineFlag(FLAGS_streams_per_connection);
+  config.requests_per_second =
+      quiche::GetQuicheCommandLineFlag(FLAGS_requests_per_second);
+  config.requests_per_connection =
+      quiche::GetQuicheCommandLineFlag(FLAGS_requests_per_connection);
+  config.resume = quiche::GetQuicheCommandLineFlag(FLAGS_resume);
+  config.duration = quic::QuicTime::Delta::FromSeconds(
+      quiche::GetQuicheCommandLineFlag(FLAGS_duration_seconds));
+  absl::optional<std::vector<quic::QuicLoadGenerator::Request>> requests =
+      quic::QuicLoadGenerator::ParseRequests(
+          quiche::GetQuicheCommandLineFlag(FLAGS_requests));
+  if (!requests.has_value()) {
+    QUIC_LOG(ERROR) << "Invalid --requests";
+    return 1;
+  }
+  config.requests = *std::move(requests);
+  if (config.num_connections <= 0 || config.streams_per_connection <= 0 ||
+      config.duration <= quic::QuicTime::Delta::Zero()) {
+    QUIC_LOG(ERROR) << "--connections, --streams_per_connection and "
+                       "--duration_seconds must be positive";
+    return 1;
+  }
+
+  const int num_threads = config.num_threads;
+  quic::QuicLoadGenerator generator(std::move(config));
+  const quic::QuicLoadGenerator::Results results = generator.Run();
+  const double seconds = results.elapsed.ToMicroseconds() / 1e6;
+  const auto millis = [](quic::QuicTime::Delta latency) {
+    return latency.ToMicroseconds() / 1e3;
+  };
+  quic::test::PrintBenchmarkResult(
+      quic::test::QuicBenchmarkResult("load_generator")
+          .AddMetric("threads", num_threads)
+          .AddMetric("seconds", seconds)
+          .AddMetric("requests_sent", results.requests_sent)
+          .AddMetric("responses_ok", results.responses_ok)
+          .AddMetric("responses_failed", results.responses_failed)
+          .AddMetric("responses_per_second", results.responses_ok / seconds)
+          .AddMetric("connections_opened", results.connections_opened)
+          .AddMetric("connections_resumed_with_0rtt",
+                     results.connections_resumed_with_0rtt)
+          .AddMetric("connection_errors", results.connection_errors)
+          .AddMetric("received_mbps",
+                     results.bytes_received * 8 / seconds / 1e6)
+          .AddMetric("max_outstanding", results.max_outstanding)
+          .AddMetric("max_backlog", results.max_backlog)
+          .AddMetric("latency_mean_ms", millis(results.latency.Mean()))
+          .AddMetric("latency_p50_ms", millis(results.latency.Percentile(0.5)))
+          .AddMetric("latency_p90_ms", millis(results.latency.Percentile(0.9)))
+          .AddMetric("latency_p99_ms",
+                     millis(results.latency.Percentile(0.99)))
+          .AddMetric("latency_p999_ms",
+                     millis(results.latency.Percentile(0.999)))
+          .AddMetric("latency_max_ms", millis(results.latency.max())));
+  return results.responses_ok > 0 ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/quic_load_generator.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "quiche/quic/core/quic_error_codes.h"
+#include "quiche/quic/core/quic_server_id.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/core/quic_versions.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/platform/api/quic_test_loopback.h"
+#include "quiche/quic/test_tools/crypto_test_utils.h"
+#include "quiche/quic/test_tools/server_thread.h"
+#include "quiche/quic/tools/quic_memory_cache_backend.h"
+#include "quiche/quic/tools/quic_server.h"
+#include "quiche/spdy/core/http2_header_block.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+constexpr char kHost[] = "test.example.com";
+
+// Resets the streams of requests for /reset instead of responding.
+class ResettingBackend : public QuicMemoryCacheBackend {
+ public:
+  void FetchResponseFromBackend(
+      const spdy::Http2HeaderBlock& request_headers,
+      const std::string& request_body,
+      QuicSimpleServerBackend::RequestHandler* request_handler) override {
+    auto path = request_headers.find(":path");
+    if (path != request_headers.end() && path->second == "/reset") {
+      request_handler->TerminateStreamWithError(
+          QuicResetStreamError::FromInternal(QUIC_STREAM_CANCELLED));
+      return;
+    }
+    QuicMemoryCacheBackend::FetchResponseFromBackend(
+        request_headers, request_body, request_handler);
+  }
+};
+
+// Generates load on a QuicServer on the loopback address.
+class QuicLoadGeneratorLoopbackTest : public QuicTest {
+ protected:
+  QuicLoadGeneratorLoopbackTest() {
+    backend_.AddSimpleResponse(kHost, "/foo", 200, "bar");
+    server_thread_ = std::make_unique<ServerThread>(
+        std::make_unique<QuicServer>(
+            crypto_test_utils::ProofSourceForTesting(), &backend_),
+        QuicSocketAddress(TestLoopback4(), 0));
+    server_thread_->Initialize();
+    server_thread_->Start();
+  }
+
+  ~QuicLoadGeneratorLoopbackTest() override {
+    server_thread_->Quit();
+    server_thread_->Join();
+  }
+
+  QuicLoadGenerator::Config CreateConfig(std::string path) {
+    QuicLoadGenerator::Config config;
+    config.server_address =
+        QuicSocketAddress(TestLoopback4(), server_thread_->GetPort());
+    config.server_id = QuicServerId(kHost, server_thread_->GetPort(), false);
+    config.versions = AllSupportedVersions();
+    config.create_proof_verifier = []() {
+      return crypto_test_utils::ProofVerifierForTesting();
+    };
+    config.duration = QuicTime::Delta::FromSeconds(1);
+    config.requests.push_back({std::move(path), 1});
+    return config;
+  }
+
+  ResettingBackend backend_;
+  std::unique_ptr<ServerThread> server_thread_;
+};
+
+TEST(QuicLoadGeneratorTest, ParseRequests) {
+  absl::optional<std::vector<QuicLoadGenerator::Request>> requests =
+      QuicLoadGenerator::ParseRequests("/index.html:3,/style.css,/a:b:2,");
+  ASSERT_TRUE(requests.has_value());
+  ASSERT_EQ(3u, requests->size());
+  EXPECT_EQ("/index.html", (*requests)[0].path);
+  EXPECT_EQ(3, (*requests)[0].weight);
+  EXPECT_EQ("/style.css", (*requests)[1].path);
+  EXPECT_EQ(1, (*requests)[1].weight);
+  EXPECT_EQ("/a:b", (*requests)[2].path);
+  EXPECT_EQ(2, (*requests)[2].weight);
+}
+
+TEST(QuicLoadGeneratorTest, ParseMalformedRequests) {
+  EXPECT_FALSE(QuicLoadGenerator::ParseRequests("").has_value());
+  EXPECT_FALSE(QuicLoadGenerator::ParseRequests("index.html").has_value());
+  EXPECT_FALSE(QuicLoadGenerator::ParseRequests("/:0").has_value());
+  EXPECT_FALSE(QuicLoadGenerator::ParseRequests("/a:-1").has_value());
+  EXPECT_FALSE(QuicLoadGenerator::ParseRequests(":3").has_value());
+}
+
+TEST_F(QuicLoadGeneratorLoopbackTest, ClosedLoop) {
+  QuicLoadGenerator::Config config = CreateConfig("/foo");
+  config.num_connections = 2;
+  config.streams_per_connection = 2;
+  // Connections are replaced, and resume their sessions with 0-RTT.
+  config.requests_per_connection = 4;
+  config.resume = true;
+  QuicLoadGenerator generator(std::move(config));
+  const QuicLoadGenerator::Results results = generator.Run();
+
+  EXPECT_LT(0u, results.responses_ok);
+  EXPECT_EQ(0u, results.responses_failed);
+  EXPECT_EQ(0u, results.connection_errors);
+  EXPECT_EQ(results.responses_ok, results.latency.count());
+  // Each connection keeps |streams_per_connection| requests outstanding, and
+  // no more.
+  EXPECT_EQ(2u, results.max_outstanding);
+  EXPECT_LT(2u, results.connections_opened);
+  EXPECT_LT(0u, results.connections_resumed_with_0rtt);
+}
+
+TEST_F(QuicLoadGeneratorLoopbackTest, ResetStreamsAreFailed) {
+  QuicLoadGenerator::Config config = CreateConfig("/reset");
+  config.streams_per_connection = 1;
+  QuicLoadGenerator generator(std::move(config));
+  const QuicLoadGenerator::Results results = generator.Run();
+
+  // A reset stream gives its stream back for the next request.
+  EXPECT_LT(1u, results.requests_sent);
+  EXPECT_EQ(0u, results.responses_ok);
+  // All but the request outstanding at the end failed.
+  EXPECT_LE(results.requests_sent - 1, results.responses_failed);
+  EXPECT_EQ(1u, results.max_outstanding);
+  EXPECT_EQ(0u, results.connection_errors);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
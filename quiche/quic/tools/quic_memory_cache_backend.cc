@@ -4,6 +4,7 @@
 
 #include "quiche/quic/tools/quic_memory_cache_backend.h"
 
+#include <memory>
 #include <utility>
 
 #include "absl/strings/match.h"
@@ -22,6 +23,45 @@ using spdy::kV3LowestPriority;
 
 namespace quic {
 
+namespace {
+
+// Streams a cached response body to the request stream a chunk at a time,
+// followed by its trailers, pausing whenever the stream buffers enough of it.
+class CachedResponseProducer
+    : public QuicSimpleServerBackend::ResponseProducer {
+ public:
+  CachedResponseProducer(const QuicBackendResponse* response,
+                         QuicSimpleServerBackend::RequestHandler* quic_stream)
+      : response_(response),
+        quic_stream_(quic_stream),
+        remaining_body_(response->body()) {}
+
+  void ResumeProducing() override {
+    static constexpr size_t kChunkSize = 64 * 1024;
+    const bool has_trailers = !response_->trailers().empty();
+    while (!remaining_body_.empty()) {
+      absl::string_view chunk = remaining_body_.substr(0, kChunkSize);
+      remaining_body_.remove_prefix(chunk.size());
+      const bool fin = remaining_body_.empty() && !has_trailers;
+      if (!quic_stream_->SendResponseBodyChunk(chunk, fin)) {
+        return;
+      }
+    }
+    if (has_trailers && !trailers_sent_) {
+      trailers_sent_ = true;
+      quic_stream_->SendResponseTrailers(response_->trailers().Clone());
+    }
+  }
+
+ private:
+  const QuicBackendResponse* response_;                   // Not owned.
+  QuicSimpleServerBackend::RequestHandler* quic_stream_;  // Not owned.
+  absl::string_view remaining_body_;
+  bool trailers_sent_ = false;
+};
+
+}  // namespace
+
 QuicMemoryCacheBackend::ResourceFile::ResourceFile(const std::string& file_name)
     : file_name_(file_name) {}
 
@@ -36,21 +76,25 @@ void QuicMemoryCacheBackend::ResourceFile::Read() {
     return;
   }
   file_contents_ = *maybe_file_contents;
+  Parse(file_contents_);
+}
 
+void QuicMemoryCacheBackend::ResourceFile::Parse(
+    absl::string_view file_contents) {
   // First read the headers.
   size_t start = 0;
-  while (start < file_contents_.length()) {
-    size_t pos = file_contents_.find('\n', start);
+  while (start < file_contents.length()) {
+    size_t pos = file_contents.find('\n', start);
     if (pos == std::string::npos) {
       QUIC_LOG(DFATAL) << "Headers invalid or empty, ignoring: " << file_name_;
       return;
     }
     size_t len = pos - start;
     // Support both dos and unix line endings for convenience.
-    if (file_contents_[pos - 1] == '\r') {
+    if (file_contents[pos - 1] == '\r') {
       len -= 1;
     }
-    absl::string_view line(file_contents_.data() + start, len);
+    absl::string_view line(file_contents.data() + start, len);
     start = pos + 1;
     // Headers end with an empty line.
     if (line.empty()) {
@@ -107,8 +151,7 @@ void QuicMemoryCacheBackend::ResourceFile::Read() {
     }
   }
 
-  body_ = absl::string_view(file_contents_.data() + start,
-                            file_contents_.size() - start);
+  body_ = file_contents.substr(start);
 }
 
 void QuicMemoryCacheBackend::ResourceFile::SetHostPathFromBase(
@@ -357,7 +400,29 @@ void QuicMemoryCacheBackend::FetchResponseFromBackend(
   QUIC_DVLOG(1)
       << "Fetching QUIC response from backend in-memory cache for url "
       << request_url;
-  quic_stream->OnResponseBackendComplete(quic_response);
+  if (quic_response == nullptr ||
+      quic_response->response_type() !=
+          QuicBackendResponse::REGULAR_RESPONSE ||
+      !quic_response->delay().IsZero()) {
+    quic_stream->OnResponseBackendComplete(quic_response);
+    return;
+  }
+
+  for (const auto& headers : quic_response->early_hints()) {
+    quic_stream->SendResponseHeaders(headers.Clone(), /*fin=*/false);
+  }
+  const bool headers_only =
+      quic_response->body().empty() && quic_response->trailers().empty();
+  quic_stream->SendResponseHeaders(quic_response->headers().Clone(),
+                                   /*fin=*/headers_only);
+  if (headers_only) {
+    return;
+  }
+  auto producer =
+      std::make_unique<CachedResponseProducer>(quic_response, quic_stream);
+  CachedResponseProducer* producer_ptr = producer.get();
+  quic_stream->SetResponseProducer(std::move(producer));
+  producer_ptr->ResumeProducing();
 }
 
 // The memory cache does not have a per-stream handler
@@ -40,6 +40,10 @@ class QuicMemoryCacheBackend : public QuicSimpleServerBackend {
 
     void Read();
 
+    // Parses the headers and body of |file_contents|, which must outlive this
+    // object.  Read() calls this on the contents it read.
+    void Parse(absl::string_view file_contents);
+
     // |base| is |file_name_| with |cache_directory| prefix stripped.
     void SetHostPathFromBase(absl::string_view base);
 
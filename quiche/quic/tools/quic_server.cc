@@ -7,6 +7,7 @@
 #include <cstdint>
 #include <memory>
 
+#include "absl/strings/string_view.h"
 #include "quiche/quic/core/crypto/crypto_handshake.h"
 #include "quiche/quic/core/crypto/quic_random.h"
 #include "quiche/quic/core/io/event_loop_socket_factory.h"
@@ -21,11 +22,14 @@
 #include "quiche/quic/core/quic_dispatcher.h"
 #include "quiche/quic/core/quic_packet_reader.h"
 #include "quiche/quic/core/quic_packets.h"
+#include "quiche/quic/core/quic_process_packet_interface.h"
 #include "quiche/quic/platform/api/quic_flags.h"
 #include "quiche/quic/platform/api/quic_logging.h"
+#include "quiche/quic/tools/quic_load_balancer_routing_table.h"
 #include "quiche/quic/tools/quic_simple_crypto_server_stream_helper.h"
 #include "quiche/quic/tools/quic_simple_dispatcher.h"
 #include "quiche/quic/tools/quic_simple_server_backend.h"
+#include "quiche/common/pooled_buffer_allocator.h"
 #include "quiche/common/simple_buffer_allocator.h"
 
 namespace quic {
@@ -34,10 +38,58 @@ namespace {
 
 const char kSourceAddressTokenSecret[] = "secret";
 
+std::unique_ptr<QuicConnectionHelperInterface> CreateConnectionHelper() {
+  if (!GetQuicFlag(quic_server_pool_send_buffers)) {
+    return std::make_unique<QuicDefaultConnectionHelper>();
+  }
+  // The dispatcher only uses the helper on the thread of the event loop, so
+  // the pool does not need to be thread-safe.
+  return std::make_unique<QuicDefaultConnectionHelper>(
+      std::make_unique<quiche::PooledBufferAllocator>());
+}
+
 }  // namespace
 
 const size_t kNumSessionsToCreatePerSocketEvent = 16;
 
+// Passes the packets from a QuicLoadBalancerRouter to the dispatcher as if they
+// came from the client address in their forwarding header.
+class QuicServer::ForwardedPacketProcessor : public ProcessPacketInterface {
+ public:
+  ForwardedPacketProcessor(const QuicSocketAddress& router_address,
+                           ProcessPacketInterface* processor)
+      : router_address_(router_address.Normalized()), processor_(processor) {}
+
+  void ProcessPacket(const QuicSocketAddress& self_address,
+                     const QuicSocketAddress& peer_address,
+                     const QuicReceivedPacket& packet) override {
+    if (peer_address.Normalized() != router_address_) {
+      processor_->ProcessPacket(self_address, peer_address, packet);
+      return;
+    }
+    absl::string_view data(packet.data(), packet.length());
+    QuicSocketAddress client_address;
+    if (!StripLoadBalancerForwardingHeader(&data, &client_address)) {
+      QUIC_DVLOG(1) << "Dropping packet without forwarding header from "
+                    << peer_address;
+      return;
+    }
+    QuicReceivedPacket forwarded_packet(
+        data.data(), data.length(), packet.receipt_time(),
+        /*owns_buffer=*/false, packet.ttl(), packet.ttl() >= 0,
+        packet.packet_headers(), packet.headers_length(),
+        /*owns_header_buffer=*/false);
+    processor_->ProcessPacket(self_address, client_address, forwarded_packet);
+  }
+
+  void OnReadBurstStart() override { processor_->OnReadBurstStart(); }
+  void OnReadBurstEnd() override { processor_->OnReadBurstEnd(); }
+
+ private:
+  const QuicSocketAddress router_address_;
+  ProcessPacketInterface* const processor_;
+};
+
 QuicServer::QuicServer(std::unique_ptr<ProofSource> proof_source,
                        QuicSimpleServerBackend* quic_simple_server_backend)
     : QuicServer(std::move(proof_source), quic_simple_server_backend,
@@ -148,6 +200,10 @@ bool QuicServer::CreateUDPSocketAndListen(const QuicSocketAddress& address) {
   }
   dispatcher_.reset(CreateQuicDispatcher());
   dispatcher_->InitializeWithWriter(CreateWriter(fd_));
+  if (load_balancer_router_address_.IsInitialized()) {
+    forwarded_packet_processor_ = std::make_unique<ForwardedPacketProcessor>(
+        load_balancer_router_address_, dispatcher_.get());
+  }
 
   return true;
 }
@@ -159,7 +215,7 @@ QuicPacketWriter* QuicServer::CreateWriter(int fd) {
 QuicDispatcher* QuicServer::CreateQuicDispatcher() {
   return new QuicSimpleDispatcher(
       &config_, &crypto_config_, &version_manager_,
-      std::make_unique<QuicDefaultConnectionHelper>(),
+      CreateConnectionHelper(),
       std::unique_ptr<QuicCryptoServerStreamBase::Helper>(
           new QuicSimpleCryptoServerStreamHelper()),
       event_loop_->CreateAlarmFactory(), quic_simple_server_backend_,
@@ -187,6 +243,7 @@ void QuicServer::Shutdown() {
     dispatcher_->Shutdown();
   }
 
+  forwarded_packet_processor_.reset();
   dispatcher_.reset();
   event_loop_.reset();
 }
@@ -200,10 +257,14 @@ void QuicServer::OnSocketEvent(QuicEventLoop* /*event_loop*/,
 
     dispatcher_->ProcessBufferedChlos(kNumSessionsToCreatePerSocketEvent);
 
+    ProcessPacketInterface* processor = dispatcher_.get();
+    if (forwarded_packet_processor_ != nullptr) {
+      processor = forwarded_packet_processor_.get();
+    }
     bool more_to_read = true;
     while (more_to_read) {
       more_to_read = packet_reader_->ReadAndDispatchPackets(
-          fd_, port_, *QuicDefaultClock::Get(), dispatcher_.get(),
+          fd_, port_, *QuicDefaultClock::Get(), processor,
           overflow_supported_ ? &packets_dropped_ : nullptr);
     }
 
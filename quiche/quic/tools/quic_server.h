@@ -77,6 +77,17 @@ class QuicServer : public QuicSpdyServerBase, public QuicSocketEventListener {
     crypto_config_.set_pre_shared_key(key);
   }
 
+  // Makes the server accept the packets which a QuicLoadBalancerRouter
+  // forwards to it from |address|, the address the router listens and sends
+  // on: the forwarding header of these packets is stripped, and the client
+  // address in it is used as the peer address. Packets from |address| without
+  // a valid header are dropped. Packets from other addresses, e.g. from
+  // clients talking to the server address directly, are not modified. Must be
+  // called before CreateUDPSocketAndListen().
+  void set_load_balancer_router_address(const QuicSocketAddress& address) {
+    load_balancer_router_address_ = address;
+  }
+
   bool overflow_supported() { return overflow_supported_; }
 
   QuicPacketCount packets_dropped() { return packets_dropped_; }
@@ -116,6 +127,8 @@ class QuicServer : public QuicSpdyServerBase, public QuicSocketEventListener {
  private:
   friend class quic::test::QuicServerPeer;
 
+  class ForwardedPacketProcessor;
+
   // Initialize the internal state of the server.
   void Initialize();
 
@@ -126,6 +139,11 @@ class QuicServer : public QuicSpdyServerBase, public QuicSocketEventListener {
   std::unique_ptr<SocketFactory> socket_factory_;
   // Accepts data from the framer and demuxes clients to sessions.
   std::unique_ptr<QuicDispatcher> dispatcher_;
+  // Strips the forwarding header of the packets from
+  // |load_balancer_router_address_| before passing them to |dispatcher_|.
+  // Null if the address is not set.
+  std::unique_ptr<ForwardedPacketProcessor> forwarded_packet_processor_;
+  QuicSocketAddress load_balancer_router_address_;
 
   // The port the server is listening on.
   int port_;
@@ -4,9 +4,24 @@
 
 #include "quiche/quic/tools/quic_server_factory.h"
 
+#include <string>
 #include <utility>
 
+#include "quiche/quic/platform/api/quic_ip_address.h"
+#include "quiche/quic/platform/api/quic_socket_address.h"
 #include "quiche/quic/tools/quic_server.h"
+#include "quiche/common/platform/api/quiche_command_line_flags.h"
+#include "quiche/common/platform/api/quiche_logging.h"
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    std::string, load_balancer_router_host, "",
+    "If set, the server is a backend of the quic_load_balancer_router "
+    "listening on this IP address and --load_balancer_router_port, and strips "
+    "the forwarding header of the packets from it. The router must listen on "
+    "this address, not on all addresses.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(int32_t, load_balancer_router_port, 6121,
+                                "The port of --load_balancer_router_host.");
 
 namespace quic {
 
@@ -14,8 +29,18 @@ std::unique_ptr<quic::QuicSpdyServerBase> QuicServerFactory::CreateServer(
     quic::QuicSimpleServerBackend* backend,
     std::unique_ptr<quic::ProofSource> proof_source,
     const quic::ParsedQuicVersionVector& supported_versions) {
-  return std::make_unique<quic::QuicServer>(std::move(proof_source), backend,
-                                            supported_versions);
+  auto server = std::make_unique<quic::QuicServer>(
+      std::move(proof_source), backend, supported_versions);
+  const std::string router_host =
+      quiche::GetQuicheCommandLineFlag(FLAGS_load_balancer_router_host);
+  if (!router_host.empty()) {
+    QuicIpAddress router_ip;
+    QUICHE_CHECK(router_ip.FromString(router_host));
+    server->set_load_balancer_router_address(QuicSocketAddress(
+        router_ip,
+        quiche::GetQuicheCommandLineFlag(FLAGS_load_balancer_router_port)));
+  }
+  return server;
 }
 
 }  // namespace quic
@@ -9,12 +9,14 @@
 #include <memory>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/http/quic_spdy_stream.h"
 #include "quiche/quic/core/quic_error_codes.h"
 #include "quiche/quic/core/quic_types.h"
 #include "quiche/quic/core/socket_factory.h"
 #include "quiche/quic/core/web_transport_interface.h"
 #include "quiche/quic/tools/quic_backend_response.h"
+#include "quiche/common/platform/api/quiche_mem_slice.h"
 #include "quiche/spdy/core/http2_header_block.h"
 
 namespace quic {
@@ -24,6 +26,19 @@ namespace quic {
 // requests received by a Quic Server
 class QuicSimpleServerBackend {
  public:
+  // Produces the body of a streaming response piecewise, so that the request
+  // stream does not buffer more of it than it can send.
+  class ResponseProducer {
+   public:
+    virtual ~ResponseProducer() = default;
+
+    // Called once the request stream has sent enough of its buffered data
+    // after RequestHandler::SendResponseBody() returned false. Should send
+    // more of the response until SendResponseBody() returns false again or the
+    // response is complete.
+    virtual void ResumeProducing() = 0;
+  };
+
   // This interface implements the methods
   // called by the QuicSimpleServerBackend implementation
   // to process the request in the backend
@@ -47,6 +62,36 @@ class QuicSimpleServerBackend {
     virtual void SendStreamData(absl::string_view data, bool close_stream) = 0;
     // Abruptly terminates (resets) the request stream with `error`.
     virtual void TerminateStreamWithError(QuicResetStreamError error) = 0;
+
+    // Streaming responses. Instead of a complete QuicBackendResponse, a
+    // backend may send the response headers with SendResponseHeaders(), then
+    // the body with any number of SendResponseBody() calls, and end the
+    // response either with `fin` or with SendResponseTrailers(). The body
+    // starts flowing before the backend has all of it, and only as much of it
+    // as the stream can send is buffered at a time.
+    //
+    // Sends response headers, with the FIN bit if `fin` is true. Headers with
+    // an informational (1xx) status, such as Early Hints, may precede the
+    // final response headers. Invalid response headers are answered with an
+    // error response, and the rest of the response is dropped.
+    virtual void SendResponseHeaders(spdy::Http2HeaderBlock response_headers,
+                                     bool fin) = 0;
+    // Sends, or buffers for sending, all of `body`, and releases its slices.
+    // Returns false if the stream buffers enough data that the backend should
+    // stop producing until the stream calls ResumeProducing() on the producer
+    // set with SetResponseProducer().
+    virtual bool SendResponseBody(absl::Span<quiche::QuicheMemSlice> body,
+                                  bool fin) = 0;
+    // Like SendResponseBody(), for a chunk of a body which the backend keeps
+    // owning, e.g. a cached one. The stream copies `chunk` before returning.
+    virtual bool SendResponseBodyChunk(absl::string_view chunk, bool fin) = 0;
+    // Ends the response with `response_trailers`.
+    virtual void SendResponseTrailers(
+        spdy::Http2HeaderBlock response_trailers) = 0;
+    // Sets the producer to resume once the stream can buffer more of the
+    // response. The producer lives as long as the request stream.
+    virtual void SetResponseProducer(
+        std::unique_ptr<ResponseProducer> producer) = 0;
   };
 
   struct WebTransportResponse {
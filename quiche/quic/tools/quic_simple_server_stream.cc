@@ -320,42 +320,10 @@ void QuicSimpleServerStream::Respond(const QuicBackendResponse* response) {
     return;
   }
 
-  // Examing response status, if it was not pure integer as typical h2
-  // response status, send error response. Notice that
-  // QuicHttpResponseCache push urls are strictly authority + path only,
-  // scheme is not included (see |QuicHttpResponseCache::GetKey()|).
-  std::string request_url = request_headers_[":authority"].as_string() +
-                            request_headers_[":path"].as_string();
-  int response_code;
-  const Http2HeaderBlock& response_headers = response->headers();
-  if (!ParseHeaderStatusCode(response_headers, &response_code)) {
-    auto status = response_headers.find(":status");
-    if (status == response_headers.end()) {
-      QUIC_LOG(WARNING)
-          << ":status not present in response from cache for request "
-          << request_url;
-    } else {
-      QUIC_LOG(WARNING) << "Illegal (non-integer) response :status from cache: "
-                        << status->second << " for request " << request_url;
-    }
-    SendErrorResponse();
+  if (!ValidateResponseHeaders(response->headers())) {
     return;
   }
 
-  if (QuicUtils::IsServerInitiatedStreamId(session()->transport_version(),
-                                           id())) {
-    // A server initiated stream is only used for a server push response,
-    // and only 200 and 30X response codes are supported for server push.
-    // This behavior mirrors the HTTP/2 implementation.
-    bool is_redirection = response_code / 100 == 3;
-    if (response_code != 200 && !is_redirection) {
-      QUIC_LOG(WARNING) << "Response to server push request " << request_url
-                        << " result in response code " << response_code;
-      Reset(QUIC_STREAM_CANCELLED);
-      return;
-    }
-  }
-
   if (response->response_type() == QuicBackendResponse::INCOMPLETE_RESPONSE) {
     QUIC_DVLOG(1)
         << "Stream " << id()
@@ -384,11 +352,63 @@ void QuicSimpleServerStream::Respond(const QuicBackendResponse* response) {
     return;
   }
 
+  if (response->has_external_body() && !response->body().empty() &&
+      response->trailers().empty()) {
+    QUIC_DVLOG(1) << "Stream " << id() << " sending an external body of "
+                  << response->body().size() << " bytes.";
+    WriteHeaders(response->headers().Clone(), false, nullptr);
+    QUICHE_DCHECK(!response_sent_);
+    response_sent_ = true;
+
+    external_body_ = response->body();
+    WriteExternalBody();
+    return;
+  }
+
   QUIC_DVLOG(1) << "Stream " << id() << " sending response.";
   SendHeadersAndBodyAndTrailers(response->headers().Clone(), response->body(),
                                 response->trailers().Clone());
 }
 
+bool QuicSimpleServerStream::ValidateResponseHeaders(
+    const Http2HeaderBlock& response_headers) {
+  // Examing response status, if it was not pure integer as typical h2
+  // response status, send error response. Notice that
+  // QuicHttpResponseCache push urls are strictly authority + path only,
+  // scheme is not included (see |QuicHttpResponseCache::GetKey()|).
+  std::string request_url = request_headers_[":authority"].as_string() +
+                            request_headers_[":path"].as_string();
+  int response_code;
+  if (!ParseHeaderStatusCode(response_headers, &response_code)) {
+    auto status = response_headers.find(":status");
+    if (status == response_headers.end()) {
+      QUIC_LOG(WARNING)
+          << ":status not present in response from cache for request "
+          << request_url;
+    } else {
+      QUIC_LOG(WARNING) << "Illegal (non-integer) response :status from cache: "
+                        << status->second << " for request " << request_url;
+    }
+    SendErrorResponse();
+    return false;
+  }
+
+  if (QuicUtils::IsServerInitiatedStreamId(session()->transport_version(),
+                                           id())) {
+    // A server initiated stream is only used for a server push response,
+    // and only 200 and 30X response codes are supported for server push.
+    // This behavior mirrors the HTTP/2 implementation.
+    bool is_redirection = response_code / 100 == 3;
+    if (response_code != 200 && !is_redirection) {
+      QUIC_LOG(WARNING) << "Response to server push request " << request_url
+                        << " result in response code " << response_code;
+      Reset(QUIC_STREAM_CANCELLED);
+      return false;
+    }
+  }
+  return true;
+}
+
 void QuicSimpleServerStream::SendStreamData(absl::string_view data,
                                             bool close_stream) {
   // Doesn't make sense to call this without data or `close_stream`.
@@ -410,9 +430,104 @@ void QuicSimpleServerStream::TerminateStreamWithError(
   ResetWriteSide(error);
 }
 
+void QuicSimpleServerStream::SendResponseHeaders(
+    Http2HeaderBlock response_headers, bool fin) {
+  int response_code;
+  if (ParseHeaderStatusCode(response_headers, &response_code) &&
+      response_code / 100 == 1) {
+    // Informational responses, e.g. Early Hints, precede the response.
+    QUIC_DVLOG(1) << "Stream " << id() << " sending an informational response: "
+                  << response_headers.DebugString();
+    WriteHeaders(std::move(response_headers), /*fin=*/false, nullptr);
+    return;
+  }
+
+  if (!ValidateResponseHeaders(response_headers)) {
+    response_rejected_ = true;
+    return;
+  }
+
+  QUIC_DVLOG(1) << "Stream " << id() << " writing headers (fin = " << fin
+                << ") : " << response_headers.DebugString();
+  QUICHE_DCHECK(!response_sent_);
+  response_sent_ = true;
+  WriteHeaders(std::move(response_headers), fin, nullptr);
+}
+
+bool QuicSimpleServerStream::SendResponseBody(
+    absl::Span<quiche::QuicheMemSlice> body, bool fin) {
+  if (response_rejected_ || write_side_closed()) {
+    for (quiche::QuicheMemSlice& slice : body) {
+      slice.Reset();
+    }
+    return false;
+  }
+  QUICHE_DCHECK(response_sent_);
+
+  if (body.empty()) {
+    if (fin) {
+      WriteOrBufferBody(absl::string_view(), /*fin=*/true);
+    }
+  } else if (body.size() == 1) {
+    // A single slice is written directly, as there is nothing to coalesce.
+    if (!body[0].empty() || fin) {
+      WriteOrBufferBody(body[0].AsStringView(), fin);
+    }
+    body[0].Reset();
+  } else {
+    // The slices of one call, e.g. a message and its length prefix, are sent
+    // in a single DATA frame.
+    ScopedDataFrameCoalescer coalescer(this);
+    for (size_t i = 0; i < body.size(); ++i) {
+      const bool last = i + 1 == body.size();
+      if (!body[i].empty() || (fin && last)) {
+        WriteOrBufferBody(body[i].AsStringView(), fin && last);
+      }
+      body[i].Reset();
+    }
+  }
+
+  producer_blocked_ = !fin && !CanWriteNewData();
+  return !producer_blocked_;
+}
+
+bool QuicSimpleServerStream::SendResponseBodyChunk(absl::string_view chunk,
+                                                   bool fin) {
+  if (response_rejected_ || write_side_closed()) {
+    return false;
+  }
+  QUICHE_DCHECK(response_sent_);
+  if (!chunk.empty() || fin) {
+    WriteOrBufferBody(chunk, fin);
+  }
+  producer_blocked_ = !fin && !CanWriteNewData();
+  return !producer_blocked_;
+}
+
+void QuicSimpleServerStream::SendResponseTrailers(
+    Http2HeaderBlock response_trailers) {
+  if (response_rejected_ || write_side_closed()) {
+    return;
+  }
+  QUIC_DLOG(INFO) << "Stream " << id() << " writing trailers (fin = true): "
+                  << response_trailers.DebugString();
+  WriteTrailers(std::move(response_trailers), nullptr);
+}
+
+void QuicSimpleServerStream::SetResponseProducer(
+    std::unique_ptr<QuicSimpleServerBackend::ResponseProducer> producer) {
+  response_producer_ = std::move(producer);
+}
+
 void QuicSimpleServerStream::OnCanWrite() {
   QuicSpdyStream::OnCanWrite();
   WriteGeneratedBytes();
+  WriteExternalBody();
+  if (producer_blocked_ && response_producer_ != nullptr &&
+      !write_side_closed() && CanWriteNewData()) {
+    producer_blocked_ = false;
+    response_producer_->ResumeProducing();
+  }
 }
 
 void QuicSimpleServerStream::WriteGeneratedBytes() {
@@ -426,6 +541,18 @@ void QuicSimpleServerStream::WriteGeneratedBytes() {
   }
 }
 
+void QuicSimpleServerStream::WriteExternalBody() {
+  // Only one chunk is buffered at a time, so that bodies larger than memory are
+  // read from the backend as the peer consumes them.
+  static constexpr size_t kChunkSize = 64 * 1024;
+  while (!HasBufferedData() && !write_side_closed() &&
+         !external_body_.empty()) {
+    absl::string_view chunk = external_body_.substr(0, kChunkSize);
+    external_body_.remove_prefix(chunk.size());
+    WriteOrBufferBody(chunk, /*fin=*/external_body_.empty());
+  }
+}
+
 void QuicSimpleServerStream::SendNotFoundResponse() {
   QUIC_DVLOG(1) << "Stream " << id() << " sending not found response.";
   Http2HeaderBlock headers;
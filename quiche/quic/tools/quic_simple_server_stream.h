@@ -6,14 +6,17 @@
 #define QUICHE_QUIC_TOOLS_QUIC_SIMPLE_SERVER_STREAM_H_
 
 #include <cstdint>
+#include <memory>
 
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/http/quic_spdy_server_stream_base.h"
 #include "quiche/quic/core/quic_error_codes.h"
 #include "quiche/quic/core/quic_packets.h"
 #include "quiche/quic/tools/quic_backend_response.h"
 #include "quiche/quic/tools/quic_simple_server_backend.h"
+#include "quiche/common/platform/api/quiche_mem_slice.h"
 #include "quiche/spdy/core/http2_header_block.h"
 #include "quiche/spdy/core/spdy_framer.h"
 
@@ -61,6 +64,15 @@ class QuicSimpleServerStream : public QuicSpdyServerStreamBase,
   void OnResponseBackendComplete(const QuicBackendResponse* response) override;
   void SendStreamData(absl::string_view data, bool close_stream) override;
   void TerminateStreamWithError(QuicResetStreamError error) override;
+  void SendResponseHeaders(spdy::Http2HeaderBlock response_headers,
+                           bool fin) override;
+  bool SendResponseBody(absl::Span<quiche::QuicheMemSlice> body,
+                        bool fin) override;
+  bool SendResponseBodyChunk(absl::string_view chunk, bool fin) override;
+  void SendResponseTrailers(spdy::Http2HeaderBlock response_trailers) override;
+  void SetResponseProducer(
+      std::unique_ptr<QuicSimpleServerBackend::ResponseProducer> producer)
+      override;
 
   void Respond(const QuicBackendResponse* response);
 
@@ -77,6 +89,10 @@ class QuicSimpleServerStream : public QuicSpdyServerStreamBase,
   virtual void SendErrorResponse();
   virtual void SendErrorResponse(int resp_code);
 
+  // Returns true if the final response headers may be sent on this stream.
+  // Otherwise sends an error response or resets the stream.
+  bool ValidateResponseHeaders(const spdy::Http2HeaderBlock& response_headers);
+
   // Sends a basic 404 response using SendHeaders for the headers and WriteData
   // for the body.
   void SendNotFoundResponse();
@@ -104,6 +120,9 @@ class QuicSimpleServerStream : public QuicSpdyServerStreamBase,
   // Writes the body bytes for the GENERATE_BYTES response type.
   void WriteGeneratedBytes();
 
+  // Writes the remainder of a body owned by the backend, a chunk at a time.
+  void WriteExternalBody();
+
   void set_quic_simple_server_backend_for_test(
       QuicSimpleServerBackend* backend) {
     quic_simple_server_backend_ = backend;
@@ -118,8 +137,17 @@ class QuicSimpleServerStream : public QuicSpdyServerStreamBase,
 
  private:
   uint64_t generate_bytes_length_;
+  // The part of an external response body which is not yet written.
+  absl::string_view external_body_;
   // Whether response headers have already been sent.
   bool response_sent_ = false;
+  // Whether streamed response headers were invalid, so that the rest of the
+  // streamed response is dropped.
+  bool response_rejected_ = false;
+  // Whether SendResponseBody() has asked `response_producer_` to pause.
+  bool producer_blocked_ = false;
+  std::unique_ptr<QuicSimpleServerBackend::ResponseProducer>
+      response_producer_;
 
   std::unique_ptr<QuicAlarm> delayed_response_alarm_;
 
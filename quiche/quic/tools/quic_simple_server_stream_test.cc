@@ -12,6 +12,7 @@
 #include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "quiche/quic/core/crypto/null_encrypter.h"
 #include "quiche/quic/core/http/http_encoder.h"
 #include "quiche/quic/core/http/spdy_utils.h"
@@ -36,6 +37,7 @@
 #include "quiche/quic/tools/quic_memory_cache_backend.h"
 #include "quiche/quic/tools/quic_simple_server_backend.h"
 #include "quiche/quic/tools/quic_simple_server_session.h"
+#include "quiche/common/platform/api/quiche_mem_slice.h"
 #include "quiche/common/simple_buffer_allocator.h"
 
 using testing::_;
@@ -1003,6 +1005,190 @@ TEST_P(QuicSimpleServerStreamTest, BackendCanTerminateStream) {
   stream_->OnStreamHeaderList(/*fin=*/false, kFakeFrameLen, header_list);
 }
 
+TEST_P(QuicSimpleServerStreamTest, BackendCanStreamResponse) {
+  auto test_backend = std::make_unique<TestQuicSimpleServerBackend>();
+  TestQuicSimpleServerBackend* test_backend_ptr = test_backend.get();
+  ReplaceBackend(std::move(test_backend));
+
+  EXPECT_CALL(session_, WritevData(_, _, _, _, _, _))
+      .WillRepeatedly(
+          Invoke(&session_, &MockQuicSimpleServerSession::ConsumeData));
+
+  constexpr absl::string_view kBody1 = "\x22\x22";
+  constexpr absl::string_view kBody2 = "\x33\x33";
+  spdy::Http2HeaderBlock* request_headers = stream_->mutable_headers();
+  (*request_headers)[":path"] = "/bar";
+  (*request_headers)[":authority"] = "www.google.com";
+  (*request_headers)[":method"] = "GET";
+
+  // The backend sends the headers, then the body in two calls, the last of
+  // which only carries the fin.
+  InSequence s;
+  EXPECT_CALL(*test_backend_ptr, FetchResponseFromBackend(_, _, _))
+      .WillOnce([kBody1, kBody2](const spdy::Http2HeaderBlock&,
+                                 const std::string&,
+                                 QuicSimpleServerBackend::RequestHandler*
+                                     request_handler) {
+        spdy::Http2HeaderBlock response_headers;
+        response_headers[":status"] = "200";
+        request_handler->SendResponseHeaders(std::move(response_headers),
+                                             /*fin=*/false);
+        quiche::QuicheMemSlice slices[] = {MemSliceFromString(kBody1),
+                                           MemSliceFromString(kBody2)};
+        EXPECT_TRUE(request_handler->SendResponseBody(absl::MakeSpan(slices),
+                                                      /*fin=*/false));
+        EXPECT_TRUE(slices[0].empty());
+        request_handler->SendResponseBody({}, /*fin=*/true);
+      });
+  EXPECT_CALL(*stream_, WriteHeadersMock(false));
+  EXPECT_CALL(*stream_, WriteOrBufferBody(kBody1, false));
+  EXPECT_CALL(*stream_, WriteOrBufferBody(kBody2, false));
+  EXPECT_CALL(*stream_, WriteOrBufferBody(absl::string_view(), true));
+
+  QuicStreamPeer::SetFinReceived(stream_);
+  stream_->DoSendResponse();
+  EXPECT_TRUE(stream_->write_side_closed());
+}
+
+// The slices of a SendResponseBody() call are sent in a single DATA frame
+// unless --quic_coalesce_http3_data_frames is unset.
+TEST_P(QuicSimpleServerStreamTest, StreamedSlicesShareDataFrame) {
+  if (!UsesHttp3()) {
+    return;
+  }
+  for (const bool coalesce : {true, false}) {
+    SetQuicFlag(quic_coalesce_http3_data_frames, coalesce);
+    auto test_backend = std::make_unique<TestQuicSimpleServerBackend>();
+    TestQuicSimpleServerBackend* test_backend_ptr = test_backend.get();
+    ReplaceBackend(std::move(test_backend));
+    auto stream = new StrictMock<TestStream>(
+        GetNthClientInitiatedBidirectionalStreamId(
+            connection_->transport_version(), coalesce ? 1 : 2),
+        &session_, BIDIRECTIONAL, test_backend_ptr);
+    session_.ActivateStream(absl::WrapUnique(stream));
+    spdy::Http2HeaderBlock* request_headers = stream->mutable_headers();
+    (*request_headers)[":path"] = "/bar";
+    (*request_headers)[":authority"] = "www.google.com";
+    (*request_headers)[":method"] = "GET";
+
+    constexpr absl::string_view kPrefix = "\x00\x00\x00\x00\x02";
+    constexpr absl::string_view kMessage = "\x22\x22";
+    EXPECT_CALL(*test_backend_ptr, FetchResponseFromBackend(_, _, _))
+        .WillOnce([kPrefix, kMessage](const spdy::Http2HeaderBlock&,
+                                      const std::string&,
+                                      QuicSimpleServerBackend::RequestHandler*
+                                          request_handler) {
+          spdy::Http2HeaderBlock response_headers;
+          response_headers[":status"] = "200";
+          request_handler->SendResponseHeaders(std::move(response_headers),
+                                               /*fin=*/false);
+          quiche::QuicheMemSlice slices[] = {MemSliceFromString(kPrefix),
+                                             MemSliceFromString(kMessage)};
+          request_handler->SendResponseBody(absl::MakeSpan(slices),
+                                            /*fin=*/true);
+        });
+    EXPECT_CALL(*stream, WriteHeadersMock(false));
+    const QuicByteCount kBodyLength = kPrefix.size() + kMessage.size();
+    auto consume_data =
+        Invoke(&session_, &MockQuicSimpleServerSession::ConsumeData);
+    InSequence s;
+    if (coalesce) {
+      EXPECT_CALL(session_,
+                  WritevData(_,
+                             HttpEncoder::GetDataFrameHeaderLength(kBodyLength),
+                             _, NO_FIN, _, _))
+          .WillOnce(consume_data);
+      EXPECT_CALL(session_, WritevData(_, kBodyLength, _, FIN, _, _))
+          .WillOnce(consume_data);
+    } else {
+      for (const absl::string_view data : {kPrefix, kMessage}) {
+        EXPECT_CALL(session_,
+                    WritevData(_,
+                               HttpEncoder::GetDataFrameHeaderLength(
+                                   data.size()),
+                               _, NO_FIN, _, _))
+            .WillOnce(consume_data);
+        EXPECT_CALL(session_,
+                    WritevData(_, data.size(), _,
+                               data == kMessage ? FIN : NO_FIN, _, _))
+            .WillOnce(consume_data);
+      }
+    }
+
+    QuicStreamPeer::SetFinReceived(stream);
+    stream->DoSendResponse();
+    EXPECT_TRUE(stream->write_side_closed());
+    testing::Mock::VerifyAndClearExpectations(&session_);
+  }
+}
+
+// A slice of at least kMaxCoalescedWriteLength bytes shares the DATA frame of
+// the slices before it, but is written without being copied into it.
+TEST_P(QuicSimpleServerStreamTest, LargeSliceIsNotCoalesced) {
+  if (!UsesHttp3()) {
+    return;
+  }
+  SetQuicFlag(quic_coalesce_http3_data_frames, true);
+  auto test_backend = std::make_unique<TestQuicSimpleServerBackend>();
+  TestQuicSimpleServerBackend* test_backend_ptr = test_backend.get();
+  ReplaceBackend(std::move(test_backend));
+  auto stream = new StrictMock<TestStream>(
+      GetNthClientInitiatedBidirectionalStreamId(
+          connection_->transport_version(), 1),
+      &session_, BIDIRECTIONAL, test_backend_ptr);
+  session_.ActivateStream(absl::WrapUnique(stream));
+  spdy::Http2HeaderBlock* request_headers = stream->mutable_headers();
+  (*request_headers)[":path"] = "/bar";
+  (*request_headers)[":authority"] = "www.google.com";
+  (*request_headers)[":method"] = "GET";
+
+  constexpr absl::string_view kPrefix = "\x00\x00\x00\x08\x00";
+  const std::string message(QuicSpdyStream::kMaxCoalescedWriteLength, 'a');
+  EXPECT_CALL(*test_backend_ptr, FetchResponseFromBackend(_, _, _))
+      .WillOnce([kPrefix, &message](const spdy::Http2HeaderBlock&,
+                                    const std::string&,
+                                    QuicSimpleServerBackend::RequestHandler*
+                                        request_handler) {
+        spdy::Http2HeaderBlock response_headers;
+        response_headers[":status"] = "200";
+        request_handler->SendResponseHeaders(std::move(response_headers),
+                                             /*fin=*/false);
+        quiche::QuicheMemSlice slices[] = {MemSliceFromString(kPrefix),
+                                           MemSliceFromString(message)};
+        request_handler->SendResponseBody(absl::MakeSpan(slices),
+                                          /*fin=*/false);
+        // A single slice is written in a DATA frame of its own.
+        quiche::QuicheMemSlice last_slice[] = {MemSliceFromString(message)};
+        request_handler->SendResponseBody(absl::MakeSpan(last_slice),
+                                          /*fin=*/true);
+      });
+  EXPECT_CALL(*stream, WriteHeadersMock(false));
+  auto consume_data =
+      Invoke(&session_, &MockQuicSimpleServerSession::ConsumeData);
+  InSequence s;
+  EXPECT_CALL(session_,
+              WritevData(_,
+                         HttpEncoder::GetDataFrameHeaderLength(
+                             kPrefix.size() + message.size()),
+                         _, NO_FIN, _, _))
+      .WillOnce(consume_data);
+  EXPECT_CALL(session_, WritevData(_, kPrefix.size(), _, NO_FIN, _, _))
+      .WillOnce(consume_data);
+  EXPECT_CALL(session_, WritevData(_, message.size(), _, NO_FIN, _, _))
+      .WillOnce(consume_data);
+  EXPECT_CALL(session_,
+              WritevData(_, HttpEncoder::GetDataFrameHeaderLength(
+                                message.size()),
+                         _, NO_FIN, _, _))
+      .WillOnce(consume_data);
+  EXPECT_CALL(session_, WritevData(_, message.size(), _, FIN, _, _))
+      .WillOnce(consume_data);
+
+  QuicStreamPeer::SetFinReceived(stream);
+  stream->DoSendResponse();
+  EXPECT_TRUE(stream->write_side_closed());
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
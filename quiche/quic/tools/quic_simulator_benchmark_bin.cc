@@ -0,0 +1,391 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Deterministic QUIC benchmarks on simulator::QuicEndpoint. Every benchmark
+// prints one line of JSON with its results to stdout, e.g.
+//   quic_simulator_benchmark --benchmarks=simulator_bulk_transfer
+//
+// The simulated results do not depend on the machine, and the CPU time
+// measures the cost of the QUIC stack alone, without any system calls.
+// simulator_datagrams compares sending datagrams one per packet with sending
+// them in batches from pooled buffers.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "quiche/quic/core/crypto/crypto_protocol.h"
+#include "quiche/quic/core/quic_config.h"
+#include "quiche/quic/core/quic_connection_stats.h"
+#include "quiche/quic/core/quic_packet_reader.h"
+#include "quiche/quic/core/quic_tag.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/core/quic_types.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+#include "quiche/quic/test_tools/quic_benchmark_utils.h"
+#include "quiche/quic/test_tools/quic_config_peer.h"
+#include "quiche/quic/test_tools/quic_test_utils.h"
+#include "quiche/quic/test_tools/simulator/link.h"
+#include "quiche/quic/test_tools/simulator/quic_endpoint.h"
+#include "quiche/quic/test_tools/simulator/simulator.h"
+#include "quiche/quic/test_tools/simulator/switch.h"
+#include "quiche/common/platform/api/quiche_command_line_flags.h"
+#include "quiche/common/platform/api/quiche_mem_slice.h"
+#include "quiche/common/pooled_buffer_allocator.h"
+#include "quiche/common/quiche_buffer_allocator.h"
+#include "quiche/common/simple_buffer_allocator.h"
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    std::string, benchmarks, "",
+    "Comma-separated list of benchmarks to run. If empty, all benchmarks are "
+    "run.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, bulk_transfer_mb, 100,
+    "Size of the simulator_bulk_transfer and simulator_ack_thinning "
+    "transfers, in MiB.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, num_connections, 500,
+    "Number of connections of the simulator_short_transfers benchmark.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, small_response_size, 100,
+    "Size of each transfer of the simulator_short_transfers benchmark.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, simulator_bandwidth_mbps, 10000,
+    "Bandwidth of the simulated links, in Mbit/s.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, num_datagrams, 200000,
+    "Number of datagrams of the simulator_datagrams benchmark.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    int32_t, datagram_size, 64,
+    "Size of the datagrams of the simulator_datagrams benchmark.");
+
+namespace quic {
+namespace test {
+namespace {
+
+QuicByteCount BulkTransferBytes() {
+  return static_cast<QuicByteCount>(
+             quiche::GetQuicheCommandLineFlag(FLAGS_bulk_transfer_mb))
+         << 20;
+}
+
+// Two QuicEndpoints connected through a switch with identical links.
+class SimulatedNetwork {
+ public:
+  // |connection_options| are sent by the client, i.e. the data sender.
+  explicit SimulatedNetwork(uint64_t connection_id,
+                            const QuicTagVector& connection_options = {})
+      : simulator_(&random_),
+        switch_(&simulator_, "Switch", 8, 2 * Bdp()),
+        client_(&simulator_, "Client", "Server", Perspective::IS_CLIENT,
+                TestConnectionId(connection_id)),
+        server_(&simulator_, "Server", "Client", Perspective::IS_SERVER,
+                TestConnectionId(connection_id)),
+        client_link_(&client_, switch_.port(1), Bandwidth(), kPropagationDelay),
+        server_link_(&server_, switch_.port(2), Bandwidth(),
+                     kPropagationDelay) {
+    if (!connection_options.empty()) {
+      // Simulator endpoints skip the handshake, so apply the options to both
+      // sides as if they had been negotiated.
+      QuicConfig client_config;
+      client_config.SetConnectionOptionsToSend(connection_options);
+      ApplyConfig(client_config, client_.connection());
+      QuicConfig server_config;
+      QuicConfigPeer::SetReceivedConnectionOptions(&server_config,
+                                                   connection_options);
+      ApplyConfig(server_config, server_.connection());
+    }
+  }
+
+  // Transfers |bytes| from the client to the server. Returns the simulated
+  // time it took, or Infinite() on timeout.
+  QuicTime::Delta Transfer(QuicByteCount bytes) {
+    const QuicTime start = simulator_.GetClock()->Now();
+    const QuicByteCount target = server_.bytes_received() + bytes;
+    client_.AddBytesToTransfer(bytes);
+    if (!simulator_.RunUntilOrTimeout(
+            [this, target]() { return server_.bytes_received() >= target; },
+            QuicTime::Delta::FromSeconds(600))) {
+      return QuicTime::Delta::Infinite();
+    }
+    return simulator_.GetClock()->Now() - start;
+  }
+
+  // Sends |count| datagrams of |size| bytes from the client to the server,
+  // |batch_size| per packet flush, with payloads from |allocator|.  Returns
+  // false on error or timeout.
+  bool SendDatagrams(int count, size_t size, int batch_size,
+                     quiche::QuicheBufferAllocator* allocator) {
+    QuicConnection* connection = client_.connection();
+    const QuicMessageId num_messages = count;
+    QuicMessageId message_id = 0;
+    while (message_id < num_messages) {
+      MessageStatus status = MESSAGE_STATUS_SUCCESS;
+      {
+        QuicConnection::ScopedPacketFlusher flusher(connection);
+        for (int i = 0; i < batch_size && message_id < num_messages; ++i) {
+          quiche::QuicheBuffer buffer(allocator, size);
+          memset(buffer.data(), 'd', size);
+          quiche::QuicheMemSlice slice(std::move(buffer));
+          status = connection->SendMessage(
+              message_id + 1, absl::MakeSpan(&slice, 1), /*flush=*/false);
+          if (status != MESSAGE_STATUS_SUCCESS) {
+            break;
+          }
+          ++message_id;
+        }
+      }
+      if (status == MESSAGE_STATUS_BLOCKED) {
+        if (!simulator_.RunUntilOrTimeout(
+                [connection]() {
+                  return connection->CanWrite(HAS_RETRANSMITTABLE_DATA);
+                },
+                QuicTime::Delta::FromSeconds(600))) {
+          return false;
+        }
+      } else if (status != MESSAGE_STATUS_SUCCESS) {
+        QUIC_LOG(ERROR) << "Failed to send datagram " << message_id + 1
+                        << ": " << MessageStatusToString(status);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Makes the server read its packets in bursts, see
+  // simulator::QuicEndpointBase::SetReadBurst().
+  void SetServerReadBurst(size_t max_packets, QuicTime::Delta delay) {
+    server_.SetReadBurst(max_packets, delay);
+  }
+
+  const QuicConnectionStats& client_stats() {
+    return client_.connection()->GetStats();
+  }
+
+  const QuicConnectionStats& server_stats() {
+    return server_.connection()->GetStats();
+  }
+
+  static QuicBandwidth Bandwidth() {
+    return QuicBandwidth::FromKBitsPerSecond(
+        1000 * static_cast<int64_t>(quiche::GetQuicheCommandLineFlag(
+                   FLAGS_simulator_bandwidth_mbps)));
+  }
+
+ private:
+  static constexpr QuicTime::Delta kPropagationDelay =
+      QuicTime::Delta::FromMilliseconds(5);
+
+  static QuicByteCount Bdp() { return Bandwidth() * (4 * kPropagationDelay); }
+
+  static void ApplyConfig(const QuicConfig& config,
+                          QuicConnection* connection) {
+    connection->SetFromConfig(config);
+    // The config is not negotiated, which would arm the handshake timeout.
+    connection->SetNetworkTimeouts(QuicTime::Delta::Infinite(),
+                                   QuicTime::Delta::FromSeconds(600));
+  }
+
+  // Fixed seed, so that every run is identical.
+  SimpleRandom random_;
+  simulator::Simulator simulator_;
+  simulator::Switch switch_;
+  simulator::QuicEndpoint client_;
+  simulator::QuicEndpoint server_;
+  simulator::SymmetricLink client_link_;
+  simulator::SymmetricLink server_link_;
+};
+
+bool RunSimulatorBulkTransfer() {
+  const QuicByteCount bytes = BulkTransferBytes();
+  SimulatedNetwork network(/*connection_id=*/42);
+  QuicBenchmarkTimer timer;
+  timer.Start();
+  const QuicTime::Delta simulated_time = network.Transfer(bytes);
+  timer.Stop();
+  if (simulated_time.IsInfinite()) {
+    QUIC_LOG(ERROR) << "Simulated bulk transfer timed out";
+    return false;
+  }
+  PrintBenchmarkResult(
+      QuicBenchmarkResult("simulator_bulk_transfer")
+          .AddMetric("bytes", bytes)
+          .AddMetric("link_mbps",
+                     SimulatedNetwork::Bandwidth().ToKBitsPerSecond() / 1000.0)
+          .AddMetric("simulated_seconds",
+                     simulated_time.ToMicroseconds() / 1e6)
+          .AddMetric("simulated_goodput_mbps",
+                     bytes * 8.0 / simulated_time.ToMicroseconds())
+          .AddTimer(timer)
+          .AddMetric("gbps_per_core", bytes * 8.0 / timer.cpu_seconds() / 1e9));
+  return true;
+}
+
+// Simulator endpoints use null encryption and skip the crypto handshake, so
+// this measures the CPU cost of connection setup, a small transfer and
+// teardown in the QUIC stack alone.
+bool RunSimulatorShortTransfers() {
+  const int num_connections =
+      quiche::GetQuicheCommandLineFlag(FLAGS_num_connections);
+  const QuicByteCount bytes =
+      quiche::GetQuicheCommandLineFlag(FLAGS_small_response_size);
+  QuicTime::Delta total_simulated_time = QuicTime::Delta::Zero();
+  QuicBenchmarkTimer timer;
+  timer.Start();
+  for (int i = 0; i < num_connections; ++i) {
+    SimulatedNetwork network(/*connection_id=*/i + 1);
+    const QuicTime::Delta simulated_time = network.Transfer(bytes);
+    if (simulated_time.IsInfinite()) {
+      QUIC_LOG(ERROR) << "Simulated transfer " << i << " timed out";
+      return false;
+    }
+    total_simulated_time = total_simulated_time + simulated_time;
+  }
+  timer.Stop();
+  PrintBenchmarkResult(
+      QuicBenchmarkResult("simulator_short_transfers")
+          .AddMetric("connections", num_connections)
+          .AddMetric("bytes_per_connection", bytes)
+          .AddMetric("mean_simulated_ms",
+                     total_simulated_time.ToMicroseconds() / 1e3 /
+                         num_connections)
+          .AddTimer(timer)
+          .AddMetric("connections_per_core_second",
+                     num_connections / timer.cpu_seconds()));
+  return true;
+}
+
+// Compares the acks sent by the receiver of a bulk transfer, and the CPU time
+// of the whole transfer, without and with kAKDB. The receiver reads its
+// packets in bursts of up to kNumPacketsPerReadMmsgCall, like QuicPacketReader
+// does, waiting for about that many packets to arrive before each read.
+bool RunSimulatorAckThinning() {
+  const QuicByteCount bytes = BulkTransferBytes();
+  const QuicTime::Delta read_burst_delay =
+      SimulatedNetwork::Bandwidth().TransferTime(kNumPacketsPerReadMmsgCall *
+                                                 kMaxOutgoingPacketSize);
+  struct Run {
+    QuicBenchmarkTimer timer;
+    QuicTime::Delta simulated_time = QuicTime::Delta::Zero();
+    QuicPacketCount acks_sent = 0;
+    QuicPacketCount packets_received = 0;
+    QuicPacketCount read_bursts_batched = 0;
+  };
+  Run runs[2];
+  for (int i = 0; i < 2; ++i) {
+    const QuicTagVector options =
+        i == 0 ? QuicTagVector() : QuicTagVector{kAKDB};
+    SimulatedNetwork network(/*connection_id=*/42, options);
+    network.SetServerReadBurst(kNumPacketsPerReadMmsgCall, read_burst_delay);
+    runs[i].timer.Start();
+    runs[i].simulated_time = network.Transfer(bytes);
+    runs[i].timer.Stop();
+    if (runs[i].simulated_time.IsInfinite()) {
+      QUIC_LOG(ERROR) << "Simulated bulk transfer " << i << " timed out";
+      return false;
+    }
+    runs[i].acks_sent = network.server_stats().packets_sent;
+    runs[i].packets_received = network.server_stats().packets_received;
+    runs[i].read_bursts_batched = network.server_stats().read_bursts_batched;
+  }
+  const Run& baseline = runs[0];
+  const Run& thinned = runs[1];
+  PrintBenchmarkResult(
+      QuicBenchmarkResult("simulator_ack_thinning")
+          .AddMetric("bytes", bytes)
+          .AddMetric("baseline_acks", baseline.acks_sent)
+          .AddMetric("thinned_acks", thinned.acks_sent)
+          .AddMetric("thinned_read_bursts_batched",
+                     thinned.read_bursts_batched)
+          .AddMetric("baseline_acks_per_1000_packets",
+                     1000.0 * baseline.acks_sent / baseline.packets_received)
+          .AddMetric("thinned_acks_per_1000_packets",
+                     1000.0 * thinned.acks_sent / thinned.packets_received)
+          .AddMetric("baseline_simulated_goodput_mbps",
+                     bytes * 8.0 / baseline.simulated_time.ToMicroseconds())
+          .AddMetric("thinned_simulated_goodput_mbps",
+                     bytes * 8.0 / thinned.simulated_time.ToMicroseconds())
+          .AddMetric("baseline_cpu_seconds", baseline.timer.cpu_seconds())
+          .AddMetric("thinned_cpu_seconds", thinned.timer.cpu_seconds())
+          .AddMetric("cpu_saved_fraction",
+                     1.0 - thinned.timer.cpu_seconds() /
+                               baseline.timer.cpu_seconds()));
+  return true;
+}
+
+// Sends small datagrams, each with its own buffer from SimpleBufferAllocator
+// and in its own packet as QuicDatagramQueue used to, and then in batches
+// sharing packets with buffers from a PooledBufferAllocator.
+bool RunSimulatorDatagrams() {
+  const int num_datagrams =
+      quiche::GetQuicheCommandLineFlag(FLAGS_num_datagrams);
+  const size_t datagram_size =
+      quiche::GetQuicheCommandLineFlag(FLAGS_datagram_size);
+  constexpr int kBatchSize = 16;
+  quiche::PooledBufferAllocator pool;
+  struct Run {
+    const char* name;
+    int batch_size;
+    quiche::QuicheBufferAllocator* allocator;
+  };
+  for (const Run& run :
+       {Run{"simulator_datagrams", 1, quiche::SimpleBufferAllocator::Get()},
+        Run{"simulator_datagrams_batched", kBatchSize, &pool}}) {
+    SimulatedNetwork network(/*connection_id=*/42);
+    QuicBenchmarkTimer timer;
+    timer.Start();
+    if (!network.SendDatagrams(num_datagrams, datagram_size, run.batch_size,
+                               run.allocator)) {
+      QUIC_LOG(ERROR) << run.name << " failed";
+      return false;
+    }
+    timer.Stop();
+    PrintBenchmarkResult(
+        QuicBenchmarkResult(run.name)
+            .AddMetric("datagrams", num_datagrams)
+            .AddMetric("datagram_size", datagram_size)
+            .AddMetric("batch_size", run.batch_size)
+            .AddTimer(timer)
+            .AddMetric("datagrams_per_core_second",
+                       num_datagrams / timer.cpu_seconds())
+            .AddMetric("datagrams_per_packet",
+                       static_cast<double>(num_datagrams) /
+                           network.client_stats().packets_sent));
+  }
+  return true;
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
+
+int main(int argc, char* argv[]) {
+  const char* usage = "Usage: quic_simulator_benchmark [--benchmarks=name,...]";
+  std::vector<std::string> args =
+      quiche::QuicheParseCommandLineFlags(usage, argc, argv);
+  if (!args.empty()) {
+    quiche::QuichePrintCommandLineFlagHelp(usage);
+    return 1;
+  }
+
+  using quic::test::QuicBenchmark;
+  const std::vector<QuicBenchmark> benchmarks = {
+      {"simulator_bulk_transfer", quic::test::RunSimulatorBulkTransfer},
+      {"simulator_short_transfers", quic::test::RunSimulatorShortTransfers},
+      {"simulator_ack_thinning", quic::test::RunSimulatorAckThinning},
+      {"simulator_datagrams", quic::test::RunSimulatorDatagrams},
+  };
+  const int failures = quic::test::RunBenchmarks(
+      benchmarks, quiche::GetQuicheCommandLineFlag(FLAGS_benchmarks));
+  return failures == 0 ? 0 : 1;
+}
@@ -12,11 +12,14 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "quiche/quic/core/crypto/cipher_suite_policy.h"
 #include "quiche/quic/core/quic_server_id.h"
 #include "quiche/quic/core/quic_versions.h"
 #include "quiche/quic/platform/api/quic_default_proof_providers.h"
+#include "quiche/quic/platform/api/quic_flags.h"
 #include "quiche/quic/platform/api/quic_socket_address.h"
 #include "quiche/quic/tools/connect_server_backend.h"
+#include "quiche/quic/tools/quic_file_backed_cache_backend.h"
 #include "quiche/quic/tools/quic_memory_cache_backend.h"
 #include "quiche/common/platform/api/quiche_command_line_flags.h"
 #include "quiche/common/platform/api/quiche_logging.h"
@@ -31,6 +34,13 @@ DEFINE_QUICHE_COMMAND_LINE_FLAG(
     "construction to seed the cache. Cache directory can be "
     "generated using `wget -p --save-headers <url>`");
 
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    bool, map_response_cache_dir, false,
+    "If true, the files of --quic_response_cache_dir are memory-mapped and "
+    "streamed from the mappings instead of being copied into memory, so that "
+    "the cache can be larger than memory. Dynamic responses and WebTransport "
+    "are not supported with a mapped cache.");
+
 DEFINE_QUICHE_COMMAND_LINE_FLAG(
     bool, generate_dynamic_responses, false,
     "If true, then URLs which have a numeric path will send a dynamically "
@@ -70,17 +80,27 @@ namespace quic {
 
 std::unique_ptr<quic::QuicSimpleServerBackend>
 QuicToyServer::MemoryCacheBackendFactory::CreateBackend() {
-  auto memory_cache_backend = std::make_unique<QuicMemoryCacheBackend>();
-  if (quiche::GetQuicheCommandLineFlag(FLAGS_generate_dynamic_responses)) {
-    memory_cache_backend->GenerateDynamicResponses();
-  }
-  if (!quiche::GetQuicheCommandLineFlag(FLAGS_quic_response_cache_dir)
-           .empty()) {
-    memory_cache_backend->InitializeBackend(
-        quiche::GetQuicheCommandLineFlag(FLAGS_quic_response_cache_dir));
-  }
-  if (quiche::GetQuicheCommandLineFlag(FLAGS_enable_webtransport)) {
-    memory_cache_backend->EnableWebTransport();
+  std::unique_ptr<QuicSimpleServerBackend> cache_backend;
+  if (quiche::GetQuicheCommandLineFlag(FLAGS_map_response_cache_dir)) {
+    auto file_backed_cache_backend =
+        std::make_unique<QuicFileBackedCacheBackend>();
+    QUICHE_CHECK(file_backed_cache_backend->InitializeBackend(
+        quiche::GetQuicheCommandLineFlag(FLAGS_quic_response_cache_dir)));
+    cache_backend = std::move(file_backed_cache_backend);
+  } else {
+    auto memory_cache_backend = std::make_unique<QuicMemoryCacheBackend>();
+    if (quiche::GetQuicheCommandLineFlag(FLAGS_generate_dynamic_responses)) {
+      memory_cache_backend->GenerateDynamicResponses();
+    }
+    if (!quiche::GetQuicheCommandLineFlag(FLAGS_quic_response_cache_dir)
+             .empty()) {
+      memory_cache_backend->InitializeBackend(
+          quiche::GetQuicheCommandLineFlag(FLAGS_quic_response_cache_dir));
+    }
+    if (quiche::GetQuicheCommandLineFlag(FLAGS_enable_webtransport)) {
+      memory_cache_backend->EnableWebTransport();
+    }
+    cache_backend = std::move(memory_cache_backend);
   }
 
   if (!quiche::GetQuicheCommandLineFlag(FLAGS_connect_proxy_destinations)
@@ -120,11 +140,11 @@ QuicToyServer::MemoryCacheBackendFactory::CreateBackend() {
     }
 
     return std::make_unique<ConnectServerBackend>(
-        std::move(memory_cache_backend), std::move(connect_proxy_destinations),
+        std::move(cache_backend), std::move(connect_proxy_destinations),
         std::move(connect_udp_proxy_targets), std::move(proxy_server_label));
   }
 
-  return memory_cache_backend;
+  return cache_backend;
 }
 
 QuicToyServer::QuicToyServer(BackendFactory* backend_factory,
@@ -156,6 +176,10 @@ int QuicToyServer::Start() {
   for (const auto& version : supported_versions) {
     QuicEnableVersion(version);
   }
+  if (GetQuicFlag(quic_tls_server_cipher_suite_policy) ==
+      static_cast<int32_t>(CipherSuitePolicy::kMeasuredThroughput)) {
+    InitializeMeasuredAeadThroughput();
+  }
   auto proof_source = quic::CreateDefaultProofSource();
   auto backend = backend_factory_->CreateBackend();
   auto server = server_factory_->CreateServer(
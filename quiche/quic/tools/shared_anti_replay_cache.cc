@@ -0,0 +1,200 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/shared_anti_replay_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "absl/numeric/int128.h"
+#include "quiche/quic/core/quic_utils.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+namespace {
+
+constexpr uint64_t kMagic = 0x5155494341525231;  // "QUICARR1"
+
+}  // namespace
+
+// static
+size_t SharedAntiReplayCache::RegionSize(size_t num_words) {
+  return kHeaderWords + kNumBuckets * (1 + num_words);
+}
+
+// static
+std::unique_ptr<SharedAntiReplayCache> SharedAntiReplayCache::Create(
+    size_t num_words, QuicTime::Delta window, const QuicClock* clock) {
+  const size_t region_size = RegionSize(num_words);
+  auto* region = new std::atomic<uint64_t>[region_size];
+  for (size_t i = 0; i < region_size; ++i) {
+    region[i].store(0, std::memory_order_relaxed);
+  }
+  std::unique_ptr<SharedAntiReplayCache> cache(new SharedAntiReplayCache(
+      region, num_words, window, clock, /*mapped=*/false));
+  if (!cache->InitializeHeader()) {
+    return nullptr;
+  }
+  return cache;
+}
+
+// static
+std::unique_ptr<SharedAntiReplayCache> SharedAntiReplayCache::CreateShared(
+    const std::string& path, size_t num_words, QuicTime::Delta window,
+    const QuicClock* clock) {
+  const size_t region_bytes = RegionSize(num_words) * sizeof(uint64_t);
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    QUIC_LOG(ERROR) << "Failed to open anti-replay cache " << path;
+    return nullptr;
+  }
+  struct stat file_stat;
+  // Extending the file fills it with zeros, which is an empty cache. A file of
+  // a different size was created with different parameters.
+  if (fstat(fd, &file_stat) != 0 ||
+      (file_stat.st_size != 0 &&
+       static_cast<size_t>(file_stat.st_size) != region_bytes) ||
+      (file_stat.st_size == 0 && ftruncate(fd, region_bytes) != 0)) {
+    QUIC_LOG(ERROR) << "Anti-replay cache " << path << " has the wrong size";
+    close(fd);
+    return nullptr;
+  }
+  void* region = mmap(nullptr, region_bytes, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+  close(fd);
+  if (region == MAP_FAILED) {
+    QUIC_LOG(ERROR) << "Failed to map anti-replay cache " << path;
+    return nullptr;
+  }
+  std::unique_ptr<SharedAntiReplayCache> cache(new SharedAntiReplayCache(
+      static_cast<std::atomic<uint64_t>*>(region), num_words, window, clock,
+      /*mapped=*/true));
+  if (!cache->InitializeHeader()) {
+    QUIC_LOG(ERROR) << "Anti-replay cache " << path
+                    << " was created with different parameters";
+    return nullptr;
+  }
+  return cache;
+}
+
+SharedAntiReplayCache::SharedAntiReplayCache(std::atomic<uint64_t>* region,
+                                             size_t num_words,
+                                             QuicTime::Delta window,
+                                             const QuicClock* clock,
+                                             bool mapped)
+    : region_(region),
+      num_words_(num_words),
+      window_(window),
+      clock_(clock),
+      mapped_(mapped) {
+  QUICHE_DCHECK_LT(0u, num_words_);
+  QUICHE_DCHECK(window_.IsPositive());
+}
+
+SharedAntiReplayCache::~SharedAntiReplayCache() {
+  if (mapped_) {
+    munmap(region_, RegionSize(num_words_) * sizeof(uint64_t));
+  } else {
+    delete[] region_;
+  }
+}
+
+bool SharedAntiReplayCache::InitializeHeader() {
+  const uint64_t expected[] = {
+      kMagic, num_words_, static_cast<uint64_t>(window_.ToMicroseconds())};
+  const size_t indices[] = {kMagicIndex, kNumWordsIndex, kWindowIndex};
+  for (int i = 0; i < 3; ++i) {
+    uint64_t value = 0;
+    if (!region_[indices[i]].compare_exchange_strong(value, expected[i]) &&
+        value != expected[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t SharedAntiReplayCache::CurrentEpoch() const {
+  return static_cast<uint64_t>(clock_->WallNow().ToUNIXMicroseconds()) /
+             window_.ToMicroseconds() +
+         1;
+}
+
+std::atomic<uint64_t>& SharedAntiReplayCache::BucketEpoch(uint64_t epoch) {
+  return region_[kHeaderWords + (epoch % kNumBuckets) * (1 + num_words_)];
+}
+
+std::atomic<uint64_t>* SharedAntiReplayCache::BucketWords(uint64_t epoch) {
+  return &BucketEpoch(epoch) + 1;
+}
+
+bool SharedAntiReplayCache::PrepareBucket(uint64_t epoch,
+                                          uint64_t current_epoch) {
+  std::atomic<uint64_t>& tag = BucketEpoch(epoch);
+  uint64_t current = tag.load(std::memory_order_acquire);
+  const uint64_t claim = kClearingBit | current_epoch;
+  do {
+    if (current == epoch) {
+      return true;
+    }
+    if ((current & kClearingBit) != 0) {
+      // Clearing takes much less than a window, so only a clearing started in
+      // this epoch can still be in progress.
+      if ((current & ~kClearingBit) >= current_epoch) {
+        return false;
+      }
+    } else if (current > epoch) {
+      // A tag from the future means that the clocks of the processes sharing
+      // the cache are far apart.
+      return false;
+    }
+  } while (!tag.compare_exchange_weak(current, claim,
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire));
+  std::atomic<uint64_t>* words = BucketWords(epoch);
+  for (size_t i = 0; i < num_words_; ++i) {
+    words[i].store(0, std::memory_order_relaxed);
+  }
+  // Unless the claim was taken over in the meantime.
+  uint64_t expected = claim;
+  return tag.compare_exchange_strong(expected, epoch,
+                                     std::memory_order_release,
+                                     std::memory_order_relaxed) ||
+         expected == epoch;
+}
+
+bool SharedAntiReplayCache::CheckAndInsert(absl::string_view ticket) {
+  const uint64_t epoch = CurrentEpoch();
+  // Clear the next bucket ahead of time, so that it is ready when the epoch
+  // changes.
+  PrepareBucket(epoch + 1, epoch);
+  if (!PrepareBucket(epoch, epoch)) {
+    // Rejecting early data is always safe.
+    return false;
+  }
+
+  // Tickets are encrypted and authenticated, so their hash cannot be chosen by
+  // an attacker. The hash must be the same in all processes.
+  const absl::uint128 hash = QuicUtils::FNV1a_128_Hash(ticket);
+  uint64_t bits = absl::Uint128Low64(hash);
+  const size_t index = absl::Uint128High64(hash) % num_words_;
+  uint64_t mask = 0;
+  for (int i = 0; i < kBitsPerTicket; ++i) {
+    mask |= uint64_t{1} << (bits & 63);
+    bits >>= 6;
+  }
+
+  if (BucketEpoch(epoch - 1).load(std::memory_order_acquire) == epoch - 1 &&
+      (BucketWords(epoch - 1)[index].load(std::memory_order_relaxed) & mask) ==
+          mask) {
+    return false;
+  }
+  const uint64_t previous = BucketWords(epoch)[index].fetch_or(
+      mask, std::memory_order_acq_rel);
+  return (previous & mask) != mask;
+}
+
+}  // namespace quic
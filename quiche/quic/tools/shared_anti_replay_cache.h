@@ -0,0 +1,114 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_TOOLS_SHARED_ANTI_REPLAY_CACHE_H_
+#define QUICHE_QUIC_TOOLS_SHARED_ANTI_REPLAY_CACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "quiche/quic/core/crypto/proof_source.h"
+#include "quiche/quic/core/quic_clock.h"
+#include "quiche/quic/core/quic_time.h"
+
+namespace quic {
+
+// SharedAntiReplayCache is a ProofSource::EarlyDataReplayCache which can be
+// shared by all the server processes that share session ticket keys, e.g.
+// through SharedTicketCrypter.
+//
+// It is a time bucketed, blocked Bloom filter: time is divided in epochs of
+// |window|, and the tickets seen in the current and the previous epoch are
+// remembered, which covers at least |window|. Each ticket sets a few bits of a
+// single 64 bit word, so that checking and inserting a ticket is one atomic
+// fetch_or and no lock is needed, even across processes. Three buckets are
+// used in rotation, the one for the next epoch is cleared while the other two
+// are in use.
+//
+// BoringSSL rejects early data with a ticket age skew of more than 60
+// seconds, so a |window| of 60 seconds or more makes sure that any replay which
+// would otherwise be accepted is detected.
+class QUIC_NO_EXPORT SharedAntiReplayCache
+    : public ProofSource::EarlyDataReplayCache {
+ public:
+  static constexpr QuicTime::Delta kDefaultWindow =
+      QuicTime::Delta::FromSeconds(60);
+
+  // Creates a cache in process memory. |num_words| 64 bit words are used per
+  // bucket, it should be at least the number of tickets expected per |window|.
+  static std::unique_ptr<SharedAntiReplayCache> Create(
+      size_t num_words, QuicTime::Delta window, const QuicClock* clock);
+
+  // Creates a cache in the file |path|, which is created if it does not exist
+  // and mapped into memory. All the processes which open the same file with
+  // the same parameters share the cache, it should be in a tmpfs such as
+  // /dev/shm. Returns nullptr on failure, e.g. if the file was created with
+  // different parameters.
+  static std::unique_ptr<SharedAntiReplayCache> CreateShared(
+      const std::string& path, size_t num_words, QuicTime::Delta window,
+      const QuicClock* clock);
+
+  ~SharedAntiReplayCache() override;
+
+  // ProofSource::EarlyDataReplayCache implementation.
+  bool CheckAndInsert(absl::string_view ticket) override;
+
+ private:
+  static constexpr int kNumBuckets = 3;
+  // Number of bits set per ticket.
+  static constexpr int kBitsPerTicket = 4;
+
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "The cache requires lock free atomics to be shared between "
+                "processes");
+
+  // Layout of the memory region, in 64 bit words: a header of kHeaderWords,
+  // then each bucket's epoch followed by its |num_words| words.
+  static constexpr size_t kHeaderWords = 4;
+  static constexpr size_t kMagicIndex = 0;
+  static constexpr size_t kNumWordsIndex = 1;
+  static constexpr size_t kWindowIndex = 2;
+
+  // Marks a bucket which is being cleared. The rest of the tag is the epoch
+  // in which the clearing started.
+  static constexpr uint64_t kClearingBit = uint64_t{1} << 63;
+
+  static size_t RegionSize(size_t num_words);
+
+  SharedAntiReplayCache(std::atomic<uint64_t>* region, size_t num_words,
+                        QuicTime::Delta window, const QuicClock* clock,
+                        bool mapped);
+
+  // Initializes the header of a zero filled region, or checks that it matches
+  // the parameters of this cache.
+  bool InitializeHeader();
+
+  // Returns the epoch the wall clock is in, starting from 1 so that zero filled
+  // buckets are never current.
+  uint64_t CurrentEpoch() const;
+
+  std::atomic<uint64_t>& BucketEpoch(uint64_t epoch);
+  std::atomic<uint64_t>* BucketWords(uint64_t epoch);
+
+  // Makes the bucket of |epoch| empty and tagged with |epoch|, unless it
+  // already is. Returns false if another thread or process started clearing
+  // it in |current_epoch|. A clearing started in an earlier epoch was
+  // abandoned, e.g. by a process which died, and is taken over.
+  bool PrepareBucket(uint64_t epoch, uint64_t current_epoch);
+
+  std::atomic<uint64_t>* const region_;
+  const size_t num_words_;
+  const QuicTime::Delta window_;
+  const QuicClock* clock_;
+  // True if |region_| is a file mapping, false if it was allocated with new.
+  const bool mapped_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TOOLS_SHARED_ANTI_REPLAY_CACHE_H_
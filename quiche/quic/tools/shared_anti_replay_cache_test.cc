@@ -0,0 +1,194 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/shared_anti_replay_cache.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "quiche/quic/platform/api/quic_test.h"
+#include "quiche/quic/platform/api/quic_thread.h"
+#include "quiche/quic/test_tools/mock_clock.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+constexpr size_t kNumWords = 1 << 16;
+constexpr QuicTime::Delta kWindow = QuicTime::Delta::FromSeconds(60);
+
+std::string Ticket(int thread, int i) {
+  return absl::StrCat("ticket-", thread, "-", i);
+}
+
+class SharedAntiReplayCacheTest : public QuicTest {
+ protected:
+  SharedAntiReplayCacheTest()
+      : path_(absl::StrCat(testing::TempDir(), "/anti_replay_",
+                           testing::UnitTest::GetInstance()
+                               ->current_test_info()
+                               ->name())) {
+    std::remove(path_.c_str());
+    clock_.AdvanceTime(QuicTime::Delta::FromSeconds(1000000));
+  }
+
+  ~SharedAntiReplayCacheTest() override { std::remove(path_.c_str()); }
+
+  const std::string path_;
+  MockClock clock_;
+};
+
+TEST_F(SharedAntiReplayCacheTest, RejectsReplay) {
+  std::unique_ptr<SharedAntiReplayCache> cache =
+      SharedAntiReplayCache::Create(kNumWords, kWindow, &clock_);
+  ASSERT_NE(nullptr, cache);
+  EXPECT_TRUE(cache->CheckAndInsert("ticket1"));
+  EXPECT_TRUE(cache->CheckAndInsert("ticket2"));
+  EXPECT_FALSE(cache->CheckAndInsert("ticket1"));
+  EXPECT_FALSE(cache->CheckAndInsert("ticket2"));
+}
+
+TEST_F(SharedAntiReplayCacheTest, RemembersTicketsForWindow) {
+  std::unique_ptr<SharedAntiReplayCache> cache =
+      SharedAntiReplayCache::Create(kNumWords, kWindow, &clock_);
+  ASSERT_NE(nullptr, cache);
+  EXPECT_TRUE(cache->CheckAndInsert("ticket"));
+  // Whatever the position in the epoch, a replay within |kWindow| is caught.
+  clock_.AdvanceTime(kWindow);
+  EXPECT_FALSE(cache->CheckAndInsert("ticket"));
+
+  // Tickets are forgotten after two windows.
+  EXPECT_TRUE(cache->CheckAndInsert("other ticket"));
+  clock_.AdvanceTime(2 * kWindow);
+  EXPECT_TRUE(cache->CheckAndInsert("other ticket"));
+  clock_.AdvanceTime(10 * kWindow);
+  EXPECT_TRUE(cache->CheckAndInsert("other ticket"));
+  EXPECT_FALSE(cache->CheckAndInsert("other ticket"));
+}
+
+TEST_F(SharedAntiReplayCacheTest, SharedBetweenMappings) {
+  // Each mapping stands for a server process.
+  std::unique_ptr<SharedAntiReplayCache> cache1 =
+      SharedAntiReplayCache::CreateShared(path_, kNumWords, kWindow, &clock_);
+  std::unique_ptr<SharedAntiReplayCache> cache2 =
+      SharedAntiReplayCache::CreateShared(path_, kNumWords, kWindow, &clock_);
+  ASSERT_NE(nullptr, cache1);
+  ASSERT_NE(nullptr, cache2);
+  EXPECT_TRUE(cache1->CheckAndInsert("ticket"));
+  EXPECT_FALSE(cache2->CheckAndInsert("ticket"));
+
+  EXPECT_EQ(nullptr, SharedAntiReplayCache::CreateShared(path_, kNumWords,
+                                                         2 * kWindow, &clock_));
+  EXPECT_EQ(nullptr, SharedAntiReplayCache::CreateShared(
+                         path_, 2 * kNumWords, kWindow, &clock_));
+}
+
+TEST_F(SharedAntiReplayCacheTest, TakesOverAbandonedClearing) {
+  std::unique_ptr<SharedAntiReplayCache> cache =
+      SharedAntiReplayCache::CreateShared(path_, kNumWords, kWindow, &clock_);
+  ASSERT_NE(nullptr, cache);
+  EXPECT_TRUE(cache->CheckAndInsert("ticket"));
+
+  // A process died while clearing the bucket of the next epoch ahead of time:
+  // the tag of the bucket, after the four words of the header, is left with
+  // the clearing bit and the epoch the clearing started in.
+  const uint64_t epoch =
+      clock_.WallNow().ToUNIXMicroseconds() / kWindow.ToMicroseconds() + 1;
+  const uint64_t tag = (uint64_t{1} << 63) | epoch;
+  const off_t tag_offset =
+      (4 + ((epoch + 1) % 3) * (1 + kNumWords)) * sizeof(uint64_t);
+  int fd = open(path_.c_str(), O_RDWR);
+  ASSERT_LE(0, fd);
+  ASSERT_EQ(static_cast<ssize_t>(sizeof(tag)),
+            pwrite(fd, &tag, sizeof(tag), tag_offset));
+  close(fd);
+
+  // The next epoch takes the bucket over instead of rejecting all tickets.
+  clock_.AdvanceTime(kWindow);
+  EXPECT_TRUE(cache->CheckAndInsert("other ticket"));
+  EXPECT_FALSE(cache->CheckAndInsert("other ticket"));
+  EXPECT_FALSE(cache->CheckAndInsert("ticket"));
+}
+
+class InsertingThread : public QuicThread {
+ public:
+  InsertingThread(SharedAntiReplayCache* cache, int id, int num_tickets,
+                  std::atomic<int>* shared_accepted,
+                  std::atomic<int>* own_accepted)
+      : QuicThread("InsertingThread"),
+        cache_(cache),
+        id_(id),
+        num_tickets_(num_tickets),
+        shared_accepted_(shared_accepted),
+        own_accepted_(own_accepted) {}
+
+ protected:
+  void Run() override {
+    int shared_accepted = 0;
+    int own_accepted = 0;
+    for (int i = 0; i < num_tickets_; ++i) {
+      // All the threads offer the same shared tickets, as if an attacker
+      // replayed them to all the server processes at once.
+      if (cache_->CheckAndInsert(Ticket(0, i))) {
+        ++shared_accepted;
+      }
+      if (cache_->CheckAndInsert(Ticket(id_ + 1, i))) {
+        ++own_accepted;
+      }
+    }
+    shared_accepted_->fetch_add(shared_accepted);
+    own_accepted_->fetch_add(own_accepted);
+  }
+
+ private:
+  SharedAntiReplayCache* cache_;
+  const int id_;
+  const int num_tickets_;
+  std::atomic<int>* shared_accepted_;
+  std::atomic<int>* own_accepted_;
+};
+
+// Many threads checking tickets concurrently never accept a ticket twice, and
+// only rarely reject a fresh one.
+TEST_F(SharedAntiReplayCacheTest, ConcurrentLookups) {
+  const int kNumThreads = 8;
+  const int kNumTickets = 20000;
+  std::unique_ptr<SharedAntiReplayCache> cache =
+      SharedAntiReplayCache::CreateShared(path_, 4 * kNumWords, kWindow,
+                                          &clock_);
+  ASSERT_NE(nullptr, cache);
+
+  std::atomic<int> shared_accepted(0);
+  std::atomic<int> own_accepted(0);
+  std::vector<std::unique_ptr<InsertingThread>> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.push_back(std::make_unique<InsertingThread>(
+        cache.get(), i, kNumTickets, &shared_accepted, &own_accepted));
+  }
+  for (auto& thread : threads) {
+    thread->Start();
+  }
+  for (auto& thread : threads) {
+    thread->Join();
+  }
+
+  EXPECT_LE(shared_accepted.load(), kNumTickets);
+  EXPECT_GT(shared_accepted.load(), kNumTickets * 99 / 100);
+  EXPECT_GT(own_accepted.load(), kNumThreads * kNumTickets * 99 / 100);
+  for (int i = 0; i < kNumTickets; ++i) {
+    ASSERT_FALSE(cache->CheckAndInsert(Ticket(0, i)));
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -0,0 +1,232 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/shared_ticket_crypter.h"
+
+#include <atomic>
+#include <utility>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_split.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "openssl/rand.h"
+#include "quiche/quic/platform/api/quic_logging.h"
+#include "quiche/common/platform/api/quiche_file_utils.h"
+
+namespace quic {
+
+namespace {
+
+// The format of an encrypted ticket is 4 bytes of key id, followed by 12 bytes
+// of nonce, followed by the output from the AES-GCM Seal operation. The seal
+// operation has an overhead of 16 bytes for its auth tag. The key id is also
+// authenticated as additional data.
+constexpr size_t kKeyIdSize = 4;
+constexpr size_t kNonceSize = 12;
+constexpr size_t kAuthTagSize = 16;
+
+constexpr size_t kNonceOffset = kKeyIdSize;
+constexpr size_t kMessageOffset = kNonceOffset + kNonceSize;
+
+void WriteKeyId(uint32_t id, uint8_t* out) {
+  out[0] = static_cast<uint8_t>(id >> 24);
+  out[1] = static_cast<uint8_t>(id >> 16);
+  out[2] = static_cast<uint8_t>(id >> 8);
+  out[3] = static_cast<uint8_t>(id);
+}
+
+uint32_t ReadKeyId(const uint8_t* in) {
+  return (static_cast<uint32_t>(in[0]) << 24) |
+         (static_cast<uint32_t>(in[1]) << 16) |
+         (static_cast<uint32_t>(in[2]) << 8) | static_cast<uint32_t>(in[3]);
+}
+
+bool IsHex(absl::string_view text) {
+  for (char c : text) {
+    if (!absl::ascii_isxdigit(c)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+class SharedTicketCrypter::ReloadThread : public QuicThread {
+ public:
+  explicit ReloadThread(SharedTicketCrypter* crypter)
+      : QuicThread("TicketKeyReload"), crypter_(crypter) {}
+
+ protected:
+  void Run() override {
+    const absl::Duration interval =
+        absl::Microseconds(crypter_->reload_interval_.ToMicroseconds());
+    while (!crypter_->stopping_.WaitForNotificationWithTimeout(interval)) {
+      crypter_->Reload();
+    }
+  }
+
+ private:
+  SharedTicketCrypter* crypter_;
+};
+
+// static
+std::unique_ptr<SharedTicketCrypter> SharedTicketCrypter::Create(
+    std::string key_file, QuicTime::Delta reload_interval) {
+  std::unique_ptr<SharedTicketCrypter> crypter(
+      new SharedTicketCrypter(std::move(key_file), reload_interval));
+  if (!crypter->Reload()) {
+    return nullptr;
+  }
+  return crypter;
+}
+
+SharedTicketCrypter::SharedTicketCrypter(std::string key_file,
+                                         QuicTime::Delta reload_interval)
+    : key_file_(std::move(key_file)), reload_interval_(reload_interval) {}
+
+SharedTicketCrypter::~SharedTicketCrypter() {
+  if (reload_thread_ != nullptr) {
+    stopping_.Notify();
+    reload_thread_->Join();
+  }
+}
+
+size_t SharedTicketCrypter::MaxOverhead() {
+  return kMessageOffset + kAuthTagSize;
+}
+
+std::vector<uint8_t> SharedTicketCrypter::Encrypt(
+    absl::string_view in, absl::string_view encryption_key) {
+  // Keys come from the key ring file only.
+  QUICHE_DCHECK(encryption_key.empty());
+  std::shared_ptr<const KeyRing> key_ring = GetKeyRing();
+  const Key& key = *key_ring->keys.front();
+
+  std::vector<uint8_t> out(in.size() + MaxOverhead());
+  WriteKeyId(key.id, out.data());
+  RAND_bytes(out.data() + kNonceOffset, kNonceSize);
+  size_t out_len;
+  if (!EVP_AEAD_CTX_seal(key.aead_ctx.get(), out.data() + kMessageOffset,
+                         &out_len, out.size() - kMessageOffset,
+                         out.data() + kNonceOffset, kNonceSize,
+                         reinterpret_cast<const uint8_t*>(in.data()),
+                         in.size(), out.data(), kKeyIdSize)) {
+    return std::vector<uint8_t>();
+  }
+  out.resize(out_len + kMessageOffset);
+  return out;
+}
+
+std::vector<uint8_t> SharedTicketCrypter::Decrypt(absl::string_view in) {
+  if (in.size() < kMessageOffset) {
+    return std::vector<uint8_t>();
+  }
+  const uint8_t* input = reinterpret_cast<const uint8_t*>(in.data());
+  const uint32_t id = ReadKeyId(input);
+
+  std::shared_ptr<const KeyRing> key_ring = GetKeyRing();
+  const Key* key = nullptr;
+  for (const std::unique_ptr<Key>& candidate : key_ring->keys) {
+    if (candidate->id == id) {
+      key = candidate.get();
+      break;
+    }
+  }
+  if (key == nullptr) {
+    return std::vector<uint8_t>();
+  }
+  std::vector<uint8_t> out(in.size() - kMessageOffset);
+  size_t out_len;
+  if (!EVP_AEAD_CTX_open(key->aead_ctx.get(), out.data(), &out_len,
+                         out.size(), input + kNonceOffset, kNonceSize,
+                         input + kMessageOffset, in.size() - kMessageOffset,
+                         input, kKeyIdSize)) {
+    return std::vector<uint8_t>();
+  }
+  out.resize(out_len);
+  return out;
+}
+
+void SharedTicketCrypter::Decrypt(
+    absl::string_view in,
+    std::shared_ptr<quic::ProofSource::DecryptCallback> callback) {
+  callback->Run(Decrypt(in));
+}
+
+size_t SharedTicketCrypter::NumKeys() { return GetKeyRing()->keys.size(); }
+
+std::shared_ptr<const SharedTicketCrypter::KeyRing>
+SharedTicketCrypter::GetKeyRing() const {
+  return std::atomic_load(&key_ring_);
+}
+
+bool SharedTicketCrypter::Reload() {
+  QuicWriterMutexLock lock(&reload_mutex_);
+  absl::optional<std::string> contents = quiche::ReadFileContents(key_file_);
+  if (!contents.has_value()) {
+    QUIC_LOG(ERROR) << "Failed to read ticket key file " << key_file_;
+    return false;
+  }
+  if (GetKeyRing() != nullptr && *contents == key_file_contents_) {
+    return true;
+  }
+  std::shared_ptr<const KeyRing> key_ring = ParseKeyRing(*contents);
+  if (key_ring == nullptr) {
+    QUIC_LOG(ERROR) << "Invalid ticket key file " << key_file_;
+    return false;
+  }
+  std::atomic_store(&key_ring_, std::move(key_ring));
+  key_file_contents_ = *std::move(contents);
+  return true;
+}
+
+void SharedTicketCrypter::StartReloadThread() {
+  QUICHE_DCHECK(reload_thread_ == nullptr);
+  reload_thread_ = std::make_unique<ReloadThread>(this);
+  reload_thread_->Start();
+}
+
+// static
+std::shared_ptr<const SharedTicketCrypter::KeyRing>
+SharedTicketCrypter::ParseKeyRing(absl::string_view contents) {
+  auto key_ring = std::make_shared<KeyRing>();
+  for (absl::string_view line : absl::StrSplit(contents, '\n')) {
+    line = absl::StripAsciiWhitespace(line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::vector<absl::string_view> fields =
+        absl::StrSplit(line, ' ', absl::SkipEmpty());
+    if (fields.size() != 2 || fields[0].size() != 2 * kKeyIdSize ||
+        fields[1].size() != 2 * kKeySize || !IsHex(fields[0]) ||
+        !IsHex(fields[1])) {
+      return nullptr;
+    }
+    const std::string id = absl::HexStringToBytes(fields[0]);
+    const std::string key_bytes = absl::HexStringToBytes(fields[1]);
+
+    auto key = std::make_unique<Key>();
+    key->id = ReadKeyId(reinterpret_cast<const uint8_t*>(id.data()));
+    for (const std::unique_ptr<Key>& existing : key_ring->keys) {
+      if (existing->id == key->id) {
+        return nullptr;
+      }
+    }
+    if (!EVP_AEAD_CTX_init(key->aead_ctx.get(), EVP_aead_aes_128_gcm(),
+                           reinterpret_cast<const uint8_t*>(key_bytes.data()),
+                           kKeySize, EVP_AEAD_DEFAULT_TAG_LENGTH, nullptr)) {
+      return nullptr;
+    }
+    key_ring->keys.push_back(std::move(key));
+  }
+  if (key_ring->keys.empty()) {
+    return nullptr;
+  }
+  return key_ring;
+}
+
+}  // namespace quic
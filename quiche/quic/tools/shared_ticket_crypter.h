@@ -0,0 +1,116 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_TOOLS_SHARED_TICKET_CRYPTER_H_
+#define QUICHE_QUIC_TOOLS_SHARED_TICKET_CRYPTER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/notification.h"
+#include "openssl/aead.h"
+#include "quiche/quic/core/crypto/proof_source.h"
+#include "quiche/quic/core/quic_time.h"
+#include "quiche/quic/platform/api/quic_mutex.h"
+#include "quiche/quic/platform/api/quic_thread.h"
+
+namespace quic {
+
+// SharedTicketCrypter implements the QUIC ProofSource::TicketCrypter interface
+// with keys read from a key ring file, so that all the server processes which
+// read the same file can resume each other's sessions. Unlike
+// SimpleTicketCrypter, it never generates keys itself.
+//
+// The key ring file has one key per line, in the form
+//   <key id: 8 hex digits> <AES-128 key: 32 hex digits>
+// Empty lines and lines starting with '#' are ignored. The first key encrypts
+// new tickets, all the keys decrypt them. To rotate keys without failing
+// resumptions, first append the new key to the file on all servers, then move
+// it to the top once every server has picked it up, and finally remove the
+// oldest key once tickets encrypted with it have expired.
+//
+// The file is read again by Reload(), or every |reload_interval| by a
+// background thread once StartReloadThread() is called, so Encrypt() and
+// Decrypt() never touch the file. It should be replaced atomically, e.g. with
+// rename(). Keeping it in a tmpfs such as /dev/shm avoids disk reads. Thread
+// safe.
+class QUIC_NO_EXPORT SharedTicketCrypter
+    : public quic::ProofSource::TicketCrypter {
+ public:
+  static constexpr QuicTime::Delta kDefaultReloadInterval =
+      QuicTime::Delta::FromSeconds(10);
+
+  // Returns nullptr if |key_file| cannot be read or does not contain a valid
+  // key ring.
+  static std::unique_ptr<SharedTicketCrypter> Create(
+      std::string key_file,
+      QuicTime::Delta reload_interval = kDefaultReloadInterval);
+
+  // Stops the reload thread, if any.
+  ~SharedTicketCrypter() override;
+
+  size_t MaxOverhead() override;
+  std::vector<uint8_t> Encrypt(absl::string_view in,
+                               absl::string_view encryption_key) override;
+  void Decrypt(
+      absl::string_view in,
+      std::shared_ptr<quic::ProofSource::DecryptCallback> callback) override;
+
+  // Reads the key file again, and swaps in its keys if they are valid.
+  // Returns false and keeps the current keys otherwise.
+  bool Reload();
+
+  // Starts a thread which calls Reload() every |reload_interval| until the
+  // crypter is destroyed.
+  void StartReloadThread();
+
+  // Number of keys in the current key ring.
+  size_t NumKeys();
+
+ private:
+  class ReloadThread;
+
+  static constexpr size_t kKeySize = 16;
+
+  struct Key {
+    uint32_t id;
+    bssl::ScopedEVP_AEAD_CTX aead_ctx;
+  };
+  struct KeyRing {
+    // The first key encrypts.
+    std::vector<std::unique_ptr<Key>> keys;
+  };
+
+  SharedTicketCrypter(std::string key_file, QuicTime::Delta reload_interval);
+
+  // Parses |contents| of a key ring file. Returns nullptr on failure.
+  static std::shared_ptr<const KeyRing> ParseKeyRing(
+      absl::string_view contents);
+
+  // Returns the current key ring without blocking on a reload.
+  std::shared_ptr<const KeyRing> GetKeyRing() const;
+
+  std::vector<uint8_t> Decrypt(absl::string_view in);
+
+  const std::string key_file_;
+  const QuicTime::Delta reload_interval_;
+
+  // Only accessed with std::atomic_load and std::atomic_store, so that a
+  // reload never blocks the handshakes which use the previous key ring.
+  std::shared_ptr<const KeyRing> key_ring_;
+
+  // Serializes reloads.
+  QuicMutex reload_mutex_;
+  std::string key_file_contents_ QUIC_GUARDED_BY(reload_mutex_);
+
+  absl::Notification stopping_;
+  std::unique_ptr<ReloadThread> reload_thread_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TOOLS_SHARED_TICKET_CRYPTER_H_
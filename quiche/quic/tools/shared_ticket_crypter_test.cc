@@ -0,0 +1,156 @@
+// Copyright 2023 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quiche/quic/tools/shared_ticket_crypter.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "quiche/quic/platform/api/quic_test.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+constexpr char kKey1[] = "00000001 000102030405060708090a0b0c0d0e0f\n";
+constexpr char kKey2[] = "00000002 f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff\n";
+
+class DecryptCallback : public quic::ProofSource::DecryptCallback {
+ public:
+  explicit DecryptCallback(std::vector<uint8_t>* out) : out_(out) {}
+
+  void Run(std::vector<uint8_t> plaintext) override { *out_ = plaintext; }
+
+ private:
+  std::vector<uint8_t>* out_;
+};
+
+absl::string_view StringPiece(const std::vector<uint8_t>& in) {
+  return absl::string_view(reinterpret_cast<const char*>(in.data()), in.size());
+}
+
+class SharedTicketCrypterTest : public QuicTest {
+ protected:
+  SharedTicketCrypterTest()
+      : key_file_(absl::StrCat(testing::TempDir(), "/ticket_keys_",
+                               testing::UnitTest::GetInstance()
+                                   ->current_test_info()
+                                   ->name())) {}
+
+  void WriteKeyFile(const std::string& contents) {
+    std::ofstream file(key_file_, std::ios::trunc);
+    file << contents;
+  }
+
+  std::vector<uint8_t> Decrypt(SharedTicketCrypter* crypter,
+                               const std::vector<uint8_t>& ciphertext) {
+    std::vector<uint8_t> out;
+    crypter->Decrypt(StringPiece(ciphertext),
+                     std::make_shared<DecryptCallback>(&out));
+    return out;
+  }
+
+  const std::string key_file_;
+  const std::vector<uint8_t> plaintext_ = {1, 2, 3, 4, 5};
+};
+
+TEST_F(SharedTicketCrypterTest, InvalidKeyFile) {
+  EXPECT_EQ(nullptr, SharedTicketCrypter::Create(key_file_ + "_missing"));
+  for (const std::string& contents :
+       {std::string(), std::string("# no keys\n"),
+        std::string("00000001 0001\n"),
+        std::string("0000000g 000102030405060708090a0b0c0d0e0f\n"),
+        absl::StrCat(kKey1, kKey1)}) {
+    SCOPED_TRACE(contents);
+    WriteKeyFile(contents);
+    EXPECT_EQ(nullptr, SharedTicketCrypter::Create(key_file_));
+  }
+}
+
+TEST_F(SharedTicketCrypterTest, ProcessesShareKeys) {
+  WriteKeyFile(absl::StrCat("# Current key first.\n", kKey1, "\n", kKey2));
+  std::unique_ptr<SharedTicketCrypter> crypter1 =
+      SharedTicketCrypter::Create(key_file_);
+  std::unique_ptr<SharedTicketCrypter> crypter2 =
+      SharedTicketCrypter::Create(key_file_);
+  ASSERT_NE(nullptr, crypter1);
+  ASSERT_NE(nullptr, crypter2);
+  EXPECT_EQ(2u, crypter1->NumKeys());
+
+  std::vector<uint8_t> ciphertext =
+      crypter1->Encrypt(StringPiece(plaintext_), {});
+  EXPECT_EQ(plaintext_.size() + crypter1->MaxOverhead(), ciphertext.size());
+  EXPECT_EQ(plaintext_, Decrypt(crypter2.get(), ciphertext));
+}
+
+TEST_F(SharedTicketCrypterTest, DecryptionFailureWithModifiedCiphertext) {
+  WriteKeyFile(kKey1);
+  std::unique_ptr<SharedTicketCrypter> crypter =
+      SharedTicketCrypter::Create(key_file_);
+  ASSERT_NE(nullptr, crypter);
+  std::vector<uint8_t> ciphertext =
+      crypter->Encrypt(StringPiece(plaintext_), {});
+
+  for (size_t i = 0; i < ciphertext.size(); i++) {
+    SCOPED_TRACE(i);
+    std::vector<uint8_t> munged_ciphertext = ciphertext;
+    munged_ciphertext[i] ^= 1;
+    EXPECT_TRUE(Decrypt(crypter.get(), munged_ciphertext).empty());
+  }
+  EXPECT_TRUE(Decrypt(crypter.get(), {}).empty());
+}
+
+TEST_F(SharedTicketCrypterTest, KeyRotation) {
+  WriteKeyFile(kKey1);
+  std::unique_ptr<SharedTicketCrypter> crypter =
+      SharedTicketCrypter::Create(key_file_);
+  ASSERT_NE(nullptr, crypter);
+  std::vector<uint8_t> old_ciphertext =
+      crypter->Encrypt(StringPiece(plaintext_), {});
+
+  // The new key is used once the file is read again.
+  WriteKeyFile(absl::StrCat(kKey2, kKey1));
+  EXPECT_EQ(1u, crypter->NumKeys());
+  EXPECT_TRUE(crypter->Reload());
+  EXPECT_EQ(2u, crypter->NumKeys());
+  std::vector<uint8_t> new_ciphertext =
+      crypter->Encrypt(StringPiece(plaintext_), {});
+  EXPECT_EQ(plaintext_, Decrypt(crypter.get(), old_ciphertext));
+  EXPECT_EQ(plaintext_, Decrypt(crypter.get(), new_ciphertext));
+
+  // An invalid file keeps the current keys.
+  WriteKeyFile("garbage");
+  EXPECT_FALSE(crypter->Reload());
+  EXPECT_EQ(plaintext_, Decrypt(crypter.get(), old_ciphertext));
+
+  // Tickets of a removed key are rejected.
+  WriteKeyFile(kKey2);
+  EXPECT_TRUE(crypter->Reload());
+  EXPECT_TRUE(Decrypt(crypter.get(), old_ciphertext).empty());
+  EXPECT_EQ(plaintext_, Decrypt(crypter.get(), new_ciphertext));
+}
+
+TEST_F(SharedTicketCrypterTest, ReloadThread) {
+  WriteKeyFile(kKey1);
+  std::unique_ptr<SharedTicketCrypter> crypter = SharedTicketCrypter::Create(
+      key_file_, QuicTime::Delta::FromMilliseconds(1));
+  ASSERT_NE(nullptr, crypter);
+  crypter->StartReloadThread();
+
+  WriteKeyFile(absl::StrCat(kKey2, kKey1));
+  const absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (crypter->NumKeys() != 2u && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_EQ(2u, crypter->NumKeys());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic